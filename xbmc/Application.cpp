@@ -83,6 +83,7 @@
 #include "powermanagement/PowerManager.h"
 #include "powermanagement/DPMSSupport.h"
 #include "settings/SettingAddon.h"
+#include "settings/SettingHandle.h"
 #include "settings/Settings.h"
 #include "settings/AdvancedSettings.h"
 #include "settings/DisplaySettings.h"
@@ -2271,8 +2272,8 @@ void CApplication::Render()
 
   // reset our info cache - we do this at the end of Render so that it is
   // fresh for the next process(), or after a windowclose animation (where process()
-  // isn't called)
-  g_infoManager.ResetCache();
+  // isn't called). Only the info bools whose state changed are reset.
+  g_infoManager.ResetChangedCache(true);
   lock.Leave();
 
   unsigned int now = XbmcThreads::SystemClockMillis();
@@ -2952,6 +2953,8 @@ void CApplication::FrameMove(bool processEvents, bool processGUI)
   }
   if (processGUI && m_renderGUI)
   {
+    // input processing may have changed the state the info bools depend on (focus etc.)
+    g_infoManager.ResetChangedCache();
     if (!m_bStop)
       g_windowManager.Process(CTimeUtils::GetFrameTime());
     g_windowManager.FrameMove();
@@ -4601,6 +4604,12 @@ bool CApplication::WakeUpScreenSaver(bool bPowerOffKeyPressed /* = false */)
     return false;
 }
 
+// read every frame
+static CSettingStringHandle s_screensaverMode("screensaver.mode");
+static CSettingIntHandle s_screensaverTime("screensaver.time");
+static CSettingIntHandle s_displaysOff("powermanagement.displaysoff");
+static CSettingStringHandle s_visualisation("musicplayer.visualisation");
+
 void CApplication::CheckScreenSaverAndDPMS()
 {
   if (!m_dpmsIsActive)
@@ -4608,10 +4617,10 @@ void CApplication::CheckScreenSaverAndDPMS()
 
   bool maybeScreensaver =
       !m_dpmsIsActive && !m_bScreenSave
-      && !CSettings::Get().GetString("screensaver.mode").empty();
+      && !s_screensaverMode.IsEmpty();
   bool maybeDPMS =
       !m_dpmsIsActive && m_dpms->IsSupported()
-      && CSettings::Get().GetInt("powermanagement.displaysoff") > 0;
+      && s_displaysOff.Get() > 0;
 
   // Has the screen saver window become active?
   if (maybeScreensaver && g_windowManager.IsWindowActive(WINDOW_SCREENSAVER))
@@ -4633,7 +4642,7 @@ void CApplication::CheckScreenSaverAndDPMS()
   if ((m_pPlayer->IsPlayingVideo() && !m_pPlayer->IsPaused())
       // * Are we playing some music in fullscreen vis?
       || (m_pPlayer->IsPlayingAudio() && g_windowManager.GetActiveWindow() == WINDOW_VISUALISATION
-          && !CSettings::Get().GetString("musicplayer.visualisation").empty()))
+          && !s_visualisation.IsEmpty()))
   {
     ResetScreenSaverTimer();
     return;
@@ -4643,13 +4652,13 @@ void CApplication::CheckScreenSaverAndDPMS()
 
   // DPMS has priority (it makes the screensaver not needed)
   if (maybeDPMS
-      && elapsed > CSettings::Get().GetInt("powermanagement.displaysoff") * 60)
+      && elapsed > s_displaysOff.Get() * 60)
   {
     ToggleDPMS(false);
     WakeUpScreenSaver();
   }
   else if (maybeScreensaver
-           && elapsed > CSettings::Get().GetInt("screensaver.time") * 60)
+           && elapsed > s_screensaverTime.Get() * 60)
   {
     ActivateScreenSaver();
   }
@@ -45,6 +45,7 @@
 #include "utils/Observer.h"
 #include "video/VideoInfoTag.h"
 #include "threads/SingleLock.h"
+#include "threads/Atomics.h"
 #include "music/tags/MusicInfoTag.h"
 #include "pictures/PictureInfoTag.h"
 #include "music/Artist.h"
@@ -58,6 +59,7 @@
 #include "utils/Variant.h"
 #include "music/karaoke/karaokelyricsfactory.h"
 #include "utils/Mime.h"
+#include "FileItemListCache.h"
 #ifdef HAS_ASAP_CODEC
 #include "cores/paplayer/ASAPCodec.h"
 #endif
@@ -78,6 +80,8 @@ CFileItem::CFileItem(const CSong& song)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
 
   SetFromSong(song);
@@ -92,6 +96,8 @@ CFileItem::CFileItem(const CStdString &path, const CAlbum& album)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
 
   m_strPath = path;
@@ -108,6 +114,8 @@ CFileItem::CFileItem(const CMusicInfoTag& music)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   SetLabel(music.GetTitle());
   m_strPath = music.GetURL();
@@ -126,6 +134,8 @@ CFileItem::CFileItem(const CVideoInfoTag& movie)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
 
   SetFromVideoInfoTag(movie);
@@ -140,6 +150,8 @@ CFileItem::CFileItem(const CEpgInfoTag& tag)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
 
   Reset();
 
@@ -167,6 +179,8 @@ CFileItem::CFileItem(const CPVRChannel& channel)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
 
   Reset();
   CEpgInfoTag epgNow;
@@ -218,6 +232,8 @@ CFileItem::CFileItem(const CPVRRecording& record)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
 
   Reset();
 
@@ -239,6 +255,8 @@ CFileItem::CFileItem(const CPVRTimerInfoTag& timer)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
 
   Reset();
 
@@ -264,6 +282,8 @@ CFileItem::CFileItem(const CArtist& artist)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   SetLabel(artist.strArtist);
   m_strPath = artist.strArtist;
@@ -282,6 +302,8 @@ CFileItem::CFileItem(const CGenre& genre)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   SetLabel(genre.strGenre);
   m_strPath = genre.strGenre;
@@ -300,6 +322,8 @@ CFileItem::CFileItem(const CFileItem& item): CGUIListItem()
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   *this = item;
 }
 
@@ -312,6 +336,8 @@ CFileItem::CFileItem(const CGUIListItem& item)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   // not particularly pretty, but it gets around the issue of Reset() defaulting
   // parameters in the CGUIListItem base class.
@@ -329,6 +355,8 @@ CFileItem::CFileItem(void)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
 }
 
@@ -342,6 +370,8 @@ CFileItem::CFileItem(const CStdString& strLabel)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   SetLabel(strLabel);
 }
@@ -355,6 +385,8 @@ CFileItem::CFileItem(const CStdString& strPath, bool bIsFolder)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   m_strPath = strPath;
   m_bIsFolder = bIsFolder;
@@ -373,6 +405,8 @@ CFileItem::CFileItem(const CMediaSource& share)
   m_pvrRecordingInfoTag = NULL;
   m_pvrTimerInfoTag = NULL;
   m_pictureInfoTag = NULL;
+  m_deferredLock = 0;
+  m_deferredPending = 0;
   Reset();
   m_bIsFolder = true;
   m_bIsShareOrDrive = true;
@@ -420,13 +454,18 @@ const CFileItem& CFileItem::operator=(const CFileItem& item)
   CGUIListItem::operator=(item);
   m_bLabelPreformated=item.m_bLabelPreformated;
   FreeMemory();
+  SetDeferredTags(boost::shared_ptr<const DeferredTags>());
   m_strPath = item.GetPath();
   m_bIsParentFolder = item.m_bIsParentFolder;
   m_iDriveType = item.m_iDriveType;
   m_bIsShareOrDrive = item.m_bIsShareOrDrive;
   m_dateTime = item.m_dateTime;
   m_dwSize = item.m_dwSize;
-  if (item.HasMusicInfoTag())
+
+  // item may be decoding its tags on a thumb loader meanwhile. Tags still archived in a
+  // list cache are shared rather than decoded, decoded ones don't change anymore
+  boost::shared_ptr<const DeferredTags> deferred = item.GetDeferredTags();
+  if (!deferred && item.m_musicInfoTag)
   {
     m_musicInfoTag = GetMusicInfoTag();
     if (m_musicInfoTag)
@@ -438,7 +477,7 @@ const CFileItem& CFileItem::operator=(const CFileItem& item)
     m_musicInfoTag = NULL;
   }
 
-  if (item.HasVideoInfoTag())
+  if (!deferred && item.m_videoInfoTag)
   {
     m_videoInfoTag = GetVideoInfoTag();
     if (m_videoInfoTag)
@@ -506,7 +545,7 @@ const CFileItem& CFileItem::operator=(const CFileItem& item)
     m_pvrTimerInfoTag = NULL;
   }
 
-  if (item.HasPictureInfoTag())
+  if (!deferred && item.m_pictureInfoTag)
   {
     m_pictureInfoTag = GetPictureInfoTag();
     if (m_pictureInfoTag)
@@ -534,6 +573,7 @@ const CFileItem& CFileItem::operator=(const CFileItem& item)
   m_extrainfo = item.m_extrainfo;
   m_specialSort = item.m_specialSort;
   m_bIsAlbum = item.m_bIsAlbum;
+  SetDeferredTags(deferred);
   return *this;
 }
 
@@ -580,6 +620,7 @@ void CFileItem::Reset()
   m_pvrTimerInfoTag=NULL;
   delete m_pictureInfoTag;
   m_pictureInfoTag=NULL;
+  SetDeferredTags(boost::shared_ptr<const DeferredTags>());
   m_extrainfo.clear();
   m_specialSort = SortSpecialNone;
   ClearProperties();
@@ -592,6 +633,8 @@ void CFileItem::Archive(CArchive& ar)
 
   if (ar.IsStoring())
   {
+    LoadDeferredTags();
+
     ar << m_bIsParentFolder;
     ar << m_bLabelPreformated;
     ar << m_strPath;
@@ -693,6 +736,7 @@ void CFileItem::Serialize(CVariant& value) const
   value["mimetype"] = m_mimetype;
   value["extrainfo"] = m_extrainfo;
 
+  LoadDeferredTags();
   if (m_musicInfoTag)
     (*m_musicInfoTag).Serialize(value["musicInfoTag"]);
 
@@ -1439,6 +1483,8 @@ bool CFileItem::IsSamePath(const CFileItem *item) const
       return (item->GetProperty("item_start") == GetProperty("item_start"));
     return true;
   }
+  LoadDeferredTags();
+  item->LoadDeferredTags();
   if (HasVideoInfoTag() && item->HasVideoInfoTag())
   {
     if (m_videoInfoTag->m_iDbId != -1 && item->m_videoInfoTag->m_iDbId != -1)
@@ -2613,15 +2659,10 @@ void CFileItemList::StackFiles()
 
 bool CFileItemList::Load(int windowID)
 {
-  CFile file;
-  if (file.Open(GetDiscFileCache(windowID)))
+  if (CFileItemListCache::Load(*this, GetDiscFileCache(windowID)))
   {
-    CArchive ar(&file, CArchive::load);
-    ar >> *this;
     CLog::Log(LOGDEBUG,"Loading items: %i, directory: %s sort method: %i, ascending: %s", Size(), CURL::GetRedacted(GetPath()).c_str(), m_sortDescription.sortBy,
       m_sortDescription.sortOrder == SortOrderAscending ? "true" : "false");
-    ar.Close();
-    file.Close();
     return true;
   }
 
@@ -2636,14 +2677,9 @@ bool CFileItemList::Save(int windowID)
 
   CLog::Log(LOGDEBUG,"Saving fileitems [%s]", CURL::GetRedacted(GetPath()).c_str());
 
-  CFile file;
-  if (file.OpenForWrite(GetDiscFileCache(windowID), true)) // overwrite always
+  if (CFileItemListCache::Save(*this, GetDiscFileCache(windowID)))
   {
-    CArchive ar(&file, CArchive::store);
-    ar << *this;
     CLog::Log(LOGDEBUG,"  -- items: %i, sort method: %i, ascending: %s", iSize, m_sortDescription.sortBy, m_sortDescription.sortOrder == SortOrderAscending ? "true" : "false");
-    ar.Close();
-    file.Close();
     return true;
   }
 
@@ -3051,7 +3087,7 @@ bool CFileItem::LoadMusicTag()
   if (!IsAudio())
     return false;
   // already loaded?
-  if (HasMusicInfoTag() && m_musicInfoTag->Loaded())
+  if (HasMusicInfoTag() && GetMusicInfoTag()->Loaded())
     return true;
   // check db
   CMusicDatabase musicDatabase;
@@ -3167,8 +3203,21 @@ void CFileItemList::ClearSortState()
   m_sortDescription.sortAttributes = SortAttributeNone;
 }
 
+bool CFileItem::HasVideoInfoTag() const
+{
+  // checked first, the tag is published before it stops being deferred
+  return HasDeferredTag(DeferredVideoTag) || m_videoInfoTag != NULL;
+}
+
+const CVideoInfoTag* CFileItem::GetVideoInfoTag() const
+{
+  LoadDeferredTags();
+  return m_videoInfoTag;
+}
+
 CVideoInfoTag* CFileItem::GetVideoInfoTag()
 {
+  LoadDeferredTags();
   if (!m_videoInfoTag)
     m_videoInfoTag = new CVideoInfoTag;
 
@@ -3207,16 +3256,105 @@ CPVRTimerInfoTag* CFileItem::GetPVRTimerInfoTag()
   return m_pvrTimerInfoTag;
 }
 
+bool CFileItem::HasPictureInfoTag() const
+{
+  // checked first, the tag is published before it stops being deferred
+  return HasDeferredTag(DeferredPictureTag) || m_pictureInfoTag != NULL;
+}
+
+const CPictureInfoTag* CFileItem::GetPictureInfoTag() const
+{
+  LoadDeferredTags();
+  return m_pictureInfoTag;
+}
+
 CPictureInfoTag* CFileItem::GetPictureInfoTag()
 {
+  LoadDeferredTags();
   if (!m_pictureInfoTag)
     m_pictureInfoTag = new CPictureInfoTag;
 
   return m_pictureInfoTag;
 }
 
+bool CFileItem::HasDeferredTag(DeferredTag tag) const
+{
+  if (!AtomicLoadAcquire(&m_deferredPending))
+    return false;
+  CAtomicSpinLock lock(m_deferredLock);
+  return m_deferredTags && (m_deferredTags->types & tag) != 0;
+}
+
+boost::shared_ptr<const CFileItem::DeferredTags> CFileItem::GetDeferredTags() const
+{
+  if (!AtomicLoadAcquire(&m_deferredPending))
+    return boost::shared_ptr<const DeferredTags>();
+  CAtomicSpinLock lock(m_deferredLock);
+  return m_deferredTags;
+}
+
+void CFileItem::SetDeferredTags(const boost::shared_ptr<const DeferredTags> &tags)
+{
+  boost::shared_ptr<const DeferredTags> old(tags);
+  CAtomicSpinLock lock(m_deferredLock);
+  m_deferredTags.swap(old);
+  AtomicStoreRelease(&m_deferredPending, m_deferredTags ? 1 : 0);
+}
+
+void CFileItem::LoadDeferredTags() const
+{
+  // the flag is cleared only once the decoded tags are published, after that
+  // the item is read without locking
+  if (!AtomicLoadAcquire(&m_deferredPending))
+    return;
+
+  // released after the lock, dropping the last reference may unmap the cache
+  boost::shared_ptr<const DeferredTags> archived;
+  CAtomicSpinLock lock(m_deferredLock);
+  if (!m_deferredTags)
+    return;
+
+  CFileItem *item = const_cast<CFileItem *>(this);
+  archived.swap(item->m_deferredTags);
+  const DeferredTags &tags = *archived;
+  CArchive ar(reinterpret_cast<const uint8_t *>(&tags + 1), tags.size);
+  if (tags.types & DeferredMusicTag)
+  {
+    MUSIC_INFO::CMusicInfoTag *tag = new MUSIC_INFO::CMusicInfoTag;
+    ar >> *tag;
+    item->m_musicInfoTag = tag;
+  }
+  if (tags.types & DeferredVideoTag)
+  {
+    CVideoInfoTag *tag = new CVideoInfoTag;
+    ar >> *tag;
+    item->m_videoInfoTag = tag;
+  }
+  if (tags.types & DeferredPictureTag)
+  {
+    CPictureInfoTag *tag = new CPictureInfoTag;
+    ar >> *tag;
+    item->m_pictureInfoTag = tag;
+  }
+
+  AtomicStoreRelease(&m_deferredPending, 0);
+}
+
+bool CFileItem::HasMusicInfoTag() const
+{
+  // checked first, the tag is published before it stops being deferred
+  return HasDeferredTag(DeferredMusicTag) || m_musicInfoTag != NULL;
+}
+
+const MUSIC_INFO::CMusicInfoTag* CFileItem::GetMusicInfoTag() const
+{
+  LoadDeferredTags();
+  return m_musicInfoTag;
+}
+
 MUSIC_INFO::CMusicInfoTag* CFileItem::GetMusicInfoTag()
 {
+  LoadDeferredTags();
   if (!m_musicInfoTag)
     m_musicInfoTag = new MUSIC_INFO::CMusicInfoTag;
 
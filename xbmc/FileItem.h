@@ -224,29 +224,17 @@ public:
   bool SortsOnBottom() const { return m_specialSort == SortSpecialOnBottom; }
   void SetSpecialSort(SortSpecial sort) { m_specialSort = sort; }
 
-  inline bool HasMusicInfoTag() const
-  {
-    return m_musicInfoTag != NULL;
-  }
+  bool HasMusicInfoTag() const;
 
   MUSIC_INFO::CMusicInfoTag* GetMusicInfoTag();
 
-  inline const MUSIC_INFO::CMusicInfoTag* GetMusicInfoTag() const
-  {
-    return m_musicInfoTag;
-  }
+  const MUSIC_INFO::CMusicInfoTag* GetMusicInfoTag() const;
 
-  inline bool HasVideoInfoTag() const
-  {
-    return m_videoInfoTag != NULL;
-  }
+  bool HasVideoInfoTag() const;
 
   CVideoInfoTag* GetVideoInfoTag();
 
-  inline const CVideoInfoTag* GetVideoInfoTag() const
-  {
-    return m_videoInfoTag;
-  }
+  const CVideoInfoTag* GetVideoInfoTag() const;
 
   inline bool HasEPGInfoTag() const
   {
@@ -308,15 +296,9 @@ public:
    */
   double GetCurrentResumeTime() const;
 
-  inline bool HasPictureInfoTag() const
-  {
-    return m_pictureInfoTag != NULL;
-  }
+  bool HasPictureInfoTag() const;
 
-  inline const CPictureInfoTag* GetPictureInfoTag() const
-  {
-    return m_pictureInfoTag;
-  }
+  const CPictureInfoTag* GetPictureInfoTag() const;
 
   CPictureInfoTag* GetPictureInfoTag();
 
@@ -455,6 +437,42 @@ public:
   int m_iBadPwdCount;
 
 private:
+  friend class CFileItemListCache;
+
+  enum DeferredTag
+  {
+    DeferredMusicTag   = 1,
+    DeferredVideoTag   = 2,
+    DeferredPictureTag = 4
+  };
+
+  /*! \brief Header of the info tags of an item restored by CFileItemListCache.
+   The archived tags follow the header in the cache file and are only decoded
+   once one of them is accessed.
+   */
+  struct DeferredTags
+  {
+    uint32_t types; ///< DeferredTag flags of the archived tags
+    uint32_t size;  ///< size of the archived tags following the header
+  };
+
+  /*! \brief Whether a tag is still archived. Only locks the item while it has archived tags. */
+  bool HasDeferredTag(DeferredTag tag) const;
+
+  /*! \brief The archived tags, empty once they were decoded. Safe while another thread decodes them. */
+  boost::shared_ptr<const DeferredTags> GetDeferredTags() const;
+
+  /*! \brief Keep the archived tags, the item must not hold decoded music, video or picture tags. */
+  void SetDeferredTags(const boost::shared_ptr<const DeferredTags> &tags);
+
+  /*! \brief Decode the info tags restored by CFileItemListCache, if any.
+   Const as it is called from the const tag accessors, the item looks the same
+   before and after. Items are decoded by the thumb loaders while the GUI reads
+   them, so this locks the item until the tags are decoded and costs a single
+   atomic read afterwards.
+   */
+  void LoadDeferredTags() const;
+
   CStdString m_strPath;            ///< complete path to item
 
   SortSpecial m_specialSort;
@@ -470,6 +488,9 @@ private:
   PVR::CPVRRecording* m_pvrRecordingInfoTag;
   PVR::CPVRTimerInfoTag * m_pvrTimerInfoTag;
   CPictureInfoTag* m_pictureInfoTag;
+  boost::shared_ptr<const DeferredTags> m_deferredTags; ///< keeps the cache the tags are stored in alive, guarded by m_deferredLock
+  mutable long m_deferredLock;             ///< spin lock guarding m_deferredTags and their decoding
+  mutable volatile long m_deferredPending; ///< non zero while m_deferredTags is set, read without the lock
   bool m_bIsAlbum;
 };
 
@@ -518,6 +539,7 @@ typedef void (*FILEITEMFILLFUNC) (CFileItemPtr &item);
   */
 class CFileItemList : public CFileItem
 {
+  friend class CFileItemListCache;
 public:
   enum CACHE_TYPE { CACHE_NEVER = 0, CACHE_IF_SLOW, CACHE_ALWAYS };
 
@@ -0,0 +1,875 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItemListCache.h"
+#include "FileItem.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "music/tags/MusicInfoTag.h"
+#include "pictures/PictureInfoTag.h"
+#include "threads/SingleLock.h"
+#include "utils/Archive.h"
+#include "utils/log.h"
+#include "utils/Variant.h"
+#include "video/VideoInfoTag.h"
+
+#if defined(TARGET_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+using namespace XFILE;
+
+const unsigned int CFileItemListCache::Version;
+
+namespace
+{
+
+const char CacheMagic[4] = { 'X', 'F', 'I', 'C' };
+const uint32_t CacheByteOrder = 0x01020304;
+
+/* Layout of a cache file, every section starts 8 byte aligned:
+
+   CacheHeader
+   uint32_t string offsets[stringCount + 1]   start of each string in the string data
+   char     string data[]                     string 0 is always the empty string
+   CacheRecord records[itemCount]             the list itself, followed by its items
+   CachePair   pairs[pairCount]               art, art fallbacks and properties of all records
+   uint8_t  blob[blobSize]                    archived info tags, variants and list details
+
+   Numbers are stored in native byte order, the cache never leaves the machine. */
+struct CacheHeader
+{
+  char     magic[4];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t wcharSize;
+  uint32_t itemCount;
+  uint32_t stringCount;
+  uint32_t pairCount;
+  uint32_t reserved;
+  uint64_t fileSize;
+  uint64_t stringIndexOffset;
+  uint64_t stringDataOffset;
+  uint64_t recordOffset;
+  uint64_t pairOffset;
+  uint64_t blobOffset;
+  uint64_t blobSize;
+  uint64_t listDetails;       ///< offset of the archived list details in the blob
+};
+
+enum RecordString
+{
+  StringLabel = 0,
+  StringLabel2,
+  StringSortLabel,            ///< raw wchar_t data
+  StringIcon,
+  StringPath,
+  StringDVDLabel,
+  StringTitle,
+  StringLockCode,
+  StringMimeType,
+  StringExtraInfo,
+  StringCount
+};
+
+enum RecordFlag
+{
+  FlagFolder           = 1 << 0,
+  FlagSelected         = 1 << 1,
+  FlagParentFolder     = 1 << 2,
+  FlagLabelPreformated = 1 << 3,
+  FlagShareOrDrive     = 1 << 4,
+  FlagCanQueue         = 1 << 5,
+  FlagDateValid        = 1 << 6,
+  FlagTags             = 1 << 7
+};
+
+struct CacheRecord
+{
+  uint32_t strings[StringCount];
+  uint32_t flags;
+  int32_t  overlayIcon;
+  int32_t  driveType;
+  int32_t  programCount;
+  int32_t  depth;
+  int32_t  startOffset;
+  int32_t  startPartNumber;
+  int32_t  endOffset;
+  int32_t  lockMode;
+  int32_t  badPwdCount;
+  int32_t  specialSort;
+  uint32_t firstPair;         ///< art pairs, followed by the fallback and property pairs
+  uint32_t artCount;
+  uint32_t fallbackCount;
+  uint32_t propertyCount;
+  uint32_t dateLow;           ///< FILETIME of the item's date
+  uint32_t dateHigh;
+  uint32_t reserved;
+  int64_t  size;
+  uint64_t tags;              ///< offset of the item's archived info tags in the blob
+};
+
+enum PairType
+{
+  PairString = 0,
+  PairNull,
+  PairInteger,
+  PairUnsigned,
+  PairBoolean,
+  PairDouble,
+  PairArchived                ///< any other variant, archived in the blob
+};
+
+struct CachePair
+{
+  uint32_t key;
+  uint32_t type;
+  uint64_t value;             ///< string id, number, bits of a double or blob offset
+};
+
+inline uint64_t Align(uint64_t offset, uint64_t alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+/*! \brief Collects the sections of a cache file while the items are written */
+class CFileItemListCache::CWriter
+{
+public:
+  CWriter() : m_archive(m_blob), m_written(0)
+  {
+    // string 0 is the empty string
+    m_stringOffsets.push_back(0);
+    m_stringOffsets.push_back(0);
+  }
+
+  /*! \brief Add a string which is unlikely to be shared between items, like a path */
+  uint32_t AddUniqueString(const char *data, size_t size)
+  {
+    if (size == 0)
+      return 0;
+
+    uint32_t id = m_stringOffsets.size() - 1;
+    m_stringData.append(data, size);
+    m_stringOffsets.push_back(m_stringData.size());
+    return id;
+  }
+
+  uint32_t AddUniqueString(const std::string &str)
+  {
+    return AddUniqueString(str.c_str(), str.size());
+  }
+
+  uint32_t AddString(const char *data, size_t size)
+  {
+    if (size == 0)
+      return 0;
+
+    std::string str(data, size);
+    std::map<std::string, uint32_t>::const_iterator it = m_strings.find(str);
+    if (it != m_strings.end())
+      return it->second;
+
+    uint32_t id = m_stringOffsets.size() - 1;
+    m_stringData.append(str);
+    m_stringOffsets.push_back(m_stringData.size());
+    m_strings.insert(std::make_pair(str, id));
+    return id;
+  }
+
+  uint32_t AddString(const std::string &str)
+  {
+    return AddString(str.c_str(), str.size());
+  }
+
+  void AddPair(const std::string &key, PairType type, uint64_t value)
+  {
+    CachePair pair;
+    pair.key = AddString(key);
+    pair.type = type;
+    pair.value = value;
+    m_pairs.push_back(pair);
+  }
+
+  void AddProperty(const std::string &key, const CVariant &value)
+  {
+    switch (value.type())
+    {
+    case CVariant::VariantTypeString:
+      AddPair(key, PairString, AddString(value.asString()));
+      break;
+    case CVariant::VariantTypeInteger:
+      AddPair(key, PairInteger, (uint64_t)value.asInteger());
+      break;
+    case CVariant::VariantTypeUnsignedInteger:
+      AddPair(key, PairUnsigned, value.asUnsignedInteger());
+      break;
+    case CVariant::VariantTypeBoolean:
+      AddPair(key, PairBoolean, value.asBoolean() ? 1 : 0);
+      break;
+    case CVariant::VariantTypeDouble:
+    {
+      double number = value.asDouble();
+      uint64_t bits;
+      memcpy(&bits, &number, sizeof(bits));
+      AddPair(key, PairDouble, bits);
+      break;
+    }
+    case CVariant::VariantTypeNull:
+    case CVariant::VariantTypeConstNull:
+      AddPair(key, PairNull, 0);
+      break;
+    default:
+    {
+      uint64_t offset = BeginBlob(0);
+      m_archive << value;
+      EndBlob(offset, 0);
+      AddPair(key, PairArchived, offset);
+      break;
+    }
+    }
+  }
+
+  uint32_t GetPairCount() const { return m_pairs.size(); }
+
+  void AddRecord(const CacheRecord &record)
+  {
+    m_records.push_back(record);
+  }
+
+  /*! \brief Start an entry in the blob, which is archived through GetArchive().
+   \param headerSize space reserved in front of the archived data, see SetBlobHeader
+   \return offset of the entry in the blob
+   */
+  uint64_t BeginBlob(size_t headerSize)
+  {
+    m_archive.Close();
+    m_blob.resize(Align(m_blob.size(), 4));
+    uint64_t offset = m_blob.size();
+    m_blob.resize(offset + headerSize);
+    return offset;
+  }
+
+  /*! \brief Finish an entry in the blob
+   \return the size of the data archived after the header
+   */
+  size_t EndBlob(uint64_t offset, size_t headerSize)
+  {
+    m_archive.Close();
+    return m_blob.size() - offset - headerSize;
+  }
+
+  /*! \brief Append an entry which was archived already */
+  uint64_t AddBlob(const void *data, size_t size)
+  {
+    uint64_t offset = BeginBlob(size);
+    memcpy(&m_blob[offset], data, size);
+    return offset;
+  }
+
+  void SetBlobHeader(uint64_t offset, const void *header, size_t size)
+  {
+    memcpy(&m_blob[offset], header, size);
+  }
+
+  CArchive &GetArchive() { return m_archive; }
+
+  bool Write(const std::string &path, uint64_t listDetails)
+  {
+    m_archive.Close();
+    if (m_stringData.size() > 0xffffffff)
+    {
+      CLog::Log(LOGERROR, "%s - too much text to cache in %s", __FUNCTION__, path.c_str());
+      return false;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CacheMagic, sizeof(header.magic));
+    header.version = Version;
+    header.byteOrder = CacheByteOrder;
+    header.wcharSize = sizeof(wchar_t);
+    header.itemCount = m_records.size();
+    header.stringCount = m_stringOffsets.size() - 1;
+    header.pairCount = m_pairs.size();
+    header.stringIndexOffset = Align(sizeof(header), 8);
+    header.stringDataOffset = Align(header.stringIndexOffset + m_stringOffsets.size() * sizeof(uint32_t), 8);
+    header.recordOffset = Align(header.stringDataOffset + m_stringData.size(), 8);
+    header.pairOffset = Align(header.recordOffset + m_records.size() * sizeof(CacheRecord), 8);
+    header.blobOffset = Align(header.pairOffset + m_pairs.size() * sizeof(CachePair), 8);
+    header.blobSize = m_blob.size();
+    header.fileSize = header.blobOffset + header.blobSize;
+    header.listDetails = listDetails;
+
+    // write next to the cache and swap it in, items may still map the old one
+    std::string tempPath = path + ".tmp";
+    CFile file;
+    if (!file.OpenForWrite(tempPath, true))
+      return false;
+
+    bool ok = WriteSection(file, 0, &header, sizeof(header)) &&
+              WriteSection(file, header.stringIndexOffset, &m_stringOffsets[0], m_stringOffsets.size() * sizeof(uint32_t)) &&
+              WriteSection(file, header.stringDataOffset, m_stringData.c_str(), m_stringData.size()) &&
+              WriteSection(file, header.recordOffset, m_records.empty() ? NULL : &m_records[0], m_records.size() * sizeof(CacheRecord)) &&
+              WriteSection(file, header.pairOffset, m_pairs.empty() ? NULL : &m_pairs[0], m_pairs.size() * sizeof(CachePair)) &&
+              WriteSection(file, header.blobOffset, m_blob.empty() ? NULL : &m_blob[0], m_blob.size());
+    file.Close();
+
+    if (ok && !CFile::Rename(tempPath, path))
+    {
+      // renaming onto an existing file fails on some platforms
+      CFile::Delete(path);
+      ok = CFile::Rename(tempPath, path);
+    }
+    if (!ok)
+    {
+      CLog::Log(LOGERROR, "%s - failed writing %s", __FUNCTION__, path.c_str());
+      CFile::Delete(tempPath);
+    }
+    return ok;
+  }
+
+private:
+  bool WriteSection(CFile &file, uint64_t offset, const void *data, size_t size)
+  {
+    static const char padding[8] = { 0 };
+    if (m_written < offset && file.Write(padding, offset - m_written) != (int)(offset - m_written))
+      return false;
+    if (size > 0 && file.Write(data, size) != (int)size)
+      return false;
+    m_written = offset + size;
+    return true;
+  }
+
+  std::map<std::string, uint32_t> m_strings;
+  std::vector<uint32_t> m_stringOffsets;
+  std::string m_stringData;
+  std::vector<CacheRecord> m_records;
+  std::vector<CachePair> m_pairs;
+  std::vector<uint8_t> m_blob;
+  CArchive m_archive;
+  uint64_t m_written;
+};
+
+/*! \brief A cache file mapped (or read) into memory, shared by the items
+ whose info tags have not been decoded yet.
+ */
+class CFileItemListCache::CReader
+{
+public:
+  CReader() : m_data(NULL), m_size(0), m_mapped(false), m_buffer(NULL), m_header(NULL) {}
+
+  ~CReader()
+  {
+#if defined(TARGET_POSIX)
+    if (m_mapped)
+      munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+    delete[] m_buffer;
+  }
+
+  bool Open(const std::string &path)
+  {
+#if defined(TARGET_POSIX)
+    int fd = open(CSpecialProtocol::TranslatePath(path).c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(CacheHeader))
+    {
+      void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+      {
+        m_data = (const uint8_t *)data;
+        m_size = st.st_size;
+        m_mapped = true;
+      }
+    }
+    close(fd);
+#endif
+
+    if (!m_mapped)
+    {
+      CFile file;
+      if (!file.Open(path))
+        return false;
+      int64_t length = file.GetLength();
+      if (length < (int64_t)sizeof(CacheHeader) || length > 0x7fffffff)
+        return false;
+      // keep the records aligned, just like a mapping is
+      m_buffer = new uint64_t[(length + 7) / 8];
+      if (file.Read(m_buffer, length) != (unsigned int)length)
+        return false;
+      m_data = (const uint8_t *)m_buffer;
+      m_size = length;
+    }
+
+    return Validate(path);
+  }
+
+  const CacheHeader &GetHeader() const { return *m_header; }
+
+  const CacheRecord &GetRecord(unsigned int index) const
+  {
+    return ((const CacheRecord *)(m_data + m_header->recordOffset))[index];
+  }
+
+  const CachePair *GetPairs(uint32_t first, uint32_t count) const
+  {
+    if ((uint64_t)first + count > m_header->pairCount)
+      return NULL;
+    return (const CachePair *)(m_data + m_header->pairOffset) + first;
+  }
+
+  bool GetString(uint32_t id, const char *&data, size_t &size) const
+  {
+    if (id >= m_header->stringCount)
+      return false;
+    const uint32_t *offsets = (const uint32_t *)(m_data + m_header->stringIndexOffset);
+    if (offsets[id] > offsets[id + 1] || m_header->stringDataOffset + offsets[id + 1] > m_size)
+      return false;
+    data = (const char *)m_data + m_header->stringDataOffset + offsets[id];
+    size = offsets[id + 1] - offsets[id];
+    return true;
+  }
+
+  bool GetString(uint32_t id, std::string &str) const
+  {
+    const char *data;
+    size_t size;
+    if (!GetString(id, data, size))
+      return false;
+    str.assign(data, size);
+    return true;
+  }
+
+  bool GetWideString(uint32_t id, std::wstring &str) const
+  {
+    const char *data;
+    size_t size;
+    if (!GetString(id, data, size))
+      return false;
+    str.resize(size / sizeof(wchar_t));
+    if (!str.empty())
+      memcpy(&str[0], data, str.size() * sizeof(wchar_t));
+    return true;
+  }
+
+  /*! \brief Get an entry of the blob
+   \param offset offset of the entry in the blob
+   \param size minimum size of the entry, set to the number of bytes up to the end of the blob
+   \return the entry or NULL if it is out of bounds
+   */
+  const uint8_t *GetBlob(uint64_t offset, size_t &size) const
+  {
+    if (offset % 4 != 0 || offset > m_header->blobSize || m_header->blobSize - offset < size)
+      return NULL;
+    size = m_header->blobSize - offset;
+    return m_data + m_header->blobOffset + offset;
+  }
+
+  bool GetVariant(const CachePair &pair, CVariant &value) const
+  {
+    switch (pair.type)
+    {
+    case PairString:
+    {
+      std::string str;
+      if (!GetString((uint32_t)pair.value, str))
+        return false;
+      value = str;
+      return true;
+    }
+    case PairNull:
+      value = CVariant();
+      return true;
+    case PairInteger:
+      value = (int64_t)pair.value;
+      return true;
+    case PairUnsigned:
+      value = (uint64_t)pair.value;
+      return true;
+    case PairBoolean:
+      value = pair.value != 0;
+      return true;
+    case PairDouble:
+    {
+      double number;
+      memcpy(&number, &pair.value, sizeof(number));
+      value = number;
+      return true;
+    }
+    case PairArchived:
+    {
+      size_t size = 0;
+      const uint8_t *data = GetBlob(pair.value, size);
+      if (!data)
+        return false;
+      CArchive ar(data, size);
+      ar >> value;
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+
+private:
+  bool Validate(const std::string &path)
+  {
+    m_header = (const CacheHeader *)m_data;
+    const CacheHeader &header = *m_header;
+    if (memcmp(header.magic, CacheMagic, sizeof(header.magic)) != 0 ||
+        header.version != Version || header.byteOrder != CacheByteOrder ||
+        header.wcharSize != sizeof(wchar_t))
+    {
+      CLog::Log(LOGDEBUG, "%s - ignoring %s written by another version", __FUNCTION__, path.c_str());
+      return false;
+    }
+
+    if (header.fileSize != m_size || header.itemCount == 0 || header.stringCount == 0 ||
+        header.stringIndexOffset % 8 != 0 || header.recordOffset % 8 != 0 ||
+        header.pairOffset % 8 != 0 || header.blobOffset % 8 != 0 ||
+        header.stringIndexOffset + ((uint64_t)header.stringCount + 1) * sizeof(uint32_t) > m_size ||
+        header.stringDataOffset > m_size ||
+        header.recordOffset + (uint64_t)header.itemCount * sizeof(CacheRecord) > m_size ||
+        header.pairOffset + (uint64_t)header.pairCount * sizeof(CachePair) > m_size ||
+        header.blobOffset + header.blobSize > m_size)
+    {
+      CLog::Log(LOGERROR, "%s - %s is corrupt", __FUNCTION__, path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  const uint8_t *m_data;
+  size_t m_size;
+  bool m_mapped;
+  uint64_t *m_buffer;
+  const CacheHeader *m_header;
+};
+
+void CFileItemListCache::SaveItem(CWriter &writer, CFileItem &item)
+{
+  CacheRecord record;
+  memset(&record, 0, sizeof(record));
+
+  record.strings[StringLabel] = writer.AddUniqueString(item.m_strLabel);
+  record.strings[StringLabel2] = writer.AddString(item.m_strLabel2);
+  record.strings[StringSortLabel] = writer.AddUniqueString((const char *)item.m_sortLabel.c_str(), item.m_sortLabel.size() * sizeof(wchar_t));
+  record.strings[StringIcon] = writer.AddString(item.m_strIcon);
+  record.strings[StringPath] = writer.AddUniqueString(item.m_strPath);
+  record.strings[StringDVDLabel] = writer.AddString(item.m_strDVDLabel);
+  record.strings[StringTitle] = writer.AddUniqueString(item.m_strTitle);
+  record.strings[StringLockCode] = writer.AddString(item.m_strLockCode);
+  record.strings[StringMimeType] = writer.AddString(item.m_mimetype);
+  record.strings[StringExtraInfo] = writer.AddString(item.m_extrainfo);
+
+  if (item.m_bIsFolder)
+    record.flags |= FlagFolder;
+  if (item.m_bSelected)
+    record.flags |= FlagSelected;
+  if (item.m_bIsParentFolder)
+    record.flags |= FlagParentFolder;
+  if (item.m_bLabelPreformated)
+    record.flags |= FlagLabelPreformated;
+  if (item.m_bIsShareOrDrive)
+    record.flags |= FlagShareOrDrive;
+  if (item.m_bCanQueue)
+    record.flags |= FlagCanQueue;
+
+  record.overlayIcon = item.m_overlayIcon;
+  record.driveType = item.m_iDriveType;
+  record.programCount = item.m_iprogramCount;
+  record.depth = item.m_idepth;
+  record.startOffset = item.m_lStartOffset;
+  record.startPartNumber = item.m_lStartPartNumber;
+  record.endOffset = item.m_lEndOffset;
+  record.lockMode = item.m_iLockMode;
+  record.badPwdCount = item.m_iBadPwdCount;
+  record.specialSort = item.m_specialSort;
+  record.size = item.m_dwSize;
+  if (item.m_dateTime.IsValid())
+  {
+    FILETIME time = item.m_dateTime;
+    record.dateLow = time.dwLowDateTime;
+    record.dateHigh = time.dwHighDateTime;
+    record.flags |= FlagDateValid;
+  }
+
+  record.firstPair = writer.GetPairCount();
+  for (CGUIListItem::ArtMap::const_iterator i = item.m_art.begin(); i != item.m_art.end(); ++i)
+    writer.AddPair(i->first, PairString, writer.AddUniqueString(i->second));
+  for (CGUIListItem::ArtMap::const_iterator i = item.m_artFallbacks.begin(); i != item.m_artFallbacks.end(); ++i)
+    writer.AddPair(i->first, PairString, writer.AddString(i->second));
+  for (CGUIListItem::PropertyMap::const_iterator i = item.m_mapProperties.begin(); i != item.m_mapProperties.end(); ++i)
+    writer.AddProperty(i->first, i->second);
+  record.artCount = item.m_art.size();
+  record.fallbackCount = item.m_artFallbacks.size();
+  record.propertyCount = item.m_mapProperties.size();
+
+  // the tags may be decoded by a thumb loader meanwhile, decoded ones don't change anymore
+  boost::shared_ptr<const CFileItem::DeferredTags> deferred = item.GetDeferredTags();
+  if (deferred)
+  {
+    // never decoded since the last load, copy it as it is
+    record.tags = writer.AddBlob(deferred.get(), sizeof(CFileItem::DeferredTags) + deferred->size);
+    record.flags |= FlagTags;
+  }
+  else if (item.m_musicInfoTag || item.m_videoInfoTag || item.m_pictureInfoTag)
+  {
+    CFileItem::DeferredTags tags;
+    tags.types = 0;
+    uint64_t offset = writer.BeginBlob(sizeof(tags));
+    CArchive &ar = writer.GetArchive();
+    if (item.m_musicInfoTag)
+    {
+      tags.types |= CFileItem::DeferredMusicTag;
+      ar << *item.m_musicInfoTag;
+    }
+    if (item.m_videoInfoTag)
+    {
+      tags.types |= CFileItem::DeferredVideoTag;
+      ar << *item.m_videoInfoTag;
+    }
+    if (item.m_pictureInfoTag)
+    {
+      tags.types |= CFileItem::DeferredPictureTag;
+      ar << *item.m_pictureInfoTag;
+    }
+    tags.size = writer.EndBlob(offset, sizeof(tags));
+    writer.SetBlobHeader(offset, &tags, sizeof(tags));
+    record.tags = offset;
+    record.flags |= FlagTags;
+  }
+
+  writer.AddRecord(record);
+}
+
+bool CFileItemListCache::LoadItem(const boost::shared_ptr<CReader> &reader, CFileItem &item, unsigned int index)
+{
+  const CacheRecord &record = reader->GetRecord(index);
+
+  if (!reader->GetString(record.strings[StringLabel], item.m_strLabel) ||
+      !reader->GetString(record.strings[StringLabel2], item.m_strLabel2) ||
+      !reader->GetWideString(record.strings[StringSortLabel], item.m_sortLabel) ||
+      !reader->GetString(record.strings[StringIcon], item.m_strIcon) ||
+      !reader->GetString(record.strings[StringPath], item.m_strPath) ||
+      !reader->GetString(record.strings[StringDVDLabel], item.m_strDVDLabel) ||
+      !reader->GetString(record.strings[StringTitle], item.m_strTitle) ||
+      !reader->GetString(record.strings[StringLockCode], item.m_strLockCode) ||
+      !reader->GetString(record.strings[StringMimeType], item.m_mimetype) ||
+      !reader->GetString(record.strings[StringExtraInfo], item.m_extrainfo))
+    return false;
+
+  item.m_bIsFolder = (record.flags & FlagFolder) != 0;
+  item.m_bSelected = (record.flags & FlagSelected) != 0;
+  item.m_bIsParentFolder = (record.flags & FlagParentFolder) != 0;
+  item.m_bLabelPreformated = (record.flags & FlagLabelPreformated) != 0;
+  item.m_bIsShareOrDrive = (record.flags & FlagShareOrDrive) != 0;
+  item.m_bCanQueue = (record.flags & FlagCanQueue) != 0;
+
+  item.m_overlayIcon = (CGUIListItem::GUIIconOverlay)record.overlayIcon;
+  item.m_iDriveType = record.driveType;
+  item.m_iprogramCount = record.programCount;
+  item.m_idepth = record.depth;
+  item.m_lStartOffset = record.startOffset;
+  item.m_lStartPartNumber = record.startPartNumber;
+  item.m_lEndOffset = record.endOffset;
+  item.m_iLockMode = (LockType)record.lockMode;
+  item.m_iBadPwdCount = record.badPwdCount;
+  item.m_specialSort = (SortSpecial)record.specialSort;
+  item.m_dwSize = record.size;
+  if (record.flags & FlagDateValid)
+  {
+    FILETIME time;
+    time.dwLowDateTime = record.dateLow;
+    time.dwHighDateTime = record.dateHigh;
+    item.m_dateTime = time;
+  }
+  else
+    item.m_dateTime.Reset();
+
+  const CachePair *pairs = reader->GetPairs(record.firstPair, record.artCount + record.fallbackCount + record.propertyCount);
+  if (!pairs)
+    return false;
+  std::string key, value;
+  for (uint32_t i = 0; i < record.artCount; i++, pairs++)
+  {
+    if (!reader->GetString(pairs->key, key) || !reader->GetString((uint32_t)pairs->value, value))
+      return false;
+    item.m_art.insert(std::make_pair(key, value));
+  }
+  for (uint32_t i = 0; i < record.fallbackCount; i++, pairs++)
+  {
+    if (!reader->GetString(pairs->key, key) || !reader->GetString((uint32_t)pairs->value, value))
+      return false;
+    item.m_artFallbacks.insert(std::make_pair(key, value));
+  }
+  for (uint32_t i = 0; i < record.propertyCount; i++, pairs++)
+  {
+    CVariant property;
+    if (!reader->GetString(pairs->key, key) || !reader->GetVariant(*pairs, property))
+      return false;
+    item.SetProperty(key, property);
+  }
+
+  if (record.flags & FlagTags)
+  {
+    size_t size = sizeof(CFileItem::DeferredTags);
+    const uint8_t *data = reader->GetBlob(record.tags, size);
+    if (!data)
+      return false;
+    const CFileItem::DeferredTags *tags = (const CFileItem::DeferredTags *)data;
+    if (tags->size > size - sizeof(CFileItem::DeferredTags))
+      return false;
+    // shares the ownership of the reader, which unmaps the file with the last item
+    item.SetDeferredTags(boost::shared_ptr<const CFileItem::DeferredTags>(reader, tags));
+  }
+
+  item.SetInvalid();
+  return true;
+}
+
+bool CFileItemListCache::Save(CFileItemList &items, const std::string &path)
+{
+  CSingleLock lock(items.m_lock);
+  CWriter writer;
+
+  SaveItem(writer, items);
+  unsigned int i = 0;
+  if (!items.m_items.empty() && items.m_items[0]->IsParentFolder())
+    i = 1;
+  for (; i < items.m_items.size(); ++i)
+    SaveItem(writer, *items.m_items[i]);
+
+  uint64_t listDetails = writer.BeginBlob(0);
+  CArchive &ar = writer.GetArchive();
+  ar << items.m_fastLookup;
+  ar << (int)items.m_sortDescription.sortBy;
+  ar << (int)items.m_sortDescription.sortOrder;
+  ar << (int)items.m_sortDescription.sortAttributes;
+  ar << items.m_sortIgnoreFolders;
+  ar << (int)items.m_cacheToDisc;
+  ar << (int)items.m_sortDetails.size();
+  for (unsigned int j = 0; j < items.m_sortDetails.size(); ++j)
+  {
+    const SORT_METHOD_DETAILS &details = items.m_sortDetails[j];
+    ar << (int)details.m_sortDescription.sortBy;
+    ar << (int)details.m_sortDescription.sortOrder;
+    ar << (int)details.m_sortDescription.sortAttributes;
+    ar << details.m_buttonLabel;
+    ar << details.m_labelMasks.m_strLabelFile;
+    ar << details.m_labelMasks.m_strLabelFolder;
+    ar << details.m_labelMasks.m_strLabel2File;
+    ar << details.m_labelMasks.m_strLabel2Folder;
+  }
+  ar << items.m_content;
+  writer.EndBlob(listDetails, 0);
+
+  return writer.Write(path, listDetails);
+}
+
+bool CFileItemListCache::Load(CFileItemList &items, const std::string &path)
+{
+  boost::shared_ptr<CReader> reader(new CReader);
+  if (!reader->Open(path))
+    return false;
+
+  const CacheHeader &header = reader->GetHeader();
+  size_t size = 0;
+  const uint8_t *listDetails = reader->GetBlob(header.listDetails, size);
+  if (!listDetails)
+    return false;
+
+  CSingleLock lock(items.m_lock);
+  CFileItemPtr parent;
+  if (!items.m_items.empty() && items.m_items[0]->IsParentFolder())
+    parent.reset(new CFileItem(*items.m_items[0]));
+
+  items.SetFastLookup(false);
+  items.Clear();
+
+  if (!LoadItem(reader, items, 0))
+  {
+    CLog::Log(LOGERROR, "%s - %s is corrupt", __FUNCTION__, path.c_str());
+    return false;
+  }
+
+  CArchive ar(listDetails, size);
+  bool fastLookup = false;
+  int tempint;
+  ar >> fastLookup;
+  ar >> tempint;
+  items.m_sortDescription.sortBy = (SortBy)tempint;
+  ar >> tempint;
+  items.m_sortDescription.sortOrder = (SortOrder)tempint;
+  ar >> tempint;
+  items.m_sortDescription.sortAttributes = (SortAttribute)tempint;
+  ar >> items.m_sortIgnoreFolders;
+  ar >> tempint;
+  items.m_cacheToDisc = CFileItemList::CACHE_TYPE(tempint);
+  int detailSize = 0;
+  ar >> detailSize;
+  for (int j = 0; j < detailSize; ++j)
+  {
+    SORT_METHOD_DETAILS details;
+    ar >> tempint;
+    details.m_sortDescription.sortBy = (SortBy)tempint;
+    ar >> tempint;
+    details.m_sortDescription.sortOrder = (SortOrder)tempint;
+    ar >> tempint;
+    details.m_sortDescription.sortAttributes = (SortAttribute)tempint;
+    ar >> details.m_buttonLabel;
+    ar >> details.m_labelMasks.m_strLabelFile;
+    ar >> details.m_labelMasks.m_strLabelFolder;
+    ar >> details.m_labelMasks.m_strLabel2File;
+    ar >> details.m_labelMasks.m_strLabel2Folder;
+    items.m_sortDetails.push_back(details);
+  }
+  ar >> items.m_content;
+
+  items.m_items.reserve(header.itemCount - (parent ? 0 : 1));
+  if (parent)
+    items.m_items.push_back(parent);
+  for (unsigned int i = 1; i < header.itemCount; ++i)
+  {
+    CFileItemPtr item(new CFileItem);
+    if (!LoadItem(reader, *item, i))
+    {
+      CLog::Log(LOGERROR, "%s - %s is corrupt", __FUNCTION__, path.c_str());
+      items.Clear();
+      return false;
+    }
+    items.m_items.push_back(item);
+  }
+
+  items.SetFastLookup(fastLookup);
+  return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include "boost/shared_ptr.hpp"
+
+class CFileItem;
+class CFileItemList;
+
+/*!
+ \brief Binary on-disk cache of a CFileItemList, used by CFileItemList::Load/Save.
+
+ The cache consists of a header, a table of unique strings, one fixed-width
+ record per item, the art and property pairs of all items and a blob section.
+ Loading maps the file into memory (where the platform allows) and builds the
+ items from the records without any per-field parsing. The music, video and
+ picture info tags are kept archived in the blob section and only decoded
+ when an item's tag is accessed, the items share the mapping until then.
+
+ Caches written by a different version of the format are rejected, so the
+ directory is simply fetched again.
+ */
+class CFileItemListCache
+{
+public:
+  /*! \brief Version of the cache format, bump on any change of the layout
+   or of the archived info tags.
+   */
+  static const unsigned int Version = 1;
+
+  /*! \brief Write a list to a cache file.
+   The file is written next to the given path and then renamed over it, so
+   items still referring to a previous mapping of the file stay valid.
+   \param items the list to write, the parent folder item is skipped.
+   \param path the cache file to write.
+   \return true if the cache was written, false otherwise.
+   */
+  static bool Save(CFileItemList &items, const std::string &path);
+
+  /*! \brief Replace the contents of a list with the contents of a cache file.
+   A parent folder item already in the list is kept.
+   \param items the list to fill.
+   \param path the cache file to read.
+   \return true if the cache was read, false if it doesn't exist, is invalid
+   or was written by another version.
+   */
+  static bool Load(CFileItemList &items, const std::string &path);
+
+private:
+  class CWriter;
+  class CReader;
+
+  static void SaveItem(CWriter &writer, CFileItem &item);
+  static bool LoadItem(const boost::shared_ptr<CReader> &reader, CFileItem &item, unsigned int index);
+};
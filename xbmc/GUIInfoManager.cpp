@@ -125,6 +125,11 @@ CGUIInfoManager::CGUIInfoManager(void) :
   m_playerShowInfo = false;
   m_fps = 0.0f;
   m_AVInfoValid = false;
+  m_changedState = 0;
+  m_playerState = 0;
+  m_stateMinute = 0;
+  m_boolEvaluations = 0;
+  m_lastBoolEvaluations = 0;
   ResetLibraryBools();
 }
 
@@ -2203,6 +2208,7 @@ bool CGUIInfoManager::GetBool(int condition1, int contextWindow, const CGUIListI
 {
   bool bReturn = false;
   int condition = abs(condition1);
+  m_boolEvaluations++;
 
   if (condition >= LISTITEM_START && condition < LISTITEM_END)
   {
@@ -5231,6 +5237,168 @@ void CGUIInfoManager::ResetCache()
     (*i)->SetDirty();
 }
 
+void CGUIInfoManager::ResetChangedCache(bool endOfFrame /* = false */)
+{
+  if (endOfFrame)
+  {
+    // reset any animation triggers as well
+    m_containerMoves.clear();
+    m_lastBoolEvaluations = m_boolEvaluations;
+    m_boolEvaluations = 0;
+  }
+
+  // poll the state we track and compare to what it was the last time round
+  unsigned int changed = DEPENDS_ALWAYS;
+
+  int playerState = 0;
+  if (g_application.m_pPlayer->IsPlaying())
+  {
+    playerState = 1;
+    if (g_application.m_pPlayer->IsPlayingAudio())
+      playerState |= 2;
+    if (g_application.m_pPlayer->IsPlayingVideo())
+      playerState |= 4;
+    if (g_application.m_pPlayer->IsPausedPlayback())
+      playerState |= 8;
+    playerState |= g_application.m_pPlayer->GetPlaySpeed() * 16;
+  }
+  if (playerState != m_playerState)
+  {
+    m_playerState = playerState;
+    changed |= DEPENDS_PLAYER;
+  }
+
+  time_t minute = time(NULL) / 60;
+  if (minute != m_stateMinute)
+  {
+    m_stateMinute = minute;
+    changed |= DEPENDS_TIME;
+  }
+
+  vector<CGUIWindow *> windows;
+  g_windowManager.GetActiveWindows(windows);
+  vector<int> windowState;
+  vector<int> focusState;
+  windowState.reserve(4 + 2 * windows.size());
+  focusState.reserve(windows.size());
+  windowState.push_back(g_windowManager.GetActiveWindow());
+  windowState.push_back(g_windowManager.IsOverlayAllowed() ? 1 : 0);
+  windowState.push_back(m_nextWindowID);
+  windowState.push_back(m_prevWindowID);
+  for (vector<CGUIWindow *>::const_iterator i = windows.begin(); i != windows.end(); ++i)
+  {
+    windowState.push_back((*i)->GetID());
+    windowState.push_back((*i)->IsAnimating(ANIM_TYPE_WINDOW_CLOSE) ? 1 : 0);
+    focusState.push_back((*i)->GetFocusedControlID());
+  }
+  if (windowState != m_windowState)
+  {
+    m_windowState.swap(windowState);
+    changed |= DEPENDS_WINDOW;
+  }
+  if (focusState != m_focusState)
+  {
+    m_focusState.swap(focusState);
+    changed |= DEPENDS_FOCUS;
+  }
+
+  CSingleLock lock(m_critInfo);
+  changed |= m_changedState;
+  m_changedState = 0;
+  for (vector<InfoPtr>::iterator i = m_bools.begin(); i != m_bools.end(); ++i)
+    (*i)->SetDirty(changed);
+}
+
+void CGUIInfoManager::MarkChanged(unsigned int dependencies)
+{
+  CSingleLock lock(m_critInfo);
+  m_changedState |= dependencies;
+}
+
+unsigned int CGUIInfoManager::GetDependencies(int condition) const
+{
+  condition = abs(condition);
+  if (condition >= MULTI_INFO_START && condition <= MULTI_INFO_END)
+  {
+    const GUIInfo &info = m_multiInfo[condition - MULTI_INFO_START];
+    switch (abs(info.m_info))
+    {
+      case SKIN_BOOL:
+      case SKIN_STRING:
+        return DEPENDS_SKIN;
+      case WINDOW_IS_VISIBLE:
+      case WINDOW_IS_TOPMOST:
+      case WINDOW_IS_ACTIVE:
+      case WINDOW_NEXT:
+      case WINDOW_PREVIOUS:
+        return DEPENDS_WINDOW;
+      case CONTROL_HAS_FOCUS:
+      case CONTROL_GROUP_HAS_FOCUS:
+        return DEPENDS_WINDOW | DEPENDS_FOCUS;
+      case SYSTEM_DATE:
+      case SYSTEM_TIME:
+        return DEPENDS_TIME;
+      case SYSTEM_HAS_CORE_ID:
+        return DEPENDS_NONE;
+      default:
+        return DEPENDS_ALWAYS;
+    }
+  }
+
+  switch (condition)
+  {
+    case SYSTEM_ALWAYS_TRUE:
+    case SYSTEM_ALWAYS_FALSE:
+    case SYSTEM_ETHERNET_LINK_ACTIVE:
+    case SYSTEM_PLATFORM_LINUX:
+    case SYSTEM_PLATFORM_WINDOWS:
+    case SYSTEM_PLATFORM_DARWIN:
+    case SYSTEM_PLATFORM_DARWIN_OSX:
+    case SYSTEM_PLATFORM_DARWIN_IOS:
+    case SYSTEM_PLATFORM_DARWIN_ATV2:
+    case SYSTEM_PLATFORM_ANDROID:
+    case SYSTEM_PLATFORM_LINUX_RASPBERRY_PI:
+    case SYSTEM_HAS_PVR:
+    case SYSTEM_ISSTANDALONE:
+    case SYSTEM_SHOW_EXIT_BUTTON:
+      return DEPENDS_NONE;
+    case LIBRARY_HAS_MUSIC:
+    case LIBRARY_HAS_VIDEO:
+    case LIBRARY_HAS_MOVIES:
+    case LIBRARY_HAS_MOVIE_SETS:
+    case LIBRARY_HAS_TVSHOWS:
+    case LIBRARY_HAS_MUSICVIDEOS:
+      return DEPENDS_LIBRARY;
+    case WINDOW_IS_MEDIA:
+    case SYSTEM_LOGGEDON:
+      return DEPENDS_WINDOW;
+    case SKIN_HAS_VIDEO_OVERLAY:
+    case SKIN_HAS_MUSIC_OVERLAY:
+    case VIDEOPLAYER_ISFULLSCREEN:
+      return DEPENDS_WINDOW | DEPENDS_PLAYER;
+    case PLAYER_HAS_MEDIA:
+    case PLAYER_HAS_AUDIO:
+    case PLAYER_HAS_VIDEO:
+    case PLAYER_PLAYING:
+    case PLAYER_PAUSED:
+    case PLAYER_REWINDING:
+    case PLAYER_FORWARDING:
+    case PLAYER_REWINDING_2x:
+    case PLAYER_REWINDING_4x:
+    case PLAYER_REWINDING_8x:
+    case PLAYER_REWINDING_16x:
+    case PLAYER_REWINDING_32x:
+    case PLAYER_FORWARDING_2x:
+    case PLAYER_FORWARDING_4x:
+    case PLAYER_FORWARDING_8x:
+    case PLAYER_FORWARDING_16x:
+    case PLAYER_FORWARDING_32x:
+      return DEPENDS_PLAYER;
+    default:
+      return DEPENDS_ALWAYS;
+  }
+}
+
 // Called from tuxbox service thread to update current status
 void CGUIInfoManager::UpdateFromTuxBox()
 {
@@ -5428,6 +5596,7 @@ void CGUIInfoManager::SetLibraryBool(int condition, bool value)
     default:
       break;
   }
+  MarkChanged(DEPENDS_LIBRARY);
 }
 
 void CGUIInfoManager::ResetLibraryBools()
@@ -5437,6 +5606,7 @@ void CGUIInfoManager::ResetLibraryBools()
   m_libraryHasTVShows = -1;
   m_libraryHasMusicVideos = -1;
   m_libraryHasMovieSets = -1;
+  MarkChanged(DEPENDS_LIBRARY);
 }
 
 bool CGUIInfoManager::GetLibraryBool(int condition)
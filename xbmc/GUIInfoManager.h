@@ -810,7 +810,27 @@ public:
   void SetNextWindow(int windowID) { m_nextWindowID = windowID; };
   void SetPreviousWindow(int windowID) { m_prevWindowID = windowID; };
 
+  /*! \brief Mark all info bools dirty, for when state changed that we don't track
+   */
   void ResetCache();
+
+  /*! \brief Mark the info bools dirty that depend on state changed since the last call
+   Cheap enough to be called more than once a frame, e.g. after input processing and after rendering.
+   \param endOfFrame true if a frame was just rendered, resets the container animation triggers and
+                     the count of evaluations as well
+   \sa MarkChanged, GetBoolEvaluations
+   */
+  void ResetChangedCache(bool endOfFrame = false);
+
+  /*! \brief Notify us of a change in state that isn't polled by ResetChangedCache
+   \param dependencies the INFO::InfoDependency flags of the changed state
+   */
+  void MarkChanged(unsigned int dependencies);
+
+  /*! \brief The number of boolean conditions that were evaluated during the last frame
+   */
+  unsigned int GetBoolEvaluations() const { return m_lastBoolEvaluations; };
+
   bool GetItemInt(int &value, const CGUIListItem *item, int info) const;
   CStdString GetItemLabel(const CFileItem *item, int info, CStdString *fallback = NULL);
   CStdString GetItemImage(const CFileItem *item, int info, CStdString *fallback = NULL);
@@ -850,6 +870,12 @@ protected:
   bool GetBool(int condition, int contextWindow = 0, const CGUIListItem *item=NULL);
   int TranslateSingleString(const CStdString &strCondition, bool &listItemDependent);
 
+  /*! \brief Get the state a condition reads
+   \param condition the condition as returned from TranslateSingleString
+   \return the INFO::InfoDependency flags of the condition
+   */
+  unsigned int GetDependencies(int condition) const;
+
   // routines for window retrieval
   bool CheckWindowCondition(CGUIWindow *window, int condition) const;
   CGUIWindow *GetWindowWithCondition(int contextWindow, int condition) const;
@@ -940,6 +966,15 @@ protected:
   int m_prevWindowID;
 
   std::vector<INFO::InfoPtr> m_bools;
+
+  // state the info bools depend on, as of the last ResetChangedCache()
+  unsigned int m_changedState;    ///< changes we've been notified of through MarkChanged()
+  int m_playerState;
+  time_t m_stateMinute;
+  std::vector<int> m_windowState;
+  std::vector<int> m_focusState;
+  unsigned int m_boolEvaluations; ///< conditions evaluated this frame, a statistic only so not locked
+  unsigned int m_lastBoolEvaluations;
   std::vector<INFO::CSkinVariableString> m_skinVariableStrings;
 
   int m_libraryHasMusic;
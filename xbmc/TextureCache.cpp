@@ -41,14 +41,22 @@ CTextureCache &CTextureCache::Get()
 
 CTextureCache::CTextureCache() : CJobQueue(false, 1, CJob::PRIORITY_LOW_PAUSABLE)
 {
+  m_pipeline = NULL;
 }
 
 CTextureCache::~CTextureCache()
 {
+  delete m_pipeline;
 }
 
 void CTextureCache::Initialize()
 {
+  if (!m_pipeline)
+    m_pipeline = new CTextureCachePipeline(this, g_advancedSettings.m_imageCacheReadThreads,
+                                           g_advancedSettings.m_imageCacheDecodeThreads,
+                                           g_advancedSettings.m_imageCacheEncodeThreads,
+                                           g_advancedSettings.m_imageCacheBatchSize);
+
   CSingleLock lock(m_databaseSection);
   if (!m_database.IsOpen())
     m_database.Open();
@@ -57,6 +65,8 @@ void CTextureCache::Initialize()
 void CTextureCache::Deinitialize()
 {
   CancelJobs();
+  if (m_pipeline)
+    m_pipeline->Cancel(); // stores the images that are done
   CSingleLock lock(m_databaseSection);
   m_database.Close();
 }
@@ -130,7 +140,10 @@ void CTextureCache::BackgroundCacheImage(const CStdString &url)
     return; // image is already cached and doesn't need to be checked further
 
   // needs (re)caching
-  AddJob(new CTextureCacheJob(CTextureUtils::UnwrapImageURL(url), details.hash));
+  if (m_pipeline)
+    m_pipeline->Add(CTextureCacheJobPtr(new CTextureCacheJob(CTextureUtils::UnwrapImageURL(url), details.hash)));
+  else
+    AddJob(new CTextureCacheJob(CTextureUtils::UnwrapImageURL(url), details.hash));
 }
 
 bool CTextureCache::CacheImage(const CStdString &image, CTextureDetails &details)
@@ -163,6 +176,8 @@ CStdString CTextureCache::CacheImage(const CStdString &image, CBaseTexture **tex
   // wait for currently processing job to end.
   while (true)
   {
+    if (m_pipeline) // it may be done already, but not stored yet
+      m_pipeline->Flush();
     m_completeEvent.WaitMSec(1000);
     {
       CSingleLock lock(m_processingSection);
@@ -287,6 +302,56 @@ void CTextureCache::OnCachingComplete(bool success, CTextureCacheJob *job)
     AddJob(new CTextureDDSJob(GetCachedPath(job->m_details.file)));
 }
 
+bool CTextureCache::OnImageStarting(const CTextureCacheJobPtr &job)
+{
+  // check whether we need cache the image anyway
+  bool needsRecaching = false;
+  CStdString path(CheckCachedImage(job->m_url, false, needsRecaching));
+  if (!path.empty() && !needsRecaching)
+    return false;
+
+  // check our processing list
+  CSingleLock lock(m_processingSection);
+  return m_processinglist.insert(job->m_url).second;
+}
+
+void CTextureCache::OnImagesCached(const std::vector<CTextureCacheJobPtr> &jobs)
+{
+  { // store all images in one go
+    CSingleLock lock(m_databaseSection);
+    m_database.BeginTransaction();
+    for (std::vector<CTextureCacheJobPtr>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+      const CTextureCacheJob *job = i->get();
+      if (!job->IsDone())
+        continue;
+      if (job->m_oldHash == job->m_details.hash)
+        m_database.SetCachedTextureValid(job->m_url, job->m_details.updateable);
+      else
+        m_database.AddCachedTexture(job->m_url, job->m_details);
+    }
+    m_database.CommitTransaction();
+  }
+
+  { // remove from our processing list
+    CSingleLock lock(m_processingSection);
+    for (std::vector<CTextureCacheJobPtr>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+      m_processinglist.erase((*i)->m_url);
+  }
+
+  m_completeEvent.Set();
+
+  // TODO: call back to the UI indicating that it can update it's image...
+  if (g_advancedSettings.m_useDDSFanart)
+  {
+    for (std::vector<CTextureCacheJobPtr>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+      if ((*i)->IsDone() && !(*i)->m_details.file.empty())
+        AddJob(new CTextureDDSJob(GetCachedPath((*i)->m_details.file)));
+    }
+  }
+}
+
 void CTextureCache::OnJobComplete(unsigned int jobID, bool success, CJob *job)
 {
   if (strcmp(job->GetType(), kJobTypeCacheImage) == 0)
@@ -24,6 +24,7 @@
 #include "utils/StdString.h"
 #include "utils/JobManager.h"
 #include "TextureDatabase.h"
+#include "TextureCachePipeline.h"
 #include "threads/Event.h"
 
 class CURL;
@@ -38,8 +39,11 @@ class CBaseTexture;
  may be periodically checked for updates and may be purged from the cache if
  unused for a set period of time.
 
+ Images are cached in the background by a CTextureCachePipeline, which stores
+ them in the database in batches.
+
  */
-class CTextureCache : public CJobQueue
+class CTextureCache : public CJobQueue, private CTextureCachePipeline::IOwner
 {
 public:
   /*!
@@ -73,8 +77,8 @@ public:
   /*! \brief Cache image (if required) using a background job
 
    Checks firstly whether an image is already cached, and return URL if so [see CheckCacheImage]
-   If the image is not yet in the database, a background job is started to
-   cache the image and add to the database [see CTextureCacheJob]
+   If the image is not yet in the database, it is queued on the texture cache pipeline
+   to cache the image and add to the database [see CTextureCachePipeline]
 
    \param image url of the image to cache
    \sa CacheImage
@@ -220,6 +224,21 @@ private:
    */
   void OnCachingComplete(bool success, CTextureCacheJob *job);
 
+  /*! \brief Called by the pipeline before an image is cached.
+   Checks whether the image was cached since it was queued, or is being cached
+   by someone else, and adds it to our processing list otherwise.
+   \sa CTextureCachePipeline::IOwner
+   */
+  virtual bool OnImageStarting(const CTextureCacheJobPtr &job);
+
+  /*! \brief Called by the pipeline with a batch of images that are done.
+   Updates the database in one transaction, removes the images from our
+   processing list and fires DDS jobs if appropriate.
+   \sa CTextureCachePipeline::IOwner
+   */
+  virtual void OnImagesCached(const std::vector<CTextureCacheJobPtr> &jobs);
+
+  CTextureCachePipeline *m_pipeline; ///< caches images in the background, created on Initialize()
   CCriticalSection m_databaseSection;
   CTextureDatabase m_database;
   std::set<CStdString> m_processinglist; ///< currently processing list to avoid 2 jobs being processed at once
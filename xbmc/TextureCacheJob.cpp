@@ -42,10 +42,15 @@ CTextureCacheJob::CTextureCacheJob(const CStdString &url, const CStdString &oldH
   m_url = url;
   m_oldHash = oldHash;
   m_cachePath = CTextureCache::GetCacheFile(m_url);
+  m_width = m_height = 0;
+  m_embeddedArt = false;
+  m_texture = NULL;
+  m_done = false;
 }
 
 CTextureCacheJob::~CTextureCacheJob()
 {
+  delete m_texture;
 }
 
 bool CTextureCacheJob::operator==(const CJob* job) const
@@ -75,56 +80,127 @@ bool CTextureCacheJob::DoWork()
 }
 
 bool CTextureCacheJob::CacheTexture(CBaseTexture **out_texture)
+{
+  if (!ReadImage())
+    return false;
+
+  if (m_done)
+  {
+#if defined(HAS_OMXPLAYER)
+    if (out_texture && m_details.hash != m_oldHash)
+      *out_texture = LoadImage(CTextureCache::GetCachedPath(m_details.file), m_width, m_height, m_additionalInfo);
+#endif
+    return true;
+  }
+
+  return DecodeImage() && EncodeImage(out_texture);
+}
+
+bool CTextureCacheJob::ReadImage()
 {
   // unwrap the URL as required
-  std::string additional_info;
-  unsigned int width, height;
-  CStdString image = DecodeImageURL(m_url, width, height, additional_info);
+  m_image = DecodeImageURL(m_url, m_width, m_height, m_additionalInfo);
 
-  m_details.updateable = additional_info != "music" && UpdateableURL(image);
+  m_details.updateable = m_additionalInfo != "music" && UpdateableURL(m_image);
 
   // generate the hash
-  m_details.hash = GetImageHash(image);
+  m_details.hash = GetImageHash(m_image);
   if (m_details.hash.empty())
     return false;
   else if (m_details.hash == m_oldHash)
+  {
+    m_done = true;
     return true;
+  }
 
 #if defined(HAS_OMXPLAYER)
-  if (COMXImage::CreateThumb(image, width, height, additional_info, CTextureCache::GetCachedPath(m_cachePath + ".jpg")))
+  if (COMXImage::CreateThumb(m_image, m_width, m_height, m_additionalInfo, CTextureCache::GetCachedPath(m_cachePath + ".jpg")))
   {
-    m_details.width = width;
-    m_details.height = height;
+    m_details.width = m_width;
+    m_details.height = m_height;
     m_details.file = m_cachePath + ".jpg";
-    if (out_texture)
-      *out_texture = LoadImage(CTextureCache::GetCachedPath(m_details.file), width, height, additional_info);
-    CLog::Log(LOGDEBUG, "Fast %s image '%s' to '%s': %p", m_oldHash.empty() ? "Caching" : "Recaching", image.c_str(), m_details.file.c_str(), out_texture);
+    m_done = true;
+    CLog::Log(LOGDEBUG, "Fast %s image '%s' to '%s'", m_oldHash.empty() ? "Caching" : "Recaching", m_image.c_str(), m_details.file.c_str());
     return true;
   }
 #endif
-  CBaseTexture *texture = LoadImage(image, width, height, additional_info, true);
-  if (texture)
+
+  if (m_additionalInfo == "music")
+  { // special case for embedded music images
+    MUSIC_INFO::EmbeddedArt art;
+    if (CMusicThumbLoader::GetEmbeddedThumb(m_image, art))
+    {
+      m_input.allocate(art.size);
+      memcpy(m_input.get(), &art.data[0], art.size);
+      m_mimeType = art.mime;
+      m_embeddedArt = true;
+      return true;
+    }
+  }
+
+  // Validate file URL to see if it is an image
+  CFileItem file(m_image, false);
+  file.FillInMimeType();
+  if (!(file.IsPicture() && !(file.IsZIP() || file.IsRAR() || file.IsCBR() || file.IsCBZ() ))
+      && !StringUtils::StartsWithNoCase(file.GetMimeType(), "image/") && !file.GetMimeType().Equals("application/octet-stream")) // ignore non-pictures
+    return false;
+  m_mimeType = file.GetMimeType();
+
+  // app icons aren't files, the texture loader reads those itself
+  if (URIUtils::IsAndroidApp(m_image))
+    return true;
+
+  XFILE::CFile reader;
+  return reader.LoadFile(m_image, m_input) > 0;
+}
+
+bool CTextureCacheJob::DecodeImage()
+{
+  delete m_texture;
+  if (m_embeddedArt)
+    m_texture = CBaseTexture::LoadFromFileInMemory((unsigned char *)m_input.get(), m_input.size(), m_mimeType, m_width, m_height);
+  else if (m_input.size())
   {
-    if (texture->HasAlpha())
-      m_details.file = m_cachePath + ".png";
-    else
-      m_details.file = m_cachePath + ".jpg";
+    // the image loader decodes at the size the image is cached at where it can (scaled jpeg decoding)
+    m_texture = CBaseTexture::LoadFromFileInMemory((unsigned char *)m_input.get(), m_input.size(), m_mimeType, m_width, m_height,
+                                                   CSettings::Get().GetBool("pictures.useexifrotation"));
+    if (m_texture && m_additionalInfo == "flipped")
+      m_texture->SetOrientation(m_texture->GetOrientation() ^ 1);
+  }
+  else
+    m_texture = LoadImage(m_image, m_width, m_height, m_additionalInfo, true);
 
-    CLog::Log(LOGDEBUG, "%s image '%s' to '%s':", m_oldHash.empty() ? "Caching" : "Recaching", image.c_str(), m_details.file.c_str());
+  m_input.clear();
+  return m_texture != NULL;
+}
 
-    if (CPicture::CacheTexture(texture, width, height, CTextureCache::GetCachedPath(m_details.file)))
+bool CTextureCacheJob::EncodeImage(CBaseTexture **out_texture)
+{
+  if (!m_texture)
+    return false;
+
+  if (m_texture->HasAlpha())
+    m_details.file = m_cachePath + ".png";
+  else
+    m_details.file = m_cachePath + ".jpg";
+
+  CLog::Log(LOGDEBUG, "%s image '%s' to '%s':", m_oldHash.empty() ? "Caching" : "Recaching", m_image.c_str(), m_details.file.c_str());
+
+  if (CPicture::CacheTexture(m_texture, m_width, m_height, CTextureCache::GetCachedPath(m_details.file)))
+  {
+    m_details.width = m_width;
+    m_details.height = m_height;
+    if (out_texture) // caller wants the texture
     {
-      m_details.width = width;
-      m_details.height = height;
-      if (out_texture) // caller wants the texture
-        *out_texture = texture;
-      else
-        delete texture;
-      return true;
+      *out_texture = m_texture;
+      m_texture = NULL;
     }
+    m_done = true;
   }
-  delete texture;
-  return false;
+
+  delete m_texture;
+  m_texture = NULL;
+  return m_done;
 }
 
 CStdString CTextureCacheJob::DecodeImageURL(const CStdString &url, unsigned int &width, unsigned int &height, std::string &additional_info)
@@ -22,6 +22,7 @@
 
 #include "utils/StdString.h"
 #include "utils/Job.h"
+#include "filesystem/File.h"
 
 class CBaseTexture;
 
@@ -68,13 +69,37 @@ public:
   virtual bool operator==(const CJob *job) const;
   virtual bool DoWork();
 
-  /*! \brief retrieve a hash for the given image
-   Combines the size, ctime and mtime of the image file into a "unique" hash
-   \param url location of the image
-   \return a hash string for this image
+  /*! \brief Cache the image, running all stages in turn
+   \param texture [out] the loaded image, if the caller wants it
+   \return true if the image is cached or didn't change, false otherwise
+   \sa ReadImage, DecodeImage, EncodeImage
    */
   bool CacheTexture(CBaseTexture **texture = NULL);
 
+  /*! \brief Hash the image and read its file into memory
+   The first stage of caching. Images that didn't change, or that a faster path cached
+   already, are done after it.
+   \return false if the image can't be cached, true otherwise
+   \sa IsDone
+   */
+  bool ReadImage();
+
+  /*! \brief Decode the image read, at the size it is cached at where the image loader supports it
+   The second stage of caching. Frees the file read.
+   \return false if the image can't be decoded, true otherwise
+   */
+  bool DecodeImage();
+
+  /*! \brief Scale, orientate and encode the decoded image to the cache
+   The last stage of caching.
+   \param texture [out] the decoded image, if the caller wants it
+   \return true if the image is cached, false otherwise
+   */
+  bool EncodeImage(CBaseTexture **texture = NULL);
+
+  /*! \brief Whether the image is cached, or didn't change, and no stages are left */
+  bool IsDone() const { return m_done; };
+
   CStdString m_url;
   CStdString m_oldHash;
   CTextureDetails m_details;
@@ -120,6 +145,17 @@ private:
   static CBaseTexture *LoadImage(const CStdString &image, unsigned int width, unsigned int height, const std::string &additional_info, bool requirePixels = false);
 
   CStdString    m_cachePath;
+
+  // state carried from one stage to the next
+  CStdString          m_image;
+  unsigned int        m_width;
+  unsigned int        m_height;
+  std::string         m_additionalInfo;
+  XFILE::auto_buffer  m_input;
+  std::string         m_mimeType;
+  bool                m_embeddedArt;
+  CBaseTexture       *m_texture;
+  bool                m_done;
 };
 
 /* \brief Job class for creating .dds versions of textures
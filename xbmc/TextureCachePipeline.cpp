@@ -0,0 +1,239 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "TextureCachePipeline.h"
+#include "TextureCacheJob.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/JobManager.h"
+
+#define HAND_OVER_INTERVAL 1000 ///< the longest time in ms images that are done wait to be handed over
+
+/* one stage of one image */
+class CTextureCacheStageJob : public CJob
+{
+public:
+  CTextureCacheStageJob(CTextureCachePipeline *pipeline, CTextureCachePipeline::Stage stage, const CTextureCacheJobPtr &job)
+    : m_pipeline(pipeline), m_stage(stage), m_job(job), m_dropped(false) {}
+
+  virtual const char *GetType() const { return "cacheimagestage"; }
+
+  virtual bool operator==(const CJob *job) const
+  {
+    if (strcmp(job->GetType(), GetType()) == 0)
+    {
+      const CTextureCacheStageJob *stageJob = dynamic_cast<const CTextureCacheStageJob*>(job);
+      if (stageJob && stageJob->m_job == m_job)
+        return true;
+    }
+    return false;
+  }
+
+  virtual bool DoWork()
+  {
+    switch (m_stage)
+    {
+    case CTextureCachePipeline::STAGE_READ:
+      if (!m_pipeline->OnImageStarting(m_job))
+      {
+        m_dropped = true;
+        return false;
+      }
+      return m_job->ReadImage();
+    case CTextureCachePipeline::STAGE_DECODE:
+      return m_job->DecodeImage();
+    default:
+      return m_job->EncodeImage();
+    }
+  }
+
+  CTextureCachePipeline             *m_pipeline;
+  const CTextureCachePipeline::Stage m_stage;
+  CTextureCacheJobPtr                m_job;
+  bool                               m_dropped;
+};
+
+/* the queue of one stage, passing images on to the pipeline once they're through */
+class CTextureCacheStage : public CJobQueue
+{
+public:
+  CTextureCacheStage(CTextureCachePipeline *pipeline, CTextureCachePipeline::Stage stage, unsigned int workers)
+    : CJobQueue(false, std::max(workers, 1U), CJob::PRIORITY_LOW_PAUSABLE),
+      m_pipeline(pipeline), m_stage(stage)
+  {
+  }
+
+  void Add(const CTextureCacheJobPtr &job)
+  {
+    AddJob(new CTextureCacheStageJob(m_pipeline, m_stage, job));
+  }
+
+  virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job)
+  {
+    CTextureCacheStageJob *stageJob = (CTextureCacheStageJob *)job;
+    m_pipeline->OnStageComplete(m_stage, stageJob->m_job, success, stageJob->m_dropped);
+    CJobQueue::OnJobComplete(jobID, success, job);
+  }
+
+private:
+  CTextureCachePipeline             *m_pipeline;
+  const CTextureCachePipeline::Stage m_stage;
+};
+
+CTextureCachePipeline::CTextureCachePipeline(IOwner *owner, unsigned int readers, unsigned int decoders, unsigned int encoders, unsigned int batchSize)
+{
+  m_owner = owner;
+  m_stages[STAGE_READ]   = new CTextureCacheStage(this, STAGE_READ, readers);
+  m_stages[STAGE_DECODE] = new CTextureCacheStage(this, STAGE_DECODE, decoders);
+  m_stages[STAGE_ENCODE] = new CTextureCacheStage(this, STAGE_ENCODE, encoders);
+  // enough to keep every worker busy while the next stage catches up
+  m_maxInProgress = 2 * (std::max(readers, 1U) + std::max(decoders, 1U) + std::max(encoders, 1U));
+  m_batchSize = std::max(batchSize, 1U);
+  m_lastHandOver = XbmcThreads::SystemClockMillis();
+}
+
+CTextureCachePipeline::~CTextureCachePipeline()
+{
+  Cancel();
+  for (int stage = 0; stage < STAGE_COUNT; stage++)
+    delete m_stages[stage];
+}
+
+bool CTextureCachePipeline::Add(const CTextureCacheJobPtr &job)
+{
+  {
+    CSingleLock lock(m_section);
+    if (!m_queued.insert(job->m_url).second)
+      return false;
+    m_waiting.push_back(job);
+  }
+  StartWaiting();
+  return true;
+}
+
+void CTextureCachePipeline::StartWaiting()
+{
+  std::vector<CTextureCacheJobPtr> jobs;
+  {
+    CSingleLock lock(m_section);
+    while (!m_waiting.empty() && m_inProgress.size() < m_maxInProgress)
+    {
+      jobs.push_back(m_waiting.front());
+      m_waiting.pop_front();
+      m_inProgress.insert(jobs.back());
+    }
+  }
+
+  for (std::vector<CTextureCacheJobPtr>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+    m_stages[STAGE_READ]->Add(*i);
+}
+
+bool CTextureCachePipeline::OnImageStarting(const CTextureCacheJobPtr &job)
+{
+  // Cancel() waits for this, so an image the owner accepts is either handed back by it or by us
+  CSingleLock startLock(m_startSection);
+  {
+    CSingleLock lock(m_section);
+    if (m_inProgress.find(job) == m_inProgress.end())
+      return false;
+  }
+
+  if (!m_owner->OnImageStarting(job))
+    return false;
+
+  CSingleLock lock(m_section);
+  m_started.insert(job);
+  return true;
+}
+
+void CTextureCachePipeline::OnStageComplete(Stage stage, const CTextureCacheJobPtr &job, bool success, bool dropped)
+{
+  bool handOver;
+  {
+    CSingleLock lock(m_section);
+    // cancelled, it was handed back already
+    if (m_inProgress.find(job) == m_inProgress.end())
+      return;
+
+    if (success && !job->IsDone() && stage + 1 < STAGE_COUNT)
+    {
+      lock.Leave();
+      m_stages[stage + 1]->Add(job);
+      return;
+    }
+
+    m_inProgress.erase(job);
+    m_started.erase(job);
+    m_queued.erase(job->m_url);
+    if (!dropped)
+      m_done.push_back(job);
+    handOver = !m_done.empty() && (m_done.size() >= m_batchSize ||
+               (m_inProgress.empty() && m_waiting.empty()) ||
+               XbmcThreads::SystemClockMillis() - m_lastHandOver >= HAND_OVER_INTERVAL);
+  }
+
+  StartWaiting();
+  if (handOver)
+    Flush();
+}
+
+void CTextureCachePipeline::Flush()
+{
+  CSingleLock ownerLock(m_ownerSection);
+  std::vector<CTextureCacheJobPtr> done;
+  {
+    CSingleLock lock(m_section);
+    done.swap(m_done);
+    m_lastHandOver = XbmcThreads::SystemClockMillis();
+  }
+
+  if (!done.empty())
+    m_owner->OnImagesCached(done);
+}
+
+void CTextureCachePipeline::Cancel()
+{
+  {
+    CSingleLock startLock(m_startSection);
+    CSingleLock lock(m_section);
+    // the owner still holds on to the images it accepted, hand them back as failed.
+    // A worker may still be busy with them, so the owner gets copies that aren't done.
+    for (std::set<CTextureCacheJobPtr>::const_iterator i = m_started.begin(); i != m_started.end(); ++i)
+      m_done.push_back(CTextureCacheJobPtr(new CTextureCacheJob((*i)->m_url, (*i)->m_oldHash)));
+    m_started.clear();
+    m_waiting.clear();
+    m_queued.clear();
+    m_inProgress.clear();
+  }
+
+  for (int stage = 0; stage < STAGE_COUNT; stage++)
+    m_stages[stage]->CancelJobs();
+
+  Flush();
+}
+
+bool CTextureCachePipeline::IsIdle() const
+{
+  CSingleLock lock(m_section);
+  return m_waiting.empty() && m_inProgress.empty();
+}
@@ -0,0 +1,152 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "threads/CriticalSection.h"
+
+class CTextureCacheJob;
+class CTextureCacheStage;
+
+typedef boost::shared_ptr<CTextureCacheJob> CTextureCacheJobPtr;
+
+/*!
+ \ingroup textures
+ \brief Caches images in stages that run side by side
+
+ Every image is read (hashed and loaded into memory), decoded and encoded to
+ the cache on a job queue of its own stage, so reading one image overlaps
+ decoding and encoding others, each stage with as many workers as it is given.
+ Only a few images per worker are between reading and encoding at once, the
+ others wait their turn, so a long list of images doesn't pile up in memory.
+
+ Images that are done are handed to the owner in batches, so it can store them
+ in a single database transaction. A batch is handed over when it is full,
+ when nothing is left to do or after a second.
+ */
+class CTextureCachePipeline
+{
+public:
+  /*! \brief The stages an image goes through, in order */
+  enum Stage
+  {
+    STAGE_READ = 0,
+    STAGE_DECODE,
+    STAGE_ENCODE,
+    STAGE_COUNT
+  };
+
+  /*! \brief The owner of a pipeline, told about the images that are done
+   */
+  class IOwner
+  {
+  public:
+    virtual ~IOwner() {};
+
+    /*! \brief Called before an image is read
+     Called from a worker of the pipeline.
+     \param job the image
+     \return true to cache the image, false to drop it (when it's cached or being cached already)
+     */
+    virtual bool OnImageStarting(const CTextureCacheJobPtr &job) = 0;
+
+    /*! \brief Called with a batch of images that are done
+     Called from a worker of the pipeline, or from whoever calls Flush(), but never twice at once.
+     \param jobs the images, in no particular order. Failed ones are included, IsDone() tells them apart.
+     */
+    virtual void OnImagesCached(const std::vector<CTextureCacheJobPtr> &jobs) = 0;
+  };
+
+  /*! \brief Create a pipeline
+   \param owner the owner to hand images to once they are done
+   \param readers the number of images read at once
+   \param decoders the number of images decoded at once
+   \param encoders the number of images encoded at once
+   \param batchSize the number of images handed to the owner at once
+   */
+  CTextureCachePipeline(IOwner *owner, unsigned int readers = 2, unsigned int decoders = 2, unsigned int encoders = 2, unsigned int batchSize = 50);
+  ~CTextureCachePipeline();
+
+  /*! \brief Queue an image to be cached, unless it is queued or in progress already
+   \param job the image to cache
+   \return true if the image was queued, false otherwise
+   */
+  bool Add(const CTextureCacheJobPtr &job);
+
+  /*! \brief Hand the images that are done to the owner without waiting for the batch to fill up
+   */
+  void Flush();
+
+  /*! \brief Drop the images that are waiting and cancel the ones in progress
+   Images that are done are still handed to the owner, and so are the ones it
+   accepted in OnImageStarting() that aren't done yet, as failed, before this returns.
+   */
+  void Cancel();
+
+  /*! \brief Whether no images are waiting or in progress. Some may be done without being handed over.
+   */
+  bool IsIdle() const;
+
+private:
+  friend class CTextureCacheStage;
+  friend class CTextureCacheStageJob;
+
+  // no copies
+  CTextureCachePipeline(const CTextureCachePipeline&);
+  CTextureCachePipeline const& operator=(CTextureCachePipeline const&);
+
+  /*! \brief Called by a stage when an image passed it
+   \param stage the stage
+   \param job the image
+   \param success whether the stage succeeded
+   \param dropped whether the owner dropped the image before it was read
+   */
+  void OnStageComplete(Stage stage, const CTextureCacheJobPtr &job, bool success, bool dropped);
+
+  /*! \brief Start reading the images waiting, as far as the number in progress allows
+   */
+  void StartWaiting();
+
+  /*! \brief Called by the read stage before an image is read, asks the owner whether to cache it
+   \param job the image
+   \return true to cache the image, false if the owner dropped it or it was cancelled
+   */
+  bool OnImageStarting(const CTextureCacheJobPtr &job);
+
+  IOwner                           *m_owner;
+  CTextureCacheStage               *m_stages[STAGE_COUNT];
+  unsigned int                      m_maxInProgress; ///< the number of images between reading and encoding at once
+  unsigned int                      m_batchSize;
+
+  CCriticalSection                  m_section;
+  std::deque<CTextureCacheJobPtr>   m_waiting;      ///< images that weren't read yet
+  std::set<std::string>             m_queued;       ///< urls of the images waiting or in progress
+  std::set<CTextureCacheJobPtr>     m_inProgress;   ///< images being read, decoded or encoded
+  std::set<CTextureCacheJobPtr>     m_started;      ///< images in progress the owner accepted
+  CCriticalSection                  m_startSection; ///< held while the owner is asked about an image
+  std::vector<CTextureCacheJobPtr>  m_done;         ///< images done but not handed over yet
+  unsigned int                      m_lastHandOver; ///< the time images were last handed over
+  CCriticalSection                  m_ownerSection; ///< held while handing images over
+};
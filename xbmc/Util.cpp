@@ -243,7 +243,7 @@ void CUtil::CleanString(const CStdString& strFileName, CStdString& strTitle, CSt
   CRegExp reTags(true, CRegExp::autoUtf8);
   CRegExp reYear(false, CRegExp::autoUtf8);
 
-  if (!reYear.RegComp(g_advancedSettings.m_videoCleanDateTimeRegExp))
+  if (!reYear.RegComp(g_advancedSettings.m_videoCleanDateTimeRegExp, CRegExp::StudyWithJitComp))
   {
     CLog::Log(LOGERROR, "%s: Invalid datetime clean RegExp:'%s'", __FUNCTION__, g_advancedSettings.m_videoCleanDateTimeRegExp.c_str());
   }
@@ -260,7 +260,7 @@ void CUtil::CleanString(const CStdString& strFileName, CStdString& strTitle, CSt
 
   for (unsigned int i = 0; i < regexps.size(); i++)
   {
-    if (!reTags.RegComp(regexps[i].c_str()))
+    if (!reTags.RegComp(regexps[i].c_str(), CRegExp::StudyWithJitComp))
     { // invalid regexp - complain in logs
       CLog::Log(LOGERROR, "%s: Invalid string clean RegExp:'%s'", __FUNCTION__, regexps[i].c_str());
       continue;
@@ -520,7 +520,7 @@ bool CUtil::ExcludeFileOrFolder(const CStdString& strFileOrFolder, const CStdStr
 
   for (unsigned int i = 0; i < regexps.size(); i++)
   {
-    if (!regExExcludes.RegComp(regexps[i].c_str()))
+    if (!regExExcludes.RegComp(regexps[i].c_str(), CRegExp::StudyWithJitComp))
     { // invalid regexp - complain in logs
       CLog::Log(LOGERROR, "%s: Invalid exclude RegExp:'%s'", __FUNCTION__, regexps[i].c_str());
       continue;
@@ -188,6 +188,10 @@ void CSkinInfo::LoadIncludes()
   CLog::Log(LOGINFO, "Loading skin includes from %s", includesPath.c_str());
   m_includes.ClearIncludes();
   m_includes.LoadIncludes(includesPath);
+
+  // windows resolved with the includes loaded before are stale
+  m_windowCache.Clear();
+  m_windowCache.SetFolder(URIUtils::AddFileToFolder("special://temp/skincache/", ID()));
 }
 
 void CSkinInfo::ResolveIncludes(TiXmlElement *node, std::map<INFO::InfoPtr, bool>* xmlIncludeConditions /* = NULL */)
@@ -198,6 +202,11 @@ void CSkinInfo::ResolveIncludes(TiXmlElement *node, std::map<INFO::InfoPtr, bool
   m_includes.ResolveIncludes(node, xmlIncludeConditions);
 }
 
+TiXmlElementPtr CSkinInfo::LoadWindow(const CStdString &file, std::map<INFO::InfoPtr, bool> &xmlIncludeConditions)
+{
+  return m_windowCache.GetWindow(file, m_includes, xmlIncludeConditions);
+}
+
 int CSkinInfo::GetStartWindow() const
 {
   int windowID = CSettings::Get().GetInt("lookandfeel.startupwindow");
@@ -25,6 +25,7 @@
 #include "Addon.h"
 #include "guilib/GraphicContext.h" // needed for the RESOLUTION members
 #include "guilib/GUIIncludes.h"    // needed for the GUIInclude member
+#include "guilib/GUIWindowCache.h" // needed for the window cache member
 #define CREDIT_LINE_LENGTH 50
 
 class TiXmlNode;
@@ -97,6 +98,14 @@ public:
 
   void ResolveIncludes(TiXmlElement *node, std::map<INFO::InfoPtr, bool>* xmlIncludeConditions = NULL);
 
+  /*! \brief Get a window file of the skin with its includes resolved
+   \param file path of the window file
+   \param xmlIncludeConditions [out] the conditions the includes depended on, and their values
+   \return the window, or an empty pointer if the file couldn't be loaded. It's shared, so mustn't be changed.
+   \sa CGUIWindowCache
+   */
+  TiXmlElementPtr LoadWindow(const CStdString &file, std::map<INFO::InfoPtr, bool> &xmlIncludeConditions);
+
   float GetEffectsSlowdown() const { return m_effectsSlowDown; };
 
   const std::vector<CStartupWindow> &GetStartupWindows() const { return m_startupWindows; };
@@ -143,6 +152,7 @@ protected:
 
   float m_effectsSlowDown;
   CGUIIncludes m_includes;
+  CGUIWindowCache m_windowCache;
   CStdString m_currentAspect;
 
   std::vector<CStartupWindow> m_startupWindows;
@@ -24,6 +24,7 @@ using namespace ActiveAE;
 #include "ActiveAESound.h"
 #include "ActiveAEStream.h"
 #include "cores/AudioEngine/Utils/AEUtil.h"
+#include "cores/AudioEngine/Utils/AEKernels.h"
 #include "cores/AudioEngine/Encoders/AEEncoderFFmpeg.h"
 
 #include "settings/Settings.h"
@@ -1717,147 +1718,15 @@ bool CActiveAE::RunStages()
           {
             out = (*it)->m_resampleBuffers->m_outputSamples.front();
             (*it)->m_resampleBuffers->m_outputSamples.pop_front();
-
-            int nb_floats = out->pkt->nb_samples * out->pkt->config.channels / out->pkt->planes;
-            int nb_loops = 1;
-            float fadingStep = 0.0f;
-
-            // fading
-            if ((*it)->m_fadingSamples == -1)
-            {
-              (*it)->m_fadingSamples = m_internalFormat.m_sampleRate * (float)(*it)->m_fadingTime / 1000.0f;
-              (*it)->m_volume = (*it)->m_fadingBase;
-            }
-            if ((*it)->m_fadingSamples > 0)
-            {
-              nb_floats = out->pkt->config.channels / out->pkt->planes;
-              nb_loops = out->pkt->nb_samples;
-              float delta = (*it)->m_fadingTarget - (*it)->m_fadingBase;
-              int samples = m_internalFormat.m_sampleRate * (float)(*it)->m_fadingTime / 1000.0f;
-              fadingStep = delta / samples;
-            }
-
-            // for stream amplification, 
-            // turned off downmix normalization,
-            // or if sink format is float (in order to prevent from clipping)
-            // we need to run on a per sample basis
-            if ((*it)->m_amplify != 1.0 || !(*it)->m_resampleBuffers->m_normalize || (m_sinkFormat.m_dataFormat == AE_FMT_FLOAT))
-            {
-              nb_floats = out->pkt->config.channels / out->pkt->planes;
-              nb_loops = out->pkt->nb_samples;
-            }
-
-            for(int i=0; i<nb_loops; i++)
-            {
-              if ((*it)->m_fadingSamples > 0)
-              {
-                (*it)->m_volume += fadingStep;
-                (*it)->m_fadingSamples--;
-
-                if ((*it)->m_fadingSamples == 0)
-                {
-                  // set variables being polled via stream interface
-                  CSingleLock lock((*it)->m_streamLock);
-                  (*it)->m_streamFading = false;
-                }
-              }
-
-              // volume for stream
-              float volume = (*it)->m_volume * (*it)->m_rgain;
-              if(nb_loops > 1)
-                volume *= (*it)->m_limiter.Run((float**)out->pkt->data, out->pkt->config.channels, i*nb_floats, out->pkt->planes > 1);
-
-              for(int j=0; j<out->pkt->planes; j++)
-              {
-#ifdef __SSE__
-                CAEUtil::SSEMulArray((float*)out->pkt->data[j]+i*nb_floats, volume, nb_floats);
-#else
-                float* fbuffer = (float*) out->pkt->data[j]+i*nb_floats;
-                for (int k = 0; k < nb_floats; ++k)
-                {
-                  fbuffer[k] *= volume;
-                }
-#endif
-              }
-            }
+            ApplyStreamVolume(*it, *(out->pkt), NULL);
           }
           else
           {
             CSampleBuffer *mix = NULL;
             mix = (*it)->m_resampleBuffers->m_outputSamples.front();
             (*it)->m_resampleBuffers->m_outputSamples.pop_front();
-
-            int nb_floats = mix->pkt->nb_samples * mix->pkt->config.channels / mix->pkt->planes;
-            int nb_loops = 1;
-            float fadingStep = 0.0f;
-
-            // fading
-            if ((*it)->m_fadingSamples == -1)
-            {
-              (*it)->m_fadingSamples = m_internalFormat.m_sampleRate * (float)(*it)->m_fadingTime / 1000.0f;
-              (*it)->m_volume = (*it)->m_fadingBase;
-            }
-            if ((*it)->m_fadingSamples > 0)
-            {
-              nb_floats = mix->pkt->config.channels / mix->pkt->planes;
-              nb_loops = mix->pkt->nb_samples;
-              float delta = (*it)->m_fadingTarget - (*it)->m_fadingBase;
-              int samples = m_internalFormat.m_sampleRate * (float)(*it)->m_fadingTime / 1000.0f;
-              fadingStep = delta / samples;
-            }
-
-            // for streams amplification of turned off downmix normalization
-            // we need to run on a per sample basis
-            if ((*it)->m_amplify != 1.0 || !(*it)->m_resampleBuffers->m_normalize)
-            {
-              nb_floats = out->pkt->config.channels / out->pkt->planes;
-              nb_loops = out->pkt->nb_samples;
-            }
-
-            for(int i=0; i<nb_loops; i++)
-            {
-              if ((*it)->m_fadingSamples > 0)
-              {
-                (*it)->m_volume += fadingStep;
-                (*it)->m_fadingSamples--;
-
-                if ((*it)->m_fadingSamples == 0)
-                {
-                  // set variables being polled via stream interface
-                  CSingleLock lock((*it)->m_streamLock);
-                  (*it)->m_streamFading = false;
-                }
-              }
-
-              // volume for stream
-              float volume = (*it)->m_volume * (*it)->m_rgain;
-              if(nb_loops > 1)
-                volume *= (*it)->m_limiter.Run((float**)mix->pkt->data, mix->pkt->config.channels, i*nb_floats, mix->pkt->planes > 1);
-
-              for(int j=0; j<out->pkt->planes && j<mix->pkt->planes; j++)
-              {
-                float *dst = (float*)out->pkt->data[j]+i*nb_floats;
-                float *src = (float*)mix->pkt->data[j]+i*nb_floats;
-#ifdef __SSE__
-                CAEUtil::SSEMulAddArray(dst, src, volume, nb_floats);
-                for (int k = 0; k < nb_floats; ++k)
-                {
-                  if (fabs(dst[k]) > 1.0f)
-                  {
-                    needClamp = true;
-                    break;
-                  }
-                }
-#else
-                for (int k = 0; k < nb_floats; ++k)
-                {
-                  dst[k] += src[k] * volume;
-                  if (fabs(dst[k]) > 1.0f)
-                    needClamp = true;
-                }
-#endif
-              }
-            }
+            if (ApplyStreamVolume(*it, *(out->pkt), mix->pkt) > 1.0f)
+              needClamp = true;
             mix->Return();
           }
           busy = true;
@@ -1870,7 +1739,7 @@ bool CActiveAE::RunStages()
         int nb_floats = out->pkt->nb_samples * out->pkt->config.channels / out->pkt->planes;
         for(int i=0; i<out->pkt->planes; i++)
         {
-          CAEUtil::ClampArray((float*)out->pkt->data[i], nb_floats);
+          CAEKernels::SoftClip((float*)out->pkt->data[i], nb_floats);
         }
       }
 
@@ -2007,6 +1876,78 @@ bool CActiveAE::HasWork()
   return false;
 }
 
+float CActiveAE::ApplyStreamVolume(CActiveAEStream *stream, CSoundPacket &dstSample, CSoundPacket *mixSample)
+{
+  CSoundPacket &srcSample = mixSample ? *mixSample : dstSample;
+  int frames = srcSample.nb_samples;
+  int channels = srcSample.config.channels / srcSample.planes;
+  float fadingStep = 0.0f;
+
+  // fading
+  if (stream->m_fadingSamples == -1)
+  {
+    stream->m_fadingSamples = m_internalFormat.m_sampleRate * (float)stream->m_fadingTime / 1000.0f;
+    stream->m_volume = stream->m_fadingBase;
+  }
+  if (stream->m_fadingSamples > 0)
+  {
+    float delta = stream->m_fadingTarget - stream->m_fadingBase;
+    int samples = m_internalFormat.m_sampleRate * (float)stream->m_fadingTime / 1000.0f;
+    fadingStep = delta / samples;
+  }
+
+  // for fading, stream amplification, turned off downmix normalization,
+  // or if sink format is float (in order to prevent the first stream from clipping)
+  // we need to run on a per sample basis
+  float peak = 0.0f;
+  if (stream->m_fadingSamples <= 0 && stream->m_amplify == 1.0 && stream->m_resampleBuffers->m_normalize &&
+      (mixSample || m_sinkFormat.m_dataFormat != AE_FMT_FLOAT))
+  {
+    float volume = stream->m_volume * stream->m_rgain;
+    for(int j=0; j<dstSample.planes && j<srcSample.planes; j++)
+    {
+      if (mixSample)
+        peak = std::max(peak, CAEKernels::MixAdd((float*)dstSample.data[j], (float*)srcSample.data[j], volume, frames * channels));
+      else
+        CAEKernels::Mul((float*)dstSample.data[j], volume, frames * channels);
+    }
+    return peak;
+  }
+
+  // the limiter only looks at the frame it runs on, so the gain ramp
+  // for all frames can be worked out before samples are touched
+  if (m_streamGains.size() < (size_t)frames)
+    m_streamGains.resize(frames);
+  for(int i=0; i<frames; i++)
+  {
+    if (stream->m_fadingSamples > 0)
+    {
+      stream->m_volume += fadingStep;
+      stream->m_fadingSamples--;
+
+      if (stream->m_fadingSamples == 0)
+      {
+        // set variables being polled via stream interface
+        CSingleLock lock(stream->m_streamLock);
+        stream->m_streamFading = false;
+      }
+    }
+
+    // volume for stream
+    m_streamGains[i] = stream->m_volume * stream->m_rgain *
+                       stream->m_limiter.Run((float**)srcSample.data, srcSample.config.channels, i*channels, srcSample.planes > 1);
+  }
+
+  for(int j=0; j<dstSample.planes && j<srcSample.planes; j++)
+  {
+    if (mixSample)
+      peak = std::max(peak, CAEKernels::MixAddFrames((float*)dstSample.data[j], (float*)srcSample.data[j], &m_streamGains[0], frames, channels));
+    else
+      CAEKernels::MulFrames((float*)dstSample.data[j], &m_streamGains[0], frames, channels);
+  }
+  return peak;
+}
+
 void CActiveAE::MixSounds(CSoundPacket &dstSample)
 {
   if (m_sounds_playing.empty())
@@ -2035,12 +1976,7 @@ void CActiveAE::MixSounds(CSoundPacket &dstSample)
       out = (float*)dstSample.data[j];
       sample_buffer = (float*)(it->sound->GetSound(false)->data[j]+start);
       int nb_floats = mix_samples * dstSample.config.channels / dstSample.planes;
-#ifdef __SSE__
-      CAEUtil::SSEMulAddArray(out, sample_buffer, volume, nb_floats);
-#else
-      for (int k = 0; k < nb_floats; ++k)
-        *out++ += *sample_buffer++ * volume;
-#endif
+      CAEKernels::MixAdd(out, sample_buffer, volume, nb_floats);
     }
 
     it->samples_played += mix_samples;
@@ -2066,13 +2002,7 @@ void CActiveAE::Deamplify(CSoundPacket &dstSample)
     for(int j=0; j<dstSample.planes; j++)
     {
       buffer = (float*)dstSample.data[j];
-#ifdef __SSE__
-      CAEUtil::SSEMulArray(buffer, volume, nb_floats);
-#else
-      float *fbuffer = buffer;
-      for (int i = 0; i < nb_floats; i++)
-        *fbuffer++ *= volume;
-#endif
+      CAEKernels::Mul(buffer, volume, nb_floats);
     }
   }
 }
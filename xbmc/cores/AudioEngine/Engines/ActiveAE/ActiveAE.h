@@ -281,6 +281,7 @@ protected:
 
   void ResampleSounds();
   bool ResampleSound(CActiveAESound *sound);
+  float ApplyStreamVolume(CActiveAEStream *stream, CSoundPacket &dstSample, CSoundPacket *mixSample);
   void MixSounds(CSoundPacket &dstSample);
   void Deamplify(CSoundPacket &dstSample);
 
@@ -342,6 +343,7 @@ protected:
   float m_volumeScaled; // multiplier to scale samples in order to achieve the volume specified in m_volume
   bool m_muted;
   bool m_sinkHasVolume;
+  std::vector<float> m_streamGains; // per frame gains of the stream being mixed
 
   // viz
   IAudioCallback *m_audioCallback;
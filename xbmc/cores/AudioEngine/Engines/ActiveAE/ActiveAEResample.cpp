@@ -19,6 +19,7 @@
  */
 
 #include "ActiveAEResample.h"
+#include "cores/AudioEngine/Utils/AEKernels.h"
 #include "utils/log.h"
 
 extern "C" {
@@ -33,6 +34,7 @@ CActiveAEResample::CActiveAEResample()
 {
   m_pContext = NULL;
   m_loaded = true;
+  m_directConvert = false;
 }
 
 CActiveAEResample::~CActiveAEResample()
@@ -175,11 +177,44 @@ bool CActiveAEResample::Init(uint64_t dst_chan_layout, int dst_channels, int dst
     CLog::Log(LOGERROR, "CActiveAEResample::Init - init resampler failed");
     return false;
   }
+
+  // plain format conversions, e.g. the sink stage, are done in one pass by our
+  // kernels. swr would unpack the samples, run them through the matrix and pack them again
+  m_directConvert = m_dst_rate == m_src_rate && m_dst_channels == m_src_channels &&
+                    (m_src_fmt == AV_SAMPLE_FMT_FLT || m_src_fmt == AV_SAMPLE_FMT_FLTP);
+  if (m_directConvert)
+  {
+    bool planar = av_sample_fmt_is_planar(m_dst_fmt) != 0;
+    if (m_dst_fmt == AV_SAMPLE_FMT_FLT || m_dst_fmt == AV_SAMPLE_FMT_FLTP)
+      m_directConvert = planar != (av_sample_fmt_is_planar(m_src_fmt) != 0);
+    else
+      m_directConvert = planar == (av_sample_fmt_is_planar(m_src_fmt) != 0) &&
+                        (m_dst_fmt == AV_SAMPLE_FMT_S16 || m_dst_fmt == AV_SAMPLE_FMT_S16P ||
+                         m_dst_fmt == AV_SAMPLE_FMT_S32 || m_dst_fmt == AV_SAMPLE_FMT_S32P);
+  }
+  if (m_directConvert)
+  {
+    if (remapLayout)
+    {
+      for (int out=0; out<m_dst_channels && m_directConvert; out++)
+        m_directConvert = m_rematrix[out][out] == 1.0;
+    }
+    else
+      m_directConvert = m_dst_chan_layout == m_src_chan_layout;
+  }
   return true;
 }
 
 int CActiveAEResample::Resample(uint8_t **dst_buffer, int dst_samples, uint8_t **src_buffer, int src_samples, double ratio)
 {
+  // swr keeps samples once it compensates or runs out of space, from then on
+  // everything has to go through it
+  if (ratio != 1.0 || src_samples > dst_samples)
+    m_directConvert = false;
+
+  if (m_directConvert)
+    return Convert(dst_buffer, src_buffer, src_samples);
+
   if (ratio != 1.0)
   {
     if (swr_set_compensation(m_pContext,
@@ -213,12 +248,13 @@ int CActiveAEResample::Resample(uint8_t **dst_buffer, int dst_samples, uint8_t *
     {
       int planes = av_sample_fmt_is_planar(m_dst_fmt) ? m_dst_channels : 1;
       int samples = ret * m_dst_channels / planes;
+      int shift = 32 - m_dst_bits - m_dst_dither_bits;
       for (int i=0; i<planes; i++)
       {
-        uint32_t* buf = (uint32_t*)dst_buffer[i];
+        int32_t* buf = (int32_t*)dst_buffer[i];
         for (int j=0; j<samples; j++)
         {
-          *buf = *buf >> m_dst_dither_bits;
+          buf[j] = buf[j] >> shift;
         }
       }
     }
@@ -226,6 +262,33 @@ int CActiveAEResample::Resample(uint8_t **dst_buffer, int dst_samples, uint8_t *
   return ret;
 }
 
+int CActiveAEResample::Convert(uint8_t **dst_buffer, uint8_t **src_buffer, int samples)
+{
+  bool srcPlanar = av_sample_fmt_is_planar(m_src_fmt) != 0;
+  if (srcPlanar != (av_sample_fmt_is_planar(m_dst_fmt) != 0))
+  {
+    if (srcPlanar)
+      CAEKernels::Interleave((const float* const*)src_buffer, (float*)dst_buffer[0], samples, m_src_channels);
+    else
+      CAEKernels::Deinterleave((const float*)src_buffer[0], (float**)dst_buffer, samples, m_src_channels);
+    return samples;
+  }
+
+  int planes = srcPlanar ? m_src_channels : 1;
+  int count = samples * m_src_channels / planes;
+  for (int i=0; i<planes; i++)
+  {
+    const float *src = (const float*)src_buffer[i];
+    if (m_dst_fmt == AV_SAMPLE_FMT_S16 || m_dst_fmt == AV_SAMPLE_FMT_S16P)
+      CAEKernels::FloatToS16(src, (int16_t*)dst_buffer[i], count);
+    else if (m_dst_bits == 32 || (m_dst_dither_bits + m_dst_bits) == 32)
+      CAEKernels::FloatToS32(src, (int32_t*)dst_buffer[i], count);
+    else
+      CAEKernels::FloatToS24(src, (int32_t*)dst_buffer[i], count);
+  }
+  return samples;
+}
+
 int64_t CActiveAEResample::GetDelay(int64_t base)
 {
   return swr_get_delay(m_pContext, base);
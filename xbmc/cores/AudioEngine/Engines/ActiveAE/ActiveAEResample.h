@@ -51,7 +51,9 @@ public:
   int GetAVChannelIndex(enum AEChannel aechannel, uint64_t layout);
 
 protected:
+  int Convert(uint8_t **dst_buffer, uint8_t **src_buffer, int samples);
   bool m_loaded;
+  bool m_directConvert;
   uint64_t m_src_chan_layout, m_dst_chan_layout;
   int m_src_rate, m_dst_rate;
   int m_src_channels, m_dst_channels;
@@ -0,0 +1,764 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "AEKernels.h"
+#include "AEUtil.h"
+#include "utils/CPUInfo.h"
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/* the vector kernels round like the scalar ones: to nearest, ties to even.
+   floats of 2^23 and above are integers already. */
+static inline int32_t RoundToInt(float v)
+{
+  if (v >= 0.0f)
+  {
+    if (v < 8388608.0f)
+      v = (v + 8388608.0f) - 8388608.0f;
+  }
+  else if (v > -8388608.0f)
+    v = (v - 8388608.0f) + 8388608.0f;
+  return (int32_t)v;
+}
+
+static inline float SoftClipSample(float x)
+{
+  /* rational function to approximate a tanh-like soft clipper, it is based
+     on the pade-approximation of the tanh function with tweaked coefficients
+     and reaches +-1 at +-3. See: http://www.musicdsp.org/showone.php?id=238 */
+  if (x < -3.0f)
+    x = -3.0f;
+  else if (x > 3.0f)
+    x = 3.0f;
+  float y = x * x;
+  return x * (27.0f + y) / (27.0f + 9.0f * y);
+}
+
+static inline float Peak(float peak, float value)
+{
+  value = fabsf(value);
+  return value > peak ? value : peak;
+}
+
+//-----------------------------------------------------------------------------
+// scalar kernels
+//-----------------------------------------------------------------------------
+
+static void Mul_C(float *data, float gain, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+    data[i] *= gain;
+}
+
+static void MulFrames_C(float *data, const float *gains, unsigned int frames, unsigned int channels)
+{
+  for (unsigned int f = 0; f < frames; f++)
+  {
+    const float gain = gains[f];
+    for (unsigned int c = 0; c < channels; c++)
+      *data++ *= gain;
+  }
+}
+
+static float MixAdd_C(float *dst, const float *src, float gain, unsigned int count)
+{
+  float peak = 0.0f;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    dst[i] += src[i] * gain;
+    peak = Peak(peak, dst[i]);
+  }
+  return peak;
+}
+
+static float MixAddFrames_C(float *dst, const float *src, const float *gains, unsigned int frames, unsigned int channels)
+{
+  float peak = 0.0f;
+  for (unsigned int f = 0; f < frames; f++)
+  {
+    const float gain = gains[f];
+    for (unsigned int c = 0; c < channels; c++, dst++, src++)
+    {
+      *dst += *src * gain;
+      peak = Peak(peak, *dst);
+    }
+  }
+  return peak;
+}
+
+static void SoftClip_C(float *data, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+    data[i] = SoftClipSample(data[i]);
+}
+
+static void FloatToS16_C(const float *src, int16_t *dst, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+  {
+    float v = src[i] * 32768.0f;
+    if (v > 32767.0f)
+      v = 32767.0f;
+    else if (v < -32768.0f)
+      v = -32768.0f;
+    dst[i] = (int16_t)RoundToInt(v);
+  }
+}
+
+static void FloatToS24_C(const float *src, int32_t *dst, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+  {
+    float v = src[i] * 8388608.0f;
+    if (v > 8388607.0f)
+      v = 8388607.0f;
+    else if (v < -8388608.0f)
+      v = -8388608.0f;
+    dst[i] = RoundToInt(v);
+  }
+}
+
+static void FloatToS32_C(const float *src, int32_t *dst, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+  {
+    float v = src[i] * 2147483648.0f;
+    if (v >= 2147483648.0f)
+      dst[i] = 0x7FFFFFFF;
+    else if (v <= -2147483648.0f)
+      dst[i] = (int32_t)0x80000000;
+    else
+      dst[i] = RoundToInt(v);
+  }
+}
+
+static void Interleave_C(const float * const *src, float *dst, unsigned int frames, unsigned int channels)
+{
+  for (unsigned int f = 0; f < frames; f++)
+  {
+    for (unsigned int c = 0; c < channels; c++)
+      *dst++ = src[c][f];
+  }
+}
+
+static void Deinterleave_C(const float *src, float * const *dst, unsigned int frames, unsigned int channels)
+{
+  for (unsigned int f = 0; f < frames; f++)
+  {
+    for (unsigned int c = 0; c < channels; c++)
+      dst[c][f] = *src++;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// SSE2 kernels
+//-----------------------------------------------------------------------------
+
+#if defined(__SSE2__)
+static inline float HorizontalMax(__m128 v)
+{
+  v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+  return _mm_cvtss_f32(v);
+}
+
+static void Mul_SSE2(float *data, float gain, unsigned int count)
+{
+  const __m128 g = _mm_set1_ps(gain);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+    _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+  Mul_C(data + i, gain, count - i);
+}
+
+static void MulFrames_SSE2(float *data, const float *gains, unsigned int frames, unsigned int channels)
+{
+  unsigned int f = 0;
+  if (channels == 1)
+  {
+    for (; f + 4 <= frames; f += 4, data += 4)
+      _mm_storeu_ps(data, _mm_mul_ps(_mm_loadu_ps(data), _mm_loadu_ps(gains + f)));
+  }
+  else if (channels == 2)
+  {
+    for (; f + 4 <= frames; f += 4, data += 8)
+    {
+      __m128 g = _mm_loadu_ps(gains + f);
+      _mm_storeu_ps(data,     _mm_mul_ps(_mm_loadu_ps(data),     _mm_unpacklo_ps(g, g)));
+      _mm_storeu_ps(data + 4, _mm_mul_ps(_mm_loadu_ps(data + 4), _mm_unpackhi_ps(g, g)));
+    }
+  }
+  else if ((channels & 3) == 0)
+  {
+    for (; f < frames; f++)
+    {
+      const __m128 g = _mm_set1_ps(gains[f]);
+      for (unsigned int c = 0; c < channels; c += 4, data += 4)
+        _mm_storeu_ps(data, _mm_mul_ps(_mm_loadu_ps(data), g));
+    }
+  }
+  MulFrames_C(data, gains + f, frames - f, channels);
+}
+
+static float MixAdd_SSE2(float *dst, const float *src, float gain, unsigned int count)
+{
+  const __m128 g = _mm_set1_ps(gain);
+  const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 peak = _mm_setzero_ps();
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 out = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+    _mm_storeu_ps(dst + i, out);
+    peak = _mm_max_ps(peak, _mm_and_ps(out, abs));
+  }
+  float tail = MixAdd_C(dst + i, src + i, gain, count - i);
+  return std::max(HorizontalMax(peak), tail);
+}
+
+static float MixAddFrames_SSE2(float *dst, const float *src, const float *gains, unsigned int frames, unsigned int channels)
+{
+  const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 peak = _mm_setzero_ps();
+  unsigned int f = 0;
+  if (channels == 1)
+  {
+    for (; f + 4 <= frames; f += 4, dst += 4, src += 4)
+    {
+      __m128 out = _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(_mm_loadu_ps(src), _mm_loadu_ps(gains + f)));
+      _mm_storeu_ps(dst, out);
+      peak = _mm_max_ps(peak, _mm_and_ps(out, abs));
+    }
+  }
+  else if (channels == 2)
+  {
+    for (; f + 4 <= frames; f += 4, dst += 8, src += 8)
+    {
+      __m128 g = _mm_loadu_ps(gains + f);
+      __m128 lo = _mm_add_ps(_mm_loadu_ps(dst),     _mm_mul_ps(_mm_loadu_ps(src),     _mm_unpacklo_ps(g, g)));
+      __m128 hi = _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(_mm_loadu_ps(src + 4), _mm_unpackhi_ps(g, g)));
+      _mm_storeu_ps(dst,     lo);
+      _mm_storeu_ps(dst + 4, hi);
+      peak = _mm_max_ps(peak, _mm_max_ps(_mm_and_ps(lo, abs), _mm_and_ps(hi, abs)));
+    }
+  }
+  else if ((channels & 3) == 0)
+  {
+    for (; f < frames; f++)
+    {
+      const __m128 g = _mm_set1_ps(gains[f]);
+      for (unsigned int c = 0; c < channels; c += 4, dst += 4, src += 4)
+      {
+        __m128 out = _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(_mm_loadu_ps(src), g));
+        _mm_storeu_ps(dst, out);
+        peak = _mm_max_ps(peak, _mm_and_ps(out, abs));
+      }
+    }
+  }
+  float tail = MixAddFrames_C(dst, src, gains + f, frames - f, channels);
+  return std::max(HorizontalMax(peak), tail);
+}
+
+static void SoftClip_SSE2(float *data, unsigned int count)
+{
+  const __m128 min = _mm_set1_ps(-3.0f);
+  const __m128 max = _mm_set1_ps(3.0f);
+  const __m128 c1 = _mm_set1_ps(27.0f);
+  const __m128 c2 = _mm_set1_ps(9.0f);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 x = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(data + i), max), min);
+    __m128 y = _mm_mul_ps(x, x);
+    _mm_storeu_ps(data + i, _mm_div_ps(_mm_mul_ps(x, _mm_add_ps(c1, y)),
+                                       _mm_add_ps(c1, _mm_mul_ps(c2, y))));
+  }
+  SoftClip_C(data + i, count - i);
+}
+
+static void FloatToS16_SSE2(const float *src, int16_t *dst, unsigned int count)
+{
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  const __m128 min = _mm_set1_ps(-32768.0f);
+  const __m128 max = _mm_set1_ps(32767.0f);
+  unsigned int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+    lo = _mm_max_ps(_mm_min_ps(lo, max), min);
+    hi = _mm_max_ps(_mm_min_ps(hi, max), min);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+  }
+  FloatToS16_C(src + i, dst + i, count - i);
+}
+
+static void FloatToS24_SSE2(const float *src, int32_t *dst, unsigned int count)
+{
+  const __m128 scale = _mm_set1_ps(8388608.0f);
+  const __m128 min = _mm_set1_ps(-8388608.0f);
+  const __m128 max = _mm_set1_ps(8388607.0f);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    v = _mm_max_ps(_mm_min_ps(v, max), min);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_cvtps_epi32(v));
+  }
+  FloatToS24_C(src + i, dst + i, count - i);
+}
+
+static void FloatToS32_SSE2(const float *src, int32_t *dst, unsigned int count)
+{
+  const __m128 scale = _mm_set1_ps(2147483648.0f);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    /* out of range conversions return 0x80000000, which is only right for
+       negative values, flip it to 0x7FFFFFFF for positive ones */
+    __m128i overflow = _mm_castps_si128(_mm_cmpge_ps(v, scale));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_cvtps_epi32(v), overflow));
+  }
+  FloatToS32_C(src + i, dst + i, count - i);
+}
+
+static void Interleave_SSE2(const float * const *src, float *dst, unsigned int frames, unsigned int channels)
+{
+  if (channels != 2)
+  {
+    Interleave_C(src, dst, frames, channels);
+    return;
+  }
+
+  unsigned int f = 0;
+  for (; f + 4 <= frames; f += 4, dst += 8)
+  {
+    __m128 l = _mm_loadu_ps(src[0] + f);
+    __m128 r = _mm_loadu_ps(src[1] + f);
+    _mm_storeu_ps(dst,     _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(l, r));
+  }
+  for (; f < frames; f++)
+  {
+    *dst++ = src[0][f];
+    *dst++ = src[1][f];
+  }
+}
+
+static void Deinterleave_SSE2(const float *src, float * const *dst, unsigned int frames, unsigned int channels)
+{
+  if (channels != 2)
+  {
+    Deinterleave_C(src, dst, frames, channels);
+    return;
+  }
+
+  unsigned int f = 0;
+  for (; f + 4 <= frames; f += 4, src += 8)
+  {
+    __m128 a = _mm_loadu_ps(src);
+    __m128 b = _mm_loadu_ps(src + 4);
+    _mm_storeu_ps(dst[0] + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(dst[1] + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  for (; f < frames; f++)
+  {
+    dst[0][f] = *src++;
+    dst[1][f] = *src++;
+  }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// NEON kernels
+// ARMv7 NEON has no division and flushes denormals, soft clipping stays
+// scalar and the kernels are only exact for normal input
+//-----------------------------------------------------------------------------
+
+#if defined(__ARM_NEON__)
+static inline float HorizontalMax(float32x4_t v)
+{
+  float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+  m = vpmax_f32(m, m);
+  return vget_lane_f32(m, 0);
+}
+
+/* round to nearest even like RoundToInt, values of 2^23 and above pass */
+static inline int32x4_t RoundToInt(float32x4_t v)
+{
+  const float32x4_t magic = vdupq_n_f32(8388608.0f);
+  const uint32x4_t sign = vdupq_n_u32(0x80000000);
+  float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(magic),
+                                                  vandq_u32(vreinterpretq_u32_f32(v), sign)));
+  float32x4_t r = vsubq_f32(vaddq_f32(v, m), m);
+  uint32x4_t small = vcltq_f32(vabsq_f32(v), magic);
+  return vcvtq_s32_f32(vbslq_f32(small, r, v));
+}
+
+static void Mul_NEON(float *data, float gain, unsigned int count)
+{
+  const float32x4_t g = vdupq_n_f32(gain);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+    vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), g));
+  Mul_C(data + i, gain, count - i);
+}
+
+static void MulFrames_NEON(float *data, const float *gains, unsigned int frames, unsigned int channels)
+{
+  unsigned int f = 0;
+  if (channels == 1)
+  {
+    for (; f + 4 <= frames; f += 4, data += 4)
+      vst1q_f32(data, vmulq_f32(vld1q_f32(data), vld1q_f32(gains + f)));
+  }
+  else if (channels == 2)
+  {
+    for (; f + 4 <= frames; f += 4, data += 8)
+    {
+      float32x4x2_t d = vld2q_f32(data);
+      float32x4_t g = vld1q_f32(gains + f);
+      d.val[0] = vmulq_f32(d.val[0], g);
+      d.val[1] = vmulq_f32(d.val[1], g);
+      vst2q_f32(data, d);
+    }
+  }
+  else if ((channels & 3) == 0)
+  {
+    for (; f < frames; f++)
+    {
+      const float32x4_t g = vdupq_n_f32(gains[f]);
+      for (unsigned int c = 0; c < channels; c += 4, data += 4)
+        vst1q_f32(data, vmulq_f32(vld1q_f32(data), g));
+    }
+  }
+  MulFrames_C(data, gains + f, frames - f, channels);
+}
+
+static float MixAdd_NEON(float *dst, const float *src, float gain, unsigned int count)
+{
+  const float32x4_t g = vdupq_n_f32(gain);
+  float32x4_t peak = vdupq_n_f32(0.0f);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    float32x4_t out = vaddq_f32(vld1q_f32(dst + i), vmulq_f32(vld1q_f32(src + i), g));
+    vst1q_f32(dst + i, out);
+    peak = vmaxq_f32(peak, vabsq_f32(out));
+  }
+  float tail = MixAdd_C(dst + i, src + i, gain, count - i);
+  return std::max(HorizontalMax(peak), tail);
+}
+
+static float MixAddFrames_NEON(float *dst, const float *src, const float *gains, unsigned int frames, unsigned int channels)
+{
+  float32x4_t peak = vdupq_n_f32(0.0f);
+  unsigned int f = 0;
+  if (channels == 1)
+  {
+    for (; f + 4 <= frames; f += 4, dst += 4, src += 4)
+    {
+      float32x4_t out = vaddq_f32(vld1q_f32(dst), vmulq_f32(vld1q_f32(src), vld1q_f32(gains + f)));
+      vst1q_f32(dst, out);
+      peak = vmaxq_f32(peak, vabsq_f32(out));
+    }
+  }
+  else if (channels == 2)
+  {
+    for (; f + 4 <= frames; f += 4, dst += 8, src += 8)
+    {
+      float32x4x2_t d = vld2q_f32(dst);
+      float32x4x2_t s = vld2q_f32(src);
+      float32x4_t g = vld1q_f32(gains + f);
+      d.val[0] = vaddq_f32(d.val[0], vmulq_f32(s.val[0], g));
+      d.val[1] = vaddq_f32(d.val[1], vmulq_f32(s.val[1], g));
+      vst2q_f32(dst, d);
+      peak = vmaxq_f32(peak, vmaxq_f32(vabsq_f32(d.val[0]), vabsq_f32(d.val[1])));
+    }
+  }
+  else if ((channels & 3) == 0)
+  {
+    for (; f < frames; f++)
+    {
+      const float32x4_t g = vdupq_n_f32(gains[f]);
+      for (unsigned int c = 0; c < channels; c += 4, dst += 4, src += 4)
+      {
+        float32x4_t out = vaddq_f32(vld1q_f32(dst), vmulq_f32(vld1q_f32(src), g));
+        vst1q_f32(dst, out);
+        peak = vmaxq_f32(peak, vabsq_f32(out));
+      }
+    }
+  }
+  float tail = MixAddFrames_C(dst, src, gains + f, frames - f, channels);
+  return std::max(HorizontalMax(peak), tail);
+}
+
+static void FloatToS16_NEON(const float *src, int16_t *dst, unsigned int count)
+{
+  const float32x4_t min = vdupq_n_f32(-32768.0f);
+  const float32x4_t max = vdupq_n_f32(32767.0f);
+  unsigned int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    float32x4_t lo = vmulq_n_f32(vld1q_f32(src + i), 32768.0f);
+    float32x4_t hi = vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f);
+    lo = vmaxq_f32(vminq_f32(lo, max), min);
+    hi = vmaxq_f32(vminq_f32(hi, max), min);
+    vst1q_s16(dst + i, vcombine_s16(vmovn_s32(RoundToInt(lo)), vmovn_s32(RoundToInt(hi))));
+  }
+  FloatToS16_C(src + i, dst + i, count - i);
+}
+
+static void FloatToS24_NEON(const float *src, int32_t *dst, unsigned int count)
+{
+  const float32x4_t min = vdupq_n_f32(-8388608.0f);
+  const float32x4_t max = vdupq_n_f32(8388607.0f);
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    float32x4_t v = vmulq_n_f32(vld1q_f32(src + i), 8388608.0f);
+    vst1q_s32(dst + i, RoundToInt(vmaxq_f32(vminq_f32(v, max), min)));
+  }
+  FloatToS24_C(src + i, dst + i, count - i);
+}
+
+static void FloatToS32_NEON(const float *src, int32_t *dst, unsigned int count)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    /* the conversion saturates on its own */
+    vst1q_s32(dst + i, RoundToInt(vmulq_n_f32(vld1q_f32(src + i), 2147483648.0f)));
+  }
+  FloatToS32_C(src + i, dst + i, count - i);
+}
+
+static void Interleave_NEON(const float * const *src, float *dst, unsigned int frames, unsigned int channels)
+{
+  if (channels != 2)
+  {
+    Interleave_C(src, dst, frames, channels);
+    return;
+  }
+
+  unsigned int f = 0;
+  for (; f + 4 <= frames; f += 4, dst += 8)
+  {
+    float32x4x2_t d;
+    d.val[0] = vld1q_f32(src[0] + f);
+    d.val[1] = vld1q_f32(src[1] + f);
+    vst2q_f32(dst, d);
+  }
+  for (; f < frames; f++)
+  {
+    *dst++ = src[0][f];
+    *dst++ = src[1][f];
+  }
+}
+
+static void Deinterleave_NEON(const float *src, float * const *dst, unsigned int frames, unsigned int channels)
+{
+  if (channels != 2)
+  {
+    Deinterleave_C(src, dst, frames, channels);
+    return;
+  }
+
+  unsigned int f = 0;
+  for (; f + 4 <= frames; f += 4, src += 8)
+  {
+    float32x4x2_t s = vld2q_f32(src);
+    vst1q_f32(dst[0] + f, s.val[0]);
+    vst1q_f32(dst[1] + f, s.val[1]);
+  }
+  for (; f < frames; f++)
+  {
+    dst[0][f] = *src++;
+    dst[1][f] = *src++;
+  }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// dispatch
+//-----------------------------------------------------------------------------
+
+struct AEKernelTable
+{
+  AEKernelSet set;
+  void  (*Mul)         (float *data, float gain, unsigned int count);
+  void  (*MulFrames)   (float *data, const float *gains, unsigned int frames, unsigned int channels);
+  float (*MixAdd)      (float *dst, const float *src, float gain, unsigned int count);
+  float (*MixAddFrames)(float *dst, const float *src, const float *gains, unsigned int frames, unsigned int channels);
+  void  (*SoftClip)    (float *data, unsigned int count);
+  void  (*FloatToS16)  (const float *src, int16_t *dst, unsigned int count);
+  void  (*FloatToS24)  (const float *src, int32_t *dst, unsigned int count);
+  void  (*FloatToS32)  (const float *src, int32_t *dst, unsigned int count);
+  void  (*Interleave)  (const float * const *src, float *dst, unsigned int frames, unsigned int channels);
+  void  (*Deinterleave)(const float *src, float * const *dst, unsigned int frames, unsigned int channels);
+};
+
+static const AEKernelTable ScalarKernels =
+{
+  AE_KERNELS_SCALAR,
+  Mul_C, MulFrames_C, MixAdd_C, MixAddFrames_C, SoftClip_C,
+  FloatToS16_C, FloatToS24_C, FloatToS32_C, Interleave_C, Deinterleave_C
+};
+
+#if defined(__SSE2__)
+static const AEKernelTable SSE2Kernels =
+{
+  AE_KERNELS_SSE2,
+  Mul_SSE2, MulFrames_SSE2, MixAdd_SSE2, MixAddFrames_SSE2, SoftClip_SSE2,
+  FloatToS16_SSE2, FloatToS24_SSE2, FloatToS32_SSE2, Interleave_SSE2, Deinterleave_SSE2
+};
+#endif
+
+#if defined(__ARM_NEON__)
+static const AEKernelTable NEONKernels =
+{
+  AE_KERNELS_NEON,
+  Mul_NEON, MulFrames_NEON, MixAdd_NEON, MixAddFrames_NEON, SoftClip_C,
+  FloatToS16_NEON, FloatToS24_NEON, FloatToS32_NEON, Interleave_NEON, Deinterleave_NEON
+};
+#endif
+
+static const AEKernelTable *GetTable(AEKernelSet set)
+{
+  switch (set)
+  {
+#if defined(__SSE2__)
+  case AE_KERNELS_SSE2:
+    if (g_cpuInfo.GetCPUFeatures() & CPU_FEATURE_SSE2)
+      return &SSE2Kernels;
+    break;
+#endif
+#if defined(__ARM_NEON__)
+  case AE_KERNELS_NEON:
+    if (g_cpuInfo.GetCPUFeatures() & CPU_FEATURE_NEON)
+      return &NEONKernels;
+    break;
+#endif
+  case AE_KERNELS_SCALAR:
+    return &ScalarKernels;
+  default:
+    break;
+  }
+  return NULL;
+}
+
+/* selected on first use, every thread ends up with the same table */
+static const AEKernelTable *s_kernels = NULL;
+
+static inline const AEKernelTable &Kernels()
+{
+  if (!s_kernels)
+    s_kernels = GetTable(CAEKernels::GetBestSet());
+  return *s_kernels;
+}
+
+void CAEKernels::Mul(float *data, float gain, unsigned int count)
+{
+  Kernels().Mul(data, gain, count);
+}
+
+void CAEKernels::MulFrames(float *data, const float *gains, unsigned int frames, unsigned int channels)
+{
+  Kernels().MulFrames(data, gains, frames, channels);
+}
+
+float CAEKernels::MixAdd(float *dst, const float *src, float gain, unsigned int count)
+{
+  return Kernels().MixAdd(dst, src, gain, count);
+}
+
+float CAEKernels::MixAddFrames(float *dst, const float *src, const float *gains, unsigned int frames, unsigned int channels)
+{
+  return Kernels().MixAddFrames(dst, src, gains, frames, channels);
+}
+
+void CAEKernels::SoftClip(float *data, unsigned int count)
+{
+  Kernels().SoftClip(data, count);
+}
+
+void CAEKernels::FloatToS16(const float *src, int16_t *dst, unsigned int count)
+{
+  Kernels().FloatToS16(src, dst, count);
+}
+
+void CAEKernels::FloatToS24(const float *src, int32_t *dst, unsigned int count)
+{
+  Kernels().FloatToS24(src, dst, count);
+}
+
+void CAEKernels::FloatToS32(const float *src, int32_t *dst, unsigned int count)
+{
+  Kernels().FloatToS32(src, dst, count);
+}
+
+void CAEKernels::Interleave(const float * const *src, float *dst, unsigned int frames, unsigned int channels)
+{
+  Kernels().Interleave(src, dst, frames, channels);
+}
+
+void CAEKernels::Deinterleave(const float *src, float * const *dst, unsigned int frames, unsigned int channels)
+{
+  Kernels().Deinterleave(src, dst, frames, channels);
+}
+
+AEKernelSet CAEKernels::GetBestSet()
+{
+  if (GetTable(AE_KERNELS_SSE2))
+    return AE_KERNELS_SSE2;
+  if (GetTable(AE_KERNELS_NEON))
+    return AE_KERNELS_NEON;
+  return AE_KERNELS_SCALAR;
+}
+
+AEKernelSet CAEKernels::GetSet()
+{
+  return Kernels().set;
+}
+
+bool CAEKernels::SetSet(AEKernelSet set)
+{
+  const AEKernelTable *table = GetTable(set);
+  if (!table)
+    return false;
+  s_kernels = table;
+  return true;
+}
+
+const char *CAEKernels::GetSetName(AEKernelSet set)
+{
+  switch (set)
+  {
+  case AE_KERNELS_SSE2: return "SSE2";
+  case AE_KERNELS_NEON: return "NEON";
+  default:              return "scalar";
+  }
+}
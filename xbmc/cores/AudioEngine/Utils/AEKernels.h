@@ -0,0 +1,91 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+
+enum AEKernelSet
+{
+  AE_KERNELS_SCALAR = 0,
+  AE_KERNELS_SSE2,
+  AE_KERNELS_NEON
+};
+
+/*! \brief Sample processing kernels used by the audio engine.
+
+ Every kernel has a plain C++ implementation and, where the build and the
+ CPU support it, an SSE2 or NEON one that is picked at runtime. The vector
+ implementations produce the same bits as the plain ones for finite input,
+ so the choice never changes the output. Buffers don't need any alignment.
+ Interleaved buffers hold frames of channels samples, planar buffers are
+ passed with channels set to 1.
+ */
+class CAEKernels
+{
+public:
+  /*! \brief data[i] *= gain */
+  static void Mul(float *data, float gain, unsigned int count);
+
+  /*! \brief data[i] *= gains[frame of i], applies a gain ramp or envelope
+   \param gains one gain per frame
+   */
+  static void MulFrames(float *data, const float *gains, unsigned int frames, unsigned int channels);
+
+  /*! \brief dst[i] += src[i] * gain
+   \return the largest absolute value written to dst
+   */
+  static float MixAdd(float *dst, const float *src, float gain, unsigned int count);
+
+  /*! \brief dst[i] += src[i] * gains[frame of i]
+   \return the largest absolute value written to dst
+   */
+  static float MixAddFrames(float *dst, const float *src, const float *gains, unsigned int frames, unsigned int channels);
+
+  /*! \brief tanh-like soft clipping of data to -1..1 */
+  static void SoftClip(float *data, unsigned int count);
+
+  /*! \brief convert float samples to S16, rounding to nearest and saturating */
+  static void FloatToS16(const float *src, int16_t *dst, unsigned int count);
+
+  /*! \brief convert float samples to S24 in the low bits of 32 bit words, rounding to nearest and saturating */
+  static void FloatToS24(const float *src, int32_t *dst, unsigned int count);
+
+  /*! \brief convert float samples to S32, rounding to nearest and saturating */
+  static void FloatToS32(const float *src, int32_t *dst, unsigned int count);
+
+  /*! \brief interleave channels planes of frames samples each into dst */
+  static void Interleave(const float * const *src, float *dst, unsigned int frames, unsigned int channels);
+
+  /*! \brief split frames of interleaved samples into channels planes */
+  static void Deinterleave(const float *src, float * const *dst, unsigned int frames, unsigned int channels);
+
+  /*! \brief the fastest kernel set supported by the build and the CPU */
+  static AEKernelSet GetBestSet();
+
+  /*! \brief the kernel set currently used */
+  static AEKernelSet GetSet();
+
+  /*! \brief switch to another kernel set, for tests and benchmarks
+   \return false if the set isn't supported, the current set stays in use
+   */
+  static bool SetSet(AEKernelSet set);
+
+  static const char *GetSetName(AEKernelSet set);
+};
@@ -27,11 +27,14 @@
 //#define AE_RING_BUFFER_DEBUG
 
 #include "utils/log.h"  //CLog
+#include "threads/Atomics.h"
 #include <string.h>     //memset, memcpy
 
 /**
  * This buffer can be used by one read and one write thread at any one time
- * without the risk of data corruption.
+ * without the risk of data corruption. The read and write counters are
+ * published with acquire/release semantics and kept on cache lines of
+ * their own, see also CSPSCRingBuffer.
  * If you intend to call the Reset() method, please use Locks.
  * All other operations are thread-safe.
  */
@@ -236,7 +239,7 @@ public:
    */
   unsigned int GetWriteSize()
   {
-    return m_iSize - ( m_iWritten - m_iRead );
+    return m_iSize - GetReadSize();
   }
 
   /**
@@ -245,7 +248,7 @@ public:
    */
   unsigned int GetReadSize()
   {
-    return m_iWritten - m_iRead;
+    return (unsigned int)((unsigned long)AtomicLoadAcquire(&m_iWritten) - (unsigned long)AtomicLoadAcquire(&m_iRead));
   }
 
   /**
@@ -276,7 +279,7 @@ private:
       m_iWritePos = size - (m_iSize - m_iWritePos);
 
     //we can increase the write count now
-    m_iWritten+=size;
+    AtomicStoreRelease(&m_iWritten, (long)((unsigned long)m_iWritten + size));
   }
 
   /**
@@ -291,13 +294,16 @@ private:
       m_iReadPos = size - (m_iSize - m_iReadPos);
 
     //we can increase the read count now
-    m_iRead+=size;
+    AtomicStoreRelease(&m_iRead, (long)((unsigned long)m_iRead + size));
   }
 
   unsigned int m_iReadPos;
   unsigned int m_iWritePos;
-  unsigned int m_iRead;
-  unsigned int m_iWritten;
+  char m_pad0[64];
+  volatile long m_iRead;
+  char m_pad1[64 - sizeof(long)];
+  volatile long m_iWritten;
+  char m_pad2[64 - sizeof(long)];
   unsigned int m_iSize;
   unsigned int m_planes;
   unsigned char **m_Buffer;
@@ -33,6 +33,7 @@
 #include "settings/AdvancedSettings.h"
 #include "settings/DisplaySettings.h"
 #include "settings/MediaSettings.h"
+#include "settings/SettingHandle.h"
 #include "settings/Settings.h"
 #include "VideoShaders/YUV2RGBShader.h"
 #include "VideoShaders/VideoFilterShader.h"
@@ -3429,11 +3430,13 @@ void CLinuxRendererGL::SetTextureFilter(GLenum method)
   }
 }
 
+static CSettingBoolHandle s_limitedRange("videoscreen.limitedrange");
+
 bool CLinuxRendererGL::Supports(ERENDERFEATURE feature)
 {
   if(feature == RENDERFEATURE_BRIGHTNESS)
   {
-    if ((m_renderMethod & RENDER_VDPAU) && !CSettings::Get().GetBool("videoscreen.limitedrange"))
+    if ((m_renderMethod & RENDER_VDPAU) && !s_limitedRange.Get())
       return true;
 
     if (m_renderMethod & RENDER_VAAPI)
@@ -3446,7 +3449,7 @@ bool CLinuxRendererGL::Supports(ERENDERFEATURE feature)
   
   if(feature == RENDERFEATURE_CONTRAST)
   {
-    if ((m_renderMethod & RENDER_VDPAU) && !CSettings::Get().GetBool("videoscreen.limitedrange"))
+    if ((m_renderMethod & RENDER_VDPAU) && !s_limitedRange.Get())
       return true;
 
     if (m_renderMethod & RENDER_VAAPI)
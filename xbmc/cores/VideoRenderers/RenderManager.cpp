@@ -36,6 +36,7 @@
 #include "ApplicationMessenger.h"
 #include "settings/AdvancedSettings.h"
 #include "settings/MediaSettings.h"
+#include "settings/SettingHandle.h"
 #include "settings/Settings.h"
 #include "guilib/GUIFontManager.h"
 
@@ -724,11 +725,13 @@ RESOLUTION CXBMCRenderManager::GetResolution()
     return RES_INVALID;
 }
 
+static CSettingIntHandle s_vsync("videoscreen.vsync");
+
 float CXBMCRenderManager::GetMaximumFPS()
 {
   float fps;
 
-  if (CSettings::Get().GetInt("videoscreen.vsync") != VSYNC_DISABLED)
+  if (s_vsync.Get() != VSYNC_DISABLED)
   {
     fps = (float)g_VideoReferenceClock.GetRefreshRate();
     if (fps <= 0) fps = g_graphicsContext.GetFPS();
@@ -23,19 +23,176 @@
 #endif
 #include "DVDDemuxUtils.h"
 #include "DVDClock.h"
+#include "threads/CriticalSection.h"
+#include "threads/SingleLock.h"
 #include "utils/log.h"
 
+#include <vector>
+
 extern "C" {
 #include "libavcodec/avcodec.h"
 }
 
+/* what the pool keeps about the packets it hands out, the packet itself
+   stays what decoders and addons know as DemuxPacket */
+struct CPooledDemuxPacket : public DemuxPacket
+{
+  int iCapacity;        // size of the pData allocation including padding, 0 if pData isn't allocated by us
+  AVBufferRef *pBuffer; // ffmpeg buffer pData points into
+};
+
+/* Packets are kept in size classes, four per octave from 1k to 4M, so a
+   recycled packet wastes at most a quarter of its allocation. Packets
+   without data of their own share class 0. */
+class CDemuxPacketPool
+{
+public:
+  static const int Classes = 49;
+  static const int MinCapacity = 1024;
+  static const size_t MaxCachedBytes = 16 * 1024 * 1024;
+  static const size_t MaxCachedEmpty = 256;
+
+  CDemuxPacketPool() : m_cachedBytes(0)
+  {
+    memset(&m_stats, 0, sizeof(m_stats));
+  }
+
+  ~CDemuxPacketPool()
+  {
+    for (int i = 0; i <= Classes; i++)
+    {
+      for (std::vector<CPooledDemuxPacket*>::iterator it = m_free[i].begin(); it != m_free[i].end(); ++it)
+        Delete(*it);
+    }
+  }
+
+  /* the class whose capacity fits bytes, -1 if they are too many to pool */
+  static int SizeClass(int bytes)
+  {
+    if (bytes <= 0)
+      return 0;
+    if (bytes <= MinCapacity)
+      return 1;
+    if (bytes > Capacity(Classes))
+      return -1;
+    int octave = 0;
+    while ((2 * MinCapacity << octave) < bytes)
+      octave++;
+    int step = MinCapacity / 4 << octave;
+    return octave * 4 + (bytes - (MinCapacity << octave) + step - 1) / step + 1;
+  }
+
+  static int Capacity(int index)
+  {
+    int octave = (index - 1) / 4;
+    return (MinCapacity << octave) + (index - 1) % 4 * (MinCapacity / 4 << octave);
+  }
+
+  /* a packet with room for bytes including padding */
+  CPooledDemuxPacket *Get(int bytes)
+  {
+    int index = SizeClass(bytes);
+    CPooledDemuxPacket *packet = NULL;
+    {
+      CSingleLock lock(m_section);
+      m_stats.allocated++;
+      if (index >= 0 && !m_free[index].empty())
+      {
+        packet = m_free[index].back();
+        m_free[index].pop_back();
+        m_cachedBytes -= packet->iCapacity;
+        m_stats.reused++;
+      }
+    }
+
+    unsigned char *data = NULL;
+    int capacity = 0;
+    if (packet)
+    {
+      data = packet->pData;
+      capacity = packet->iCapacity;
+    }
+    else
+    {
+      packet = new CPooledDemuxPacket;
+      if (index != 0)
+      {
+        capacity = index > 0 ? Capacity(index) : bytes;
+        data = (unsigned char*)_aligned_malloc(capacity, 16);
+        if (!data)
+        {
+          delete packet;
+          return NULL;
+        }
+      }
+    }
+
+    memset(packet, 0, sizeof(CPooledDemuxPacket));
+    packet->pData = data;
+    packet->iCapacity = capacity;
+    return packet;
+  }
+
+  void Put(CPooledDemuxPacket *packet)
+  {
+    if (packet->pBuffer)
+    {
+      av_buffer_unref(&packet->pBuffer);
+      packet->pData = NULL;
+    }
+
+    int index = packet->iCapacity > 0 ? SizeClass(packet->iCapacity) : 0;
+    if (index >= 0)
+    {
+      CSingleLock lock(m_section);
+      if (index == 0 ? m_free[0].size() < MaxCachedEmpty
+                     : m_cachedBytes + packet->iCapacity <= MaxCachedBytes)
+      {
+        m_free[index].push_back(packet);
+        m_cachedBytes += packet->iCapacity;
+        return;
+      }
+    }
+    Delete(packet);
+  }
+
+  void Count(bool referenced, int bytesCopied)
+  {
+    CSingleLock lock(m_section);
+    if (referenced)
+      m_stats.referenced++;
+    m_stats.bytesCopied += bytesCopied;
+  }
+
+  void GetStats(DemuxPacketStats &stats)
+  {
+    CSingleLock lock(m_section);
+    stats = m_stats;
+    stats.bytesCached = m_cachedBytes;
+  }
+
+private:
+  static void Delete(CPooledDemuxPacket *packet)
+  {
+    if (packet->iCapacity > 0)
+      _aligned_free(packet->pData);
+    delete packet;
+  }
+
+  CCriticalSection m_section;
+  std::vector<CPooledDemuxPacket*> m_free[Classes + 1];
+  size_t m_cachedBytes;
+  DemuxPacketStats m_stats;
+};
+
+static CDemuxPacketPool g_demuxPacketPool;
+
 void CDVDDemuxUtils::FreeDemuxPacket(DemuxPacket* pPacket)
 {
   if (pPacket)
   {
     try {
-      if (pPacket->pData) _aligned_free(pPacket->pData);
-      delete pPacket;
+      g_demuxPacketPool.Put((CPooledDemuxPacket*)pPacket);
     }
     catch(...) {
       CLog::Log(LOGERROR, "%s - Exception thrown while freeing packet", __FUNCTION__);
@@ -45,34 +202,26 @@ void CDVDDemuxUtils::FreeDemuxPacket(DemuxPacket* pPacket)
 
 DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(int iDataSize)
 {
-  DemuxPacket* pPacket = new DemuxPacket;
-  if (!pPacket) return NULL;
+  DemuxPacket* pPacket = NULL;
 
   try
   {
-    memset(pPacket, 0, sizeof(DemuxPacket));
+    // need to allocate a few bytes more.
+    // From avcodec.h (ffmpeg)
+    /**
+      * Required number of additionally allocated bytes at the end of the input bitstream for decoding.
+      * this is mainly needed because some optimized bitstream readers read
+      * 32 or 64 bit at once and could read over the end<br>
+      * Note, if the first 23 bits of the additional bytes are not 0 then damaged
+      * MPEG bitstreams could cause overread and segfault
+      */
+    pPacket = g_demuxPacketPool.Get(iDataSize > 0 ? iDataSize + FF_INPUT_BUFFER_PADDING_SIZE : 0);
+    if (!pPacket)
+      return NULL;
 
+    // reset the padding to 0, recycled packets hold old data
     if (iDataSize > 0)
-    {
-      // need to allocate a few bytes more.
-      // From avcodec.h (ffmpeg)
-      /**
-        * Required number of additionally allocated bytes at the end of the input bitstream for decoding.
-        * this is mainly needed because some optimized bitstream readers read
-        * 32 or 64 bit at once and could read over the end<br>
-        * Note, if the first 23 bits of the additional bytes are not 0 then damaged
-        * MPEG bitstreams could cause overread and segfault
-        */
-      pPacket->pData =(uint8_t*)_aligned_malloc(iDataSize + FF_INPUT_BUFFER_PADDING_SIZE, 16);
-      if (!pPacket->pData)
-      {
-        FreeDemuxPacket(pPacket);
-        return NULL;
-      }
-
-      // reset the last 8 bytes to 0;
       memset(pPacket->pData + iDataSize, 0, FF_INPUT_BUFFER_PADDING_SIZE);
-    }
 
     // setup defaults
     pPacket->dts       = DVD_NOPTS_VALUE;
@@ -87,3 +236,44 @@ DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(int iDataSize)
   }
   return pPacket;
 }
+
+DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(AVPacket* pkt)
+{
+  // a buffer only we reference can be handed to the decoders as it is,
+  // as long as it is aligned and has the padding they expect
+  AVBufferRef *buf = pkt->buf;
+  if (pkt->data && pkt->size > 0 && buf && av_buffer_is_writable(buf) &&
+      ((uintptr_t)pkt->data & 15) == 0 &&
+      pkt->data >= buf->data &&
+      pkt->data + pkt->size + FF_INPUT_BUFFER_PADDING_SIZE <= buf->data + buf->size)
+  {
+    CPooledDemuxPacket* pPacket = (CPooledDemuxPacket*)AllocateDemuxPacket(0);
+    if (!pPacket)
+      return NULL;
+    pPacket->pBuffer = av_buffer_ref(buf);
+    if (!pPacket->pBuffer)
+    {
+      FreeDemuxPacket(pPacket);
+      return NULL;
+    }
+    pPacket->pData = pkt->data;
+    pPacket->iSize = pkt->size;
+    g_demuxPacketPool.Count(true, 0);
+    return pPacket;
+  }
+
+  int size = pkt->data ? pkt->size : 0;
+  DemuxPacket* pPacket = AllocateDemuxPacket(size);
+  if (pPacket && size > 0)
+  {
+    memcpy(pPacket->pData, pkt->data, size);
+    pPacket->iSize = size;
+    g_demuxPacketPool.Count(false, size);
+  }
+  return pPacket;
+}
+
+void CDVDDemuxUtils::GetStats(DemuxPacketStats &stats)
+{
+  g_demuxPacketPool.GetStats(stats);
+}
@@ -21,11 +21,28 @@
  */
 
 #include "DVDDemuxPacket.h"
+#include <stdint.h>
+
+struct AVPacket;
+
+struct DemuxPacketStats
+{
+  uint64_t allocated;   // packets handed out
+  uint64_t reused;      // of these, packets taken from the pool
+  uint64_t referenced;  // of these, packets referencing the demuxer's buffer
+  uint64_t bytesCopied; // payload copied from demuxer packets
+  uint64_t bytesCached; // data held by packets waiting in the pool
+};
 
 class CDVDDemuxUtils
 {
 public:
   static void FreeDemuxPacket(DemuxPacket* pPacket);
   static DemuxPacket* AllocateDemuxPacket(int iDataSize = 0);
+  /*! \brief Allocate a packet holding the payload of an ffmpeg packet.
+   References the buffer of pkt when it is refcounted, writable and padded,
+   copies the payload otherwise. pkt can be freed afterwards either way.
+   */
+  static DemuxPacket* AllocateDemuxPacket(AVPacket* pkt);
+  static void GetStats(DemuxPacketStats &stats);
 };
-
@@ -21,59 +21,313 @@
 #include "DVDMessageQueue.h"
 #include "DVDDemuxers/DVDDemuxUtils.h"
 #include "utils/log.h"
+#include "threads/Atomics.h"
 #include "threads/SingleLock.h"
 #include "DVDClock.h"
 #include "utils/MathUtils.h"
+#include <climits>
 
 using namespace std;
 
+#define MSGQ_CACHE_LINE_SIZE 64
+
+// packet times are kept in milliseconds so they fit the atomics
+#define QUEUE_NOPTS     LONG_MIN
+#define QUEUE_TIME_BASE 1000
+
+/*
+ * Bounded ring of messages for any number of writers and one reader, after
+ * Dmitry Vyukov's bounded queue. Every cell carries a sequence number telling
+ * its state for the position pos it is used for:
+ *
+ *   pos       free, a writer that reserved pos may fill it
+ *   pos + 1   holds a message
+ *   pos + 2   the message was taken, by the reader or by Remove
+ *
+ * Taking a message is a compare and swap of pos + 1 to pos + 2, so Remove
+ * can take messages anywhere in the ring while the reader takes them at the
+ * front. Taken cells at the front are handed back to the writers as
+ * pos + size by whoever advances the read position past them.
+ */
+class CDVDMessageRing
+{
+public:
+  CDVDMessageRing(unsigned int size) : m_mask(size - 1), m_head(0), m_tail(0)
+  {
+    m_cells = new Cell[size];
+    for (unsigned int i = 0; i < size; i++)
+    {
+      m_cells[i].sequence = i;
+      m_cells[i].message  = NULL;
+      m_cells[i].type     = CDVDMsg::NONE;
+      m_cells[i].size     = 0;
+    }
+  }
+
+  ~CDVDMessageRing()
+  {
+    int size;
+    Remove(CDVDMsg::NONE, size);
+    delete[] m_cells;
+  }
+
+  /* queue msg, the ring takes over the reference. size is what the message
+     adds to the data size of the queue. */
+  bool Push(CDVDMsg* msg, int size)
+  {
+    for (;;)
+    {
+      long pos = AtomicLoadAcquire(&m_tail);
+      Cell& cell = m_cells[pos & m_mask];
+      long seq = AtomicLoadAcquire(&cell.sequence);
+      long diff = Distance(pos, seq);
+      if (diff == 0)
+      {
+        if (cas(&m_tail, pos, Advance(pos, 1)) == pos)
+        {
+          cell.message = msg;
+          cell.type    = msg->GetMessageType();
+          cell.size    = size;
+          AtomicStoreRelease(&cell.sequence, Advance(pos, 1));
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        // the cell is still used one round earlier, full unless it was taken
+        Reclaim();
+        if (AtomicLoadAcquire(&cell.sequence) == seq)
+          return false;
+      }
+    }
+  }
+
+  /* the oldest message or NULL, reader only */
+  CDVDMsg* Pop(int &size)
+  {
+    long pos;
+    Cell* cell = Front(pos);
+    while (cell)
+    {
+      CDVDMsg* msg = cell->message;
+      size = cell->size;
+      if (cas(&cell->sequence, Advance(pos, 1), Advance(pos, 2)) == Advance(pos, 1))
+      {
+        Reclaim();
+        return msg;
+      }
+      // removed meanwhile
+      cell = Front(pos);
+    }
+    return NULL;
+  }
+
+  bool Empty()
+  {
+    long pos;
+    return Front(pos) == NULL;
+  }
+
+  /* take and release all messages of type, or all if type is NONE
+     \return the number of messages removed, size receives their size */
+  unsigned int Remove(CDVDMsg::Message type, int &size)
+  {
+    unsigned int count = 0;
+    size = 0;
+    long tail = AtomicLoadAcquire(&m_tail);
+    for (long pos = AtomicLoadAcquire(&m_head); Distance(pos, tail) > 0; pos = Advance(pos, 1))
+    {
+      Cell& cell = m_cells[pos & m_mask];
+      if (AtomicLoadAcquire(&cell.sequence) != Advance(pos, 1))
+        continue;
+      CDVDMsg* msg = cell.message;
+      int msgSize = cell.size;
+      if (type != CDVDMsg::NONE && cell.type != type)
+        continue;
+      if (cas(&cell.sequence, Advance(pos, 1), Advance(pos, 2)) == Advance(pos, 1))
+      {
+        msg->Release();
+        size += msgSize;
+        count++;
+      }
+    }
+    Reclaim();
+    return count;
+  }
+
+  unsigned int Count(CDVDMsg::Message type)
+  {
+    unsigned int count = 0;
+    long tail = AtomicLoadAcquire(&m_tail);
+    for (long pos = AtomicLoadAcquire(&m_head); Distance(pos, tail) > 0; pos = Advance(pos, 1))
+    {
+      Cell& cell = m_cells[pos & m_mask];
+      if (AtomicLoadAcquire(&cell.sequence) == Advance(pos, 1) && cell.type == type)
+        count++;
+    }
+    return count;
+  }
+
+  /* cells in use, including taken ones not handed back yet */
+  unsigned int Used()
+  {
+    long head = AtomicLoadAcquire(&m_head);
+    long diff = Distance(head, AtomicLoadAcquire(&m_tail));
+    return diff > 0 ? (unsigned int)diff : 0;
+  }
+
+  unsigned int Capacity() const { return m_mask + 1; }
+
+private:
+  CDVDMessageRing(const CDVDMessageRing&);
+  CDVDMessageRing& operator=(const CDVDMessageRing&);
+
+  struct Cell
+  {
+    volatile long    sequence;
+    CDVDMsg*         message;
+    CDVDMsg::Message type;
+    int              size;
+  };
+
+  /* positions wrap around, compare them by their distance */
+  static long Distance(long from, long to)
+  {
+    return (long)((unsigned long)to - (unsigned long)from);
+  }
+
+  static long Advance(long pos, unsigned long count)
+  {
+    return (long)((unsigned long)pos + count);
+  }
+
+  /* the cell at the read position if it holds a message */
+  Cell* Front(long &pos)
+  {
+    for (;;)
+    {
+      Reclaim();
+      pos = AtomicLoadAcquire(&m_head);
+      Cell& cell = m_cells[pos & m_mask];
+      long seq = AtomicLoadAcquire(&cell.sequence);
+      if (seq == Advance(pos, 1))
+        return &cell;
+      // empty, or the cell is being filled, unless the front moved on meanwhile
+      if (seq != Advance(pos, 2) && AtomicLoadAcquire(&m_head) == pos)
+        return NULL;
+    }
+  }
+
+  /* hand taken cells at the read position back to the writers */
+  void Reclaim()
+  {
+    for (;;)
+    {
+      long pos = AtomicLoadAcquire(&m_head);
+      Cell& cell = m_cells[pos & m_mask];
+      if (AtomicLoadAcquire(&cell.sequence) != Advance(pos, 2))
+        return;
+      if (cas(&m_head, pos, Advance(pos, 1)) == pos)
+        AtomicStoreRelease(&cell.sequence, Advance(pos, m_mask + 1));
+    }
+  }
+
+  Cell*         m_cells;
+  unsigned long m_mask;
+  char          m_pad0[MSGQ_CACHE_LINE_SIZE];
+  volatile long m_head;
+  char          m_pad1[MSGQ_CACHE_LINE_SIZE - sizeof(long)];
+  volatile long m_tail;
+  char          m_pad2[MSGQ_CACHE_LINE_SIZE - sizeof(long)];
+};
+
+// priority 0 carries the demuxer packets, the queue reports itself full
+// before the ring is so the demuxer stops reading in time
+static const unsigned int RingSizes[] = { 8192, 1024 };
+
 CDVDMessageQueue::CDVDMessageQueue(const string &owner) : m_hEvent(true), m_owner(owner)
 {
   m_iDataSize     = 0;
+  m_waiters       = 0;
   m_bAbortRequest = false;
   m_bInitialized  = false;
-  m_bCaching      = false;
   m_bEmptied      = true;
 
-  m_TimeBack      = DVD_NOPTS_VALUE;
-  m_TimeFront     = DVD_NOPTS_VALUE;
+  m_TimeBack      = QUEUE_NOPTS;
+  m_TimeFront     = QUEUE_NOPTS;
   m_TimeSize      = 1.0 / 4.0; /* 4 seconds */
   m_iMaxDataSize  = 0;
+
+  for (int i = 0; i < Priorities; i++)
+  {
+    m_rings[i] = new CDVDMessageRing(RingSizes[i]);
+    m_overflowed[i] = 0;
+  }
 }
 
 CDVDMessageQueue::~CDVDMessageQueue()
 {
   // remove all remaining messages
-  Flush();
+  for (int i = 0; i < Priorities; i++)
+  {
+    delete m_rings[i];
+    for (Overflow::iterator it = m_overflow[i].begin(); it != m_overflow[i].end(); ++it)
+      it->first->Release();
+  }
 }
 
 void CDVDMessageQueue::Init()
 {
+  CSingleLock lock(m_section);
   m_iDataSize     = 0;
   m_bAbortRequest = false;
   m_bEmptied      = true;
   m_bInitialized  = true;
-  m_TimeBack      = DVD_NOPTS_VALUE;
-  m_TimeFront     = DVD_NOPTS_VALUE;
+  AtomicStoreRelease(&m_TimeBack, QUEUE_NOPTS);
+  AtomicStoreRelease(&m_TimeFront, QUEUE_NOPTS);
+}
+
+long CDVDMessageQueue::ToQueueTime(double pts)
+{
+  if (pts == DVD_NOPTS_VALUE)
+    return QUEUE_NOPTS;
+  double ms = pts / (DVD_TIME_BASE / QUEUE_TIME_BASE);
+  if (ms <= (double)LONG_MIN + 1)
+    return LONG_MIN + 1;
+  if (ms >= (double)LONG_MAX)
+    return LONG_MAX;
+  return (long)ms;
 }
 
 void CDVDMessageQueue::Flush(CDVDMsg::Message type)
 {
   CSingleLock lock(m_section);
 
-  for(SList::iterator it = m_list.begin(); it != m_list.end();)
+  // messages are taken out where they are, the others keep their order
+  for (int i = 0; i < Priorities; i++)
   {
-    if (it->message->IsType(type) ||  type == CDVDMsg::NONE)
-      it = m_list.erase(it);
-    else
-      ++it;
+    int size;
+    m_rings[i]->Remove(type, size);
+    for (Overflow::iterator it = m_overflow[i].begin(); it != m_overflow[i].end();)
+    {
+      if (type == CDVDMsg::NONE || it->first->IsType(type))
+      {
+        size += it->second;
+        it->first->Release();
+        it = m_overflow[i].erase(it);
+      }
+      else
+        ++it;
+    }
+    AtomicStoreRelease(&m_overflowed[i], (long)m_overflow[i].size());
+    if (size)
+      AtomicSubtract(&m_iDataSize, size);
   }
 
   if (type == CDVDMsg::DEMUXER_PACKET ||  type == CDVDMsg::NONE)
   {
-    m_iDataSize = 0;
-    m_TimeBack  = DVD_NOPTS_VALUE;
-    m_TimeFront = DVD_NOPTS_VALUE;
+    AtomicStoreRelease(&m_TimeBack, QUEUE_NOPTS);
+    AtomicStoreRelease(&m_TimeFront, QUEUE_NOPTS);
     m_bEmptied = true;
   }
 }
@@ -101,8 +355,6 @@ void CDVDMessageQueue::End()
 
 MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority)
 {
-  CSingleLock lock(m_section);
-
   if (!m_bInitialized)
   {
     CLog::Log(LOGWARNING, "CDVDMessageQueue(%s)::Put MSGQ_NOT_INITIALIZED", m_owner.c_str());
@@ -115,41 +367,71 @@ MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority)
     return MSGQ_INVALID_MSG;
   }
 
-  SList::iterator it = m_list.begin();
-  while(it != m_list.end())
+  DemuxPacket* packet = NULL;
+  if (pMsg->IsType(CDVDMsg::DEMUXER_PACKET) && priority == 0)
+    packet = ((CDVDMsgDemuxerPacket*)pMsg)->GetPacket();
+
+  // account the packet before Get can see it
+  int size = packet ? packet->iSize : 0;
+  if (size)
+    AtomicAdd(&m_iDataSize, size);
+
+  // the queue keeps the reference the message was put with. Once messages
+  // overflowed the ring the following ones queue up behind them, keeping their order
+  int ring = priority > 0 ? 1 : 0;
+  if (AtomicLoadAcquire(&m_overflowed[ring]) > 0 || !m_rings[ring]->Push(pMsg, size))
   {
-    if(priority <= it->priority)
-      break;
-    ++it;
+    CSingleLock lock(m_section);
+    if (m_overflow[ring].empty())
+      CLog::Log(LOGDEBUG, "CDVDMessageQueue(%s)::Put - ring %d is full, queueing behind it", m_owner.c_str(), ring);
+    m_overflow[ring].push_back(make_pair(pMsg, size));
+    AtomicStoreRelease(&m_overflowed[ring], (long)m_overflow[ring].size());
   }
-  m_list.insert(it, DVDMessageListItem(pMsg, priority));
 
-  if (pMsg->IsType(CDVDMsg::DEMUXER_PACKET) && priority == 0)
+  if (packet)
   {
-    DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)pMsg)->GetPacket();
-    if(packet)
+    long time = ToQueueTime(packet->dts != DVD_NOPTS_VALUE ? packet->dts : packet->pts);
+    if (time != QUEUE_NOPTS)
     {
-      m_iDataSize += packet->iSize;
-      if     (packet->dts != DVD_NOPTS_VALUE)
-        m_TimeFront = packet->dts;
-      else if(packet->pts != DVD_NOPTS_VALUE)
-        m_TimeFront = packet->pts;
-      if(m_TimeBack == DVD_NOPTS_VALUE)
-        m_TimeBack = m_TimeFront;
+      AtomicStoreRelease(&m_TimeFront, time);
+      // the first timestamp after a flush is also the oldest one
+      cas(&m_TimeBack, QUEUE_NOPTS, time);
     }
   }
 
-  pMsg->Release();
-
-  m_hEvent.Set(); // inform waiter for new packet
+  // inform waiter for new packet, the atomic read orders it after the push
+  if (AtomicAdd(&m_waiters, 0) > 0)
+    m_hEvent.Set();
 
   return MSGQ_OK;
 }
 
-MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutInMilliSeconds, int &priority)
+bool CDVDMessageQueue::HasMessage(int priority)
+{
+  for (int i = Priorities - 1; i >= 0 && i >= priority; i--)
+  {
+    if (!m_rings[i]->Empty() || AtomicLoadAcquire(&m_overflowed[i]) > 0)
+      return true;
+  }
+  return false;
+}
+
+CDVDMsg* CDVDMessageQueue::PopOverflow(int priority, int &size)
 {
   CSingleLock lock(m_section);
+  Overflow &overflow = m_overflow[priority];
+  if (overflow.empty())
+    return NULL;
+
+  CDVDMsg* msg = overflow.front().first;
+  size = overflow.front().second;
+  overflow.pop_front();
+  AtomicStoreRelease(&m_overflowed[priority], (long)overflow.size());
+  return msg;
+}
 
+MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutInMilliSeconds, int &priority)
+{
   *pMsg = NULL;
 
   int ret = 0;
@@ -160,7 +442,7 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
     return MSGQ_NOT_INITIALIZED;
   }
 
-  if(m_list.empty() && m_bEmptied == false && priority == 0 && m_owner != "teletext")
+  if(m_bEmptied == false && priority == 0 && m_owner != "teletext" && !HasMessage(0))
   {
 #if !defined(TARGET_RASPBERRY_PI)
     CLog::Log(LOGWARNING, "CDVDMessageQueue(%s)::Get - asked for new data packet, with nothing available", m_owner.c_str());
@@ -170,29 +452,40 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
 
   while (!m_bAbortRequest)
   {
-    if(!m_list.empty() && m_list.back().priority >= priority && !m_bCaching)
+    CDVDMsg* msg = NULL;
+    int size = 0;
+    int prio;
+    for (prio = Priorities - 1; prio >= 0 && prio >= priority; prio--)
+    {
+      msg = m_rings[prio]->Pop(size);
+      // the ring is empty before anything that overflowed it is taken
+      if (!msg && AtomicLoadAcquire(&m_overflowed[prio]) > 0)
+        msg = PopOverflow(prio, size);
+      if (msg)
+        break;
+    }
+
+    if (msg)
     {
-      DVDMessageListItem& item(m_list.back());
-      priority = item.priority;
+      priority = prio;
 
-      if (item.message->IsType(CDVDMsg::DEMUXER_PACKET) && item.priority == 0)
+      if (msg->IsType(CDVDMsg::DEMUXER_PACKET) && prio == 0)
       {
-        DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)item.message)->GetPacket();
+        DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)msg)->GetPacket();
         if(packet)
         {
-          m_iDataSize -= packet->iSize;
-          if     (packet->dts != DVD_NOPTS_VALUE)
-            m_TimeBack = packet->dts;
-          else if(packet->pts != DVD_NOPTS_VALUE)
-            m_TimeBack = packet->pts;
+          AtomicSubtract(&m_iDataSize, size);
+          long time = ToQueueTime(packet->dts != DVD_NOPTS_VALUE ? packet->dts : packet->pts);
+          if (time != QUEUE_NOPTS)
+            AtomicStoreRelease(&m_TimeBack, time);
         }
 
         if(m_bEmptied && m_iDataSize > 0)
           m_bEmptied = false;
       }
 
-      *pMsg = item.message->Acquire();
-      m_list.pop_back();
+      // hand the queue's reference to the caller
+      *pMsg = msg;
 
       ret = MSGQ_OK;
       break;
@@ -204,14 +497,16 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
     }
     else
     {
+      // announce the wait before checking again, so a Put either sees the
+      // waiter and signals or is seen by the check
+      AtomicIncrement(&m_waiters);
       m_hEvent.Reset();
-      lock.Leave();
+      bool signaled = m_bAbortRequest || HasMessage(priority) || m_hEvent.WaitMSec(iTimeoutInMilliSeconds);
+      AtomicDecrement(&m_waiters);
 
       // wait for a new message
-      if (!m_hEvent.WaitMSec(iTimeoutInMilliSeconds))
+      if (!signaled)
         return MSGQ_TIMEOUT;
-
-      lock.Enter();
     }
   }
 
@@ -229,10 +524,14 @@ unsigned CDVDMessageQueue::GetPacketCount(CDVDMsg::Message type)
     return 0;
 
   unsigned count = 0;
-  for(SList::iterator it = m_list.begin(); it != m_list.end();++it)
+  for (int i = 0; i < Priorities; i++)
   {
-    if(it->message->IsType(type))
-      count++;
+    count += m_rings[i]->Count(type);
+    for (Overflow::const_iterator it = m_overflow[i].begin(); it != m_overflow[i].end(); ++it)
+    {
+      if (it->first->IsType(type))
+        count++;
+    }
   }
 
   return count;
@@ -249,28 +548,40 @@ void CDVDMessageQueue::WaitUntilEmpty()
 
 int CDVDMessageQueue::GetLevel() const
 {
-  if(m_iDataSize > m_iMaxDataSize)
+  int dataSize = GetDataSize();
+  if(dataSize > m_iMaxDataSize)
     return 100;
-  if(m_iDataSize == 0)
+
+  // many small packets without timestamps can fill the ring before the data size limit
+  if(m_rings[0]->Used() >= m_rings[0]->Capacity() / 4 * 3 || m_overflowed[0] > 0)
+    return 100;
+
+  if(dataSize == 0)
     return 0;
 
-  if(IsDataBased())
-    return min(100, 100 * m_iDataSize / m_iMaxDataSize);
+  long back  = AtomicLoadAcquire(&m_TimeBack);
+  long front = AtomicLoadAcquire(&m_TimeFront);
+  if(back == QUEUE_NOPTS || front == QUEUE_NOPTS || front <= back)
+    return min(100, 100 * dataSize / m_iMaxDataSize);
 
-  return min(100, MathUtils::round_int(100.0 * m_TimeSize * (m_TimeFront - m_TimeBack) / DVD_TIME_BASE ));
+  return min(100, MathUtils::round_int(100.0 * m_TimeSize * (double)(front - back) / QUEUE_TIME_BASE));
 }
 
 int CDVDMessageQueue::GetTimeSize() const
 {
-  if(IsDataBased())
+  long back  = AtomicLoadAcquire(&m_TimeBack);
+  long front = AtomicLoadAcquire(&m_TimeFront);
+  if(back == QUEUE_NOPTS || front == QUEUE_NOPTS || front <= back)
     return 0;
   else
-    return (int)((m_TimeFront - m_TimeBack) / DVD_TIME_BASE);
+    return (int)((front - back) / QUEUE_TIME_BASE);
 }
 
 bool CDVDMessageQueue::IsDataBased() const
 {
-  return (m_TimeBack == DVD_NOPTS_VALUE  ||
-          m_TimeFront == DVD_NOPTS_VALUE ||
-          m_TimeFront <= m_TimeBack);
+  long back  = AtomicLoadAcquire(&m_TimeBack);
+  long front = AtomicLoadAcquire(&m_TimeFront);
+  return (back == QUEUE_NOPTS  ||
+          front == QUEUE_NOPTS ||
+          front <= back);
 }
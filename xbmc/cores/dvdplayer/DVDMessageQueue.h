@@ -80,6 +80,26 @@ enum MsgQueueReturnCode
 
 #define MSGQ_IS_ERROR(c)    (c < 0)
 
+class CDVDMessageRing;
+
+/*!
+ \brief Message queue feeding one of the player threads.
+
+ Put may be called from any thread, Get only from the thread owning the
+ queue. Messages are kept in preallocated rings, one per priority, that
+ are written and read without locking, so queueing a message allocates
+ nothing and the demuxer never waits for a player thread. The timestamps
+ of the newest and oldest queued packet are kept in milliseconds in atomics,
+ Put sets the newest and Get the oldest one.
+
+ Put never fails for lack of room: when a ring is full the message, and
+ every one after it until the reader catches up, goes to an unbounded list
+ kept under a lock, so control messages are never dropped. The lock is
+ otherwise only taken by Flush, Abort and the functions walking the list.
+
+ Priorities above 0 are all queued as priority 1, which is the highest one
+ used. Within a priority messages are returned in the order they were put.
+ */
 class CDVDMessageQueue
 {
 public:
@@ -105,7 +125,7 @@ public:
     return Get(pMsg, iTimeoutInMilliSeconds, priority);
   }
 
-  int GetDataSize() const               { return m_iDataSize; }
+  int GetDataSize() const               { return (int)m_iDataSize; }
   int GetTimeSize() const;
   unsigned GetPacketCount(CDVDMsg::Message type);
   bool ReceivedAbortRequest()           { return m_bAbortRequest; }
@@ -123,24 +143,36 @@ public:
   bool IsDataBased() const;
 
 private:
+  CDVDMessageQueue(const CDVDMessageQueue&);
+  CDVDMessageQueue& operator=(const CDVDMessageQueue&);
+
+  bool HasMessage(int priority);
+  static long ToQueueTime(double pts);
+  CDVDMsg* PopOverflow(int priority, int &size);
+
+  static const int Priorities = 2;
 
   CEvent m_hEvent;
   mutable CCriticalSection m_section;
 
-  bool m_bAbortRequest;
-  bool m_bInitialized;
-  bool m_bCaching;
+  volatile bool m_bAbortRequest;
+  volatile bool m_bInitialized;
 
-  int m_iDataSize;
-  double m_TimeFront;
-  double m_TimeBack;
+  volatile long m_iDataSize;
+  volatile long m_waiters; // threads waiting in Get, Put only signals when there are any
+  mutable volatile long m_TimeFront; // newest packet time in ms, QUEUE_NOPTS without one
+  mutable volatile long m_TimeBack;  // oldest packet time in ms
   double m_TimeSize;
 
   int m_iMaxDataSize;
-  bool m_bEmptied;
+  volatile bool m_bEmptied; // only decides whether Get warns about running dry
   std::string m_owner;
 
-  typedef std::list<DVDMessageListItem> SList;
-  SList m_list;
+  CDVDMessageRing* m_rings[Priorities];
+
+  // messages put while their ring was full, with their size, guarded by m_section
+  typedef std::list<std::pair<CDVDMsg*, int> > Overflow;
+  Overflow m_overflow[Priorities];
+  volatile long m_overflowed[Priorities]; // sizes of m_overflow, read without the lock
 };
 
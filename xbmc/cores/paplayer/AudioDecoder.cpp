@@ -198,12 +198,21 @@ int CAudioDecoder::ReadSamples(int numsamples)
   if ( numsamples )
   {
     int readSize = 0;
-    int result = m_codec->ReadPCM(m_pcmInputBuffer, numsamples * (m_codec->m_BitsPerSample >> 3), &readSize);
+    int size = numsamples * (m_codec->m_BitsPerSample >> 3);
+
+    // decode straight into our buffer unless the space wraps around
+    CSPSCRingBuffer::Span spans[2];
+    m_pcmBuffer.PeekWrite(spans);
+    bool inPlace = spans[0].size >= (unsigned int)size;
+    int result = m_codec->ReadPCM(inPlace ? (BYTE *)spans[0].data : m_pcmInputBuffer, size, &readSize);
 
     if (result != READ_ERROR && readSize)
     {
       // move it into our buffer
-      m_pcmBuffer.WriteData((char *)m_pcmInputBuffer, readSize);
+      if (inPlace)
+        m_pcmBuffer.CommitWrite(readSize);
+      else
+        m_pcmBuffer.WriteData((char *)m_pcmInputBuffer, readSize);
 
       // update status
       if (m_status == STATUS_QUEUING && m_pcmBuffer.getMaxReadSize() > m_pcmBuffer.getSize() * 0.9)
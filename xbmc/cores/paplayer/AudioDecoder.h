@@ -23,7 +23,7 @@
 #include "threads/Thread.h"
 #include "ICodec.h"
 #include "threads/CriticalSection.h"
-#include "utils/RingBuffer.h"
+#include "utils/SPSCRingBuffer.h"
 #include "cores/AudioEngine/Utils/AEChannelInfo.h"
 
 class CFileItem;
@@ -78,7 +78,7 @@ public:
 
 private:
   // pcm buffer
-  CRingBuffer m_pcmBuffer;
+  CSPSCRingBuffer m_pcmBuffer;
 
   // output buffer (for transferring data from the Pcm Buffer to the rest of the audio chain)
   float m_outputBuffer[OUTPUT_SAMPLES];
@@ -103,6 +103,8 @@ void CDatabase::Filter::AppendGroup(const std::string &strGroup)
 CDatabase::CDatabase(void)
 {
   m_openCount = 0;
+  m_transactionDepth = 0;
+  m_transactionFailed = false;
   m_sqlite = true;
   m_bMultiWrite = false;
   m_multipleExecute = false;
@@ -575,6 +577,8 @@ void CDatabase::Close()
   }
 
   m_openCount = 0;
+  m_transactionDepth = 0;
+  m_transactionFailed = false;
   m_multipleExecute = false;
 
   if (NULL == m_pDB.get() ) return ;
@@ -628,6 +632,10 @@ void CDatabase::Interupt()
 
 void CDatabase::BeginTransaction()
 {
+  // nested transactions are part of the outermost one
+  if (m_transactionDepth++ > 0)
+    return;
+
   try
   {
     if (NULL != m_pDB.get())
@@ -641,6 +649,21 @@ void CDatabase::BeginTransaction()
 
 bool CDatabase::CommitTransaction()
 {
+  if (m_transactionDepth > 1)
+  {
+    m_transactionDepth--;
+    return !m_transactionFailed;
+  }
+  m_transactionDepth = 0;
+
+  if (m_transactionFailed)
+  {
+    // a nested transaction was rolled back, so all of it is
+    CLog::Log(LOGWARNING, "database:committransaction - a nested transaction failed, rolling back");
+    RollbackTransaction();
+    return false;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -656,6 +679,16 @@ bool CDatabase::CommitTransaction()
 
 void CDatabase::RollbackTransaction()
 {
+  // a nested transaction fails the outer one, which rolls back when it ends
+  if (m_transactionDepth > 1)
+  {
+    m_transactionDepth--;
+    m_transactionFailed = true;
+    return;
+  }
+  m_transactionDepth = 0;
+  m_transactionFailed = false;
+
   try
   {
     if (NULL != m_pDB.get())
@@ -669,7 +702,7 @@ void CDatabase::RollbackTransaction()
 
 bool CDatabase::InTransaction()
 {
-  if (NULL != m_pDB.get()) return false;
+  if (NULL == m_pDB.get()) return false;
   return m_pDB->in_transaction();
 }
 
@@ -720,6 +753,35 @@ bool CDatabase::BuildSQL(const CStdString &strQuery, const Filter &filter, CStdS
   return true;
 }
 
+bool CDatabase::SortInDatabase(const CStdString &strQuery, const Filter &filter, const SortDescription &sorting, const std::string &mediaType, CStdString &strSQLExtra, int &total)
+{
+  total = -1;
+  if (!filter.limit.empty() || m_pDB.get() == NULL)
+    return false;
+
+  std::string orderBy;
+  if (sorting.sortBy != SortByNone &&
+     (!filter.order.empty() || !DatabaseUtils::BuildOrderByClause(sorting, mediaType, m_pDB->naturalCollation(), orderBy)))
+    return false;
+
+  if (sorting.limitStart > 0 || sorting.limitEnd > 0)
+  {
+    CStdString strCount;
+    if (filter.group.empty())
+      strCount = PrepareSQL(strQuery, "COUNT(1)") + strSQLExtra;
+    else
+      strCount = "SELECT COUNT(1) FROM (" + PrepareSQL(strQuery, "1") + strSQLExtra + ") AS grouped";
+    total = (int)strtol(GetSingleValue(strCount, m_pDS).c_str(), NULL, 10);
+  }
+
+  if (!orderBy.empty())
+    strSQLExtra += " ORDER BY " + orderBy;
+  if (total >= 0)
+    strSQLExtra += DatabaseUtils::BuildLimitClause(sorting.limitEnd, sorting.limitStart);
+
+  return true;
+}
+
 bool CDatabase::BuildSQL(const CStdString &strBaseDir, const CStdString &strQuery, Filter &filter, CStdString &strSQL, CDbUrl &dbUrl)
 {
   SortDescription sorting;
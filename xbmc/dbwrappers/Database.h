@@ -66,6 +66,11 @@ public:
 
   bool Open(const DatabaseSettings &db);
 
+  /*! \brief Start a transaction
+   Transactions started while another one is open are part of the outer one, they are
+   committed when the outer one is. Rolling back a nested one fails the outer one: its
+   commit rolls everything back and returns false, as do the commits of the other nested ones.
+   */
   void BeginTransaction();
   virtual bool CommitTransaction();
   void RollbackTransaction();
@@ -204,6 +209,21 @@ protected:
 
   bool BuildSQL(const CStdString &strQuery, const Filter &filter, CStdString &strSQL);
 
+  /*! \brief Leave sorting and paging the rows of a library view to the database where possible.
+   That's the case if the filter doesn't limit the rows itself and the sort method can be expressed
+   in SQL (see DatabaseUtils::BuildOrderByClause()), which for text keys needs a database comparing
+   text naturally (see dbiplus::Database::naturalCollation()). The number of rows before paging is counted by
+   a query of its own, so rows of other pages are never read.
+   \param strQuery the query without its conditions, with a %s placeholder for the fields to select
+   \param filter the filter the conditions of the query were built from
+   \param sorting the sorting and paging of the rows
+   \param mediaType the media type of the rows
+   \param strSQLExtra the conditions of the query (see BuildSQL()), the ORDER BY and LIMIT clauses are appended to them
+   \param total [out] the number of rows before paging, -1 if the rows aren't paged
+   \return true if the rows are returned sorted and paged, false if that's still to be done on the results
+   */
+  bool SortInDatabase(const CStdString &strQuery, const Filter &filter, const SortDescription &sorting, const std::string &mediaType, CStdString &strSQLExtra, int &total);
+
   bool m_sqlite; ///< \brief whether we use sqlite (defaults to true)
 
   std::auto_ptr<dbiplus::Database> m_pDB;
@@ -217,6 +237,8 @@ private:
 
   bool m_bMultiWrite; /*!< True if there are any queries in the queue, false otherwise */
   unsigned int m_openCount;
+  unsigned int m_transactionDepth; ///< number of open BeginTransaction() calls
+  bool m_transactionFailed;        ///< a nested transaction was rolled back
 
   bool m_multipleExecute;
   std::vector<std::string> m_multipleQueries;
@@ -199,6 +199,13 @@ void Dataset::parse_sql(string &sql) {
 }
 
 
+bool Dataset::query_stream(const string &sql, const BindList &params) {
+  if (!params.empty())
+    throw DbErrors("Bound parameters are not supported by this database");
+  return query(sql.c_str());
+}
+
+
 void Dataset::close(void) {
   haveError  = false;
   frecno = 0;
@@ -167,6 +167,13 @@ public:
 
   virtual bool in_transaction() {return false;};
 
+/* virtual methods for sorting */
+
+  /*! \brief Get the collation comparing text case insensitively and the numbers in it by value.
+   \return the name of the collation for ORDER BY clauses, empty if the database doesn't have one.
+   */
+  virtual std::string naturalCollation() const { return ""; }
+
 };
 
 
@@ -185,6 +192,7 @@ enum sqlType {sqlSelect,sqlUpdate,sqlInsert,sqlDelete,sqlExec};
 
 typedef std::list<std::string> StringList;
 typedef std::map<std::string,field_value> ParamList;
+typedef std::vector<field_value> BindList;
 
 
 class Dataset  {
@@ -310,6 +318,11 @@ public:
   virtual const void* getExecRes()=0;
 /* as open, but with our query exept Sql */
   virtual bool query(const char *sql) = 0;
+/* as query, but rows are fetched from the server one at a time while walking the dataset with
+   next() instead of being read into memory up front. params are bound to the '?' placeholders
+   in sql. Only first() on the first row, next(), eof() and the field accessors are available,
+   num_rows() returns the number of rows read so far. The default implementation falls back to query(). */
+  virtual bool query_stream(const std::string &sql, const BindList &params = BindList());
 /* Close SQL Query*/
   virtual void close();
 /* This function looks for field Field_name with value equal Field_value
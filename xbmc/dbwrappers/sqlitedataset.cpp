@@ -33,6 +33,7 @@
 #include "utils/log.h"
 #include "system.h" // for Sleep(), OutputDebugString() and GetLastError()
 #include "utils/URIUtils.h"
+#include "utils/StringUtils.h"
 
 #ifdef TARGET_WINDOWS
 #pragma comment(lib, "sqlite3.lib")
@@ -79,6 +80,68 @@ int callback(void* res_ptr,int ncol, char** reslt,char** cols)
   return 0;  
 }
 
+// maximum number of idle prepared statements kept per connection
+static const size_t STMT_CACHE_MAX = 32;
+
+static void read_row(sqlite3_stmt *stmt, sql_record &row)
+{
+  const unsigned int numColumns = row.size();
+  for (unsigned int i = 0; i < numColumns; i++)
+  {
+    field_value &v = row.at(i);
+    int type = sqlite3_column_type(stmt, i);
+    if (type != SQLITE_NULL && v.get_isNull())
+      v = field_value(); // a reused row may still be flagged from a previous NULL
+    switch (type)
+    {
+    case SQLITE_INTEGER:
+      v.set_asInt64(sqlite3_column_int64(stmt, i));
+      break;
+    case SQLITE_FLOAT:
+      v.set_asDouble(sqlite3_column_double(stmt, i));
+      break;
+    case SQLITE_TEXT:
+      v.set_asString((const char *)sqlite3_column_text(stmt, i));
+      break;
+    case SQLITE_BLOB:
+      v.set_asString((const char *)sqlite3_column_text(stmt, i));
+      break;
+    case SQLITE_NULL:
+    default:
+      v.set_asString("");
+      v.set_isNull();
+      break;
+    }
+  }
+}
+
+static int bind_param(sqlite3_stmt *stmt, int index, const field_value &value)
+{
+  if (value.get_isNull())
+    return sqlite3_bind_null(stmt, index);
+
+  switch (value.get_fType())
+  {
+  case ft_Boolean:
+  case ft_Char:
+  case ft_Short:
+  case ft_UShort:
+  case ft_Int:
+  case ft_UInt:
+  case ft_Int64:
+    return sqlite3_bind_int64(stmt, index, value.get_asInt64());
+  case ft_Float:
+  case ft_Double:
+  case ft_LongDouble:
+    return sqlite3_bind_double(stmt, index, value.get_asDouble());
+  default:
+  {
+    std::string text = value.get_asString();
+    return sqlite3_bind_text(stmt, index, text.c_str(), text.size(), SQLITE_TRANSIENT);
+  }
+  }
+}
+
 static int busy_callback(void*, int busyCount)
 {
   Sleep(100);
@@ -86,6 +149,68 @@ static int busy_callback(void*, int busyCount)
   return 1;
 }
 
+// name of the collation sorting text naturally, registered on every connection
+static const char NATURAL_COLLATION[] = "NATURALNOCASE";
+
+// decodes UTF-8 text the way CSortKeys does for the in-memory sort, skipping invalid bytes
+static void decode_text(const void *text, int length, std::wstring &decoded)
+{
+  const unsigned char *str = (const unsigned char *)text;
+  const unsigned char *end = str + length;
+  decoded.reserve(length);
+  while (str < end)
+  {
+    uint32_t c = *str++;
+    if (c >= 0x80)
+    {
+      int trailing;
+      if ((c & 0xE0) == 0xC0)
+      {
+        c &= 0x1F;
+        trailing = 1;
+      }
+      else if ((c & 0xF0) == 0xE0)
+      {
+        c &= 0x0F;
+        trailing = 2;
+      }
+      else if ((c & 0xF8) == 0xF0)
+      {
+        c &= 0x07;
+        trailing = 3;
+      }
+      else
+        continue;
+
+      for (; trailing > 0 && str < end && (*str & 0xC0) == 0x80; trailing--)
+        c = (c << 6) | (*str++ & 0x3F);
+      if (trailing > 0)
+        continue;
+
+      if (sizeof(wchar_t) == 2 && c > 0xFFFF)
+      {
+        c -= 0x10000;
+        decoded.push_back((wchar_t)(0xD800 + (c >> 10)));
+        c = 0xDC00 + (c & 0x3FF);
+      }
+    }
+    decoded.push_back((wchar_t)c);
+  }
+}
+
+// compares text exactly like the library views sort their items in memory,
+// so a list sorted by the database and one sorted by SortUtils agree
+static int natural_collation(void*, int leftLength, const void *left, int rightLength, const void *right)
+{
+  std::wstring l, r;
+  decode_text(left, leftLength, l);
+  decode_text(right, rightLength, r);
+  int64_t result = StringUtils::AlphaNumericCompare(l.c_str(), r.c_str());
+  if (result < 0)
+    return -1;
+  return result > 0 ? 1 : 0;
+}
+
 //************* SqliteDatabase implementation ***************
 
 SqliteDatabase::SqliteDatabase() {
@@ -222,6 +347,7 @@ int SqliteDatabase::connect(bool create) {
     if (sqlite3_open_v2(db_fullpath.c_str(), &conn, flags, NULL)==SQLITE_OK)
     {
       sqlite3_busy_handler(conn, busy_callback, NULL);
+      sqlite3_create_collation(conn, NATURAL_COLLATION, SQLITE_UTF8, NULL, natural_collation);
       char* err=NULL;
       if (setErr(sqlite3_exec(getHandle(),"PRAGMA empty_result_callbacks=ON",NULL,NULL,&err),"PRAGMA empty_result_callbacks=ON") != SQLITE_OK)
       {
@@ -259,6 +385,10 @@ bool SqliteDatabase::exists(void)
 
 void SqliteDatabase::disconnect(void) {
   if (active == false) return;
+  // sqlite3_close fails with SQLITE_BUSY while any statement is left unfinalized
+  while (!streams.empty())
+    (*streams.begin())->finalize_stream();
+  clear_statement_cache();
   sqlite3_close(conn);
   active = false;
 }
@@ -414,6 +544,47 @@ void SqliteDatabase::rollback_transaction() {
 }
 
 
+// methods for the statement cache
+// ---------------------------------------------
+int SqliteDatabase::acquire_statement(const char *sql, sqlite3_stmt **stmt) {
+  for (StatementCache::iterator i = stmt_cache.begin(); i != stmt_cache.end(); ++i)
+  {
+    if (i->first == sql)
+    {
+      *stmt = i->second;
+      stmt_cache.erase(i);
+      return SQLITE_OK;
+    }
+  }
+  *stmt = NULL;
+  return sqlite3_prepare_v2(conn, sql, -1, stmt, NULL);
+}
+
+void SqliteDatabase::release_statement(sqlite3_stmt *stmt) {
+  if (stmt == NULL) return;
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  const char *sql = sqlite3_sql(stmt);
+  if (!active || sql == NULL) {
+    sqlite3_finalize(stmt);
+    return;
+  }
+
+  stmt_cache.push_front(make_pair(string(sql), stmt));
+  if (stmt_cache.size() > STMT_CACHE_MAX) {
+    sqlite3_finalize(stmt_cache.back().second);
+    stmt_cache.pop_back();
+  }
+}
+
+void SqliteDatabase::clear_statement_cache() {
+  for (StatementCache::iterator i = stmt_cache.begin(); i != stmt_cache.end(); ++i)
+    sqlite3_finalize(i->second);
+  stmt_cache.clear();
+}
+
+
 // methods for formatting
 // ---------------------------------------------
 string SqliteDatabase::vprepare(const char *format, va_list args)
@@ -445,6 +616,13 @@ string SqliteDatabase::vprepare(const char *format, va_list args)
   return strResult;
 }
 
+// methods for sorting
+// ---------------------------------------------
+string SqliteDatabase::naturalCollation() const
+{
+  return NATURAL_COLLATION;
+}
+
 
 //************* SqliteDataset implementation ***************
 
@@ -453,6 +631,8 @@ SqliteDataset::SqliteDataset():Dataset() {
   db = NULL;
   errmsg = NULL;
   autorefresh = false;
+  stream_stmt = NULL;
+  stream_rows = -1;
 }
 
 
@@ -461,9 +641,13 @@ SqliteDataset::SqliteDataset(SqliteDatabase *newDb):Dataset(newDb) {
   db = newDb;
   errmsg = NULL;
   autorefresh = false;
+  stream_stmt = NULL;
+  stream_rows = -1;
 }
 
  SqliteDataset::~SqliteDataset(){
+   // a database that disconnected has finalized the statement already
+   release_stream();
    if (errmsg) sqlite3_free(errmsg);
  }
 
@@ -483,6 +667,43 @@ sqlite3* SqliteDataset::handle(){
   else return NULL;
 }
 
+bool SqliteDataset::step_stream() {
+  int rc = sqlite3_step(stream_stmt);
+  if (rc == SQLITE_ROW)
+  {
+    if (result.records.empty())
+      result.records.push_back(new sql_record(result.record_header.size()));
+    read_row(stream_stmt, *result.records[0]);
+    stream_rows++;
+    return true;
+  }
+
+  string query = sqlite3_sql(stream_stmt) ? sqlite3_sql(stream_stmt) : "";
+  release_stream();
+  if (db->setErr(rc == SQLITE_DONE ? SQLITE_OK : rc, query.c_str()) != SQLITE_OK)
+    throw DbErrors(db->getErrorMsg());
+  return false;
+}
+
+void SqliteDataset::release_stream() {
+  if (stream_stmt)
+  {
+    SqliteDatabase *sqlite = static_cast<SqliteDatabase*>(db);
+    sqlite->remove_stream(this);
+    sqlite->release_statement(stream_stmt);
+    stream_stmt = NULL;
+  }
+}
+
+void SqliteDataset::finalize_stream() {
+  if (stream_stmt)
+  {
+    static_cast<SqliteDatabase*>(db)->remove_stream(this);
+    sqlite3_finalize(stream_stmt);
+    stream_stmt = NULL;
+  }
+}
+
 void SqliteDataset::make_query(StringList &_sql) {
   string query;
   if (db == NULL) throw DbErrors("No Database Connection");
@@ -648,8 +869,9 @@ bool SqliteDataset::query(const char *query) {
 
   close();
 
+  SqliteDatabase *sqlite = static_cast<SqliteDatabase*>(db);
   sqlite3_stmt *stmt = NULL;
-  if (db->setErr(sqlite3_prepare_v2(handle(),query,-1,&stmt, NULL),query) != SQLITE_OK)
+  if (db->setErr(sqlite->acquire_statement(query, &stmt),query) != SQLITE_OK)
     throw DbErrors(db->getErrorMsg());
 
   // column headers
@@ -659,37 +881,15 @@ bool SqliteDataset::query(const char *query) {
     result.record_header[i].name = sqlite3_column_name(stmt, i);
 
   // returned rows
-  while (sqlite3_step(stmt) == SQLITE_ROW)
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
   { // have a row of data
-    sql_record *res = new sql_record;
-    res->resize(numColumns);
-    for (unsigned int i = 0; i < numColumns; i++)
-    {
-      field_value &v = res->at(i);
-      switch (sqlite3_column_type(stmt, i))
-      {
-      case SQLITE_INTEGER:
-        v.set_asInt64(sqlite3_column_int64(stmt, i));
-        break;
-      case SQLITE_FLOAT:
-        v.set_asDouble(sqlite3_column_double(stmt, i));
-        break;
-      case SQLITE_TEXT:
-        v.set_asString((const char *)sqlite3_column_text(stmt, i));
-        break;
-      case SQLITE_BLOB:
-        v.set_asString((const char *)sqlite3_column_text(stmt, i));
-        break;
-      case SQLITE_NULL:
-      default:
-        v.set_asString("");
-        v.set_isNull();
-        break;
-      }
-    }
+    sql_record *res = new sql_record(numColumns);
+    read_row(stmt, *res);
     result.records.push_back(res);
   }
-  if (db->setErr(sqlite3_finalize(stmt),query) == SQLITE_OK)
+  sqlite->release_statement(stmt);
+  if (db->setErr(rc == SQLITE_DONE ? SQLITE_OK : rc,query) == SQLITE_OK)
   {
     active = true;
     ds_state = dsSelect;
@@ -706,6 +906,41 @@ bool SqliteDataset::query(const string &q){
   return query(q.c_str());
 }
 
+bool SqliteDataset::query_stream(const string &sql, const BindList &params) {
+  if(!handle()) throw DbErrors("No Database Connection");
+
+  close();
+
+  SqliteDatabase *sqlite = static_cast<SqliteDatabase*>(db);
+  if (db->setErr(sqlite->acquire_statement(sql.c_str(), &stream_stmt), sql.c_str()) != SQLITE_OK)
+    throw DbErrors(db->getErrorMsg());
+  sqlite->add_stream(this);
+
+  for (unsigned int i = 0; i < params.size(); i++)
+  {
+    if (db->setErr(bind_param(stream_stmt, i + 1, params[i]), sql.c_str()) != SQLITE_OK)
+    {
+      release_stream();
+      throw DbErrors(db->getErrorMsg());
+    }
+  }
+
+  // column headers
+  const unsigned int numColumns = sqlite3_column_count(stream_stmt);
+  result.record_header.resize(numColumns);
+  for (unsigned int i = 0; i < numColumns; i++)
+    result.record_header[i].name = sqlite3_column_name(stream_stmt, i);
+
+  // only the current row is held, and it is reused for every row that follows
+  stream_rows = 0;
+  step_stream();
+
+  active = true;
+  ds_state = dsSelect;
+  this->first();
+  return true;
+}
+
 void SqliteDataset::open(const string &sql) {
   set_select_sql(sql);
   open();
@@ -722,6 +957,8 @@ void SqliteDataset::open() {
 
 
 void SqliteDataset::close() {
+  release_stream();
+  stream_rows = -1;
   Dataset::close();
   result.clear();
   edit_object->clear();
@@ -742,6 +979,8 @@ void SqliteDataset::cancel() {
 
 
 int SqliteDataset::num_rows() {
+  if (stream_rows >= 0)
+    return stream_rows;
   return result.records.size();
 }
 
@@ -757,21 +996,38 @@ bool SqliteDataset::bof() {
 
 
 void SqliteDataset::first() {
+  if (stream_rows > 1)
+    throw DbErrors("Can't rewind a streaming query");
   Dataset::first();
   this->fill_fields();
 }
 
 void SqliteDataset::last() {
+  if (stream_rows >= 0)
+    throw DbErrors("Can't seek in a streaming query");
   Dataset::last();
   fill_fields();
 }
 
 void SqliteDataset::prev(void) {
+  if (stream_rows >= 0)
+    throw DbErrors("Can't seek in a streaming query");
   Dataset::prev();
   fill_fields();
 }
 
 void SqliteDataset::next(void) {
+  if (stream_rows >= 0)
+  {
+    if (ds_state != dsSelect || feof)
+      return;
+    fbof = false;
+    if (stream_stmt && step_stream())
+      fill_fields();
+    else
+      feof = true;
+    return;
+  }
   Dataset::next();
   if (!eof()) 
       fill_fields();
@@ -779,6 +1035,10 @@ void SqliteDataset::next(void) {
 
 void SqliteDataset::free_row(void)
 {
+  // the single row of a streaming query is reused
+  if (stream_rows >= 0)
+    return;
+
   if (frecno < 0 || (unsigned int)frecno >= result.records.size())
     return;
 
@@ -791,6 +1051,8 @@ void SqliteDataset::free_row(void)
 }
 
 bool SqliteDataset::seek(int pos) {
+  if (stream_rows >= 0)
+    throw DbErrors("Can't seek in a streaming query");
   if (ds_state == dsSelect) {
     Dataset::seek(pos);
     fill_fields();
@@ -30,6 +30,8 @@
 #define _SQLITEDATASET_H
 
 #include <stdio.h>
+#include <list>
+#include <set>
 #include "dataset.h"
 #include <sqlite3.h>
 
@@ -39,6 +41,8 @@ namespace dbiplus {
        class 'SqliteDatabase' connects with Sqlite-server
 
 ******************************************************************/
+class SqliteDataset;
+
 class SqliteDatabase: public Database {
 protected:
 /* connect descriptor */
@@ -46,6 +50,12 @@ protected:
   bool _in_transaction;
   int last_err;
 
+/* prepared statements not in use, most recently used first */
+  typedef std::list<std::pair<std::string, sqlite3_stmt*> > StatementCache;
+  StatementCache stmt_cache;
+/* datasets with an open query_stream(), their statements are finalized on disconnect */
+  std::set<SqliteDataset*> streams;
+
 public:
 /* default constructor */
   SqliteDatabase();
@@ -97,6 +107,20 @@ public:
 
   bool in_transaction() {return _in_transaction;}; 	
 
+/* virtual methods for sorting */
+  virtual std::string naturalCollation() const;
+
+/* takes a prepared statement for sql out of the statement cache, preparing it if it isn't cached.
+   Returns the sqlite result code. The statement must be handed back with release_statement() */
+  int acquire_statement(const char *sql, sqlite3_stmt **stmt);
+/* resets a statement and puts it back into the statement cache */
+  void release_statement(sqlite3_stmt *stmt);
+/* finalizes all cached statements */
+  void clear_statement_cache();
+/* tracks the datasets holding a statement outside the cache */
+  void add_stream(SqliteDataset *ds) { streams.insert(ds); }
+  void remove_stream(SqliteDataset *ds) { streams.erase(ds); }
+
 };
 
 
@@ -128,6 +152,19 @@ protected:
 /* Changing field values during dataset navigation */
   virtual void free_row();  // free the memory allocated for the current row
 
+/* statement of an open query_stream(), NULL otherwise */
+  sqlite3_stmt *stream_stmt;
+/* rows read from stream_stmt so far */
+  int stream_rows;
+/* reads the next row of stream_stmt into the current record, returns false at the end */
+  bool step_stream();
+/* hands stream_stmt back to the database */
+  void release_stream();
+/* finalizes stream_stmt when the database disconnects, the stream ends at the current row */
+  void finalize_stream();
+
+  friend class SqliteDatabase;
+
 public:
 /* constructor */
   SqliteDataset();
@@ -150,6 +187,7 @@ or insert() operations default = false) */
 /* as open, but with our query exept Sql */
   virtual bool query(const char *query);
   virtual bool query(const std::string &query);
+  virtual bool query_stream(const std::string &sql, const BindList &params = BindList());
 /* func. closes a query */
   virtual void close(void);
 /* Cancel changes, made in insert or edit states of dataset */
@@ -18,6 +18,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "guilib/LocalizeStrings.h"
 #include "settings/AdvancedSettings.h"
 #include "settings/Settings.h"
@@ -38,6 +40,11 @@ using namespace PVR;
 using namespace EPG;
 using namespace std;
 
+static bool SortTagsByStart(const CEpgInfoTagPtr &left, const CEpgInfoTagPtr &right)
+{
+  return left->StartAsUTC() < right->StartAsUTC();
+}
+
 CEpg::CEpg(int iEpgID, const CStdString &strName /* = "" */, const CStdString &strScraperName /* = "" */, bool bLoadedFromDb /* = false */) :
     m_bChanged(!bLoadedFromDb),
     m_bTagsChanged(false),
@@ -99,6 +106,7 @@ CEpg &CEpg::operator =(const CEpg &right)
   {
     CEpgInfoTagPtr EITPtr (new CEpgInfoTag(*it->second));
     m_tags.insert(make_pair(it->first, EITPtr));
+    m_searchIndex.Index(EITPtr);
   }
 
   return *this;
@@ -158,6 +166,7 @@ void CEpg::Clear(void)
 {
   CSingleLock lock(m_critSection);
   m_tags.clear();
+  m_searchIndex.Clear();
 }
 
 void CEpg::Cleanup(void)
@@ -178,6 +187,7 @@ void CEpg::Cleanup(const CDateTime &Time)
         m_nowActiveStart.SetValid(false);
 
       it->second->ClearTimer();
+      m_searchIndex.Remove(it->second);
       m_tags.erase(it++);
     }
   }
@@ -330,6 +340,7 @@ void CEpg::AddEntry(const CEpgInfoTag &tag)
     newTag->SetPVRChannel(m_pvrChannel);
     newTag->m_epg          = this;
     newTag->m_bChanged     = false;
+    m_searchIndex.Index(newTag);
   }
 }
 
@@ -355,6 +366,7 @@ bool CEpg::UpdateEntry(const CEpgInfoTag &tag, bool bUpdateDatabase /* = false *
   infoTag->Update(tag, bNewTag);
   infoTag->m_epg          = this;
   infoTag->m_pvrChannel   = m_pvrChannel;
+  m_searchIndex.Index(infoTag);
 
   if (bUpdateDatabase)
     m_changedTags.insert(make_pair(infoTag->UniqueBroadcastID(), infoTag));
@@ -522,10 +534,34 @@ int CEpg::Get(CFileItemList &results, const EpgSearchFilter &filter) const
 
   CSingleLock lock(m_critSection);
 
-  for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+  /* locked channels show placeholders instead of the texts that were indexed */
+  vector<CEpgInfoTagPtr> candidates;
+  if ((!m_pvrChannel || !m_pvrChannel->IsLocked()) && m_searchIndex.GetCandidates(filter, candidates))
+  {
+    /* only check the tags containing the search term or genre, in the order of the table */
+    sort(candidates.begin(), candidates.end(), SortTagsByStart);
+    for (vector<CEpgInfoTagPtr>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+    {
+      if (filter.FilterEntry(**it))
+        results.Add(CFileItemPtr(new CFileItem(**it)));
+    }
+  }
+  else
   {
-    if (filter.FilterEntry(*it->second))
-      results.Add(CFileItemPtr(new CFileItem(*it->second)));
+    /* only check the tags starting within the filter's period. it's in local time, so allow for a different offset */
+    map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin();
+    if (filter.m_startDateTime.IsValid())
+      it = m_tags.lower_bound(filter.m_startDateTime.GetAsUTCDateTime() - CDateTimeSpan(1, 0, 0, 0));
+
+    CDateTime lastStart;
+    if (filter.m_endDateTime.IsValid())
+      lastStart = filter.m_endDateTime.GetAsUTCDateTime() + CDateTimeSpan(1, 0, 0, 0);
+
+    for (; it != m_tags.end() && (!lastStart.IsValid() || it->first <= lastStart); it++)
+    {
+      if (filter.FilterEntry(*it->second))
+        results.Add(CFileItemPtr(new CFileItem(*it->second)));
+    }
   }
 
   return results.Size() - iInitialSize;
@@ -626,6 +662,7 @@ bool CEpg::FixOverlappingEvents(bool bUpdateDb /* = false */)
         m_nowActiveStart.SetValid(false);
 
       it->second->ClearTimer();
+      m_searchIndex.Remove(it->second);
       m_tags.erase(it++);
     }
     else if (previousTag->EndAsUTC() > currentTag->StartAsUTC())
@@ -26,6 +26,7 @@
 
 #include "EpgInfoTag.h"
 #include "EpgSearchFilter.h"
+#include "EpgSearchIndex.h"
 #include "utils/Observer.h"
 #include "pvr/channels/PVRChannel.h"
 
@@ -340,6 +341,7 @@ namespace EPG
     bool IsRemovableTag(const EPG::CEpgInfoTag &tag) const;
 
     std::map<CDateTime, CEpgInfoTagPtr> m_tags;
+    CEpgSearchIndex                     m_searchIndex;     /*!< the words and genres of the tags in m_tags */
     std::map<int, CEpgInfoTagPtr>       m_changedTags;
     std::map<int, CEpgInfoTagPtr>       m_deletedTags;
     bool                                m_bChanged;        /*!< true if anything changed that needs to be persisted, false otherwise */
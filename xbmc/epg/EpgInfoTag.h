@@ -43,6 +43,7 @@ namespace EPG
   {
     friend class CEpg;
     friend class CEpgDatabase;
+    friend class CEpgSearchIndex;
     friend class PVR::CPVRTimerInfoTag;
 
   public:
@@ -0,0 +1,308 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include "threads/SingleLock.h"
+#include "utils/StringUtils.h"
+#include "utils/TextSearch.h"
+
+#include "EpgSearchIndex.h"
+#include "EpgSearchFilter.h"
+
+using namespace std;
+using namespace EPG;
+
+/* everything but ascii letters and digits separates words, multi-byte characters are part of them */
+static inline bool IsWordCharacter(char c)
+{
+  return (c & 0x80) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+/* narrows down the slots found so far to those in "other" */
+static void Restrict(vector<unsigned int> &slots, bool &bNarrowed, const vector<unsigned int> &other)
+{
+  if (!bNarrowed)
+  {
+    slots = other;
+    bNarrowed = true;
+    return;
+  }
+
+  vector<unsigned int> intersection;
+  set_intersection(slots.begin(), slots.end(), other.begin(), other.end(), back_inserter(intersection));
+  slots.swap(intersection);
+}
+
+CEpgSearchIndex::CEpgSearchIndex(void)
+{
+}
+
+void CEpgSearchIndex::GetWords(const std::string &strText, std::vector<std::string> &words)
+{
+  /* lower case the same way CTextSearch does */
+  CStdString strLower(strText);
+  StringUtils::ToLower(strLower);
+
+  size_t iStart(0);
+  while (iStart < strLower.size())
+  {
+    while (iStart < strLower.size() && !IsWordCharacter(strLower[iStart]))
+      iStart++;
+
+    size_t iEnd(iStart);
+    while (iEnd < strLower.size() && IsWordCharacter(strLower[iEnd]))
+      iEnd++;
+
+    if (iEnd > iStart)
+      words.push_back(strLower.substr(iStart, iEnd - iStart));
+    iStart = iEnd;
+  }
+}
+
+void CEpgSearchIndex::Index(const CEpgInfoTagPtr &tag)
+{
+  if (!tag)
+    return;
+
+  unsigned int iSlot;
+  map<const CEpgInfoTag *, unsigned int>::const_iterator it = m_slots.find(tag.get());
+  if (it != m_slots.end())
+  {
+    iSlot = it->second;
+    Unindex(iSlot);
+  }
+  else if (!m_freeSlots.empty())
+  {
+    iSlot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    m_slots.insert(make_pair(tag.get(), iSlot));
+  }
+  else
+  {
+    iSlot = m_entries.size();
+    m_entries.push_back(Entry());
+    m_slots.insert(make_pair(tag.get(), iSlot));
+  }
+
+  Entry &entry = m_entries[iSlot];
+  entry.tag = tag;
+
+  /* the texts EpgSearchFilter::MatchSearchTerm() searches, as they were set */
+  vector<string> words;
+  {
+    CSingleLock lock(tag->m_critSection);
+    entry.iGenreType = tag->m_iGenreType;
+    entry.bUntitled  = tag->m_strTitle.empty();
+    GetWords(tag->m_strTitle, words);
+    GetWords(tag->m_strPlotOutline, words);
+  }
+
+  Insert(m_genres[entry.iGenreType], iSlot);
+  if (entry.bUntitled)
+    Insert(m_untitled, iSlot);
+
+  for (vector<string>::const_iterator itWord = words.begin(); itWord != words.end(); itWord++)
+  {
+    unsigned int iWordId;
+    map<string, unsigned int>::const_iterator itId = m_wordIds.find(*itWord);
+    if (itId != m_wordIds.end())
+      iWordId = itId->second;
+    else
+    {
+      iWordId = m_words.size();
+      m_words.push_back(*itWord);
+      m_postings.push_back(Postings());
+      m_wordIds.insert(make_pair(*itWord, iWordId));
+    }
+    entry.words.push_back(iWordId);
+  }
+
+  sort(entry.words.begin(), entry.words.end());
+  entry.words.erase(unique(entry.words.begin(), entry.words.end()), entry.words.end());
+  for (vector<unsigned int>::const_iterator itWord = entry.words.begin(); itWord != entry.words.end(); itWord++)
+    Insert(m_postings[*itWord], iSlot);
+}
+
+void CEpgSearchIndex::Remove(const CEpgInfoTagPtr &tag)
+{
+  if (!tag)
+    return;
+
+  map<const CEpgInfoTag *, unsigned int>::iterator it = m_slots.find(tag.get());
+  if (it == m_slots.end())
+    return;
+
+  unsigned int iSlot = it->second;
+  Unindex(iSlot);
+  m_entries[iSlot].tag.reset();
+  m_freeSlots.push_back(iSlot);
+  m_slots.erase(it);
+}
+
+void CEpgSearchIndex::Clear(void)
+{
+  m_entries.clear();
+  m_freeSlots.clear();
+  m_slots.clear();
+  m_words.clear();
+  m_wordIds.clear();
+  m_postings.clear();
+  m_genres.clear();
+  m_untitled.clear();
+}
+
+void CEpgSearchIndex::Unindex(unsigned int iSlot)
+{
+  Entry &entry = m_entries[iSlot];
+
+  for (vector<unsigned int>::const_iterator it = entry.words.begin(); it != entry.words.end(); it++)
+    Erase(m_postings[*it], iSlot);
+  entry.words.clear();
+
+  map<int, Postings>::iterator itGenre = m_genres.find(entry.iGenreType);
+  if (itGenre != m_genres.end())
+  {
+    Erase(itGenre->second, iSlot);
+    if (itGenre->second.empty())
+      m_genres.erase(itGenre);
+  }
+
+  if (entry.bUntitled)
+    Erase(m_untitled, iSlot);
+  entry.bUntitled = false;
+}
+
+bool CEpgSearchIndex::GetTermCandidates(const std::string &strTerm, Postings &slots) const
+{
+  /* the longest word of the term is the most selective one */
+  vector<string> words;
+  GetWords(strTerm, words);
+
+  string strLongest;
+  for (vector<string>::const_iterator it = words.begin(); it != words.end(); it++)
+  {
+    if (it->size() > strLongest.size())
+      strLongest = *it;
+  }
+
+  /* a term without words can be anywhere */
+  if (strLongest.empty())
+    return false;
+
+  for (unsigned int iWordId = 0; iWordId < m_words.size(); iWordId++)
+  {
+    if (!m_postings[iWordId].empty() && m_words[iWordId].find(strLongest) != string::npos)
+      slots.insert(slots.end(), m_postings[iWordId].begin(), m_postings[iWordId].end());
+  }
+
+  sort(slots.begin(), slots.end());
+  slots.erase(unique(slots.begin(), slots.end()), slots.end());
+  return true;
+}
+
+bool CEpgSearchIndex::GetCandidates(const EpgSearchFilter &filter, std::vector<CEpgInfoTagPtr> &candidates) const
+{
+  bool bNarrowed(false);
+  Postings slots;
+
+  if (filter.m_iGenreType != EPG_SEARCH_UNSET && !filter.m_bIncludeUnknownGenres)
+  {
+    map<int, Postings>::const_iterator it = m_genres.find(filter.m_iGenreType);
+    Restrict(slots, bNarrowed, it != m_genres.end() ? it->second : Postings());
+  }
+
+  if (!filter.m_strSearchTerm.empty())
+  {
+    CTextSearch search(filter.m_strSearchTerm, filter.m_bIsCaseSensitive, SEARCH_DEFAULT_OR);
+    bool bTextNarrowed(false);
+    Postings textSlots;
+
+    /* all of the AND terms have to be found */
+    const vector<CStdString> &andTerms = search.GetAndTerms();
+    for (vector<CStdString>::const_iterator it = andTerms.begin(); it != andTerms.end(); it++)
+    {
+      Postings termSlots;
+      if (GetTermCandidates(*it, termSlots))
+        Restrict(textSlots, bTextNarrowed, termSlots);
+    }
+
+    /* and at least one of the OR terms. NOT terms can't narrow anything down */
+    const vector<CStdString> &orTerms = search.GetOrTerms();
+    if (!orTerms.empty())
+    {
+      Postings orSlots;
+      bool bAnywhere(false);
+      for (vector<CStdString>::const_iterator it = orTerms.begin(); it != orTerms.end() && !bAnywhere; it++)
+      {
+        Postings termSlots;
+        if (!GetTermCandidates(*it, termSlots))
+          bAnywhere = true;
+        else
+        {
+          Postings merged;
+          set_union(orSlots.begin(), orSlots.end(), termSlots.begin(), termSlots.end(), back_inserter(merged));
+          orSlots.swap(merged);
+        }
+      }
+
+      if (!bAnywhere)
+        Restrict(textSlots, bTextNarrowed, orSlots);
+    }
+
+    /* tags without a title are shown and searched with a placeholder title */
+    if (bTextNarrowed)
+    {
+      Postings merged;
+      set_union(textSlots.begin(), textSlots.end(), m_untitled.begin(), m_untitled.end(), back_inserter(merged));
+      Restrict(slots, bNarrowed, merged);
+    }
+  }
+
+  if (!bNarrowed)
+    return false;
+
+  candidates.reserve(candidates.size() + slots.size());
+  for (Postings::const_iterator it = slots.begin(); it != slots.end(); it++)
+    candidates.push_back(m_entries[*it].tag);
+
+  return true;
+}
+
+void CEpgSearchIndex::Insert(Postings &postings, unsigned int iSlot)
+{
+  /* slots are mostly handed out in ascending order */
+  if (postings.empty() || postings.back() < iSlot)
+    postings.push_back(iSlot);
+  else
+  {
+    Postings::iterator it = lower_bound(postings.begin(), postings.end(), iSlot);
+    if (it == postings.end() || *it != iSlot)
+      postings.insert(it, iSlot);
+  }
+}
+
+void CEpgSearchIndex::Erase(Postings &postings, unsigned int iSlot)
+{
+  Postings::iterator it = lower_bound(postings.begin(), postings.end(), iSlot);
+  if (it != postings.end() && *it == iSlot)
+    postings.erase(it);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "EpgInfoTag.h"
+
+namespace EPG
+{
+  struct EpgSearchFilter;
+
+  /** Index of the words and genres of the tags in an EPG table */
+
+  /*!
+   * The search term of an EpgSearchFilter is matched as a substring of the
+   * title or plot outline of a tag. Every word of a search term lies within
+   * a word of a matching text, so the tags containing a word with the longest
+   * word of each term in it are the only tags that can match. The index finds
+   * those without looking at any of the other tags, the filter still decides
+   * which of them match.
+   *
+   * Tags are added again whenever their contents change and removed when they
+   * leave the table. The index isn't locked, the table it belongs to does that.
+   * Tags of parental locked channels are searched with placeholder texts, the
+   * table doesn't use the index for those.
+   */
+  class CEpgSearchIndex
+  {
+  public:
+    CEpgSearchIndex(void);
+
+    /*!
+     * @brief Add a tag to the index or index its current contents again.
+     * @param tag The tag.
+     */
+    void Index(const CEpgInfoTagPtr &tag);
+
+    /*!
+     * @brief Remove a tag from the index.
+     * @param tag The tag.
+     */
+    void Remove(const CEpgInfoTagPtr &tag);
+
+    /*!
+     * @brief Remove all tags from the index.
+     */
+    void Clear(void);
+
+    /*!
+     * @brief The tags that may match a filter, in no particular order.
+     * @param filter The filter.
+     * @param candidates The tags that may match.
+     * @return False if the index can't narrow down the filter and every tag has to be checked, true otherwise.
+     */
+    bool GetCandidates(const EpgSearchFilter &filter, std::vector<CEpgInfoTagPtr> &candidates) const;
+
+    /*!
+     * @return The number of indexed tags.
+     */
+    size_t Size(void) const { return m_slots.size(); }
+
+    /*!
+     * @brief Split a text into the words the index is made of.
+     * @param strText The text.
+     * @param words The lower case words of the text.
+     */
+    static void GetWords(const std::string &strText, std::vector<std::string> &words);
+
+  private:
+    typedef std::vector<unsigned int> Postings; /*!< sorted slots of the tags */
+
+    struct Entry
+    {
+      CEpgInfoTagPtr            tag;
+      std::vector<unsigned int> words;
+      int                       iGenreType;
+      bool                      bUntitled;
+    };
+
+    void Unindex(unsigned int iSlot);
+    bool GetTermCandidates(const std::string &strTerm, Postings &slots) const;
+
+    static void Insert(Postings &postings, unsigned int iSlot);
+    static void Erase(Postings &postings, unsigned int iSlot);
+
+    std::vector<Entry>                       m_entries;   /*!< the indexed tags, by slot */
+    std::vector<unsigned int>                m_freeSlots; /*!< slots of removed tags */
+    std::map<const CEpgInfoTag *, unsigned int> m_slots;  /*!< the slot of each tag */
+    std::vector<std::string>                 m_words;     /*!< every word seen, by id */
+    std::map<std::string, unsigned int>      m_wordIds;   /*!< the id of each word */
+    std::vector<Postings>                    m_postings;  /*!< the tags containing each word, by id */
+    std::map<int, Postings>                  m_genres;    /*!< the tags of each genre type */
+    Postings                                 m_untitled;  /*!< the tags without a title */
+  };
+}
@@ -351,38 +351,32 @@ void CGUIEPGGridContainer::ProcessProgrammeGrid(unsigned int currentTime, CDirty
   posB += DrawOffsetB;
 
   int channel = chanOffset;
+  CGUIListItemPtr focusedItem = m_gridLayout.GetListItem(m_channelOffset + m_channelCursor, m_blockOffset + m_blockCursor);
 
   while (posB < endB && !m_channelItems.empty())
   {
-    if (channel >= (int)m_channelItems.size())
+    if (channel >= (int)m_channelItems.size() || channel >= m_gridLayout.Rows())
       break;
 
     // Free memory not used on screen
     FreeProgrammeMemory(channel, blockOffset - cacheBeforeProgramme, blockOffset + m_programmesPerPage + 1 + cacheAfterProgramme);
 
-    int block = blockOffset;
     float posA2 = posA;
 
-    CGUIListItemPtr item = m_gridIndex[channel][block].item;
-    if (blockOffset > 0 && item == m_gridIndex[channel][blockOffset-1].item)
-    {
-      /* first program starts before current view */
-      int startBlock = blockOffset - 1;
-      while (startBlock >= 0 && m_gridIndex[channel][startBlock].item == item)
-        startBlock--;
-
-      block = startBlock + 1;
-      int missingSection = blockOffset - block;
-      posA2 -= missingSection * m_blockSize;
-    }
+    /* first program may start before current view */
+    std::vector<GridItemsPtr> &row = m_gridLayout.GetRow(channel);
+    int index = m_gridLayout.Find(channel, std::max(blockOffset, 0));
+    if (index >= 0)
+      posA2 -= (blockOffset - row[index].startBlock) * m_blockSize;
 
-    while (posA2 < endA && !m_programmeItems.empty())   // FOR EACH ITEM ///////////////
+    while (index >= 0 && index < (int)row.size() && posA2 < endA && !m_programmeItems.empty())   // FOR EACH ITEM ///////////////
     {
-      item = m_gridIndex[channel][block].item;
+      GridItemsPtr &gridItem = row[index++];
+      CGUIListItemPtr item = gridItem.item;
       if (!item || !item.get()->IsFileItem())
         break;
 
-      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == m_gridIndex[m_channelOffset + m_channelCursor][m_blockOffset + m_blockCursor].item);
+      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == focusedItem);
 
       // calculate the size to truncate if item is out of grid view
       float truncateSize = 0;
@@ -393,13 +387,12 @@ void CGUIEPGGridContainer::ProcessProgrammeGrid(unsigned int currentTime, CDirty
       }
 
       // truncate item's width
-      m_gridIndex[channel][block].width = m_gridIndex[channel][block].originWidth - truncateSize;
+      gridItem.width = gridItem.originWidth - truncateSize;
 
-      ProcessItem(posA2, posB, item.get(), m_lastChannel, focused, m_programmeLayout, m_focusedProgrammeLayout, currentTime, dirtyregions, m_gridIndex[channel][block].width);
+      ProcessItem(posA2, posB, item.get(), m_lastChannel, focused, m_programmeLayout, m_focusedProgrammeLayout, currentTime, dirtyregions, gridItem.width);
 
       // increment our X position
-      posA2 += m_gridIndex[channel][block].width; // assumes focused & unfocused layouts have equal length
-      block += (int)(m_gridIndex[channel][block].originWidth / m_blockSize);
+      posA2 += gridItem.width; // assumes focused & unfocused layouts have equal length
     }
 
     // increment our Y position
@@ -438,34 +431,28 @@ void CGUIEPGGridContainer::RenderProgrammeGrid()
   float focusedPosX = 0;
   float focusedPosY = 0;
   CGUIListItemPtr focusedItem;
+  CGUIListItemPtr selectedItem = m_gridLayout.GetListItem(m_channelOffset + m_channelCursor, m_blockOffset + m_blockCursor);
   while (posB < endB && !m_channelItems.empty())
   {
-    if (channel >= (int)m_channelItems.size())
+    if (channel >= (int)m_channelItems.size() || channel >= m_gridLayout.Rows())
       break;
 
-    int block = blockOffset;
     float posA2 = posA;
 
-    CGUIListItemPtr item = m_gridIndex[channel][block].item;
-    if (blockOffset > 0 && item == m_gridIndex[channel][blockOffset-1].item)
-    {
-      /* first program starts before current view */
-      int startBlock = blockOffset - 1;
-      while (startBlock >= 0 && m_gridIndex[channel][startBlock].item == item)
-        startBlock--;
-
-      block = startBlock + 1;
-      int missingSection = blockOffset - block;
-      posA2 -= missingSection * m_blockSize;
-    }
+    /* first program may start before current view */
+    std::vector<GridItemsPtr> &row = m_gridLayout.GetRow(channel);
+    int index = m_gridLayout.Find(channel, std::max(blockOffset, 0));
+    if (index >= 0)
+      posA2 -= (blockOffset - row[index].startBlock) * m_blockSize;
 
-    while (posA2 < endA && !m_programmeItems.empty())   // FOR EACH ITEM ///////////////
+    while (index >= 0 && index < (int)row.size() && posA2 < endA && !m_programmeItems.empty())   // FOR EACH ITEM ///////////////
     {
-      item = m_gridIndex[channel][block].item;
+      GridItemsPtr &gridItem = row[index++];
+      CGUIListItemPtr item = gridItem.item;
       if (!item || !item.get()->IsFileItem())
         break;
 
-      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == m_gridIndex[m_channelOffset + m_channelCursor][m_blockOffset + m_blockCursor].item);
+      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == selectedItem);
 
       // reset to grid start position if first item is out of grid view
       if (posA2 < posA)
@@ -484,8 +471,7 @@ void CGUIEPGGridContainer::RenderProgrammeGrid()
       }
 
       // increment our X position
-      posA2 += m_gridIndex[channel][block].width; // assumes focused & unfocused layouts have equal length
-      block += (int)(m_gridIndex[channel][block].originWidth / m_blockSize);
+      posA2 += gridItem.width; // assumes focused & unfocused layouts have equal length
     }
 
     // increment our Y position
@@ -768,12 +754,6 @@ bool CGUIEPGGridContainer::OnMessage(CGUIMessage& message)
           }
 
           ClearGridIndex();
-          m_gridIndex.reserve(m_channelItems.size());
-          for (unsigned int i = 0; i < m_channelItems.size(); i++)
-          {
-            std::vector<GridItemsPtr> blocks(MAXBLOCKS);
-            m_gridIndex.push_back(blocks);
-          }
 
           FreeItemsMemory();
           UpdateLayout();
@@ -838,90 +818,17 @@ void CGUIEPGGridContainer::UpdateItems()
     return;
   }
 
-  CDateTimeSpan blockDuration;
-  blockDuration.SetDateTimeSpan(0, 0, MINSPERBLOCK, 0);
-
   long tick(XbmcThreads::SystemClockMillis());
 
+  /* rows are laid out when they're shown */
+  m_gridLayout.Initialize(m_gridStart, m_blocks, MINSPERBLOCK, m_blockSize, m_channelHeight);
   for (unsigned int row = 0; row < m_epgItemsPtr.size(); ++row)
   {
-    CDateTime gridCursor  = m_gridStart; //reset cursor for new channel
-    unsigned long progIdx = m_epgItemsPtr[row].start;
-    unsigned long lastIdx = m_epgItemsPtr[row].stop;
-    int iEpgId            = ((CFileItem *)m_programmeItems[progIdx].get())->GetEPGInfoTag()->EpgID();
-
-    /** FOR EACH BLOCK **********************************************************************/
-
-    for (int block = 0; block < m_blocks; block++)
-    {
-      while (progIdx <= lastIdx)
-      {
-        CGUIListItemPtr item = m_programmeItems[progIdx];
-        const CEpgInfoTag* tag = ((CFileItem *)item.get())->GetEPGInfoTag();
-        if (tag == NULL)
-        {
-          progIdx++;
-          continue;
-        }
-
-        if (tag->EpgID() != iEpgId || gridCursor < tag->StartAsUTC() || m_gridEnd <= tag->StartAsUTC())
-          break;
-
-        if (gridCursor < tag->EndAsUTC())
-        {
-          m_gridIndex[row][block].item = item;
-          break;
-        }
-        
-        progIdx++;
-      }
-
-      gridCursor += blockDuration;
-    }
-
-    /** FOR EACH BLOCK **********************************************************************/
-    int itemSize = 1; // size of the programme in blocks
-    int savedBlock = 0;
-
-    for (int block = 0; block < m_blocks; block++)
-    {
-      CGUIListItemPtr item = m_gridIndex[row][block].item;
-
-      if (item != m_gridIndex[row][block+1].item)
-      {
-        if (!item)
-        {
-          CEpgInfoTag gapTag;
-          CFileItemPtr gapItem(new CFileItem(gapTag));
-          for (int i = block ; i > block - itemSize; i--)
-          {
-            m_gridIndex[row][i].item = gapItem;
-          }
-        }
-        else
-        {
-          const CEpgInfoTag* tag = ((CFileItem *)item.get())->GetEPGInfoTag();
-          m_gridIndex[row][savedBlock].item->SetProperty("GenreType", tag->GenreType());
-        }
-
-        m_gridIndex[row][savedBlock].originWidth = itemSize*m_blockSize;
-        m_gridIndex[row][savedBlock].originHeight = m_channelHeight;
-
-        m_gridIndex[row][savedBlock].width = m_gridIndex[row][savedBlock].originWidth;
-        m_gridIndex[row][savedBlock].height = m_gridIndex[row][savedBlock].originHeight;
-
-        itemSize = 1;
-        savedBlock = block+1;
-      }
-      else
-      {
-        itemSize++;
-      }
-    }
+    std::vector<CGUIListItemPtr> programmes(m_programmeItems.begin() + m_epgItemsPtr[row].start,
+                                            m_programmeItems.begin() + m_epgItemsPtr[row].stop + 1);
+    m_gridLayout.AddRow(programmes);
   }
 
-  /******************************************* END ******************************************/
-
   CLog::Log(LOGDEBUG, "CGUIEPGGridContainer - %s completed successfully in %u ms", __FUNCTION__, (unsigned int)(XbmcThreads::SystemClockMillis()-tick));
 
   m_channels = (int)m_epgItemsPtr.size();
@@ -1006,13 +913,15 @@ void CGUIEPGGridContainer::OnDown()
 
 void CGUIEPGGridContainer::OnLeft()
 {
-  if (!m_gridIndex.empty() && m_item)
+  if (m_gridLayout.Rows() > 0 && m_item)
   {
     if (m_channelCursor + m_channelOffset >= 0 && m_blockOffset >= 0 &&
-        m_item->item != m_gridIndex[m_channelCursor + m_channelOffset][m_blockOffset].item)
+        m_item->item != m_gridLayout.GetListItem(m_channelCursor + m_channelOffset, m_blockOffset))
     {
       // this is not first item on page
-      m_item = GetPrevItem(m_channelCursor);
+      GridItemsPtr *prevItem = GetPrevItem(m_channelCursor);
+      if (prevItem)
+        m_item = prevItem;
       SetBlock(GetBlock(m_item->item, m_channelCursor));
 
       return;
@@ -1032,12 +941,14 @@ void CGUIEPGGridContainer::OnLeft()
 
 void CGUIEPGGridContainer::OnRight()
 {
-  if (!m_gridIndex.empty() && m_item)
+  if (m_gridLayout.Rows() > 0 && m_item)
   {
-    if (m_item->item != m_gridIndex[m_channelCursor + m_channelOffset][m_blocksPerPage + m_blockOffset - 1].item)
+    if (m_item->item != m_gridLayout.GetListItem(m_channelCursor + m_channelOffset, m_blocksPerPage + m_blockOffset - 1))
     {
       // this is not last item on page
-      m_item = GetNextItem(m_channelCursor);
+      GridItemsPtr *nextItem = GetNextItem(m_channelCursor);
+      if (nextItem)
+        m_item = nextItem;
       SetBlock(GetBlock(m_item->item, m_channelCursor));
 
       return;
@@ -1151,7 +1062,7 @@ bool CGUIEPGGridContainer::SelectItemFromPoint(const CPoint &point, bool justGri
   if (channelIndex >= m_channels || blockIndex >= m_blocks)
     return false;
   // bail if block isn't occupied
-  if (!m_gridIndex[channelIndex][blockIndex].item)
+  if (!m_gridLayout.GetListItem(channelIndex, blockIndex))
     return false;
 
   SetChannel(channel);
@@ -1286,13 +1197,13 @@ void CGUIEPGGridContainer::SetSelectedChannel(int channelIndex)
 
 int CGUIEPGGridContainer::GetSelectedItem() const
 {
-  if (m_gridIndex.empty() ||
+  if (m_gridLayout.Rows() == 0 ||
       m_epgItemsPtr.empty() ||
       m_channelCursor + m_channelOffset >= m_channels ||
       m_blockCursor + m_blockOffset >= m_blocks)
     return -1;
 
-  CGUIListItemPtr currentItem = m_gridIndex[m_channelCursor + m_channelOffset][m_blockCursor + m_blockOffset].item;
+  CGUIListItemPtr currentItem = m_gridLayout.GetListItem(m_channelCursor + m_channelOffset, m_blockCursor + m_blockOffset);
   if (!currentItem)
     return -1;
 
@@ -1379,9 +1290,9 @@ GridItemsPtr *CGUIEPGGridContainer::GetClosestItem(const int &channel)
   }
 
   if (right <= SHORTGAP && right <= left && m_blockCursor + right < m_blocksPerPage)
-    return &m_gridIndex[channel + m_channelOffset][m_blockCursor + right + m_blockOffset];
+    return m_gridLayout.GetItem(channel + m_channelOffset, m_blockCursor + right + m_blockOffset);
 
-  return &m_gridIndex[channel + m_channelOffset][m_blockCursor - left  + m_blockOffset];
+  return m_gridLayout.GetItem(channel + m_channelOffset, m_blockCursor - left  + m_blockOffset);
 }
 
 int CGUIEPGGridContainer::GetItemSize(GridItemsPtr *item)
@@ -1403,12 +1314,17 @@ int CGUIEPGGridContainer::GetBlock(const CGUIListItemPtr &item, const int &chann
 int CGUIEPGGridContainer::GetRealBlock(const CGUIListItemPtr &item, const int &channel)
 {
   int channelIndex = channel + m_channelOffset;
-  int block = 0;
+  if (channelIndex < 0 || channelIndex >= m_gridLayout.Rows())
+    return m_blocks;
 
-  while (m_gridIndex[channelIndex][block].item != item && block < m_blocks)
-    block++;
+  const std::vector<GridItemsPtr> &row = m_gridLayout.GetRow(channelIndex);
+  for (std::vector<GridItemsPtr>::const_iterator it = row.begin(); it != row.end(); ++it)
+  {
+    if (it->item == item)
+      return it->startBlock;
+  }
 
-  return block;
+  return m_blocks;
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetNextItem(const int &channel)
@@ -1418,12 +1334,13 @@ GridItemsPtr *CGUIEPGGridContainer::GetNextItem(const int &channel)
   if (channelIndex >= m_channels || blockIndex >= m_blocks)
     return NULL;
 
-  int i = m_blockCursor;
-
-  while (i < m_blocksPerPage && m_gridIndex[channelIndex][i + m_blockOffset].item == m_gridIndex[channelIndex][blockIndex].item)
-    i++;
+  GridItemsPtr *item = m_gridLayout.GetItem(channelIndex, blockIndex);
+  if (!item)
+    return NULL;
 
-  return &m_gridIndex[channelIndex][i + m_blockOffset];
+  /* the item after the current one, or the current one if it ends after the page */
+  int i = std::min(item->startBlock + item->blocks - m_blockOffset, m_blocksPerPage);
+  return m_gridLayout.GetItem(channelIndex, i + m_blockOffset);
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetPrevItem(const int &channel)
@@ -1433,12 +1350,13 @@ GridItemsPtr *CGUIEPGGridContainer::GetPrevItem(const int &channel)
   if (channelIndex >= m_channels || blockIndex >= m_blocks)
     return NULL;
 
-  int i = m_blockCursor;
-
-  while (i > 0 && m_gridIndex[channelIndex][i + m_blockOffset].item == m_gridIndex[channelIndex][blockIndex].item)
-    i--;
+  GridItemsPtr *item = m_gridLayout.GetItem(channelIndex, blockIndex);
+  if (!item)
+    return NULL;
 
-  return &m_gridIndex[channelIndex][i + m_blockOffset];
+  /* the item before the current one, or the current one if it starts before the page */
+  int i = std::max(item->startBlock - 1 - m_blockOffset, 0);
+  return m_gridLayout.GetItem(channelIndex, i + m_blockOffset);
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetItem(const int &channel)
@@ -1448,7 +1366,7 @@ GridItemsPtr *CGUIEPGGridContainer::GetItem(const int &channel)
   if (channelIndex >= m_channels || blockIndex >= m_blocks)
     return NULL;
 
-  return &m_gridIndex[channelIndex][blockIndex];
+  return m_gridLayout.GetItem(channelIndex, blockIndex);
 }
 
 void CGUIEPGGridContainer::SetFocus(bool focus)
@@ -1604,16 +1522,7 @@ CStdString CGUIEPGGridContainer::GetDescription() const
 
 void CGUIEPGGridContainer::ClearGridIndex(void)
 {
-  for (unsigned int i = 0; i < m_gridIndex.size(); i++)
-  {
-    for (int block = 0; block < m_blocks; block++)
-    {
-      if (m_gridIndex[i][block].item)
-        m_gridIndex[i][block].item.get()->ClearProperties();
-    }
-    m_gridIndex[i].clear();
-  }
-  m_gridIndex.clear();
+  m_gridLayout.Clear();
 }
 
 void CGUIEPGGridContainer::Reset()
@@ -1641,13 +1550,12 @@ void CGUIEPGGridContainer::GoToEnd()
   int blocksEnd = 0;   // the end block of the last epg element for the selected channel
   int blocksStart = 0; // the start block of the last epg element for the selected channel
   int blockOffset = 0; // the block offset to scroll to
-  for (int blockIndex = m_blocks; blockIndex >= 0 && (!blocksEnd || !blocksStart); blockIndex--)
+  int channelIndex = m_channelCursor + m_channelOffset;
+  if (channelIndex >= 0 && channelIndex < m_gridLayout.Rows() && !m_gridLayout.GetRow(channelIndex).empty())
   {
-    if (!blocksEnd && m_gridIndex[m_channelCursor + m_channelOffset][blockIndex].item != NULL)
-      blocksEnd = blockIndex;
-    if (blocksEnd && m_gridIndex[m_channelCursor + m_channelOffset][blocksEnd].item != 
-                     m_gridIndex[m_channelCursor + m_channelOffset][blockIndex].item)
-      blocksStart = blockIndex + 1;
+    const GridItemsPtr &last = m_gridLayout.GetRow(channelIndex).back();
+    blocksStart = last.startBlock;
+    blocksEnd   = last.startBlock + last.blocks - 1;
   }
   if (blocksEnd - blocksStart > m_blocksPerPage)
     blockOffset = blocksStart;
@@ -1834,37 +1742,30 @@ void CGUIEPGGridContainer::FreeProgrammeMemory(int channel, int keepStart, int k
 {
   if (keepStart < keepEnd)
   { // remove before keepStart and after keepEnd
+    if (channel < 0 || channel >= m_gridLayout.Rows())
+      return;
+
+    // every item is one interval of the row, so the items that are partially visible are kept
+    // and every other item is freed once
+    std::vector<GridItemsPtr> &row = m_gridLayout.GetRow(channel);
+
     if (keepStart > 0 && keepStart < m_blocks)
     {
-      // if item exist and block is not part of visible item
-      CGUIListItemPtr last = m_gridIndex[channel][keepStart].item;
-      for (int i = keepStart - 1 ; i > 0 ; i--)
+      int index = m_gridLayout.Find(channel, keepStart);
+      for (int i = index - 1; i >= 0; i--)
       {
-        if (m_gridIndex[channel][i].item && m_gridIndex[channel][i].item != last)
-        {
-          m_gridIndex[channel][i].item->FreeMemory();
-          // FreeMemory() is smart enough to not cause any problems when called multiple times on same item
-          // but we can make use of condition needed to not call FreeMemory() on item that is partially visible
-          // to avoid calling FreeMemory() multiple times on item that ocupy few blocks in a row
-          last = m_gridIndex[channel][i].item;
-        }
+        if (row[i].item)
+          row[i].item->FreeMemory();
       }
     }
 
     if (keepEnd > 0 && keepEnd < m_blocks)
     {
-      CGUIListItemPtr last = m_gridIndex[channel][keepEnd].item;
-      for (int i = keepEnd + 1 ; i < m_blocks ; i++)
+      int index = m_gridLayout.Find(channel, keepEnd);
+      for (int i = index + 1; index >= 0 && i < (int)row.size(); i++)
       {
-        // if item exist and block is not part of visible item
-        if (m_gridIndex[channel][i].item && m_gridIndex[channel][i].item != last)
-        {
-          m_gridIndex[channel][i].item->FreeMemory();
-          // FreeMemory() is smart enough to not cause any problems when called multiple times on same item
-          // but we can make use of condition needed to not call FreeMemory() on item that is partially visible
-          // to avoid calling FreeMemory() multiple times on item that ocupy few blocks in a row
-          last = m_gridIndex[channel][i].item;
-        }
+        if (row[i].item)
+          row[i].item->FreeMemory();
       }
     }
   }
@@ -25,21 +25,13 @@
 #include "guilib/GUIControl.h"
 #include "guilib/GUIListItemLayout.h"
 #include "guilib/IGUIContainer.h"
+#include "GUIEPGGridLayout.h"
 
 namespace EPG
 {
   #define MAXCHANNELS 20
   #define MAXBLOCKS   (16 * 24 * 60 / 5) //! 16 days of 5 minute blocks (14 days for upcoming data + 1 day for past data + 1 day for fillers)
 
-  struct GridItemsPtr
-  {
-    CGUIListItemPtr item;
-    float originWidth;
-    float originHeight;
-    float width;
-    float height;
-  };
-
   class CGUIEPGGridContainer : public IGUIContainer
   {
   public:
@@ -205,7 +197,7 @@ namespace EPG
 
     CGUITexture m_guiProgressIndicatorTexture;
 
-    std::vector<std::vector<GridItemsPtr> > m_gridIndex;
+    CGUIEPGGridLayout m_gridLayout;
     GridItemsPtr *m_item;
     CGUIListItem *m_lastItem;
     CGUIListItem *m_lastChannel;
@@ -0,0 +1,215 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "FileItem.h"
+#include "epg/EpgInfoTag.h"
+#include "utils/Variant.h"
+
+#include "GUIEPGGridLayout.h"
+
+using namespace EPG;
+using namespace std;
+
+CGUIEPGGridLayout::CGUIEPGGridLayout(void) :
+    m_iBlocks(0),
+    m_iMinutesPerBlock(1),
+    m_fBlockSize(0),
+    m_fRowHeight(0)
+{
+}
+
+CGUIEPGGridLayout::~CGUIEPGGridLayout(void)
+{
+}
+
+void CGUIEPGGridLayout::Initialize(const CDateTime &gridStart, int iBlocks, int iMinutesPerBlock, float fBlockSize, float fRowHeight)
+{
+  Clear();
+  m_gridStart        = gridStart;
+  m_iBlocks          = iBlocks;
+  m_iMinutesPerBlock = iMinutesPerBlock > 0 ? iMinutesPerBlock : 1;
+  m_fBlockSize       = fBlockSize;
+  m_fRowHeight       = fRowHeight;
+}
+
+void CGUIEPGGridLayout::Clear(void)
+{
+  for (vector<Row>::iterator row = m_rows.begin(); row != m_rows.end(); row++)
+  {
+    for (vector<GridItemsPtr>::iterator it = row->items.begin(); it != row->items.end(); it++)
+    {
+      if (it->item)
+        it->item->ClearProperties();
+    }
+  }
+  m_rows.clear();
+}
+
+void CGUIEPGGridLayout::AddRow(const std::vector<CGUIListItemPtr> &programmes)
+{
+  Row row;
+  row.programmes = programmes;
+  row.bLaidOut   = false;
+  m_rows.push_back(row);
+}
+
+int CGUIEPGGridLayout::LaidOutRows(void) const
+{
+  int iLaidOut(0);
+  for (vector<Row>::const_iterator it = m_rows.begin(); it != m_rows.end(); it++)
+  {
+    if (it->bLaidOut)
+      iLaidOut++;
+  }
+  return iLaidOut;
+}
+
+std::vector<GridItemsPtr> &CGUIEPGGridLayout::GetRow(int iRow)
+{
+  Row &row = m_rows[iRow];
+  if (!row.bLaidOut)
+    Layout(row);
+  return row.items;
+}
+
+int CGUIEPGGridLayout::Find(int iRow, int iBlock)
+{
+  if (iRow < 0 || iRow >= (int)m_rows.size() || iBlock < 0 || iBlock >= m_iBlocks)
+    return -1;
+
+  return Find(GetRow(iRow), iBlock);
+}
+
+GridItemsPtr *CGUIEPGGridLayout::GetItem(int iRow, int iBlock)
+{
+  int iIndex = Find(iRow, iBlock);
+  if (iIndex < 0)
+    return NULL;
+
+  return &m_rows[iRow].items[iIndex];
+}
+
+CGUIListItemPtr CGUIEPGGridLayout::GetListItem(int iRow, int iBlock) const
+{
+  if (iRow < 0 || iRow >= (int)m_rows.size() || iBlock < 0 || iBlock >= m_iBlocks)
+    return CGUIListItemPtr();
+
+  Row &row = m_rows[iRow];
+  if (!row.bLaidOut)
+    Layout(row);
+
+  int iIndex = Find(row.items, iBlock);
+  if (iIndex < 0)
+    return CGUIListItemPtr();
+
+  return row.items[iIndex].item;
+}
+
+void CGUIEPGGridLayout::Layout(Row &row) const
+{
+  row.items.clear();
+  row.bLaidOut = true;
+
+  int iNextBlock(0);
+  int iEpgId(-1);
+  for (vector<CGUIListItemPtr>::const_iterator it = row.programmes.begin(); it != row.programmes.end() && iNextBlock < m_iBlocks; it++)
+  {
+    const CEpgInfoTag *tag = ((CFileItem *)it->get())->GetEPGInfoTag();
+    if (tag == NULL)
+      continue;
+
+    /* a row shows the programmes of a single table */
+    if (it == row.programmes.begin())
+      iEpgId = tag->EpgID();
+    else if (tag->EpgID() != iEpgId)
+      break;
+
+    /* the blocks starting while the programme is on, unless an earlier programme took them */
+    int iStartBlock = max(iNextBlock, GetBlock(tag->StartAsUTC()));
+    int iEndBlock   = min(m_iBlocks, GetBlock(tag->EndAsUTC()));
+    if (iStartBlock >= m_iBlocks)
+      break;
+    if (iEndBlock <= iStartBlock)
+      continue;
+
+    if (iStartBlock > iNextBlock)
+    {
+      CEpgInfoTag gapTag;
+      CFileItemPtr gapItem(new CFileItem(gapTag));
+      Add(row, gapItem, iNextBlock, iStartBlock);
+    }
+
+    (*it)->SetProperty("GenreType", tag->GenreType());
+    Add(row, *it, iStartBlock, iEndBlock);
+    iNextBlock = iEndBlock;
+  }
+
+  if (iNextBlock < m_iBlocks)
+  {
+    CEpgInfoTag gapTag;
+    CFileItemPtr gapItem(new CFileItem(gapTag));
+    Add(row, gapItem, iNextBlock, m_iBlocks);
+  }
+}
+
+void CGUIEPGGridLayout::Add(Row &row, const CGUIListItemPtr &item, int iStartBlock, int iEndBlock) const
+{
+  GridItemsPtr gridItem;
+  gridItem.item         = item;
+  gridItem.startBlock   = iStartBlock;
+  gridItem.blocks       = iEndBlock - iStartBlock;
+  gridItem.originWidth  = gridItem.blocks * m_fBlockSize;
+  gridItem.originHeight = m_fRowHeight;
+  gridItem.width        = gridItem.originWidth;
+  gridItem.height       = gridItem.originHeight;
+  row.items.push_back(gridItem);
+}
+
+int CGUIEPGGridLayout::GetBlock(const CDateTime &time) const
+{
+  /* the first block that doesn't start before the time */
+  int iSeconds = (time - m_gridStart).GetSecondsTotal();
+  int iBlockSeconds = m_iMinutesPerBlock * 60;
+  if (iSeconds <= 0)
+    return iSeconds / iBlockSeconds;
+
+  return (iSeconds + iBlockSeconds - 1) / iBlockSeconds;
+}
+
+int CGUIEPGGridLayout::Find(const std::vector<GridItemsPtr> &items, int iBlock)
+{
+  /* the last item starting at or before the block */
+  int iLow(0), iHigh((int)items.size());
+  while (iLow < iHigh)
+  {
+    int iMiddle = (iLow + iHigh) / 2;
+    if (items[iMiddle].startBlock <= iBlock)
+      iLow = iMiddle + 1;
+    else
+      iHigh = iMiddle;
+  }
+
+  if (iLow == 0 || iBlock >= items[iLow - 1].startBlock + items[iLow - 1].blocks)
+    return -1;
+
+  return iLow - 1;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <vector>
+
+#include "XBDateTime.h"
+#include "guilib/GUIListItem.h"
+#include "guilib/IGUIContainer.h"
+
+namespace EPG
+{
+  struct GridItemsPtr
+  {
+    CGUIListItemPtr item;
+    float originWidth;
+    float originHeight;
+    float width;
+    float height;
+    int startBlock;   //! the first block the item covers
+    int blocks;       //! the number of blocks the item covers
+  };
+
+  /*!
+   * @brief Where the programmes of the EPG grid go
+   *
+   * Every row of the grid is a list of intervals of blocks, one for each
+   * programme and one for each gap between programmes, in the order of their
+   * start blocks. A block is found by a binary search of its row and the
+   * programmes following it are the next intervals.
+   *
+   * Rows are only laid out when they're first used, so binding a guide only
+   * costs the rows that are shown.
+   */
+  class CGUIEPGGridLayout
+  {
+  public:
+    CGUIEPGGridLayout(void);
+    virtual ~CGUIEPGGridLayout(void);
+
+    /*!
+     * @brief Start a new layout without any rows.
+     * @param gridStart The time the first block starts at, in UTC.
+     * @param iBlocks The number of blocks in each row.
+     * @param iMinutesPerBlock The duration of a block.
+     * @param fBlockSize The width of a block.
+     * @param fRowHeight The height of a row.
+     */
+    void Initialize(const CDateTime &gridStart, int iBlocks, int iMinutesPerBlock, float fBlockSize, float fRowHeight);
+
+    /*!
+     * @brief Remove all rows and clear the properties of the items that were laid out.
+     */
+    void Clear(void);
+
+    /*!
+     * @brief Add a row.
+     * @param programmes The items of the programmes of one EPG table, sorted by start time.
+     */
+    void AddRow(const std::vector<CGUIListItemPtr> &programmes);
+
+    int Rows(void) const { return (int)m_rows.size(); }
+    int Blocks(void) const { return m_iBlocks; }
+
+    /*!
+     * @return The number of rows that have been laid out.
+     */
+    int LaidOutRows(void) const;
+
+    /*!
+     * @brief The items of a row, laid out if that hasn't happened yet.
+     * @param iRow The row.
+     * @return The items, covering all blocks of the row.
+     */
+    std::vector<GridItemsPtr> &GetRow(int iRow);
+
+    /*!
+     * @brief Find the item covering a block.
+     * @param iRow The row.
+     * @param iBlock The block.
+     * @return The index of the item in GetRow(), or -1 if the block isn't in the grid.
+     */
+    int Find(int iRow, int iBlock);
+
+    /*!
+     * @brief Get the item covering a block.
+     * @param iRow The row.
+     * @param iBlock The block.
+     * @return The item, or NULL if the block isn't in the grid.
+     */
+    GridItemsPtr *GetItem(int iRow, int iBlock);
+
+    /*!
+     * @brief Get the list item covering a block.
+     * @param iRow The row.
+     * @param iBlock The block.
+     * @return The list item, or an empty pointer if the block isn't in the grid.
+     */
+    CGUIListItemPtr GetListItem(int iRow, int iBlock) const;
+
+  private:
+    struct Row
+    {
+      std::vector<CGUIListItemPtr> programmes;
+      std::vector<GridItemsPtr>    items;
+      bool                         bLaidOut;
+    };
+
+    void Layout(Row &row) const;
+    void Add(Row &row, const CGUIListItemPtr &item, int iStartBlock, int iEndBlock) const;
+    int GetBlock(const CDateTime &time) const;
+    static int Find(const std::vector<GridItemsPtr> &items, int iBlock);
+
+    mutable std::vector<Row> m_rows;  //! rows are laid out when they're looked at
+    CDateTime                m_gridStart;
+    int                      m_iBlocks;
+    int                      m_iMinutesPerBlock;
+    float                    m_fBlockSize;
+    float                    m_fRowHeight;
+  };
+}
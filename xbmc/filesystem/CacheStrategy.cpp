@@ -57,6 +57,16 @@ void CCacheStrategy::ClearEndOfInput()
   m_bEndOfInput = false;
 }
 
+int64_t CCacheStrategy::StartPrefetch(int64_t iFilePosition)
+{
+  return CACHE_RC_ERROR;
+}
+
+int64_t CCacheStrategy::EndPrefetch()
+{
+  return CachedDataEndPos();
+}
+
 CSimpleFileCache::CSimpleFileCache()
   : m_hCacheFileRead(NULL)
   , m_hCacheFileWrite(NULL)
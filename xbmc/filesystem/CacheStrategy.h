@@ -61,6 +61,23 @@ public:
   virtual int64_t CachedDataEndPos() = 0;
   virtual bool IsCachedPosition(int64_t iFilePosition) = 0;
 
+  /*!
+   \brief Direct the following writes to another position of the file, without moving the read position.
+   Lets the cache fill a region the reader is expected to seek to, e.g. the index at the end of a file.
+   \param iFilePosition position to cache data of.
+   \return the position the next write is expected for (the end of data already cached there),
+   CACHE_RC_ERROR if the strategy can't keep data away from the read position.
+   \sa EndPrefetch
+   */
+  virtual int64_t StartPrefetch(int64_t iFilePosition);
+
+  /*!
+   \brief Direct the following writes back behind the data being read.
+   \return the position the next write is expected for.
+   \sa StartPrefetch
+   */
+  virtual int64_t EndPrefetch();
+
   virtual CCacheStrategy *CreateNew() = 0;
 
   CEvent m_space;
@@ -27,18 +27,19 @@
 
 using namespace XFILE;
 
-CCircularCache::CCircularCache(size_t front, size_t back)
+CCircularCache::CCircularCache(size_t front, size_t back, unsigned int segments)
  : CCacheStrategy()
- , m_beg(0)
- , m_end(0)
+ , m_stamp(0)
+ , m_maxSegments(std::max(segments, 1U))
  , m_cur(0)
  , m_buf(NULL)
- , m_size(front + back)
+ , m_size((front + back + CIRCULAR_CACHE_BLOCK_SIZE - 1) / CIRCULAR_CACHE_BLOCK_SIZE * CIRCULAR_CACHE_BLOCK_SIZE)
  , m_size_back(back)
 #ifdef TARGET_WINDOWS
  , m_handle(INVALID_HANDLE_VALUE)
 #endif
 {
+  m_read = m_write = m_segments.end();
 }
 
 CCircularCache::~CCircularCache()
@@ -58,8 +59,13 @@ int CCircularCache::Open()
 #endif
   if(m_buf == 0)
     return CACHE_RC_ERROR;
-  m_beg = 0;
-  m_end = 0;
+
+  m_segments.clear();
+  m_free.clear();
+  for (size_t block = m_size / CIRCULAR_CACHE_BLOCK_SIZE; block > 0; block--)
+    m_free.push_back(block - 1);
+  m_read = m_write = m_segments.end();
+  m_read = m_write = AddSegment(0);
   m_cur = 0;
   return CACHE_RC_OK;
 }
@@ -74,24 +80,24 @@ void CCircularCache::Close()
   delete[] m_buf;
 #endif
   m_buf = NULL;
+  m_segments.clear();
+  m_free.clear();
+  m_read = m_write = m_segments.end();
 }
 
 /**
- * Function will write to m_buf at m_end % m_size location
- * it will write at maximum m_size, but it will only write
- * as much it can without wrapping around in the buffer
- *
- * It will always leave m_size_back of the backbuffer intact
- * but if the back buffer is less than that, that space is
- * usable to write.
+ * Function will write to the end of the segment written to,
+ * it will only write as much as fits in the last block of
+ * the segment, taking a new block if that one is full.
  *
- * If back buffer is filled to an larger extent than
- * m_size_back, it will allow it to be overwritten
- * until only m_size_back data remains.
+ * It will always leave m_size_back of the back buffer of
+ * the segment being read intact (less what other segments
+ * hold), but if the back buffer is less than that, that
+ * space is usable to write.
  *
- * The following always apply:
- *  * m_end <= m_cur <= m_end
- *  * m_end - m_beg <= m_size
+ * Data of other segments that is overwritten is dropped
+ * from them, a prefetch stops where the segment being
+ * read begins.
  *
  * Multiple calls may be needed to fill buffer completely.
  */
@@ -99,32 +105,32 @@ int CCircularCache::WriteToCache(const char *buf, size_t len)
 {
   CSingleLock lock(m_sync);
 
-  // where are we in the buffer
-  size_t pos   = m_end % m_size;
-  size_t back  = (size_t)(m_cur - m_beg);
-  size_t front = (size_t)(m_end - m_cur);
-
-  size_t limit = m_size - std::min(back, m_size_back) - front;
-  size_t wrap  = m_size - pos;
+  Segment &segment = *m_write;
+  size_t room = (size_t)(segment.start + segment.blocks.size() * CIRCULAR_CACHE_BLOCK_SIZE - segment.end);
+  if (room == 0)
+  {
+    if (!AllocateBlock(m_write))
+      return 0;
+    room = CIRCULAR_CACHE_BLOCK_SIZE;
+  }
 
-  // limit by max forward size
-  if(len > limit)
-    len = limit;
+  // limit to the end of the block
+  if (len > room)
+    len = room;
 
-  // limit to wrap point
-  if(len > wrap)
-    len = wrap;
+  // a prefetch must not overwrite what is being read
+  if (m_write != m_read && segment.end < m_read->begin && segment.end + (int64_t)len > m_read->begin)
+    len = (size_t)(m_read->begin - segment.end);
 
-  if(len == 0)
+  if (len == 0)
     return 0;
 
   // write the data
-  memcpy(m_buf + pos, buf, len);
-  m_end += len;
+  memcpy(Data(segment, segment.end), buf, len);
+  segment.end += len;
+  segment.used = ++m_stamp;
 
-  // drop history that was overwritten
-  if(m_end - m_beg > (int64_t)m_size)
-    m_beg = m_end - m_size;
+  DropOverlapped(m_write);
 
   m_written.Set();
 
@@ -133,16 +139,16 @@ int CCircularCache::WriteToCache(const char *buf, size_t len)
 
 /**
  * Reads data from cache. Will only read up till
- * the buffer wrap point. So multiple calls
- * may be needed to empty the whole cache
+ * the end of a block. So multiple calls may be
+ * needed to empty the whole cache
  */
 int CCircularCache::ReadFromCache(char *buf, size_t len)
 {
   CSingleLock lock(m_sync);
 
-  size_t pos   = m_cur % m_size;
-  size_t front = (size_t)(m_end - m_cur);
-  size_t avail = std::min(m_size - pos, front);
+  Segment &segment = *m_read;
+  size_t front = (size_t)(segment.end - m_cur);
+  size_t avail = std::min(CIRCULAR_CACHE_BLOCK_SIZE - (size_t)((m_cur - segment.start) % CIRCULAR_CACHE_BLOCK_SIZE), front);
 
   if(avail == 0)
   {
@@ -158,8 +164,9 @@ int CCircularCache::ReadFromCache(char *buf, size_t len)
   if(len == 0)
     return 0;
 
-  memcpy(buf, m_buf + pos, len);
+  memcpy(buf, Data(segment, m_cur), len);
   m_cur += len;
+  segment.used = ++m_stamp;
 
   m_space.Set();
 
@@ -169,7 +176,7 @@ int CCircularCache::ReadFromCache(char *buf, size_t len)
 int64_t CCircularCache::WaitForData(unsigned int minumum, unsigned int millis)
 {
   CSingleLock lock(m_sync);
-  int64_t avail = m_end - m_cur;
+  int64_t avail = m_read->end - m_cur;
 
   if(millis == 0 || IsEndOfInput())
     return avail;
@@ -183,26 +190,31 @@ int64_t CCircularCache::WaitForData(unsigned int minumum, unsigned int millis)
     lock.Leave();
     m_written.WaitMSec(50); // may miss the deadline. shouldn't be a problem.
     lock.Enter();
-    avail = m_end - m_cur;
+    avail = m_read->end - m_cur;
   }
 
   return avail;
 }
 
+/**
+ * Only seeks within the segment being read succeed. A seek
+ * to another segment has to go through Reset(), so that
+ * the source continues behind the data cached there.
+ */
 int64_t CCircularCache::Seek(int64_t pos)
 {
   CSingleLock lock(m_sync);
 
   // if seek is a bit over what we have, try to wait a few seconds for the data to be available.
   // we try to avoid a (heavy) seek on the source
-  if (pos >= m_end && pos < m_end + 100000)
+  if (m_write == m_read && pos >= m_read->end && pos < m_read->end + 100000)
   {
     lock.Leave();
     WaitForData((size_t)(pos - m_cur), 5000);
     lock.Enter();
   }
 
-  if(pos >= m_beg && pos <= m_end)
+  if(pos >= m_read->begin && pos <= m_read->end)
   {
     m_cur = pos;
     return pos;
@@ -214,35 +226,208 @@ int64_t CCircularCache::Seek(int64_t pos)
 void CCircularCache::Reset(int64_t pos, bool clearAnyway)
 {
   CSingleLock lock(m_sync);
-  if (!clearAnyway && IsCachedPosition(pos))
+  Segments::iterator segment = m_segments.end();
+  if (clearAnyway)
   {
-    m_cur = pos;
-    return;
+    m_read = m_write = m_segments.end();
+    while (!m_segments.empty())
+      DropSegment(m_segments.begin());
   }
-  m_end = pos;
-  m_beg = pos;
+  else
+    segment = FindSegment(pos);
+
+  if (segment == m_segments.end())
+  {
+    m_read = m_write = m_segments.end();
+    segment = AddSegment(pos);
+  }
+
+  m_read = m_write = segment;
   m_cur = pos;
+  segment->used = ++m_stamp;
+  DropEmpty();
 }
 
 int64_t CCircularCache::CachedDataEndPosIfSeekTo(int64_t iFilePosition)
 {
-  if (IsCachedPosition(iFilePosition))
-    return m_end;
+  CSingleLock lock(m_sync);
+  Segments::iterator segment = FindSegment(iFilePosition);
+  if (segment != m_segments.end())
+    return segment->end;
   return iFilePosition;
 }
 
 int64_t CCircularCache::CachedDataEndPos()
 {
-  return m_end;
+  CSingleLock lock(m_sync);
+  return m_write->end;
 }
 
 bool CCircularCache::IsCachedPosition(int64_t iFilePosition)
 {
-  return iFilePosition >= m_beg && iFilePosition <= m_end;
+  CSingleLock lock(m_sync);
+  return FindSegment(iFilePosition) != m_segments.end();
+}
+
+int64_t CCircularCache::StartPrefetch(int64_t iFilePosition)
+{
+  CSingleLock lock(m_sync);
+  if (m_maxSegments < 2)
+    return CACHE_RC_ERROR;
+
+  Segments::iterator segment = FindSegment(iFilePosition);
+  if (segment == m_read)
+    return CACHE_RC_ERROR;
+  if (segment == m_segments.end())
+    segment = AddSegment(iFilePosition);
+
+  m_write = segment;
+  return segment->end;
+}
+
+int64_t CCircularCache::EndPrefetch()
+{
+  CSingleLock lock(m_sync);
+  m_write = m_read;
+  DropEmpty();
+  return m_read->end;
 }
 
 CCacheStrategy *CCircularCache::CreateNew()
 {
-  return new CCircularCache(m_size - m_size_back, m_size_back);
+  return new CCircularCache(m_size - m_size_back, m_size_back, m_maxSegments);
 }
 
+CCircularCache::Segments::iterator CCircularCache::FindSegment(int64_t pos)
+{
+  // segments only touch at their ends, prefer the one going further
+  Segments::iterator found = m_segments.end();
+  for (Segments::iterator it = m_segments.begin(); it != m_segments.end(); ++it)
+  {
+    if (pos >= it->begin && pos <= it->end && (found == m_segments.end() || it->end > found->end))
+      found = it;
+  }
+  return found;
+}
+
+CCircularCache::Segments::iterator CCircularCache::AddSegment(int64_t pos)
+{
+  while (m_segments.size() >= m_maxSegments)
+  {
+    Segments::iterator lru = LeastRecentlyUsed(m_segments.end());
+    if (lru == m_segments.end())
+      break;
+    DropSegment(lru);
+  }
+
+  Segment segment;
+  segment.start = pos;
+  segment.begin = pos;
+  segment.end   = pos;
+  segment.used  = ++m_stamp;
+  return m_segments.insert(m_segments.end(), segment);
+}
+
+CCircularCache::Segments::iterator CCircularCache::LeastRecentlyUsed(Segments::iterator exclude)
+{
+  Segments::iterator lru = m_segments.end();
+  for (Segments::iterator it = m_segments.begin(); it != m_segments.end(); ++it)
+  {
+    if (it == m_read || it == m_write || it == exclude)
+      continue;
+    // wrap safe comparison of the stamps
+    if (lru == m_segments.end() || (int)(it->used - lru->used) < 0)
+      lru = it;
+  }
+  return lru;
+}
+
+bool CCircularCache::AllocateBlock(Segments::iterator segment)
+{
+  if (m_free.empty())
+  {
+    // history of the segment being read is given up first, then other segments
+    // as long as they take more than their share of the back buffer
+    size_t others = OtherBlocks() * CIRCULAR_CACHE_BLOCK_SIZE;
+    size_t keep   = m_size_back > others ? m_size_back - others : 0;
+    Segments::iterator lru;
+    if (!m_read->blocks.empty() && m_read->start + CIRCULAR_CACHE_BLOCK_SIZE + (int64_t)keep <= m_cur)
+      DropFirstBlock(m_read);
+    else if ((segment != m_read || others > m_size_back / 2)
+          && (lru = LeastRecentlyUsed(segment)) != m_segments.end())
+    {
+      DropFirstBlock(lru);
+      if (lru->blocks.empty())
+        DropSegment(lru);
+    }
+    else
+      return false;
+  }
+
+  if (segment->blocks.empty())
+    segment->start = segment->begin = segment->end;
+  segment->blocks.push_back(m_free.back());
+  m_free.pop_back();
+  return true;
+}
+
+void CCircularCache::DropFirstBlock(Segments::iterator segment)
+{
+  m_free.push_back(segment->blocks.front());
+  segment->blocks.pop_front();
+  segment->start += CIRCULAR_CACHE_BLOCK_SIZE;
+  if (segment->begin < segment->start)
+    segment->begin = segment->start;
+  if (segment->end < segment->begin)
+    segment->end = segment->begin;
+}
+
+void CCircularCache::DropSegment(Segments::iterator segment)
+{
+  m_free.insert(m_free.end(), segment->blocks.begin(), segment->blocks.end());
+  m_segments.erase(segment);
+}
+
+void CCircularCache::DropOverlapped(Segments::iterator segment)
+{
+  for (Segments::iterator it = m_segments.begin(); it != m_segments.end(); )
+  {
+    Segments::iterator other = it++;
+    if (other == segment || other == m_read || other->begin >= segment->end || other->end <= segment->begin)
+      continue;
+
+    other->begin = segment->end;
+    while (!other->blocks.empty() && other->start + CIRCULAR_CACHE_BLOCK_SIZE <= other->begin)
+      DropFirstBlock(other);
+    if (other->begin >= other->end)
+      DropSegment(other);
+  }
+}
+
+void CCircularCache::DropEmpty()
+{
+  for (Segments::iterator it = m_segments.begin(); it != m_segments.end(); )
+  {
+    Segments::iterator segment = it++;
+    if (segment != m_read && segment != m_write && segment->begin == segment->end)
+      DropSegment(segment);
+  }
+}
+
+size_t CCircularCache::OtherBlocks()
+{
+  size_t blocks = 0;
+  for (Segments::iterator it = m_segments.begin(); it != m_segments.end(); ++it)
+  {
+    if (it != m_read)
+      blocks += it->blocks.size();
+  }
+  return blocks;
+}
+
+uint8_t *CCircularCache::Data(const Segment &segment, int64_t pos)
+{
+  size_t offset = (size_t)(pos - segment.start);
+  return m_buf + segment.blocks[offset / CIRCULAR_CACHE_BLOCK_SIZE] * CIRCULAR_CACHE_BLOCK_SIZE
+               + offset % CIRCULAR_CACHE_BLOCK_SIZE;
+}
@@ -25,12 +25,37 @@
 #include "threads/CriticalSection.h"
 #include "threads/Event.h"
 
+#include <deque>
+#include <list>
+#include <vector>
+
 namespace XFILE {
 
+#define CIRCULAR_CACHE_BLOCK_SIZE (64*1024)
+#define CIRCULAR_CACHE_SEGMENTS   8
+
+/*!
+ \brief Memory cache keeping several non-contiguous ranges of a file.
+
+ The buffer is split into blocks of CIRCULAR_CACHE_BLOCK_SIZE bytes which are
+ handed out to segments, each segment caching one contiguous range of the file.
+ Reading and writing normally happen in the same segment, which then behaves
+ like a single circular buffer: it may grow to the front size and keeps at least
+ the back size of data that was already read.
+
+ A seek outside of the segment being read starts a new one and leaves the old
+ ranges in place, so seeking back to them (or to a trailing index a demuxer
+ keeps returning to) is served from memory. Other segments hold on to their
+ blocks until the current one needs the space: history beyond the back size is
+ given up first, then the least recently used segments, which together may not
+ take more than half of the back size from the segment being read.
+
+ Writes can also be directed to a segment that isn't read, see StartPrefetch.
+ */
 class CCircularCache : public CCacheStrategy
 {
 public:
-    CCircularCache(size_t front, size_t back);
+    CCircularCache(size_t front, size_t back, unsigned int segments = CIRCULAR_CACHE_SEGMENTS);
     virtual ~CCircularCache();
 
     virtual int Open() ;
@@ -47,13 +72,41 @@ public:
     virtual int64_t CachedDataEndPos(); 
     virtual bool IsCachedPosition(int64_t iFilePosition);
 
+    virtual int64_t StartPrefetch(int64_t iFilePosition);
+    virtual int64_t EndPrefetch();
+
     virtual CCacheStrategy *CreateNew();
 protected:
-    int64_t           m_beg;       /**< index in file (not buffer) of beginning of valid data */
-    int64_t           m_end;       /**< index in file (not buffer) of end of valid data */
+    struct Segment
+    {
+      int64_t            start;  /**< index in file of the first byte of the first block */
+      int64_t            begin;  /**< index in file of beginning of valid data */
+      int64_t            end;    /**< index in file of end of valid data */
+      std::deque<size_t> blocks; /**< blocks holding the data from start on */
+      unsigned int       used;   /**< stamp of the last read or write, for LRU eviction */
+    };
+    typedef std::list<Segment> Segments;
+
+    Segments::iterator FindSegment(int64_t pos);
+    Segments::iterator AddSegment(int64_t pos);
+    Segments::iterator LeastRecentlyUsed(Segments::iterator exclude);
+    bool               AllocateBlock(Segments::iterator segment);
+    void               DropFirstBlock(Segments::iterator segment);
+    void               DropSegment(Segments::iterator segment);
+    void               DropOverlapped(Segments::iterator segment);
+    void               DropEmpty();
+    size_t             OtherBlocks();
+    uint8_t           *Data(const Segment &segment, int64_t pos);
+
+    Segments          m_segments;
+    Segments::iterator m_read;     /**< segment holding the read position */
+    Segments::iterator m_write;    /**< segment written to, m_read unless prefetching */
+    std::vector<size_t> m_free;    /**< blocks not used by any segment */
+    unsigned int      m_stamp;
+    unsigned int      m_maxSegments;
     int64_t           m_cur;       /**< current reading index in file */
     uint8_t          *m_buf;       /**< buffer holding data */
-    size_t            m_size;      /**< size of data buffer used (m_buf) */
+    size_t            m_size;      /**< size of data buffer used (m_buf), a multiple of the block size */
     size_t            m_size_back; /**< guaranteed size of back buffer (actual size can be smaller, or larger if front buffer doesn't need it) */
     CCriticalSection  m_sync;
     CEvent            m_written;
@@ -29,12 +29,14 @@
 #include "threads/SingleLock.h"
 #include "utils/log.h"
 #include "utils/TimeUtils.h"
+#include "utils/URIUtils.h"
 #include "settings/AdvancedSettings.h"
 
 using namespace AUTOPTR;
 using namespace XFILE;
 
 #define READ_CACHE_CHUNK_SIZE (64*1024)
+#define PREFETCH_TRAILER_SIZE (1024*1024)
 
 class CWriteRate
 {
@@ -85,6 +87,7 @@ CFileCache::CFileCache(bool useDoubleCache) : CThread("FileCache")
    m_seekPos = 0;
    m_readPos = 0;
    m_writePos = 0;
+   m_prefetchPos = -1;
    if (g_advancedSettings.m_cacheMemBufferSize == 0)
      m_pCache = new CSimpleFileCache();
    else
@@ -113,6 +116,7 @@ CFileCache::CFileCache(CCacheStrategy *pCache, bool bDeleteCache) : CThread("Fil
   m_seekPos = 0;
   m_readPos = 0;
   m_writePos = 0;
+  m_prefetchPos = -1;
   m_nSeekResult = 0;
   m_chunkSize = 0;
 }
@@ -179,6 +183,15 @@ bool CFileCache::Open(const CURL& url)
   m_seekPossible = m_source.IoControl(IOCTRL_SEEK_POSSIBLE, NULL);
   m_chunkSize = CFile::GetChunkSize(m_source.GetChunkSize(), READ_CACHE_CHUNK_SIZE);
 
+  // demuxers of these containers look for an index at the end of the file
+  m_prefetchPos = -1;
+  if (m_seekPossible > 0 && URIUtils::HasExtension(m_sourcePath, ".mkv|.mk3d|.mp4|.m4v|.mov|.avi"))
+  {
+    int64_t length = m_source.GetLength();
+    if (length > 4 * PREFETCH_TRAILER_SIZE)
+      m_prefetchPos = length - PREFETCH_TRAILER_SIZE;
+  }
+
   m_readPos = 0;
   m_writePos = 0;
   m_writeRate = 1024 * 1024;
@@ -211,6 +224,7 @@ void CFileCache::Process()
   CWriteRate limiter;
   CWriteRate average;
   bool cacheReachEOF = false;
+  bool prefetching = false;
 
   while (!m_bStop)
   {
@@ -218,6 +232,11 @@ void CFileCache::Process()
     if (m_seekEvent.WaitMSec(0))
     {
       m_seekEvent.Reset();
+      if (prefetching)
+      {
+        m_pCache->EndPrefetch();
+        prefetching = false;
+      }
       int64_t cacheMaxPos = m_pCache->CachedDataEndPosIfSeekTo(m_seekPos);
       cacheReachEOF = cacheMaxPos == m_source.GetLength();
       bool sourceSeekFailed = false;
@@ -246,7 +265,28 @@ void CFileCache::Process()
       m_seekEnded.Set();
     }
 
-    while (m_writeRate)
+    // once the reader has something to work on, cache the end of the file
+    // too, so the demuxer looking for an index there doesn't hit the source
+    if (m_prefetchPos >= 0 && m_writePos - m_readPos >= (int64_t)m_chunkSize)
+    {
+      int64_t prefetchPos = m_pCache->StartPrefetch(m_prefetchPos);
+      m_prefetchPos = -1;
+      if (prefetchPos >= 0 && prefetchPos < m_source.GetLength())
+      {
+        prefetching = true;
+        if (m_source.Seek(prefetchPos, SEEK_SET) != prefetchPos)
+        {
+          CLog::Log(LOGWARNING, "CFileCache::Process - failed to seek to %"PRId64" for prefetching", prefetchPos);
+          prefetching = false;
+          if (!EndPrefetch())
+            break;
+        }
+      }
+      else if (prefetchPos >= 0)
+        m_pCache->EndPrefetch();
+    }
+
+    while (m_writeRate && !prefetching)
     {
       if (m_writePos - m_readPos < m_writeRate)
       {
@@ -267,6 +307,13 @@ void CFileCache::Process()
     int iRead = 0;
     if (!cacheReachEOF)
       iRead = m_source.Read(buffer.get(), m_chunkSize);
+    if (prefetching && iRead <= 0)
+    {
+      prefetching = false;
+      if (!EndPrefetch())
+        break;
+      continue;
+    }
     if (iRead == 0)
     {
       CLog::Log(LOGINFO, "CFileCache::Process - Hit eof.");
@@ -285,6 +332,7 @@ void CFileCache::Process()
       m_bStop = true;
 
     int iTotalWrite=0;
+    bool prefetched = prefetching;
     while (!m_bStop && (iTotalWrite < iRead))
     {
       int iWrite = 0;
@@ -300,6 +348,14 @@ void CFileCache::Process()
       }
       else if (iWrite == 0)
       {
+        // the reader doesn't free space for a prefetch, it ends once the cache is full
+        if (prefetching)
+        {
+          prefetching = false;
+          if (!EndPrefetch())
+            m_bStop = true;
+          break;
+        }
         m_cacheFull = true;
         average.Pause();
         m_pCache->m_space.WaitMSec(5);
@@ -318,7 +374,8 @@ void CFileCache::Process()
       }
     }
 
-    m_writePos += iTotalWrite;
+    if (!prefetched)
+      m_writePos += iTotalWrite;
 
     // under estimate write rate by a second, to
     // avoid uncertainty at start of caching
@@ -326,6 +383,18 @@ void CFileCache::Process()
   }
 }
 
+bool CFileCache::EndPrefetch()
+{
+  // continue behind the data being read
+  int64_t pos = m_pCache->EndPrefetch();
+  if (m_source.Seek(pos, SEEK_SET) != pos)
+  {
+    CLog::Log(LOGERROR, "CFileCache::Process - failed to seek back to %"PRId64" after prefetching", pos);
+    return false;
+  }
+  return true;
+}
+
 void CFileCache::OnExit()
 {
   m_bStop = true;
@@ -62,6 +62,8 @@ namespace XFILE
     virtual std::string GetContentCharset(void);
 
   private:
+    bool EndPrefetch();
+
     CCacheStrategy *m_pCache;
     bool      m_bDeleteCache;
     int        m_seekPossible;
@@ -73,6 +75,7 @@ namespace XFILE
     int64_t      m_seekPos;
     int64_t      m_readPos;
     int64_t      m_writePos;
+    int64_t      m_prefetchPos; ///< start of the region to cache ahead of the reader, -1 if none
     unsigned     m_chunkSize;
     unsigned     m_writeRate;
     unsigned     m_writeRateActual;
@@ -97,7 +97,8 @@ void Pipe::Flush()
   {
     return;
   }
-  m_buffer.Clear();
+  // drop what was written so far, the writer may be adding more meanwhile
+  m_buffer.SkipBytes(m_buffer.getMaxReadSize());
   CheckStatus();
 }
 
@@ -173,10 +174,7 @@ bool Pipe::Write(const char *buf, int nSize, int nWaitMillis)
   bool bOk = false;
   int writeSize = m_buffer.getMaxWriteSize();
   if (writeSize > nSize)
-  {
-    m_buffer.WriteData((char*)buf, nSize);
     bOk = true;
-  }
   else
   {
     while ( (int)m_buffer.getMaxWriteSize() < nSize && m_bOpen )
@@ -189,7 +187,6 @@ bool Pipe::Write(const char *buf, int nSize, int nWaitMillis)
       lock.Enter();
       if (bClear && (int)m_buffer.getMaxWriteSize() >= nSize)
       {
-        m_buffer.WriteData((char*)buf, nSize);
         bOk = true;
         break;
       }
@@ -200,6 +197,14 @@ bool Pipe::Write(const char *buf, int nSize, int nWaitMillis)
     }
   }
 
+  if (bOk)
+  {
+    // this is the only writer, the space can't shrink while copying without the lock
+    lock.Leave();
+    m_buffer.WriteData(buf, nSize);
+    lock.Enter();
+  }
+
   CheckStatus();
   
   return bOk && m_bOpen;
@@ -27,7 +27,7 @@
 #include "threads/CriticalSection.h"
 #include "threads/Event.h"
 #include "utils/StdString.h"
-#include "utils/RingBuffer.h"
+#include "utils/SPSCRingBuffer.h"
 
 #include <map>
 
@@ -95,7 +95,7 @@ class Pipe
     bool        m_bReadyForRead;
 
     bool        m_bEof;
-    CRingBuffer m_buffer;
+    CSPSCRingBuffer m_buffer; // written without holding m_lock, read and flushed with it
     CStdString  m_strPipeName;  
     int         m_nRefCount;
     int         m_nOpenThreashold;
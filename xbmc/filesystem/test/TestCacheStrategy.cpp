@@ -0,0 +1,282 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "filesystem/CircularCache.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace XFILE;
+
+static const int64_t FileLength = 64 * 1024 * 1024;
+static const size_t ChunkSize = 64 * 1024;
+static const size_t ReadAhead = 1024 * 1024;
+
+/* One read of a trace, a seek when pos isn't where the previous read ended */
+struct TraceStep
+{
+  int64_t pos;
+  size_t  size;
+};
+
+/* What a demuxer does when opening a file with the index at its end and the
+   user seeks twice */
+static const TraceStep DemuxerTrace[] =
+{
+  { 0,                               32 * 1024 },   // header
+  { FileLength - 512 * 1024,         512 * 1024 },  // index
+  { 32 * 1024,                       2 * 1024 * 1024 },
+  { FileLength - 512 * 1024,         512 * 1024 },  // seek, index again
+  { 32 * 1024 * 1024,                2 * 1024 * 1024 },
+  { FileLength - 512 * 1024,         512 * 1024 },  // seek, index again
+  { 2 * 1024 * 1024,                 1024 * 1024 }, // back to where playback was
+};
+
+/* Replays traces against a cache strategy the way CFileCache drives it,
+   with the source read in the same thread, and checks every byte read. */
+class CTraceReplay
+{
+public:
+  CTraceReplay(CCacheStrategy &cache)
+    : m_cache(cache), m_sourcePos(0), m_readPos(0), m_sourceBytes(0), m_sourceSeeks(0)
+  {
+  }
+
+  static char ByteAt(int64_t pos)
+  {
+    return (char)(pos ^ (pos >> 8) ^ (pos >> 16));
+  }
+
+  bool Replay(const TraceStep *steps, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      if (!Seek(steps[i].pos) || !Read(steps[i].size))
+        return false;
+    }
+    return true;
+  }
+
+  bool Seek(int64_t pos)
+  {
+    if (pos == m_readPos)
+      return true;
+
+    // the cache would wait for data just ahead of what it has
+    while (pos >= m_cache.CachedDataEndPos() && pos < m_cache.CachedDataEndPos() + 100000 && Fill(ChunkSize))
+      ;
+
+    if (m_cache.Seek(pos) != pos)
+    {
+      int64_t cacheMaxPos = m_cache.CachedDataEndPosIfSeekTo(pos);
+      if (cacheMaxPos < FileLength)
+        SeekSource(cacheMaxPos);
+      else
+        m_sourcePos = cacheMaxPos; // nothing left to read
+      m_cache.Reset(pos, false);
+      m_cache.ClearEndOfInput();
+      if (m_cache.CachedDataEndPos() != cacheMaxPos)
+        return false;
+    }
+    m_readPos = pos;
+    return true;
+  }
+
+  bool Read(size_t size)
+  {
+    std::vector<char> buffer(size);
+    size_t done = 0;
+    while (done < size)
+    {
+      int rc = m_cache.ReadFromCache(&buffer[done], size - done);
+      if (rc == CACHE_RC_WOULD_BLOCK)
+      {
+        if (!Fill(ChunkSize))
+          return false;
+        continue;
+      }
+      if (rc <= 0)
+        return false;
+      for (int i = 0; i < rc; i++)
+      {
+        if (buffer[done + i] != ByteAt(m_readPos + i))
+          return false;
+      }
+      done += rc;
+      m_readPos += rc;
+    }
+
+    // keep the cache ahead of the reader like the cache thread does
+    while (m_cache.CachedDataEndPos() - m_readPos < (int64_t)ReadAhead && Fill(ChunkSize))
+      ;
+    return true;
+  }
+
+  /* cache the data at pos without moving the read position */
+  bool Prefetch(int64_t pos, size_t size)
+  {
+    int64_t prefetchPos = m_cache.StartPrefetch(pos);
+    if (prefetchPos < 0)
+      return false;
+    SeekSource(prefetchPos);
+    while (m_sourcePos < pos + (int64_t)size && Fill(ChunkSize))
+      ;
+    SeekSource(m_cache.EndPrefetch());
+    return m_cache.IsCachedPosition(pos + size);
+  }
+
+  /* write at most size bytes from the source to the cache */
+  bool Fill(size_t size)
+  {
+    if (m_sourcePos >= FileLength)
+    {
+      m_cache.EndOfInput();
+      return false;
+    }
+    if (m_cache.CachedDataEndPos() != m_sourcePos)
+      return false;
+
+    size = (size_t)std::min((int64_t)size, FileLength - m_sourcePos);
+    std::vector<char> buffer(size);
+    for (size_t i = 0; i < size; i++)
+      buffer[i] = ByteAt(m_sourcePos + i);
+    m_sourceBytes += size;
+
+    size_t done = 0;
+    while (done < size)
+    {
+      int rc = m_cache.WriteToCache(&buffer[done], size - done);
+      if (rc <= 0)
+        break;
+      done += rc;
+    }
+    // whatever didn't fit is read again
+    m_sourcePos += done;
+    return done > 0;
+  }
+
+  void SeekSource(int64_t pos)
+  {
+    if (pos != m_sourcePos)
+      m_sourceSeeks++;
+    m_sourcePos = pos;
+  }
+
+  CCacheStrategy &m_cache;
+  int64_t m_sourcePos;
+  int64_t m_readPos;
+  int64_t m_sourceBytes;
+  unsigned int m_sourceSeeks;
+};
+
+TEST(TestCacheStrategy, SequentialRead)
+{
+  CCircularCache cache(4 * 1024 * 1024, 1024 * 1024);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+  CTraceReplay replay(cache);
+
+  const TraceStep trace[] = { { 0, 16 * 1024 * 1024 } };
+  ASSERT_TRUE(replay.Replay(trace, sizeof(trace) / sizeof(trace[0])));
+  EXPECT_EQ(0U, replay.m_sourceSeeks);
+  EXPECT_FALSE(cache.IsCachedPosition(0));
+  EXPECT_TRUE(cache.IsCachedPosition(15 * 1024 * 1024));
+
+  // seeking back into the back buffer doesn't need the source
+  EXPECT_TRUE(replay.Seek(15 * 1024 * 1024));
+  EXPECT_TRUE(replay.Read(1024 * 1024));
+  EXPECT_EQ(0U, replay.m_sourceSeeks);
+  cache.Close();
+}
+
+TEST(TestCacheStrategy, DemuxerTrace)
+{
+  const size_t steps = sizeof(DemuxerTrace) / sizeof(DemuxerTrace[0]);
+
+  CCircularCache single(4 * 1024 * 1024, 1024 * 1024, 1);
+  ASSERT_EQ(CACHE_RC_OK, single.Open());
+  CTraceReplay singleReplay(single);
+  ASSERT_TRUE(singleReplay.Replay(DemuxerTrace, steps));
+
+  CCircularCache segmented(4 * 1024 * 1024, 1024 * 1024);
+  ASSERT_EQ(CACHE_RC_OK, segmented.Open());
+  CTraceReplay segmentedReplay(segmented);
+  ASSERT_TRUE(segmentedReplay.Replay(DemuxerTrace, steps));
+
+  // the index is read from the source once, and so is the data played before the seeks
+  EXPECT_LT(segmentedReplay.m_sourceSeeks, singleReplay.m_sourceSeeks);
+  EXPECT_LT(segmentedReplay.m_sourceBytes, singleReplay.m_sourceBytes);
+  EXPECT_TRUE(segmented.IsCachedPosition(FileLength - 512 * 1024));
+  EXPECT_FALSE(single.IsCachedPosition(FileLength - 512 * 1024));
+  single.Close();
+  segmented.Close();
+}
+
+TEST(TestCacheStrategy, Prefetch)
+{
+  CCircularCache cache(4 * 1024 * 1024, 1024 * 1024);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+  CTraceReplay replay(cache);
+
+  ASSERT_TRUE(replay.Read(32 * 1024));
+  ASSERT_TRUE(replay.Prefetch(FileLength - 512 * 1024, 512 * 1024));
+  EXPECT_EQ(2U, replay.m_sourceSeeks);
+
+  // reading continues behind the header, the index is there when the demuxer seeks to it
+  ASSERT_TRUE(replay.Read(32 * 1024));
+  ASSERT_TRUE(replay.Seek(FileLength - 512 * 1024));
+  EXPECT_EQ(FileLength, cache.CachedDataEndPos());
+  EXPECT_TRUE(replay.Read(512 * 1024));
+  EXPECT_EQ(2U, replay.m_sourceSeeks);
+
+  // a single segment can't keep data away from the read position
+  CCircularCache single(4 * 1024 * 1024, 1024 * 1024, 1);
+  ASSERT_EQ(CACHE_RC_OK, single.Open());
+  EXPECT_EQ(CACHE_RC_ERROR, single.StartPrefetch(FileLength - 512 * 1024));
+  single.Close();
+  cache.Close();
+}
+
+TEST(TestCacheStrategy, LeastRecentlyUsed)
+{
+  CCircularCache cache(4 * 1024 * 1024, 1024 * 1024, 3);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+  CTraceReplay replay(cache);
+
+  const TraceStep trace[] =
+  {
+    { 0,                 64 * 1024 },
+    { 8 * 1024 * 1024,   64 * 1024 },
+    { 0,                 64 * 1024 },
+    { 16 * 1024 * 1024,  64 * 1024 },
+    { 24 * 1024 * 1024,  64 * 1024 },
+  };
+  ASSERT_TRUE(replay.Replay(trace, sizeof(trace) / sizeof(trace[0])));
+
+  // the region at 8MB was used least recently, it made room for the one at 24MB
+  EXPECT_TRUE(cache.IsCachedPosition(0));
+  EXPECT_FALSE(cache.IsCachedPosition(8 * 1024 * 1024));
+  EXPECT_TRUE(cache.IsCachedPosition(16 * 1024 * 1024));
+  EXPECT_TRUE(cache.IsCachedPosition(24 * 1024 * 1024));
+
+  cache.Reset(0, true);
+  EXPECT_FALSE(cache.IsCachedPosition(16 * 1024 * 1024));
+  cache.Close();
+}
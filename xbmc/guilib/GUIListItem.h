@@ -44,6 +44,7 @@ class CVariant;
  */
 class CGUIListItem
 {
+  friend class CFileItemListCache;
 public:
   typedef std::map<std::string, std::string> ArtMap;
 
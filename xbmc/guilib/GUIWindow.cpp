@@ -70,12 +70,10 @@ CGUIWindow::CGUIWindow(int id, const CStdString &xmlFile)
   m_manualRunActions = false;
   m_exclusiveMouseControl = 0;
   m_clearBackground = 0xff000000; // opaque black -> always clear
-  m_windowXMLRootElement = NULL;
 }
 
 CGUIWindow::~CGUIWindow(void)
 {
-  delete m_windowXMLRootElement;
 }
 
 bool CGUIWindow::Load(const CStdString& strFileName, bool bContainsPath)
@@ -134,36 +132,33 @@ bool CGUIWindow::Load(const CStdString& strFileName, bool bContainsPath)
 
 bool CGUIWindow::LoadXML(const CStdString &strPath, const CStdString &strLowerPath)
 {
-  // load window xml if we don't have it stored yet
-  if (!m_windowXMLRootElement)
+  // set the scaling resolution so that any control creation or initialisation can
+  // be done with respect to the correct aspect ratio
+  g_graphicsContext.SetScalingResolution(m_coordsRes, m_needsScaling);
+
+  // the skin keeps the window with its includes resolved, so this only parses
+  // and resolves it the first time (or when the conditions of the includes change)
+  std::string strPathLower = strPath;
+  StringUtils::ToLower(strPathLower);
+  TiXmlElementPtr root = g_SkinInfo->LoadWindow(strPath, m_xmlIncludeConditions);
+  if (!root && strPathLower != strPath)
+    root = g_SkinInfo->LoadWindow(strPathLower, m_xmlIncludeConditions);
+  if (!root && !strLowerPath.empty() && strLowerPath != strPathLower)
+    root = g_SkinInfo->LoadWindow(strLowerPath, m_xmlIncludeConditions);
+  if (!root)
   {
-    CXBMCTinyXML xmlDoc;
-    std::string strPathLower = strPath;
-    StringUtils::ToLower(strPathLower);
-    if (!xmlDoc.LoadFile(strPath) && !xmlDoc.LoadFile(strPathLower) && !xmlDoc.LoadFile(strLowerPath))
-    {
-      CLog::Log(LOGERROR, "unable to load:%s, Line %d\n%s", strPath.c_str(), xmlDoc.ErrorRow(), xmlDoc.ErrorDesc());
-      SetID(WINDOW_INVALID);
-      return false;
-    }
-    m_windowXMLRootElement = (TiXmlElement*)xmlDoc.RootElement()->Clone();
+    CLog::Log(LOGERROR, "unable to load:%s", strPath.c_str());
+    SetID(WINDOW_INVALID);
+    return false;
   }
-  else
-    CLog::Log(LOGDEBUG, "Using already stored xml root node for %s", strPath.c_str());
 
-  return Load(m_windowXMLRootElement);
+  return LoadResolved(root.get());
 }
 
 bool CGUIWindow::Load(TiXmlElement* pRootElement)
 {
   if (!pRootElement)
     return false;
-  
-  if (strcmpi(pRootElement->Value(), "window"))
-  {
-    CLog::Log(LOGERROR, "file : XML file doesnt contain <window>");
-    return false;
-  }
 
   // we must create copy of root element as we will manipulate it when resolving includes
   // and we don't want original root element to change
@@ -175,6 +170,19 @@ bool CGUIWindow::Load(TiXmlElement* pRootElement)
 
   // Resolve any includes that may be present and save conditions used to do it
   g_SkinInfo->ResolveIncludes(pRootElement, &m_xmlIncludeConditions);
+  bool ret = LoadResolved(pRootElement);
+  delete pRootElement;
+  return ret;
+}
+
+bool CGUIWindow::LoadResolved(TiXmlElement* pRootElement)
+{
+  if (strcmpi(pRootElement->Value(), "window"))
+  {
+    CLog::Log(LOGERROR, "file : XML file doesnt contain <window>");
+    return false;
+  }
+
   // now load in the skin file
   SetDefaults();
 
@@ -272,7 +280,6 @@ bool CGUIWindow::Load(TiXmlElement* pRootElement)
 
   m_windowLoaded = true;
   OnWindowLoaded();
-  delete pRootElement;
   return true;
 }
 
@@ -765,11 +772,7 @@ void CGUIWindow::FreeResources(bool forceUnload /*= FALSE */)
   // unload the skin
   if (m_loadType == LOAD_EVERY_TIME || forceUnload) ClearAll();
   if (forceUnload)
-  {
-    delete m_windowXMLRootElement;
-    m_windowXMLRootElement = NULL;
     m_xmlIncludeConditions.clear();
-  }
 }
 
 void CGUIWindow::DynamicResourceAlloc(bool bOnOff)
@@ -0,0 +1,402 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GUIWindowCache.h"
+#include "GUIIncludes.h"
+#include "GUIInfoManager.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "threads/SingleLock.h"
+#include "utils/Archive.h"
+#include "utils/Crc32.h"
+#include "utils/log.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+#include "utils/XBMCTinyXML.h"
+
+using namespace std;
+using namespace XFILE;
+
+#define WINDOWCACHE_MAGIC     0x43574258 // "XBWC"
+#define WINDOWCACHE_VERSION   1
+#define WINDOWCACHE_MAX_DEPTH 256
+
+// node types in the stored tree
+#define WINDOWCACHE_ELEMENT   'e'
+#define WINDOWCACHE_TEXT      't'
+#define WINDOWCACHE_CDATA     'c'
+
+CGUIWindowCache::CGUIWindowCache()
+{
+}
+
+CGUIWindowCache::CGUIWindowCache(const CGUIWindowCache &cache)
+  : m_folder(cache.m_folder)
+{
+}
+
+CGUIWindowCache& CGUIWindowCache::operator=(const CGUIWindowCache &cache)
+{
+  if (this != &cache)
+  {
+    CSingleLock lock(m_critical);
+    m_folder = cache.m_folder;
+    m_windows.clear();
+  }
+  return *this;
+}
+
+CGUIWindowCache::~CGUIWindowCache()
+{
+}
+
+void CGUIWindowCache::SetFolder(const std::string &folder)
+{
+  CSingleLock lock(m_critical);
+  m_folder = folder;
+  if (!m_folder.empty())
+    URIUtils::AddSlashAtEnd(m_folder);
+}
+
+void CGUIWindowCache::Clear()
+{
+  CSingleLock lock(m_critical);
+  m_windows.clear();
+}
+
+TiXmlElementPtr CGUIWindowCache::GetWindow(const std::string &file, CGUIIncludes &includes, std::map<INFO::InfoPtr, bool> &xmlIncludeConditions)
+{
+  CSingleLock lock(m_critical);
+
+  // the tree resolved before with the same values of the conditions
+  std::vector<Window> &windows = m_windows[file];
+  for (std::vector<Window>::const_iterator it = windows.begin(); it != windows.end(); ++it)
+  {
+    if (IsCurrent(*it, xmlIncludeConditions))
+      return it->root;
+  }
+
+  // the tree stored by an earlier run
+  Window window;
+  if (Load(file, includes, window) && IsCurrent(window, xmlIncludeConditions))
+  {
+    windows.push_back(window);
+    return window.root;
+  }
+
+  window = Window();
+  if (!Resolve(file, includes, window))
+    return TiXmlElementPtr();
+
+  Save(file, window);
+  xmlIncludeConditions.clear();
+  xmlIncludeConditions.insert(window.conditions.begin(), window.conditions.end());
+  windows.push_back(window);
+  return window.root;
+}
+
+std::string CGUIWindowCache::GetCachedPath(const std::string &file) const
+{
+  if (m_folder.empty())
+    return "";
+
+  Crc32 crc;
+  crc.ComputeFromLowerCase(file);
+  return URIUtils::AddFileToFolder(m_folder, StringUtils::Format("%08x.bin", (unsigned int)crc));
+}
+
+bool CGUIWindowCache::GetSource(const std::string &file, Source &source)
+{
+  struct __stat64 info;
+  if (CFile::Stat(file, &info) != 0)
+    return false;
+
+  source.file = file;
+  source.time = info.st_mtime;
+  source.size = info.st_size;
+  return true;
+}
+
+bool CGUIWindowCache::IsCurrent(const Window &window, std::map<INFO::InfoPtr, bool> &xmlIncludeConditions)
+{
+  for (std::vector<std::pair<INFO::InfoPtr, bool> >::const_iterator it = window.conditions.begin(); it != window.conditions.end(); ++it)
+  {
+    if (it->first->Get() != it->second)
+      return false;
+  }
+
+  xmlIncludeConditions.clear();
+  xmlIncludeConditions.insert(window.conditions.begin(), window.conditions.end());
+  return true;
+}
+
+bool CGUIWindowCache::Resolve(const std::string &file, CGUIIncludes &includes, Window &window) const
+{
+  Source source;
+  if (!GetSource(file, source))
+    return false;
+
+  CXBMCTinyXML xmlDoc;
+  if (!xmlDoc.LoadFile(file) || xmlDoc.RootElement() == NULL)
+  {
+    CLog::Log(LOGERROR, "unable to load:%s, Line %d\n%s", file.c_str(), xmlDoc.ErrorRow(), xmlDoc.ErrorDesc());
+    return false;
+  }
+
+  window.root.reset((TiXmlElement*)xmlDoc.RootElement()->Clone());
+
+  std::map<INFO::InfoPtr, bool> conditions;
+  includes.ResolveIncludes(window.root.get(), &conditions);
+  window.conditions.assign(conditions.begin(), conditions.end());
+
+  // the include files are known once the includes are resolved, as they may load more of them
+  window.sources.push_back(source);
+  const std::vector<CStdString> &files = includes.GetFiles();
+  for (std::vector<CStdString>::const_iterator it = files.begin(); it != files.end(); ++it)
+  {
+    if (GetSource(*it, source))
+      window.sources.push_back(source);
+  }
+  return true;
+}
+
+bool CGUIWindowCache::Load(const std::string &file, CGUIIncludes &includes, Window &window) const
+{
+  std::string cachedPath = GetCachedPath(file);
+  if (cachedPath.empty())
+    return false;
+
+  CFile cachedFile;
+  auto_buffer buffer;
+  if (cachedFile.LoadFile(cachedPath, buffer) == 0)
+    return false;
+
+  CArchive ar((const uint8_t *)buffer.get(), buffer.size());
+  int magic = 0, version = 0;
+  ar >> magic;
+  ar >> version;
+  if (magic != WINDOWCACHE_MAGIC || version != WINDOWCACHE_VERSION)
+    return false;
+
+  std::string storedFile;
+  ar >> storedFile;
+  if (storedFile != file)
+    return false;
+
+  // any change to the window file or the include files makes it stale
+  int count = 0;
+  ar >> count;
+  if (count <= 0)
+    return false;
+  for (int i = 0; i < count; i++)
+  {
+    Source stored, current;
+    ar >> stored.file;
+    ar >> stored.time;
+    ar >> stored.size;
+    if (!GetSource(stored.file, current) || current.time != stored.time || current.size != stored.size)
+      return false;
+    window.sources.push_back(stored);
+  }
+
+  ar >> count;
+  for (int i = 0; i < count; i++)
+  {
+    std::string condition;
+    bool value = false;
+    ar >> condition;
+    ar >> value;
+    window.conditions.push_back(make_pair(g_infoManager.Register(condition), value));
+  }
+
+  std::vector<std::string> strings;
+  ar >> strings;
+  TiXmlNode *root = LoadNode(ar, strings, 0);
+  if (root == NULL || root->ToElement() == NULL)
+  {
+    CLog::Log(LOGWARNING, "%s - invalid window cache %s for %s", __FUNCTION__, cachedPath.c_str(), file.c_str());
+    delete root;
+    return false;
+  }
+  window.root.reset(root->ToElement());
+
+  // resolving the includes loaded these, so they're there when the controls look up skin variables
+  for (std::vector<Source>::const_iterator it = window.sources.begin() + 1; it != window.sources.end(); ++it)
+    includes.LoadIncludes(it->file);
+
+  return true;
+}
+
+void CGUIWindowCache::Save(const std::string &file, const Window &window) const
+{
+  std::string cachedPath = GetCachedPath(file);
+  if (cachedPath.empty())
+    return;
+
+  if (!CDirectory::Exists(m_folder) && !CDirectory::Create(m_folder))
+    return;
+
+  std::map<std::string, int> strings;
+  AddStrings(window.root.get(), strings);
+  std::vector<std::string> table(strings.size());
+  for (std::map<std::string, int>::const_iterator it = strings.begin(); it != strings.end(); ++it)
+    table[it->second] = it->first;
+
+  std::vector<uint8_t> buffer;
+  {
+    CArchive ar(buffer);
+    ar << (int)WINDOWCACHE_MAGIC;
+    ar << (int)WINDOWCACHE_VERSION;
+    ar << file;
+    ar << (int)window.sources.size();
+    for (std::vector<Source>::const_iterator it = window.sources.begin(); it != window.sources.end(); ++it)
+    {
+      ar << it->file;
+      ar << it->time;
+      ar << it->size;
+    }
+    ar << (int)window.conditions.size();
+    for (std::vector<std::pair<INFO::InfoPtr, bool> >::const_iterator it = window.conditions.begin(); it != window.conditions.end(); ++it)
+    {
+      ar << it->first->GetExpression();
+      ar << it->second;
+    }
+    ar << table;
+    StoreNode(ar, window.root.get(), strings);
+    ar.Close();
+  }
+
+  CFile cachedFile;
+  if (!cachedFile.OpenForWrite(cachedPath, true) || cachedFile.Write(&buffer[0], buffer.size()) != (int)buffer.size())
+  {
+    CLog::Log(LOGWARNING, "%s - unable to store %s in the window cache", __FUNCTION__, file.c_str());
+    cachedFile.Close();
+    CFile::Delete(cachedPath);
+  }
+}
+
+void CGUIWindowCache::AddStrings(const TiXmlNode *node, std::map<std::string, int> &strings)
+{
+  // every name and value is stored once, the tree refers to them by index
+  strings.insert(make_pair(node->ValueStr(), (int)strings.size()));
+
+  const TiXmlElement *element = node->ToElement();
+  if (element == NULL)
+    return;
+
+  for (const TiXmlAttribute *attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+  {
+    strings.insert(make_pair(std::string(attribute->Name()), (int)strings.size()));
+    strings.insert(make_pair(attribute->ValueStr(), (int)strings.size()));
+  }
+  for (const TiXmlNode *child = element->FirstChild(); child; child = child->NextSibling())
+    AddStrings(child, strings);
+}
+
+void CGUIWindowCache::StoreNode(CArchive &ar, const TiXmlNode *node, const std::map<std::string, int> &strings)
+{
+  const TiXmlText *text = node->ToText();
+  if (text)
+  {
+    ar << (char)(text->CDATA() ? WINDOWCACHE_CDATA : WINDOWCACHE_TEXT);
+    ar << strings.find(text->ValueStr())->second;
+    return;
+  }
+
+  // comments and the like aren't looked at by the controls
+  const TiXmlElement *element = node->ToElement();
+  ar << (char)WINDOWCACHE_ELEMENT;
+  ar << strings.find(element->ValueStr())->second;
+
+  int attributes = 0;
+  for (const TiXmlAttribute *attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+    attributes++;
+  ar << attributes;
+  for (const TiXmlAttribute *attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+  {
+    ar << strings.find(attribute->Name())->second;
+    ar << strings.find(attribute->ValueStr())->second;
+  }
+
+  int children = 0;
+  for (const TiXmlNode *child = element->FirstChild(); child; child = child->NextSibling())
+  {
+    if (child->ToElement() || child->ToText())
+      children++;
+  }
+  ar << children;
+  for (const TiXmlNode *child = element->FirstChild(); child; child = child->NextSibling())
+  {
+    if (child->ToElement() || child->ToText())
+      StoreNode(ar, child, strings);
+  }
+}
+
+TiXmlNode* CGUIWindowCache::LoadNode(CArchive &ar, const std::vector<std::string> &strings, int depth)
+{
+  if (depth > WINDOWCACHE_MAX_DEPTH)
+    return NULL;
+
+  char type = 0;
+  int value = -1;
+  ar >> type;
+  ar >> value;
+  if (value < 0 || value >= (int)strings.size())
+    return NULL;
+
+  if (type == WINDOWCACHE_TEXT || type == WINDOWCACHE_CDATA)
+  {
+    TiXmlText *text = new TiXmlText(strings[value].c_str());
+    text->SetCDATA(type == WINDOWCACHE_CDATA);
+    return text;
+  }
+  if (type != WINDOWCACHE_ELEMENT)
+    return NULL;
+
+  TiXmlElement *element = new TiXmlElement(strings[value].c_str());
+  int attributes = 0;
+  ar >> attributes;
+  for (int i = 0; i < attributes; i++)
+  {
+    int name = -1;
+    ar >> name;
+    ar >> value;
+    if (name < 0 || name >= (int)strings.size() || value < 0 || value >= (int)strings.size())
+    {
+      delete element;
+      return NULL;
+    }
+    element->SetAttribute(strings[name].c_str(), strings[value].c_str());
+  }
+
+  int children = 0;
+  ar >> children;
+  for (int i = 0; i < children; i++)
+  {
+    TiXmlNode *child = LoadNode(ar, strings, depth + 1);
+    if (child == NULL)
+    {
+      delete element;
+      return NULL;
+    }
+    element->LinkEndChild(child);
+  }
+  return element;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "interfaces/info/InfoBool.h"
+#include "threads/CriticalSection.h"
+
+class CArchive;
+class CGUIIncludes;
+class TiXmlElement;
+class TiXmlNode;
+
+typedef boost::shared_ptr<TiXmlElement> TiXmlElementPtr;
+
+/*!
+ \ingroup guilib
+ \brief Keeps the window files of a skin with their includes resolved
+
+ Opening a window used to parse its file and resolve the includes, defaults
+ and constants of the whole tree every time. The cache keeps the resolved
+ tree of every window file in memory, and stores it in a compact binary form
+ in a folder of its own, so the next run of the skin doesn't parse or resolve
+ it either.
+
+ Includes can depend on conditions, so a tree is only used while the
+ conditions its includes depended on have the values they had when it was
+ resolved. Stored trees are also dropped once the window file or one of the
+ include files of the skin changed.
+ */
+class CGUIWindowCache
+{
+public:
+  CGUIWindowCache();
+  /*! \brief Copies start out empty, using the same folder */
+  CGUIWindowCache(const CGUIWindowCache &cache);
+  CGUIWindowCache& operator=(const CGUIWindowCache &cache);
+  ~CGUIWindowCache();
+
+  /*! \brief Set the folder the resolved trees are stored in
+   \param folder the folder, or empty to keep them in memory only
+   */
+  void SetFolder(const std::string &folder);
+
+  /*! \brief Drop the trees kept in memory, as the includes they were resolved with changed
+   */
+  void Clear();
+
+  /*! \brief Get the tree of a window file with its includes resolved
+   \param file path of the window file
+   \param includes the includes to resolve the tree with
+   \param xmlIncludeConditions [out] the conditions the includes depended on, and their values
+   \return the tree, or an empty pointer if the file couldn't be loaded. It's shared, so mustn't be changed.
+   */
+  TiXmlElementPtr GetWindow(const std::string &file, CGUIIncludes &includes, std::map<INFO::InfoPtr, bool> &xmlIncludeConditions);
+
+  /*! \brief Get the path a window file is stored at
+   \param file path of the window file
+   \return the path in the cache folder, or empty if there's no cache folder
+   */
+  std::string GetCachedPath(const std::string &file) const;
+
+private:
+  /*! \brief A file the tree was made from, with its modification time and size */
+  struct Source
+  {
+    std::string file;
+    int64_t     time;
+    int64_t     size;
+  };
+
+  struct Window
+  {
+    TiXmlElementPtr                               root;
+    std::vector<Source>                           sources;    ///< the window file first, then the include files
+    std::vector<std::pair<INFO::InfoPtr, bool> >  conditions;
+  };
+
+  static bool GetSource(const std::string &file, Source &source);
+  static bool IsCurrent(const Window &window, std::map<INFO::InfoPtr, bool> &xmlIncludeConditions);
+
+  bool Resolve(const std::string &file, CGUIIncludes &includes, Window &window) const;
+  bool Load(const std::string &file, CGUIIncludes &includes, Window &window) const;
+  void Save(const std::string &file, const Window &window) const;
+
+  static void AddStrings(const TiXmlNode *node, std::map<std::string, int> &strings);
+  static void StoreNode(CArchive &ar, const TiXmlNode *node, const std::map<std::string, int> &strings);
+  static TiXmlNode* LoadNode(CArchive &ar, const std::vector<std::string> &strings, int depth);
+
+  CCriticalSection                                 m_critical;
+  std::string                                      m_folder;
+  std::map<std::string, std::vector<Window> >      m_windows; ///< the resolved trees per window file
+};
@@ -998,6 +998,15 @@ void CGUIWindowManager::GetActiveModelessWindows(vector<int> &ids)
   }
 }
 
+void CGUIWindowManager::GetActiveWindows(vector<CGUIWindow *> &windows) const
+{
+  CSingleLock lock(g_graphicsContext);
+  CGUIWindow *window = GetWindow(GetActiveWindow());
+  if (window)
+    windows.push_back(window);
+  windows.insert(windows.end(), m_activeDialogs.begin(), m_activeDialogs.end());
+}
+
 CGUIWindow *CGUIWindowManager::GetTopMostDialog() const
 {
   CSingleLock lock(g_graphicsContext);
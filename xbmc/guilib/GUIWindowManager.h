@@ -139,6 +139,10 @@ public:
   bool IsOverlayAllowed() const;
   void ShowOverlay(CGUIWindow::OVERLAY_STATE state);
   void GetActiveModelessWindows(std::vector<int> &ids);
+  /*! \brief Get the active window followed by the active dialogs (including closing ones)
+   \param windows the vector the windows are appended to
+   */
+  void GetActiveWindows(std::vector<CGUIWindow *> &windows) const;
 #ifdef _DEBUG
   void DumpTextureUse();
 #endif
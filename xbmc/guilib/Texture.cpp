@@ -209,10 +209,10 @@ CBaseTexture *CBaseTexture::LoadFromFile(const CStdString& texturePath, unsigned
   return NULL;
 }
 
-CBaseTexture *CBaseTexture::LoadFromFileInMemory(unsigned char *buffer, size_t bufferSize, const std::string &mimeType, unsigned int idealWidth, unsigned int idealHeight)
+CBaseTexture *CBaseTexture::LoadFromFileInMemory(unsigned char *buffer, size_t bufferSize, const std::string &mimeType, unsigned int idealWidth, unsigned int idealHeight, bool autoRotate)
 {
   CTexture *texture = new CTexture();
-  if (texture->LoadFromFileInMem(buffer, bufferSize, mimeType, idealWidth, idealHeight))
+  if (texture->LoadFromFileInMem(buffer, bufferSize, mimeType, idealWidth, idealHeight, autoRotate))
     return texture;
   delete texture;
   return NULL;
@@ -266,7 +266,7 @@ bool CBaseTexture::LoadFromFileInternal(const CStdString& texturePath, unsigned
   return true;
 }
 
-bool CBaseTexture::LoadFromFileInMem(unsigned char* buffer, size_t size, const std::string& mimeType, unsigned int maxWidth, unsigned int maxHeight)
+bool CBaseTexture::LoadFromFileInMem(unsigned char* buffer, size_t size, const std::string& mimeType, unsigned int maxWidth, unsigned int maxHeight, bool autoRotate)
 {
   if (!buffer || !size)
     return false;
@@ -275,7 +275,7 @@ bool CBaseTexture::LoadFromFileInMem(unsigned char* buffer, size_t size, const s
   unsigned int height = maxHeight ? std::min(maxHeight, g_Windowing.GetMaxTextureSize()) : g_Windowing.GetMaxTextureSize();
 
   IImage* pImage = ImageFactory::CreateLoaderFromMimeType(mimeType);
-  if(!LoadIImage(pImage, buffer, size, width, height))
+  if(!LoadIImage(pImage, buffer, size, width, height, autoRotate))
   {
     delete pImage;
     pImage = ImageFactory::CreateFallbackLoader(mimeType);
@@ -27,6 +27,22 @@ class CGUIListItem;
 
 namespace INFO
 {
+/*!
+ \ingroup info
+ \brief The state an info bool reads, so that it's only re-evaluated when that state changes
+ */
+enum InfoDependency
+{
+  DEPENDS_NONE    = 0x00,        ///< constant, evaluated once
+  DEPENDS_PLAYER  = 0x01,        ///< whether (and what) is playing, pause state and play speed
+  DEPENDS_WINDOW  = 0x02,        ///< the active window, the active dialogs and the window history
+  DEPENDS_FOCUS   = 0x04,        ///< the focused control of the active window and dialogs
+  DEPENDS_TIME    = 0x08,        ///< the time of day, in minutes
+  DEPENDS_SKIN    = 0x10,        ///< skin settings
+  DEPENDS_LIBRARY = 0x20,        ///< library content
+  DEPENDS_ALWAYS  = 0x80000000   ///< state we don't track, re-evaluated every frame
+};
+
 /*!
  \ingroup info
  \brief Base class, wrapping boolean conditions and expressions
@@ -44,6 +60,14 @@ public:
   {
     m_dirty = true;
   }
+  /*! \brief Set the info bool dirty if it depends on any of the changed state.
+   \param changed the InfoDependency flags of the state that has changed
+   */
+  void SetDirty(unsigned int changed)
+  {
+    if (m_dependencies & changed)
+      m_dirty = true;
+  }
   /*! \brief Get the value of this info bool
    This is called to update (if dirty) and fetch the value of the info bool
    \param item the item used to evaluate the bool
@@ -73,11 +97,13 @@ public:
 
   const std::string &GetExpression() const { return m_expression; }
   bool ListItemDependent() const { return m_listItemDependent; }
+  unsigned int GetDependencies() const { return m_dependencies; }
 protected:
 
   bool m_value;                ///< current value
   int m_context;               ///< contextual information to go with the condition
   bool m_listItemDependent;    ///< do not cache if a listitem pointer is given
+  unsigned int m_dependencies; ///< InfoDependency flags of the state the value is based on
 
 private:
   std::string  m_expression;   ///< original expression
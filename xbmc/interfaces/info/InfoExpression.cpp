@@ -19,7 +19,7 @@
  */
 
 #include "InfoExpression.h"
-#include <stack>
+#include <algorithm>
 #include "utils/log.h"
 #include "GUIInfoManager.h"
 
@@ -30,6 +30,9 @@ InfoSingle::InfoSingle(const std::string &expression, int context)
 : InfoBool(expression, context)
 {
   m_condition = g_infoManager.TranslateSingleString(expression, m_listItemDependent);
+  // conditions on the focused list item have to be evaluated every time
+  if (!m_listItemDependent)
+    m_dependencies = g_infoManager.GetDependencies(m_condition);
 }
 
 void InfoSingle::Update(const CGUIListItem *item)
@@ -40,149 +43,173 @@ void InfoSingle::Update(const CGUIListItem *item)
 InfoExpression::InfoExpression(const std::string &expression, int context)
 : InfoBool(expression, context)
 {
-  Parse(expression);
+  if (!Parse(expression))
+  {
+    CLog::Log(LOGERROR, "Error parsing boolean expression %s", expression.c_str());
+    m_program.clear();
+    m_operands.clear();
+    m_listItemDependent = false;
+  }
+
+  // we're dirty whenever one of our operands may be
+  m_dependencies = DEPENDS_NONE;
+  for (vector<InfoPtr>::const_iterator i = m_operands.begin(); i != m_operands.end(); ++i)
+    m_dependencies |= (*i)->GetDependencies();
 }
 
 void InfoExpression::Update(const CGUIListItem *item)
 {
-  Evaluate(item, m_value);
+  m_value = Evaluate(item);
 }
 
-#define OPERATOR_LB   5
-#define OPERATOR_RB   4
-#define OPERATOR_NOT  3
-#define OPERATOR_AND  2
-#define OPERATOR_OR   1
+#define OPERATOR_NOT  -1  // negates the value
+#define OPERATOR_AND  -2  // jumps to the following target if the value is false
+#define OPERATOR_OR   -3  // jumps to the following target if the value is true
 
-short InfoExpression::GetOperator(const char ch) const
+static void SkipSpaces(const std::string &expression, size_t &pos)
 {
-  if (ch == '[')
-    return OPERATOR_LB;
-  else if (ch == ']')
-    return OPERATOR_RB;
-  else if (ch == '!')
-    return OPERATOR_NOT;
-  else if (ch == '+')
-    return OPERATOR_AND;
-  else if (ch == '|')
-    return OPERATOR_OR;
-  else
-    return 0;
+  while (pos < expression.size() && isspace((unsigned char)expression[pos]))
+    pos++;
 }
 
-void InfoExpression::Parse(const std::string &expression)
+// returns the position of the bracket closing the one at pos, or npos if it isn't closed
+static size_t FindClosingBracket(const std::string &expression, size_t pos)
 {
-  stack<char> operators;
-  std::string operand;
-  for (unsigned int i = 0; i < expression.size(); i++)
+  int depth = 0;
+  for (; pos < expression.size(); pos++)
   {
-    if (GetOperator(expression[i]))
-    {
-      // cleanup any operand, translate and put into our expression list
-      if (!operand.empty())
-      {
-        InfoPtr info = g_infoManager.Register(operand, m_context);
-        if (info)
-        {
-          m_listItemDependent |= info->ListItemDependent();
-          m_postfix.push_back(m_operands.size());
-          m_operands.push_back(info);
-        }
-        operand.clear();
-      }
-      // handle closing parenthesis
-      if (expression[i] == ']')
-      {
-        while (!operators.empty())
-        {
-          char oper = operators.top();
-          operators.pop();
-
-          if (oper == '[')
-            break;
-
-          m_postfix.push_back(-GetOperator(oper)); // negative denotes operator
-        }
-      }
-      else
-      {
-        // all other operators we pop off the stack any operator
-        // that has a higher priority than the one we have.
-        while (!operators.empty() && GetOperator(operators.top()) > GetOperator(expression[i]))
-        {
-          // only handle parenthesis once they're closed.
-          if (operators.top() == '[' && expression[i] != ']')
-            break;
-
-          m_postfix.push_back(-GetOperator(operators.top()));  // negative denotes operator
-          operators.pop();
-        }
-        operators.push(expression[i]);
-      }
-    }
-    else
-    {
-      operand += expression[i];
-    }
+    if (expression[pos] == '[')
+      depth++;
+    else if (expression[pos] == ']' && --depth == 0)
+      return pos;
   }
+  return std::string::npos;
+}
+
+bool InfoExpression::Parse(const std::string &expression)
+{
+  // an expression in brackets would otherwise end up as its only operand
+  std::string strip(expression);
+  while (!strip.empty() && strip[0] == '[' && FindClosingBracket(strip, 0) == strip.size() - 1)
+    strip = strip.substr(1, strip.size() - 2);
+
+  size_t pos = 0;
+  if (!ParseOr(strip, pos))
+    return false;
+  SkipSpaces(strip, pos);
+  return pos == strip.size();
+}
 
-  if (!operand.empty())
+// the operands of OR are ANDs, which bind tighter
+bool InfoExpression::ParseOr(const std::string &expression, size_t &pos)
+{
+  vector<size_t> jumps;
+  if (!ParseAnd(expression, pos))
+    return false;
+  SkipSpaces(expression, pos);
+  while (pos < expression.size() && expression[pos] == '|')
   {
-    InfoPtr info = g_infoManager.Register(operand, m_context);
-    if (info)
-    {
-      m_listItemDependent |= info->ListItemDependent();
-      m_postfix.push_back(m_operands.size());
-      m_operands.push_back(info);
-    }
+    pos++;
+    m_program.push_back(OPERATOR_OR);
+    jumps.push_back(m_program.size());
+    m_program.push_back(0);
+    if (!ParseAnd(expression, pos))
+      return false;
+    SkipSpaces(expression, pos);
   }
+  // a true value skips all remaining terms
+  for (vector<size_t>::const_iterator i = jumps.begin(); i != jumps.end(); ++i)
+    m_program[*i] = m_program.size();
+  return true;
+}
 
-  // finish up by adding any operators
-  while (!operators.empty())
+bool InfoExpression::ParseAnd(const std::string &expression, size_t &pos)
+{
+  vector<size_t> jumps;
+  if (!ParseOperand(expression, pos))
+    return false;
+  SkipSpaces(expression, pos);
+  while (pos < expression.size() && expression[pos] == '+')
   {
-    m_postfix.push_back(-GetOperator(operators.top()));  // negative denotes operator
-    operators.pop();
+    pos++;
+    m_program.push_back(OPERATOR_AND);
+    jumps.push_back(m_program.size());
+    m_program.push_back(0);
+    if (!ParseOperand(expression, pos))
+      return false;
+    SkipSpaces(expression, pos);
   }
-
-  // test evaluate
-  bool test;
-  if (!Evaluate(NULL, test))
-    CLog::Log(LOGERROR, "Error evaluating boolean expression %s", expression.c_str());
+  // a false value skips all remaining factors, landing on the enclosing OR if any
+  for (vector<size_t>::const_iterator i = jumps.begin(); i != jumps.end(); ++i)
+    m_program[*i] = m_program.size();
+  return true;
 }
 
-bool InfoExpression::Evaluate(const CGUIListItem *item, bool &result)
+bool InfoExpression::ParseOperand(const std::string &expression, size_t &pos)
 {
-  stack<bool> save;
-  for (vector<short>::const_iterator it = m_postfix.begin(); it != m_postfix.end(); ++it)
+  SkipSpaces(expression, pos);
+  if (pos >= expression.size())
+    return false;
+
+  if (expression[pos] == '!')
   {
-    short expr = *it;
-    if (expr == -OPERATOR_NOT)
-    { // NOT the top item on the stack
-      if (save.empty()) return false;
-      bool expr = save.top();
-      save.pop();
-      save.push(!expr);
-    }
-    else if (expr == -OPERATOR_AND)
-    { // AND the top two items on the stack
-      if (save.size() < 2) return false;
-      bool right = save.top(); save.pop();
-      bool left = save.top(); save.pop();
-      save.push(left && right);
-    }
-    else if (expr == -OPERATOR_OR)
-    { // OR the top two items on the stack
-      if (save.size() < 2) return false;
-      bool right = save.top(); save.pop();
-      bool left = save.top(); save.pop();
-      save.push(left || right);
-    }
-    else if (expr >= 0) // operand
-      save.push(m_operands[expr]->Get(item));
+    pos++;
+    if (!ParseOperand(expression, pos))
+      return false;
+    m_program.push_back(OPERATOR_NOT);
+    return true;
+  }
+
+  if (expression[pos] == '[')
+  { // register the sub-expression on its own so it's shared with other expressions
+    size_t end = FindClosingBracket(expression, pos);
+    if (end == std::string::npos)
+      return false;
+    std::string operand = expression.substr(pos + 1, end - pos - 1);
+    pos = end + 1;
+    return AddOperand(operand);
   }
-  if (save.size() != 1)
+
+  size_t end = expression.find_first_of("[]!+|", pos);
+  if (end == std::string::npos)
+    end = expression.size();
+  std::string operand = expression.substr(pos, end - pos);
+  pos = end;
+  return AddOperand(operand);
+}
+
+bool InfoExpression::AddOperand(const std::string &operand)
+{
+  InfoPtr info = g_infoManager.Register(operand, m_context);
+  if (!info)
     return false;
-  result = save.top();
+
+  m_listItemDependent |= info->ListItemDependent();
+  // the same operand may appear more than once (e.g. a + b | !a + c)
+  vector<InfoPtr>::const_iterator i = find(m_operands.begin(), m_operands.end(), info);
+  m_program.push_back(i - m_operands.begin());
+  if (i == m_operands.end())
+    m_operands.push_back(info);
   return true;
 }
 
+bool InfoExpression::Evaluate(const CGUIListItem *item)
+{
+  bool value = false;
+  size_t pc = 0;
+  while (pc < m_program.size())
+  {
+    short code = m_program[pc++];
+    if (code >= 0)
+      value = m_operands[code]->Get(item);
+    else if (code == OPERATOR_NOT)
+      value = !value;
+    else
+    { // the left hand side decides the result if it's false for AND, or true for OR
+      short target = m_program[pc++];
+      if (value == (code == OPERATOR_OR))
+        pc = target;
+    }
+  }
+  return value;
+}
@@ -41,6 +41,12 @@ private:
 };
 
 /*! \brief Class to wrap active boolean expressions
+
+ The expression is compiled to a short program of operand indices and operators. Operands,
+ including bracketed sub-expressions, are registered info bools so that they're shared with
+ every other expression using them and evaluated at most once per frame. AND and OR jump
+ over their right hand side when the left hand side decides the result, so evaluation needs
+ no stack and doesn't allocate.
  */
 class InfoExpression : public InfoBool
 {
@@ -50,11 +56,14 @@ public:
 
   virtual void Update(const CGUIListItem *item);
 private:
-  void Parse(const std::string &expression);
-  bool Evaluate(const CGUIListItem *item, bool &result);
-  short GetOperator(const char ch) const;
+  bool Parse(const std::string &expression);
+  bool ParseOr(const std::string &expression, size_t &pos);
+  bool ParseAnd(const std::string &expression, size_t &pos);
+  bool ParseOperand(const std::string &expression, size_t &pos);
+  bool AddOperand(const std::string &operand);
+  bool Evaluate(const CGUIListItem *item);
 
-  std::vector<short> m_postfix;         ///< the postfix form of the expression (operators and operand indicies)
+  std::vector<short> m_program;         ///< operand indices and operators (negative), AND and OR are followed by their jump target
   std::vector<InfoPtr> m_operands;      ///< the operands in the expression
 };
 
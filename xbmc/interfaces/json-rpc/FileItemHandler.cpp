@@ -28,6 +28,7 @@
 #include "FileOperations.h"
 #include "utils/URIUtils.h"
 #include "utils/ISerializable.h"
+#include "utils/JSONStreamWriter.h"
 #include "utils/Variant.h"
 #include "video/VideoInfoTag.h"
 #include "music/tags/MusicInfoTag.h"
@@ -242,10 +243,30 @@ void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const
       fields.insert(field->asString());
   }
 
-  for (int i = start; i < end; i++)
+  CResponseStream *stream = NULL;
+  if (resultname != NULL && end - start > 0)
+    stream = CResponseStream::Get(result);
+
+  if (stream != NULL)
+  {
+    // the items go out one by one, the list is never built
+    CJSONStreamWriter &writer = stream->BeginMember(resultname);
+    writer.OpenArray();
+    for (int i = start; i < end && !writer.Failed(); i++)
+    {
+      CVariant object;
+      HandleFileItem(ID, allowFile, resultname, items.Get(i), parameterObject, fields, object, false, thumbLoader);
+      writer.WriteValue(object[resultname]);
+    }
+    writer.CloseArray();
+  }
+  else
   {
-    CFileItemPtr item = items.Get(i);
-    HandleFileItem(ID, allowFile, resultname, item, parameterObject, fields, result, true, thumbLoader);
+    for (int i = start; i < end; i++)
+    {
+      CFileItemPtr item = items.Get(i);
+      HandleFileItem(ID, allowFile, resultname, item, parameterObject, fields, result, true, thumbLoader);
+    }
   }
 
   delete thumbLoader;
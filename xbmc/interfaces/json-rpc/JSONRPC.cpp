@@ -27,6 +27,8 @@
 #include "interfaces/AnnouncementManager.h"
 #include "playlists/SmartPlayList.h"
 #include "settings/AdvancedSettings.h"
+#include "threads/ThreadLocal.h"
+#include "utils/JSONStreamWriter.h"
 #include "utils/log.h"
 #include "utils/StringUtils.h"
 #include "utils/Variant.h"
@@ -38,6 +40,75 @@ using namespace std;
 
 bool CJSONRPC::m_initialized = false;
 
+static XbmcThreads::ThreadLocal<CResponseStream> CurrentStream;
+
+CResponseStream::CResponseStream(CJSONStreamWriter &writer, const CVariant &id, const CVariant &result)
+  : m_writer(writer), m_id(id), m_result(&result), m_started(false)
+{
+  m_previous = CurrentStream.get();
+  CurrentStream.set(this);
+}
+
+CResponseStream::~CResponseStream()
+{
+  CurrentStream.set(m_previous);
+}
+
+CResponseStream* CResponseStream::Get(const CVariant &result)
+{
+  CResponseStream *stream = CurrentStream.get();
+  if (stream == NULL || stream->m_result != &result)
+    return NULL;
+
+  return stream;
+}
+
+CJSONStreamWriter& CResponseStream::BeginMember(const std::string &name)
+{
+  if (!m_started)
+  {
+    // the members in the order BuildResponse() gives them
+    m_writer.OpenObject();
+    m_writer.WriteKey("id");
+    m_writer.WriteValue(m_id);
+    m_writer.WriteKey("jsonrpc");
+    m_writer.WriteValue("2.0");
+    m_writer.WriteKey("result");
+    m_writer.OpenObject();
+    m_started = true;
+  }
+
+  m_members.insert(name);
+  m_writer.WriteKey(name);
+  return m_writer;
+}
+
+void CResponseStream::Finish(const CVariant &result)
+{
+  if (result.isObject())
+  {
+    for (CVariant::const_iterator_map itr = result.begin_map(); itr != result.end_map(); itr++)
+    {
+      if (m_members.find(itr->first) != m_members.end())
+        continue;
+
+      m_writer.WriteKey(itr->first);
+      m_writer.WriteValue(itr->second);
+    }
+  }
+
+  m_writer.CloseObject();
+  m_writer.CloseObject();
+}
+
+void CResponseStream::Fail(const CVariant &error)
+{
+  m_writer.CloseObject();
+  m_writer.WriteKey("error");
+  m_writer.WriteValue(error);
+  m_writer.CloseObject();
+}
+
 void CJSONRPC::Initialize()
 {
   if (m_initialized)
@@ -229,8 +300,16 @@ JSONRPC_STATUS CJSONRPC::NotifyAll(const CStdString &method, ITransportLayer *tr
 
 CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client)
 {
-  CVariant inputroot, outputroot, result;
-  bool hasResponse = false;
+  std::string str;
+  CJSONStringOutput output(str);
+  MethodCall(inputString, transport, client, &output);
+  return str;
+}
+
+bool CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client, IJSONStreamOutput *output)
+{
+  CVariant inputroot, outputroot;
+  CJSONStreamWriter writer(output, g_advancedSettings.m_jsonOutputCompact);
 
   if(g_advancedSettings.CanLogComponent(LOGJSONRPC))
     CLog::Log(LOGDEBUG, "JSONRPC: Incoming request: %s", inputString.c_str());
@@ -244,36 +323,40 @@ CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *
       {
         CLog::Log(LOGERROR, "JSONRPC: Empty batch call\n");
         BuildResponse(inputroot, InvalidRequest, CVariant(), outputroot);
-        hasResponse = true;
+        writer.WriteValue(outputroot);
       }
       else
       {
+        // a batch of notifications isn't answered at all
+        bool hasResponse = false;
+        for (CVariant::const_iterator_array itr = inputroot.begin_array(); itr != inputroot.end_array() && !hasResponse; itr++)
+          hasResponse = !IsProperJSONRPC(*itr) || itr->isMember("id");
+
+        if (hasResponse)
+          writer.OpenArray();
+
         for (CVariant::const_iterator_array itr = inputroot.begin_array(); itr != inputroot.end_array(); itr++)
-        {
-          CVariant response;
-          if (HandleMethodCall(*itr, response, transport, client))
-          {
-            outputroot.append(response);
-            hasResponse = true;
-          }
-        }
+          HandleMethodCall(*itr, writer, transport, client);
+
+        if (hasResponse)
+          writer.CloseArray();
       }
     }
     else
-      hasResponse = HandleMethodCall(inputroot, outputroot, transport, client);
+      HandleMethodCall(inputroot, writer, transport, client);
   }
   else
   {
     CLog::Log(LOGERROR, "JSONRPC: Failed to parse '%s'\n", inputString.c_str());
     BuildResponse(inputroot, ParseError, CVariant(), outputroot);
-    hasResponse = true;
+    writer.WriteValue(outputroot);
   }
 
-  CStdString str = hasResponse ? CJSONVariantWriter::Write(outputroot, g_advancedSettings.m_jsonOutputCompact) : "";
-  return str;
+  writer.Flush();
+  return writer.Written() > 0;
 }
 
-bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client)
+bool CJSONRPC::HandleMethodCall(const CVariant& request, CJSONStreamWriter &writer, ITransportLayer *transport, IClient *client)
 {
   JSONRPC_STATUS errorCode = OK;
   CVariant result;
@@ -289,10 +372,31 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
     JSONRPC::MethodCall method;
     CVariant params;
 
-    if ((errorCode = CJSONServiceDescription::CheckCall(methodName, request["params"], transport, client, isNotification, method, params)) == OK)
+    if ((errorCode = CJSONServiceDescription::CheckCall(methodName, request["params"], transport, client, isNotification, method, params)) != OK)
+      result = params;
+    else if (isNotification)
       errorCode = method(methodName, transport, client, params, result);
     else
-      result = params;
+    {
+      CResponseStream stream(writer, request["id"], result);
+      errorCode = method(methodName, transport, client, params, result);
+
+      if (stream.HasStarted())
+      {
+        // part of the result is out already, leave out what the method added
+        // to its result before it failed and tell the client it did
+        if (errorCode != OK && errorCode != ACK)
+        {
+          CLog::Log(LOGERROR, "JSONRPC: %s failed after its response was started", methodName.c_str());
+          CVariant response;
+          BuildResponse(request, errorCode, result, response);
+          stream.Fail(response["error"]);
+        }
+        else
+          stream.Finish(result);
+        return true;
+      }
+    }
   }
   else
   {
@@ -300,9 +404,14 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
     errorCode = InvalidRequest;
   }
 
+  if (isNotification)
+    return false;
+
+  CVariant response;
   BuildResponse(request, errorCode, result, response);
+  writer.WriteValue(response);
 
-  return !isNotification;
+  return true;
 }
 
 inline bool CJSONRPC::IsProperJSONRPC(const CVariant& inputroot)
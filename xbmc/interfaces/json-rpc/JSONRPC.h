@@ -21,6 +21,7 @@
 
 #include <iostream>
 #include <map>
+#include <set>
 #include <stdio.h>
 #include <string>
 
@@ -29,8 +30,71 @@
 #include "interfaces/IAnnouncer.h"
 #include "utils/StdString.h"
 
+class CJSONStreamWriter;
+class IJSONStreamOutput;
+
 namespace JSONRPC
 {
+  /*!
+   \ingroup jsonrpc
+   \brief Response of a method call written while the method runs
+
+   A method producing a long list can write it straight to the transport
+   rather than building it in its result first. The response is started
+   with the first member written this way, the members the method put in
+   its result are written after it returns.
+
+   Once the response is started it can't be turned into a plain error
+   anymore. If the method fails afterwards the result is closed right after
+   the members written so far and the response ends with the error member
+   the method would have been answered with, so a client can tell the
+   result is incomplete.
+   */
+  class CResponseStream
+  {
+  public:
+    /*!
+     \brief Gets the streamed response of the call handled by this thread
+     \param result Object the caller would otherwise add its members to
+     \return The stream, NULL unless the response is streamed and result is the result of the call
+     */
+    static CResponseStream* Get(const CVariant &result);
+
+    /*!
+     \brief Starts writing a member of the result
+     \param name Name of the member, the result must not contain it as well
+     \return Writer to write the value of the member with
+     */
+    CJSONStreamWriter& BeginMember(const std::string &name);
+
+  private:
+    friend class CJSONRPC;
+
+    CResponseStream(CJSONStreamWriter &writer, const CVariant &id, const CVariant &result);
+    ~CResponseStream();
+
+    bool HasStarted() const { return m_started; }
+
+    /*!
+     \brief Writes the members of the result not written yet and ends the response
+     \param result Result of the call
+     */
+    void Finish(const CVariant &result);
+
+    /*!
+     \brief Ends the result after the members written so far and adds an error to the response
+     \param error Error member of the response, see CJSONRPC::BuildResponse()
+     */
+    void Fail(const CVariant &error);
+
+    CJSONStreamWriter &m_writer;
+    const CVariant &m_id;
+    const CVariant *m_result;
+    CResponseStream *m_previous;
+    bool m_started;
+    std::set<std::string> m_members;
+  };
+
   /*!
    \ingroup jsonrpc
    \brief JSON RPC handler
@@ -64,6 +128,21 @@ namespace JSONRPC
      */
     static CStdString MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client);
 
+    /*
+     \brief Handles an incoming JSON-RPC request
+     \param inputString received JSON-RPC request
+     \param transport Transport protocol on which the request arrived
+     \param client Client which sent the request
+     \param output Destination of the JSON-RPC response
+     \return true if a response was written
+
+     Like the above but the response is handed to output in chunks while
+     it is produced, methods returning long lists write them item by item
+     (see CResponseStream). A method failing after its list went out gives
+     the partial result followed by an error member.
+     */
+    static bool MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client, IJSONStreamOutput *output);
+
     static JSONRPC_STATUS Introspect(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSONRPC_STATUS Version(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSONRPC_STATUS Permission(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
@@ -74,7 +153,7 @@ namespace JSONRPC
   
   private:
     static void setup();
-    static bool HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client);
+    static bool HandleMethodCall(const CVariant& request, CJSONStreamWriter &writer, ITransportLayer *transport, IClient *client);
     static inline bool IsProperJSONRPC(const CVariant& inputroot);
 
     inline static void BuildResponse(const CVariant& request, JSONRPC_STATUS code, const CVariant& result, CVariant& response);
@@ -0,0 +1,241 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined TARGET_WINDOWS)
+  #include "config.h"
+#endif
+
+// python.h should always be included first before any other includes
+#include <Python.h>
+
+#include "system.h"
+#include "PythonInterpreterPool.h"
+#include "settings/AdvancedSettings.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/log.h"
+#include "utils/StringUtils.h"
+
+using namespace std;
+
+CPythonInterpreterPool::CPythonInterpreterPool()
+{ }
+
+CPythonInterpreterPool::~CPythonInterpreterPool()
+{
+  // the interpreters are ended by XBPython before python is finalized,
+  // by now there's no python left to end them with
+}
+
+bool CPythonInterpreterPool::IsPooled(const ADDON::AddonPtr &addon)
+{
+  if (addon.get() == NULL || addon->Type() != ADDON::ADDON_PLUGIN)
+    return false;
+
+  return g_advancedSettings.m_pythonPoolSize > 0 &&
+         g_advancedSettings.m_pythonPoolAddons.find(addon->ID()) != g_advancedSettings.m_pythonPoolAddons.end();
+}
+
+void* CPythonInterpreterPool::Acquire(const string &script, string &pythonPath)
+{
+  void *interpreter = NULL;
+  {
+    CSingleLock lock(m_critical);
+    InterpreterMap::iterator i = m_interpreters.find(script);
+    if (i == m_interpreters.end())
+      return NULL;
+
+    // the last one released is the one most likely still in memory
+    interpreter = i->second.back().interpreter;
+    pythonPath = i->second.back().pythonPath;
+    i->second.pop_back();
+    if (i->second.empty())
+      m_interpreters.erase(i);
+  }
+
+  return PyThreadState_New((PyInterpreterState*)interpreter);
+}
+
+bool CPythonInterpreterPool::Reset(void *threadState, const string &moduleFolder)
+{
+  // threads the script started would keep running in the next run
+  PyThreadState *state = (PyThreadState*)threadState;
+  if (state == NULL || state->interp->tstate_head != state || state->next != NULL)
+    return false;
+
+  PyObject *module = PyImport_AddModule((char*)"__main__"); // borrowed ref
+  if (module == NULL)
+  {
+    PyErr_Clear();
+    return false;
+  }
+
+  // start the next run with an empty __main__, the way a new interpreter has it
+  PyObject *dict = PyModule_GetDict(module); // borrowed ref
+  PyDict_Clear(dict);
+  PyDict_SetItemString(dict, "__builtins__", PyEval_GetBuiltins());
+  PyObject *name = PyString_FromString("__main__");
+  PyDict_SetItemString(dict, "__name__", name);
+  Py_DECREF(name);
+  PyDict_SetItemString(dict, "__doc__", Py_None);
+  PyDict_SetItemString(dict, "__package__", Py_None);
+
+  // drop the modules of the script itself, so they're imported again with the next arguments
+  PyObject *modules = PyImport_GetModuleDict(); // borrowed ref
+  vector<PyObject*> dropped;
+  PyObject *key, *value;
+  Py_ssize_t pos = 0;
+  while (PyDict_Next(modules, &pos, &key, &value))
+  {
+    if (value == NULL || !PyModule_Check(value))
+      continue;
+
+    const char *file = PyModule_GetFilename(value); // internal data, don't delete
+    if (file == NULL)
+    {
+      // built in modules have no file
+      PyErr_Clear();
+      continue;
+    }
+
+    size_t length = moduleFolder.size();
+    if (length > 0 && strlen(file) > length && StringUtils::StartsWith(file, moduleFolder.c_str()) &&
+        (file[length] == '/' || file[length] == '\\'))
+    {
+      Py_INCREF(key);
+      dropped.push_back(key);
+    }
+  }
+
+  for (vector<PyObject*>::iterator i = dropped.begin(); i != dropped.end(); ++i)
+  {
+    PyDict_DelItem(modules, *i);
+    Py_DECREF(*i);
+  }
+
+  // collect the objects of the script, so classes of the xbmc modules it held are gone
+  PyGC_Collect();
+  PyErr_Clear();
+  return true;
+}
+
+bool CPythonInterpreterPool::Release(const string &script, void *threadState, const string &pythonPath)
+{
+  PyThreadState *state = (PyThreadState*)threadState;
+  if (state == NULL || state->interp->tstate_head != state || state->next != NULL)
+    return false;
+
+  { CSingleLock lock(m_critical);
+    InterpreterMap::const_iterator i = m_interpreters.find(script);
+    if (i != m_interpreters.end() && i->second.size() >= g_advancedSettings.m_pythonPoolSize)
+      return false;
+  }
+
+  PyInterpreterState *interpreter = state->interp;
+  PyThreadState_Clear(state);
+  PyThreadState_Swap(NULL);
+  PyThreadState_Delete(state);
+
+  Interpreter kept;
+  kept.interpreter = interpreter;
+  kept.pythonPath = pythonPath;
+  kept.released = XbmcThreads::SystemClockMillis();
+
+  CSingleLock lock(m_critical);
+  InterpreterMap::iterator i = m_interpreters.find(script);
+  if (i != m_interpreters.end() && i->second.size() >= g_advancedSettings.m_pythonPoolSize)
+  {
+    // another run of the script was kept meanwhile, and we still hold the GIL
+    state = PyThreadState_New(interpreter);
+    PyThreadState_Swap(state);
+    Py_EndInterpreter(state);
+    PyThreadState_Swap(NULL);
+    return true;
+  }
+  vector<Interpreter> &interpreters = m_interpreters[script];
+  interpreters.push_back(kept);
+  CLog::Log(LOGDEBUG, "%s - keeping the interpreter of %s (%u kept)", __FUNCTION__, script.c_str(), (unsigned int)interpreters.size());
+  return true;
+}
+
+void CPythonInterpreterPool::Expire(unsigned int idleTime)
+{
+  vector<Interpreter> expired;
+  {
+    CSingleLock lock(m_critical);
+    unsigned int now = XbmcThreads::SystemClockMillis();
+    for (InterpreterMap::iterator i = m_interpreters.begin(); i != m_interpreters.end();)
+    {
+      // released in order, so the ones still in use follow the expired ones
+      vector<Interpreter>::iterator j = i->second.begin();
+      while (j != i->second.end() && now - j->released >= idleTime)
+        ++j;
+      expired.insert(expired.end(), i->second.begin(), j);
+      i->second.erase(i->second.begin(), j);
+
+      if (i->second.empty())
+        m_interpreters.erase(i++);
+      else
+        ++i;
+    }
+  }
+
+  if (!expired.empty())
+    CLog::Log(LOGDEBUG, "%s - ending %u unused interpreters", __FUNCTION__, (unsigned int)expired.size());
+  End(expired);
+}
+
+void CPythonInterpreterPool::Clear()
+{
+  vector<Interpreter> interpreters;
+  {
+    CSingleLock lock(m_critical);
+    for (InterpreterMap::const_iterator i = m_interpreters.begin(); i != m_interpreters.end(); ++i)
+      interpreters.insert(interpreters.end(), i->second.begin(), i->second.end());
+    m_interpreters.clear();
+  }
+
+  End(interpreters);
+}
+
+size_t CPythonInterpreterPool::Size() const
+{
+  CSingleLock lock(m_critical);
+  size_t size = 0;
+  for (InterpreterMap::const_iterator i = m_interpreters.begin(); i != m_interpreters.end(); ++i)
+    size += i->second.size();
+  return size;
+}
+
+void CPythonInterpreterPool::End(const vector<Interpreter> &interpreters)
+{
+  if (interpreters.empty())
+    return;
+
+  PyEval_AcquireLock();
+  for (vector<Interpreter>::const_iterator i = interpreters.begin(); i != interpreters.end(); ++i)
+  {
+    PyThreadState *state = PyThreadState_New((PyInterpreterState*)i->interpreter);
+    PyThreadState_Swap(state);
+    Py_EndInterpreter(state);
+    PyThreadState_Swap(NULL);
+  }
+  PyEval_ReleaseLock();
+}
@@ -0,0 +1,119 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "addons/IAddon.h"
+#include "threads/CriticalSection.h"
+
+/*!
+ \brief Keeps the python interpreters of plugins between runs
+
+ Every run of a script starts a new sub-interpreter, which sets up the xbmc
+ modules, runs the initialization script and imports every module the script
+ uses all over again. Plugins are run once for every directory they list, so
+ for them most of that time goes into starting up rather than listing.
+
+ The pool keeps the interpreter of a plugin which ran without problems, and
+ hands it to the next run of the same plugin, which then only runs the script.
+ Modules the plugin imported from its own folder are dropped from sys.modules
+ when it's kept, as they may have kept the arguments of the run that imported
+ them, so only modules of python itself and of other add-ons stay imported.
+
+ It's opt-in per plugin through the \<pythonpool\> element of
+ advancedsettings.xml, as a plugin could still keep state in those modules.
+
+ The thread states and interpreters are PyThreadState and PyInterpreterState
+ pointers, which are void* so Python.h isn't drawn into the header.
+ */
+class CPythonInterpreterPool
+{
+public:
+  CPythonInterpreterPool();
+  ~CPythonInterpreterPool();
+
+  /*! \brief Whether the interpreters of an add-on are kept between runs
+   \param addon the add-on the script belongs to
+   \return true if it's a plugin listed in advancedsettings.xml
+   */
+  static bool IsPooled(const ADDON::AddonPtr &addon);
+
+  /*! \brief Take a kept interpreter of a script
+   Must be called holding the GIL with no thread state swapped in.
+   \param script path of the script
+   \param pythonPath [out] the python path the interpreter was set up with
+   \return a new thread state of the interpreter, or NULL if none is kept
+   */
+  void* Acquire(const std::string &script, std::string &pythonPath);
+
+  /*! \brief Reset the interpreter of a script that ran, so it can be kept
+   Empties __main__, drops the modules of the script and collects what they left.
+   Must be called holding the GIL with the thread state swapped in.
+   \param threadState the thread state the script ran in
+   \param moduleFolder the folder of the modules to drop, in system encoding
+   \return false if the interpreter can't be kept, as threads of the script are still around
+   */
+  static bool Reset(void *threadState, const std::string &moduleFolder);
+
+  /*! \brief Keep the reset interpreter of a script for its next run
+   Must be called holding the GIL with the only thread state of the interpreter
+   swapped in. If the interpreter is kept the thread state is swapped out and deleted.
+   \param script path of the script
+   \param threadState the thread state the script ran in
+   \param pythonPath the python path the interpreter was set up with
+   \return true if it's taken care of, false if the caller should end it
+   */
+  bool Release(const std::string &script, void *threadState, const std::string &pythonPath);
+
+  /*! \brief End interpreters which weren't used for a while
+   Must be called without holding the GIL.
+   \param idleTime the milliseconds an interpreter is kept without being used
+   */
+  void Expire(unsigned int idleTime);
+
+  /*! \brief End all kept interpreters
+   Must be called without holding the GIL.
+   */
+  void Clear();
+
+  /*! \brief Get the number of kept interpreters
+   */
+  size_t Size() const;
+
+private:
+  CPythonInterpreterPool(const CPythonInterpreterPool&);
+  CPythonInterpreterPool const& operator=(CPythonInterpreterPool const&);
+
+  struct Interpreter
+  {
+    void        *interpreter;
+    std::string  pythonPath;
+    unsigned int released;
+  };
+  typedef std::map<std::string, std::vector<Interpreter> > InterpreterMap;
+
+  static void End(const std::vector<Interpreter> &interpreters);
+
+  mutable CCriticalSection m_critical;
+  InterpreterMap           m_interpreters; ///< the kept interpreters per script, last released last
+};
@@ -39,6 +39,7 @@
 #include "interfaces/legacy/Addon.h"
 #include "interfaces/python/LanguageHook.h"
 #include "interfaces/python/PyContext.h"
+#include "interfaces/python/PythonInterpreterPool.h"
 #include "interfaces/python/pythreadstate.h"
 #include "interfaces/python/swig.h"
 #include "interfaces/python/XBPython.h"
@@ -160,7 +161,15 @@ bool CPythonInvoker::execute(const std::string &script, const std::vector<std::s
 
   // get the global lock
   PyEval_AcquireLock();
-  PyThreadState* state = Py_NewInterpreter();
+
+  // plugins may run in the interpreter kept from an earlier run
+  bool pooled = CPythonInterpreterPool::IsPooled(m_addon);
+  PyThreadState* state = NULL;
+  if (pooled)
+    state = (PyThreadState*)g_pythonParser.GetInterpreterPool().Acquire(m_sourceFile, m_pythonPath);
+  bool warm = state != NULL;
+  if (!warm)
+    state = Py_NewInterpreter();
   if (state == NULL)
   {
     PyEval_ReleaseLock();
@@ -173,7 +182,16 @@ bool CPythonInvoker::execute(const std::string &script, const std::vector<std::s
   XBMCAddon::AddonClass::Ref<XBMCAddon::Python::PythonLanguageHook> languageHook(new XBMCAddon::Python::PythonLanguageHook(state->interp));
   languageHook->RegisterMe();
 
-  onInitialization();
+  if (warm)
+  {
+    // the modules are initialized already, the script only needs to know it may run again
+    CLog::Log(LOGDEBUG, "CPythonInvoker(%d, %s): using the interpreter kept from an earlier run", GetId(), m_sourceFile.c_str());
+    PyObject *m = PyImport_AddModule((char*)"xbmc");
+    if (m == NULL || PyObject_SetAttrString(m, (char*)"abortRequested", PyBool_FromLong(0)))
+      CLog::Log(LOGERROR, "CPythonInvoker(%d, %s): failed to reset abortRequested", GetId(), m_sourceFile.c_str());
+  }
+  else
+    onInitialization();
   setState(InvokerStateInitialized);
 
   std::string realFilename(CSpecialProtocol::TranslatePath(m_sourceFile));
@@ -186,33 +204,38 @@ bool CPythonInvoker::execute(const std::string &script, const std::vector<std::s
   // this is used for python so it will search modules from script path first
   CStdString scriptDir = URIUtils::GetDirectory(realFilename);
   URIUtils::RemoveSlashAtEnd(scriptDir);
-  addPath(scriptDir);
 
-  // add on any addon modules the user has installed
-  ADDON::VECADDONS addons;
-  ADDON::CAddonMgr::Get().GetAddons(ADDON::ADDON_SCRIPT_MODULE, addons);
-  for (unsigned int i = 0; i < addons.size(); ++i)
-    addPath(CSpecialProtocol::TranslatePath(addons[i]->LibPath()));
+  // a kept interpreter comes with the path it was set up with
+  if (!warm)
+  {
+    addPath(scriptDir);
 
-  // we want to use sys.path so it includes site-packages
-  // if this fails, default to using Py_GetPath
-  PyObject *sysMod(PyImport_ImportModule((char*)"sys")); // must call Py_DECREF when finished
-  PyObject *sysModDict(PyModule_GetDict(sysMod)); // borrowed ref, no need to delete
-  PyObject *pathObj(PyDict_GetItemString(sysModDict, "path")); // borrowed ref, no need to delete
+    // add on any addon modules the user has installed
+    ADDON::VECADDONS addons;
+    ADDON::CAddonMgr::Get().GetAddons(ADDON::ADDON_SCRIPT_MODULE, addons);
+    for (unsigned int i = 0; i < addons.size(); ++i)
+      addPath(CSpecialProtocol::TranslatePath(addons[i]->LibPath()));
 
-  if (pathObj != NULL && PyList_Check(pathObj))
-  {
-    for (int i = 0; i < PyList_Size(pathObj); i++)
+    // we want to use sys.path so it includes site-packages
+    // if this fails, default to using Py_GetPath
+    PyObject *sysMod(PyImport_ImportModule((char*)"sys")); // must call Py_DECREF when finished
+    PyObject *sysModDict(PyModule_GetDict(sysMod)); // borrowed ref, no need to delete
+    PyObject *pathObj(PyDict_GetItemString(sysModDict, "path")); // borrowed ref, no need to delete
+
+    if (pathObj != NULL && PyList_Check(pathObj))
     {
-      PyObject *e = PyList_GetItem(pathObj, i); // borrowed ref, no need to delete
-      if (e != NULL && PyString_Check(e))
-        addNativePath(PyString_AsString(e)); // returns internal data, don't delete or modify
+      for (int i = 0; i < PyList_Size(pathObj); i++)
+      {
+        PyObject *e = PyList_GetItem(pathObj, i); // borrowed ref, no need to delete
+        if (e != NULL && PyString_Check(e))
+          addNativePath(PyString_AsString(e)); // returns internal data, don't delete or modify
+      }
     }
-  }
-  else
-    addNativePath(Py_GetPath());
+    else
+      addNativePath(Py_GetPath());
 
-  Py_DECREF(sysMod); // release ref to sysMod
+    Py_DECREF(sysMod); // release ref to sysMod
+  }
 
   // set current directory and python's path.
   if (m_argv != NULL)
@@ -387,7 +410,21 @@ bool CPythonInvoker::execute(const std::string &script, const std::vector<std::s
       PyRun_SimpleString(GC_SCRIPT) == -1)
     CLog::Log(LOGERROR, "CPythonInvoker(%d, %s): failed to run the gc to clean up after running prior to shutting down the Interpreter", GetId(), m_sourceFile.c_str());
 
-  Py_EndInterpreter(state);
+  // keep the interpreter of a plugin that ran without problems and left nothing behind
+  bool kept = false;
+  if (pooled && stateToSet == InvokerStateDone && !m_stop && !systemExitThrown)
+  {
+    std::string moduleFolder(scriptDir);
+#ifdef TARGET_WINDOWS
+    g_charsetConverter.utf8ToSystem(moduleFolder, true);
+#endif
+    CPythonInterpreterPool &pool = g_pythonParser.GetInterpreterPool();
+    if (CPythonInterpreterPool::Reset(state, moduleFolder) && !languageHook->HasRegisteredAddonClasses())
+      kept = pool.Release(m_sourceFile, state, m_pythonPath);
+  }
+
+  if (!kept)
+    Py_EndInterpreter(state);
 
   // If we still have objects left around, produce an error message detailing what's been left behind
   if (languageHook->HasRegisteredAddonClasses())
@@ -563,6 +563,7 @@ void XBPython::Finalize()
     m_mainThreadState = NULL; // clear the main thread state before releasing the lock
     {
       CSingleExit exit(m_critSection);
+      m_interpreterPool.Clear();
       PyEval_AcquireLock();
       PyThreadState_Swap(curTs);
 
@@ -602,6 +603,9 @@ void XBPython::Uninitialize()
 
   // cleanup threads that are still running
   tmpvec.clear(); // boost releases the XBPyThreads which, if deleted, calls FinalizeScript
+
+  if (m_bInitialized)
+    m_interpreterPool.Clear();
 }
 
 void XBPython::Process()
@@ -626,8 +630,11 @@ void XBPython::Process()
     //delete scripts which are done
     tmpvec.clear(); // boost releases the XBPyThreads which, if deleted, calls FinalizeScript
 
+    // end the kept interpreters of plugins that weren't run for a while
+    m_interpreterPool.Expire(g_advancedSettings.m_pythonPoolIdleTime * 1000);
+
     CSingleLock l2(m_critSection);
-    if(m_iDllScriptCounter == 0 && (XbmcThreads::SystemClockMillis() - m_endtime) > 10000 )
+    if(m_iDllScriptCounter == 0 && m_interpreterPool.Size() == 0 && (XbmcThreads::SystemClockMillis() - m_endtime) > 10000 )
     {
       Finalize();
     }
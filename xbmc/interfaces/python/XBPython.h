@@ -27,6 +27,7 @@
 #include "interfaces/IAnnouncer.h"
 #include "interfaces/generic/ILanguageInvocationHandler.h"
 #include "addons/IAddon.h"
+#include "interfaces/python/PythonInterpreterPool.h"
 
 #include <boost/shared_ptr.hpp>
 #include <vector>
@@ -106,6 +107,9 @@ public:
   void UnregisterExtensionLib(LibraryLoader *pLib);
   void UnloadExtensionLibs();
 
+  /*! \brief Get the interpreters of plugins kept between their runs */
+  CPythonInterpreterPool& GetInterpreterPool() { return m_interpreterPool; }
+
 private:
   void Finalize();
 
@@ -124,6 +128,8 @@ private:
   MonitorCallbackList m_vecMonitorCallbackList;
   LibraryLoader*      m_pDll;
 
+  CPythonInterpreterPool m_interpreterPool;
+
   // any global events that scripts should be using
   CEvent m_globalEvent;
 
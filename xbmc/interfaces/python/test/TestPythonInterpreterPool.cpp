@@ -0,0 +1,191 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "addons/PluginSource.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "interfaces/generic/ScriptInvocationManager.h"
+#include "interfaces/python/XBPython.h"
+#include "settings/AdvancedSettings.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
+#include "utils/Stopwatch.h"
+#include "utils/URIUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/* a plugin in special://temp which imports a few modules of python and one of its own */
+class TestPythonInterpreterPool : public testing::Test
+{
+protected:
+  TestPythonInterpreterPool()
+  {
+    m_plugin = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "plugin.test.pool/");
+    m_script = URIUtils::AddFileToFolder(m_plugin, "default.py");
+    m_output = URIUtils::AddFileToFolder(m_plugin, "out.txt");
+    XFILE::CDirectory::Create(m_plugin);
+    XFILE::CDirectory::Create(URIUtils::AddFileToFolder(m_plugin, "resources/"));
+    XFILE::CDirectory::Create(URIUtils::AddFileToFolder(m_plugin, "resources/lib/"));
+
+    Write(m_script, "import sys, os\n"
+                    "warm = 'xml.dom.minidom' in sys.modules\n"
+                    "import xml.dom.minidom, json, urllib, re\n"
+                    "from resources.lib import helper\n"
+                    "out = open(os.path.join(os.path.dirname(__file__), 'out.txt'), 'w')\n"
+                    "out.write('%s %s' % (helper.HANDLE, warm and 'warm' or 'cold'))\n"
+                    "out.close()\n");
+    Write(URIUtils::AddFileToFolder(m_plugin, "resources/__init__.py"), "");
+    Write(URIUtils::AddFileToFolder(m_plugin, "resources/lib/__init__.py"), "");
+    Write(URIUtils::AddFileToFolder(m_plugin, "resources/lib/helper.py"), "import sys\nHANDLE = sys.argv[1]\n");
+
+    ADDON::AddonProps props("plugin.test.pool", ADDON::ADDON_PLUGIN, "1.0.0", "");
+    props.path = m_plugin;
+    m_addon = ADDON::AddonPtr(new ADDON::CPluginSource(props));
+
+    m_addons = g_advancedSettings.m_pythonPoolAddons;
+    m_size = g_advancedSettings.m_pythonPoolSize;
+    CScriptInvocationManager::Get().RegisterLanguageInvocationHandler(&g_pythonParser, ".py");
+  }
+
+  ~TestPythonInterpreterPool()
+  {
+    g_pythonParser.GetInterpreterPool().Clear();
+    g_advancedSettings.m_pythonPoolAddons = m_addons;
+    g_advancedSettings.m_pythonPoolSize = m_size;
+
+    const char *modules[] = { "resources/__init__", "resources/lib/__init__", "resources/lib/helper" };
+    for (unsigned int i = 0; i < sizeof(modules) / sizeof(modules[0]); i++)
+    {
+      std::string module = URIUtils::AddFileToFolder(m_plugin, modules[i]);
+      XFILE::CFile::Delete(module + ".py");
+      XFILE::CFile::Delete(module + ".pyc");
+      XFILE::CFile::Delete(module + ".pyo");
+    }
+    XFILE::CFile::Delete(m_script);
+    XFILE::CFile::Delete(m_output);
+    XFILE::CDirectory::Remove(URIUtils::AddFileToFolder(m_plugin, "resources/lib/"));
+    XFILE::CDirectory::Remove(URIUtils::AddFileToFolder(m_plugin, "resources/"));
+    XFILE::CDirectory::Remove(m_plugin);
+  }
+
+  static void Write(const std::string &file, const std::string &text)
+  {
+    XFILE::CFile out;
+    ASSERT_TRUE(out.OpenForWrite(file, true));
+    ASSERT_EQ((int)text.size(), out.Write(text.c_str(), text.size()));
+    out.Close();
+  }
+
+  /* run the plugin the way a directory listing does, returning what it wrote */
+  std::string Run(const std::string &handle)
+  {
+    std::vector<std::string> argv;
+    argv.push_back("plugin://plugin.test.pool/");
+    argv.push_back(handle);
+    argv.push_back("?mode=list");
+
+    int id = CScriptInvocationManager::Get().Execute(m_script, m_addon, argv);
+    EXPECT_GE(id, 0);
+    XbmcThreads::EndTime timeout(30000);
+    while (CScriptInvocationManager::Get().IsRunning(id) && !timeout.IsTimePast())
+      XbmcThreads::ThreadSleep(1);
+    EXPECT_FALSE(CScriptInvocationManager::Get().IsRunning(id));
+
+    std::string output;
+    XFILE::CFile in;
+    if (in.Open(m_output))
+    {
+      char buffer[64];
+      unsigned int read = in.Read(buffer, sizeof(buffer));
+      output.assign(buffer, read);
+      in.Close();
+    }
+    XFILE::CFile::Delete(m_output);
+    return output;
+  }
+
+  void Pool(bool pooled)
+  {
+    g_advancedSettings.m_pythonPoolAddons.clear();
+    if (pooled)
+      g_advancedSettings.m_pythonPoolAddons.insert("plugin.test.pool");
+    g_advancedSettings.m_pythonPoolSize = 1;
+  }
+
+  std::string           m_plugin;
+  std::string           m_script;
+  std::string           m_output;
+  ADDON::AddonPtr       m_addon;
+  std::set<std::string> m_addons;
+  unsigned int          m_size;
+};
+
+TEST_F(TestPythonInterpreterPool, NotPooled)
+{
+  Pool(false);
+  EXPECT_FALSE(CPythonInterpreterPool::IsPooled(m_addon));
+  EXPECT_EQ("1 cold", Run("1"));
+  EXPECT_EQ("2 cold", Run("2"));
+  EXPECT_EQ(0U, g_pythonParser.GetInterpreterPool().Size());
+}
+
+TEST_F(TestPythonInterpreterPool, Kept)
+{
+  Pool(true);
+  EXPECT_TRUE(CPythonInterpreterPool::IsPooled(m_addon));
+  EXPECT_EQ("1 cold", Run("1"));
+  EXPECT_EQ(1U, g_pythonParser.GetInterpreterPool().Size());
+
+  // the modules of python are still imported, the one of the plugin is imported with the new arguments
+  EXPECT_EQ("2 warm", Run("2"));
+  EXPECT_EQ("3 warm", Run("3"));
+  EXPECT_EQ(1U, g_pythonParser.GetInterpreterPool().Size());
+
+  // a plugin that wasn't run for a while starts over
+  g_pythonParser.GetInterpreterPool().Expire(0);
+  EXPECT_EQ(0U, g_pythonParser.GetInterpreterPool().Size());
+  EXPECT_EQ("4 cold", Run("4"));
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestPythonInterpreterPool, DISABLED_BenchmarkListings)
+{
+  const unsigned int runs = 50;
+  bool pooled[] = { false, true };
+  for (unsigned int i = 0; i < sizeof(pooled) / sizeof(pooled[0]); i++)
+  {
+    Pool(pooled[i]);
+    Run("0");
+
+    CStopWatch watch;
+    watch.StartZero();
+    for (unsigned int run = 0; run < runs; run++)
+      Run("1");
+    float elapsed = watch.GetElapsedMilliseconds();
+    std::cout << runs << " listings " << (pooled[i] ? "in a kept interpreter: " : "in new interpreters: ")
+              << elapsed / runs << " ms per listing" << std::endl;
+  }
+}
@@ -20,7 +20,6 @@
 
 #include "threads/SystemClock.h"
 #include "MusicInfoScanner.h"
-#include "music/tags/MusicInfoTagLoaderFactory.h"
 #include "MusicAlbumInfo.h"
 #include "MusicInfoScraper.h"
 #include "filesystem/MusicDatabaseDirectory.h"
@@ -62,6 +61,10 @@ using namespace MUSICDATABASEDIRECTORY;
 using namespace MUSIC_GRABBER;
 using namespace ADDON;
 
+/* songs and time after which the songs added during a scan are committed */
+static const int BatchSongs = 500;
+static const unsigned int BatchMillis = 5000;
+
 CMusicInfoScanner::CMusicInfoScanner() : CThread("MusicInfoScanner"), m_fileCountReader(this, "MusicFileCounter")
 {
   m_bRunning = false;
@@ -71,6 +74,10 @@ CMusicInfoScanner::CMusicInfoScanner() : CThread("MusicInfoScanner"), m_fileCoun
   m_currentItem=0;
   m_itemCount=0;
   m_flags = 0;
+  m_filesRead = 0;
+  m_batched = false;
+  m_batchSongs = 0;
+  m_batchStart = 0;
 }
 
 CMusicInfoScanner::~CMusicInfoScanner()
@@ -116,6 +123,17 @@ void CMusicInfoScanner::Process()
       // result in unexpected behaviour.
       m_bCanInterrupt = false;
       m_needsCleanup = false;
+      m_filesRead = 0;
+      m_tagReader.SetThreads(g_advancedSettings.m_iMusicLibraryScanThreads);
+
+      // songs of many folders go in one transaction, unless scraping holds it open
+      m_batched = !(m_flags & SCAN_ONLINE);
+      if (m_batched)
+      {
+        m_musicDatabase.BeginTransaction();
+        m_batchSongs = 0;
+        m_batchStart = XbmcThreads::SystemClockMillis();
+      }
 
       bool commit = true;
       for (std::set<std::string>::const_iterator it = m_pathsToScan.begin(); it != m_pathsToScan.end(); it++)
@@ -138,6 +156,18 @@ void CMusicInfoScanner::Process()
         }
       }
 
+      // the songs added until stopped are kept
+      if (m_batched)
+      {
+        if (!m_musicDatabase.CommitTransaction())
+        { // the cached ids may belong to rolled back rows
+          CLog::Log(LOGERROR, "MusicInfoScanner: Failed to commit the last batch of songs");
+          m_musicDatabase.EmptyCache();
+        }
+        m_batched = false;
+      }
+      m_tagReader.Clear();
+
       if (commit)
       {
         g_infoManager.ResetLibraryBools();
@@ -164,7 +194,8 @@ void CMusicInfoScanner::Process()
       m_musicDatabase.EmptyCache();
       
       tick = XbmcThreads::SystemClockMillis() - tick;
-      CLog::Log(LOGNOTICE, "My Music: Scanning for music info using worker thread, operation took %s", StringUtils::SecondsToTimeString(tick / 1000).c_str());
+      CLog::Log(LOGNOTICE, "My Music: Scanning for music info using worker thread, operation took %s, %u files read (%.1f files/s)",
+                StringUtils::SecondsToTimeString(tick / 1000).c_str(), m_filesRead, tick > 0 ? m_filesRead * 1000.0f / tick : 0.0f);
     }
     if (m_scanType == 1) // load album info
     {
@@ -230,6 +261,13 @@ void CMusicInfoScanner::Process()
   }
   catch (...)
   {
+    if (m_batched)
+    { // the cached ids may belong to rolled back rows
+      m_musicDatabase.RollbackTransaction();
+      m_musicDatabase.EmptyCache();
+      m_batched = false;
+    }
+    m_tagReader.Clear();
     CLog::Log(LOGERROR, "MusicInfoScanner: Exception while scanning.");
   }
   m_musicDatabase.Close();
@@ -426,7 +464,8 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
     items.Sort(SortByLabel, SortOrderAscending);
 
     // and then scan in the new information
-    if (RetrieveMusicInfo(strDirectory, items) > 0)
+    int songsAdded = RetrieveMusicInfo(strDirectory, items);
+    if (songsAdded > 0)
     {
       if (m_handle)
         OnDirectoryScanned(strDirectory);
@@ -434,6 +473,7 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
 
     // save information about this folder
     m_musicDatabase.SetPathHash(strDirectory, hash);
+    CommitBatch(songsAdded);
   }
   else
   { // path is the same - no need to rescan
@@ -471,15 +511,34 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   return !m_bStop;
 }
 
+void CMusicInfoScanner::CommitBatch(int songsAdded)
+{
+  if (!m_batched)
+    return;
+
+  m_batchSongs += songsAdded;
+  unsigned int now = XbmcThreads::SystemClockMillis();
+  if (m_batchSongs < BatchSongs && now - m_batchStart < BatchMillis)
+    return;
+
+  if (!m_musicDatabase.CommitTransaction())
+  { // the cached ids may belong to rolled back rows
+    CLog::Log(LOGERROR, "MusicInfoScanner: Failed to commit a batch of %i songs", m_batchSongs);
+    m_musicDatabase.EmptyCache();
+  }
+  m_musicDatabase.BeginTransaction();
+  m_batchSongs = 0;
+  m_batchStart = now;
+}
+
 INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList& scannedItems)
 {
   CStdStringArray regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
 
+  // the files to read, workers start on them while we go through them in order
+  vector<CFileItemPtr> files;
   for (int i = 0; i < items.Size(); ++i)
   {
-    if (m_bStop)
-      return INFO_CANCELLED;
-
     CFileItemPtr pItem = items[i];
 
     if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), regexps))
@@ -488,20 +547,29 @@ INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList&
     if (pItem->m_bIsFolder || pItem->IsPlayList() || pItem->IsPicture() || pItem->IsLyrics())
       continue;
 
-    m_currentItem++;
+    files.push_back(pItem);
+    m_tagReader.Prefetch(pItem);
+  }
 
-    CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
-    if (!tag.Loaded())
+  for (vector<CFileItemPtr>::const_iterator it = files.begin(); it != files.end(); ++it)
+  {
+    if (m_bStop)
     {
-      auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(pItem->GetPath()));
-      if (NULL != pLoader.get())
-        pLoader->Load(pItem->GetPath(), tag);
+      m_tagReader.Clear();
+      return INFO_CANCELLED;
     }
 
+    CFileItemPtr pItem = *it;
+
+    m_currentItem++;
+
+    bool loaded = m_tagReader.Load(pItem);
+    m_filesRead++;
+
     if (m_handle && m_itemCount>0)
       m_handle->SetPercentage(m_currentItem/(float)m_itemCount*100);
 
-    if (!tag.Loaded())
+    if (!loaded)
     {
       CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
       continue;
@@ -22,6 +22,7 @@
 #include "music/MusicDatabase.h"
 #include "MusicAlbumInfo.h"
 #include "MusicInfoScraper.h"
+#include "MusicTagReader.h"
 
 class CAlbum;
 class CArtist;
@@ -187,6 +188,13 @@ protected:
 
   bool DoScan(const CStdString& strDirectory);
 
+  /*! \brief Commit the songs added since the last commit and start a new transaction
+   Songs of many folders are added in a single transaction, which is committed once
+   it holds enough songs or has been open for a while.
+   \param songsAdded [in] number of songs added since the last call
+   */
+  void CommitBatch(int songsAdded);
+
   virtual void Run();
   int CountFiles(const CFileItemList& items, bool recursive);
   int CountFilesRecursively(const CStdString& strPath);
@@ -218,5 +226,11 @@ protected:
   std::set<std::string> m_pathsToScan;
   int m_flags;
   CThread m_fileCountReader;
+
+  CMusicTagReader m_tagReader;
+  unsigned int m_filesRead;   ///< files whose tags were read during this scan
+  bool m_batched;             ///< true while songs are added in transactions spanning several folders
+  int m_batchSongs;           ///< songs added in the open transaction
+  unsigned int m_batchStart;  ///< time the open transaction started
 };
 }
@@ -0,0 +1,130 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MusicTagReader.h"
+#include "music/tags/MusicInfoTag.h"
+#include "music/tags/MusicInfoTagLoaderFactory.h"
+#include "utils/JobManager.h"
+#include "utils/PrefetchJob.h"
+
+#include <memory>
+
+using namespace std;
+
+namespace MUSIC_INFO
+{
+  static bool ReadTag(const CStdString &path, CMusicInfoTag &tag)
+  {
+    auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(path));
+    if (NULL != pLoader.get())
+      pLoader->Load(path, tag);
+    return tag.Loaded();
+  }
+
+  /* A file to read, shared by the reader and the job reading it */
+  class CMusicTagRequest : public CPrefetchRequest
+  {
+  public:
+    CMusicTagRequest(const CStdString &path) : m_path(path)
+    {
+    }
+
+    const CStdString m_path;
+    CMusicInfoTag    m_tag;
+
+  protected:
+    virtual void DoWork()
+    {
+      ReadTag(m_path, m_tag);
+    }
+  };
+
+  CMusicTagReader::CMusicTagReader(unsigned int threads /* = 1 */)
+    : m_threads(threads), m_queue(NULL)
+  {
+  }
+
+  CMusicTagReader::~CMusicTagReader()
+  {
+    Clear();
+  }
+
+  void CMusicTagReader::SetThreads(unsigned int threads)
+  {
+    Clear();
+    m_threads = threads;
+  }
+
+  void CMusicTagReader::Prefetch(const CFileItemPtr &item)
+  {
+    // the scanner thread is one of the readers
+    if (m_threads < 2 || item->GetMusicInfoTag()->Loaded())
+      return;
+    if (m_requests.find(item->GetPath()) != m_requests.end())
+      return;
+
+    MusicTagRequestPtr request(new CMusicTagRequest(item->GetPath()));
+    m_requests.insert(make_pair(item->GetPath(), request));
+
+    if (!m_queue)
+      m_queue = new CJobQueue(false, m_threads - 1, CJob::PRIORITY_LOW);
+    m_queue->AddJob(new CPrefetchJob(request, "musictagreader"));
+  }
+
+  bool CMusicTagReader::Load(const CFileItemPtr &item)
+  {
+    CMusicInfoTag &tag = *item->GetMusicInfoTag();
+    if (tag.Loaded())
+      return true;
+
+    Requests::iterator it = m_requests.find(item->GetPath());
+    if (it != m_requests.end())
+    {
+      MusicTagRequestPtr request = it->second;
+      m_requests.erase(it);
+
+      // a worker is on it, wait rather than reading it twice
+      if (!request->Start())
+      {
+        request->Wait();
+        tag = request->m_tag;
+        return tag.Loaded();
+      }
+    }
+
+    return ReadTag(item->GetPath(), tag);
+  }
+
+  void CMusicTagReader::Clear()
+  {
+    for (Requests::iterator it = m_requests.begin(); it != m_requests.end(); ++it)
+      it->second->Start();
+    m_requests.clear();
+
+    // jobs in progress finish on their own, they hold on to their request
+    delete m_queue;
+    m_queue = NULL;
+  }
+
+  bool CMusicTagReader::Read(CFileItem &item)
+  {
+    return ReadTag(item.GetPath(), *item.GetMusicInfoTag());
+  }
+}
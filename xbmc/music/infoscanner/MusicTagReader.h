@@ -0,0 +1,82 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include "FileItem.h"
+#include "utils/StdString.h"
+
+class CJobQueue;
+
+namespace MUSIC_INFO
+{
+  class CMusicTagRequest;
+
+  /*! \brief Reads the tags of music files on job manager workers
+
+   The music scanner names the files of a folder before it adds them to the
+   database, and up to threads - 1 workers read their tags meanwhile. Load()
+   waits for a tag in progress, or reads it on the calling thread if no worker
+   started on it yet, so the scanner reads tags itself too and is never slower
+   than reading every file in turn. With a single thread nothing is read ahead.
+
+   Only the scanner thread may call the member functions.
+   */
+  class CMusicTagReader
+  {
+  public:
+    CMusicTagReader(unsigned int threads = 1);
+    ~CMusicTagReader();
+
+    /*! \brief Set the number of threads reading tags, forgetting all files
+     \param threads the number of threads, including the one calling Load()
+     */
+    void SetThreads(unsigned int threads);
+
+    /*! \brief Start reading the tag of a file, unless it is loaded or being read already
+     \param item the file
+     */
+    void Prefetch(const CFileItemPtr &item);
+
+    /*! \brief Load the tag of a file, waiting for it or reading it here as needed
+     \param item [in/out] the file, its music info tag is set
+     \return true if the tag was loaded
+     */
+    bool Load(const CFileItemPtr &item);
+
+    /*! \brief Forget all files and cancel the reading jobs */
+    void Clear();
+
+    /*! \brief Read the tag of a file the way the music scanner does
+     \param item [in/out] the file, its music info tag is set
+     \return true if the tag was loaded
+     */
+    static bool Read(CFileItem &item);
+
+  private:
+    typedef boost::shared_ptr<CMusicTagRequest> MusicTagRequestPtr;
+    typedef std::map<CStdString, MusicTagRequestPtr> Requests;
+
+    unsigned int m_threads;
+    Requests     m_requests;
+    CJobQueue   *m_queue;
+  };
+}
@@ -0,0 +1,150 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SocketPoller.h"
+#include "utils/log.h"
+
+#include <errno.h>
+
+#if defined(TARGET_LINUX) || defined(TARGET_ANDROID)
+#define HAS_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+CSocketPoller::CSocketPoller()
+{
+  m_epoll = -1;
+#ifdef HAS_EPOLL
+  m_epoll = epoll_create(16);
+  if (m_epoll < 0)
+    CLog::Log(LOGWARNING, "%s - epoll unavailable (%d), using select", __FUNCTION__, errno);
+#endif
+}
+
+CSocketPoller::~CSocketPoller()
+{
+#ifdef HAS_EPOLL
+  if (m_epoll >= 0)
+    close(m_epoll);
+#endif
+}
+
+bool CSocketPoller::Set(SOCKET socket, int events)
+{
+  Sockets::iterator it = m_sockets.find(socket);
+  if (it != m_sockets.end() && it->second == events)
+    return true;
+
+#ifdef HAS_EPOLL
+  if (m_epoll >= 0)
+  {
+    struct epoll_event event = {};
+    event.events = ((events & POLL_READ) ? EPOLLIN : 0) | ((events & POLL_WRITE) ? EPOLLOUT : 0);
+    event.data.fd = socket;
+    if (epoll_ctl(m_epoll, it == m_sockets.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, socket, &event) < 0)
+    {
+      CLog::Log(LOGERROR, "%s - unable to watch socket %d (%d)", __FUNCTION__, (int)socket, errno);
+      return false;
+    }
+  }
+#elif !defined(TARGET_WINDOWS)
+  // select() can't wait for descriptors past FD_SETSIZE
+  if (it == m_sockets.end() && (intptr_t)socket >= FD_SETSIZE)
+    return false;
+#endif
+
+  m_sockets[socket] = events;
+  return true;
+}
+
+void CSocketPoller::Remove(SOCKET socket)
+{
+  Sockets::iterator it = m_sockets.find(socket);
+  if (it == m_sockets.end())
+    return;
+
+#ifdef HAS_EPOLL
+  if (m_epoll >= 0)
+  {
+    struct epoll_event event = {};
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, &event);
+  }
+#endif
+  m_sockets.erase(it);
+}
+
+int CSocketPoller::Wait(std::vector<Event> &events, unsigned int timeoutMs)
+{
+  events.clear();
+
+#ifdef HAS_EPOLL
+  if (m_epoll >= 0)
+  {
+    struct epoll_event ready[64];
+    int res = epoll_wait(m_epoll, ready, sizeof(ready) / sizeof(ready[0]), timeoutMs);
+    if (res < 0)
+      return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < res; i++)
+    {
+      // hang ups and errors are read, recv() tells which it is
+      Event event = { ready[i].data.fd, 0 };
+      if (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        event.events |= POLL_READ;
+      if (ready[i].events & EPOLLOUT)
+        event.events |= POLL_WRITE;
+      events.push_back(event);
+    }
+    return res;
+  }
+#endif
+
+  SOCKET max_fd = 0;
+  fd_set rfds, wfds;
+  FD_ZERO(&rfds);
+  FD_ZERO(&wfds);
+  for (Sockets::const_iterator it = m_sockets.begin(); it != m_sockets.end(); ++it)
+  {
+    if (it->second & POLL_READ)
+      FD_SET(it->first, &rfds);
+    if (it->second & POLL_WRITE)
+      FD_SET(it->first, &wfds);
+    if ((intptr_t)it->first > (intptr_t)max_fd)
+      max_fd = it->first;
+  }
+
+  struct timeval to = { (long)(timeoutMs / 1000), (long)(timeoutMs % 1000) * 1000 };
+  int res = select((intptr_t)max_fd + 1, &rfds, &wfds, NULL, &to);
+  if (res < 0)
+    return errno == EINTR ? 0 : -1;
+
+  for (Sockets::const_iterator it = m_sockets.begin(); it != m_sockets.end(); ++it)
+  {
+    Event event = { it->first, 0 };
+    if (FD_ISSET(it->first, &rfds))
+      event.events |= POLL_READ;
+    if (FD_ISSET(it->first, &wfds))
+      event.events |= POLL_WRITE;
+    if (event.events)
+      events.push_back(event);
+  }
+  return events.size();
+}
@@ -0,0 +1,73 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <vector>
+
+#include "system.h"
+
+/*! \brief Waits for sockets to become readable or writable
+
+ Uses epoll where it is available, so the cost of a wait depends on the
+ number of ready sockets rather than on the number of watched ones, and
+ select() elsewhere. Not thread safe, a single thread owns the poller.
+ */
+class CSocketPoller
+{
+public:
+  enum
+  {
+    POLL_READ  = 1 << 0, ///< the socket has data to read, is closed or has an error
+    POLL_WRITE = 1 << 1  ///< the socket has room to write
+  };
+
+  struct Event
+  {
+    SOCKET socket;
+    int    events;
+  };
+
+  CSocketPoller();
+  ~CSocketPoller();
+
+  /*! \brief Watch a socket, or change what a watched socket is watched for
+   \param socket the socket
+   \param events POLL_READ and/or POLL_WRITE, 0 to keep the socket without waiting for it
+   \return false if the socket can't be watched
+   */
+  bool Set(SOCKET socket, int events);
+
+  /*! \brief Stop watching a socket, to be called before closing it */
+  void Remove(SOCKET socket);
+
+  /*! \brief Wait for watched sockets to become ready
+   \param events [out] the ready sockets and what they are ready for
+   \param timeoutMs how long to wait at most
+   \return the number of ready sockets, 0 on timeout and -1 on error
+   */
+  int Wait(std::vector<Event> &events, unsigned int timeoutMs);
+
+private:
+  typedef std::map<SOCKET, int> Sockets;
+
+  int     m_epoll; ///< the epoll instance, -1 if select() is used
+  Sockets m_sockets;
+};
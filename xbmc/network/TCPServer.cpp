@@ -24,15 +24,21 @@
 #include <memory.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <algorithm>
 
 #include "settings/AdvancedSettings.h"
 #include "interfaces/json-rpc/JSONRPC.h"
 #include "interfaces/AnnouncementManager.h"
 #include "utils/log.h"
+#include "utils/Job.h"
+#include "utils/JSONStreamWriter.h"
+#include "utils/JobManager.h"
 #include "utils/Variant.h"
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
 #include "websocket/WebSocketManager.h"
 #include "Network.h"
+#include "SocketPoller.h"
 
 static const char     bt_service_name[] = "XBMC JSON-RPC";
 static const char     bt_service_desc[] = "Interface for XBMC remote control over bluetooth";
@@ -56,9 +62,96 @@ using namespace ANNOUNCEMENT;
 //using namespace std; On VS2010, bind conflicts with std::bind
 
 #define RECEIVEBUFFER 1024
+// requests handled at the same time, over all connections
+#define REQUEST_WORKERS 4
+// a connection with more requests waiting or more output unsent isn't read from
+#define MAX_QUEUED_REQUESTS 16
+#define MAX_PENDING_OUTPUT (1024 * 1024)
+// sent output is dropped from the front of the buffer once there is this much of it
+#define MIN_COMPACT_OUTPUT (64 * 1024)
+// announcements held back during a streamed response are dropped past this
+#define MAX_DEFERRED_OUTPUT (256 * 1024)
+// a connection that takes none of a streamed response for this long is dropped
+#define STREAM_TIMEOUT 30000
 
 CTCPServer *CTCPServer::ServerInstance = NULL;
 
+static bool SetNonBlocking(SOCKET socket)
+{
+#ifdef TARGET_WINDOWS
+  u_long nonblocking = 1;
+  return ioctlsocket(socket, FIONBIO, &nonblocking) == 0;
+#else
+  return fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool WouldBlock()
+{
+#ifdef TARGET_WINDOWS
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+/* The transport the JSON-RPC methods see. Workers may still be handling
+   requests after the server is gone, so it isn't the server itself. */
+class CTCPTransport : public ITransportLayer
+{
+public:
+  virtual bool PrepareDownload(const char *path, CVariant &details, std::string &protocol) { return false; }
+  virtual bool Download(const char *path, CVariant &result) { return false; }
+  virtual int GetCapabilities() { return Response | Announcing; }
+};
+
+static CTCPTransport TCPTransport;
+
+class CTCPServer::CRequestJob : public CJob, public IJSONStreamOutput
+{
+public:
+  CRequestJob(const ClientPtr &client, const std::string &request, const WakeupPtr &wakeup)
+    : m_client(client), m_request(request), m_wakeup(wakeup)
+  {
+  }
+
+  virtual bool DoWork()
+  {
+    if (m_client->CanStream())
+    {
+      m_client->BeginResponse();
+      CJSONRPC::MethodCall(m_request, &TCPTransport, m_client.get(), this);
+      m_client->EndResponse();
+    }
+    else
+    {
+      std::string response = CJSONRPC::MethodCall(m_request, &TCPTransport, m_client.get());
+      m_client->Send(response.c_str(), response.size());
+    }
+
+    m_client->FinishRequest();
+    // the server thread writes the response and hands out the next request
+    m_wakeup->Wake();
+    return true;
+  }
+
+  virtual bool Write(const char *data, size_t size)
+  {
+    if (!m_client->StreamResponse(data, size))
+      return false;
+
+    m_wakeup->Wake();
+    return m_client->WaitForOutput();
+  }
+
+  virtual const char *GetType() const { return "jsonrpcrequest"; }
+
+private:
+  ClientPtr   m_client;
+  std::string m_request;
+  WakeupPtr   m_wakeup;
+};
+
 bool CTCPServer::StartServer(int port, bool nonlocal)
 {
   StopServer(true);
@@ -77,6 +170,9 @@ void CTCPServer::StopServer(bool bWait)
 {
   if (ServerInstance)
   {
+    // don't wait for the poll to time out
+    ServerInstance->m_bStop = true;
+    ServerInstance->m_wakeup->Wake();
     ServerInstance->StopThread(bWait);
     if (bWait)
     {
@@ -99,113 +195,113 @@ CTCPServer::CTCPServer(int port, bool nonlocal) : CThread("TCPServer")
   m_port = port;
   m_nonlocal = nonlocal;
   m_sdpd = NULL;
+  m_poller = new CSocketPoller();
+  m_requestQueue = new CJobQueue(false, REQUEST_WORKERS, CJob::PRIORITY_NORMAL);
+  m_wakeup.reset(new CWakeup());
+  if (m_wakeup->m_socket != INVALID_SOCKET)
+    m_poller->Set(m_wakeup->m_socket, CSocketPoller::POLL_READ);
+}
+
+CTCPServer::~CTCPServer()
+{
+  Deinitialize();
+  delete m_requestQueue;
+  delete m_poller;
 }
 
 void CTCPServer::Process()
 {
   m_bStop = false;
+  std::vector<CSocketPoller::Event> events;
 
   while (!m_bStop)
   {
-    SOCKET          max_fd = 0;
-    fd_set          rfds;
-    struct timeval  to     = {1, 0};
-    FD_ZERO(&rfds);
-
-    for (std::vector<SOCKET>::iterator it = m_servers.begin(); it != m_servers.end(); it++)
+    // hand out requests, write what the sockets take and decide what to wait for
+    for (int i = m_connections.size() - 1; i >= 0; i--)
     {
-      FD_SET(*it, &rfds);
-      if ((intptr_t)*it > (intptr_t)max_fd)
-        max_fd = *it;
-    }
+      ClientPtr client = m_connections[i];
 
-    for (unsigned int i = 0; i < m_connections.size(); i++)
-    {
-      FD_SET(m_connections[i]->m_socket, &rfds);
-      if ((intptr_t)m_connections[i]->m_socket > (intptr_t)max_fd)
-        max_fd = m_connections[i]->m_socket;
+      std::string request;
+      if (client->StartRequest(request))
+        m_requestQueue->AddJob(new CRequestJob(client, request, m_wakeup));
+
+      if (!client->Flush())
+      {
+        CLog::Log(LOGINFO, "JSONRPC Server: Disconnection detected");
+        RemoveClient(i);
+        continue;
+      }
+
+      int wanted = client->IsBusy() ? 0 : CSocketPoller::POLL_READ;
+      if (client->PendingOutput() > 0)
+        wanted |= CSocketPoller::POLL_WRITE;
+      m_poller->Set(client->m_socket, wanted);
     }
 
-    int res = select((intptr_t)max_fd+1, &rfds, NULL, NULL, &to);
+    // without a wakeup socket we look for finished requests every now and then
+    int res = m_poller->Wait(events, m_wakeup->m_socket != INVALID_SOCKET ? 1000 : 20);
     if (res < 0)
     {
       CLog::Log(LOGERROR, "JSONRPC Server: Select failed");
       Sleep(1000);
       Initialize();
+      continue;
     }
-    else if (res > 0)
+
+    for (std::vector<CSocketPoller::Event>::const_iterator event = events.begin(); event != events.end(); ++event)
     {
-      for (int i = m_connections.size() - 1; i >= 0; i--)
+      if (event->socket == m_wakeup->m_socket)
       {
-        int socket = m_connections[i]->m_socket;
-        if (FD_ISSET(socket, &rfds))
-        {
-          char buffer[RECEIVEBUFFER] = {};
-          int  nread = 0;
-          nread = recv(socket, (char*)&buffer, RECEIVEBUFFER, 0);
-          bool close = false;
-          if (nread > 0)
-          {
-            std::string response;
-            if (m_connections[i]->IsNew())
-            {
-              CWebSocket *websocket = CWebSocketManager::Handle(buffer, nread, response);
-
-              if (response.size() > 0)
-                m_connections[i]->Send(response.c_str(), response.size());
-
-              if (websocket != NULL)
-              {
-                // Replace the CTCPClient with a CWebSocketClient
-                CWebSocketClient *websocketClient = new CWebSocketClient(websocket, *(m_connections[i]));
-                delete m_connections[i];
-                m_connections.erase(m_connections.begin() + i);
-                m_connections.insert(m_connections.begin() + i, websocketClient);
-              }
-            }
-
-            if (response.size() <= 0)
-              m_connections[i]->PushBuffer(this, buffer, nread);
-
-            close = m_connections[i]->Closing();
-          }
-          else
-            close = true;
+        m_wakeup->Drain();
+        continue;
+      }
+
+      std::vector<SOCKET>::iterator server = std::find(m_servers.begin(), m_servers.end(), event->socket);
+      if (server != m_servers.end())
+      {
+        CLog::Log(LOGDEBUG, "JSONRPC Server: New connection detected");
+        ClientPtr newconnection(new CTCPClient());
+        newconnection->m_socket = accept(*server, (sockaddr*)&newconnection->m_cliaddr, &newconnection->m_addrlen);
 
-          if (close)
+        if (newconnection->m_socket == INVALID_SOCKET)
+        {
+          CLog::Log(LOGERROR, "JSONRPC Server: Accept of new connection failed: %d", errno);
+          if (EBADF == errno)
           {
-            CLog::Log(LOGINFO, "JSONRPC Server: Disconnection detected");
-            m_connections[i]->Disconnect();
-            delete m_connections[i];
-            m_connections.erase(m_connections.begin() + i);
+            Sleep(1000);
+            Initialize();
+            break;
           }
         }
+        else if (!SetNonBlocking(newconnection->m_socket) || !m_poller->Set(newconnection->m_socket, CSocketPoller::POLL_READ))
+        {
+          CLog::Log(LOGERROR, "JSONRPC Server: Unable to watch new connection");
+          newconnection->Disconnect();
+        }
+        else
+        {
+          CLog::Log(LOGINFO, "JSONRPC Server: New connection added");
+          CSingleLock lock(m_critSection);
+          m_connections.push_back(newconnection);
+        }
+        continue;
       }
 
-      for (std::vector<SOCKET>::iterator it = m_servers.begin(); it != m_servers.end(); it++)
+      // writable connections are written to on the next round
+      if (!(event->events & CSocketPoller::POLL_READ))
+        continue;
+
+      for (unsigned int i = 0; i < m_connections.size(); i++)
       {
-        if (FD_ISSET(*it, &rfds))
-        {
-          CLog::Log(LOGDEBUG, "JSONRPC Server: New connection detected");
-          CTCPClient *newconnection = new CTCPClient();
-          newconnection->m_socket = accept(*it, (sockaddr*)&newconnection->m_cliaddr, &newconnection->m_addrlen);
+        if (m_connections[i]->m_socket != event->socket)
+          continue;
 
-          if (newconnection->m_socket == INVALID_SOCKET)
-          {
-            CLog::Log(LOGERROR, "JSONRPC Server: Accept of new connection failed: %d", errno);
-            if (EBADF == errno)
-            {
-              Sleep(1000);
-              Initialize();
-              break;
-            }
-          }
-          else
-          {
-            CLog::Log(LOGINFO, "JSONRPC Server: New connection added");
-            m_connections.push_back(newconnection);
-          }
+        if (!ReadClient(i))
+        {
+          CLog::Log(LOGINFO, "JSONRPC Server: Disconnection detected");
+          RemoveClient(i);
         }
+        break;
       }
     }
   }
@@ -213,35 +309,76 @@ void CTCPServer::Process()
   Deinitialize();
 }
 
-bool CTCPServer::PrepareDownload(const char *path, CVariant &details, std::string &protocol)
+bool CTCPServer::ReadClient(unsigned int index)
 {
-  return false;
-}
+  ClientPtr client = m_connections[index];
 
-bool CTCPServer::Download(const char *path, CVariant &result)
-{
-  return false;
+  char buffer[RECEIVEBUFFER] = {};
+  int  nread = recv(client->m_socket, (char*)&buffer, RECEIVEBUFFER, 0);
+  if (nread < 0 && WouldBlock())
+    return true;
+  if (nread <= 0)
+    return false;
+
+  std::string response;
+  if (client->IsNew())
+  {
+    CWebSocket *websocket = CWebSocketManager::Handle(buffer, nread, response);
+
+    if (response.size() > 0)
+      client->Send(response.c_str(), response.size());
+
+    if (websocket != NULL)
+    {
+      // Replace the CTCPClient with a CWebSocketClient
+      CSingleLock lock(m_critSection);
+      client.reset(new CWebSocketClient(websocket, *client));
+      m_connections[index] = client;
+    }
+  }
+
+  if (response.size() <= 0)
+    client->PushBuffer(buffer, nread);
+
+  return !client->Closing();
 }
 
-int CTCPServer::GetCapabilities()
+void CTCPServer::RemoveClient(unsigned int index)
 {
-  return Response | Announcing;
+  ClientPtr client = m_connections[index];
+  m_poller->Remove(client->m_socket);
+  client->Disconnect();
+
+  // workers handling its requests hold on to it until they're done
+  CSingleLock lock(m_critSection);
+  m_connections.erase(m_connections.begin() + index);
 }
 
 void CTCPServer::Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data)
 {
   std::string str = IJSONRPCAnnouncer::AnnouncementToJSONRPC(flag, sender, message, data, g_advancedSettings.m_jsonOutputCompact);
 
+  bool queued = false;
+  CSingleLock lock(m_critSection);
   for (unsigned int i = 0; i < m_connections.size(); i++)
   {
+    CSingleLock clientLock(m_connections[i]->m_critSection);
+    if ((m_connections[i]->GetAnnouncementFlags() & flag) == 0)
+      continue;
+
+    // a connection that doesn't keep up misses announcements rather than holding up the others
+    if (m_connections[i]->PendingOutput() >= MAX_PENDING_OUTPUT)
     {
-      CSingleLock lock (m_connections[i]->m_critSection);
-      if ((m_connections[i]->GetAnnouncementFlags() & flag) == 0)
-        continue;
+      CLog::Log(LOGDEBUG, "JSONRPC Server: Dropping announcement %s for a slow connection", message);
+      continue;
     }
 
     m_connections[i]->Send(str.c_str(), str.size());
+    queued = true;
   }
+
+  if (queued)
+    m_wakeup->Wake();
 }
 
 bool CTCPServer::Initialize()
@@ -305,7 +442,8 @@ bool CTCPServer::InitializeBlue()
     return false;
   }
 
-  m_servers.push_back(fd);
+  if (!AddServer(fd))
+    return false;
 
   CSADDR_INFO addrinfo;
   addrinfo.iProtocol   = BTHPROTO_RFCOMM;
@@ -435,8 +573,12 @@ bool CTCPServer::InitializeBlue()
     return false;
   }
 
+  if (!AddServer(fd))
+  {
+    sdp_close(session);
+    return false;
+  }
   m_sdpd = session;
-  m_servers.push_back(fd);
 
   return true;
 #endif
@@ -452,22 +594,45 @@ bool CTCPServer::InitializeTCP()
   if ((fd = CreateTCPServerSocket(m_port, !m_nonlocal, 10, "JSONRPC")) == INVALID_SOCKET)
     return false;
 
+  return AddServer(fd);
+}
+
+bool CTCPServer::AddServer(SOCKET fd)
+{
+  if (!m_poller->Set(fd, CSocketPoller::POLL_READ))
+  {
+    CLog::Log(LOGERROR, "JSONRPC Server: Unable to watch listening socket");
+    closesocket(fd);
+    return false;
+  }
+
   m_servers.push_back(fd);
   return true;
 }
 
 void CTCPServer::Deinitialize()
 {
+  // before taking our lock, announcements are sent holding the announcement manager's
+  CAnnouncementManager::Get().RemoveAnnouncer(this);
+
+  // requests waiting for a worker are dropped, those being handled finish on their own
+  m_requestQueue->CancelJobs();
+
+  CSingleLock lock(m_critSection);
   for (unsigned int i = 0; i < m_connections.size(); i++)
   {
+    m_poller->Remove(m_connections[i]->m_socket);
     m_connections[i]->Disconnect();
-    delete m_connections[i];
   }
 
   m_connections.clear();
+  lock.Leave();
 
   for (unsigned int i = 0; i < m_servers.size(); i++)
+  {
+    m_poller->Remove(m_servers[i]);
     closesocket(m_servers[i]);
+  }
 
   m_servers.clear();
 
@@ -476,8 +641,49 @@ void CTCPServer::Deinitialize()
     sdp_close((sdp_session_t*)m_sdpd);
   m_sdpd = NULL;
 #endif
+}
 
-  CAnnouncementManager::Get().RemoveAnnouncer(this);
+CTCPServer::CWakeup::CWakeup()
+{
+  // a datagram socket connected to itself on the loopback interface
+  m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (m_socket == INVALID_SOCKET)
+    return;
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (bind(m_socket, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      getsockname(m_socket, (struct sockaddr*)&addr, &len) < 0 ||
+      connect(m_socket, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      !SetNonBlocking(m_socket))
+  {
+    CLog::Log(LOGERROR, "JSONRPC Server: Unable to create the wakeup socket");
+    closesocket(m_socket);
+    m_socket = INVALID_SOCKET;
+  }
+}
+
+CTCPServer::CWakeup::~CWakeup()
+{
+  if (m_socket != INVALID_SOCKET)
+    closesocket(m_socket);
+}
+
+void CTCPServer::CWakeup::Wake()
+{
+  // if the socket is full the server thread is awake anyway
+  char c = 0;
+  if (m_socket != INVALID_SOCKET)
+    send(m_socket, &c, 1, 0);
+}
+
+void CTCPServer::CWakeup::Drain()
+{
+  char buffer[64];
+  while (recv(m_socket, buffer, sizeof(buffer), 0) > 0)
+    ;
 }
 
 CTCPServer::CTCPClient::CTCPClient()
@@ -489,6 +695,10 @@ CTCPServer::CTCPClient::CTCPClient()
   m_endBrackets = 0;
   m_beginChar = 0;
   m_endChar = 0;
+  m_processing = false;
+  m_outputStart = 0;
+  m_streaming = false;
+  m_stalled = false;
 
   m_addrlen = sizeof(m_cliaddr);
 }
@@ -511,26 +721,144 @@ int CTCPServer::CTCPClient::GetPermissionFlags()
 
 int CTCPServer::CTCPClient::GetAnnouncementFlags()
 {
+  CSingleLock lock (m_critSection);
   return m_announcementflags;
 }
 
 bool CTCPServer::CTCPClient::SetAnnouncementFlags(int flags)
 {
+  CSingleLock lock (m_critSection);
   m_announcementflags = flags;
   return true;
 }
 
 void CTCPServer::CTCPClient::Send(const char *data, unsigned int size)
 {
-  unsigned int sent = 0;
-  do
+  CSingleLock lock (m_critSection);
+  // nothing may come between the pieces of a streamed response
+  if (!m_streaming)
+    m_output.append(data, size);
+  else if (m_deferred.size() + size <= MAX_DEFERRED_OUTPUT)
+    m_deferred.append(data, size);
+  else
+    CLog::Log(LOGDEBUG, "JSONRPC Server: Dropping %u bytes held back for a long response", size);
+}
+
+bool CTCPServer::CTCPClient::Flush()
+{
+  CSingleLock lock (m_critSection);
+  if (m_stalled)
+    return false;
+
+  while (m_outputStart < m_output.size())
   {
-    CSingleLock lock (m_critSection);
-    sent += send(m_socket, data + sent, size - sent, 0);
-  } while (sent < size);
+    int sent = send(m_socket, m_output.c_str() + m_outputStart, m_output.size() - m_outputStart, 0);
+    if (sent < 0)
+    {
+      bool blocked = WouldBlock();
+      // a streamed response is appended to while it's sent, drop what went out already
+      if (m_outputStart >= MIN_COMPACT_OUTPUT)
+      {
+        m_output.erase(0, m_outputStart);
+        m_outputStart = 0;
+      }
+      return blocked;
+    }
+    m_outputStart += sent;
+    if (m_output.size() - m_outputStart < MAX_PENDING_OUTPUT)
+      m_drained.Set();
+  }
+
+  m_output.clear();
+  m_outputStart = 0;
+  return true;
+}
+
+size_t CTCPServer::CTCPClient::PendingOutput()
+{
+  CSingleLock lock (m_critSection);
+  return m_output.size() - m_outputStart;
+}
+
+bool CTCPServer::CTCPClient::IsBusy()
+{
+  CSingleLock lock (m_critSection);
+  return m_requests.size() >= MAX_QUEUED_REQUESTS || m_output.size() - m_outputStart >= MAX_PENDING_OUTPUT;
 }
 
-void CTCPServer::CTCPClient::PushBuffer(CTCPServer *host, const char *buffer, int length)
+bool CTCPServer::CTCPClient::StartRequest(std::string &request)
+{
+  // the requests of a connection are answered in order
+  CSingleLock lock (m_critSection);
+  if (m_processing || m_requests.empty())
+    return false;
+
+  request = m_requests.front();
+  m_requests.pop_front();
+  m_processing = true;
+  return true;
+}
+
+void CTCPServer::CTCPClient::FinishRequest()
+{
+  CSingleLock lock (m_critSection);
+  m_processing = false;
+}
+
+void CTCPServer::CTCPClient::BeginResponse()
+{
+  CSingleLock lock (m_critSection);
+  m_streaming = true;
+}
+
+bool CTCPServer::CTCPClient::StreamResponse(const char *data, unsigned int size)
+{
+  CSingleLock lock (m_critSection);
+  if (m_socket == INVALID_SOCKET || m_stalled)
+    return false;
+
+  m_output.append(data, size);
+  return true;
+}
+
+bool CTCPServer::CTCPClient::WaitForOutput()
+{
+  // a slow connection holds up its worker rather than piling up output,
+  // but one that stops reading is dropped so it doesn't keep the worker
+  CSingleLock lock (m_critSection);
+  size_t pending = m_output.size() - m_outputStart;
+  XbmcThreads::EndTime timeout(STREAM_TIMEOUT);
+  while (m_socket != INVALID_SOCKET && !m_stalled && pending >= MAX_PENDING_OUTPUT)
+  {
+    if (timeout.IsTimePast())
+    {
+      CLog::Log(LOGINFO, "JSONRPC Server: Dropping a connection that stopped reading its response");
+      m_stalled = true;
+      break;
+    }
+
+    {
+      CSingleExit exit (m_critSection);
+      m_drained.WaitMSec(100);
+    }
+
+    if (m_output.size() - m_outputStart < pending)
+      timeout.Set(STREAM_TIMEOUT);
+    pending = m_output.size() - m_outputStart;
+  }
+
+  return m_socket != INVALID_SOCKET && !m_stalled;
+}
+
+void CTCPServer::CTCPClient::EndResponse()
+{
+  CSingleLock lock (m_critSection);
+  m_streaming = false;
+  m_output.append(m_deferred);
+  m_deferred.clear();
+}
+
+void CTCPServer::CTCPClient::PushBuffer(const char *buffer, int length)
 {
   m_new = false;
 
@@ -558,8 +886,8 @@ void CTCPServer::CTCPClient::PushBuffer(CTCPServer *host, const char *buffer, in
         m_endBrackets++;
       if (m_beginBrackets > 0 && m_endBrackets > 0 && m_beginBrackets == m_endBrackets)
       {
-        std::string line = CJSONRPC::MethodCall(m_buffer, host, this);
-        Send(line.c_str(), line.size());
+        CSingleLock lock (m_critSection);
+        m_requests.push_back(m_buffer);
         m_beginChar = m_beginBrackets = m_endBrackets = 0;
         m_buffer.clear();
       }
@@ -572,9 +900,13 @@ void CTCPServer::CTCPClient::Disconnect()
   if (m_socket > 0)
   {
     CSingleLock lock (m_critSection);
+    // what the socket takes right away, it doesn't block
+    Flush();
     shutdown(m_socket, SHUT_RDWR);
     closesocket(m_socket);
     m_socket = INVALID_SOCKET;
+    // a worker streaming a response gives up
+    m_drained.Set();
   }
 }
 
@@ -590,6 +922,13 @@ void CTCPServer::CTCPClient::Copy(const CTCPClient& client)
   m_beginChar         = client.m_beginChar;
   m_endChar           = client.m_endChar;
   m_buffer            = client.m_buffer;
+  m_requests          = client.m_requests;
+  m_processing        = client.m_processing;
+  m_output            = client.m_output;
+  m_outputStart       = client.m_outputStart;
+  m_streaming         = client.m_streaming;
+  m_deferred          = client.m_deferred;
+  m_stalled           = client.m_stalled;
 }
 
 CTCPServer::CWebSocketClient::CWebSocketClient(CWebSocket *websocket)
@@ -625,6 +964,8 @@ CTCPServer::CWebSocketClient& CTCPServer::CWebSocketClient::operator=(const CWeb
 
 void CTCPServer::CWebSocketClient::Send(const char *data, unsigned int size)
 {
+  // workers and announcements send while the server thread reads
+  CSingleLock lock (m_critSection);
   const CWebSocketMessage *msg = m_websocket->Send(WebSocketTextFrame, data, size);
   if (msg == NULL || !msg->IsComplete())
     return;
@@ -634,11 +975,12 @@ void CTCPServer::CWebSocketClient::Send(const char *data, unsigned int size)
     CTCPClient::Send(frames.at(index)->GetFrameData(), (unsigned int)frames.at(index)->GetFrameLength());
 }
 
-void CTCPServer::CWebSocketClient::PushBuffer(CTCPServer *host, const char *buffer, int length)
+void CTCPServer::CWebSocketClient::PushBuffer(const char *buffer, int length)
 {
   bool send;
   const CWebSocketMessage *msg = NULL;
   size_t len = length;
+  CSingleLock lock (m_critSection);
   do
   {
     if ((msg = m_websocket->Handle(buffer, len, send)) != NULL && msg->IsComplete())
@@ -652,7 +994,7 @@ void CTCPServer::CWebSocketClient::PushBuffer(CTCPServer *host, const char *buff
       else
       {
         for (unsigned int index = 0; index < frames.size(); index++)
-          CTCPClient::PushBuffer(host, frames.at(index)->GetApplicationData(), (int)frames.at(index)->GetLength());
+          CTCPClient::PushBuffer(frames.at(index)->GetApplicationData(), (int)frames.at(index)->GetLength());
       }
 
       delete msg;
@@ -668,6 +1010,7 @@ void CTCPServer::CWebSocketClient::Disconnect()
 {
   if (m_socket > 0)
   {
+    CSingleLock lock (m_critSection);
     if (m_websocket->GetState() != WebSocketStateClosed && m_websocket->GetState() != WebSocketStateNotConnected)
     {
       const CWebSocketFrame *closeFrame = m_websocket->Close();
@@ -679,4 +1022,3 @@ void CTCPServer::CWebSocketClient::Disconnect()
       CTCPClient::Disconnect();
   }
 }
-
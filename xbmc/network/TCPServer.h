@@ -19,39 +19,69 @@
  *
  */
 
+#include <deque>
 #include <vector>
 #include <sys/socket.h>
+#include <boost/shared_ptr.hpp>
 
 #include "interfaces/json-rpc/IClient.h"
 #include "interfaces/json-rpc/IJSONRPCAnnouncer.h"
-#include "interfaces/json-rpc/ITransportLayer.h"
 #include "threads/CriticalSection.h"
+#include "threads/Event.h"
 #include "threads/Thread.h"
 #include "websocket/WebSocket.h"
 
+class CJobQueue;
+class CSocketPoller;
+
 namespace JSONRPC
 {
-  class CTCPServer : public ITransportLayer, public JSONRPC::IJSONRPCAnnouncer, public CThread
+  /*! \brief JSON-RPC over raw TCP, bluetooth and websockets
+
+   A single thread waits for the sockets of all connections and does all of
+   their reading and writing. Complete requests are handled by job manager
+   workers, the requests of a connection one after the other and those of
+   different connections at the same time, and their responses and the
+   announcements are buffered until the socket takes them. A connection with
+   too many requests waiting or too much output unsent isn't read from until
+   it catches up, and announcements are dropped for it meanwhile. Responses
+   to raw TCP connections are queued piece by piece while they're produced,
+   the worker waiting whenever the connection falls too far behind.
+   */
+  class CTCPServer : public JSONRPC::IJSONRPCAnnouncer, public CThread
   {
   public:
     static bool StartServer(int port, bool nonlocal);
     static void StopServer(bool bWait);
     static bool IsRunning();
 
-    virtual bool PrepareDownload(const char *path, CVariant &details, std::string &protocol);
-    virtual bool Download(const char *path, CVariant &result);
-    virtual int GetCapabilities();
-
     virtual void Announce(ANNOUNCEMENT::AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data);
   protected:
     void Process();
   private:
     CTCPServer(int port, bool nonlocal);
+    ~CTCPServer();
     bool Initialize();
     bool InitializeBlue();
     bool InitializeTCP();
+    /*! \brief Watch a listening socket for connections, closing it if that fails */
+    bool AddServer(SOCKET fd);
     void Deinitialize();
 
+    /* Wakes the server thread from other threads, it outlives the server while workers hold on to it */
+    class CWakeup
+    {
+    public:
+      CWakeup();
+      ~CWakeup();
+
+      void Wake();
+      void Drain();
+
+      SOCKET m_socket;
+    };
+    typedef boost::shared_ptr<CWakeup> WakeupPtr;
+
     class CTCPClient : public IClient
     {
     public:
@@ -66,13 +96,42 @@ namespace JSONRPC
       virtual int  GetAnnouncementFlags();
       virtual bool SetAnnouncementFlags(int flags);
 
+      /*! \brief Queue data for the socket, any thread may send */
       virtual void Send(const char *data, unsigned int size);
-      virtual void PushBuffer(CTCPServer *host, const char *buffer, int length);
+      /*! \brief Parse received data, queueing the complete requests */
+      virtual void PushBuffer(const char *buffer, int length);
       virtual void Disconnect();
 
       virtual bool IsNew() const { return m_new; }
       virtual bool Closing() const { return false; }
 
+      /*! \brief Write as much of the queued data as the socket takes without blocking
+       \return false if the socket failed or the connection stalled
+       */
+      bool Flush();
+      /*! \brief Number of bytes queued for the socket */
+      size_t PendingOutput();
+      /*! \brief Whether the connection is behind and shouldn't be read from */
+      bool IsBusy();
+      /*! \brief Take the next request for a worker, unless one is handling a request already */
+      bool StartRequest(std::string &request);
+      void FinishRequest();
+
+      /*! \brief Whether responses may go out in pieces while they're produced */
+      virtual bool CanStream() const { return true; }
+      /*! \brief Start a response sent in pieces, data sent meanwhile is held back until it ends */
+      void BeginResponse();
+      /*! \brief Queue the next piece of the response
+       \return false once the connection is closed
+       */
+      bool StreamResponse(const char *data, unsigned int size);
+      /*! \brief Wait while the socket is too far behind to queue more
+       \return false once the connection is closed, or if it took nothing for a while
+       and is to be dropped (see Flush())
+       */
+      bool WaitForOutput();
+      void EndResponse();
+
       SOCKET           m_socket;
       sockaddr_storage m_cliaddr;
       socklen_t        m_addrlen;
@@ -86,7 +145,16 @@ namespace JSONRPC
       int m_beginBrackets, m_endBrackets;
       char m_beginChar, m_endChar;
       std::string m_buffer;
+      std::deque<std::string> m_requests; ///< complete requests waiting for a worker
+      bool m_processing;                  ///< a worker is handling a request
+      std::string m_output;               ///< data the socket didn't take yet
+      size_t m_outputStart;               ///< bytes of m_output already sent
+      bool m_streaming;                   ///< a response is being sent in pieces
+      std::string m_deferred;             ///< data sent while a response is streamed
+      bool m_stalled;                     ///< stopped reading a streamed response, to be dropped
+      CEvent m_drained;                   ///< signalled when the socket took some output
     };
+    typedef boost::shared_ptr<CTCPClient> ClientPtr;
 
     class CWebSocketClient : public CTCPClient
     {
@@ -98,9 +166,12 @@ namespace JSONRPC
       ~CWebSocketClient();
 
       virtual void Send(const char *data, unsigned int size);
-      virtual void PushBuffer(CTCPServer *host, const char *buffer, int length);
+      virtual void PushBuffer(const char *buffer, int length);
       virtual void Disconnect();
 
+      /* every message has to be framed as a whole */
+      virtual bool CanStream() const { return false; }
+
       virtual bool IsNew() const { return m_websocket == NULL; }
       virtual bool Closing() const { return m_websocket != NULL && m_websocket->GetState() == WebSocketStateClosed; }
 
@@ -108,8 +179,18 @@ namespace JSONRPC
       CWebSocket *m_websocket;
     };
 
-    std::vector<CTCPClient*> m_connections;
+    class CRequestJob;
+
+    /*! \brief Read from a connection, false if it closed */
+    bool ReadClient(unsigned int index);
+    void RemoveClient(unsigned int index);
+
+    CCriticalSection m_critSection; ///< guards m_connections, announcements come from other threads
+    std::vector<ClientPtr> m_connections;
     std::vector<SOCKET> m_servers;
+    CSocketPoller *m_poller;
+    CJobQueue *m_requestQueue;
+    WakeupPtr m_wakeup;
     int m_port;
     bool m_nonlocal;
     void* m_sdpd;
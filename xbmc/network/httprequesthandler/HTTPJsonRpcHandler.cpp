@@ -23,6 +23,7 @@
 #include "interfaces/json-rpc/JSONServiceDescription.h"
 #include "interfaces/json-rpc/JSONUtils.h"
 #include "network/WebServer.h"
+#include "utils/JSONStreamWriter.h"
 #include "utils/JSONVariantWriter.h"
 #include "utils/log.h"
 
@@ -70,7 +71,12 @@ int CHTTPJsonRpcHandler::HandleHTTPRequest(const HTTPRequest &request)
   }
 
   if (isRequest)
-    m_response = CJSONRPC::MethodCall(m_request, request.webserver, &client);
+  {
+    // the response is written straight into the buffer handed to libmicrohttpd
+    m_response.clear();
+    CJSONStringOutput output(m_response);
+    CJSONRPC::MethodCall(m_request, request.webserver, &client, &output);
+  }
   else
   {
     // get the whole output of JSONRPC.Introspect
@@ -250,6 +250,10 @@ void CAdvancedSettings::Initialize()
   m_fanartRes = 1080;
   m_imageRes = 720;
   m_useDDSFanart = false;
+  m_imageCacheReadThreads = 2;
+  m_imageCacheDecodeThreads = 2;
+  m_imageCacheEncodeThreads = 2;
+  m_imageCacheBatchSize = 50;
 
   m_sambaclienttimeout = 10;
   m_sambadoscodepage = "";
@@ -266,6 +270,7 @@ void CAdvancedSettings::Initialize()
   m_bMusicLibraryAllItemsOnBottom = false;
   m_bMusicLibraryAlbumsSortByArtistThenYear = false;
   m_bMusicLibraryCleanOnUpdate = false;
+  m_iMusicLibraryScanThreads = 4;
   m_iMusicLibraryRecentlyAddedItems = 25;
   m_strMusicLibraryAlbumFormat = "";
   m_strMusicLibraryAlbumFormatRight = "";
@@ -374,6 +379,10 @@ void CAdvancedSettings::Initialize()
   m_jsonOutputCompact = true;
   m_jsonTcpPort = 9090;
 
+  m_pythonPoolAddons.clear();
+  m_pythonPoolSize = 1;
+  m_pythonPoolIdleTime = 300;
+
   m_enableMultimediaKeys = false;
 
   m_canWindowed = true;
@@ -752,6 +761,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetBoolean(pElement, "allitemsonbottom", m_bMusicLibraryAllItemsOnBottom);
     XMLUtils::GetBoolean(pElement, "albumssortbyartistthenyear", m_bMusicLibraryAlbumsSortByArtistThenYear);
     XMLUtils::GetBoolean(pElement, "cleanonupdate", m_bMusicLibraryCleanOnUpdate);
+    XMLUtils::GetInt(pElement, "scanthreads", m_iMusicLibraryScanThreads, 1, 16);
     XMLUtils::GetString(pElement, "albumformat", m_strMusicLibraryAlbumFormat);
     XMLUtils::GetString(pElement, "albumformatright", m_strMusicLibraryAlbumFormatRight);
     XMLUtils::GetString(pElement, "itemseparator", m_musicItemSeparator);
@@ -811,6 +821,19 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetUInt(pElement, "tcpport", m_jsonTcpPort);
   }
 
+  pElement = pRootElement->FirstChildElement("pythonpool");
+  if (pElement)
+  {
+    XMLUtils::GetUInt(pElement, "size", m_pythonPoolSize, 0, 8);
+    XMLUtils::GetUInt(pElement, "idletime", m_pythonPoolIdleTime, 10, 86400);
+    m_pythonPoolAddons.clear();
+    for (const TiXmlElement *addon = pElement->FirstChildElement("addon"); addon; addon = addon->NextSiblingElement("addon"))
+    {
+      if (addon->FirstChild())
+        m_pythonPoolAddons.insert(addon->FirstChild()->ValueStr());
+    }
+  }
+
   pElement = pRootElement->FirstChildElement("samba");
   if (pElement)
   {
@@ -1040,6 +1063,16 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
 #if !defined(TARGET_RASPBERRY_PI)
   XMLUtils::GetBoolean(pRootElement, "useddsfanart", m_useDDSFanart);
 #endif
+
+  pElement = pRootElement->FirstChildElement("imagecache");
+  if (pElement)
+  {
+    XMLUtils::GetUInt(pElement, "readthreads", m_imageCacheReadThreads, 1, 16);
+    XMLUtils::GetUInt(pElement, "decodethreads", m_imageCacheDecodeThreads, 1, 16);
+    XMLUtils::GetUInt(pElement, "encodethreads", m_imageCacheEncodeThreads, 1, 16);
+    XMLUtils::GetUInt(pElement, "batchsize", m_imageCacheBatchSize, 1, 1000);
+  }
+
   XMLUtils::GetBoolean(pRootElement, "playlistasfolders", m_playlistAsFolders);
   XMLUtils::GetBoolean(pRootElement, "detectasudf", m_detectAsUdf);
 
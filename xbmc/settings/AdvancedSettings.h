@@ -19,6 +19,8 @@
  *
  */
 
+#include <set>
+#include <string>
 #include <vector>
 
 #include "settings/lib/ISettingCallback.h"
@@ -250,6 +252,10 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
      */
     unsigned int GetThumbSize() const { return m_imageRes / 2; };
     bool m_useDDSFanart;
+    unsigned int m_imageCacheReadThreads;   ///< \brief the number of images read for the texture cache at once
+    unsigned int m_imageCacheDecodeThreads; ///< \brief the number of images decoded for the texture cache at once
+    unsigned int m_imageCacheEncodeThreads; ///< \brief the number of images encoded for the texture cache at once
+    unsigned int m_imageCacheBatchSize;     ///< \brief the number of cached images stored in the texture database at once
 
     int m_sambaclienttimeout;
     CStdString m_sambadoscodepage;
@@ -267,6 +273,7 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     bool m_bMusicLibraryAllItemsOnBottom;
     bool m_bMusicLibraryAlbumsSortByArtistThenYear;
     bool m_bMusicLibraryCleanOnUpdate;
+    int m_iMusicLibraryScanThreads;
     CStdString m_strMusicLibraryAlbumFormat;
     CStdString m_strMusicLibraryAlbumFormatRight;
     bool m_prioritiseAPEv2tags;
@@ -387,6 +394,10 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     bool m_jsonOutputCompact;
     unsigned int m_jsonTcpPort;
 
+    std::set<std::string> m_pythonPoolAddons; ///< \brief the plugins whose python interpreters are kept between runs
+    unsigned int m_pythonPoolSize;            ///< \brief the number of interpreters kept per plugin
+    unsigned int m_pythonPoolIdleTime;        ///< \brief the seconds an interpreter is kept without being used
+
     bool m_enableMultimediaKeys;
     std::vector<CStdString> m_settingsFiles;
     void ParseSettingsFile(const CStdString &file);
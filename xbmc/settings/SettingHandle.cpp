@@ -0,0 +1,52 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SettingHandle.h"
+#include "settings/Settings.h"
+#include "settings/lib/SettingsManager.h"
+#include "threads/Atomics.h"
+
+CSettingHandleBase::CSettingHandleBase(const char *id, CSettingsManager *settingsManager)
+  : m_id(id),
+    m_settingsManager(settingsManager),
+    m_setting(0),
+    m_generation(0)
+{ }
+
+CSetting* CSettingHandleBase::Resolve(int type) const
+{
+  CSettingsManager *settingsManager = m_settingsManager;
+  if (settingsManager == NULL)
+    settingsManager = CSettings::Get().GetSettingsManager();
+
+  // the setting is still the one we resolved as long as the settings weren't cleared.
+  // the generation is stored after the setting, so it's loaded before it.
+  long generation = settingsManager->GetGeneration();
+  if (AtomicLoadAcquire(&m_generation) == generation)
+    return (CSetting*)AtomicLoadAcquire(&m_setting);
+
+  CSetting *setting = settingsManager->GetSetting(m_id);
+  if (setting == NULL || setting->GetType() != type)
+    return NULL;
+
+  AtomicStoreRelease(&m_setting, (long)setting);
+  AtomicStoreRelease(&m_generation, generation);
+  return setting;
+}
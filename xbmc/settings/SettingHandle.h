@@ -0,0 +1,132 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+
+#include "settings/lib/Setting.h"
+
+class CSettingsManager;
+
+/*!
+ \ingroup settings
+ \brief Base class of the typed setting handles, see CSettingHandle.
+ */
+class CSettingHandleBase
+{
+public:
+  const std::string& GetId() const { return m_id; }
+
+protected:
+  /*!
+   \param id Setting identifier (lower case)
+   \param settingsManager Settings manager the setting belongs to, NULL for the one of CSettings
+   */
+  CSettingHandleBase(const char *id, CSettingsManager *settingsManager);
+
+  /*!
+   \brief Gets the setting, looking it up by its identifier the first time
+   and whenever the settings have been cleared since.
+
+   \param type Type the setting must be of
+   \return Setting or NULL if there's no setting of the given type with the identifier
+   */
+  CSetting* Resolve(int type) const;
+
+private:
+  std::string m_id;
+  CSettingsManager *m_settingsManager;
+  mutable volatile long m_setting;    ///< the setting as it was resolved last
+  mutable volatile long m_generation; ///< the generation of the settings m_setting was resolved in
+};
+
+/*!
+ \ingroup settings
+ \brief Typed handle of a setting for code reading it often.
+
+ A handle is declared once, usually as a static next to the code using it,
+ and looks up its setting by identifier only the first time it's used. After
+ that reading it neither searches the settings nor takes a lock, as the value
+ is read from the snapshot of the setting (see CSettingAtomicValue and
+ CSettingValueSnapshot).
+
+ \code
+ static CSettingBoolHandle s_limitedRange("videoscreen.limitedrange");
+ if (s_limitedRange.Get())
+   ...
+ \endcode
+
+ Reading a setting that doesn't exist or is of another type returns the
+ default value of the type, like CSettings::GetBool() and friends do.
+ */
+template<class TSetting, typename TValue, int TType>
+class CSettingHandle : public CSettingHandleBase
+{
+public:
+  explicit CSettingHandle(const char *id, CSettingsManager *settingsManager = NULL)
+    : CSettingHandleBase(id, settingsManager)
+  { }
+
+  TValue Get() const
+  {
+    const TSetting *setting = (const TSetting*)Resolve(TType);
+    if (setting == NULL)
+      return TValue();
+
+    return setting->GetValue();
+  }
+
+  bool Set(const TValue &value) const
+  {
+    TSetting *setting = (TSetting*)Resolve(TType);
+    if (setting == NULL)
+      return false;
+
+    return setting->SetValue(value);
+  }
+
+  TSetting* GetSetting() const { return (TSetting*)Resolve(TType); }
+};
+
+typedef CSettingHandle<CSettingBool, bool, SettingTypeBool> CSettingBoolHandle;
+typedef CSettingHandle<CSettingInt, int, SettingTypeInteger> CSettingIntHandle;
+typedef CSettingHandle<CSettingNumber, double, SettingTypeNumber> CSettingNumberHandle;
+
+/*!
+ \ingroup settings
+ \brief Handle of a string setting, see CSettingHandle.
+ */
+class CSettingStringHandle : public CSettingHandle<CSettingString, std::string, SettingTypeString>
+{
+public:
+  explicit CSettingStringHandle(const char *id, CSettingsManager *settingsManager = NULL)
+    : CSettingHandle<CSettingString, std::string, SettingTypeString>(id, settingsManager)
+  { }
+
+  /*! \brief Whether the value is empty, cheaper than Get() as the value isn't copied */
+  bool IsEmpty() const
+  {
+    const CSettingString *setting = (const CSettingString*)Resolve(SettingTypeString);
+    if (setting == NULL)
+      return true;
+
+    return setting->IsEmpty();
+  }
+};
@@ -82,11 +82,18 @@ const string& CSkinSettings::GetString(int setting) const
 
 void CSkinSettings::SetString(int setting, const string &label)
 {
-  CSingleLock lock(m_critical);
-  map<int, CSkinString>::iterator it = m_strings.find(setting);
-  if (it != m_strings.end())
   {
-    it->second.value = label;
+    CSingleLock lock(m_critical);
+    map<int, CSkinString>::iterator it = m_strings.find(setting);
+    if (it != m_strings.end())
+      it->second.value = label;
+    else
+      setting = -1;
+  }
+  // outside of our lock, the info manager takes its own
+  if (setting >= 0)
+  {
+    g_infoManager.MarkChanged(INFO::DEPENDS_SKIN);
     return;
   }
 
@@ -129,11 +136,18 @@ bool CSkinSettings::GetBool(int setting) const
 
 void CSkinSettings::SetBool(int setting, bool set)
 {
-  CSingleLock lock(m_critical);
-  map<int, CSkinBool>::iterator it = m_bools.find(setting);
-  if (it != m_bools.end())
   {
-    it->second.value = set;
+    CSingleLock lock(m_critical);
+    map<int, CSkinBool>::iterator it = m_bools.find(setting);
+    if (it != m_bools.end())
+      it->second.value = set;
+    else
+      setting = -1;
+  }
+  // outside of our lock, the info manager takes its own
+  if (setting >= 0)
+  {
+    g_infoManager.MarkChanged(INFO::DEPENDS_SKIN);
     return;
   }
 
@@ -145,6 +159,12 @@ void CSkinSettings::Reset(const string &setting)
 {
   string settingName = StringUtils::Format("%s.%s", GetCurrentSkin().c_str(), setting.c_str());
 
+  if (ResetSetting(settingName))
+    g_infoManager.MarkChanged(INFO::DEPENDS_SKIN); // outside of our lock, the info manager takes its own
+}
+
+bool CSkinSettings::ResetSetting(const string &settingName)
+{
   CSingleLock lock(m_critical);
   // run through and see if we have this setting as a string
   for (map<int, CSkinString>::iterator it = m_strings.begin(); it != m_strings.end(); ++it)
@@ -152,7 +172,7 @@ void CSkinSettings::Reset(const string &setting)
     if (StringUtils::EqualsNoCase(settingName, it->second.name))
     {
       it->second.value.clear();
-      return;
+      return true;
     }
   }
 
@@ -162,9 +182,10 @@ void CSkinSettings::Reset(const string &setting)
     if (StringUtils::EqualsNoCase(settingName, it->second.name))
     {
       it->second.value = false;
-      return;
+      return true;
     }
   }
+  return false;
 }
 
 void CSkinSettings::Reset()
@@ -72,6 +72,8 @@ protected:
   virtual ~CSkinSettings();
 
   std::string GetCurrentSkin() const;
+  /*! \brief Reset a setting by its full name, false if there's no such setting */
+  bool ResetSetting(const std::string &settingName);
 
 private:
   std::map<int, CSkinString> m_strings;
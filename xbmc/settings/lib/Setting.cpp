@@ -591,7 +591,7 @@ CSettingBool::CSettingBool(const std::string &id, const CSettingBool &setting)
 
 CSettingBool::CSettingBool(const std::string &id, int label, bool value, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value)
+    m_value(value), m_default(value), m_snapshot(value)
 {
   m_label = label;
 }
@@ -611,7 +611,10 @@ bool CSettingBool::Deserialize(const TiXmlNode *node, bool update /* = false */)
   // get the default value
   bool value;
   if (XMLUtils::GetBoolean(node, SETTING_XML_ELM_DEFAULT, value))
+  {
     m_value = m_default = value;
+    m_snapshot.Publish(m_value);
+  }
   else if (!update)
   {
     CLog::Log(LOGERROR, "CSettingBool: error reading the default value of \"%s\"", m_id.c_str());
@@ -656,6 +659,7 @@ bool CSettingBool::SetValue(bool value)
 
   bool oldValue = m_value;
   m_value = value;
+  m_snapshot.BeginChange();
 
   if (!OnSettingChanging(this))
   {
@@ -666,9 +670,11 @@ bool CSettingBool::SetValue(bool value)
     // callback so we need to let all the callback handlers
     // know that the setting hasn't changed
     OnSettingChanging(this);
+    m_snapshot.EndChange(m_value);
     return false;
   }
 
+  m_snapshot.EndChange(m_value);
   m_changed = m_value != m_default;
   OnSettingChanged(this);
   return true;
@@ -680,7 +686,10 @@ void CSettingBool::SetDefault(bool value)
 
   m_default = value;
   if (!m_changed)
+  {
     m_value = m_default;
+    m_snapshot.Publish(m_value);
+  }
 }
 
 void CSettingBool::copy(const CSettingBool &setting)
@@ -688,6 +697,7 @@ void CSettingBool::copy(const CSettingBool &setting)
   CSetting::Copy(setting);
 
   m_value = setting.m_value;
+  m_snapshot.Publish(m_value);
   m_default = setting.m_default;
 }
   
@@ -725,7 +735,7 @@ CSettingInt::CSettingInt(const std::string &id, const CSettingInt &setting)
 
 CSettingInt::CSettingInt(const std::string &id, int label, int value, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value),
+    m_value(value), m_default(value), m_snapshot(value),
     m_min(0), m_step(1), m_max(0),
     m_optionsFiller(NULL),
     m_optionsFillerData(NULL)
@@ -735,7 +745,7 @@ CSettingInt::CSettingInt(const std::string &id, int label, int value, CSettingsM
 
 CSettingInt::CSettingInt(const std::string &id, int label, int value, int minimum, int step, int maximum, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value),
+    m_value(value), m_default(value), m_snapshot(value),
     m_min(minimum), m_step(step), m_max(maximum),
     m_optionsFiller(NULL),
     m_optionsFillerData(NULL)
@@ -745,7 +755,7 @@ CSettingInt::CSettingInt(const std::string &id, int label, int value, int minimu
 
 CSettingInt::CSettingInt(const std::string &id, int label, int value, const StaticIntegerSettingOptions &options, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value),
+    m_value(value), m_default(value), m_snapshot(value),
     m_min(0), m_step(1), m_max(0),
     m_options(options),
     m_optionsFiller(NULL),
@@ -769,7 +779,10 @@ bool CSettingInt::Deserialize(const TiXmlNode *node, bool update /* = false */)
   // get the default value
   int value;
   if (XMLUtils::GetInt(node, SETTING_XML_ELM_DEFAULT, value))
+  {
     m_value = m_default = value;
+    m_snapshot.Publish(m_value);
+  }
   else if (!update)
   {
     CLog::Log(LOGERROR, "CSettingInt: error reading the default value of \"%s\"", m_id.c_str());
@@ -891,6 +904,7 @@ bool CSettingInt::SetValue(int value)
 
   int oldValue = m_value;
   m_value = value;
+  m_snapshot.BeginChange();
 
   if (!OnSettingChanging(this))
   {
@@ -901,9 +915,11 @@ bool CSettingInt::SetValue(int value)
     // callback so we need to let all the callback handlers
     // know that the setting hasn't changed
     OnSettingChanging(this);
+    m_snapshot.EndChange(m_value);
     return false;
   }
 
+  m_snapshot.EndChange(m_value);
   m_changed = m_value != m_default;
   OnSettingChanged(this);
   return true;
@@ -915,7 +931,10 @@ void CSettingInt::SetDefault(int value)
 
   m_default = value;
   if (!m_changed)
+  {
     m_value = m_default;
+    m_snapshot.Publish(m_value);
+  }
 }
 
 SettingOptionsType CSettingInt::GetOptionsType() const
@@ -980,6 +999,7 @@ void CSettingInt::copy(const CSettingInt &setting)
   CExclusiveLock lock(m_critical);
 
   m_value = setting.m_value;
+  m_snapshot.Publish(m_value);
   m_default = setting.m_default;
   m_min = setting.m_min;
   m_step = setting.m_step;
@@ -1018,7 +1038,7 @@ CSettingNumber::CSettingNumber(const std::string &id, const CSettingNumber &sett
 
 CSettingNumber::CSettingNumber(const std::string &id, int label, float value, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value),
+    m_value(value), m_default(value), m_snapshot(value),
     m_min(0.0), m_step(1.0), m_max(0.0)
 {
   m_label = label;
@@ -1026,7 +1046,7 @@ CSettingNumber::CSettingNumber(const std::string &id, int label, float value, CS
 
 CSettingNumber::CSettingNumber(const std::string &id, int label, float value, float minimum, float step, float maximum, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value),
+    m_value(value), m_default(value), m_snapshot(value),
     m_min(minimum), m_step(step), m_max(maximum)
 {
   m_label = label;
@@ -1047,7 +1067,10 @@ bool CSettingNumber::Deserialize(const TiXmlNode *node, bool update /* = false *
   // get the default value
   double value;
   if (XMLUtils::GetDouble(node, SETTING_XML_ELM_DEFAULT, value))
+  {
     m_value = m_default = value;
+    m_snapshot.Publish(m_value);
+  }
   else if (!update)
   {
     CLog::Log(LOGERROR, "CSettingNumber: error reading the default value of \"%s\"", m_id.c_str());
@@ -1123,6 +1146,7 @@ bool CSettingNumber::SetValue(double value)
 
   double oldValue = m_value;
   m_value = value;
+  m_snapshot.BeginChange();
 
   if (!OnSettingChanging(this))
   {
@@ -1133,9 +1157,11 @@ bool CSettingNumber::SetValue(double value)
     // callback so we need to let all the callback handlers
     // know that the setting hasn't changed
     OnSettingChanging(this);
+    m_snapshot.EndChange(m_value);
     return false;
   }
 
+  m_snapshot.EndChange(m_value);
   m_changed = m_value != m_default;
   OnSettingChanged(this);
   return true;
@@ -1147,7 +1173,10 @@ void CSettingNumber::SetDefault(double value)
 
   m_default = value;
   if (!m_changed)
+  {
     m_value = m_default;
+    m_snapshot.Publish(m_value);
+  }
 }
 
 void CSettingNumber::copy(const CSettingNumber &setting)
@@ -1156,6 +1185,7 @@ void CSettingNumber::copy(const CSettingNumber &setting)
   CExclusiveLock lock(m_critical);
 
   m_value = setting.m_value;
+  m_snapshot.Publish(m_value);
   m_default = setting.m_default;
   m_min = setting.m_min;
   m_step = setting.m_step;
@@ -1177,6 +1207,7 @@ bool CSettingNumber::fromString(const std::string &strValue, double &value)
 
 CSettingString::CSettingString(const std::string &id, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
+    m_empty(true),
     m_allowEmpty(false),
     m_optionsFiller(NULL),
     m_optionsFillerData(NULL)
@@ -1192,7 +1223,7 @@ CSettingString::CSettingString(const std::string &id, const CSettingString &sett
 
 CSettingString::CSettingString(const std::string &id, int label, const std::string &value, CSettingsManager *settingsManager /* = NULL */)
   : CSetting(id, settingsManager),
-    m_value(value), m_default(value),
+    m_value(value), m_default(value), m_snapshot(value), m_empty(value.empty()),
     m_allowEmpty(false),
     m_optionsFiller(NULL),
     m_optionsFillerData(NULL)
@@ -1237,7 +1268,11 @@ bool CSettingString::Deserialize(const TiXmlNode *node, bool update /* = false *
   CStdString value;
   if (XMLUtils::GetString(node, SETTING_XML_ELM_DEFAULT, value) &&
      (!value.empty() || m_allowEmpty))
+  {
     m_value = m_default = value;
+    m_snapshot.Publish(m_value);
+    m_empty.Publish(m_value.empty());
+  }
   else if (!update && !m_allowEmpty)
   {
     CLog::Log(LOGERROR, "CSettingString: error reading the default value of \"%s\"", m_id.c_str());
@@ -1268,6 +1303,8 @@ bool CSettingString::SetValue(const std::string &value)
 
   std::string oldValue = m_value;
   m_value = value;
+  m_snapshot.BeginChange();
+  m_empty.BeginChange();
 
   if (!OnSettingChanging(this))
   {
@@ -1278,9 +1315,13 @@ bool CSettingString::SetValue(const std::string &value)
     // callback so we need to let all the callback handlers
     // know that the setting hasn't changed
     OnSettingChanging(this);
+    m_snapshot.EndChange(m_value);
+    m_empty.EndChange(m_value.empty());
     return false;
   }
 
+  m_snapshot.EndChange(m_value);
+  m_empty.EndChange(m_value.empty());
   m_changed = m_value != m_default;
   OnSettingChanged(this);
   return true;
@@ -1292,7 +1333,11 @@ void CSettingString::SetDefault(const std::string &value)
 
   m_default = value;
   if (!m_changed)
+  {
     m_value = m_default;
+    m_snapshot.Publish(m_value);
+    m_empty.Publish(m_value.empty());
+  }
 }
 
 SettingOptionsType CSettingString::GetOptionsType() const
@@ -1355,6 +1400,8 @@ void CSettingString::copy(const CSettingString &setting)
 
   CExclusiveLock lock(m_critical);
   m_value = setting.m_value;
+  m_snapshot.Publish(m_value);
+  m_empty.Publish(m_value.empty());
   m_default = setting.m_default;
   m_allowEmpty = setting.m_allowEmpty;
   m_optionsFillerName = setting.m_optionsFillerName;
@@ -32,6 +32,7 @@
 #include "SettingDefinitions.h"
 #include "SettingDependency.h"
 #include "SettingUpdate.h"
+#include "threads/Atomics.h"
 #include "threads/SharedSection.h"
 
 /*!
@@ -198,6 +199,137 @@ protected:
   int m_maximumItems;
 };
 
+/*!
+ \ingroup settings
+ \brief The value of a setting as it's read without taking a lock.
+
+ Used by the number and string settings, bool and integer settings publish
+ their value as it is, see CSettingAtomicValue.
+
+ Every published value is a copy of its own that never changes. Readers take
+ a reference to the current copy under a spin lock that is only held while
+ the pointer is copied, so a copy is deleted once the last reader holding it
+ is done with it rather than when the setting is deleted.
+
+ A changed value is published once the callbacks validating it have accepted
+ it, so readers never see a value that's rolled back. While it's validated
+ the snapshot is marked as changing and the setting reads its value under its
+ lock instead, which gives the callbacks the new value and has other readers
+ wait for the outcome. Values are published under the exclusive lock of the
+ setting.
+ */
+template<typename T>
+class CSettingValueSnapshot
+{
+public:
+  typedef boost::shared_ptr<const T> ValuePtr;
+
+  explicit CSettingValueSnapshot(const T &value = T())
+    : m_current(new T(value)), m_lock(0), m_changing(0)
+  { }
+  CSettingValueSnapshot(const CSettingValueSnapshot &snapshot)
+    : m_current(snapshot.Get()), m_lock(0), m_changing(0)
+  { }
+
+  CSettingValueSnapshot& operator=(const CSettingValueSnapshot &snapshot)
+  {
+    Swap(snapshot.Get());
+    return *this;
+  }
+
+  ValuePtr Get() const
+  {
+    CAtomicSpinLock lock(m_lock);
+    return m_current;
+  }
+
+  void Publish(const T &value)
+  {
+    if (*Get() == value)
+      return;
+
+    Swap(ValuePtr(new T(value)));
+  }
+
+  /*! \brief Whether a new value is being validated, see BeginChange() */
+  bool IsChanging() const { return AtomicLoadAcquire(&m_changing) != 0; }
+
+  /*! \brief Mark a new value as being validated, it's not published yet */
+  void BeginChange() { AtomicStoreRelease(&m_changing, 1); }
+
+  /*! \brief Publish the value the setting ended up with after validating a new one
+   \param value the new value if it was accepted, the old one otherwise
+   */
+  void EndChange(const T &value)
+  {
+    Publish(value);
+    AtomicStoreRelease(&m_changing, 0);
+  }
+
+private:
+  void Swap(ValuePtr value)
+  {
+    {
+      CAtomicSpinLock lock(m_lock);
+      m_current.swap(value);
+    }
+    // the old copy is released here, outside of the spin lock
+  }
+
+  ValuePtr m_current;
+  mutable long m_lock;
+  mutable volatile long m_changing;
+};
+
+/*!
+ \ingroup settings
+ \brief The value of a bool or integer setting as it's read without taking a lock.
+
+ The value fits in a long, so it's published with an atomic store and read
+ with an atomic load. Changes are validated and published like the ones of
+ CSettingValueSnapshot.
+ */
+template<typename T>
+class CSettingAtomicValue
+{
+public:
+  explicit CSettingAtomicValue(T value = T())
+    : m_value((long)value), m_changing(0)
+  { }
+  CSettingAtomicValue(const CSettingAtomicValue &value)
+    : m_value((long)value.Get()), m_changing(0)
+  { }
+
+  CSettingAtomicValue& operator=(const CSettingAtomicValue &value)
+  {
+    Publish(value.Get());
+    return *this;
+  }
+
+  T Get() const { return (T)AtomicLoadAcquire(&m_value); }
+
+  void Publish(T value) { AtomicStoreRelease(&m_value, (long)value); }
+
+  /*! \brief Whether a new value is being validated, see BeginChange() */
+  bool IsChanging() const { return AtomicLoadAcquire(&m_changing) != 0; }
+
+  /*! \brief Mark a new value as being validated, it's not published yet */
+  void BeginChange() { AtomicStoreRelease(&m_changing, 1); }
+
+  /*! \brief Publish the value the setting ended up with after validating a new one
+   \param value the new value if it was accepted, the old one otherwise
+   */
+  void EndChange(T value)
+  {
+    Publish(value);
+    AtomicStoreRelease(&m_changing, 0);
+  }
+
+private:
+  mutable volatile long m_value;
+  mutable volatile long m_changing;
+};
+
 /*!
  \ingroup settings
  \brief Boolean setting implementation.
@@ -222,7 +354,15 @@ public:
   virtual bool CheckValidity(const std::string &value) const;
   virtual void Reset() { SetValue(m_default); }
 
-  bool GetValue() const { CSharedLock lock(m_critical); return m_value; }
+  bool GetValue() const
+  {
+    if (m_snapshot.IsChanging())
+    {
+      CSharedLock lock(m_critical);
+      return m_value;
+    }
+    return m_snapshot.Get();
+  }
   bool SetValue(bool value);
   bool GetDefault() const { return m_default; }
   void SetDefault(bool value);
@@ -233,6 +373,7 @@ private:
 
   bool m_value;
   bool m_default;
+  CSettingAtomicValue<bool> m_snapshot; ///< m_value for readers that don't take the lock
 };
 
 /*!
@@ -262,7 +403,15 @@ public:
   virtual bool CheckValidity(int value) const;
   virtual void Reset() { SetValue(m_default); }
 
-  int GetValue() const { CSharedLock lock(m_critical); return m_value; }
+  int GetValue() const
+  {
+    if (m_snapshot.IsChanging())
+    {
+      CSharedLock lock(m_critical);
+      return m_value;
+    }
+    return m_snapshot.Get();
+  }
   bool SetValue(int value);
   int GetDefault() const { return m_default; }
   void SetDefault(int value);
@@ -296,6 +445,7 @@ private:
 
   int m_value;
   int m_default;
+  CSettingAtomicValue<int> m_snapshot; ///< m_value for readers that don't take the lock
   int m_min;
   int m_step;
   int m_max;
@@ -332,7 +482,15 @@ public:
   virtual bool CheckValidity(double value) const;
   virtual void Reset() { SetValue(m_default); }
 
-  double GetValue() const { CSharedLock lock(m_critical); return m_value; }
+  double GetValue() const
+  {
+    if (m_snapshot.IsChanging())
+    {
+      CSharedLock lock(m_critical);
+      return m_value;
+    }
+    return *m_snapshot.Get();
+  }
   bool SetValue(double value);
   double GetDefault() const { return m_default; }
   void SetDefault(double value);
@@ -350,6 +508,7 @@ private:
 
   double m_value;
   double m_default;
+  CSettingValueSnapshot<double> m_snapshot; ///< m_value for readers that don't take the lock
   double m_min;
   double m_step;
   double m_max;
@@ -379,7 +538,25 @@ public:
   virtual bool CheckValidity(const std::string &value) const;
   virtual void Reset() { SetValue(m_default); }
 
-  virtual const std::string& GetValue() const { CSharedLock lock(m_critical); return m_value; }
+  virtual std::string GetValue() const
+  {
+    if (m_snapshot.IsChanging())
+    {
+      CSharedLock lock(m_critical);
+      return m_value;
+    }
+    return *m_snapshot.Get();
+  }
+  /*! \brief Whether the value is empty, without copying it like GetValue() does */
+  bool IsEmpty() const
+  {
+    if (m_empty.IsChanging())
+    {
+      CSharedLock lock(m_critical);
+      return m_value.empty();
+    }
+    return m_empty.Get();
+  }
   virtual bool SetValue(const std::string &value);
   virtual const std::string& GetDefault() const { return m_default; }
   virtual void SetDefault(const std::string &value);
@@ -406,6 +583,8 @@ protected:
 
   std::string m_value;
   std::string m_default;
+  CSettingValueSnapshot<std::string> m_snapshot; ///< m_value for readers that don't take the lock
+  CSettingAtomicValue<bool> m_empty;              ///< whether m_value is empty, for readers that don't take the lock
   bool m_allowEmpty;
   std::string m_optionsFillerName;
   StringSettingOptionsFiller m_optionsFiller;
@@ -28,7 +28,8 @@
 
 
 CSettingsManager::CSettingsManager()
-  : m_initialized(false), m_loaded(false)
+  : m_initialized(false), m_loaded(false),
+    m_generation(1)
 { }
 
 CSettingsManager::~CSettingsManager()
@@ -161,6 +162,9 @@ void CSettingsManager::Clear()
   CExclusiveLock lock(m_critical);
   Unload();
 
+  // settings resolved before are about to be deleted
+  AtomicIncrement(&m_generation);
+
   m_settings.clear();
   for (SettingSectionMap::iterator section = m_sections.begin(); section != m_sections.end(); ++section)
     delete section->second;
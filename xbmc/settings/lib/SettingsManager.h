@@ -234,6 +234,16 @@ public:
    \return Setting object with the given identifier or NULL if the identifier is unknown
    */
   CSetting* GetSetting(const std::string &id) const;
+  /*!
+   \brief Gets the generation of the settings.
+
+   The generation changes whenever the settings are cleared, so pointers to
+   settings taken in an earlier generation must not be used anymore (see
+   CSettingHandle).
+
+   \return Generation of the settings
+   */
+  long GetGeneration() const { return AtomicLoadAcquire(&m_generation); }
   /*!
    \brief Gets the full list of setting sections.
 
@@ -456,4 +466,5 @@ private:
 
   CSharedSection m_critical;
   CSharedSection m_settingsCritical;
+  mutable volatile long m_generation;
 };
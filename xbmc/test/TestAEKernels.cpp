@@ -0,0 +1,264 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cores/AudioEngine/Utils/AEKernels.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+/* the odd sizes leave tails for the scalar code in the vector kernels */
+static const unsigned int Frames[] = { 0, 1, 3, 4, 7, 64, 1021 };
+static const unsigned int Channels[] = { 1, 2, 3, 6, 8 };
+
+/* samples in -range..range, with exact ties for the integer conversions */
+static std::vector<float> Samples(unsigned int count, float range, unsigned int seed)
+{
+  std::vector<float> samples(count);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    if (i % 5 == 4)
+      samples[i] = ((int)(seed >> 20) - 2048 + 0.5f) / 32768.0f;
+    else
+      samples[i] = ((seed >> 8) / 8388608.0f - 1.0f) * range;
+  }
+  return samples;
+}
+
+/* runs both kernel sets on copies of the same input */
+class CKernelCompare
+{
+public:
+  CKernelCompare() : m_best(CAEKernels::GetBestSet()), m_previous(CAEKernels::GetSet()) {}
+  ~CKernelCompare() { CAEKernels::SetSet(m_previous); }
+
+  void Scalar() { CAEKernels::SetSet(AE_KERNELS_SCALAR); }
+  void Best()   { CAEKernels::SetSet(m_best); }
+
+  AEKernelSet m_best;
+  AEKernelSet m_previous;
+};
+
+TEST(TestAEKernels, Mul)
+{
+  CKernelCompare compare;
+  for (unsigned int i = 0; i < sizeof(Frames) / sizeof(Frames[0]); i++)
+  {
+    for (unsigned int j = 0; j < sizeof(Channels) / sizeof(Channels[0]); j++)
+    {
+      unsigned int count = Frames[i] * Channels[j];
+      std::vector<float> gains = Samples(Frames[i] + 1, 2.0f, 7);
+      std::vector<float> expected = Samples(count + 1, 1.5f, i * 16 + j);
+      std::vector<float> data = expected;
+
+      compare.Scalar();
+      CAEKernels::Mul(&expected[1], 0.3f, count);
+      CAEKernels::MulFrames(&expected[1], &gains[1], Frames[i], Channels[j]);
+      compare.Best();
+      CAEKernels::Mul(&data[1], 0.3f, count);
+      CAEKernels::MulFrames(&data[1], &gains[1], Frames[i], Channels[j]);
+      EXPECT_EQ(0, memcmp(&expected[0], &data[0], data.size() * sizeof(float)))
+        << Frames[i] << " frames, " << Channels[j] << " channels";
+    }
+  }
+}
+
+TEST(TestAEKernels, MixAdd)
+{
+  CKernelCompare compare;
+  for (unsigned int i = 0; i < sizeof(Frames) / sizeof(Frames[0]); i++)
+  {
+    for (unsigned int j = 0; j < sizeof(Channels) / sizeof(Channels[0]); j++)
+    {
+      unsigned int count = Frames[i] * Channels[j];
+      std::vector<float> gains = Samples(Frames[i] + 1, 1.0f, 3);
+      std::vector<float> src = Samples(count + 1, 1.0f, i * 16 + j + 1);
+      std::vector<float> expected = Samples(count + 1, 1.0f, i * 16 + j);
+      std::vector<float> data = expected;
+
+      compare.Scalar();
+      float expectedPeak = CAEKernels::MixAdd(&expected[1], &src[0], 0.7f, count);
+      float expectedFramesPeak = CAEKernels::MixAddFrames(&expected[1], &src[0], &gains[0], Frames[i], Channels[j]);
+      compare.Best();
+      float peak = CAEKernels::MixAdd(&data[1], &src[0], 0.7f, count);
+      float framesPeak = CAEKernels::MixAddFrames(&data[1], &src[0], &gains[0], Frames[i], Channels[j]);
+      EXPECT_EQ(0, memcmp(&expected[0], &data[0], data.size() * sizeof(float)))
+        << Frames[i] << " frames, " << Channels[j] << " channels";
+      EXPECT_EQ(expectedPeak, peak);
+      EXPECT_EQ(expectedFramesPeak, framesPeak);
+    }
+  }
+
+  float dst[5] = { 0.5f, -0.5f, 0.25f, 0.0f, 0.0f };
+  const float src[5] = { 1.0f, -1.0f, 0.0f, 0.5f, -3.0f };
+  EXPECT_EQ(1.5f, CAEKernels::MixAdd(dst, src, 0.5f, 5));
+  EXPECT_EQ(-1.0f, dst[1]);
+}
+
+TEST(TestAEKernels, SoftClip)
+{
+  CKernelCompare compare;
+  std::vector<float> expected = Samples(1031, 4.0f, 11);
+  std::vector<float> data = expected;
+
+  compare.Scalar();
+  CAEKernels::SoftClip(&expected[1], expected.size() - 1);
+  compare.Best();
+  CAEKernels::SoftClip(&data[1], data.size() - 1);
+  EXPECT_EQ(0, memcmp(&expected[0], &data[0], data.size() * sizeof(float)));
+
+  float clip[] = { -5.0f, -3.0f, 0.0f, 3.0f, 5.0f };
+  CAEKernels::SoftClip(clip, 5);
+  EXPECT_EQ(-1.0f, clip[0]);
+  EXPECT_EQ(-1.0f, clip[1]);
+  EXPECT_EQ(0.0f, clip[2]);
+  EXPECT_EQ(1.0f, clip[3]);
+  EXPECT_EQ(1.0f, clip[4]);
+}
+
+TEST(TestAEKernels, Convert)
+{
+  CKernelCompare compare;
+  std::vector<float> src = Samples(1031, 1.2f, 5);
+  unsigned int count = src.size() - 1;
+  std::vector<int16_t> expected16(count), data16(count);
+  std::vector<int32_t> expected24(count), data24(count);
+  std::vector<int32_t> expected32(count), data32(count);
+
+  compare.Scalar();
+  CAEKernels::FloatToS16(&src[1], &expected16[0], count);
+  CAEKernels::FloatToS24(&src[1], &expected24[0], count);
+  CAEKernels::FloatToS32(&src[1], &expected32[0], count);
+  compare.Best();
+  CAEKernels::FloatToS16(&src[1], &data16[0], count);
+  CAEKernels::FloatToS24(&src[1], &data24[0], count);
+  CAEKernels::FloatToS32(&src[1], &data32[0], count);
+  EXPECT_TRUE(expected16 == data16);
+  EXPECT_TRUE(expected24 == data24);
+  EXPECT_TRUE(expected32 == data32);
+
+  // saturation and rounding to nearest even
+  const float values[] = { 1.0f, -1.0f, 2.0f, -2.0f, 0.5f / 32768, 1.5f / 32768, -2.5f / 32768, 0.0f };
+  int16_t s16[8];
+  int32_t s24[8], s32[8];
+  for (int set = 0; set < 2; set++)
+  {
+    if (set == 0)
+      compare.Scalar();
+    else
+      compare.Best();
+    CAEKernels::FloatToS16(values, s16, 8);
+    CAEKernels::FloatToS24(values, s24, 8);
+    CAEKernels::FloatToS32(values, s32, 8);
+    EXPECT_EQ(32767, s16[0]);
+    EXPECT_EQ(-32768, s16[1]);
+    EXPECT_EQ(32767, s16[2]);
+    EXPECT_EQ(-32768, s16[3]);
+    EXPECT_EQ(0, s16[4]);
+    EXPECT_EQ(2, s16[5]);
+    EXPECT_EQ(-2, s16[6]);
+    EXPECT_EQ(8388607, s24[0]);
+    EXPECT_EQ(-8388608, s24[1]);
+    EXPECT_EQ(128, s24[4]);
+    EXPECT_EQ(0x7FFFFFFF, s32[0]);
+    EXPECT_EQ((int32_t)0x80000000, s32[1]);
+    EXPECT_EQ(0x7FFFFFFF, s32[2]);
+    EXPECT_EQ((int32_t)0x80000000, s32[3]);
+    EXPECT_EQ(32768, s32[4]);
+  }
+}
+
+TEST(TestAEKernels, Interleave)
+{
+  CKernelCompare compare;
+  for (unsigned int j = 0; j < sizeof(Channels) / sizeof(Channels[0]); j++)
+  {
+    unsigned int channels = Channels[j];
+    unsigned int frames = 1021;
+    std::vector<float> interleaved = Samples(frames * channels, 1.0f, j);
+    std::vector<std::vector<float> > planes(channels, std::vector<float>(frames));
+    std::vector<float*> planePtrs(channels);
+    for (unsigned int c = 0; c < channels; c++)
+      planePtrs[c] = &planes[c][0];
+
+    CAEKernels::Deinterleave(&interleaved[0], &planePtrs[0], frames, channels);
+    for (unsigned int c = 0; c < channels; c++)
+      EXPECT_EQ(interleaved[(frames - 1) * channels + c], planes[c][frames - 1]);
+
+    std::vector<float> result(frames * channels);
+    CAEKernels::Interleave(&planePtrs[0], &result[0], frames, channels);
+    EXPECT_TRUE(interleaved == result) << channels << " channels";
+  }
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestAEKernels, DISABLED_Benchmark)
+{
+  CKernelCompare compare;
+  static const unsigned int frames = 1024;
+  static const unsigned int channels = 2;
+  static const int loops = 2000;
+  std::vector<float> src = Samples(frames * channels, 1.0f, 1);
+  std::vector<float> dst = Samples(frames * channels, 1.0f, 2);
+  std::vector<float> gains = Samples(frames, 1.0f, 3);
+  std::vector<int16_t> s16(frames * channels);
+  std::vector<int32_t> s32(frames * channels);
+
+  AEKernelSet sets[] = { AE_KERNELS_SCALAR, compare.m_best };
+  for (unsigned int s = 0; s < (compare.m_best == AE_KERNELS_SCALAR ? 1U : 2U); s++)
+  {
+    CAEKernels::SetSet(sets[s]);
+    CStopWatch watch;
+    float peak = 0.0f;
+
+    watch.StartZero();
+    for (int i = 0; i < loops; i++)
+      peak += CAEKernels::MixAdd(&dst[0], &src[0], (i & 1) ? 0.5f : -0.5f, frames * channels);
+    float mix = watch.GetElapsedMilliseconds();
+
+    watch.StartZero();
+    for (int i = 0; i < loops; i++)
+      peak += CAEKernels::MixAddFrames(&dst[0], &src[0], &gains[0], frames, channels);
+    float ramp = watch.GetElapsedMilliseconds();
+
+    watch.StartZero();
+    for (int i = 0; i < loops; i++)
+      CAEKernels::SoftClip(&dst[0], frames * channels);
+    float clip = watch.GetElapsedMilliseconds();
+
+    watch.StartZero();
+    for (int i = 0; i < loops; i++)
+      CAEKernels::FloatToS16(&src[0], &s16[0], frames * channels);
+    float toS16 = watch.GetElapsedMilliseconds();
+
+    watch.StartZero();
+    for (int i = 0; i < loops; i++)
+      CAEKernels::FloatToS32(&src[0], &s32[0], frames * channels);
+    float toS32 = watch.GetElapsedMilliseconds();
+
+    std::cout << CAEKernels::GetSetName(sets[s]) << " kernels, " << loops << " stereo periods of " << frames << " frames:"
+              << " mix " << mix << " ms, gain ramp mix " << ramp << " ms, soft clip " << clip << " ms,"
+              << " S16 " << toS16 << " ms, S32 " << toS32 << " ms" << (peak > 0.0f ? "" : " ") << std::endl;
+  }
+}
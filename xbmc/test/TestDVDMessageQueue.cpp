@@ -0,0 +1,298 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cores/dvdplayer/DVDClock.h"
+#include "cores/dvdplayer/DVDMessageQueue.h"
+#include "cores/dvdplayer/DVDDemuxers/DVDDemuxUtils.h"
+#include "threads/Thread.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+static CDVDMsg* NewPacket(int size, double dts)
+{
+  DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket(size);
+  packet->iSize = size;
+  packet->dts = dts;
+  return new CDVDMsgDemuxerPacket(packet);
+}
+
+static int GetInt(CDVDMessageQueue &queue, int priority = 0)
+{
+  CDVDMsg* msg = NULL;
+  if (queue.Get(&msg, 0, priority) != MSGQ_OK)
+    return -1;
+  int value = msg->IsType(CDVDMsg::GENERAL_SYNCHRONIZE) ? *(CDVDMsgInt*)msg : -2;
+  msg->Release();
+  return value;
+}
+
+TEST(TestDVDMessageQueue, Priority)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+  queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, 1));
+  queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, 2), 1);
+  queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, 3));
+  queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, 4), 1);
+
+  // priority messages first, each priority in the order it was put
+  EXPECT_EQ(2, GetInt(queue));
+  EXPECT_EQ(4, GetInt(queue, 1));
+  EXPECT_EQ(-1, GetInt(queue, 1));
+  EXPECT_EQ(1, GetInt(queue));
+  EXPECT_EQ(3, GetInt(queue));
+  EXPECT_EQ(-1, GetInt(queue));
+  queue.End();
+}
+
+TEST(TestDVDMessageQueue, Level)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+  queue.SetMaxDataSize(10000);
+  queue.SetMaxTimeSize(2.0);
+
+  queue.Put(NewPacket(1000, 0));
+  queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, 1));
+  queue.Put(NewPacket(2000, DVD_TIME_BASE / 2));
+  queue.Put(NewPacket(3000, DVD_TIME_BASE));
+  EXPECT_EQ(6000, queue.GetDataSize());
+  EXPECT_EQ(3U, queue.GetPacketCount(CDVDMsg::DEMUXER_PACKET));
+  EXPECT_FALSE(queue.IsDataBased());
+  EXPECT_EQ(50, queue.GetLevel());
+
+  CDVDMsg* msg;
+  ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 0));
+  EXPECT_TRUE(msg->IsType(CDVDMsg::DEMUXER_PACKET));
+  msg->Release();
+  EXPECT_EQ(5000, queue.GetDataSize());
+  EXPECT_EQ(50, queue.GetLevel());
+  EXPECT_EQ(1, GetInt(queue));
+  ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 0));
+  msg->Release();
+  EXPECT_EQ(3000, queue.GetDataSize());
+  EXPECT_EQ(25, queue.GetLevel());
+  queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, 2));
+  queue.Put(NewPacket(1000, 2 * DVD_TIME_BASE));
+
+  // flushing packets keeps the other messages
+  queue.Flush();
+  EXPECT_EQ(0, queue.GetDataSize());
+  EXPECT_EQ(0, queue.GetLevel());
+  EXPECT_EQ(0U, queue.GetPacketCount(CDVDMsg::DEMUXER_PACKET));
+  EXPECT_EQ(2, GetInt(queue));
+  EXPECT_EQ(-1, GetInt(queue));
+
+  // data based when there are no timestamps
+  queue.Put(NewPacket(2500, DVD_NOPTS_VALUE));
+  EXPECT_TRUE(queue.IsDataBased());
+  EXPECT_EQ(25, queue.GetLevel());
+  queue.Put(NewPacket(8000, DVD_NOPTS_VALUE));
+  EXPECT_TRUE(queue.IsFull());
+  queue.End();
+}
+
+class CQueueAborter : public IRunnable
+{
+public:
+  CQueueAborter(CDVDMessageQueue &queue) : m_queue(queue) {}
+  void Run()
+  {
+    XbmcThreads::ThreadSleep(50);
+    m_queue.Abort();
+  }
+  CDVDMessageQueue &m_queue;
+};
+
+TEST(TestDVDMessageQueue, Abort)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+  CQueueAborter aborter(queue);
+  CThread thread(&aborter, "QueueAborter");
+  thread.Create();
+
+  CDVDMsg* msg;
+  EXPECT_EQ(MSGQ_TIMEOUT, queue.Get(&msg, 10));
+  EXPECT_EQ(MSGQ_ABORT, queue.Get(&msg, 10000));
+  EXPECT_TRUE(queue.ReceivedAbortRequest());
+  EXPECT_TRUE(thread.WaitForThreadExit(10000));
+  queue.End();
+}
+
+/* puts count messages carrying source and a sequence number */
+class CQueueProducer : public IRunnable
+{
+public:
+  CQueueProducer(std::vector<CDVDMessageQueue*> &queues, int source, int count)
+    : m_queues(queues), m_source(source), m_count(count) {}
+
+  void Run()
+  {
+    for (int i = 0; i < m_count; i++)
+    {
+      for (std::vector<CDVDMessageQueue*>::iterator it = m_queues.begin(); it != m_queues.end(); ++it)
+      {
+        // the demuxer waits for room the same way
+        while ((*it)->IsFull())
+          XbmcThreads::ThreadSleep(0);
+        (*it)->Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, m_source << 24 | i));
+      }
+    }
+  }
+
+  std::vector<CDVDMessageQueue*> &m_queues;
+  int m_source;
+  int m_count;
+};
+
+/* gets count messages and checks each source's messages arrive in order */
+class CQueueConsumer : public IRunnable
+{
+public:
+  CQueueConsumer(CDVDMessageQueue &queue, int sources, int count)
+    : m_queue(queue), m_next(sources, 0), m_count(count), m_ordered(true) {}
+
+  void Run()
+  {
+    for (int i = 0; i < m_count; i++)
+    {
+      CDVDMsg* msg;
+      if (m_queue.Get(&msg, 10000) != MSGQ_OK)
+      {
+        m_ordered = false;
+        return;
+      }
+      int value = *(CDVDMsgInt*)msg;
+      msg->Release();
+      int source = value >> 24;
+      if (source >= (int)m_next.size() || (value & 0xFFFFFF) != m_next[source]++)
+        m_ordered = false;
+    }
+  }
+
+  CDVDMessageQueue &m_queue;
+  std::vector<int> m_next;
+  int m_count;
+  bool m_ordered;
+};
+
+/* producers threads feeding consumers threads, each consumer with a queue of its own */
+static float RunProducersConsumers(int producers, int consumers, int count, bool &ordered)
+{
+  std::vector<CDVDMessageQueue*> queues;
+  std::vector<CQueueConsumer*> consumerRunners;
+  std::vector<CQueueProducer*> producerRunners;
+  std::vector<CThread*> threads;
+  for (int i = 0; i < consumers; i++)
+  {
+    queues.push_back(new CDVDMessageQueue("test"));
+    queues.back()->Init();
+    queues.back()->SetMaxDataSize(1024 * 1024);
+    consumerRunners.push_back(new CQueueConsumer(*queues.back(), producers, producers * count));
+    threads.push_back(new CThread(consumerRunners.back(), "QueueConsumer"));
+  }
+  for (int i = 0; i < producers; i++)
+  {
+    producerRunners.push_back(new CQueueProducer(queues, i, count));
+    threads.push_back(new CThread(producerRunners.back(), "QueueProducer"));
+  }
+
+  CStopWatch watch;
+  watch.StartZero();
+  for (std::vector<CThread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+    (*it)->Create();
+  for (std::vector<CThread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+  {
+    EXPECT_TRUE((*it)->WaitForThreadExit(60000));
+    delete *it;
+  }
+  float elapsed = watch.GetElapsedSeconds();
+
+  ordered = true;
+  for (int i = 0; i < consumers; i++)
+  {
+    ordered &= consumerRunners[i]->m_ordered;
+    delete consumerRunners[i];
+    queues[i]->End();
+    delete queues[i];
+  }
+  for (int i = 0; i < producers; i++)
+    delete producerRunners[i];
+  return elapsed;
+}
+
+TEST(TestDVDMessageQueue, Producers)
+{
+  bool ordered;
+  RunProducersConsumers(4, 1, 20000, ordered);
+  EXPECT_TRUE(ordered);
+}
+
+TEST(TestDVDMessageQueue, Overflow)
+{
+  // more messages than the rings hold, none may be dropped
+  static const int count = 10000;
+  CDVDMessageQueue queue("test");
+  queue.Init();
+  for (int i = 0; i < count; i++)
+  {
+    EXPECT_EQ(MSGQ_OK, queue.Put(NewPacket(10, DVD_NOPTS_VALUE)));
+    EXPECT_EQ(MSGQ_OK, queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, i), 1));
+  }
+  EXPECT_EQ(10 * count, queue.GetDataSize());
+  EXPECT_EQ((unsigned)count, queue.GetPacketCount(CDVDMsg::DEMUXER_PACKET));
+  EXPECT_TRUE(queue.IsFull());
+
+  // taken in the order they were put, some from the rings and some from behind them
+  for (int i = 0; i < count / 2; i++)
+    ASSERT_EQ(i, GetInt(queue, 1));
+  for (int i = count; i < count + count / 2; i++)
+    EXPECT_EQ(MSGQ_OK, queue.Put(new CDVDMsgInt(CDVDMsg::GENERAL_SYNCHRONIZE, i), 1));
+  for (int i = count / 2; i < count + count / 2; i++)
+    ASSERT_EQ(i, GetInt(queue, 1));
+  EXPECT_EQ(-1, GetInt(queue, 1));
+
+  // flushing packets takes those behind the ring too
+  queue.Flush();
+  EXPECT_EQ(0, queue.GetDataSize());
+  EXPECT_EQ(0U, queue.GetPacketCount(CDVDMsg::DEMUXER_PACKET));
+  EXPECT_FALSE(queue.IsFull());
+  EXPECT_EQ(-1, GetInt(queue));
+  queue.End();
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestDVDMessageQueue, DISABLED_BenchmarkContention)
+{
+  static const int count = 200000;
+  for (int consumers = 1; consumers <= 4; consumers++)
+  {
+    bool ordered;
+    float elapsed = RunProducersConsumers(1, consumers, count, ordered);
+    EXPECT_TRUE(ordered);
+    std::cout << "1 producer, " << consumers << " consumers: " << count * consumers << " messages in "
+              << elapsed * 1000 << " ms, " << (elapsed > 0 ? count * consumers / elapsed : 0) << " messages/s" << std::endl;
+  }
+}
@@ -0,0 +1,152 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cores/dvdplayer/DVDClock.h"
+#include "cores/dvdplayer/DVDDemuxers/DVDDemux.h"
+#include "cores/dvdplayer/DVDDemuxers/DVDDemuxUtils.h"
+#include "cores/dvdplayer/DVDDemuxers/DVDFactoryDemuxer.h"
+#include "cores/dvdplayer/DVDInputStreams/DVDFactoryInputStream.h"
+#include "cores/dvdplayer/DVDInputStreams/DVDInputStream.h"
+#include "utils/Stopwatch.h"
+#include "test/TestUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <string.h>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+TEST(TestDemuxPacketPool, Recycle)
+{
+  DemuxPacketStats before, after;
+  CDVDDemuxUtils::GetStats(before);
+
+  DemuxPacket *packet = CDVDDemuxUtils::AllocateDemuxPacket(3000);
+  ASSERT_TRUE(packet != NULL);
+  EXPECT_EQ(0, (intptr_t)packet->pData & 15);
+  EXPECT_EQ(DVD_NOPTS_VALUE, packet->pts);
+  EXPECT_EQ(-1, packet->iStreamId);
+  memset(packet->pData, 0xFF, 3000 + FF_INPUT_BUFFER_PADDING_SIZE);
+  packet->pts = 1.0;
+  uint8_t *data = packet->pData;
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+
+  // a slightly smaller packet of the same size class gets the same memory, reset
+  packet = CDVDDemuxUtils::AllocateDemuxPacket(2900);
+  ASSERT_TRUE(packet != NULL);
+  EXPECT_EQ(data, packet->pData);
+  EXPECT_EQ(DVD_NOPTS_VALUE, packet->pts);
+  EXPECT_EQ(0, packet->iSize);
+  for (int i = 0; i < FF_INPUT_BUFFER_PADDING_SIZE; i++)
+    EXPECT_EQ(0, packet->pData[2900 + i]);
+
+  // packets too big for the pool still work
+  DemuxPacket *big = CDVDDemuxUtils::AllocateDemuxPacket(8 * 1024 * 1024);
+  ASSERT_TRUE(big != NULL);
+  big->pData[8 * 1024 * 1024 - 1] = 1;
+
+  DemuxPacket *empty = CDVDDemuxUtils::AllocateDemuxPacket(0);
+  ASSERT_TRUE(empty != NULL);
+  EXPECT_TRUE(empty->pData == NULL);
+
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+  CDVDDemuxUtils::FreeDemuxPacket(big);
+  CDVDDemuxUtils::FreeDemuxPacket(empty);
+
+  CDVDDemuxUtils::GetStats(after);
+  EXPECT_EQ(before.allocated + 4, after.allocated);
+  EXPECT_LE(before.reused + 1, after.reused);
+}
+
+TEST(TestDemuxPacketPool, FromAVPacket)
+{
+  DemuxPacketStats before, after;
+  CDVDDemuxUtils::GetStats(before);
+
+  AVPacket pkt;
+  ASSERT_EQ(0, av_new_packet(&pkt, 1000));
+  for (int i = 0; i < pkt.size; i++)
+    pkt.data[i] = (uint8_t)i;
+
+  DemuxPacket *packet = CDVDDemuxUtils::AllocateDemuxPacket(&pkt);
+  ASSERT_TRUE(packet != NULL);
+  ASSERT_EQ(1000, packet->iSize);
+  for (int i = 0; i < packet->iSize; i++)
+    EXPECT_EQ((uint8_t)i, packet->pData[i]);
+  for (int i = 0; i < FF_INPUT_BUFFER_PADDING_SIZE; i++)
+    EXPECT_EQ(0, packet->pData[1000 + i]);
+
+  // the packet stays valid when the demuxer is done with its buffer
+  av_free_packet(&pkt);
+  EXPECT_EQ(999 & 0xFF, packet->pData[999]);
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+
+  CDVDDemuxUtils::GetStats(after);
+  EXPECT_EQ(before.allocated + 1, after.allocated);
+  if (after.referenced == before.referenced)
+    EXPECT_EQ(before.bytesCopied + 1000, after.bytesCopied);
+  else
+    EXPECT_EQ(before.bytesCopied, after.bytesCopied);
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestDemuxPacketPool, DISABLED_BenchmarkDemux)
+{
+  std::vector<CStdString> urls = CXBMCTestUtils::Instance().getTestFileFactoryReadUrls();
+  if (urls.empty())
+    urls.push_back(XBMC_REF_FILE_PATH("addons/skin.confluence/sounds/notify.wav"));
+
+  for (std::vector<CStdString>::const_iterator url = urls.begin(); url != urls.end(); ++url)
+  {
+    CDVDInputStream *input = CDVDFactoryInputStream::CreateInputStream(NULL, *url, "");
+    ASSERT_TRUE(input != NULL);
+    ASSERT_TRUE(input->Open(url->c_str(), ""));
+    CDVDDemux *demuxer = CDVDFactoryDemuxer::CreateDemuxer(input);
+    ASSERT_TRUE(demuxer != NULL);
+
+    DemuxPacketStats before, after;
+    CDVDDemuxUtils::GetStats(before);
+    CStopWatch watch;
+    watch.StartZero();
+
+    uint64_t bytes = 0;
+    DemuxPacket *packet;
+    while ((packet = demuxer->Read()) != NULL)
+    {
+      bytes += packet->iSize;
+      CDVDDemuxUtils::FreeDemuxPacket(packet);
+    }
+
+    float elapsed = watch.GetElapsedSeconds();
+    CDVDDemuxUtils::GetStats(after);
+    uint64_t packets = after.allocated - before.allocated;
+    std::cout << *url << ": " << packets << " packets, " << bytes << " bytes in " << elapsed * 1000 << " ms, "
+              << (elapsed > 0.0f ? packets / elapsed : 0.0f) << " packets/s, "
+              << after.reused - before.reused << " recycled, "
+              << after.referenced - before.referenced << " without copy, "
+              << after.bytesCopied - before.bytesCopied << " bytes copied" << std::endl;
+
+    delete demuxer;
+    delete input;
+  }
+}
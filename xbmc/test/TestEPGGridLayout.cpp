@@ -0,0 +1,270 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "epg/EpgInfoTag.h"
+#include "epg/GUIEPGGridLayout.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace EPG;
+
+#define TEST_MINSPERBLOCK 5
+
+class TestEPGGridLayout : public testing::Test
+{
+protected:
+  TestEPGGridLayout() : m_state(42)
+  {
+    m_start = CDateTime(2013, 1, 1, 0, 0, 0);
+  }
+
+  unsigned int Random(unsigned int max)
+  {
+    m_state = m_state * 1103515245 + 12345;
+    return (m_state >> 8) % max;
+  }
+
+  CGUIListItemPtr Programme(int iStartMinutes, int iEndMinutes)
+  {
+    CEpgInfoTag tag;
+    tag.SetStartFromUTC(m_start + CDateTimeSpan(0, 0, iStartMinutes, 0));
+    tag.SetEndFromUTC(m_start + CDateTimeSpan(0, 0, iEndMinutes, 0));
+    return CGUIListItemPtr(new CFileItem(tag));
+  }
+
+  /* gaps are filled with items of empty tags */
+  static bool IsGap(const CGUIListItemPtr &item)
+  {
+    return !((CFileItem *)item.get())->GetEPGInfoTag()->StartAsUTC().IsValid();
+  }
+
+  /* back to back shows of 10 to 120 minutes with the odd gap, not aligned to blocks */
+  void Channel(int iMinutes, std::vector<CGUIListItemPtr> &programmes)
+  {
+    int iStart = (int)Random(30);
+    while (iStart < iMinutes)
+    {
+      int iEnd = iStart + 10 + Random(12) * 10 + Random(3);
+      programmes.push_back(Programme(iStart, iEnd));
+      iStart = iEnd + (Random(20) ? 0 : 15);
+    }
+  }
+
+  /* the block index the grid container built before it had a layout */
+  void BlockLayout(const std::vector<CGUIListItemPtr> &programmes, int iBlocks, std::vector<CGUIListItemPtr> &blocks)
+  {
+    CDateTimeSpan blockDuration;
+    blockDuration.SetDateTimeSpan(0, 0, TEST_MINSPERBLOCK, 0);
+
+    blocks.assign(iBlocks, CGUIListItemPtr());
+    CDateTime gridCursor = m_start;
+    unsigned int progIdx = 0;
+    for (int block = 0; block < iBlocks; block++)
+    {
+      while (progIdx < programmes.size())
+      {
+        const CEpgInfoTag *tag = ((CFileItem *)programmes[progIdx].get())->GetEPGInfoTag();
+        if (gridCursor < tag->StartAsUTC())
+          break;
+
+        if (gridCursor < tag->EndAsUTC())
+        {
+          blocks[block] = programmes[progIdx];
+          break;
+        }
+
+        progIdx++;
+      }
+      gridCursor += blockDuration;
+    }
+  }
+
+  CDateTime m_start;
+  unsigned int m_state;
+};
+
+TEST_F(TestEPGGridLayout, Intervals)
+{
+  CGUIEPGGridLayout layout;
+  layout.Initialize(m_start, 48, TEST_MINSPERBLOCK, 10.0f, 20.0f);
+
+  std::vector<CGUIListItemPtr> programmes;
+  programmes.push_back(Programme(-20, 12));  // starts before the grid, ends in block 2
+  programmes.push_back(Programme(10, 40));   // overlaps the first one
+  programmes.push_back(Programme(60, 61));   // a gap before it, shorter than a block
+  programmes.push_back(Programme(90, 600));  // ends after the grid
+  layout.AddRow(programmes);
+
+  EXPECT_EQ(0, layout.LaidOutRows());
+  std::vector<GridItemsPtr> &row = layout.GetRow(0);
+  EXPECT_EQ(1, layout.LaidOutRows());
+
+  ASSERT_EQ(6U, row.size());
+  EXPECT_TRUE(row[0].item == programmes[0]);
+  EXPECT_EQ(0, row[0].startBlock);
+  EXPECT_EQ(3, row[0].blocks);
+  EXPECT_FLOAT_EQ(30.0f, row[0].originWidth);
+  EXPECT_FLOAT_EQ(20.0f, row[0].originHeight);
+  EXPECT_TRUE(row[1].item == programmes[1]);
+  EXPECT_EQ(3, row[1].startBlock);
+  EXPECT_EQ(5, row[1].blocks);
+  EXPECT_TRUE(IsGap(row[2].item));
+  EXPECT_EQ(8, row[2].startBlock);
+  EXPECT_EQ(4, row[2].blocks);
+  EXPECT_TRUE(row[3].item == programmes[2]);
+  EXPECT_EQ(12, row[3].startBlock);
+  EXPECT_EQ(1, row[3].blocks);
+  EXPECT_TRUE(IsGap(row[4].item));
+  EXPECT_EQ(13, row[4].startBlock);
+  EXPECT_EQ(5, row[4].blocks);
+  EXPECT_TRUE(row[5].item == programmes[3]);
+  EXPECT_EQ(18, row[5].startBlock);
+  EXPECT_EQ(30, row[5].blocks);
+
+  EXPECT_EQ(0, layout.Find(0, 0));
+  EXPECT_EQ(0, layout.Find(0, 2));
+  EXPECT_EQ(1, layout.Find(0, 3));
+  EXPECT_EQ(2, layout.Find(0, 10));
+  EXPECT_EQ(3, layout.Find(0, 12));
+  EXPECT_EQ(5, layout.Find(0, 47));
+  EXPECT_EQ(-1, layout.Find(0, 48));
+  EXPECT_EQ(-1, layout.Find(0, -1));
+  EXPECT_EQ(-1, layout.Find(1, 0));
+  EXPECT_TRUE(layout.GetItem(1, 0) == NULL);
+  EXPECT_TRUE(layout.GetItem(0, 20) == &row[5]);
+  EXPECT_TRUE(layout.GetListItem(0, 20) == programmes[3]);
+  EXPECT_FALSE(layout.GetListItem(0, 48));
+}
+
+TEST_F(TestEPGGridLayout, SameAsBlocks)
+{
+  const int iBlocks = 2 * 24 * 60 / TEST_MINSPERBLOCK;
+  CGUIEPGGridLayout layout;
+  layout.Initialize(m_start, iBlocks, TEST_MINSPERBLOCK, 10.0f, 20.0f);
+
+  std::vector<std::vector<CGUIListItemPtr> > channels(20);
+  for (unsigned int i = 0; i < channels.size(); i++)
+  {
+    Channel(3 * 24 * 60, channels[i]);
+    layout.AddRow(channels[i]);
+  }
+
+  // every block shows the programme it showed before, gaps are filled
+  for (unsigned int i = 0; i < channels.size(); i++)
+  {
+    std::vector<CGUIListItemPtr> blocks;
+    BlockLayout(channels[i], iBlocks, blocks);
+    for (int block = 0; block < iBlocks; block++)
+    {
+      CGUIListItemPtr item = layout.GetListItem(i, block);
+      ASSERT_TRUE(item);
+      if (blocks[block])
+        EXPECT_TRUE(item == blocks[block]) << "channel " << i << " block " << block;
+      else
+        EXPECT_TRUE(IsGap(item)) << "channel " << i << " block " << block;
+    }
+
+    // and the intervals cover the row without overlapping
+    const std::vector<GridItemsPtr> &row = layout.GetRow(i);
+    int iNextBlock = 0;
+    for (std::vector<GridItemsPtr>::const_iterator it = row.begin(); it != row.end(); it++)
+    {
+      EXPECT_EQ(iNextBlock, it->startBlock);
+      EXPECT_GT(it->blocks, 0);
+      iNextBlock = it->startBlock + it->blocks;
+    }
+    EXPECT_EQ(iBlocks, iNextBlock);
+  }
+}
+
+TEST_F(TestEPGGridLayout, Clear)
+{
+  CGUIEPGGridLayout layout;
+  layout.Initialize(m_start, 288, TEST_MINSPERBLOCK, 10.0f, 20.0f);
+
+  std::vector<CGUIListItemPtr> programmes;
+  Channel(24 * 60, programmes);
+  for (int i = 0; i < 10; i++)
+    layout.AddRow(programmes);
+  for (int i = 0; i < 10; i++)
+    layout.GetRow(i);
+  EXPECT_EQ(10, layout.LaidOutRows());
+
+  layout.Clear();
+  EXPECT_EQ(0, layout.Rows());
+  EXPECT_EQ(0, layout.LaidOutRows());
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestEPGGridLayout, DISABLED_BenchmarkLargeGuide)
+{
+  // 1000 channels with two weeks of shows each, in 5 minute blocks
+  const int iChannels = 1000;
+  const int iBlocks   = 14 * 24 * 60 / TEST_MINSPERBLOCK;
+  const int iVisible  = 10;
+
+  std::vector<std::vector<CGUIListItemPtr> > channels(iChannels);
+  size_t programmes = 0;
+  for (int i = 0; i < iChannels; i++)
+  {
+    Channel(14 * 24 * 60, channels[i]);
+    programmes += channels[i].size();
+  }
+
+  CStopWatch watch;
+  CGUIEPGGridLayout layout;
+
+  // binding the guide and showing a page of it
+  watch.StartZero();
+  layout.Initialize(m_start, iBlocks, TEST_MINSPERBLOCK, 10.0f, 20.0f);
+  for (int i = 0; i < iChannels; i++)
+    layout.AddRow(channels[i]);
+  for (int i = 0; i < iVisible; i++)
+    layout.GetRow(i);
+  float visibleTime = watch.GetElapsedMilliseconds();
+  EXPECT_EQ(iVisible, layout.LaidOutRows());
+
+  // scrolling through every channel
+  watch.StartZero();
+  size_t items = 0;
+  for (int i = 0; i < iChannels; i++)
+    items += layout.GetRow(i).size();
+  float fullTime = watch.GetElapsedMilliseconds();
+  EXPECT_EQ(iChannels, layout.LaidOutRows());
+
+  // the block index that was built before, for all channels
+  watch.StartZero();
+  std::vector<CGUIListItemPtr> blocks;
+  for (int i = 0; i < iChannels; i++)
+    BlockLayout(channels[i], iBlocks, blocks);
+  float blockTime = watch.GetElapsedMilliseconds();
+
+  std::cout << iChannels << " channels, " << programmes << " programmes, " << iBlocks << " blocks per channel" << std::endl;
+  std::cout << "visible page laid out in " << visibleTime << " ms" << std::endl;
+  std::cout << "all channels laid out in " << fullTime << " ms, " << items << " intervals ("
+            << items * sizeof(GridItemsPtr) / 1024 << " kB)" << std::endl;
+  std::cout << "block index built in " << blockTime << " ms, " << (size_t)iChannels * iBlocks << " blocks ("
+            << (size_t)iChannels * iBlocks * sizeof(GridItemsPtr) / 1024 << " kB)" << std::endl;
+}
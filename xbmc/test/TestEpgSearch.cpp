@@ -0,0 +1,327 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "addons/include/xbmc_epg_types.h"
+#include "epg/Epg.h"
+#include "epg/EpgSearchIndex.h"
+#include "threads/SingleLock.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <ctype.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace EPG;
+
+static const char *Syllables[] = { "ka", "ro", "mi", "tan", "sel", "vo", "dra", "pe", "lu", "ber", "gon", "shi", "ta", "ex", "qua", "ni" };
+
+/* a small random number generator, so every run makes the same guide */
+class CGuideRandom
+{
+public:
+  CGuideRandom(unsigned int seed) : m_state(seed) { }
+
+  unsigned int Next(unsigned int max)
+  {
+    m_state = m_state * 1103515245 + 12345;
+    return (m_state >> 8) % max;
+  }
+
+private:
+  unsigned int m_state;
+};
+
+/* an EPG table that can be searched the way it was before it had an index */
+class CTestEpg : public CEpg
+{
+public:
+  CTestEpg(int iEpgID) : CEpg(iEpgID, StringUtils::Format("Channel %d", iEpgID)) { }
+
+  int Scan(CFileItemList &results, const EpgSearchFilter &filter) const
+  {
+    int iInitialSize = results.Size();
+    CSingleLock lock(m_critSection);
+    for (std::map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+    {
+      if (filter.FilterEntry(*it->second))
+        results.Add(CFileItemPtr(new CFileItem(*it->second)));
+    }
+    return results.Size() - iInitialSize;
+  }
+};
+
+class TestEpgSearch : public testing::Test
+{
+protected:
+  TestEpgSearch() : m_random(42)
+  {
+    m_start = CDateTime::GetCurrentDateTime().GetAsUTCDateTime() - CDateTimeSpan(0, 1, 0, 0);
+
+    for (int i = 0; i < 2000; i++)
+    {
+      std::string word;
+      for (unsigned int syllables = 2 + m_random.Next(3); syllables > 0; syllables--)
+        word += Syllables[m_random.Next(sizeof(Syllables) / sizeof(Syllables[0]))];
+      m_vocabulary.push_back(word);
+    }
+    m_vocabulary[0] = "news";
+    m_vocabulary[1] = "sport";
+    m_vocabulary[2] = "late";
+  }
+
+  ~TestEpgSearch()
+  {
+    for (std::vector<CTestEpg*>::iterator it = m_tables.begin(); it != m_tables.end(); it++)
+      delete *it;
+  }
+
+  std::string Words(unsigned int count, bool bCapitalise)
+  {
+    std::string text;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      // some words are a lot more common than others
+      std::string word = m_vocabulary[m_random.Next(m_random.Next(2) ? 50 : m_vocabulary.size())];
+      if (bCapitalise)
+        word[0] = toupper(word[0]);
+      text += (i > 0 ? " " : "") + word;
+    }
+    return text;
+  }
+
+  /* a guide of back to back shows of 10 to 60 minutes */
+  void Fill(int iTables, int iTagsPerTable)
+  {
+    int iBroadcastId(1);
+    for (int iTable = 1; iTable <= iTables; iTable++)
+    {
+      CTestEpg *epg = new CTestEpg(iTable);
+      CDateTime start = m_start;
+      for (int iTag = 0; iTag < iTagsPerTable; iTag++)
+      {
+        CDateTime end = start + CDateTimeSpan(0, 0, 10 + m_random.Next(6) * 10, 0);
+        CEpgInfoTag tag;
+        tag.SetUniqueBroadcastID(iBroadcastId++);
+        tag.SetStartFromUTC(start);
+        tag.SetEndFromUTC(end);
+        tag.SetTitle(Words(1 + m_random.Next(3), true));
+        tag.SetPlotOutline(Words(5 + m_random.Next(10), false) + ".");
+        tag.SetGenre(EPG_EVENT_CONTENTMASK_MOVIEDRAMA + m_random.Next(11) * 0x10, 0, NULL);
+        epg->UpdateEntry(tag);
+        start = end;
+      }
+      m_tables.push_back(epg);
+      m_end = start;
+    }
+  }
+
+  EpgSearchFilter Filter(const std::string &strTerm) const
+  {
+    EpgSearchFilter filter;
+    filter.m_strSearchTerm            = strTerm;
+    filter.m_bIsCaseSensitive         = false;
+    filter.m_bSearchInDescription     = false;
+    filter.m_iGenreType               = EPG_SEARCH_UNSET;
+    filter.m_iGenreSubType            = EPG_SEARCH_UNSET;
+    filter.m_iMinimumDuration         = EPG_SEARCH_UNSET;
+    filter.m_iMaximumDuration         = EPG_SEARCH_UNSET;
+    filter.m_startDateTime.SetFromUTCDateTime(m_start);
+    filter.m_endDateTime.SetFromUTCDateTime(m_end);
+    filter.m_bIncludeUnknownGenres    = false;
+    filter.m_bPreventRepeats          = false;
+    filter.m_iChannelNumber           = EPG_SEARCH_UNSET;
+    filter.m_bFTAOnly                 = false;
+    filter.m_iChannelGroup            = EPG_SEARCH_UNSET;
+    filter.m_bIgnorePresentTimers     = false;
+    filter.m_bIgnorePresentRecordings = false;
+    filter.m_iUniqueBroadcastId       = EPG_SEARCH_UNSET;
+    return filter;
+  }
+
+  int Search(const EpgSearchFilter &filter, CFileItemList &results) const
+  {
+    for (std::vector<CTestEpg*>::const_iterator it = m_tables.begin(); it != m_tables.end(); it++)
+      (*it)->Get(results, filter);
+    return results.Size();
+  }
+
+  int Scan(const EpgSearchFilter &filter, CFileItemList &results) const
+  {
+    for (std::vector<CTestEpg*>::const_iterator it = m_tables.begin(); it != m_tables.end(); it++)
+      (*it)->Scan(results, filter);
+    return results.Size();
+  }
+
+  /* the index finds exactly what looking at every tag finds */
+  void ExpectSameAsScan(const EpgSearchFilter &filter) const
+  {
+    CFileItemList searched, scanned;
+    Search(filter, searched);
+    Scan(filter, scanned);
+    ASSERT_EQ(scanned.Size(), searched.Size()) << "'" << filter.m_strSearchTerm << "'";
+    for (int i = 0; i < scanned.Size(); i++)
+      EXPECT_EQ(scanned[i]->GetEPGInfoTag()->UniqueBroadcastID(), searched[i]->GetEPGInfoTag()->UniqueBroadcastID());
+  }
+
+  CGuideRandom m_random;
+  std::vector<std::string> m_vocabulary;
+  std::vector<CTestEpg*> m_tables;
+  CDateTime m_start;
+  CDateTime m_end;
+};
+
+TEST(TestEpgSearchIndex, GetWords)
+{
+  std::vector<std::string> words;
+  CEpgSearchIndex::GetWords("The Late-Night NEWS, part 2: \xc3\x84rger!", words);
+  ASSERT_EQ(7U, words.size());
+  EXPECT_STREQ("the", words[0].c_str());
+  EXPECT_STREQ("late", words[1].c_str());
+  EXPECT_STREQ("night", words[2].c_str());
+  EXPECT_STREQ("news", words[3].c_str());
+  EXPECT_STREQ("part", words[4].c_str());
+  EXPECT_STREQ("2", words[5].c_str());
+  EXPECT_STREQ("\xc3\x84rger", words[6].c_str());
+}
+
+TEST_F(TestEpgSearch, SameAsScan)
+{
+  Fill(5, 500);
+
+  const char *terms[] = { "news", "NEWS", "ew", "sport news", "+news +sport", "news and late", "\"late news\"",
+                          "news !sport", "!news", "not", "-", "a", m_vocabulary[100].c_str(), m_vocabulary[1000].c_str() };
+  for (unsigned int i = 0; i < sizeof(terms) / sizeof(terms[0]); i++)
+    ExpectSameAsScan(Filter(terms[i]));
+
+  EpgSearchFilter filter = Filter("News");
+  filter.m_bIsCaseSensitive = true;
+  ExpectSameAsScan(filter);
+
+  filter = Filter("");
+  filter.m_iGenreType = EPG_EVENT_CONTENTMASK_SPORTS;
+  ExpectSameAsScan(filter);
+  filter.m_strSearchTerm = "news";
+  ExpectSameAsScan(filter);
+  filter.m_bIncludeUnknownGenres = true;
+  ExpectSameAsScan(filter);
+
+  filter = Filter("");
+  filter.m_startDateTime.SetFromUTCDateTime(m_start + CDateTimeSpan(1, 0, 0, 0));
+  filter.m_endDateTime.SetFromUTCDateTime(m_start + CDateTimeSpan(1, 6, 0, 0));
+  ExpectSameAsScan(filter);
+  filter.m_strSearchTerm = "late";
+  ExpectSameAsScan(filter);
+}
+
+TEST_F(TestEpgSearch, Updates)
+{
+  Fill(1, 100);
+  CTestEpg *epg = m_tables.front();
+  CFileItemList results;
+  ASSERT_EQ(0, Search(Filter("xyzzy"), results));
+
+  // a changed title is found by its new words only
+  CEpgInfoTagPtr tag = epg->GetTagAround(m_start + CDateTimeSpan(0, 2, 0, 0));
+  ASSERT_TRUE(tag);
+  CStdString strOldTitle = tag->Title();
+  CEpgInfoTag changed(*tag);
+  changed.SetTitle("Xyzzy");
+  epg->UpdateEntry(changed);
+  EXPECT_EQ(1, Search(Filter("xyzzy"), results));
+  ExpectSameAsScan(Filter(strOldTitle));
+
+  // as are tags that were added
+  CEpgInfoTag added;
+  added.SetUniqueBroadcastID(1000);
+  added.SetStartFromUTC(m_end);
+  added.SetEndFromUTC(m_end + CDateTimeSpan(0, 1, 0, 0));
+  added.SetTitle("Plugh and xyzzy");
+  epg->UpdateEntry(added);
+  m_end += CDateTimeSpan(0, 1, 0, 0);
+  results.Clear();
+  EXPECT_EQ(2, Search(Filter("xyzzy"), results));
+  results.Clear();
+  EXPECT_EQ(1, Search(Filter("plugh"), results));
+
+  // removed tags are gone
+  epg->Cleanup(m_start + CDateTimeSpan(0, 3, 0, 0));
+  results.Clear();
+  EXPECT_EQ(1, Search(Filter("xyzzy"), results));
+  ExpectSameAsScan(Filter("news"));
+
+  epg->Clear();
+  results.Clear();
+  EXPECT_EQ(0, Search(Filter("plugh"), results));
+}
+
+TEST_F(TestEpgSearch, Copy)
+{
+  Fill(1, 100);
+  CTestEpg copy(2);
+  copy = *m_tables.front();
+
+  // the copy has an index of its own tags
+  m_tables.front()->Clear();
+  CFileItemList searched, scanned;
+  copy.Get(searched, Filter("news"));
+  copy.Scan(scanned, Filter("news"));
+  EXPECT_GT(searched.Size(), 0);
+  EXPECT_EQ(scanned.Size(), searched.Size());
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestEpgSearch, DISABLED_BenchmarkLargeGuide)
+{
+  // 500 channels with two weeks of shows each
+  CStopWatch watch;
+  watch.StartZero();
+  Fill(500, 1000);
+  std::cout << "500000 tags indexed in " << watch.GetElapsedMilliseconds() << " ms" << std::endl;
+
+  std::vector<EpgSearchFilter> filters;
+  filters.push_back(Filter("news"));
+  filters.push_back(Filter(m_vocabulary[500]));
+  filters.push_back(Filter("+late +" + m_vocabulary[10]));
+  filters.push_back(Filter("\"late news\""));
+  filters.push_back(Filter(""));
+  filters.back().m_iGenreType = EPG_EVENT_CONTENTMASK_SPORTS;
+  filters.push_back(Filter(""));
+  filters.back().m_startDateTime.SetFromUTCDateTime(m_start + CDateTimeSpan(7, 0, 0, 0));
+  filters.back().m_endDateTime.SetFromUTCDateTime(m_start + CDateTimeSpan(7, 3, 0, 0));
+
+  for (std::vector<EpgSearchFilter>::const_iterator it = filters.begin(); it != filters.end(); it++)
+  {
+    CFileItemList searched, scanned;
+    watch.StartZero();
+    Search(*it, searched);
+    float searchTime = watch.GetElapsedMilliseconds();
+    watch.StartZero();
+    Scan(*it, scanned);
+    float scanTime = watch.GetElapsedMilliseconds();
+
+    EXPECT_EQ(scanned.Size(), searched.Size());
+    std::cout << "'" << it->m_strSearchTerm << "' genre " << it->m_iGenreType << ": " << searched.Size()
+              << " results, index " << searchTime << " ms, scan " << scanTime << " ms" << std::endl;
+  }
+}
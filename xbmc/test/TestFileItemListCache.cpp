@@ -0,0 +1,282 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "FileItemListCache.h"
+#include "filesystem/File.h"
+#include "threads/Thread.h"
+#include "utils/Archive.h"
+#include "utils/StringUtils.h"
+#include "utils/Stopwatch.h"
+#include "utils/Variant.h"
+#include "video/VideoInfoTag.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+static const char *CachePath = "special://temp/TestFileItemListCache.fi";
+
+static void FillList(CFileItemList &items, int count)
+{
+  items.SetPath("videodb://movies/titles/");
+  items.SetContent("movies");
+  items.SetProperty("total", count);
+  for (int i = 0; i < count; i++)
+  {
+    CFileItemPtr item(new CFileItem(StringUtils::Format("The Movie %d", i)));
+    item->SetPath(StringUtils::Format("videodb://movies/titles/%d", i));
+    item->m_dateTime.SetDateTime(2000 + i % 14, 1 + i % 12, 1 + i % 28, 12, 0, 0);
+    item->m_dwSize = i * 1024;
+    item->SetArt("thumb", StringUtils::Format("image://thumb%d.jpg/", i));
+    item->SetArt("fanart", "image://fanart.jpg/");
+    item->SetProperty("watchedepisodes", i % 10);
+    item->SetProperty("rating", i / 10.0);
+    item->SetProperty("hasnext", i % 2 == 0);
+    CVideoInfoTag *tag = item->GetVideoInfoTag();
+    tag->m_strTitle = item->GetLabel();
+    tag->m_strPlot = "A plot that is long enough to not be completely unrealistic for a movie.";
+    tag->m_strFileNameAndPath = StringUtils::Format("/movies/movie %d.mkv", i);
+    tag->m_iDbId = i;
+    tag->m_iYear = 1950 + i % 64;
+    tag->m_genre.push_back("Action");
+    tag->m_genre.push_back("Drama");
+    items.Add(item);
+  }
+}
+
+TEST(TestFileItemListCache, SaveAndLoad)
+{
+  CFileItemList items;
+  FillList(items, 10);
+  items.Get(3)->Select(true);
+  items.Get(4)->SetProperty("array", CVariant(CVariant::VariantTypeArray));
+  ASSERT_TRUE(CFileItemListCache::Save(items, CachePath));
+
+  CFileItemList loaded;
+  ASSERT_TRUE(CFileItemListCache::Load(loaded, CachePath));
+  EXPECT_STREQ("videodb://movies/titles/", loaded.GetPath().c_str());
+  EXPECT_STREQ("movies", loaded.GetContent().c_str());
+  EXPECT_EQ(10, loaded.GetProperty("total").asInteger());
+  ASSERT_EQ(10, loaded.Size());
+  for (int i = 0; i < loaded.Size(); i++)
+  {
+    CFileItemPtr item = items.Get(i);
+    CFileItemPtr copy = loaded.Get(i);
+    EXPECT_STREQ(item->GetLabel().c_str(), copy->GetLabel().c_str());
+    EXPECT_STREQ(item->GetPath().c_str(), copy->GetPath().c_str());
+    EXPECT_TRUE(item->GetSortLabel() == copy->GetSortLabel());
+    EXPECT_TRUE(item->m_dateTime == copy->m_dateTime);
+    EXPECT_EQ(item->m_dwSize, copy->m_dwSize);
+    EXPECT_EQ(item->IsSelected(), copy->IsSelected());
+    EXPECT_TRUE(item->GetArt() == copy->GetArt());
+    EXPECT_EQ(item->GetProperty("watchedepisodes").asInteger(), copy->GetProperty("watchedepisodes").asInteger());
+    EXPECT_EQ(item->GetProperty("rating").asDouble(), copy->GetProperty("rating").asDouble());
+    EXPECT_EQ(item->GetProperty("hasnext").asBoolean(), copy->GetProperty("hasnext").asBoolean());
+    EXPECT_FALSE(copy->HasMusicInfoTag());
+    ASSERT_TRUE(copy->HasVideoInfoTag());
+    const CFileItem &constCopy = *copy;
+    EXPECT_STREQ(item->GetVideoInfoTag()->m_strTitle.c_str(), constCopy.GetVideoInfoTag()->m_strTitle.c_str());
+    EXPECT_EQ(item->GetVideoInfoTag()->m_iDbId, constCopy.GetVideoInfoTag()->m_iDbId);
+    EXPECT_TRUE(item->GetVideoInfoTag()->m_genre == constCopy.GetVideoInfoTag()->m_genre);
+  }
+  EXPECT_TRUE(loaded.Get(4)->GetProperty("array").isArray());
+
+  EXPECT_TRUE(XFILE::CFile::Delete(CachePath));
+}
+
+TEST(TestFileItemListCache, SaveUndecodedTags)
+{
+  CFileItemList items;
+  FillList(items, 3);
+  ASSERT_TRUE(CFileItemListCache::Save(items, CachePath));
+
+  // the tags of the loaded items are still archived when they are saved again
+  CFileItemList loaded;
+  ASSERT_TRUE(CFileItemListCache::Load(loaded, CachePath));
+  CFileItem copy(*loaded.Get(1));
+  ASSERT_TRUE(CFileItemListCache::Save(loaded, CachePath));
+  EXPECT_STREQ("The Movie 1", copy.GetVideoInfoTag()->m_strTitle.c_str());
+
+  CFileItemList reloaded;
+  ASSERT_TRUE(CFileItemListCache::Load(reloaded, CachePath));
+  ASSERT_EQ(3, reloaded.Size());
+  EXPECT_STREQ("The Movie 2", reloaded.Get(2)->GetVideoInfoTag()->m_strTitle.c_str());
+  EXPECT_STREQ("The Movie 2", loaded.Get(2)->GetVideoInfoTag()->m_strTitle.c_str());
+
+  EXPECT_TRUE(XFILE::CFile::Delete(CachePath));
+}
+
+/* reads the tags of every item of a loaded list, the way the GUI and the thumb loaders do at once */
+class CTagReader : public IRunnable
+{
+public:
+  CTagReader(const CFileItemList &items) : m_items(items), m_found(0) {}
+
+  void Run()
+  {
+    for (int i = 0; i < m_items.Size(); i++)
+    {
+      const CFileItem &item = *m_items.Get(i);
+      if (item.HasVideoInfoTag() && item.GetVideoInfoTag() &&
+          item.GetVideoInfoTag()->m_iDbId == i && !item.HasMusicInfoTag())
+        m_found++;
+    }
+  }
+
+  const CFileItemList &m_items;
+  int m_found;
+};
+
+TEST(TestFileItemListCache, ConcurrentReaders)
+{
+  static const int count = 2000;
+  CFileItemList items;
+  FillList(items, count);
+  ASSERT_TRUE(CFileItemListCache::Save(items, CachePath));
+
+  CFileItemList loaded;
+  ASSERT_TRUE(CFileItemListCache::Load(loaded, CachePath));
+  std::vector<CTagReader*> readers;
+  std::vector<CThread*> threads;
+  for (int i = 0; i < 4; i++)
+  {
+    readers.push_back(new CTagReader(loaded));
+    threads.push_back(new CThread(readers.back(), "TagReader"));
+  }
+  for (std::vector<CThread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+    (*it)->Create();
+  for (unsigned int i = 0; i < threads.size(); i++)
+  {
+    EXPECT_TRUE(threads[i]->WaitForThreadExit(60000));
+    EXPECT_EQ(count, readers[i]->m_found);
+    delete threads[i];
+    delete readers[i];
+  }
+
+  EXPECT_TRUE(XFILE::CFile::Delete(CachePath));
+}
+
+TEST(TestFileItemListCache, KeepsParentFolder)
+{
+  CFileItemList items;
+  FillList(items, 2);
+  CFileItemPtr parent(new CFileItem(".."));
+  parent->SetPath("videodb://movies/");
+  parent->m_bIsFolder = true;
+  items.AddFront(parent, 0);
+  ASSERT_TRUE(CFileItemListCache::Save(items, CachePath));
+
+  CFileItemList loaded;
+  CFileItemPtr loadedParent(new CFileItem(".."));
+  loadedParent->SetPath("videodb://");
+  loadedParent->m_bIsFolder = true;
+  loaded.Add(loadedParent);
+  ASSERT_TRUE(CFileItemListCache::Load(loaded, CachePath));
+  ASSERT_EQ(3, loaded.Size());
+  EXPECT_STREQ("videodb://", loaded.Get(0)->GetPath().c_str());
+  EXPECT_STREQ("The Movie 0", loaded.Get(1)->GetLabel().c_str());
+
+  EXPECT_TRUE(XFILE::CFile::Delete(CachePath));
+}
+
+TEST(TestFileItemListCache, RejectsOtherVersions)
+{
+  CFileItemList items;
+  FillList(items, 2);
+  ASSERT_TRUE(CFileItemListCache::Save(items, CachePath));
+
+  XFILE::CFile file;
+  ASSERT_TRUE(file.OpenForWrite(CachePath, false));
+  unsigned int version = CFileItemListCache::Version + 1;
+  file.Seek(4, SEEK_SET);
+  file.Write(&version, sizeof(version));
+  file.Close();
+
+  CFileItemList loaded;
+  EXPECT_FALSE(CFileItemListCache::Load(loaded, CachePath));
+  EXPECT_FALSE(CFileItemListCache::Load(loaded, "special://temp/TestFileItemListCache-missing.fi"));
+
+  EXPECT_TRUE(XFILE::CFile::Delete(CachePath));
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestFileItemListCache, DISABLED_Benchmark)
+{
+  static const int counts[] = { 10000, 100000 };
+
+  for (unsigned int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+  {
+    CFileItemList items;
+    FillList(items, counts[i]);
+    CStopWatch watch;
+    float elapsed;
+
+    XFILE::CFile file;
+    watch.StartZero();
+    ASSERT_TRUE(file.OpenForWrite(CachePath, true));
+    {
+      CArchive ar(&file, CArchive::store);
+      ar << items;
+      ar.Close();
+    }
+    file.Close();
+    elapsed = watch.GetElapsedMilliseconds();
+    std::cout << "CArchive: saving " << counts[i] << " items: " << elapsed << " ms" << std::endl;
+
+    CFileItemList archived;
+    watch.StartZero();
+    ASSERT_TRUE(file.Open(CachePath));
+    {
+      CArchive ar(&file, CArchive::load);
+      ar >> archived;
+      ar.Close();
+    }
+    file.Close();
+    elapsed = watch.GetElapsedMilliseconds();
+    std::cout << "CArchive: loading " << counts[i] << " items: " << elapsed << " ms" << std::endl;
+    EXPECT_EQ(counts[i], archived.Size());
+
+    watch.StartZero();
+    ASSERT_TRUE(CFileItemListCache::Save(items, CachePath));
+    elapsed = watch.GetElapsedMilliseconds();
+    std::cout << "CFileItemListCache: saving " << counts[i] << " items: " << elapsed << " ms" << std::endl;
+
+    CFileItemList cached;
+    watch.StartZero();
+    ASSERT_TRUE(CFileItemListCache::Load(cached, CachePath));
+    elapsed = watch.GetElapsedMilliseconds();
+    std::cout << "CFileItemListCache: loading " << counts[i] << " items: " << elapsed << " ms" << std::endl;
+    EXPECT_EQ(counts[i], cached.Size());
+
+    // what a view touches when it opens: labels and art of every item, the info tag of one
+    watch.StartZero();
+    size_t touched = 0;
+    for (int j = 0; j < cached.Size(); j++)
+      touched += cached.Get(j)->GetLabel().size() + cached.Get(j)->GetArt("thumb").size();
+    touched += cached.Get(0)->GetVideoInfoTag()->m_strPlot.size();
+    elapsed = watch.GetElapsedMilliseconds();
+    std::cout << "CFileItemListCache: touching " << counts[i] << " items: " << elapsed << " ms" << std::endl;
+    EXPECT_LT(0u, touched);
+
+    EXPECT_TRUE(XFILE::CFile::Delete(CachePath));
+  }
+}
@@ -0,0 +1,125 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "GUIInfoManager.h"
+#include "filesystem/Directory.h"
+#include "interfaces/info/InfoBool.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/XBMCTinyXML.h"
+#include "test/TestUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+TEST(TestGUIInfoManager, Expressions)
+{
+  EXPECT_TRUE(g_infoManager.EvaluateBool("System.AlwaysTrue + !System.AlwaysFalse"));
+  EXPECT_FALSE(g_infoManager.EvaluateBool("!System.AlwaysTrue | System.AlwaysFalse + System.AlwaysTrue"));
+  EXPECT_TRUE(g_infoManager.EvaluateBool("System.AlwaysFalse + System.AlwaysTrue | System.AlwaysTrue"));
+  EXPECT_TRUE(g_infoManager.EvaluateBool("System.AlwaysTrue | System.AlwaysTrue + System.AlwaysFalse"));
+  EXPECT_TRUE(g_infoManager.EvaluateBool("![System.AlwaysFalse | System.AlwaysFalse] + [System.AlwaysTrue | System.AlwaysFalse]"));
+  EXPECT_FALSE(g_infoManager.EvaluateBool("![System.AlwaysTrue + [System.AlwaysFalse | System.AlwaysTrue]]"));
+  EXPECT_TRUE(g_infoManager.EvaluateBool("[[System.AlwaysTrue]]"));
+  EXPECT_TRUE(g_infoManager.EvaluateBool("!!System.AlwaysTrue"));
+
+  // malformed expressions evaluate to false
+  EXPECT_FALSE(g_infoManager.EvaluateBool("System.AlwaysTrue +"));
+  EXPECT_FALSE(g_infoManager.EvaluateBool("[System.AlwaysTrue | System.AlwaysFalse"));
+  EXPECT_FALSE(g_infoManager.EvaluateBool("System.AlwaysTrue ] + System.AlwaysTrue"));
+}
+
+TEST(TestGUIInfoManager, SharedSubExpressions)
+{
+  INFO::InfoPtr operand = g_infoManager.Register("System.AlwaysFalse | !System.AlwaysTrue");
+  long references = operand.use_count();
+
+  // both bracketed uses refer to the operand registered above
+  INFO::InfoPtr first = g_infoManager.Register("[System.AlwaysFalse | !System.AlwaysTrue] + System.AlwaysTrue");
+  INFO::InfoPtr second = g_infoManager.Register("System.AlwaysTrue | ![System.AlwaysFalse | !System.AlwaysTrue]");
+  EXPECT_EQ(references + 2, operand.use_count());
+  EXPECT_FALSE(first->Get());
+  EXPECT_TRUE(second->Get());
+}
+
+static void GetConditions(const TiXmlElement *element, std::vector<std::string> &conditions)
+{
+  for (; element; element = element->NextSiblingElement())
+  {
+    const char *condition = element->Attribute("condition");
+    if (condition)
+      conditions.push_back(condition);
+    if (element->ValueStr() == "visible" && element->FirstChild())
+      conditions.push_back(element->FirstChild()->ValueStr());
+    GetConditions(element->FirstChildElement(), conditions);
+  }
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestGUIInfoManager, DISABLED_BenchmarkSkinConditions)
+{
+  std::vector<std::string> conditions;
+  CFileItemList files;
+  ASSERT_TRUE(XFILE::CDirectory::GetDirectory(XBMC_REF_FILE_PATH("/addons/skin.confluence/720p/"), files, ".xml"));
+  for (int i = 0; i < files.Size(); i++)
+  {
+    CXBMCTinyXML doc;
+    if (doc.LoadFile(files.Get(i)->GetPath()))
+      GetConditions(doc.RootElement(), conditions);
+  }
+  ASSERT_FALSE(conditions.empty());
+
+  CStopWatch watch;
+  watch.StartZero();
+  std::vector<INFO::InfoPtr> bools;
+  for (std::vector<std::string>::const_iterator i = conditions.begin(); i != conditions.end(); ++i)
+  {
+    // these would access the databases, addons and the network
+    std::string lower(*i);
+    StringUtils::ToLower(lower);
+    if (lower.find("library.") != std::string::npos || lower.find("weather.") != std::string::npos ||
+        lower.find("pvr.") != std::string::npos || lower.find("system.hasaddon") != std::string::npos)
+      continue;
+    INFO::InfoPtr info = g_infoManager.Register(*i);
+    if (info)
+      bools.push_back(info);
+  }
+  float elapsed = watch.GetElapsedMilliseconds();
+  std::cout << "Registering " << bools.size() << " conditions: " << elapsed << " ms" << std::endl;
+
+  static const int frames = 1000;
+  unsigned int evaluations = 0;
+  unsigned int count = 0;
+  watch.StartZero();
+  for (int frame = 0; frame < frames; frame++)
+  {
+    g_infoManager.ResetCache();
+    for (std::vector<INFO::InfoPtr>::const_iterator i = bools.begin(); i != bools.end(); ++i)
+      count += (*i)->Get() ? 1 : 0;
+    g_infoManager.ResetChangedCache(true);
+    evaluations += g_infoManager.GetBoolEvaluations();
+  }
+  elapsed = watch.GetElapsedMilliseconds();
+  std::cout << "Evaluating " << bools.size() << " conditions (" << count / frames << " true): "
+            << elapsed * 1000 / frames << " us per frame, "
+            << evaluations / frames << " single conditions evaluated per frame" << std::endl;
+}
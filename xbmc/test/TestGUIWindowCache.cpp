@@ -0,0 +1,270 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "guilib/GUIIncludes.h"
+#include "guilib/GUIWindowCache.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+#include "utils/XBMCTinyXML.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <string>
+
+/* a skin folder in special://temp with an includes file and a window */
+class TestGUIWindowCache : public testing::Test
+{
+protected:
+  TestGUIWindowCache()
+  {
+    m_skin = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestGUIWindowCache/");
+    m_cache = URIUtils::AddFileToFolder(m_skin, "cache/");
+    m_includesFile = URIUtils::AddFileToFolder(m_skin, "includes.xml");
+    m_windowFile = URIUtils::AddFileToFolder(m_skin, "window.xml");
+    XFILE::CDirectory::Create(m_skin);
+  }
+
+  ~TestGUIWindowCache()
+  {
+    XFILE::CFile::Delete(m_includesFile);
+    XFILE::CFile::Delete(m_windowFile);
+    XFILE::CFile::Delete(CachedPath());
+    XFILE::CDirectory::Remove(m_cache);
+    XFILE::CDirectory::Remove(m_skin);
+  }
+
+  static void Write(const std::string &file, const std::string &xml)
+  {
+    XFILE::CFile out;
+    ASSERT_TRUE(out.OpenForWrite(file, true));
+    ASSERT_EQ((int)xml.size(), out.Write(xml.c_str(), xml.size()));
+    out.Close();
+  }
+
+  static int64_t Size(const std::string &file)
+  {
+    struct __stat64 info;
+    if (XFILE::CFile::Stat(file, &info) != 0)
+      return 0;
+    return info.st_size;
+  }
+
+  static std::string Print(const TiXmlElement *root)
+  {
+    TiXmlPrinter printer;
+    root->Accept(&printer);
+    return printer.CStr();
+  }
+
+  std::string CachedPath() const
+  {
+    CGUIWindowCache cache;
+    cache.SetFolder(m_cache);
+    return cache.GetCachedPath(m_windowFile);
+  }
+
+  /* resolves the window the way windows did before the cache */
+  std::string Resolve(CGUIIncludes &includes)
+  {
+    CXBMCTinyXML xmlDoc;
+    EXPECT_TRUE(xmlDoc.LoadFile(m_windowFile));
+    TiXmlElement *root = (TiXmlElement*)xmlDoc.RootElement()->Clone();
+    includes.ResolveIncludes(root);
+    std::string xml = Print(root);
+    delete root;
+    return xml;
+  }
+
+  /* includes of controls using more includes, constants and defaults, and a window of groups of them */
+  void Generate(unsigned int includes, unsigned int controls)
+  {
+    std::string xml = "<includes>\n";
+    xml += "<constant name=\"Width\">1280</constant>\n<constant name=\"Gap\">10</constant>\n";
+    xml += "<default type=\"label\"><font>font13</font><textcolor>grey2</textcolor><align>left</align></default>\n";
+    xml += "<default type=\"image\"><aspectratio>keep</aspectratio><fadetime>Gap</fadetime></default>\n";
+    xml += "<include name=\"Animation\"><animation effect=\"fade\" time=\"200\">WindowOpen</animation>"
+           "<animation effect=\"fade\" time=\"200\">WindowClose</animation></include>\n";
+    for (unsigned int i = 0; i < includes; i++)
+    {
+      xml += StringUtils::Format("<include name=\"Item%u\">"
+                                 "<control type=\"image\"><left>Gap</left><top>%u</top><width>Width</width><height>40</height><texture>item%u.png</texture></control>"
+                                 "<control type=\"label\"><left>Gap</left><top>%u</top><width>400</width><height>40</height><label>$INFO[ListItem.Label]</label><include>Animation</include></control>"
+                                 "</include>\n", i, i * 2, i, i * 2 + 1);
+    }
+    xml += "</includes>\n";
+    Write(m_includesFile, xml);
+
+    xml = "<window>\n<defaultcontrol always=\"true\">50</defaultcontrol>\n<include>Animation</include>\n<controls>\n";
+    for (unsigned int i = 0; i < controls; i++)
+    {
+      xml += StringUtils::Format("<control type=\"group\" id=\"%u\"><left>Gap</left>"
+                                 "<include>Item%u</include><include>Item%u</include>"
+                                 "<include condition=\"System.AlwaysFalse\">Item%u</include>"
+                                 "</control>\n", 100 + i, i % includes, (i * 7) % includes, (i * 3) % includes);
+    }
+    xml += "</controls>\n</window>\n";
+    Write(m_windowFile, xml);
+  }
+
+  std::string m_skin;
+  std::string m_cache;
+  std::string m_includesFile;
+  std::string m_windowFile;
+};
+
+TEST_F(TestGUIWindowCache, Resolved)
+{
+  Generate(5, 10);
+  CGUIIncludes includes;
+  ASSERT_TRUE(includes.LoadIncludes(m_includesFile));
+  std::string expected = Resolve(includes);
+
+  CGUIWindowCache cache;
+  std::map<INFO::InfoPtr, bool> conditions;
+  TiXmlElementPtr root = cache.GetWindow(m_windowFile, includes, conditions);
+  ASSERT_TRUE(root);
+  EXPECT_EQ(expected, Print(root.get()));
+  EXPECT_EQ(std::string::npos, expected.find("<include>"));
+  EXPECT_EQ(std::string::npos, expected.find(">Gap<"));
+  EXPECT_NE(std::string::npos, expected.find("<font>font13</font>"));
+
+  // the include with a condition that's false was dropped, and the condition noted
+  ASSERT_EQ(1U, conditions.size());
+  EXPECT_TRUE(StringUtils::EqualsNoCase(conditions.begin()->first->GetExpression(), "System.AlwaysFalse"));
+  EXPECT_FALSE(conditions.begin()->second);
+
+  // opening it again doesn't resolve it again
+  std::map<INFO::InfoPtr, bool> again;
+  EXPECT_TRUE(root == cache.GetWindow(m_windowFile, includes, again));
+  EXPECT_TRUE(again == conditions);
+
+  // files that don't exist aren't loaded
+  EXPECT_FALSE(cache.GetWindow(URIUtils::AddFileToFolder(m_skin, "missing.xml"), includes, again));
+}
+
+TEST_F(TestGUIWindowCache, Stored)
+{
+  Generate(5, 10);
+  std::string expected;
+  {
+    CGUIIncludes includes;
+    ASSERT_TRUE(includes.LoadIncludes(m_includesFile));
+    expected = Resolve(includes);
+
+    CGUIWindowCache cache;
+    cache.SetFolder(m_cache);
+    std::map<INFO::InfoPtr, bool> conditions;
+    ASSERT_TRUE(cache.GetWindow(m_windowFile, includes, conditions));
+    EXPECT_TRUE(XFILE::CFile::Exists(CachedPath()));
+  }
+
+  // a later run reads the stored tree
+  {
+    CGUIIncludes includes;
+    ASSERT_TRUE(includes.LoadIncludes(m_includesFile));
+    CGUIWindowCache cache;
+    cache.SetFolder(m_cache);
+    std::map<INFO::InfoPtr, bool> conditions;
+    TiXmlElementPtr root = cache.GetWindow(m_windowFile, includes, conditions);
+    ASSERT_TRUE(root);
+    EXPECT_EQ(expected, Print(root.get()));
+    EXPECT_EQ(1U, conditions.size());
+  }
+
+  // and resolves it again once an include file changed
+  Generate(6, 10);
+  {
+    CGUIIncludes includes;
+    ASSERT_TRUE(includes.LoadIncludes(m_includesFile));
+    expected = Resolve(includes);
+    CGUIWindowCache cache;
+    cache.SetFolder(m_cache);
+    std::map<INFO::InfoPtr, bool> conditions;
+    TiXmlElementPtr root = cache.GetWindow(m_windowFile, includes, conditions);
+    ASSERT_TRUE(root);
+    EXPECT_EQ(expected, Print(root.get()));
+  }
+
+  // a broken cache file is ignored
+  Write(CachedPath(), "XBWC");
+  {
+    CGUIIncludes includes;
+    ASSERT_TRUE(includes.LoadIncludes(m_includesFile));
+    CGUIWindowCache cache;
+    cache.SetFolder(m_cache);
+    std::map<INFO::InfoPtr, bool> conditions;
+    TiXmlElementPtr root = cache.GetWindow(m_windowFile, includes, conditions);
+    ASSERT_TRUE(root);
+    EXPECT_EQ(expected, Print(root.get()));
+  }
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestGUIWindowCache, DISABLED_BenchmarkLargeSkin)
+{
+  // about the size of the home window of a large skin
+  const unsigned int opens = 20;
+  Generate(300, 400);
+  CGUIIncludes includes;
+  ASSERT_TRUE(includes.LoadIncludes(m_includesFile));
+
+  // before: the first open parsed and resolved the file, later ones resolved a copy of the parsed tree
+  CStopWatch watch;
+  watch.StartZero();
+  CXBMCTinyXML xmlDoc;
+  ASSERT_TRUE(xmlDoc.LoadFile(m_windowFile));
+  float parseTime = watch.GetElapsedMilliseconds();
+  watch.StartZero();
+  for (unsigned int i = 0; i < opens; i++)
+  {
+    TiXmlElement *root = (TiXmlElement*)xmlDoc.RootElement()->Clone();
+    includes.ResolveIncludes(root);
+    delete root;
+  }
+  float resolveTime = watch.GetElapsedMilliseconds() / opens;
+
+  // after: the first open of a run reads the stored tree, later ones use it as it is
+  {
+    CGUIWindowCache cache;
+    cache.SetFolder(m_cache);
+    std::map<INFO::InfoPtr, bool> conditions;
+    ASSERT_TRUE(cache.GetWindow(m_windowFile, includes, conditions));
+  }
+  CGUIWindowCache cache;
+  cache.SetFolder(m_cache);
+  std::map<INFO::InfoPtr, bool> conditions;
+  watch.StartZero();
+  ASSERT_TRUE(cache.GetWindow(m_windowFile, includes, conditions));
+  float storedTime = watch.GetElapsedMilliseconds();
+  watch.StartZero();
+  for (unsigned int i = 0; i < opens; i++)
+    cache.GetWindow(m_windowFile, includes, conditions);
+  float memoryTime = watch.GetElapsedMilliseconds() / opens;
+
+  std::cout << "window of " << Size(m_windowFile) << " bytes, " << Print(cache.GetWindow(m_windowFile, includes, conditions).get()).size()
+            << " bytes once resolved, stored in " << Size(CachedPath()) << " bytes" << std::endl;
+  std::cout << "before: first open " << parseTime + resolveTime << " ms, later opens " << resolveTime << " ms" << std::endl;
+  std::cout << "after: first open " << storedTime << " ms, later opens " << memoryTime << " ms" << std::endl;
+}
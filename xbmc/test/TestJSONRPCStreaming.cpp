@@ -0,0 +1,253 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "interfaces/json-rpc/FileItemHandler.h"
+#include "interfaces/json-rpc/JSONRPC.h"
+#include "media/MediaType.h"
+#include "music/tags/MusicInfoTag.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/JSONStreamWriter.h"
+#include "utils/JSONVariantParser.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <sys/resource.h>
+
+#include <iostream>
+
+using namespace JSONRPC;
+
+static const char *SongsRequest =
+  "{\"jsonrpc\": \"2.0\", \"method\": \"XBMCTest.GetSongs\", \"id\": 1, \"params\": "
+  "{ \"properties\": [ \"title\", \"artist\", \"album\", \"genre\", \"track\", \"duration\", \"year\", \"file\" ] }}";
+
+/* a library method listing the songs set up by the tests */
+class CTestSongs : public CFileItemHandler
+{
+public:
+  static JSONRPC_STATUS GetSongs(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
+  {
+    HandleFileItemList("songid", true, "songs", Songs, parameterObject, result);
+    return OK;
+  }
+
+  /* fails once the songs went out */
+  static JSONRPC_STATUS GetSongsFailing(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
+  {
+    HandleFileItemList("songid", true, "songs", Songs, parameterObject, result);
+    return FailedToExecute;
+  }
+
+  static void Fill(int count)
+  {
+    Songs.Clear();
+    for (int i = 0; i < count; i++)
+    {
+      CFileItemPtr item(new CFileItem(StringUtils::Format("Song %d", i)));
+      item->SetPath(StringUtils::Format("/music/Artist %d/Album %d/%02d - Song %d.mp3", i / 120, i / 12, i % 12 + 1, i));
+      MUSIC_INFO::CMusicInfoTag *tag = item->GetMusicInfoTag();
+      tag->SetURL(item->GetPath());
+      tag->SetTitle(item->GetLabel());
+      tag->SetArtist(StringUtils::Format("Artist %d", i / 120));
+      tag->SetAlbum(StringUtils::Format("Album %d", i / 12));
+      tag->SetGenre("Rock");
+      tag->SetTrackNumber(i % 12 + 1);
+      tag->SetDuration(180 + i % 120);
+      tag->SetYear(1970 + i % 40);
+      tag->SetDatabaseId(i + 1, MediaTypeSong);
+      tag->SetLoaded(true);
+      Songs.Add(item);
+    }
+  }
+
+  static CFileItemList Songs;
+};
+
+CFileItemList CTestSongs::Songs;
+
+class CTestTransport : public ITransportLayer
+{
+public:
+  virtual bool PrepareDownload(const char *path, CVariant &details, std::string &protocol) { return false; }
+  virtual bool Download(const char *path, CVariant &result) { return false; }
+  virtual int GetCapabilities() { return Response; }
+};
+
+class CTestClient : public IClient
+{
+public:
+  virtual int GetPermissionFlags() { return OPERATION_PERMISSION_ALL; }
+  virtual int GetAnnouncementFlags() { return 0; }
+  virtual bool SetAnnouncementFlags(int flags) { return false; }
+};
+
+/* a socket taking everything, noting when the first byte arrived */
+class CTestOutput : public IJSONStreamOutput
+{
+public:
+  CTestOutput(bool keep) : m_keep(keep), m_firstByte(-1.0f), m_size(0) { m_watch.StartZero(); }
+
+  virtual bool Write(const char *data, size_t size)
+  {
+    if (m_firstByte < 0.0f)
+      m_firstByte = m_watch.GetElapsedMilliseconds();
+    if (m_keep)
+      m_data.append(data, size);
+    m_size += size;
+    return true;
+  }
+
+  bool m_keep;
+  CStopWatch m_watch;
+  float m_firstByte;
+  size_t m_size;
+  std::string m_data;
+};
+
+static long PeakRSS()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+class TestJSONRPCStreaming : public testing::Test
+{
+protected:
+  TestJSONRPCStreaming()
+  {
+    static bool registered = false;
+    CJSONRPC::Initialize();
+    if (!registered)
+    {
+      registered = CJSONServiceDescription::AddMethod(
+        "\"XBMCTest.GetSongs\": { \"type\": \"method\", \"description\": \"Songs of the tests\", "
+        "\"transport\": \"Response\", \"permission\": \"ReadData\", \"params\": [ "
+        "{ \"name\": \"properties\", \"type\": \"array\", \"items\": { \"type\": \"string\" } } ], "
+        "\"returns\": \"object\" }", CTestSongs::GetSongs) && CJSONServiceDescription::AddMethod(
+        "\"XBMCTest.GetSongsFailing\": { \"type\": \"method\", \"description\": \"Songs of the tests, then fails\", "
+        "\"transport\": \"Response\", \"permission\": \"ReadData\", \"params\": [ "
+        "{ \"name\": \"properties\", \"type\": \"array\", \"items\": { \"type\": \"string\" } } ], "
+        "\"returns\": \"object\" }", CTestSongs::GetSongsFailing);
+    }
+  }
+
+  ~TestJSONRPCStreaming()
+  {
+    CTestSongs::Songs.Clear();
+  }
+
+  CTestTransport m_transport;
+  CTestClient m_client;
+};
+
+TEST_F(TestJSONRPCStreaming, SameResult)
+{
+  CTestSongs::Fill(100);
+
+  CTestOutput output(true);
+  EXPECT_TRUE(CJSONRPC::MethodCall(SongsRequest, &m_transport, &m_client, &output));
+
+  CVariant streamed = CJSONVariantParser::Parse((const unsigned char *)output.m_data.c_str(), output.m_data.size());
+  ASSERT_TRUE(streamed.isObject()) << output.m_data;
+  EXPECT_EQ(1, streamed["id"].asInteger());
+  EXPECT_STREQ("2.0", streamed["jsonrpc"].asString().c_str());
+
+  // the items are the same as when they're put in the result
+  CVariant parameters = CJSONVariantParser::Parse((const unsigned char *)SongsRequest, strlen(SongsRequest))["params"];
+  CVariant result;
+  CTestSongs::GetSongs("xbmctest.getsongs", &m_transport, &m_client, parameters, result);
+  ASSERT_EQ(100U, result["songs"].size());
+  EXPECT_EQ(CJSONVariantWriter::Write(result, true), CJSONVariantWriter::Write(streamed["result"], true));
+  EXPECT_EQ(100, streamed["result"]["limits"]["total"].asInteger());
+}
+
+TEST_F(TestJSONRPCStreaming, FailedAfterStart)
+{
+  CTestSongs::Fill(10);
+
+  // the songs are out when the method fails, the response ends with the error
+  std::string request = "{\"jsonrpc\": \"2.0\", \"method\": \"XBMCTest.GetSongsFailing\", \"id\": 1}";
+  CTestOutput output(true);
+  EXPECT_TRUE(CJSONRPC::MethodCall(request, &m_transport, &m_client, &output));
+
+  CVariant streamed = CJSONVariantParser::Parse((const unsigned char *)output.m_data.c_str(), output.m_data.size());
+  ASSERT_TRUE(streamed.isObject()) << output.m_data;
+  EXPECT_EQ(10U, streamed["result"]["songs"].size());
+  EXPECT_FALSE(streamed["result"].isMember("limits"));
+  ASSERT_TRUE(streamed.isMember("error")) << output.m_data;
+  EXPECT_EQ(FailedToExecute, streamed["error"]["code"].asInteger());
+}
+
+TEST_F(TestJSONRPCStreaming, Batch)
+{
+  CTestSongs::Fill(10);
+
+  // the streamed response is an element of the batch like any other
+  std::string request = "[" + std::string(SongsRequest) + ", {\"jsonrpc\": \"2.0\", \"method\": \"JSONRPC.Ping\", \"id\": 2}, "
+                        "{\"jsonrpc\": \"2.0\", \"method\": \"JSONRPC.Ping\"}]";
+  std::string response = CJSONRPC::MethodCall(request, &m_transport, &m_client);
+  CVariant responses = CJSONVariantParser::Parse((const unsigned char *)response.c_str(), response.size());
+  ASSERT_TRUE(responses.isArray()) << response;
+  ASSERT_EQ(2U, responses.size());
+  EXPECT_EQ(10U, responses[0]["result"]["songs"].size());
+  EXPECT_STREQ("pong", responses[1]["result"].asString().c_str());
+
+  // nor is there anything to stream for notifications
+  request = "[{\"jsonrpc\": \"2.0\", \"method\": \"XBMCTest.GetSongs\"}]";
+  EXPECT_TRUE(CJSONRPC::MethodCall(request, &m_transport, &m_client).empty());
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestJSONRPCStreaming, DISABLED_BenchmarkLargeList)
+{
+  static const int songs = 20000;
+  CTestSongs::Fill(songs);
+  long baseline = PeakRSS();
+
+  CTestOutput streamed(false);
+  EXPECT_TRUE(CJSONRPC::MethodCall(SongsRequest, &m_transport, &m_client, &streamed));
+  float streamedTotal = streamed.m_watch.GetElapsedMilliseconds();
+  long streamedPeak = PeakRSS();
+
+  // the way responses were made before, the whole list in the result then in a string
+  CStopWatch watch;
+  watch.StartZero();
+  CVariant parameters = CJSONVariantParser::Parse((const unsigned char *)SongsRequest, strlen(SongsRequest))["params"];
+  CVariant response;
+  response["id"] = 1;
+  response["jsonrpc"] = "2.0";
+  CTestSongs::GetSongs("xbmctest.getsongs", &m_transport, &m_client, parameters, response["result"]);
+  std::string built = CJSONVariantWriter::Write(response, g_advancedSettings.m_jsonOutputCompact);
+  float builtTotal = watch.GetElapsedMilliseconds();
+  long builtPeak = PeakRSS();
+
+  EXPECT_EQ((size_t)songs, response["result"]["songs"].size());
+  EXPECT_GT(streamed.m_size, built.size() / 2);
+
+  std::cout << songs << " songs, " << built.size() / 1024 << " KiB" << std::endl;
+  std::cout << "streamed: first byte after " << streamed.m_firstByte << " ms, done after " << streamedTotal
+            << " ms, peak RSS +" << streamedPeak - baseline << " KiB" << std::endl;
+  std::cout << "built:    first byte after " << builtTotal << " ms, done after " << builtTotal
+            << " ms, peak RSS +" << builtPeak - baseline << " KiB" << std::endl;
+}
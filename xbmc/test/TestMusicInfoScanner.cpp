@@ -0,0 +1,191 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "music/infoscanner/MusicTagReader.h"
+#include "music/tags/MusicInfoTag.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace MUSIC_INFO;
+
+/* an ID3v2.3 text frame, latin-1 encoded */
+static void AppendTextFrame(std::string &tag, const char *id, const std::string &text)
+{
+  unsigned int size = text.size() + 1;
+  tag.append(id, 4);
+  tag.push_back((char)(size >> 24));
+  tag.push_back((char)(size >> 16));
+  tag.push_back((char)(size >> 8));
+  tag.push_back((char)size);
+  tag.append(2, '\0');
+  tag.push_back('\0');
+  tag.append(text);
+}
+
+/* an mp3 with an ID3v2.3 tag and a few silent MPEG-1 layer III frames */
+static std::string TaggedMP3(const std::string &title, const std::string &artist, const std::string &album, int track)
+{
+  std::string frames;
+  AppendTextFrame(frames, "TIT2", title);
+  AppendTextFrame(frames, "TPE1", artist);
+  AppendTextFrame(frames, "TALB", album);
+  AppendTextFrame(frames, "TRCK", StringUtils::Format("%d", track));
+  AppendTextFrame(frames, "TYER", "2013");
+  AppendTextFrame(frames, "TCON", "Rock");
+
+  std::string file("ID3\x03\x00\x00", 6);
+  unsigned int size = frames.size();
+  file.push_back((char)((size >> 21) & 0x7F));
+  file.push_back((char)((size >> 14) & 0x7F));
+  file.push_back((char)((size >> 7) & 0x7F));
+  file.push_back((char)(size & 0x7F));
+  file.append(frames);
+
+  // 128 kbit/s at 44.1 kHz, 417 bytes a frame
+  for (int i = 0; i < 10; i++)
+  {
+    file.append("\xFF\xFB\x90\x64", 4);
+    file.append(417 - 4, '\0');
+  }
+  return file;
+}
+
+/* album folders of tagged mp3s in special://temp */
+class CSyntheticMusicTree
+{
+public:
+  CSyntheticMusicTree(int albums, int songs)
+  {
+    m_root = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestMusicScan/");
+    XFILE::CDirectory::Create(m_root);
+    for (int i = 0; i < albums; i++)
+    {
+      CStdString folder = URIUtils::AddFileToFolder(m_root, StringUtils::Format("Album %d/", i));
+      XFILE::CDirectory::Create(folder);
+      m_folders.push_back(folder);
+      for (int j = 0; j < songs; j++)
+      {
+        CStdString title = StringUtils::Format("Song %d of album %d", j + 1, i);
+        CStdString file = URIUtils::AddFileToFolder(folder, StringUtils::Format("%02d - %s.mp3", j + 1, title.c_str()));
+        std::string data = TaggedMP3(title, StringUtils::Format("Artist %d", i % 7), StringUtils::Format("Album %d", i), j + 1);
+        XFILE::CFile out;
+        if (out.OpenForWrite(file, true))
+        {
+          out.Write(data.c_str(), data.size());
+          out.Close();
+        }
+        m_files.push_back(file);
+        m_titles.push_back(title);
+      }
+    }
+  }
+
+  ~CSyntheticMusicTree()
+  {
+    for (std::vector<CStdString>::const_iterator it = m_files.begin(); it != m_files.end(); ++it)
+      XFILE::CFile::Delete(*it);
+    for (std::vector<CStdString>::const_iterator it = m_folders.begin(); it != m_folders.end(); ++it)
+      XFILE::CDirectory::Remove(*it);
+    XFILE::CDirectory::Remove(m_root);
+  }
+
+  CStdString m_root;
+  std::vector<CStdString> m_folders;
+  std::vector<CStdString> m_files;
+  std::vector<CStdString> m_titles;
+};
+
+TEST(TestMusicInfoScanner, TagReader)
+{
+  CSyntheticMusicTree tree(2, 3);
+
+  CFileItem item(tree.m_files[4], false);
+  EXPECT_TRUE(CMusicTagReader::Read(item));
+  EXPECT_STREQ(tree.m_titles[4].c_str(), item.GetMusicInfoTag()->GetTitle().c_str());
+  EXPECT_EQ(2, item.GetMusicInfoTag()->GetTrackNumber());
+
+  // read ahead tags are the same as the ones read in place
+  CMusicTagReader reader(4);
+  std::vector<CFileItemPtr> items;
+  for (size_t i = 0; i < tree.m_files.size(); i++)
+  {
+    items.push_back(CFileItemPtr(new CFileItem(tree.m_files[i], false)));
+    reader.Prefetch(items.back());
+  }
+  for (size_t i = 0; i < items.size(); i++)
+  {
+    EXPECT_TRUE(reader.Load(items[i]));
+    EXPECT_STREQ(tree.m_titles[i].c_str(), items[i]->GetMusicInfoTag()->GetTitle().c_str());
+  }
+
+  // files without a tag aren't loaded, whoever reads them
+  CFileItemPtr missing(new CFileItem(URIUtils::AddFileToFolder(tree.m_root, "missing.mp3"), false));
+  reader.Prefetch(missing);
+  EXPECT_FALSE(reader.Load(missing));
+  reader.Clear();
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestMusicInfoScanner, DISABLED_BenchmarkTagReader)
+{
+  static const int albums = 100;
+  static const int songs = 12;
+  CSyntheticMusicTree tree(albums, songs);
+
+  std::vector<CStdString> titles[2];
+  for (int threaded = 0; threaded < 2; threaded++)
+  {
+    unsigned int threads = threaded ? 4 : 1;
+    CMusicTagReader reader(threads);
+    CStopWatch watch;
+    watch.StartZero();
+    for (int i = 0; i < albums; i++)
+    {
+      // the scanner reads a folder at a time, naming all of its files first
+      std::vector<CFileItemPtr> items;
+      for (int j = 0; j < songs; j++)
+      {
+        items.push_back(CFileItemPtr(new CFileItem(tree.m_files[i * songs + j], false)));
+        reader.Prefetch(items.back());
+      }
+      for (size_t j = 0; j < items.size(); j++)
+      {
+        reader.Load(items[j]);
+        titles[threaded].push_back(items[j]->GetMusicInfoTag()->GetTitle());
+      }
+    }
+    float elapsed = watch.GetElapsedSeconds();
+    std::cout << threads << " threads: " << tree.m_files.size() << " files read in " << elapsed * 1000 << " ms, "
+              << (elapsed > 0 ? tree.m_files.size() / elapsed : 0) << " files/s" << std::endl;
+  }
+  EXPECT_TRUE(titles[0] == titles[1]);
+  EXPECT_TRUE(titles[1] == tree.m_titles);
+}
@@ -0,0 +1,233 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "settings/SettingHandle.h"
+#include "settings/lib/Setting.h"
+#include "settings/lib/SettingSection.h"
+#include "settings/lib/SettingsManager.h"
+#include "threads/Atomics.h"
+#include "threads/Thread.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#define TEST_READS_PER_THREAD 1000000
+
+/* a settings manager of its own with a setting of every type */
+class TestSettingHandle : public testing::Test
+{
+protected:
+  TestSettingHandle()
+  {
+    Add();
+  }
+
+  void Add()
+  {
+    CSettingGroup *group = new CSettingGroup("1", &m_settingsManager);
+    group->AddSetting(new CSettingBool("test.bool", 0, true, &m_settingsManager));
+    group->AddSetting(new CSettingInt("test.int", 0, 42, &m_settingsManager));
+    CSettingString *string = new CSettingString("test.string", 0, "foo", &m_settingsManager);
+    string->SetAllowEmpty(true);
+    group->AddSetting(string);
+    CSettingCategory *category = new CSettingCategory("test", &m_settingsManager);
+    category->AddGroup(group);
+    CSettingSection *section = new CSettingSection("test", &m_settingsManager);
+    section->AddCategory(category);
+    m_settingsManager.AddSection(section);
+  }
+
+  CSettingsManager m_settingsManager;
+};
+
+/* reads a bool setting in a loop, by identifier or through a handle */
+class CTestSettingReader : public IRunnable
+{
+public:
+  CTestSettingReader(CSettingsManager &settingsManager, const CSettingBoolHandle *handle, volatile long *start)
+    : m_settingsManager(settingsManager), m_handle(handle), m_start(start), m_trues(0), m_elapsed(0)
+  { }
+
+  virtual void Run()
+  {
+    while (AtomicLoadAcquire(m_start) == 0)
+      XbmcThreads::ThreadSleep(0);
+
+    CStopWatch watch;
+    watch.StartZero();
+    for (unsigned int i = 0; i < TEST_READS_PER_THREAD; i++)
+    {
+      if (m_handle ? m_handle->Get() : m_settingsManager.GetBool("test.bool"))
+        m_trues++;
+    }
+    m_elapsed = watch.GetElapsedSeconds();
+  }
+
+  CSettingsManager         &m_settingsManager;
+  const CSettingBoolHandle *m_handle;
+  volatile long            *m_start;
+  unsigned int              m_trues;
+  float                     m_elapsed;
+};
+
+/* runs readers while the setting keeps changing, returning nanoseconds per read */
+static float RunReaders(CSettingsManager &settingsManager, const CSettingBoolHandle *handle, unsigned int readers)
+{
+  volatile long start = 0;
+  std::vector<CTestSettingReader*> runnables;
+  std::vector<CThread*> threads;
+  for (unsigned int i = 0; i < readers; i++)
+  {
+    runnables.push_back(new CTestSettingReader(settingsManager, handle, &start));
+    threads.push_back(new CThread(runnables.back(), "TestSettingReader"));
+    threads.back()->Create();
+  }
+
+  AtomicStoreRelease(&start, 1);
+
+  // keep writing until every reader is done
+  bool value = false;
+  for (unsigned int i = 0; i < readers; i++)
+  {
+    while (!threads[i]->WaitForThreadExit(1))
+    {
+      settingsManager.SetBool("test.bool", value);
+      value = !value;
+    }
+  }
+
+  float elapsed = 0;
+  for (unsigned int i = 0; i < readers; i++)
+  {
+    elapsed += runnables[i]->m_elapsed;
+    delete threads[i];
+    delete runnables[i];
+  }
+  return elapsed * 1000000000.0f / ((float)readers * TEST_READS_PER_THREAD);
+}
+
+TEST_F(TestSettingHandle, Get)
+{
+  CSettingBoolHandle boolHandle("test.bool", &m_settingsManager);
+  CSettingIntHandle intHandle("test.int", &m_settingsManager);
+  CSettingStringHandle stringHandle("test.string", &m_settingsManager);
+
+  EXPECT_TRUE(boolHandle.Get());
+  EXPECT_EQ(42, intHandle.Get());
+  EXPECT_EQ("foo", stringHandle.Get());
+  EXPECT_FALSE(stringHandle.IsEmpty());
+  EXPECT_TRUE(boolHandle.GetSetting() == m_settingsManager.GetSetting("test.bool"));
+
+  // changes made by identifier are seen through the handle and the other way around
+  EXPECT_TRUE(m_settingsManager.SetBool("test.bool", false));
+  EXPECT_FALSE(boolHandle.Get());
+  EXPECT_TRUE(intHandle.Set(7));
+  EXPECT_EQ(7, m_settingsManager.GetInt("test.int"));
+  EXPECT_TRUE(m_settingsManager.SetString("test.string", "bar"));
+  EXPECT_EQ("bar", stringHandle.Get());
+  EXPECT_EQ("bar", m_settingsManager.GetString("test.string"));
+  EXPECT_TRUE(stringHandle.Set(""));
+  EXPECT_TRUE(stringHandle.IsEmpty());
+}
+
+TEST_F(TestSettingHandle, Unresolved)
+{
+  // missing settings and settings of another type read as the default of the type
+  CSettingBoolHandle missing("test.missing", &m_settingsManager);
+  CSettingIntHandle mistyped("test.bool", &m_settingsManager);
+  EXPECT_FALSE(missing.Get());
+  EXPECT_FALSE(missing.Set(true));
+  EXPECT_TRUE(missing.GetSetting() == NULL);
+  EXPECT_EQ(0, mistyped.Get());
+  EXPECT_TRUE(mistyped.GetSetting() == NULL);
+}
+
+TEST_F(TestSettingHandle, Clear)
+{
+  CSettingIntHandle handle("test.int", &m_settingsManager);
+  EXPECT_TRUE(handle.Set(7));
+  EXPECT_EQ(7, handle.Get());
+
+  // handles resolve the setting again once the settings were cleared
+  m_settingsManager.Clear();
+  EXPECT_EQ(0, handle.Get());
+  Add();
+  EXPECT_EQ(42, handle.Get());
+  EXPECT_TRUE(handle.GetSetting() == m_settingsManager.GetSetting("test.int"));
+}
+
+/* rejects test.int being changed to 13, recording the values it was asked about */
+class CTestSettingRejecter : public ISettingCallback
+{
+public:
+  CTestSettingRejecter(const CSettingIntHandle &handle) : m_handle(handle) { }
+
+  virtual bool OnSettingChanging(const CSetting *setting)
+  {
+    m_asked.push_back(m_handle.Get());
+    return m_asked.back() != 13;
+  }
+
+  const CSettingIntHandle &m_handle;
+  std::vector<int>         m_asked;
+};
+
+TEST_F(TestSettingHandle, RejectedChange)
+{
+  CSettingIntHandle handle("test.int", &m_settingsManager);
+  CTestSettingRejecter rejecter(handle);
+  std::set<std::string> settings;
+  settings.insert("test.int");
+  m_settingsManager.RegisterCallback(&rejecter, settings);
+  m_settingsManager.SetLoaded();
+
+  // the callbacks see the value they validate, it's never published
+  EXPECT_FALSE(handle.Set(13));
+  ASSERT_EQ(2U, rejecter.m_asked.size());
+  EXPECT_EQ(13, rejecter.m_asked[0]);
+  EXPECT_EQ(42, rejecter.m_asked[1]);
+  EXPECT_EQ(42, handle.Get());
+
+  EXPECT_TRUE(handle.Set(7));
+  EXPECT_EQ(7, rejecter.m_asked.back());
+  EXPECT_EQ(7, handle.Get());
+
+  m_settingsManager.UnregisterCallback(&rejecter);
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestSettingHandle, DISABLED_BenchmarkConcurrentReaders)
+{
+  CSettingBoolHandle handle("test.bool", &m_settingsManager);
+
+  unsigned int readers[] = { 1, 2, 4, 8 };
+  for (unsigned int i = 0; i < sizeof(readers) / sizeof(readers[0]); i++)
+  {
+    float byId = RunReaders(m_settingsManager, NULL, readers[i]);
+    float byHandle = RunReaders(m_settingsManager, &handle, readers[i]);
+    std::cout << readers[i] << " reader(s): " << byId << " ns per read by identifier, "
+              << byHandle << " ns per read through a handle" << std::endl;
+  }
+}
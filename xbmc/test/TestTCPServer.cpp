@@ -0,0 +1,252 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "system.h"
+#include "interfaces/json-rpc/JSONRPC.h"
+#include "network/TCPServer.h"
+#include "threads/Thread.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace JSONRPC;
+
+static const int TestPort = 19090;
+
+/* a server that stops answering fails the test rather than hanging it */
+static SOCKET WithTimeout(SOCKET sock)
+{
+  struct timeval timeout = {};
+  timeout.tv_sec = 10;
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+  return sock;
+}
+
+/* the server binds the loopback address of ipv6 if it can, of ipv4 otherwise */
+static SOCKET ConnectToServer()
+{
+  struct sockaddr_in6 addr6 = {};
+  addr6.sin6_family = AF_INET6;
+  addr6.sin6_port = htons(TestPort);
+  addr6.sin6_addr = in6addr_loopback;
+  SOCKET sock = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+  if (sock != INVALID_SOCKET && connect(sock, (struct sockaddr*)&addr6, sizeof(addr6)) == 0)
+    return WithTimeout(sock);
+  if (sock != INVALID_SOCKET)
+    closesocket(sock);
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(TestPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock != INVALID_SOCKET && connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+    return WithTimeout(sock);
+  if (sock != INVALID_SOCKET)
+    closesocket(sock);
+  return INVALID_SOCKET;
+}
+
+static bool SendAll(SOCKET sock, const std::string &data)
+{
+  for (size_t sent = 0; sent < data.size(); )
+  {
+    int res = send(sock, data.c_str() + sent, data.size() - sent, 0);
+    if (res <= 0)
+      return false;
+    sent += res;
+  }
+  return true;
+}
+
+/* reads one JSON object, the responses don't contain braces in strings */
+static bool ReadObject(SOCKET sock, std::string &pending, std::string &object)
+{
+  while (true)
+  {
+    int depth = 0;
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+      if (pending[i] == '{')
+        depth++;
+      else if (pending[i] == '}' && --depth == 0)
+      {
+        object = pending.substr(0, i + 1);
+        pending.erase(0, i + 1);
+        return true;
+      }
+    }
+
+    char buffer[4096];
+    int res = recv(sock, buffer, sizeof(buffer), 0);
+    if (res <= 0)
+      return false;
+    pending.append(buffer, res);
+  }
+}
+
+static std::string Ping(int id)
+{
+  return StringUtils::Format("{\"jsonrpc\": \"2.0\", \"method\": \"JSONRPC.Ping\", \"id\": %d}", id);
+}
+
+class TestTCPServer : public testing::Test
+{
+protected:
+  TestTCPServer()
+  {
+    CJSONRPC::Initialize();
+    m_started = CTCPServer::StartServer(TestPort, false);
+  }
+
+  ~TestTCPServer()
+  {
+    CTCPServer::StopServer(true);
+  }
+
+  bool m_started;
+};
+
+TEST_F(TestTCPServer, Pipelined)
+{
+  ASSERT_TRUE(m_started);
+  SOCKET sock = ConnectToServer();
+  ASSERT_NE(INVALID_SOCKET, sock);
+
+  // requests sent at once are answered in order
+  std::string requests;
+  for (int i = 1; i <= 50; i++)
+    requests += Ping(i);
+  EXPECT_TRUE(SendAll(sock, requests));
+
+  std::string pending, response;
+  for (int i = 1; i <= 50; i++)
+  {
+    ASSERT_TRUE(ReadObject(sock, pending, response));
+    StringUtils::Replace(response, " ", "");
+    EXPECT_NE(std::string::npos, response.find("\"pong\""));
+    EXPECT_NE(std::string::npos, response.find(StringUtils::Format("\"id\":%d", i))) << response;
+  }
+  closesocket(sock);
+}
+
+/* a remote sending a request and waiting for its response, over and over */
+class CLoadClient : public IRunnable
+{
+public:
+  CLoadClient(int requests) : m_requests(requests), m_failed(0) {}
+
+  void Run()
+  {
+    SOCKET sock = ConnectToServer();
+    if (sock == INVALID_SOCKET)
+    {
+      m_failed = m_requests;
+      return;
+    }
+
+    std::string pending, response;
+    CStopWatch watch;
+    for (int i = 0; i < m_requests; i++)
+    {
+      watch.StartZero();
+      if (!SendAll(sock, Ping(i)) || !ReadObject(sock, pending, response))
+      {
+        m_failed = m_requests - i;
+        break;
+      }
+      m_latencies.push_back(watch.GetElapsedMilliseconds());
+    }
+    closesocket(sock);
+  }
+
+  int m_requests;
+  int m_failed;
+  std::vector<float> m_latencies;
+};
+
+/* runs clients at once, returning the requests that failed */
+static int RunClients(int clients, int requests, float &elapsed, std::vector<float> &latencies)
+{
+  std::vector<CLoadClient*> runners;
+  std::vector<CThread*> threads;
+  for (int i = 0; i < clients; i++)
+  {
+    runners.push_back(new CLoadClient(requests));
+    threads.push_back(new CThread(runners.back(), "LoadClient"));
+  }
+
+  CStopWatch watch;
+  watch.StartZero();
+  for (std::vector<CThread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+    (*it)->Create();
+  for (std::vector<CThread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+  {
+    EXPECT_TRUE((*it)->WaitForThreadExit(60000));
+    delete *it;
+  }
+  elapsed = watch.GetElapsedSeconds();
+
+  int failed = 0;
+  for (std::vector<CLoadClient*>::iterator it = runners.begin(); it != runners.end(); ++it)
+  {
+    failed += (*it)->m_failed;
+    latencies.insert(latencies.end(), (*it)->m_latencies.begin(), (*it)->m_latencies.end());
+    delete *it;
+  }
+  return failed;
+}
+
+TEST_F(TestTCPServer, ConcurrentClients)
+{
+  ASSERT_TRUE(m_started);
+  float elapsed;
+  std::vector<float> latencies;
+  EXPECT_EQ(0, RunClients(8, 20, elapsed, latencies));
+  EXPECT_EQ(160U, latencies.size());
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestTCPServer, DISABLED_BenchmarkConcurrentClients)
+{
+  static const int requests = 200;
+  ASSERT_TRUE(m_started);
+
+  for (int clients = 1; clients <= 64; clients *= 4)
+  {
+    float elapsed;
+    std::vector<float> latencies;
+    EXPECT_EQ(0, RunClients(clients, requests, elapsed, latencies));
+    ASSERT_FALSE(latencies.empty());
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << clients << " clients: " << latencies.size() << " requests in " << elapsed * 1000 << " ms, p50 "
+              << latencies[latencies.size() / 2] << " ms, p99 " << latencies[latencies.size() * 99 / 100] << " ms" << std::endl;
+  }
+}
@@ -0,0 +1,338 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "TextureCache.h"
+#include "TextureCacheJob.h"
+#include "TextureCachePipeline.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "pictures/Picture.h"
+#include "profiles/ProfilesManager.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
+#include "utils/JobManager.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/* counts the images the pipeline hands over */
+class CTestTextureCacheOwner : public CTextureCachePipeline::IOwner
+{
+public:
+  CTestTextureCacheOwner(unsigned int expected) : m_expected(expected), m_cached(0), m_failed(0), m_batches(0), m_largestBatch(0) {}
+
+  virtual bool OnImageStarting(const CTextureCacheJobPtr &job)
+  {
+    return true;
+  }
+
+  virtual void OnImagesCached(const std::vector<CTextureCacheJobPtr> &jobs)
+  {
+    CSingleLock lock(m_section);
+    for (std::vector<CTextureCacheJobPtr>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+      if ((*i)->IsDone())
+      {
+        m_cached++;
+        m_details.push_back((*i)->m_details);
+      }
+      else
+        m_failed++;
+    }
+    m_batches++;
+    m_largestBatch = std::max(m_largestBatch, (unsigned int)jobs.size());
+    if (m_cached + m_failed >= m_expected)
+      m_allDone.Set();
+  }
+
+  bool Wait()
+  {
+    return m_allDone.WaitMSec(120000);
+  }
+
+  CCriticalSection             m_section;
+  CEvent                       m_allDone;
+  unsigned int                 m_expected;
+  unsigned int                 m_cached;
+  unsigned int                 m_failed;
+  unsigned int                 m_batches;
+  unsigned int                 m_largestBatch;
+  std::vector<CTextureDetails> m_details;
+};
+
+/* keeps a list of the images being cached like CTextureCache does */
+class CTestProcessingOwner : public CTestTextureCacheOwner
+{
+public:
+  CTestProcessingOwner(unsigned int expected) : CTestTextureCacheOwner(expected), m_starts(0) {}
+
+  virtual bool OnImageStarting(const CTextureCacheJobPtr &job)
+  {
+    CSingleLock lock(m_section);
+    m_starts++;
+    return m_processing.insert(job->m_url).second;
+  }
+
+  virtual void OnImagesCached(const std::vector<CTextureCacheJobPtr> &jobs)
+  {
+    {
+      CSingleLock lock(m_section);
+      for (std::vector<CTextureCacheJobPtr>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+        m_processing.erase((*i)->m_url);
+    }
+    CTestTextureCacheOwner::OnImagesCached(jobs);
+  }
+
+  unsigned int Starts()
+  {
+    CSingleLock lock(m_section);
+    return m_starts;
+  }
+
+  size_t Processing()
+  {
+    CSingleLock lock(m_section);
+    return m_processing.size();
+  }
+
+  unsigned int          m_starts;
+  std::set<std::string> m_processing;
+};
+
+/* a folder of sample images, and a profile whose thumbnails folder is in special://temp */
+class TestTextureCachePipeline : public testing::Test
+{
+protected:
+  TestTextureCachePipeline()
+  {
+    m_profile = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestTextureCache/");
+    XFILE::CDirectory::Create(m_profile);
+    m_addedProfile = CProfilesManager::Get().GetNumberOfProfiles() == 0;
+    if (m_addedProfile)
+      CProfilesManager::Get().AddProfile(CProfile(m_profile, "Master user", 0));
+    XFILE::CDirectory::Create(CProfilesManager::Get().GetThumbnailsFolder());
+    for (size_t hex = 0; hex < 16; hex++)
+      XFILE::CDirectory::Create(URIUtils::AddFileToFolder(CProfilesManager::Get().GetThumbnailsFolder(), StringUtils::Format("%x", hex)));
+
+    m_samples = URIUtils::AddFileToFolder(m_profile, "samples/");
+    XFILE::CDirectory::Create(m_samples);
+  }
+
+  ~TestTextureCachePipeline()
+  {
+    for (std::vector<CStdString>::const_iterator i = m_created.begin(); i != m_created.end(); ++i)
+      XFILE::CFile::Delete(*i);
+    if (m_addedProfile)
+      CProfilesManager::Get().Clear();
+  }
+
+  /* posters and fanart of noisy gradients, every fifth one a png */
+  void Generate(unsigned int count)
+  {
+    unsigned int seed = 42;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      bool fanart = i % 2;
+      unsigned int width  = fanart ? 1920 : 1000;
+      unsigned int height = fanart ? 1080 : 1500;
+      std::vector<uint32_t> pixels(width * height);
+      for (unsigned int y = 0; y < height; y++)
+      {
+        for (unsigned int x = 0; x < width; x++)
+        {
+          seed = seed * 1103515245 + 12345;
+          unsigned int noise = (seed >> 16) & 0x1F;
+          pixels[y * width + x] = 0xFF000000 | ((x * 255 / width + noise) & 0xFF) << 16 | ((y * 255 / height) & 0xFF) << 8 | ((i * 16 + noise) & 0xFF);
+        }
+      }
+      CStdString file = URIUtils::AddFileToFolder(m_samples, StringUtils::Format("sample%04u.%s", i, i % 5 == 4 ? "png" : "jpg"));
+      if (CPicture::CreateThumbnailFromSurface((unsigned char *)&pixels[0], width, height, width * 4, file))
+        m_images.push_back(file);
+    }
+  }
+
+  /* the images of a folder given by XBMC_TEXTURECACHE_SAMPLES, generated ones otherwise */
+  void Samples(unsigned int count)
+  {
+    const char *folder = getenv("XBMC_TEXTURECACHE_SAMPLES");
+    if (folder)
+    {
+      CFileItemList items;
+      XFILE::CDirectory::GetDirectory(folder, items, ".jpg|.jpeg|.png|.tbn", XFILE::DIR_FLAG_NO_FILE_DIRS);
+      for (int i = 0; i < items.Size(); i++)
+        m_images.push_back(items[i]->GetPath());
+    }
+    else
+      Generate(count);
+    m_created.insert(m_created.end(), m_images.begin(), m_images.end());
+  }
+
+  /* cache all images through a pipeline, returning the images per second */
+  float Run(unsigned int readers, unsigned int decoders, unsigned int encoders, unsigned int batchSize, CTestTextureCacheOwner &owner)
+  {
+    CStopWatch watch;
+    watch.StartZero();
+    {
+      CTextureCachePipeline pipeline(&owner, readers, decoders, encoders, batchSize);
+      for (std::vector<CStdString>::const_iterator i = m_images.begin(); i != m_images.end(); ++i)
+        pipeline.Add(CTextureCacheJobPtr(new CTextureCacheJob(*i)));
+      EXPECT_TRUE(owner.Wait());
+      EXPECT_TRUE(pipeline.IsIdle());
+    }
+    float elapsed = watch.GetElapsedSeconds();
+    Forget(owner);
+    return elapsed > 0 ? m_images.size() / elapsed : 0;
+  }
+
+  /* remove the cached images, so the next run caches them again */
+  void Forget(const CTestTextureCacheOwner &owner)
+  {
+    for (std::vector<CTextureDetails>::const_iterator i = owner.m_details.begin(); i != owner.m_details.end(); ++i)
+      XFILE::CFile::Delete(CTextureCache::GetCachedPath(i->file));
+  }
+
+  CStdString              m_profile;
+  CStdString              m_samples;
+  bool                    m_addedProfile;
+  std::vector<CStdString> m_images;
+  std::vector<CStdString> m_created;
+};
+
+TEST_F(TestTextureCachePipeline, CachesAll)
+{
+  Generate(12);
+  m_created = m_images;
+  ASSERT_FALSE(m_images.empty());
+
+  // a missing image fails, without holding up the others
+  m_images.push_back(URIUtils::AddFileToFolder(m_samples, "missing.jpg"));
+
+  CTestTextureCacheOwner owner(m_images.size());
+  {
+    CTextureCachePipeline pipeline(&owner, 2, 2, 2, 5);
+    for (std::vector<CStdString>::const_iterator i = m_images.begin(); i != m_images.end(); ++i)
+      EXPECT_TRUE(pipeline.Add(CTextureCacheJobPtr(new CTextureCacheJob(*i))));
+    // an image that is queued already isn't queued twice
+    EXPECT_FALSE(pipeline.Add(CTextureCacheJobPtr(new CTextureCacheJob(m_images.front()))));
+    ASSERT_TRUE(owner.Wait());
+  }
+
+  EXPECT_EQ(m_images.size() - 1, owner.m_cached);
+  EXPECT_EQ(1U, owner.m_failed);
+  EXPECT_LE(owner.m_largestBatch, 5U);
+  for (std::vector<CTextureDetails>::const_iterator i = owner.m_details.begin(); i != owner.m_details.end(); ++i)
+  {
+    EXPECT_TRUE(XFILE::CFile::Exists(CTextureCache::GetCachedPath(i->file))) << i->file;
+    EXPECT_GT(i->width, 0U);
+    EXPECT_LE(i->height, 1080U);
+    EXPECT_FALSE(i->hash.empty());
+  }
+  Forget(owner);
+}
+
+TEST_F(TestTextureCachePipeline, CancelInProgress)
+{
+  Generate(12);
+  m_created = m_images;
+  ASSERT_FALSE(m_images.empty());
+
+  CTestProcessingOwner owner(m_images.size());
+  {
+    CTextureCachePipeline pipeline(&owner, 1, 1, 1, 50);
+    for (std::vector<CStdString>::const_iterator i = m_images.begin(); i != m_images.end(); ++i)
+      EXPECT_TRUE(pipeline.Add(CTextureCacheJobPtr(new CTextureCacheJob(*i))));
+
+    XbmcThreads::EndTime timeout(10000);
+    while (owner.Starts() == 0 && !timeout.IsTimePast())
+      XbmcThreads::ThreadSleep(1);
+    ASSERT_GT(owner.Starts(), 0U);
+
+    // every image the owner accepted is handed back before Cancel() returns
+    pipeline.Cancel();
+    EXPECT_TRUE(pipeline.IsIdle());
+    EXPECT_EQ(0U, owner.Processing());
+  }
+
+  // so the same image is cached again afterwards
+  CTestProcessingOwner again(1);
+  {
+    CTextureCachePipeline pipeline(&again, 1, 1, 1, 50);
+    EXPECT_TRUE(pipeline.Add(CTextureCacheJobPtr(new CTextureCacheJob(m_images.front()))));
+    ASSERT_TRUE(again.Wait());
+  }
+  EXPECT_EQ(1U, again.m_cached);
+  EXPECT_EQ(0U, again.Processing());
+
+  Forget(owner);
+  Forget(again);
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestTextureCachePipeline, DISABLED_BenchmarkColdCache)
+{
+  Samples(200);
+  ASSERT_FALSE(m_images.empty());
+
+  // the job manager only runs a couple of background jobs at once by default
+  CJobManager::GetInstance().SetMaxWorkers(16);
+
+  // every image cached in turn, the way a single caching job at a time does
+  {
+    CTestTextureCacheOwner owner(m_images.size());
+    std::vector<CTextureCacheJobPtr> jobs;
+    CStopWatch watch;
+    watch.StartZero();
+    for (std::vector<CStdString>::const_iterator i = m_images.begin(); i != m_images.end(); ++i)
+    {
+      CTextureCacheJobPtr job(new CTextureCacheJob(*i));
+      job->CacheTexture();
+      jobs.push_back(job);
+    }
+    float elapsed = watch.GetElapsedSeconds();
+    owner.OnImagesCached(jobs);
+    EXPECT_EQ(m_images.size(), owner.m_cached);
+    Forget(owner);
+    std::cout << m_images.size() << " images cached in turn: " << elapsed * 1000 << " ms, "
+              << (elapsed > 0 ? m_images.size() / elapsed : 0) << " images/s" << std::endl;
+  }
+
+  unsigned int threads[] = { 1, 2, 4 };
+  for (unsigned int i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+  {
+    CTestTextureCacheOwner owner(m_images.size());
+    float rate = Run(threads[i], threads[i], threads[i], 50, owner);
+    EXPECT_EQ(m_images.size(), owner.m_cached);
+    std::cout << threads[i] << " thread(s) per stage: " << rate << " images/s in " << owner.m_batches << " batches" << std::endl;
+  }
+
+  CJobManager::GetInstance().SetMaxWorkers(5);
+}
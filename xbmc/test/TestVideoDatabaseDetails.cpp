@@ -0,0 +1,357 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "dbwrappers/sqlitedataset.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "profiles/ProfilesManager.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+#include "video/VideoDatabase.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+
+/* a video database of its own, counting the statements run on it */
+class CTestVideoDatabase : public CVideoDatabase
+{
+public:
+  CTestVideoDatabase() : m_queries(0) {}
+
+  bool Create(const std::string &folder)
+  {
+    DatabaseSettings settings;
+    settings.type = "sqlite3";
+    settings.host = folder;
+    settings.name = "TestMyVideos";
+    if (!Update(settings))
+      return false;
+
+    sqlite3_trace(((dbiplus::SqliteDatabase *)m_pDB.get())->getHandle(), CountQuery, &m_queries);
+    return true;
+  }
+
+  static void CountQuery(void *queries, const char *sql)
+  {
+    (*(unsigned int *)queries)++;
+  }
+
+  unsigned int m_queries;
+};
+
+class TestVideoDatabaseDetails : public testing::Test
+{
+protected:
+  TestVideoDatabaseDetails()
+  {
+    m_folder = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestVideoDatabase/");
+    XFILE::CDirectory::Create(m_folder);
+    m_addedProfile = CProfilesManager::Get().GetNumberOfProfiles() == 0;
+    if (m_addedProfile)
+      CProfilesManager::Get().AddProfile(CProfile(m_folder, "Master user", 0));
+  }
+
+  ~TestVideoDatabaseDetails()
+  {
+    m_db.Close();
+    CFileItemList files;
+    XFILE::CDirectory::GetDirectory(m_folder, files, "", XFILE::DIR_FLAG_NO_FILE_DIRS);
+    for (int i = 0; i < files.Size(); i++)
+      XFILE::CFile::Delete(files[i]->GetPath());
+    XFILE::CDirectory::Remove(m_folder);
+    if (m_addedProfile)
+      CProfilesManager::Get().Clear();
+  }
+
+  static SActorInfo Actor(const std::string &name, const std::string &role, int order)
+  {
+    SActorInfo actor;
+    actor.strName = name;
+    actor.strRole = role;
+    actor.order = order;
+    return actor;
+  }
+
+  static void Streams(CStreamDetails &details, unsigned int i)
+  {
+    CStreamDetailVideo *video = new CStreamDetailVideo();
+    video->m_strCodec = i % 3 ? "h264" : "mpeg2video";
+    video->m_iWidth = i % 2 ? 1920 : 1280;
+    video->m_iHeight = i % 2 ? 1080 : 720;
+    video->m_fAspect = 1.78f;
+    video->m_iDuration = 1200 + i;
+    details.AddStream(video);
+
+    CStreamDetailAudio *audio = new CStreamDetailAudio();
+    audio->m_strCodec = "ac3";
+    audio->m_iChannels = 6;
+    audio->m_strLanguage = "eng";
+    details.AddStream(audio);
+
+    if (i % 2)
+    {
+      CStreamDetailSubtitle *subtitle = new CStreamDetailSubtitle();
+      subtitle->m_strLanguage = "ger";
+      details.AddStream(subtitle);
+    }
+  }
+
+  /* movies with a cast, tags and streams, a few of them linked to a show with episodes */
+  void Fill(unsigned int movies, unsigned int episodes)
+  {
+    std::map<std::string, std::string> art;
+    std::map<int, std::map<std::string, std::string> > seasonArt;
+
+    m_db.BeginTransaction();
+
+    CVideoInfoTag show;
+    show.m_strTitle = "Show";
+    show.m_cast.push_back(Actor("Lead", "Herself", 0));
+    show.m_cast.push_back(Actor("Sidekick", "Himself", 1));
+    show.m_tags.push_back("Series");
+    int idShow = m_db.SetDetailsForTvShow(URIUtils::AddFileToFolder(m_folder, "show/"), show, art, seasonArt);
+
+    for (unsigned int i = 0; i < movies; i++)
+    {
+      CVideoInfoTag movie;
+      movie.m_strTitle = StringUtils::Format("Movie %u", i);
+      for (unsigned int j = 0; j < 8; j++)
+        movie.m_cast.push_back(Actor(StringUtils::Format("Actor %u", (i + j * 7) % 100), StringUtils::Format("Role %u", j), j));
+      movie.m_tags.push_back(StringUtils::Format("Tag %u", i % 7));
+      movie.m_tags.push_back("Tagged");
+      Streams(movie.m_streamDetails, i);
+      int idMovie = m_db.SetDetailsForMovie(URIUtils::AddFileToFolder(m_folder, StringUtils::Format("movie%04u.mkv", i)), movie, art);
+      if (i % 10 == 0)
+        m_db.LinkMovieToTvshow(idMovie, idShow, false);
+    }
+
+    for (unsigned int i = 0; i < episodes; i++)
+    {
+      CVideoInfoTag episode;
+      episode.m_strTitle = StringUtils::Format("Episode %u", i);
+      episode.m_iSeason = 1 + i / 20;
+      episode.m_iEpisode = 1 + i % 20;
+      episode.m_cast.push_back(Actor(StringUtils::Format("Guest %u", i % 30), "Guest", 0));
+      if (i % 3 == 0)
+        episode.m_cast.push_back(Actor("Lead", "Herself", 1));
+      Streams(episode.m_streamDetails, i);
+      episode.m_strFileNameAndPath = URIUtils::AddFileToFolder(m_folder, StringUtils::Format("show/s%02de%02d.mkv", episode.m_iSeason, episode.m_iEpisode));
+      m_db.SetDetailsForEpisode(episode.m_strFileNameAndPath, episode, art, idShow);
+      if (i % 4 == 0)
+      {
+        CBookmark bookmark;
+        bookmark.timeInSeconds = 60.0 + i;
+        bookmark.totalTimeInSeconds = 1200.0;
+        m_db.AddBookMarkForEpisode(episode, bookmark);
+      }
+    }
+
+    m_db.CommitTransaction();
+  }
+
+  /* the details of all items, read one item at a time the way the json-rpc interface did */
+  void GetOneByOne(CFileItemList &items)
+  {
+    for (int i = 0; i < items.Size(); i++)
+    {
+      CVideoInfoTag *tag = items[i]->GetVideoInfoTag();
+      if (tag->m_type == MediaTypeMovie)
+        m_db.GetMovieInfo("", *tag, tag->m_iDbId);
+      else if (tag->m_type == MediaTypeEpisode)
+        m_db.GetEpisodeInfo("", *tag, tag->m_iDbId);
+    }
+  }
+
+  static void ExpectSameDetails(const CVideoInfoTag &expected, const CVideoInfoTag &actual)
+  {
+    ASSERT_EQ(expected.m_iDbId, actual.m_iDbId);
+    ASSERT_EQ(expected.m_cast.size(), actual.m_cast.size()) << actual.m_strTitle;
+    for (unsigned int i = 0; i < expected.m_cast.size(); i++)
+    {
+      EXPECT_EQ(expected.m_cast[i].strName, actual.m_cast[i].strName) << actual.m_strTitle;
+      EXPECT_EQ(expected.m_cast[i].strRole, actual.m_cast[i].strRole) << actual.m_strTitle;
+      EXPECT_EQ(expected.m_cast[i].order, actual.m_cast[i].order) << actual.m_strTitle;
+    }
+    EXPECT_TRUE(expected.m_tags == actual.m_tags) << actual.m_strTitle;
+    EXPECT_TRUE(expected.m_showLink == actual.m_showLink) << actual.m_strTitle;
+    EXPECT_FLOAT_EQ(expected.m_fEpBookmark, actual.m_fEpBookmark) << actual.m_strTitle;
+    EXPECT_EQ(expected.m_duration, actual.m_duration) << actual.m_strTitle;
+
+    const CStreamDetails &e = expected.m_streamDetails, &a = actual.m_streamDetails;
+    EXPECT_EQ(e.GetStreamCount(CStreamDetail::VIDEO), a.GetStreamCount(CStreamDetail::VIDEO)) << actual.m_strTitle;
+    EXPECT_EQ(e.GetStreamCount(CStreamDetail::AUDIO), a.GetStreamCount(CStreamDetail::AUDIO)) << actual.m_strTitle;
+    EXPECT_EQ(e.GetStreamCount(CStreamDetail::SUBTITLE), a.GetStreamCount(CStreamDetail::SUBTITLE)) << actual.m_strTitle;
+    EXPECT_EQ(e.GetVideoCodec(), a.GetVideoCodec()) << actual.m_strTitle;
+    EXPECT_EQ(e.GetVideoWidth(), a.GetVideoWidth()) << actual.m_strTitle;
+    EXPECT_EQ(e.GetAudioChannels(), a.GetAudioChannels()) << actual.m_strTitle;
+    EXPECT_EQ(e.GetSubtitleLanguage(), a.GetSubtitleLanguage()) << actual.m_strTitle;
+  }
+
+  /* a page of movies and a page of episodes, the way the json-rpc interface asks for them */
+  void GetPages(CFileItemList &movies, CFileItemList &episodes)
+  {
+    ASSERT_TRUE(m_db.GetMoviesByWhere("videodb://movies/titles/", CDatabase::Filter(), movies));
+    ASSERT_TRUE(m_db.GetEpisodesByWhere("videodb://tvshows/titles/-1/-1/", CDatabase::Filter(), episodes, false));
+  }
+
+  CStdString         m_folder;
+  bool               m_addedProfile;
+  CTestVideoDatabase m_db;
+};
+
+TEST_F(TestVideoDatabaseDetails, SameAsOneByOne)
+{
+  ASSERT_TRUE(m_db.Create(m_folder));
+  Fill(30, 25);
+
+  CFileItemList movies, episodes;
+  GetPages(movies, episodes);
+  ASSERT_EQ(30, movies.Size());
+  ASSERT_EQ(25, episodes.Size());
+
+  CFileItemList expectedMovies, expectedEpisodes;
+  expectedMovies.Copy(movies);
+  expectedEpisodes.Copy(episodes);
+  GetOneByOne(expectedMovies);
+  GetOneByOne(expectedEpisodes);
+
+  EXPECT_TRUE(m_db.GetDetailsForItems(movies));
+  EXPECT_TRUE(m_db.GetDetailsForItems(episodes));
+
+  for (int i = 0; i < movies.Size(); i++)
+    ExpectSameDetails(*expectedMovies[i]->GetVideoInfoTag(), *movies[i]->GetVideoInfoTag());
+  for (int i = 0; i < episodes.Size(); i++)
+    ExpectSameDetails(*expectedEpisodes[i]->GetVideoInfoTag(), *episodes[i]->GetVideoInfoTag());
+
+  // reading the details twice doesn't add them twice
+  EXPECT_TRUE(m_db.GetDetailsForItems(movies));
+  ExpectSameDetails(*expectedMovies[0]->GetVideoInfoTag(), *movies[0]->GetVideoInfoTag());
+
+  // the show's cast follows the episode's cast, without listing an actor twice
+  const CVideoInfoTag *episode = NULL;
+  for (int i = 0; i < episodes.Size() && !episode; i++)
+  {
+    if (episodes[i]->GetVideoInfoTag()->m_strTitle == "Episode 0")
+      episode = episodes[i]->GetVideoInfoTag();
+  }
+  ASSERT_TRUE(episode != NULL);
+  ASSERT_EQ(3U, episode->m_cast.size());
+  EXPECT_EQ("Lead", episode->m_cast[1].strName);
+  EXPECT_EQ("Sidekick", episode->m_cast[2].strName);
+}
+
+TEST_F(TestVideoDatabaseDetails, NestedTransactions)
+{
+  ASSERT_TRUE(m_db.Create(m_folder));
+
+  // nested transactions are committed with the outer one
+  m_db.BeginTransaction();
+  m_db.BeginTransaction();
+  EXPECT_TRUE(m_db.ExecuteQuery("insert into country (strCountry) values ('Kept')"));
+  EXPECT_TRUE(m_db.CommitTransaction());
+  EXPECT_TRUE(m_db.InTransaction());
+  EXPECT_TRUE(m_db.CommitTransaction());
+  EXPECT_FALSE(m_db.InTransaction());
+
+  // rolling back a nested one rolls back all of it
+  m_db.BeginTransaction();
+  EXPECT_TRUE(m_db.ExecuteQuery("insert into country (strCountry) values ('Outer')"));
+  m_db.BeginTransaction();
+  EXPECT_TRUE(m_db.ExecuteQuery("insert into country (strCountry) values ('Inner')"));
+  m_db.RollbackTransaction();
+  EXPECT_TRUE(m_db.InTransaction());
+  m_db.BeginTransaction();
+  EXPECT_FALSE(m_db.CommitTransaction());
+  EXPECT_FALSE(m_db.CommitTransaction());
+  EXPECT_FALSE(m_db.InTransaction());
+  EXPECT_STREQ("1", m_db.GetSingleValue("select count(*) from country").c_str());
+
+  // and the next transaction starts over
+  m_db.BeginTransaction();
+  EXPECT_TRUE(m_db.ExecuteQuery("insert into country (strCountry) values ('Next')"));
+  EXPECT_TRUE(m_db.CommitTransaction());
+  EXPECT_STREQ("2", m_db.GetSingleValue("select count(*) from country").c_str());
+}
+
+TEST_F(TestVideoDatabaseDetails, FewQueries)
+{
+  ASSERT_TRUE(m_db.Create(m_folder));
+  Fill(200, 100);
+
+  CFileItemList movies, episodes;
+  GetPages(movies, episodes);
+  unsigned int queries = m_db.m_queries;
+  GetOneByOne(movies);
+  GetOneByOne(episodes);
+  unsigned int oneByOneQueries = m_db.m_queries - queries;
+
+  movies.Clear();
+  episodes.Clear();
+  GetPages(movies, episodes);
+  queries = m_db.m_queries;
+  EXPECT_TRUE(m_db.GetDetailsForItems(movies));
+  EXPECT_TRUE(m_db.GetDetailsForItems(episodes));
+  unsigned int batchQueries = m_db.m_queries - queries;
+
+  // a query per table and page of ids, however many items there are
+  EXPECT_LE(batchQueries, 20U);
+  EXPECT_LT(batchQueries, oneByOneQueries);
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST_F(TestVideoDatabaseDetails, DISABLED_BenchmarkQueries)
+{
+  ASSERT_TRUE(m_db.Create(m_folder));
+  Fill(1000, 500);
+
+  CFileItemList movies, episodes;
+  CStopWatch watch;
+
+  // one item at a time
+  GetPages(movies, episodes);
+  unsigned int queries = m_db.m_queries;
+  watch.StartZero();
+  GetOneByOne(movies);
+  GetOneByOne(episodes);
+  float oneByOneTime = watch.GetElapsedMilliseconds();
+  unsigned int oneByOneQueries = m_db.m_queries - queries;
+
+  // all items at once
+  movies.Clear();
+  episodes.Clear();
+  GetPages(movies, episodes);
+  queries = m_db.m_queries;
+  watch.StartZero();
+  EXPECT_TRUE(m_db.GetDetailsForItems(movies));
+  EXPECT_TRUE(m_db.GetDetailsForItems(episodes));
+  float batchTime = watch.GetElapsedMilliseconds();
+  unsigned int batchQueries = m_db.m_queries - queries;
+
+  std::cout << movies.Size() << " movies and " << episodes.Size() << " episodes" << std::endl;
+  std::cout << "details one item at a time: " << oneByOneQueries << " queries, " << oneByOneTime << " ms" << std::endl;
+  std::cout << "details of all items at once: " << batchQueries << " queries, " << batchTime << " ms" << std::endl;
+}
@@ -0,0 +1,246 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "utils/RegExp.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+#include "video/VideoInfoScanner.h"
+#include "video/VideoScanPrefetcher.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace VIDEO;
+
+class CTestVideoInfoScanner : public CVideoInfoScanner
+{
+public:
+  using CVideoInfoScanner::EnumerateEpisodeItem;
+};
+
+/* episode file names in the formats the default expressions know about */
+static CFileItemList* EpisodeItems(int count)
+{
+  CFileItemList* items = new CFileItemList;
+  for (int i = 0; i < count; i++)
+  {
+    int show = i / 500, season = i / 50 % 10 + 1, episode = i % 50 + 1;
+    CStdString path;
+    switch (i % 4)
+    {
+    case 0:
+      path = StringUtils::Format("/tv/Show %d/Season %d/Show.%d.S%02dE%02d.720p.HDTV.x264.mkv", show, season, show, season, episode);
+      break;
+    case 1:
+      path = StringUtils::Format("/tv/Show %d/Season %d/Show %d - %dx%02d - Title.avi", show, season, show, season, episode);
+      break;
+    case 2:
+      path = StringUtils::Format("/tv/Show %d/Season %d/show.%d.s%02de%02de%02d.mkv", show, season, show, season, episode, episode + 1);
+      break;
+    default:
+      path = StringUtils::Format("/tv/Show %d/Show.%d.2013.%02d.%02d.mp4", show, show, season, episode % 28 + 1);
+      break;
+    }
+    items->Add(CFileItemPtr(new CFileItem(path, false)));
+  }
+  return items;
+}
+
+TEST(TestVideoInfoScanner, EnumerateEpisodeItem)
+{
+  CTestVideoInfoScanner scanner;
+  CFileItem item("/tv/Show/Season 2/Show.S02E03E04.mkv", false);
+  EPISODELIST episodes;
+  EXPECT_TRUE(scanner.EnumerateEpisodeItem(&item, episodes));
+  ASSERT_EQ(2U, episodes.size());
+  EXPECT_EQ(2, episodes[0].iSeason);
+  EXPECT_EQ(3, episodes[0].iEpisode);
+  EXPECT_EQ(4, episodes[1].iEpisode);
+}
+
+TEST(TestVideoInfoScanner, EnumerateEpisodesCached)
+{
+  static const int count = 400;
+  CTestVideoInfoScanner scanner;
+  CFileItemList* items = EpisodeItems(count);
+
+  // the cached expressions find the same episodes
+  size_t found[2];
+  for (int cached = 0; cached < 2; cached++)
+  {
+    CRegExp::SetCacheSize(cached ? 500 : 0);
+    EPISODELIST episodes;
+    for (int i = 0; i < items->Size(); i++)
+      scanner.EnumerateEpisodeItem(items->Get(i).get(), episodes);
+    found[cached] = episodes.size();
+  }
+  CRegExp::SetCacheSize(500);
+  EXPECT_EQ(found[0], found[1]);
+  EXPECT_LE((size_t)count, found[1]);
+
+  delete items;
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestVideoInfoScanner, DISABLED_BenchmarkEnumerateEpisodes)
+{
+  static const int count = 20000;
+  CTestVideoInfoScanner scanner;
+  CFileItemList* items = EpisodeItems(count);
+
+  size_t found[2];
+  for (int cached = 0; cached < 2; cached++)
+  {
+    CRegExp::SetCacheSize(cached ? 500 : 0);
+    EPISODELIST episodes;
+    CStopWatch watch;
+    watch.StartZero();
+    for (int i = 0; i < items->Size(); i++)
+      scanner.EnumerateEpisodeItem(items->Get(i).get(), episodes);
+    float elapsed = watch.GetElapsedMilliseconds();
+    found[cached] = episodes.size();
+    std::cout << (cached ? "with" : "without") << " the expression cache: " << count << " files, "
+              << found[cached] << " episodes in " << elapsed << " ms" << std::endl;
+  }
+  CRegExp::SetCacheSize(500);
+  EXPECT_EQ(found[0], found[1]);
+  EXPECT_LE((size_t)count, found[1]);
+
+  delete items;
+}
+
+/* movie folders of empty files in special://temp */
+class CSyntheticMovieTree
+{
+public:
+  CSyntheticMovieTree(int folders, int files)
+  {
+    m_root = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestVideoScan/");
+    XFILE::CDirectory::Create(m_root);
+    for (int i = 0; i < folders; i++)
+    {
+      CStdString folder = URIUtils::AddFileToFolder(m_root, StringUtils::Format("Movie %d (%d)/", i, 1950 + i % 60));
+      XFILE::CDirectory::Create(folder);
+      m_folders.push_back(folder);
+      for (int j = 0; j < files; j++)
+      {
+        CStdString file = URIUtils::AddFileToFolder(folder, StringUtils::Format("Movie %d.part%d.mkv", i, j + 1));
+        XFILE::CFile out;
+        if (out.OpenForWrite(file, true))
+          out.Close();
+        m_files.push_back(file);
+      }
+    }
+  }
+
+  ~CSyntheticMovieTree()
+  {
+    for (std::vector<CStdString>::const_iterator it = m_files.begin(); it != m_files.end(); ++it)
+      XFILE::CFile::Delete(*it);
+    for (std::vector<CStdString>::const_iterator it = m_folders.begin(); it != m_folders.end(); ++it)
+      XFILE::CDirectory::Remove(*it);
+    XFILE::CDirectory::Remove(m_root);
+  }
+
+  CStdString m_root;
+  std::vector<CStdString> m_folders;
+  std::vector<CStdString> m_files;
+};
+
+TEST(TestVideoInfoScanner, Prefetcher)
+{
+  CSyntheticMovieTree tree(3, 2);
+  const CStdString &folder = tree.m_folders[1];
+
+  CScanListing listing;
+  CVideoScanPrefetcher::List(folder, CScanListing::LIST_FILES, "", listing);
+  EXPECT_TRUE(listing.m_listed);
+  EXPECT_EQ(2, listing.m_items.Size());
+  EXPECT_EQ(2, listing.m_count);
+  EXPECT_FALSE(listing.m_hash.empty());
+
+  // unchanged folders aren't listed
+  CScanListing stacked;
+  CVideoScanPrefetcher::List(folder, CScanListing::LIST_STACKED, "", stacked);
+  EXPECT_TRUE(stacked.m_listed);
+  ASSERT_FALSE(stacked.m_fastHash.empty());
+  CScanListing unchanged;
+  CVideoScanPrefetcher::List(folder, CScanListing::LIST_STACKED, stacked.m_fastHash, unchanged);
+  EXPECT_FALSE(unchanged.m_listed);
+  EXPECT_EQ(0, unchanged.m_items.Size());
+
+  CScanListing recursive;
+  CVideoScanPrefetcher::List(tree.m_root, CScanListing::LIST_RECURSIVE, "", recursive);
+  EXPECT_EQ(6, recursive.m_count);
+
+  // prefetched listings are the same as the ones listed in place
+  CVideoScanPrefetcher prefetcher;
+  for (size_t i = 0; i < tree.m_folders.size(); i++)
+    prefetcher.Prefetch(tree.m_folders[i], CScanListing::LIST_STACKED, stacked.m_fastHash);
+  EXPECT_TRUE(prefetcher.IsPrefetched(folder));
+  ScanListingPtr got = prefetcher.Get(folder, CScanListing::LIST_STACKED, stacked.m_fastHash);
+  EXPECT_FALSE(prefetcher.IsPrefetched(folder));
+  EXPECT_FALSE(got->m_listed);
+  EXPECT_EQ(stacked.m_fastHash, got->m_fastHash);
+
+  // the database hash changed since, the folder is listed again
+  got = prefetcher.Get(tree.m_folders[0], CScanListing::LIST_STACKED, "");
+  EXPECT_TRUE(got->m_listed);
+  EXPECT_EQ(stacked.m_count, got->m_count);
+
+  prefetcher.Forget(tree.m_root);
+  EXPECT_FALSE(prefetcher.IsPrefetched(tree.m_folders[2]));
+  got = prefetcher.Get(folder, CScanListing::LIST_FILES);
+  EXPECT_EQ(listing.m_hash, got->m_hash);
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestVideoInfoScanner, DISABLED_BenchmarkScanListing)
+{
+  static const int folders = 500;
+  static const int window = 16;
+  CSyntheticMovieTree tree(folders, 4);
+
+  std::vector<CStdString> hashes[2];
+  for (int pipelined = 0; pipelined < 2; pipelined++)
+  {
+    CVideoScanPrefetcher prefetcher;
+    CStopWatch watch;
+    watch.StartZero();
+    for (int i = 0, prefetched = 0; i < folders; i++)
+    {
+      // the same window the scanner keeps listing ahead
+      for (; pipelined && prefetched < folders && prefetched <= i + window; prefetched++)
+        prefetcher.Prefetch(tree.m_folders[prefetched], CScanListing::LIST_STACKED);
+      hashes[pipelined].push_back(prefetcher.Get(tree.m_folders[i], CScanListing::LIST_STACKED)->m_hash);
+    }
+    float elapsed = watch.GetElapsedMilliseconds();
+    std::cout << (pipelined ? "prefetched" : "in turn") << ": " << folders << " folders of " << tree.m_files.size() / folders
+              << " files listed in " << elapsed << " ms" << std::endl;
+  }
+  EXPECT_TRUE(hashes[0] == hashes[1]);
+}
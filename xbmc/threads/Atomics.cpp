@@ -20,6 +20,9 @@
 
 #include "Atomics.h"
 #include "system.h"
+#if defined(TARGET_WINDOWS)
+#include <intrin.h>
+#endif
 ///////////////////////////////////////////////////////////////////////////
 // 32-bit atomic compare-and-swap
 // Returns previous value of *pAddr
@@ -455,6 +458,39 @@ long AtomicSubtract(volatile long* pAddr, long amount)
 #endif
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Atomic load with acquire semantics. Memory accesses after the load
+// are not moved before it.
+///////////////////////////////////////////////////////////////////////////
+long AtomicLoadAcquire(volatile long* pAddr)
+{
+  long val = *pAddr;
+#if defined(TARGET_WINDOWS)
+  _ReadWriteBarrier(); // x86 doesn't reorder loads with later accesses
+#elif defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__ ("" : : : "memory");
+#else
+  __sync_synchronize();
+#endif
+  return val;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Atomic store with release semantics. Memory accesses before the store
+// are not moved after it.
+///////////////////////////////////////////////////////////////////////////
+void AtomicStoreRelease(volatile long* pAddr, long value)
+{
+#if defined(TARGET_WINDOWS)
+  _ReadWriteBarrier(); // x86 doesn't reorder stores with earlier accesses
+#elif defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__ ("" : : : "memory");
+#else
+  __sync_synchronize();
+#endif
+  *pAddr = value;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Fast spinlock implmentation. No backoff when busy
 ///////////////////////////////////////////////////////////////////////////
@@ -30,6 +30,8 @@ long AtomicIncrement(volatile long* pAddr);
 long AtomicDecrement(volatile long* pAddr);
 long AtomicAdd(volatile long* pAddr, long amount);
 long AtomicSubtract(volatile long* pAddr, long amount);
+long AtomicLoadAcquire(volatile long* pAddr);
+void AtomicStoreRelease(volatile long* pAddr, long value);
 
 class CAtomicSpinLock
 {
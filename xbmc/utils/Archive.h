@@ -37,6 +37,10 @@ class CArchive
 {
 public:
   CArchive(XFILE::CFile* pFile, int mode);
+  /*! \brief Load from a block of memory, which has to outlive the archive */
+  CArchive(const uint8_t *data, size_t size);
+  /*! \brief Store into a memory buffer, data is appended to it on every flush */
+  CArchive(std::vector<uint8_t> &buffer);
   ~CArchive();
 
   /* CArchive support storing and loading of all C basic integer types
@@ -183,6 +187,7 @@ protected:
   }
 
   XFILE::CFile* m_pFile;
+  std::vector<uint8_t> *m_pMemory;
   int m_iMode;
   uint8_t *m_pBuffer;
   uint8_t *m_BufferPos;
@@ -23,7 +23,9 @@
 #include "DatabaseUtils.h"
 #include "dbwrappers/dataset.h"
 #include "music/MusicDatabase.h"
+#include "settings/AdvancedSettings.h"
 #include "utils/log.h"
+#include "utils/SortUtils.h"
 #include "utils/Variant.h"
 #include "utils/StringUtils.h"
 #include "video/VideoDatabase.h"
@@ -465,6 +467,279 @@ std::string DatabaseUtils::BuildLimitClause(int end, int start /* = 0 */)
   return sql.str();
 }
 
+namespace
+{
+  /*! \brief Builds the parts of an ORDER BY clause like SortUtils builds the sort keys of items. */
+  class COrderByBuilder
+  {
+  public:
+    COrderByBuilder(const MediaType &mediaType, const std::string &collation, bool ignoreArticle)
+      : m_mediaType(mediaType), m_collation(collation), m_ignoreArticle(ignoreArticle)
+    { }
+
+    std::string Column(Field field, DatabaseQueryPart queryPart = DatabaseQueryPartSelect) const
+    {
+      return DatabaseUtils::GetField(field, m_mediaType, queryPart);
+    }
+
+    bool AddNumber(Field field)
+    {
+      return AddNumberExpression(Column(field));
+    }
+
+    bool AddNumberExpression(const std::string &expression)
+    {
+      if (expression.empty())
+        return false;
+      // values are compared like CVariant::asInteger()/asFloat() reads them, no value counts as 0
+      m_parts.push_back("CAST(COALESCE(" + expression + ", 0) AS DECIMAL(20,6))");
+      return true;
+    }
+
+    bool AddDate(Field field, DatabaseQueryPart queryPart = DatabaseQueryPartSelect)
+    {
+      std::string column = Column(field, queryPart);
+      if (column.empty())
+        return false;
+      // database dates sort by their text
+      m_parts.push_back("COALESCE(" + column + ", '')");
+      return true;
+    }
+
+    bool AddText(Field field, bool ignoreArticle)
+    {
+      return AddTextExpression(Column(field), ignoreArticle);
+    }
+
+    bool AddTextExpression(const std::string &expression, bool ignoreArticle)
+    {
+      // without a natural collation the database orders text differently than StringUtils::AlphaNumericCompare()
+      if (expression.empty() || m_collation.empty())
+        return false;
+
+      std::string text = "COALESCE(" + expression + ", '')";
+      if (ignoreArticle && !g_advancedSettings.m_vecTokens.empty())
+      {
+        // skip the first article the text starts with, like CSortKeys::GetArticleLength()
+        std::string stripped = "CASE";
+        for (std::vector<CStdString>::const_iterator token = g_advancedSettings.m_vecTokens.begin(); token != g_advancedSettings.m_vecTokens.end(); ++token)
+        {
+          std::string article = *token;
+          StringUtils::ToLower(article);
+          StringUtils::Replace(article, "'", "''");
+          stripped += StringUtils::Format(" WHEN LENGTH(%s) > %u AND LOWER(SUBSTR(%s, 1, %u)) = '%s' THEN SUBSTR(%s, %u)",
+                                          text.c_str(), (unsigned int)token->size(), text.c_str(), (unsigned int)token->size(),
+                                          article.c_str(), text.c_str(), (unsigned int)token->size() + 1);
+        }
+        text = stripped + " ELSE " + text + " END";
+      }
+
+      m_parts.push_back("(" + text + ") COLLATE " + m_collation);
+      return true;
+    }
+
+    /*! \brief The label of the item (see DatabaseUtils::GetDatabaseResults()) */
+    bool AddLabel()
+    {
+      if (m_mediaType == MediaTypeMovie || m_mediaType == MediaTypeTvShow || m_mediaType == MediaTypeMusicVideo)
+        return AddText(FieldTitle, m_ignoreArticle);
+      if (m_mediaType == MediaTypeEpisode)
+      {
+        // "<season * 100 + episode>. <title>"
+        std::string season = Column(FieldSeason), episode = Column(FieldEpisodeNumber);
+        if (season.empty() || episode.empty())
+          return false;
+        return AddNumberExpression("CAST(COALESCE(" + season + ", 0) AS DECIMAL(20,6)) * 100 + CAST(COALESCE(" + episode + ", 0) AS DECIMAL(20,6))") &&
+               AddText(FieldTitle, false);
+      }
+      if (m_mediaType == MediaTypeSong)
+        return AddNumber(FieldTrackNumber) && AddText(FieldTitle, false);
+      if (m_mediaType == MediaTypeAlbum)
+        return AddText(FieldAlbum, m_ignoreArticle);
+      if (m_mediaType == MediaTypeArtist)
+        return AddText(FieldArtist, m_ignoreArticle);
+      return false;
+    }
+
+    std::string GetClause(bool descending) const
+    {
+      std::string orderBy;
+      for (std::vector<std::string>::const_iterator part = m_parts.begin(); part != m_parts.end(); ++part)
+      {
+        if (!orderBy.empty())
+          orderBy += ", ";
+        orderBy += *part;
+        if (descending)
+          orderBy += " DESC";
+      }
+
+      // equal items stay in the order of their ids, as the sort in memory is stable
+      std::string id = Column(FieldId);
+      if (!id.empty())
+        orderBy += ", " + id;
+      return orderBy;
+    }
+
+  private:
+    MediaType m_mediaType;
+    std::string m_collation;
+    bool m_ignoreArticle;
+    std::vector<std::string> m_parts;
+  };
+}
+
+bool DatabaseUtils::BuildOrderByClause(const SortDescription &sorting, const MediaType &mediaType, const std::string &collation, std::string &orderBy)
+{
+  bool ignoreArticle = (sorting.sortAttributes & SortAttributeIgnoreArticle) != 0;
+  COrderByBuilder builder(mediaType, collation, ignoreArticle);
+
+  // every sort method is built from the same keys as its preparator in SortUtils
+  bool supported = false;
+  switch (sorting.sortBy)
+  {
+  case SortByLabel:
+    supported = builder.AddLabel();
+    break;
+
+  case SortByTitle:
+    supported = builder.AddText(FieldTitle, ignoreArticle);
+    break;
+
+  case SortBySortTitle:
+    if (mediaType == MediaTypeMovie || mediaType == MediaTypeTvShow)
+      supported = builder.AddTextExpression(builder.Column(FieldTitle, DatabaseQueryPartOrderBy), ignoreArticle);
+    else
+      supported = builder.AddText(FieldTitle, ignoreArticle);
+    break;
+
+  case SortByPath:
+    supported = builder.AddText(FieldPath, false);
+    if (supported && !builder.Column(FieldStartOffset).empty())
+      builder.AddNumber(FieldStartOffset);
+    break;
+
+  case SortByDateAdded:
+    supported = builder.AddDate(FieldDateAdded, DatabaseQueryPartOrderBy);
+    break;
+
+  case SortByLastPlayed:
+    supported = builder.AddDate(FieldLastPlayed) && builder.AddLabel();
+    break;
+
+  case SortByPlaycount:
+    supported = builder.AddNumber(FieldPlaycount) && builder.AddLabel();
+    break;
+
+  case SortByYear:
+    if (mediaType == MediaTypeTvShow)
+      supported = builder.AddNumberExpression("SUBSTR(" + builder.Column(FieldYear) + ", 1, 4)") && builder.AddLabel();
+    else if (mediaType == MediaTypeMovie || mediaType == MediaTypeMusicVideo ||
+             mediaType == MediaTypeAlbum || mediaType == MediaTypeSong)
+      supported = builder.AddNumber(FieldYear) && builder.AddLabel();
+    break;
+
+  case SortByRating:
+    supported = builder.AddNumber(FieldRating) && builder.AddLabel();
+    break;
+
+  case SortByVotes:
+    supported = builder.AddNumber(FieldVotes) && builder.AddLabel();
+    break;
+
+  case SortByTop250:
+    supported = builder.AddNumber(FieldTop250) && builder.AddLabel();
+    break;
+
+  case SortByMPAA:
+    supported = builder.AddText(FieldMPAA, false) && builder.AddLabel();
+    break;
+
+  case SortByTrackNumber:
+    supported = builder.AddNumber(FieldTrackNumber);
+    break;
+
+  case SortByTime:
+    supported = builder.AddNumber(FieldTime);
+    break;
+
+  case SortByGenre:
+    supported = builder.AddText(FieldGenre, ignoreArticle);
+    break;
+
+  case SortByCountry:
+    supported = builder.AddText(FieldCountry, ignoreArticle);
+    break;
+
+  case SortByStudio:
+    supported = builder.AddText(FieldStudio, ignoreArticle);
+    break;
+
+  case SortByArtist:
+    supported = builder.AddText(FieldArtist, ignoreArticle);
+    if (supported && g_advancedSettings.m_bMusicLibraryAlbumsSortByArtistThenYear && !builder.Column(FieldYear).empty())
+      builder.AddNumber(FieldYear);
+    if (supported && !builder.Column(FieldAlbum).empty())
+      builder.AddText(FieldAlbum, true);
+    if (supported && !builder.Column(FieldTrackNumber).empty())
+      builder.AddNumber(FieldTrackNumber);
+    break;
+
+  case SortByAlbum:
+    supported = builder.AddText(FieldAlbum, ignoreArticle) && builder.AddText(FieldArtist, ignoreArticle);
+    if (supported && !builder.Column(FieldTrackNumber).empty())
+      builder.AddNumber(FieldTrackNumber);
+    break;
+
+  case SortByEpisodeNumber:
+    if (mediaType == MediaTypeEpisode)
+    {
+      // specials are placed by the season and episode they air before
+      std::string season = "CAST(COALESCE(" + builder.Column(FieldSeason) + ", 0) AS DECIMAL(20,6))";
+      std::string episode = "CAST(COALESCE(" + builder.Column(FieldEpisodeNumber) + ", 0) AS DECIMAL(20,6))";
+      std::string sortSeason = "CAST(COALESCE(" + builder.Column(FieldSeasonSpecialSort) + ", 0) AS DECIMAL(20,6))";
+      std::string sortEpisode = "CAST(COALESCE(" + builder.Column(FieldEpisodeNumberSpecialSort) + ", 0) AS DECIMAL(20,6))";
+      supported = builder.AddNumberExpression(StringUtils::Format("CASE WHEN %s > 0 OR %s > 0 THEN %s * 4294967296 + %s * 65536 - (65536 - %s) ELSE %s * 4294967296 + %s * 65536 END",
+                                                                  sortEpisode.c_str(), sortSeason.c_str(), sortSeason.c_str(), sortEpisode.c_str(), episode.c_str(),
+                                                                  season.c_str(), episode.c_str())) &&
+                  builder.AddLabel();
+    }
+    break;
+
+  case SortBySeason:
+    if (mediaType == MediaTypeEpisode)
+      supported = builder.AddNumberExpression("COALESCE(" + builder.Column(FieldSeasonSpecialSort) + ", " + builder.Column(FieldSeason) + ")") && builder.AddLabel();
+    else if (mediaType == MediaTypeTvShow)
+      supported = builder.AddNumber(FieldSeason) && builder.AddLabel();
+    break;
+
+  case SortByNumberOfEpisodes:
+    supported = builder.AddNumber(FieldNumberOfEpisodes) && builder.AddLabel();
+    break;
+
+  case SortByNumberOfWatchedEpisodes:
+    supported = builder.AddNumber(FieldNumberOfWatchedEpisodes) && builder.AddLabel();
+    break;
+
+  case SortByTvShowStatus:
+    supported = builder.AddText(FieldTvShowStatus, false) && builder.AddLabel();
+    break;
+
+  case SortByTvShowTitle:
+    supported = builder.AddText(FieldTvShowTitle, false) && builder.AddLabel();
+    break;
+
+  default:
+    // no columns to sort by (stream details, files, ...) or nothing to sort by in SQL (random)
+    break;
+  }
+
+  if (!supported)
+    return false;
+
+  orderBy = builder.GetClause(sorting.sortOrder == SortOrderDescending);
+  return true;
+}
+
 int DatabaseUtils::GetField(Field field, const MediaType &mediaType, bool asIndex)
 {
   if (field == FieldNone || mediaType == MediaTypeNone)
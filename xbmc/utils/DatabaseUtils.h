@@ -137,6 +137,8 @@ typedef enum {
   DatabaseQueryPartOrderBy,
 } DatabaseQueryPart;
 
+struct SortDescription;
+
 typedef std::map<Field, CVariant> DatabaseResult;
 typedef std::vector<DatabaseResult> DatabaseResults;
 
@@ -155,6 +157,15 @@ public:
 
   static std::string BuildLimitClause(int end, int start = 0);
 
+  /*! \brief Build the ORDER BY clause sorting the rows of a library view the way SortUtils sorts their items.
+   \param sorting the sort method, order and attributes
+   \param mediaType the media type of the rows
+   \param collation the collation comparing text naturally (see dbiplus::Database::naturalCollation()), empty if the database has none
+   \param orderBy [out] the clause, without "ORDER BY"
+   \return false if the sort method can't be expressed in SQL for the media type, or it sorts by text and there's no collation
+   */
+  static bool BuildOrderByClause(const SortDescription &sorting, const MediaType &mediaType, const std::string &collation, std::string &orderBy);
+
 private:
   static int GetField(Field field, const MediaType &mediaType, bool asIndex);
 };
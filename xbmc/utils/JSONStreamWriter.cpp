@@ -0,0 +1,134 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <locale>
+
+#include "JSONStreamWriter.h"
+
+CJSONStreamWriter::CJSONStreamWriter(IJSONStreamOutput *output, bool compact, size_t chunkSize /* = 16 * 1024 */)
+  : m_output(output), m_chunkSize(chunkSize), m_written(0), m_failed(false)
+{
+#if YAJL_MAJOR == 2
+  m_gen = yajl_gen_alloc(NULL);
+  yajl_gen_config(m_gen, yajl_gen_beautify, compact ? 0 : 1);
+  yajl_gen_config(m_gen, yajl_gen_indent_string, "\t");
+#else
+  yajl_gen_config conf = { compact ? 0 : 1, "\t" };
+  m_gen = yajl_gen_alloc(&conf, NULL);
+#endif
+}
+
+CJSONStreamWriter::~CJSONStreamWriter()
+{
+  yajl_gen_clear(m_gen);
+  yajl_gen_free(m_gen);
+}
+
+void CJSONStreamWriter::OpenObject()
+{
+  if (!m_failed)
+    Check(yajl_gen_status_ok == yajl_gen_map_open(m_gen));
+}
+
+void CJSONStreamWriter::CloseObject()
+{
+  if (!m_failed)
+    Check(yajl_gen_status_ok == yajl_gen_map_close(m_gen));
+}
+
+void CJSONStreamWriter::OpenArray()
+{
+  if (!m_failed)
+    Check(yajl_gen_status_ok == yajl_gen_array_open(m_gen));
+}
+
+void CJSONStreamWriter::CloseArray()
+{
+  if (!m_failed)
+    Check(yajl_gen_status_ok == yajl_gen_array_close(m_gen));
+}
+
+void CJSONStreamWriter::WriteKey(const std::string &key)
+{
+  if (!m_failed)
+    Check(yajl_gen_status_ok == yajl_gen_string(m_gen, (const unsigned char*)key.c_str(), key.length()));
+}
+
+void CJSONStreamWriter::WriteValue(const CVariant &value)
+{
+  if (m_failed)
+    return;
+
+  // Set locale to classic ("C") to ensure valid JSON numbers
+  const char *currentLocale = setlocale(LC_NUMERIC, NULL);
+  if (currentLocale != NULL)
+    setlocale(LC_NUMERIC, "C");
+
+  bool success = CJSONVariantWriter::InternalWrite(m_gen, value);
+
+  // Re-set locale to what it was before using yajl
+  if (currentLocale != NULL)
+    setlocale(LC_NUMERIC, currentLocale);
+
+  Check(success);
+}
+
+bool CJSONStreamWriter::Flush()
+{
+  if (m_failed)
+    return false;
+
+  const unsigned char *buffer;
+#if YAJL_MAJOR == 2
+  size_t length;
+#else
+  unsigned int length;
+#endif
+  yajl_gen_get_buf(m_gen, &buffer, &length);
+  if (length == 0)
+    return true;
+
+  if (m_output == NULL || !m_output->Write((const char *)buffer, length))
+    m_failed = true;
+  else
+    m_written += length;
+
+  yajl_gen_clear(m_gen);
+  return !m_failed;
+}
+
+void CJSONStreamWriter::Check(bool success)
+{
+  if (!success)
+  {
+    m_failed = true;
+    return;
+  }
+
+  const unsigned char *buffer;
+#if YAJL_MAJOR == 2
+  size_t length;
+#else
+  unsigned int length;
+#endif
+  yajl_gen_get_buf(m_gen, &buffer, &length);
+  if (length >= m_chunkSize)
+    Flush();
+}
@@ -0,0 +1,107 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+
+#include "JSONVariantWriter.h"
+
+/*!
+ \brief Destination of the chunks written by CJSONStreamWriter
+ */
+class IJSONStreamOutput
+{
+public:
+  virtual ~IJSONStreamOutput() { }
+
+  /*!
+   \brief Takes the next chunk of the document
+   \return false if the destination is gone and writing should stop
+   */
+  virtual bool Write(const char *data, size_t size) = 0;
+};
+
+/*!
+ \brief Collects the written document in a string
+ */
+class CJSONStringOutput : public IJSONStreamOutput
+{
+public:
+  CJSONStringOutput(std::string &output) : m_output(output) { }
+
+  virtual bool Write(const char *data, size_t size) { m_output.append(data, size); return true; }
+
+private:
+  std::string &m_output;
+};
+
+/*!
+ \brief Writes a JSON document piece by piece
+
+ Unlike CJSONVariantWriter the document doesn't have to exist as a CVariant
+ first. Containers are opened and closed explicitly and the values in them
+ can be written one at a time, whenever more than a chunk of output has
+ gathered it's handed to the output.
+
+ Writing the same document through both writers gives the same text.
+ */
+class CJSONStreamWriter
+{
+public:
+  CJSONStreamWriter(IJSONStreamOutput *output, bool compact, size_t chunkSize = 16 * 1024);
+  ~CJSONStreamWriter();
+
+  void OpenObject();
+  void CloseObject();
+  void OpenArray();
+  void CloseArray();
+
+  /*!
+   \brief Writes the name of the next member of the current object
+   */
+  void WriteKey(const std::string &key);
+  void WriteValue(const CVariant &value);
+
+  /*!
+   \brief Hands what is left over to the output
+   \return false if anything failed to be written
+   */
+  bool Flush();
+
+  /*!
+   \return true once the output refused a chunk or the document was malformed,
+   anything written afterwards is dropped
+   */
+  bool Failed() const { return m_failed; }
+
+  /*!
+   \return Number of bytes handed to the output so far
+   */
+  size_t Written() const { return m_written; }
+
+private:
+  void Check(bool success);
+
+  yajl_gen m_gen;
+  IJSONStreamOutput *m_output;
+  size_t m_chunkSize;
+  size_t m_written;
+  bool m_failed;
+};
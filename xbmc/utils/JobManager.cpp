@@ -20,7 +20,9 @@
 
 #include "JobManager.h"
 #include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#include "threads/Atomics.h"
 #include "threads/SingleLock.h"
 #include "utils/log.h"
 
@@ -52,6 +54,29 @@ CJobWorker::~CJobWorker()
     StopThread();
 }
 
+bool CJobWorker::HasJobs(bool pausable) const
+{
+  CSingleLock lock(m_queueSection);
+  for (int priority = CJob::PRIORITY_HIGH; priority >= CJob::PRIORITY_LOW_PAUSABLE; --priority)
+  {
+    if (priority == CJob::PRIORITY_LOW_PAUSABLE && !pausable)
+      continue;
+    if (!m_jobQueue[priority].empty())
+      return true;
+  }
+  return false;
+}
+
+void CJobWorker::FreeJobs()
+{
+  CSingleLock lock(m_queueSection);
+  for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
+  {
+    for_each(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), mem_fun_ref(&CJobManager::CWorkItem::FreeJob));
+    m_jobQueue[priority].clear();
+  }
+}
+
 void CJobWorker::Process()
 {
   SetPriority( GetMinPriority() );
@@ -175,13 +200,15 @@ CJobManager &CJobManager::GetInstance()
 CJobManager::CJobManager()
 {
   m_jobCounter = 0;
+  m_nextWorker = 0;
+  m_maxWorkers = 5;
   m_running = true;
   m_pauseJobs = false;
 }
 
 void CJobManager::Restart()
 {
-  CSingleLock lock(m_section);
+  CExclusiveLock lock(m_workerSection);
 
   if (m_running)
     throw std::logic_error("CJobManager already running");
@@ -190,18 +217,18 @@ void CJobManager::Restart()
 
 void CJobManager::CancelJobs()
 {
-  CSingleLock lock(m_section);
+  CExclusiveLock lock(m_workerSection);
   m_running = false;
 
   // clear any pending jobs
-  for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
-  {
-    for_each(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), mem_fun_ref(&CWorkItem::FreeJob));
-    m_jobQueue[priority].clear();
-  }
+  for (Workers::iterator it = m_workers.begin(); it != m_workers.end(); ++it)
+    (*it)->FreeJobs();
 
   // cancel any callbacks on jobs still processing
-  for_each(m_processing.begin(), m_processing.end(), mem_fun_ref(&CWorkItem::Cancel));
+  {
+    CSingleLock processingLock(m_section);
+    for_each(m_processing.begin(), m_processing.end(), mem_fun_ref(&CWorkItem::Cancel));
+  }
 
   // tell our workers to finish
   while (m_workers.size())
@@ -219,83 +246,170 @@ CJobManager::~CJobManager()
 
 unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority)
 {
-  CSingleLock lock(m_section);
-
-  if (!m_running)
-    return 0;
-
   // increment the job counter, ensuring 0 (invalid job) is never hit
-  m_jobCounter++;
-  if (m_jobCounter == 0)
-    m_jobCounter++;
+  unsigned int id;
+  do
+  {
+    id = (unsigned int)AtomicIncrement(&m_jobCounter);
+  } while (id == 0);
 
   // create a work item for this job
-  CWorkItem work(job, m_jobCounter, priority, callback);
-  m_jobQueue[priority].push_back(work);
+  CWorkItem work(job, id, priority, callback);
+
+  bool queued = false;
+  {
+    CSharedLock lock(m_workerSection);
+    if (!m_running)
+      return 0;
+
+    if (!m_workers.empty())
+    {
+      CJobWorker *worker = GetQueueForThread();
+      CSingleLock queueLock(worker->m_queueSection);
+      worker->m_jobQueue[priority].push_back(work);
+      queued = true;
+    }
+    if (queued && !NeedsWorker(priority))
+      return work.m_id;
+  }
+
+  // everyone is busy - we need more workers
+  CExclusiveLock lock(m_workerSection);
+  if (!m_running)
+    return queued ? work.m_id : 0;
+  if (queued && !NeedsWorker(priority))
+    return work.m_id;
 
-  StartWorkers(priority);
+  CJobWorker *worker = new CJobWorker(this);
+  m_workers.push_back(worker);
+  if (!queued)
+  {
+    CSingleLock queueLock(worker->m_queueSection);
+    worker->m_jobQueue[priority].push_back(work);
+  }
   return work.m_id;
 }
 
 void CJobManager::CancelJob(unsigned int jobID)
 {
-  CSingleLock lock(m_section);
-
-  // check whether we have this job in the queue
-  for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
+  // check whether we have this job in one of the queues. Jobs move from a queue
+  // to the processing vector under the queue lock, so we can't miss them in between.
   {
-    JobQueue::iterator i = find(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), jobID);
-    if (i != m_jobQueue[priority].end())
+    CSharedLock lock(m_workerSection);
+    for (Workers::iterator it = m_workers.begin(); it != m_workers.end(); ++it)
     {
-      delete i->m_job;
-      m_jobQueue[priority].erase(i);
-      return;
+      CSingleLock queueLock((*it)->m_queueSection);
+      for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
+      {
+        JobQueue &queue = (*it)->m_jobQueue[priority];
+        JobQueue::iterator i = find(queue.begin(), queue.end(), jobID);
+        if (i != queue.end())
+        {
+          delete i->m_job;
+          queue.erase(i);
+          return;
+        }
+      }
     }
   }
   // or if we're processing it
+  CSingleLock lock(m_section);
   Processing::iterator it = find(m_processing.begin(), m_processing.end(), jobID);
   if (it != m_processing.end())
     it->m_callback = NULL; // job is in progress, so only thing to do is to remove callback
 }
 
-void CJobManager::StartWorkers(CJob::PRIORITY priority)
+bool CJobManager::NeedsWorker(CJob::PRIORITY priority)
 {
   CSingleLock lock(m_section);
 
   // check how many free threads we have
   if (m_processing.size() >= GetMaxWorkers(priority))
-    return;
+    return false;
 
   // do we have any sleeping threads?
   if (m_processing.size() < m_workers.size())
   {
     m_jobEvent.Set();
-    return;
+    return false;
   }
 
-  // everyone is busy - we need more workers
-  m_workers.push_back(new CJobWorker(this));
+  return true;
+}
+
+CJobWorker *CJobManager::GetQueueForThread()
+{
+  // jobs queued from within a job stay on the worker that queued them
+  for (Workers::iterator it = m_workers.begin(); it != m_workers.end(); ++it)
+  {
+    if ((*it)->IsCurrentThread())
+      return *it;
+  }
+  unsigned long next = (unsigned long)AtomicIncrement(&m_nextWorker);
+  return m_workers[next % m_workers.size()];
+}
+
+bool CJobManager::HasRunnableJobs() const
+{
+  bool pausable;
+  {
+    CSingleLock lock(m_section);
+    pausable = !m_pauseJobs;
+  }
+  for (Workers::const_iterator it = m_workers.begin(); it != m_workers.end(); ++it)
+  {
+    if ((*it)->HasJobs(pausable))
+      return true;
+  }
+  return false;
 }
 
-CJob *CJobManager::PopJob()
+CJob *CJobManager::PopJob(CJobWorker *queue, int priority, bool &blocked)
 {
+  blocked = false;
+  CSingleLock queueLock(queue->m_queueSection);
+  JobQueue &jobs = queue->m_jobQueue[priority];
+  if (jobs.empty())
+    return NULL;
+
   CSingleLock lock(m_section);
+  // Check whether we're pausing pausable jobs
+  if ((priority == CJob::PRIORITY_LOW_PAUSABLE && m_pauseJobs) ||
+      m_processing.size() >= GetMaxWorkers(CJob::PRIORITY(priority)))
+  {
+    blocked = true;
+    return NULL;
+  }
+
+  // pop the job off the queue
+  CWorkItem job = jobs.front();
+  jobs.pop_front();
+
+  // add to the processing vector
+  m_processing.push_back(job);
+  job.m_job->m_callback = this;
+  return job.m_job;
+}
+
+CJob *CJobManager::PopJob(CJobWorker *worker)
+{
+  CSharedLock lock(m_workerSection);
+
   for (int priority = CJob::PRIORITY_HIGH; priority >= CJob::PRIORITY_LOW_PAUSABLE; --priority)
   {
-    // Check whether we're pausing pausable jobs
-    if (priority == CJob::PRIORITY_LOW_PAUSABLE && m_pauseJobs)
-      continue;
+    // take from our own queue, and only steal from the others when it's empty
+    bool blocked;
+    CJob *job = PopJob(worker, priority, blocked);
+    if (job)
+      return job;
 
-    if (m_jobQueue[priority].size() && m_processing.size() < GetMaxWorkers(CJob::PRIORITY(priority)))
+    for (Workers::const_iterator it = m_workers.begin(); it != m_workers.end() && !blocked; ++it)
     {
-      // pop the job off the queue
-      CWorkItem job = m_jobQueue[priority].front();
-      m_jobQueue[priority].pop_front();
-
-      // add to the processing vector
-      m_processing.push_back(job);
-      job.m_job->m_callback = this;
-      return job.m_job;
+      if (*it == worker)
+        continue;
+      job = PopJob(*it, priority, blocked);
+      if (job)
+        return job;
     }
   }
   return NULL;
@@ -344,30 +458,53 @@ int CJobManager::IsProcessing(const std::string &type) const
   return jobsMatched;
 }
 
-CJob *CJobManager::GetNextJob(const CJobWorker *worker)
+CJob *CJobManager::GetNextJob(CJobWorker *worker)
 {
-  CSingleLock lock(m_section);
-  while (m_running)
+  while (true)
   {
-    // grab a job off the queue if we have one
-    CJob *job = PopJob();
-    if (job)
-      return job;
-    // no jobs are left - sleep for 30 seconds to allow new jobs to come in
-    lock.Leave();
-    bool newJob = m_jobEvent.WaitMSec(30000);
-    lock.Enter();
-    if (!newJob)
-      break;
+    if (m_running)
+    {
+      // grab a job off our queue, or someone else's, if we have one
+      CJob *job = PopJob(worker);
+      if (job)
+        return job;
+      // no jobs are left - sleep for 30 seconds to allow new jobs to come in
+      if (m_jobEvent.WaitMSec(30000))
+        continue;
+    }
+
+    // ensure no jobs have come in during the period after
+    // timeout and before we held the lock
+    CExclusiveLock lock(m_workerSection);
+    if (m_running && HasRunnableJobs())
+      continue;
+
+    if (m_running && worker->HasJobs(true))
+    {
+      // only paused jobs are left on our queue - hand them over, or stay around if we're the last one
+      if (m_workers.size() < 2)
+        continue;
+      CJobWorker *heir = m_workers.front() != worker ? m_workers.front() : m_workers.back();
+      CSingleLock queueLock(worker->m_queueSection);
+      CSingleLock heirLock(heir->m_queueSection);
+      for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
+      {
+        // keep the heir's queue in the order the jobs were added
+        JobQueue &jobs = worker->m_jobQueue[priority];
+        JobQueue &heirJobs = heir->m_jobQueue[priority];
+        JobQueue merged;
+        merge(heirJobs.begin(), heirJobs.end(), jobs.begin(), jobs.end(), back_inserter(merged));
+        heirJobs.swap(merged);
+        jobs.clear();
+      }
+    }
+
+    // have no jobs
+    Workers::iterator i = find(m_workers.begin(), m_workers.end(), worker);
+    if (i != m_workers.end())
+      m_workers.erase(i); // workers auto-delete
+    return NULL;
   }
-  // ensure no jobs have come in during the period after
-  // timeout and before we held the lock
-  CJob *job = PopJob();
-  if (job)
-    return job;
-  // have no jobs
-  RemoveWorker(worker);
-  return NULL;
 }
 
 bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
@@ -418,15 +555,21 @@ void CJobManager::OnJobComplete(bool success, CJob *job)
 
 void CJobManager::RemoveWorker(const CJobWorker *worker)
 {
-  CSingleLock lock(m_section);
+  CExclusiveLock lock(m_workerSection);
   // remove our worker
   Workers::iterator i = find(m_workers.begin(), m_workers.end(), worker);
   if (i != m_workers.end())
     m_workers.erase(i); // workers auto-delete
 }
 
+void CJobManager::SetMaxWorkers(unsigned int maxWorkers)
+{
+  CSingleLock lock(m_section);
+  m_maxWorkers = std::max(maxWorkers, 1u);
+}
+
 unsigned int CJobManager::GetMaxWorkers(CJob::PRIORITY priority) const
 {
-  static const unsigned int max_workers = 5;
-  return max_workers - (CJob::PRIORITY_HIGH - priority);
+  unsigned int reserved = CJob::PRIORITY_HIGH - priority;
+  return m_maxWorkers > reserved ? m_maxWorkers - reserved : 1;
 }
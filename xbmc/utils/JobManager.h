@@ -23,21 +23,12 @@
 #include <vector>
 #include <string>
 #include "threads/CriticalSection.h"
+#include "threads/SharedSection.h"
 #include "threads/Thread.h"
 #include "Job.h"
 
 class CJobManager;
-
-class CJobWorker : public CThread
-{
-public:
-  CJobWorker(CJobManager *manager);
-  virtual ~CJobWorker();
-
-  void Process();
-private:
-  CJobManager  *m_jobManager;
-};
+class CJobWorker;
 
 /*!
  \ingroup jobs
@@ -165,6 +156,12 @@ private:
  priority levels.  Lower priority jobs are executed only if there are sufficient
  spare worker threads free to allow for higher priority jobs that may arise.
 
+ Each worker owns a local queue per priority level.  Jobs added from a worker thread
+ are queued on that worker, other jobs are spread over the workers round-robin.  An idle
+ worker takes the highest priority job from its own queue, and only steals one from
+ another worker's queue when its own is empty.  Jobs queued on the same worker start in
+ the order they were added, jobs spread over several workers may start in any order.
+
  \sa CJob and IJobCallback
  */
 class CJobManager
@@ -187,6 +184,11 @@ class CJobManager
     {
       return m_job == job;
     };
+    /*! \brief Whether this job was added before the other, ids wrap around */
+    bool operator<(const CWorkItem &item) const
+    {
+      return (int)(m_id - item.m_id) < 0;
+    };
     void FreeJob()
     {
       delete m_job;
@@ -269,6 +271,14 @@ public:
    */
   bool IsProcessing(const CJob::PRIORITY &priority) const;
 
+  /*!
+   \brief Sets the number of workers that may process jobs at once.
+   Jobs of PRIORITY_HIGH may use all workers, each lower priority level gets one worker less
+   (but always at least one).  Defaults to 5.
+   \param maxWorkers the number of workers for PRIORITY_HIGH jobs.
+   */
+  void SetMaxWorkers(unsigned int maxWorkers);
+
 protected:
   friend class CJobWorker;
   friend class CJob;
@@ -278,7 +288,7 @@ protected:
    \param worker a pointer to the current CJobWorker instance requesting a job.
    \sa CJob
    */
-  CJob *GetNextJob(const CJobWorker *worker);
+  CJob *GetNextJob(CJobWorker *worker);
 
   /*!
    \brief Callback from CJobWorker after a job has completed.
@@ -307,27 +317,77 @@ private:
   CJobManager const& operator=(CJobManager const&);
   virtual ~CJobManager();
 
-  /*! \brief Pop a job off the job queue and add to the processing queue ready to process
+  /*! \brief Pop the highest priority job off the worker's own queue, or another worker's
+   queue if its own is empty, and add it to the processing queue ready to process
+   \param worker the worker requesting a job.
    \return the job to process, NULL if no jobs are available
    */
-  CJob *PopJob();
+  CJob *PopJob(CJobWorker *worker);
+
+  /*! \brief Pop a job of the given priority off a worker's queue and add to the processing queue.
+   Must be called with m_workerSection held.
+   \param queue the worker whose queue to pop from.
+   \param priority the priority level to pop.
+   \param blocked [out] true if no job of this priority is allowed to run now.
+   \return the job to process, NULL if there is none or it isn't allowed to run
+   */
+  CJob *PopJob(CJobWorker *queue, int priority, bool &blocked);
+
+  /*! \brief Check whether a new worker is needed to process a job of the given priority.
+   Wakes an idle worker instead if there is one. Must be called with m_workerSection held.
+   */
+  bool NeedsWorker(CJob::PRIORITY priority);
+
+  /*! \brief Pick the worker queue a new job should go to. Must be called with m_workerSection held.
+   */
+  CJobWorker *GetQueueForThread();
+
+  /*! \brief Check whether any worker has a job queued that may be run now.
+   Must be called with m_workerSection held.
+   */
+  bool HasRunnableJobs() const;
 
-  void StartWorkers(CJob::PRIORITY priority);
   void RemoveWorker(const CJobWorker *worker);
   unsigned int GetMaxWorkers(CJob::PRIORITY priority) const;
 
-  unsigned int m_jobCounter;
+  volatile long m_jobCounter;
+  volatile long m_nextWorker;
+  unsigned int  m_maxWorkers;
 
   typedef std::deque<CWorkItem>    JobQueue;
   typedef std::vector<CWorkItem>   Processing;
   typedef std::vector<CJobWorker*> Workers;
 
-  JobQueue   m_jobQueue[CJob::PRIORITY_HIGH+1];
   bool       m_pauseJobs;
   Processing m_processing;
   Workers    m_workers;
 
-  CCriticalSection m_section;
+  CCriticalSection m_section;       ///< guards m_processing and m_pauseJobs
+  CSharedSection   m_workerSection; ///< guards m_workers and m_running
   CEvent           m_jobEvent;
-  bool             m_running;
+  volatile bool    m_running;
+};
+
+class CJobWorker : public CThread
+{
+public:
+  CJobWorker(CJobManager *manager);
+  virtual ~CJobWorker();
+
+  void Process();
+private:
+  friend class CJobManager;
+
+  /*! \brief Check whether any jobs are queued on this worker.
+   \param pausable whether PRIORITY_LOW_PAUSABLE jobs should be counted.
+   */
+  bool HasJobs(bool pausable) const;
+
+  /*! \brief Delete all jobs queued on this worker. */
+  void FreeJobs();
+
+  CJobManager  *m_jobManager;
+
+  CCriticalSection      m_queueSection;
+  CJobManager::JobQueue m_jobQueue[CJob::PRIORITY_HIGH+1];
 };
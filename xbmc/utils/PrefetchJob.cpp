@@ -0,0 +1,62 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "PrefetchJob.h"
+#include "threads/SingleLock.h"
+
+CPrefetchRequest::CPrefetchRequest() : m_started(false), m_done(true)
+{
+}
+
+CPrefetchRequest::~CPrefetchRequest()
+{
+}
+
+bool CPrefetchRequest::Start()
+{
+  CSingleLock lock(m_section);
+  if (m_started)
+    return false;
+  m_started = true;
+  return true;
+}
+
+void CPrefetchRequest::Run()
+{
+  DoWork();
+  m_done.Set();
+}
+
+void CPrefetchRequest::Wait()
+{
+  m_done.Wait();
+}
+
+CPrefetchJob::CPrefetchJob(const PrefetchRequestPtr &request, const char *type)
+  : m_request(request), m_type(type)
+{
+}
+
+bool CPrefetchJob::DoWork()
+{
+  if (m_request->Start())
+    m_request->Run();
+  return true;
+}
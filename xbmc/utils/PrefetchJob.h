@@ -0,0 +1,91 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/shared_ptr.hpp>
+#include "Job.h"
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+
+/*!
+ \ingroup jobs
+ \brief Work that is done ahead of time on a job manager worker, or by the thread needing it.
+
+ A thread that knows what it will need next puts a CPrefetchJob for each request on a job
+ queue. When it needs the result it claims the request with Start(): if no worker got to
+ it yet the thread runs it itself, otherwise it waits for the worker with Wait(). A request
+ is run exactly once, so a thread never waits on a job that is still queued, and claiming
+ a request it doesn't need anymore turns its job into a no-op.
+
+ Derived classes implement DoWork() and keep its result.
+
+ \sa CPrefetchJob
+ */
+class CPrefetchRequest
+{
+public:
+  CPrefetchRequest();
+  virtual ~CPrefetchRequest();
+
+  /*! \brief Claim the request
+   \return false if a worker or the thread needing it claimed it before
+   */
+  bool Start();
+
+  /*! \brief Do the work of a request claimed with Start() */
+  void Run();
+
+  /*! \brief Wait until a request claimed by someone else is done */
+  void Wait();
+
+protected:
+  /*! \brief Do the work, on a worker or on the thread needing it */
+  virtual void DoWork() = 0;
+
+private:
+  CPrefetchRequest(const CPrefetchRequest&);
+  CPrefetchRequest& operator=(const CPrefetchRequest&);
+
+  CCriticalSection m_section;
+  bool             m_started;
+  CEvent           m_done;
+};
+
+typedef boost::shared_ptr<CPrefetchRequest> PrefetchRequestPtr;
+
+/*!
+ \ingroup jobs
+ \brief Job running a CPrefetchRequest unless it was claimed before.
+
+ The job holds on to its request, so it may outlive whoever queued it.
+ \sa CPrefetchRequest
+ */
+class CPrefetchJob : public CJob
+{
+public:
+  CPrefetchJob(const PrefetchRequestPtr &request, const char *type);
+
+  virtual bool DoWork();
+  virtual const char *GetType() const { return m_type; }
+
+private:
+  PrefetchRequestPtr m_request;
+  const char        *m_type;
+};
@@ -21,9 +21,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm> 
+#include <list>
+#include <map>
 #include "RegExp.h"
 #include "StdString.h"
 #include "log.h"
+#include "threads/CriticalSection.h"
+#include "threads/SingleLock.h"
 #include "utils/StringUtils.h"
 #include "utils/Utf8Utils.h"
 
@@ -52,6 +56,89 @@ int CRegExp::m_Utf8Supported = -1;
 int CRegExp::m_UcpSupported  = -1;
 int CRegExp::m_JitSupported  = -1;
 
+/* A compiled and studied expression. pcre only reads it while matching,
+   so it is shared by all CRegExp objects using the same expression. */
+class CRegExpCode
+{
+public:
+  CRegExpCode(pcre* re, pcre_extra* sd, bool jitCompiled) : m_re(re), m_sd(sd), m_jitCompiled(jitCompiled) {}
+  ~CRegExpCode()
+  {
+    pcre_free(m_re);
+    if (m_sd)
+      pcre_free_study(m_sd);
+  }
+
+  pcre*       m_re;
+  pcre_extra* m_sd;
+  bool        m_jitCompiled;
+
+private:
+  CRegExpCode(const CRegExpCode&);
+  CRegExpCode& operator=(const CRegExpCode&);
+};
+
+typedef boost::shared_ptr<CRegExpCode> RegExpCodePtr;
+
+/* The least recently used compiled expressions by expression, options and study mode */
+class CRegExpCache
+{
+public:
+  CRegExpCache() : m_size(500) {}
+
+  RegExpCodePtr Get(const std::string& key)
+  {
+    CSingleLock lock(m_section);
+    Index::iterator it = m_index.find(key);
+    if (it == m_index.end())
+      return RegExpCodePtr();
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->second;
+  }
+
+  void Add(const std::string& key, const RegExpCodePtr& code)
+  {
+    CSingleLock lock(m_section);
+    if (m_size == 0 || m_index.find(key) != m_index.end())
+      return;
+    m_lru.push_front(std::make_pair(key, code));
+    m_index[key] = m_lru.begin();
+    Trim();
+  }
+
+  void SetSize(unsigned int size)
+  {
+    CSingleLock lock(m_section);
+    m_size = size;
+    Trim();
+  }
+
+private:
+  typedef std::list<std::pair<std::string, RegExpCodePtr> > LRUList;
+  typedef std::map<std::string, LRUList::iterator> Index;
+
+  void Trim()
+  {
+    // objects still using an evicted expression keep it alive
+    while (m_index.size() > m_size)
+    {
+      m_index.erase(m_lru.back().first);
+      m_lru.pop_back();
+    }
+  }
+
+  CCriticalSection m_section;
+  LRUList          m_lru; // most recently used first
+  Index            m_index;
+  unsigned int     m_size;
+};
+
+static CRegExpCache& GetCache()
+{
+  static CRegExpCache cache;
+  return cache;
+}
+
 
 CRegExp::CRegExp(bool caseless /*= false*/, CRegExp::utf8Mode utf8 /*= asciiOnly*/)
 {
@@ -78,7 +165,6 @@ void CRegExp::InitValues(bool caseless /*= false*/, CRegExp::utf8Mode utf8 /*= a
   m_jitCompiled = false;
   m_bMatched    = false;
   m_iMatchCount = 0;
-  m_jitStack    = NULL;
 
   memset(m_iOvector, 0, sizeof(m_iOvector));
 }
@@ -237,7 +323,6 @@ CRegExp::CRegExp(const CRegExp& re)
 {
   m_re = NULL;
   m_sd = NULL;
-  m_jitStack = NULL;
   m_utf8Mode = re.m_utf8Mode;
   m_iOptions = re.m_iOptions;
   *this = re;
@@ -245,28 +330,22 @@ CRegExp::CRegExp(const CRegExp& re)
 
 const CRegExp& CRegExp::operator=(const CRegExp& re)
 {
-  size_t size;
+  if (this == &re)
+    return *this;
+
+  // the compiled expression is shared, not copied
   Cleanup();
-  m_jitCompiled = false;
+  m_code = re.m_code;
+  m_re = re.m_re;
+  m_sd = re.m_sd;
+  m_jitCompiled = re.m_jitCompiled;
   m_pattern = re.m_pattern;
-  if (re.m_re)
-  {
-    if (pcre_fullinfo(re.m_re, NULL, PCRE_INFO_SIZE, &size) >= 0)
-    {
-      if ((m_re = (pcre*)malloc(size)))
-      {
-        memcpy(m_re, re.m_re, size);
-        memcpy(m_iOvector, re.m_iOvector, OVECCOUNT*sizeof(int));
-        m_offset = re.m_offset;
-        m_iMatchCount = re.m_iMatchCount;
-        m_bMatched = re.m_bMatched;
-        m_subject = re.m_subject;
-        m_iOptions = re.m_iOptions;
-      }
-      else
-        CLog::Log(LOGSEVERE, "%s: Failed to allocate memory", __FUNCTION__);
-    }
-  }
+  memcpy(m_iOvector, re.m_iOvector, OVECCOUNT*sizeof(int));
+  m_offset = re.m_offset;
+  m_iMatchCount = re.m_iMatchCount;
+  m_bMatched = re.m_bMatched;
+  m_subject = re.m_subject;
+  m_iOptions = re.m_iOptions;
   return *this;
 }
 
@@ -275,7 +354,7 @@ CRegExp::~CRegExp()
   Cleanup();
 }
 
-bool CRegExp::RegComp(const char *re, studyMode study /*= NoStudy*/)
+bool CRegExp::RegComp(const char *re, studyMode study /*= NoStudy*/, cacheMode cache /*= UseCache*/)
 {
   if (!re)
     return false;
@@ -292,39 +371,58 @@ bool CRegExp::RegComp(const char *re, studyMode study /*= NoStudy*/)
 
   Cleanup();
 
-  m_re = pcre_compile(re, options, &errMsg, &errOffset, NULL);
-  if (!m_re)
+  // the expression goes last so the options can't be mistaken for a part of it
+  std::string key;
+  if (cache == UseCache)
   {
-    m_pattern.clear();
-    CLog::Log(LOGERROR, "PCRE: %s. Compilation failed at offset %d in expression '%s'",
-              errMsg, errOffset, re);
-    return false;
+    key = StringUtils::Format("%x:%d:", options, (int)study) + re;
+    m_code = GetCache().Get(key);
   }
-
-  m_pattern = re;
-
-  if (study)
+  if (!m_code)
   {
-    const bool jitCompile = (study == StudyWithJitComp) && IsJitSupported();
-    const int studyOptions = jitCompile ? PCRE_STUDY_JIT_COMPILE : 0;
+    pcre* compiled = pcre_compile(re, options, &errMsg, &errOffset, NULL);
+    if (!compiled)
+    {
+      m_pattern.clear();
+      CLog::Log(LOGERROR, "PCRE: %s. Compilation failed at offset %d in expression '%s'",
+                errMsg, errOffset, re);
+      return false;
+    }
 
-    m_sd = pcre_study(m_re, studyOptions, &errMsg);
-    if (errMsg != NULL)
+    pcre_extra* studied = NULL;
+    bool jitCompiled = false;
+    if (study)
     {
-      CLog::Log(LOGWARNING, "%s: PCRE error \"%s\" while studying expression", __FUNCTION__, errMsg);
-      if (m_sd != NULL)
+      const bool jitCompile = (study == StudyWithJitComp) && IsJitSupported();
+      const int studyOptions = jitCompile ? PCRE_STUDY_JIT_COMPILE : 0;
+
+      studied = pcre_study(compiled, studyOptions, &errMsg);
+      if (errMsg != NULL)
       {
-        pcre_free_study(m_sd);
-        m_sd = NULL;
+        CLog::Log(LOGWARNING, "%s: PCRE error \"%s\" while studying expression", __FUNCTION__, errMsg);
+        if (studied != NULL)
+        {
+          pcre_free_study(studied);
+          studied = NULL;
+        }
+      }
+      else if (jitCompile)
+      {
+        int jitPresent = 0;
+        jitCompiled = (pcre_fullinfo(compiled, studied, PCRE_INFO_JIT, &jitPresent) == 0 && jitPresent == 1);
       }
     }
-    else if (jitCompile)
-    {
-      int jitPresent = 0;
-      m_jitCompiled = (pcre_fullinfo(m_re, m_sd, PCRE_INFO_JIT, &jitPresent) == 0 && jitPresent == 1);
-    }
+
+    m_code.reset(new CRegExpCode(compiled, studied, jitCompiled));
+    if (cache == UseCache)
+      GetCache().Add(key, m_code);
   }
 
+  m_re = m_code->m_re;
+  m_sd = m_code->m_sd;
+  m_jitCompiled = m_code->m_jitCompiled;
+  m_pattern = re;
+
   return true;
 }
 
@@ -357,22 +455,22 @@ int CRegExp::PrivateRegFind(size_t bufferLen, const char *str, unsigned int star
     return -1;
   }
 
-#ifdef PCRE_HAS_JIT_CODE
-  if (m_jitCompiled && !m_jitStack)
-  {
-    m_jitStack = pcre_jit_stack_alloc(32*1024, 512*1024);
-    if (m_jitStack == NULL)
-      CLog::Log(LOGWARNING, "%s: can't allocate address space for JIT stack", __FUNCTION__);
-
-    pcre_assign_jit_stack(m_sd, NULL, m_jitStack);
-  }
-#endif
-
   if (maxNumberOfCharsToTest >= 0)
     bufferLen = std::min<size_t>(bufferLen, startoffset + maxNumberOfCharsToTest);
 
   m_subject.assign(str + startoffset, bufferLen - startoffset);
-  int rc = pcre_exec(m_re, NULL, m_subject.c_str(), m_subject.length(), 0, 0, m_iOvector, OVECCOUNT);
+  int rc = pcre_exec(m_re, m_sd, m_subject.c_str(), m_subject.length(), 0, 0, m_iOvector, OVECCOUNT);
+
+#if defined(PCRE_HAS_JIT_CODE) && defined(PCRE_ERROR_JIT_STACKLIMIT)
+  if (rc == PCRE_ERROR_JIT_STACKLIMIT && m_jitCompiled)
+  {
+    // the JIT code is shared between threads and can't be given a bigger
+    // stack of its own, use the interpreter for this subject instead
+    pcre_extra extra = *m_sd;
+    extra.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+    rc = pcre_exec(m_re, &extra, m_subject.c_str(), m_subject.length(), 0, 0, m_iOvector, OVECCOUNT);
+  }
+#endif
 
   if (rc<1)
   {
@@ -558,25 +656,9 @@ void CRegExp::DumpOvector(int iLog /* = LOGDEBUG */)
 
 void CRegExp::Cleanup()
 {
-  if (m_re)
-  {
-    pcre_free(m_re); 
-    m_re = NULL; 
-  }
-
-  if (m_sd)
-  {
-    pcre_free_study(m_sd);
-    m_sd = NULL;
-  }
-
-#ifdef PCRE_HAS_JIT_CODE
-  if (m_jitStack)
-  {
-    pcre_jit_stack_free(m_jitStack);
-    m_jitStack = NULL;
-  }
-#endif
+  m_code.reset();
+  m_re = NULL;
+  m_sd = NULL;
 }
 
 inline bool CRegExp::IsValidSubNumber(int iSub) const
@@ -636,6 +718,11 @@ bool CRegExp::LogCheckUtf8Support(void)
   return utf8FullSupport;
 }
 
+void CRegExp::SetCacheSize(unsigned int size)
+{
+  GetCache().SetSize(size);
+}
+
 bool CRegExp::IsJitSupported(void)
 {
   if (m_JitSupported == -1)
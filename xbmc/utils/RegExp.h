@@ -24,10 +24,9 @@
 
 #include <string>
 #include <vector>
+#include <boost/shared_ptr.hpp>
 
 namespace PCRE {
-struct real_pcre_jit_stack; // forward declaration for PCRE without JIT
-typedef struct real_pcre_jit_stack pcre_jit_stack;
 #ifdef TARGET_WINDOWS
 #define PCRE_STATIC 1
 #ifdef _DEBUG
@@ -39,6 +38,18 @@ typedef struct real_pcre_jit_stack pcre_jit_stack;
 #include <pcre.h>
 }
 
+class CRegExpCode;
+
+/**
+ * PCRE regular expression.
+ *
+ * Compiled expressions are kept in a process wide cache keyed by the
+ * expression, its options and the study mode, so compiling an expression
+ * that was compiled before, by any thread, only costs a lookup. Expressions
+ * built at run time that are unlikely to be seen again are compiled with
+ * NoCache, so they don't push the others out. A CRegExp object itself must
+ * not be used by several threads at once.
+ */
 class CRegExp
 {
 public:
@@ -55,6 +66,11 @@ public:
     asciiOnly =  0, // process regexp and strings as single-byte encoded strings
     forceUtf8 =  1  // enable UTF-8 mode (with Unicode properties)
   };
+  enum cacheMode
+  {
+    UseCache = 0, // share the compiled expression through the process wide cache
+    NoCache  = 1  // compile the expression for this object only
+  };
 
   static const int m_MaxNumOfBackrefrences = 20;
   /**
@@ -83,19 +99,21 @@ public:
    * @param re          The regular expression
    * @param study (optional) Controls study of expression, useful if expression will be used 
    *                         several times
+   * @param cache (optional) Whether the compiled expression is shared through the cache
    * @return true on success, false on any error
    */
-  bool RegComp(const char *re, studyMode study = NoStudy);
+  bool RegComp(const char *re, studyMode study = NoStudy, cacheMode cache = UseCache);
 
   /**
    * Compile (prepare) regular expression
    * @param re          The regular expression
    * @param study (optional) Controls study of expression, useful if expression will be used
    *                         several times
+   * @param cache (optional) Whether the compiled expression is shared through the cache
    * @return true on success, false on any error
    */
-  bool RegComp(const std::string& re, studyMode study = NoStudy)
-  { return RegComp(re.c_str(), study); }
+  bool RegComp(const std::string& re, studyMode study = NoStudy, cacheMode cache = UseCache)
+  { return RegComp(re.c_str(), study, cache); }
 
   /**
    * Find first match of regular expression in given string
@@ -147,6 +165,11 @@ public:
   static bool AreUnicodePropertiesSupported(void);
   static bool LogCheckUtf8Support(void);
   static bool IsJitSupported(void);
+  /**
+   * Set how many compiled expressions are kept for reuse
+   * @param size Maximum number of cached expressions, 0 disables the cache
+   */
+  static void SetCacheSize(unsigned int size);
 
 private:
   int PrivateRegFind(size_t bufferLen, const char *str, unsigned int startoffset = 0, int maxNumberOfCharsToTest = -1);
@@ -158,6 +181,7 @@ private:
   void Cleanup();
   inline bool IsValidSubNumber(int iSub) const;
 
+  boost::shared_ptr<CRegExpCode> m_code; // owns m_re and m_sd
   PCRE::pcre* m_re;
   PCRE::pcre_extra* m_sd;
   static const int OVECCOUNT=(m_MaxNumOfBackrefrences + 1) * 3;
@@ -168,7 +192,6 @@ private:
   int         m_iOptions;
   bool        m_jitCompiled;
   bool        m_bMatched;
-  PCRE::pcre_jit_stack* m_jitStack;
   std::string m_subject;
   std::string m_pattern;
   static int  m_Utf8Supported;
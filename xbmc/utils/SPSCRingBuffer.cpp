@@ -0,0 +1,168 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SPSCRingBuffer.h"
+#include "threads/Atomics.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+CSPSCRingBuffer::CSPSCRingBuffer()
+{
+  m_buffer = NULL;
+  m_size = 0;
+  m_writePos = 0;
+  m_readPos = 0;
+}
+
+CSPSCRingBuffer::~CSPSCRingBuffer()
+{
+  Destroy();
+}
+
+bool CSPSCRingBuffer::Create(unsigned int size)
+{
+  Destroy();
+  // the positions have to fit twice the size
+  if (size == 0 || size > 0x3fffffff)
+    return false;
+  m_buffer = (char*)malloc(size);
+  if (m_buffer == NULL)
+    return false;
+  m_size = size;
+  return true;
+}
+
+void CSPSCRingBuffer::Destroy()
+{
+  free(m_buffer);
+  m_buffer = NULL;
+  m_size = 0;
+  m_writePos = 0;
+  m_readPos = 0;
+}
+
+void CSPSCRingBuffer::Clear()
+{
+  m_writePos = 0;
+  m_readPos = 0;
+}
+
+bool CSPSCRingBuffer::ReadData(char *buf, unsigned int size)
+{
+  Span spans[2];
+  if (PeekRead(spans) < size)
+    return false;
+
+  unsigned int first = std::min(size, spans[0].size);
+  memcpy(buf, spans[0].data, first);
+  memcpy(buf + first, spans[1].data, size - first);
+  CommitRead(size);
+  return true;
+}
+
+bool CSPSCRingBuffer::SkipBytes(unsigned int size)
+{
+  if (getMaxReadSize() < size)
+    return false;
+  CommitRead(size);
+  return true;
+}
+
+unsigned int CSPSCRingBuffer::PeekRead(Span spans[2])
+{
+  long readPos = m_readPos;
+  unsigned int size = Fill(AtomicLoadAcquire(&m_writePos), readPos);
+  GetSpans(readPos, size, spans);
+  return size;
+}
+
+void CSPSCRingBuffer::CommitRead(unsigned int size)
+{
+  AtomicStoreRelease(&m_readPos, Advance(m_readPos, size));
+}
+
+bool CSPSCRingBuffer::WriteData(const char *buf, unsigned int size)
+{
+  Span spans[2];
+  if (PeekWrite(spans) < size)
+    return false;
+
+  unsigned int first = std::min(size, spans[0].size);
+  memcpy(spans[0].data, buf, first);
+  memcpy(spans[1].data, buf + first, size - first);
+  CommitWrite(size);
+  return true;
+}
+
+unsigned int CSPSCRingBuffer::PeekWrite(Span spans[2])
+{
+  long writePos = m_writePos;
+  unsigned int size = m_size - Fill(writePos, AtomicLoadAcquire(&m_readPos));
+  GetSpans(writePos, size, spans);
+  return size;
+}
+
+void CSPSCRingBuffer::CommitWrite(unsigned int size)
+{
+  AtomicStoreRelease(&m_writePos, Advance(m_writePos, size));
+}
+
+unsigned int CSPSCRingBuffer::getSize()
+{
+  return m_size;
+}
+
+unsigned int CSPSCRingBuffer::getMaxReadSize()
+{
+  return Fill(AtomicLoadAcquire(&m_writePos), AtomicLoadAcquire(&m_readPos));
+}
+
+unsigned int CSPSCRingBuffer::getMaxWriteSize()
+{
+  return m_size - getMaxReadSize();
+}
+
+unsigned int CSPSCRingBuffer::Fill(long writePos, long readPos) const
+{
+  long fill = writePos - readPos;
+  if (fill < 0)
+    fill += 2 * (long)m_size;
+  return (unsigned int)fill;
+}
+
+void CSPSCRingBuffer::GetSpans(long pos, unsigned int size, Span spans[2]) const
+{
+  unsigned int index = (unsigned int)(pos < (long)m_size ? pos : pos - m_size);
+  unsigned int first = std::min(size, m_size - index);
+  spans[0].data = m_buffer + index;
+  spans[0].size = first;
+  spans[1].data = m_buffer;
+  spans[1].size = size - first;
+}
+
+long CSPSCRingBuffer::Advance(long pos, unsigned int size) const
+{
+  pos += size;
+  if (pos >= 2 * (long)m_size)
+    pos -= 2 * (long)m_size;
+  return pos;
+}
@@ -0,0 +1,109 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define SPSC_CACHE_LINE_SIZE 64
+
+/*!
+ \brief Lock-free ring buffer for one producer and one consumer thread.
+
+ The producer only moves the write position and the consumer only moves the
+ read position, each published with release semantics, so neither side ever
+ blocks the other. The positions live on cache lines of their own.
+
+ Besides the copying ReadData/WriteData the buffer hands out the contiguous
+ parts of its readable or writable space through PeekRead/PeekWrite, so data
+ can be produced into or consumed from the buffer in place and then committed.
+
+ Create, Destroy and Clear must not run concurrently with anything else.
+ */
+class CSPSCRingBuffer
+{
+public:
+  /*! \brief A contiguous part of the buffer, see PeekRead and PeekWrite. */
+  struct Span
+  {
+    char         *data;
+    unsigned int  size;
+  };
+
+  CSPSCRingBuffer();
+  ~CSPSCRingBuffer();
+
+  bool Create(unsigned int size);
+  void Destroy();
+  void Clear();
+
+  /*! \brief Copy size bytes out of the buffer. Consumer only.
+   \return false if less than size bytes are available, nothing is read then.
+   */
+  bool ReadData(char *buf, unsigned int size);
+
+  /*! \brief Drop size bytes from the buffer. Consumer only. */
+  bool SkipBytes(unsigned int size);
+
+  /*! \brief Get the readable data without consuming it. Consumer only.
+   \param spans receives the readable data, the second span holds what wrapped
+   around to the start of the buffer and is empty if nothing did.
+   \return the total size of the spans.
+   \sa CommitRead
+   */
+  unsigned int PeekRead(Span spans[2]);
+
+  /*! \brief Release size bytes of the data returned by PeekRead to the producer. */
+  void CommitRead(unsigned int size);
+
+  /*! \brief Copy size bytes into the buffer. Producer only.
+   \return false if there is not enough space for size bytes, nothing is written then.
+   */
+  bool WriteData(const char *buf, unsigned int size);
+
+  /*! \brief Get the writable space of the buffer. Producer only.
+   \param spans receives the free space, the second span is the part at the
+   start of the buffer and is empty if the free space doesn't wrap.
+   \return the total size of the spans.
+   \sa CommitWrite
+   */
+  unsigned int PeekWrite(Span spans[2]);
+
+  /*! \brief Publish size bytes written to the spans returned by PeekWrite to the consumer. */
+  void CommitWrite(unsigned int size);
+
+  unsigned int getSize();
+  unsigned int getMaxReadSize();
+  unsigned int getMaxWriteSize();
+
+private:
+  CSPSCRingBuffer(const CSPSCRingBuffer&);
+  CSPSCRingBuffer& operator=(const CSPSCRingBuffer&);
+
+  unsigned int Fill(long writePos, long readPos) const;
+  void GetSpans(long pos, unsigned int size, Span spans[2]) const;
+  long Advance(long pos, unsigned int size) const;
+
+  char          *m_buffer;
+  unsigned int   m_size;
+  char           m_pad0[SPSC_CACHE_LINE_SIZE];
+  // positions run from 0 to 2 * m_size, so a full buffer can be told from an empty one
+  volatile long  m_writePos;
+  char           m_pad1[SPSC_CACHE_LINE_SIZE - sizeof(long)];
+  volatile long  m_readPos;
+  char           m_pad2[SPSC_CACHE_LINE_SIZE - sizeof(long)];
+};
@@ -225,7 +225,8 @@ void CScraperParser::ParseExpression(const CStdString& input, CStdString& dest,
     ReplaceBuffers(strExpression);
     ReplaceBuffers(strOutput);
 
-    if (!reg.RegComp(strExpression.c_str()))
+    // the buffers are part of the expression, so it's rarely the same twice
+    if (!reg.RegComp(strExpression.c_str(), CRegExp::NoStudy, CRegExp::NoCache))
     {
       return;
     }
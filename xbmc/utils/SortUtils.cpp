@@ -18,229 +18,704 @@
  *
  */
 
+#include <algorithm>
+#include <locale>
+#include <stdio.h>
+#include <string.h>
+
 #include "SortUtils.h"
 #include "URL.h"
 #include "Util.h"
 #include "XBDateTime.h"
 #include "settings/AdvancedSettings.h"
-#include "utils/CharsetConverter.h"
+#include "threads/Atomics.h"
+#include "threads/Event.h"
+#include "utils/CPUInfo.h"
+#include "utils/JobManager.h"
 #include "utils/StdString.h"
 #include "utils/StringUtils.h"
 #include "utils/Variant.h"
 
 using namespace std;
 
-string ArrayToString(SortAttribute attributes, const CVariant &variant, const string &seperator = " / ")
+#define SORT_PARALLEL_THRESHOLD 20000 // smaller lists are sorted on the calling thread
+#define SORT_PARALLEL_MIN_RUN    5000 // minimum number of items sorted by one thread
+
+static unsigned int SortThreads = 0; // threads large lists are sorted with, 0 for one per CPU
+
+/*! \brief Typed sort keys for all items of a list.
+
+ Every item is described by a chain of key parts which are compared one after
+ the other. Numbers, reals and dates are compared by value. Text parts are
+ decoded into one character pool per list and mapped onto the collation order
+ of the current locale once, so comparing two items neither allocates nor calls
+ into the locale. Text (and parts of different kinds) is compared like
+ StringUtils::AlphaNumericCompare() compares the formatted sort labels.
+ */
+class CSortKeys
+{
+public:
+  void Reserve(size_t items)
+  {
+    m_items.reserve(items + 1);
+    m_parts.reserve(items * 2);
+    m_chars.reserve(items * 32);
+  }
+
+  void BeginItem()
+  {
+    m_items.push_back(m_parts.size());
+  }
+
+  void AddInteger(int64_t value)
+  {
+    Part part = { PartInteger, 0, 0, value, 0.0 };
+    m_parts.push_back(part);
+  }
+
+  void AddReal(double value)
+  {
+    Part part = { PartReal, 0, 0, 0, value };
+    m_parts.push_back(part);
+  }
+
+  /*! \brief Add a database date ("YYYY-MM-DD" optionally followed by the time).
+   Anything that doesn't look like a date is added as text instead.
+   */
+  void AddDate(const CVariant &date)
+  {
+    if (date.isString())
+    {
+      int64_t value;
+      const char *str = date.c_str();
+      if (ParseDate(str, value))
+      {
+        Part part = { PartDate, m_chars.size(), 0, value, 0.0 };
+        m_parts.push_back(part);
+        AppendText(str, strlen(str));
+        return;
+      }
+    }
+
+    AddText(date);
+  }
+
+  /*! \brief Add a text part, optionally without a leading article.
+   */
+  void AddText(const CVariant &text, bool ignoreArticle = false)
+  {
+    BeginText();
+    AppendText(text, ignoreArticle);
+  }
+
+  /*! \brief Add all the entries of an array joined by " / " as one text part.
+   */
+  void AddArray(const CVariant &variant, bool ignoreArticle)
+  {
+    BeginText();
+    if (variant.isArray())
+    {
+      for (CVariant::const_iterator_array it = variant.begin_array(); it != variant.end_array(); it++)
+      {
+        if (it != variant.begin_array())
+          AppendText(" / ", 3);
+        AppendText(*it, ignoreArticle);
+      }
+    }
+    else if (variant.isString())
+      AppendText(variant, ignoreArticle);
+  }
+
+  /*! \brief Map all the collected characters onto their collation ranks.
+   Must be called once after the keys of all items have been added.
+   */
+  void Collate();
+
+  /*! \brief Compare the keys of two items.
+   \return negative if left < right, positive if left > right, 0 if equal
+   */
+  int Compare(size_t left, size_t right) const
+  {
+    size_t l = m_items[left], lEnd = m_items[left + 1];
+    size_t r = m_items[right], rEnd = m_items[right + 1];
+    for (; l < lEnd && r < rEnd; l++, r++)
+    {
+      int result = ComparePart(m_parts[l], m_parts[r]);
+      if (result != 0)
+        return result;
+    }
+
+    if (r < rEnd)
+      return -1;
+    if (l < lEnd)
+      return 1;
+    return 0;
+  }
+
+  /*! \brief Render the key of an item as a label, parts separated by a space.
+   */
+  std::wstring GetLabel(size_t item) const;
+
+  static bool ParseDate(const char *str, int64_t &value);
+  static size_t GetArticleLength(const char *label, size_t length);
+
+private:
+  typedef enum
+  {
+    PartInteger,
+    PartReal,
+    PartDate,
+    PartText
+  } PartType;
+
+  typedef struct
+  {
+    PartType type;
+    size_t   offset;   // characters in the pool (text and dates)
+    size_t   length;
+    int64_t  integer;  // integers and dates as YYYYMMDDhhmmss
+    double   real;
+  } Part;
+
+  void BeginText()
+  {
+    Part part = { PartText, m_chars.size(), 0, 0, 0.0 };
+    m_parts.push_back(part);
+  }
+
+  void AppendText(const CVariant &text, bool ignoreArticle)
+  {
+    if (text.isString())
+    {
+      const char *str = text.c_str();
+      size_t length = strlen(str);
+      size_t skip = ignoreArticle ? GetArticleLength(str, length) : 0;
+      AppendText(str + skip, length - skip);
+    }
+    else if (!text.isNull())
+    {
+      std::string str = text.asString();
+      size_t skip = ignoreArticle ? GetArticleLength(str.c_str(), str.size()) : 0;
+      AppendText(str.c_str() + skip, str.size() - skip);
+    }
+  }
+
+  void AppendText(const char *utf8, size_t length);
+
+  static int CompareText(const wchar_t *left, const uint32_t *leftRanks, size_t leftLength,
+                         const wchar_t *right, const uint32_t *rightRanks, size_t rightLength);
+  int ComparePart(const Part &left, const Part &right) const;
+  size_t RenderNumber(const Part &part, wchar_t *chars, uint32_t *ranks, size_t size) const;
+  static size_t FormatNumber(const Part &part, char *buffer, size_t size);
+
+  std::vector<size_t> m_items;
+  std::vector<Part> m_parts;
+  std::vector<wchar_t> m_chars;
+  std::vector<uint32_t> m_ranks;
+  uint32_t m_asciiRanks[128];
+};
+
+bool CSortKeys::ParseDate(const char *str, int64_t &value)
 {
-  vector<string> strArray;
-  if (variant.isArray())
+  static const char layout[] = "dddd-dd-dd dd:dd:dd";
+
+  int64_t result = 0;
+  size_t i = 0;
+  for (; layout[i] != 0; i++)
   {
-    for (CVariant::const_iterator_array it = variant.begin_array(); it != variant.end_array(); it++)
+    if (layout[i] == 'd')
     {
-      if (attributes & SortAttributeIgnoreArticle)
-        strArray.push_back(SortUtils::RemoveArticles(it->asString()));
+      if (str[i] < '0' || str[i] > '9')
+        break;
+      result = result * 10 + (str[i] - '0');
+    }
+    else if (str[i] != layout[i] && !(layout[i] == ' ' && str[i] == 'T'))
+      break;
+  }
+
+  if (str[i] != 0 || (i != 10 && i != 19))
+    return false;
+
+  if (i == 10)
+    result *= 1000000;
+  value = result;
+  return true;
+}
+
+size_t CSortKeys::GetArticleLength(const char *label, size_t length)
+{
+  for (unsigned int i = 0; i < g_advancedSettings.m_vecTokens.size(); ++i)
+  {
+    if (g_advancedSettings.m_vecTokens[i].size() < length &&
+        strnicmp(g_advancedSettings.m_vecTokens[i].c_str(), label, g_advancedSettings.m_vecTokens[i].size()) == 0)
+      return g_advancedSettings.m_vecTokens[i].size();
+  }
+
+  return 0;
+}
+
+void CSortKeys::AppendText(const char *utf8, size_t length)
+{
+  const unsigned char *str = (const unsigned char *)utf8;
+  const unsigned char *end = str + length;
+  while (str < end)
+  {
+    uint32_t c = *str++;
+    if (c >= 0x80)
+    {
+      int trailing;
+      if ((c & 0xE0) == 0xC0)
+      {
+        c &= 0x1F;
+        trailing = 1;
+      }
+      else if ((c & 0xF0) == 0xE0)
+      {
+        c &= 0x0F;
+        trailing = 2;
+      }
+      else if ((c & 0xF8) == 0xF0)
+      {
+        c &= 0x07;
+        trailing = 3;
+      }
       else
-        strArray.push_back(it->asString());
+        continue; // skip invalid bytes
+
+      for (; trailing > 0 && str < end && (*str & 0xC0) == 0x80; trailing--)
+        c = (c << 6) | (*str++ & 0x3F);
+      if (trailing > 0)
+        continue;
+
+      if (sizeof(wchar_t) == 2 && c > 0xFFFF)
+      {
+        c -= 0x10000;
+        m_chars.push_back((wchar_t)(0xD800 + (c >> 10)));
+        c = 0xDC00 + (c & 0x3FF);
+      }
+    }
+    m_chars.push_back((wchar_t)c);
+  }
+
+  m_parts.back().length = m_chars.size() - m_parts.back().offset;
+}
+
+namespace
+{
+  inline wchar_t FoldCase(wchar_t c)
+  {
+    if (c >= L'A' && c <= L'Z')
+      c += L'a' - L'A';
+    return c;
+  }
+
+  class CollateLess
+  {
+  public:
+    CollateLess(const collate<wchar_t> &coll) : m_coll(coll) { }
+
+    bool operator()(const wchar_t &left, const wchar_t &right) const
+    {
+      return m_coll.compare(&left, &left + 1, &right, &right + 1) < 0;
     }
 
-    return StringUtils::Join(strArray, seperator);
+  private:
+    const collate<wchar_t> &m_coll;
+  };
+}
+
+void CSortKeys::Collate()
+{
+  m_items.push_back(m_parts.size());
+
+  // collect every distinct character, ASCII is tracked in a table and
+  // always includes what numbers are rendered with
+  bool ascii[128] = { false };
+  for (const char *c = "0123456789-+.einaf"; *c != 0; c++)
+    ascii[(int)*c] = true;
+  vector<wchar_t> distinct;
+  for (vector<wchar_t>::const_iterator it = m_chars.begin(); it != m_chars.end(); ++it)
+  {
+    wchar_t c = FoldCase(*it);
+    if (c >= 0 && c < 128)
+      ascii[c] = true;
+    else
+      distinct.push_back(c);
+  }
+  sort(distinct.begin(), distinct.end());
+  distinct.erase(unique(distinct.begin(), distinct.end()), distinct.end());
+  size_t nonAscii = distinct.size();
+  for (wchar_t c = 0; c < 128; c++)
+  {
+    if (ascii[c])
+      distinct.push_back(c);
+  }
+
+  // rank them in collation order, characters which collate equal share a rank
+  const collate<wchar_t> &coll = use_facet< collate<wchar_t> >(locale());
+  vector<wchar_t> ordered(distinct);
+  sort(ordered.begin(), ordered.end(), CollateLess(coll));
+
+  memset(m_asciiRanks, 0, sizeof(m_asciiRanks));
+  vector<uint32_t> ranks(nonAscii);
+  uint32_t rank = 0;
+  for (size_t i = 0; i < ordered.size(); i++)
+  {
+    wchar_t c = ordered[i];
+    if (i > 0 && coll.compare(&ordered[i - 1], &ordered[i - 1] + 1, &c, &c + 1) != 0)
+      rank++;
+
+    if (c >= 0 && c < 128)
+      m_asciiRanks[c] = rank;
+    else
+      ranks[lower_bound(distinct.begin(), distinct.begin() + nonAscii, c) - distinct.begin()] = rank;
+  }
+
+  m_ranks.resize(m_chars.size());
+  for (size_t i = 0; i < m_chars.size(); i++)
+  {
+    wchar_t c = FoldCase(m_chars[i]);
+    if (c >= 0 && c < 128)
+      m_ranks[i] = m_asciiRanks[c];
+    else
+      m_ranks[i] = ranks[lower_bound(distinct.begin(), distinct.begin() + nonAscii, c) - distinct.begin()];
+  }
+}
+
+int CSortKeys::CompareText(const wchar_t *left, const uint32_t *leftRanks, size_t leftLength,
+                           const wchar_t *right, const uint32_t *rightRanks, size_t rightLength)
+{
+  size_t l = 0, r = 0;
+  while (l < leftLength && r < rightLength)
+  {
+    // compare numbers by value, only up to 15 digits
+    if (left[l] >= L'0' && left[l] <= L'9' && right[r] >= L'0' && right[r] <= L'9')
+    {
+      int64_t lnum = 0, rnum = 0;
+      size_t ld = l, rd = r;
+      for (; ld < leftLength && ld < l + 15 && left[ld] >= L'0' && left[ld] <= L'9'; ld++)
+        lnum = lnum * 10 + (left[ld] - L'0');
+      for (; rd < rightLength && rd < r + 15 && right[rd] >= L'0' && right[rd] <= L'9'; rd++)
+        rnum = rnum * 10 + (right[rd] - L'0');
+      if (lnum != rnum)
+        return lnum < rnum ? -1 : 1;
+      l = ld;
+      r = rd;
+      continue;
+    }
+
+    if (leftRanks[l] != rightRanks[r])
+      return leftRanks[l] < rightRanks[r] ? -1 : 1;
+    l++;
+    r++;
+  }
+
+  if (r < rightLength)
+    return -1;
+  if (l < leftLength)
+    return 1;
+  return 0;
+}
+
+size_t CSortKeys::FormatNumber(const Part &part, char *buffer, size_t size)
+{
+  int length;
+  if (part.type == PartInteger)
+    length = snprintf(buffer, size, "%"PRId64, part.integer);
+  else
+    length = snprintf(buffer, size, "%f", part.real);
+
+  return length > 0 ? std::min((size_t)length, size - 1) : 0;
+}
+
+int CSortKeys::ComparePart(const Part &left, const Part &right) const
+{
+  bool leftNumber = left.type == PartInteger || left.type == PartReal;
+  bool rightNumber = right.type == PartInteger || right.type == PartReal;
+
+  // values of the same kind are compared directly
+  if (left.type == PartInteger && right.type == PartInteger)
+  {
+    if (left.integer != right.integer)
+      return left.integer < right.integer ? -1 : 1;
+    return 0;
+  }
+  if (leftNumber && rightNumber)
+  {
+    double leftValue = left.type == PartInteger ? (double)left.integer : left.real;
+    double rightValue = right.type == PartInteger ? (double)right.integer : right.real;
+    if (leftValue != rightValue)
+      return leftValue < rightValue ? -1 : 1;
+    return 0;
+  }
+  if (left.type == PartDate && right.type == PartDate)
+  {
+    if (left.integer != right.integer)
+      return left.integer < right.integer ? -1 : 1;
+    if (left.length != right.length)
+      return left.length < right.length ? -1 : 1;
+    return 0;
+  }
+
+  // anything else (e.g. a number against text) is compared by its textual form
+  wchar_t leftChars[64], rightChars[64];
+  uint32_t leftRanks[64], rightRanks[64];
+  const wchar_t *l = leftChars, *r = rightChars;
+  const uint32_t *lr = leftRanks, *rr = rightRanks;
+  size_t leftLength, rightLength;
+  if (leftNumber)
+    leftLength = RenderNumber(left, leftChars, leftRanks, 64);
+  else
+  {
+    l = &m_chars[0] + left.offset;
+    lr = &m_ranks[0] + left.offset;
+    leftLength = left.length;
+  }
+  if (rightNumber)
+    rightLength = RenderNumber(right, rightChars, rightRanks, 64);
+  else
+  {
+    r = &m_chars[0] + right.offset;
+    rr = &m_ranks[0] + right.offset;
+    rightLength = right.length;
+  }
+
+  return CompareText(l, lr, leftLength, r, rr, rightLength);
+}
+
+size_t CSortKeys::RenderNumber(const Part &part, wchar_t *chars, uint32_t *ranks, size_t size) const
+{
+  char buffer[64];
+  size_t length = FormatNumber(part, buffer, std::min(size, sizeof(buffer)));
+  for (size_t i = 0; i < length; i++)
+  {
+    chars[i] = buffer[i];
+    ranks[i] = m_asciiRanks[buffer[i] & 0x7F];
   }
-  else if (variant.isString())
+
+  return length;
+}
+
+wstring CSortKeys::GetLabel(size_t item) const
+{
+  wstring label;
+  for (size_t i = m_items[item]; i < m_items[item + 1]; i++)
   {
-    if (attributes & SortAttributeIgnoreArticle)
-      return SortUtils::RemoveArticles(variant.asString());
+    const Part &part = m_parts[i];
+    if (i > m_items[item])
+      label += L' ';
+
+    if (part.type == PartText || part.type == PartDate)
+    {
+      if (part.length > 0)
+        label.append(&m_chars[part.offset], part.length);
+    }
     else
-      return variant.asString();
+    {
+      char number[64];
+      size_t length = FormatNumber(part, number, sizeof(number));
+      label.append(number, number + length);
+    }
   }
 
-  return "";
+  return label;
 }
 
-string ByLabel(SortAttribute attributes, const SortItem &values)
+const CVariant& GetField(const SortItem &values, Field field)
 {
-  if (attributes & SortAttributeIgnoreArticle)
-    return SortUtils::RemoveArticles(values.at(FieldLabel).asString());
+  SortItem::const_iterator it = values.find(field);
+  if (it != values.end())
+    return it->second;
 
-  return values.at(FieldLabel).asString();
+  return CVariant::ConstNullVariant;
 }
 
-string ByFile(SortAttribute attributes, const SortItem &values)
+bool IsEmptyText(const CVariant &variant)
 {
-  CURL url(values.at(FieldPath).asString());
-  
-  return StringUtils::Format("%s %d", url.GetFileNameWithoutPath().c_str(), values.at(FieldStartOffset).asInteger());
+  if (variant.isString())
+    return variant.c_str()[0] == 0;
+  if (variant.isNull())
+    return true;
+  return variant.asString().empty();
 }
 
-string ByPath(SortAttribute attributes, const SortItem &values)
+void ByLabel(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %d", values.at(FieldPath).asString().c_str(), values.at(FieldStartOffset).asInteger());
+  key.AddText(GetField(values, FieldLabel), (attributes & SortAttributeIgnoreArticle) != 0);
 }
 
-string ByLastPlayed(SortAttribute attributes, const SortItem &values)
+void ByFile(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %s", values.at(FieldLastPlayed).asString().c_str(), ByLabel(attributes, values).c_str());
+  CURL url(GetField(values, FieldPath).asString());
+
+  key.AddText(CVariant(url.GetFileNameWithoutPath()));
+  key.AddInteger(GetField(values, FieldStartOffset).asInteger());
 }
 
-string ByPlaycount(SortAttribute attributes, const SortItem &values)
+void ByPath(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i %s", (int)values.at(FieldPlaycount).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddText(GetField(values, FieldPath));
+  key.AddInteger(GetField(values, FieldStartOffset).asInteger());
 }
 
-string ByDate(SortAttribute attributes, const SortItem &values)
+void ByLastPlayed(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldDate).asString() + " " + ByLabel(attributes, values);
+  key.AddDate(GetField(values, FieldLastPlayed));
+  ByLabel(attributes, values, key);
 }
 
-string ByDateAdded(SortAttribute attributes, const SortItem &values)
+void ByPlaycount(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %d", values.at(FieldDateAdded).asString().c_str(), (int)values.at(FieldId).asInteger());;
+  key.AddInteger(GetField(values, FieldPlaycount).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string BySize(SortAttribute attributes, const SortItem &values)
+void ByDate(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%"PRId64, values.at(FieldSize).asInteger());
+  key.AddDate(GetField(values, FieldDate));
+  ByLabel(attributes, values, key);
 }
 
-string ByDriveType(SortAttribute attributes, const SortItem &values)
+void ByDateAdded(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%d %s", (int)values.at(FieldDriveType).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddDate(GetField(values, FieldDateAdded));
+  key.AddInteger(GetField(values, FieldId).asInteger());
 }
 
-string ByTitle(SortAttribute attributes, const SortItem &values)
+void BySize(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  if (attributes & SortAttributeIgnoreArticle)
-    return SortUtils::RemoveArticles(values.at(FieldTitle).asString());
+  key.AddInteger(GetField(values, FieldSize).asInteger());
+}
 
-  return values.at(FieldTitle).asString();
+void ByDriveType(SortAttribute attributes, const SortItem &values, CSortKeys &key)
+{
+  key.AddInteger(GetField(values, FieldDriveType).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByAlbum(SortAttribute attributes, const SortItem &values)
+void ByTitle(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  string album = values.at(FieldAlbum).asString();
-  if (attributes & SortAttributeIgnoreArticle)
-    album = SortUtils::RemoveArticles(album);
+  key.AddText(GetField(values, FieldTitle), (attributes & SortAttributeIgnoreArticle) != 0);
+}
 
-  CStdString label = StringUtils::Format("%s %s", album.c_str(), ArrayToString(attributes, values.at(FieldArtist)).c_str());
+void ByAlbum(SortAttribute attributes, const SortItem &values, CSortKeys &key)
+{
+  key.AddText(GetField(values, FieldAlbum), (attributes & SortAttributeIgnoreArticle) != 0);
+  key.AddArray(GetField(values, FieldArtist), (attributes & SortAttributeIgnoreArticle) != 0);
 
-  const CVariant &track = values.at(FieldTrackNumber);
+  const CVariant &track = GetField(values, FieldTrackNumber);
   if (!track.isNull())
-    label += StringUtils::Format(" %i", (int)track.asInteger());
-
-  return label;
+    key.AddInteger(track.asInteger());
 }
 
-string ByAlbumType(SortAttribute attributes, const SortItem &values)
+void ByAlbumType(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldAlbumType).asString() + " " + ByLabel(attributes, values);
+  key.AddText(GetField(values, FieldAlbumType));
+  ByLabel(attributes, values, key);
 }
 
-string ByArtist(SortAttribute attributes, const SortItem &values)
+void ByArtist(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  CStdString label = ArrayToString(attributes, values.at(FieldArtist));
+  key.AddArray(GetField(values, FieldArtist), (attributes & SortAttributeIgnoreArticle) != 0);
 
-  const CVariant &year = values.at(FieldYear);
+  const CVariant &year = GetField(values, FieldYear);
   if (g_advancedSettings.m_bMusicLibraryAlbumsSortByArtistThenYear &&
       !year.isNull())
-    label += StringUtils::Format(" %i", (int)year.asInteger());
+    key.AddInteger(year.asInteger());
 
-  const CVariant &album = values.at(FieldAlbum);
+  const CVariant &album = GetField(values, FieldAlbum);
   if (!album.isNull())
-    label += " " + SortUtils::RemoveArticles(album.asString());
+    key.AddText(album, true);
 
-  const CVariant &track = values.at(FieldTrackNumber);
+  const CVariant &track = GetField(values, FieldTrackNumber);
   if (!track.isNull())
-    label += StringUtils::Format(" %i", (int)track.asInteger());
-
-  return label;
+    key.AddInteger(track.asInteger());
 }
 
-string ByTrackNumber(SortAttribute attributes, const SortItem &values)
+void ByTrackNumber(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i", (int)values.at(FieldTrackNumber).asInteger());
+  key.AddInteger(GetField(values, FieldTrackNumber).asInteger());
 }
 
-string ByTime(SortAttribute attributes, const SortItem &values)
+void ByTime(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  CStdString label;
-  const CVariant &time = values.at(FieldTime);
+  const CVariant &time = GetField(values, FieldTime);
   if (time.isInteger())
-    label = StringUtils::Format("%i", (int)time.asInteger());
+    key.AddInteger(time.asInteger());
   else
-    label = StringUtils::Format("%s", time.asString().c_str());
-  return label;
+    key.AddText(time);
 }
 
-string ByProgramCount(SortAttribute attributes, const SortItem &values)
+void ByProgramCount(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i", (int)values.at(FieldProgramCount).asInteger());
+  key.AddInteger(GetField(values, FieldProgramCount).asInteger());
 }
 
-string ByPlaylistOrder(SortAttribute attributes, const SortItem &values)
+void ByPlaylistOrder(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
   // TODO: Playlist order is hacked into program count variable (not nice, but ok until 2.0)
-  return ByProgramCount(attributes, values);
+  ByProgramCount(attributes, values, key);
 }
 
-string ByGenre(SortAttribute attributes, const SortItem &values)
+void ByGenre(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return ArrayToString(attributes, values.at(FieldGenre));
+  key.AddArray(GetField(values, FieldGenre), (attributes & SortAttributeIgnoreArticle) != 0);
 }
 
-string ByCountry(SortAttribute attributes, const SortItem &values)
+void ByCountry(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return ArrayToString(attributes, values.at(FieldCountry));
+  key.AddArray(GetField(values, FieldCountry), (attributes & SortAttributeIgnoreArticle) != 0);
 }
 
-string ByYear(SortAttribute attributes, const SortItem &values)
+void ByYear(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  CStdString label;
-  const CVariant &airDate = values.at(FieldAirDate);
-  if (!airDate.isNull() && !airDate.asString().empty())
-    label = airDate.asString() + " ";
+  const CVariant &airDate = GetField(values, FieldAirDate);
+  if (!IsEmptyText(airDate))
+    key.AddDate(airDate);
 
-  label += StringUtils::Format("%i %s", (int)values.at(FieldYear).asInteger(), ByLabel(attributes, values).c_str());
- 
-  return label;
+  key.AddInteger(GetField(values, FieldYear).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string BySortTitle(SortAttribute attributes, const SortItem &values)
+void BySortTitle(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  string title = values.at(FieldSortTitle).asString();
-  if (title.empty())
-    title = values.at(FieldTitle).asString();
-
-  if (attributes & SortAttributeIgnoreArticle)
-    title = SortUtils::RemoveArticles(title);
-
-  return title;
+  const CVariant &sortTitle = GetField(values, FieldSortTitle);
+  if (!IsEmptyText(sortTitle))
+    key.AddText(sortTitle, (attributes & SortAttributeIgnoreArticle) != 0);
+  else
+    key.AddText(GetField(values, FieldTitle), (attributes & SortAttributeIgnoreArticle) != 0);
 }
 
-string ByRating(SortAttribute attributes, const SortItem &values)
+void ByRating(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%f %s", values.at(FieldRating).asFloat(), ByLabel(attributes, values).c_str());
+  key.AddReal(GetField(values, FieldRating).asFloat());
+  ByLabel(attributes, values, key);
 }
 
-string ByVotes(SortAttribute attributes, const SortItem &values)
+void ByVotes(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%d %s", (int)values.at(FieldVotes).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddInteger(GetField(values, FieldVotes).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByTop250(SortAttribute attributes, const SortItem &values)
+void ByTop250(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%d %s", (int)values.at(FieldTop250).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddInteger(GetField(values, FieldTop250).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByMPAA(SortAttribute attributes, const SortItem &values)
+void ByMPAA(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldMPAA).asString() + " " + ByLabel(attributes, values);
+  key.AddText(GetField(values, FieldMPAA));
+  ByLabel(attributes, values, key);
 }
 
-string ByStudio(SortAttribute attributes, const SortItem &values)
+void ByStudio(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return ArrayToString(attributes, values.at(FieldStudio));
+  key.AddArray(GetField(values, FieldStudio), (attributes & SortAttributeIgnoreArticle) != 0);
 }
 
-string ByEpisodeNumber(SortAttribute attributes, const SortItem &values)
+void ByEpisodeNumber(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
   // we calculate an offset number based on the episode's
   // sort season and episode values. in addition
@@ -251,242 +726,390 @@ string ByEpisodeNumber(SortAttribute attributes, const SortItem &values)
   // after each other they will sort backwards. if a show has > 2^32-1 seasons
   // or if a season has > 2^16-1 episodes strange things will happen (overflow)
   uint64_t num;
-  const CVariant &episodeSpecial = values.at(FieldEpisodeNumberSpecialSort);
-  const CVariant &seasonSpecial = values.at(FieldSeasonSpecialSort);
+  const CVariant &episodeSpecial = GetField(values, FieldEpisodeNumberSpecialSort);
+  const CVariant &seasonSpecial = GetField(values, FieldSeasonSpecialSort);
   if (!episodeSpecial.isNull() && !seasonSpecial.isNull() &&
      (episodeSpecial.asInteger() > 0 || seasonSpecial.asInteger() > 0))
-    num = ((uint64_t)seasonSpecial.asInteger() << 32) + (episodeSpecial.asInteger() << 16) - ((2 << 15) - values.at(FieldEpisodeNumber).asInteger());
+    num = ((uint64_t)seasonSpecial.asInteger() << 32) + (episodeSpecial.asInteger() << 16) - ((2 << 15) - GetField(values, FieldEpisodeNumber).asInteger());
   else
-    num = ((uint64_t)values.at(FieldSeason).asInteger() << 32) + (values.at(FieldEpisodeNumber).asInteger() << 16);
-
-  std::string title;
-  if (values.find(FieldMediaType) != values.end() && values.at(FieldMediaType).asString() == MediaTypeMovie)
-    title = BySortTitle(attributes, values);
-  if (title.empty())
-    title = ByLabel(attributes, values);
+    num = ((uint64_t)GetField(values, FieldSeason).asInteger() << 32) + (GetField(values, FieldEpisodeNumber).asInteger() << 16);
+  key.AddInteger((int64_t)num);
 
-  return StringUtils::Format("%"PRIu64" %s", num, title.c_str());
+  const CVariant &mediaType = GetField(values, FieldMediaType);
+  if (mediaType.isString() && strcmp(mediaType.c_str(), MediaTypeMovie) == 0 &&
+      !(IsEmptyText(GetField(values, FieldSortTitle)) && IsEmptyText(GetField(values, FieldTitle))))
+    BySortTitle(attributes, values, key);
+  else
+    ByLabel(attributes, values, key);
 }
 
-string BySeason(SortAttribute attributes, const SortItem &values)
+void BySeason(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  int season = (int)values.at(FieldSeason).asInteger();
-  const CVariant &specialSeason = values.at(FieldSeasonSpecialSort);
+  int season = (int)GetField(values, FieldSeason).asInteger();
+  const CVariant &specialSeason = GetField(values, FieldSeasonSpecialSort);
   if (!specialSeason.isNull())
     season = (int)specialSeason.asInteger();
 
-  return StringUtils::Format("%i %s", season, ByLabel(attributes, values).c_str());
+  key.AddInteger(season);
+  ByLabel(attributes, values, key);
 }
 
-string ByNumberOfEpisodes(SortAttribute attributes, const SortItem &values)
+void ByNumberOfEpisodes(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i %s", (int)values.at(FieldNumberOfEpisodes).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddInteger(GetField(values, FieldNumberOfEpisodes).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByNumberOfWatchedEpisodes(SortAttribute attributes, const SortItem &values)
+void ByNumberOfWatchedEpisodes(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i %s", (int)values.at(FieldNumberOfWatchedEpisodes).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddInteger(GetField(values, FieldNumberOfWatchedEpisodes).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByTvShowStatus(SortAttribute attributes, const SortItem &values)
+void ByTvShowStatus(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldTvShowStatus).asString() + " " + ByLabel(attributes, values);
+  key.AddText(GetField(values, FieldTvShowStatus));
+  ByLabel(attributes, values, key);
 }
 
-string ByTvShowTitle(SortAttribute attributes, const SortItem &values)
+void ByTvShowTitle(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldTvShowTitle).asString() + " " + ByLabel(attributes, values);
+  key.AddText(GetField(values, FieldTvShowTitle));
+  ByLabel(attributes, values, key);
 }
 
-string ByProductionCode(SortAttribute attributes, const SortItem &values)
+void ByProductionCode(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldProductionCode).asString();
+  key.AddText(GetField(values, FieldProductionCode));
 }
 
-string ByVideoResolution(SortAttribute attributes, const SortItem &values)
+void ByVideoResolution(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i %s", (int)values.at(FieldVideoResolution).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddInteger(GetField(values, FieldVideoResolution).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByVideoCodec(SortAttribute attributes, const SortItem &values)
+void ByVideoCodec(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %s", values.at(FieldVideoCodec).asString().c_str(), ByLabel(attributes, values).c_str());
+  key.AddText(GetField(values, FieldVideoCodec));
+  ByLabel(attributes, values, key);
 }
 
-string ByVideoAspectRatio(SortAttribute attributes, const SortItem &values)
+void ByVideoAspectRatio(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%f %s", values.at(FieldVideoAspectRatio).asString().c_str(), ByLabel(attributes, values).c_str());
+  key.AddReal(GetField(values, FieldVideoAspectRatio).asFloat());
+  ByLabel(attributes, values, key);
 }
 
-string ByAudioChannels(SortAttribute attributes, const SortItem &values)
+void ByAudioChannels(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i %s", (int)values.at(FieldAudioChannels).asInteger(), ByLabel(attributes, values).c_str());
+  key.AddInteger(GetField(values, FieldAudioChannels).asInteger());
+  ByLabel(attributes, values, key);
 }
 
-string ByAudioCodec(SortAttribute attributes, const SortItem &values)
+void ByAudioCodec(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %s", values.at(FieldAudioCodec).asString().c_str(), ByLabel(attributes, values).c_str());
+  key.AddText(GetField(values, FieldAudioCodec));
+  ByLabel(attributes, values, key);
 }
 
-string ByAudioLanguage(SortAttribute attributes, const SortItem &values)
+void ByAudioLanguage(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %s", values.at(FieldAudioLanguage).asString().c_str(), ByLabel(attributes, values).c_str());;
+  key.AddText(GetField(values, FieldAudioLanguage));
+  ByLabel(attributes, values, key);
 }
 
-string BySubtitleLanguage(SortAttribute attributes, const SortItem &values)
+void BySubtitleLanguage(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%s %s", values.at(FieldSubtitleLanguage).asString().c_str(), ByLabel(attributes, values).c_str());
+  key.AddText(GetField(values, FieldSubtitleLanguage));
+  ByLabel(attributes, values, key);
 }
 
-string ByBitrate(SortAttribute attributes, const SortItem &values)
+void ByBitrate(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%"PRId64, values.at(FieldBitrate).asInteger());
+  key.AddInteger(GetField(values, FieldBitrate).asInteger());
 }
 
-string ByListeners(SortAttribute attributes, const SortItem &values)
+void ByListeners(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i", values.at(FieldListeners).asInteger());;
+  key.AddInteger(GetField(values, FieldListeners).asInteger());
 }
 
-string ByRandom(SortAttribute attributes, const SortItem &values)
+void ByRandom(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return StringUtils::Format("%i", CUtil::GetRandomNumber());;
+  key.AddInteger(CUtil::GetRandomNumber());
 }
 
-string ByChannel(SortAttribute attributes, const SortItem &values)
+void ByChannel(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldChannelName).asString();
+  key.AddText(GetField(values, FieldChannelName));
 }
 
-string ByDateTaken(SortAttribute attributes, const SortItem &values)
+void ByDateTaken(SortAttribute attributes, const SortItem &values, CSortKeys &key)
 {
-  return values.at(FieldDateTaken).asString();
+  key.AddDate(GetField(values, FieldDateTaken));
 }
 
-bool preliminarySort(const SortItem &left, const SortItem &right, bool handleFolder, bool &result, std::wstring &labelLeft, std::wstring &labelRight)
+/*! \brief Position of an item in the list together with the attributes that
+ are compared before its sort key.
+ */
+typedef struct
+{
+  size_t index;
+  int    special; // 0 = sort on top, 1 = none, 2 = sort on bottom
+  int    folder;  // -1 = unknown
+} SortEntry;
+
+class SortEntryLess
 {
-  // make sure both items have the necessary data to do the sorting
-  SortItem::const_iterator itLeftSort, itRightSort;
-  if ((itLeftSort = left.find(FieldSort)) == left.end())
+public:
+  SortEntryLess(const CSortKeys &keys, SortOrder sortOrder, SortAttribute attributes)
+    : m_keys(keys),
+      m_descending(sortOrder == SortOrderDescending),
+      m_handleFolder((attributes & SortAttributeIgnoreFolders) == 0)
+  { }
+
+  bool operator()(const SortEntry &left, const SortEntry &right) const
   {
-    result = false;
-    return true;
+    // items sorted on top/bottom keep their order amongst each other
+    if (left.special != right.special)
+      return left.special < right.special;
+    if (left.special != 1)
+      return false;
+
+    // folders always come first
+    if (m_handleFolder && left.folder >= 0 && right.folder >= 0 && left.folder != right.folder)
+      return left.folder > right.folder;
+
+    int result = m_keys.Compare(left.index, right.index);
+    return m_descending ? result > 0 : result < 0;
   }
-  if ((itRightSort = right.find(FieldSort)) == right.end())
+
+private:
+  const CSortKeys &m_keys;
+  bool m_descending;
+  bool m_handleFolder;
+};
+
+inline const SortItem& GetSortItem(const DatabaseResult &item) { return item; }
+inline const SortItem& GetSortItem(const SortItemPtr &item) { return *item; }
+
+SortEntry MakeSortEntry(size_t index, const SortItem &item)
+{
+  SortEntry entry = { index, 1, -1 };
+
+  SortItem::const_iterator it = item.find(FieldSortSpecial);
+  if (it != item.end())
   {
-    result = true;
-    return true;
+    int64_t special = it->second.asInteger();
+    if (special == SortSpecialOnTop)
+      entry.special = 0;
+    else if (special == SortSpecialOnBottom)
+      entry.special = 2;
   }
 
-  // look at special sorting behaviour
-  SortItem::const_iterator itLeft, itRight;
-  SortSpecial leftSortSpecial = SortSpecialNone;
-  SortSpecial rightSortSpecial = SortSpecialNone;
-  if ((itLeft = left.find(FieldSortSpecial)) != left.end() && itLeft->second.asInteger() <= (int64_t)SortSpecialOnBottom)
-    leftSortSpecial = (SortSpecial)itLeft->second.asInteger();
-  if ((itRight = right.find(FieldSortSpecial)) != right.end() && itRight->second.asInteger() <= (int64_t)SortSpecialOnBottom)
-    rightSortSpecial = (SortSpecial)itRight->second.asInteger();
-  
-  // one has a special sort
-  if (leftSortSpecial != rightSortSpecial)
-  {
-    // left should be sorted on top
-    // or right should be sorted on bottom
-    // => left is sorted above right
-    if (leftSortSpecial == SortSpecialOnTop ||
-        rightSortSpecial == SortSpecialOnBottom)
-    {
-      result = true;
-      return true;
-    }
-    
-    // otherwise right is sorted above left
-    result = false;
-    return true;
-  }
-  // both have either sort on top or sort on bottom -> leave as-is
-  else if (leftSortSpecial != SortSpecialNone && leftSortSpecial == rightSortSpecial)
+  if ((it = item.find(FieldFolder)) != item.end())
+    entry.folder = it->second.asBoolean() ? 1 : 0;
+
+  return entry;
+}
+
+inline void SetSortLabel(DatabaseResult &item, const CSortKeys &keys, size_t index)
+{
+  // nothing looks at the sort label of database results, so don't bother
+}
+
+inline void SetSortLabel(SortItemPtr &item, const CSortKeys &keys, size_t index)
+{
+  (*item)[FieldSort] = CVariant(keys.GetLabel(index));
+}
+
+/*! \brief One step of the parallel merge sort, split into independent tasks.
+
+ Tasks are claimed by the calling thread as well as by jobs on the job manager,
+ so the sort finishes even if no worker is available. Jobs which start late
+ only hold on to the phase, they won't touch the entries once all tasks have
+ been claimed.
+ */
+class CSortPhase
+{
+public:
+  CSortPhase(vector<SortEntry> &source, vector<SortEntry> &target, const vector<size_t> &runs,
+             size_t width, const SortEntryLess &less)
+    : m_source(source), m_target(target), m_runs(runs), m_width(width), m_less(less),
+      m_next(0), m_done(0)
   {
-    result = false;
-    return true;
+    // the first phase sorts every run in place, the following ones merge pairs of runs
+    size_t count = m_runs.size() - 1;
+    m_tasks = m_width == 0 ? count : (count + 2 * m_width - 1) / (2 * m_width);
   }
 
-  if (handleFolder)
+  long GetTasks() const { return m_tasks; }
+
+  bool RunTask()
   {
-    itLeft = left.find(FieldFolder);
-    itRight = right.find(FieldFolder);
-    if (itLeft != left.end() && itRight != right.end() &&
-        itLeft->second.asBoolean() != itRight->second.asBoolean())
+    long task = AtomicIncrement(&m_next) - 1;
+    if (task >= m_tasks)
+      return false;
+
+    if (m_width == 0)
+      std::stable_sort(m_source.begin() + m_runs[task], m_source.begin() + m_runs[task + 1], m_less);
+    else
     {
-      result = itLeft->second.asBoolean();
-      return true;
+      size_t count = m_runs.size() - 1;
+      size_t first = task * 2 * m_width;
+      size_t middle = std::min(first + m_width, count);
+      size_t last = std::min(first + 2 * m_width, count);
+      std::merge(m_source.begin() + m_runs[first], m_source.begin() + m_runs[middle],
+                 m_source.begin() + m_runs[middle], m_source.begin() + m_runs[last],
+                 m_target.begin() + m_runs[first], m_less);
     }
+
+    if (AtomicIncrement(&m_done) == m_tasks)
+      m_finished.Set();
+    return true;
   }
 
-  labelLeft = itLeftSort->second.asWideString();
-  labelRight = itRightSort->second.asWideString();
+  void Wait()
+  {
+    while (RunTask())
+      ;
+    m_finished.Wait();
+  }
 
-  return false;
-}
+private:
+  vector<SortEntry> &m_source;
+  vector<SortEntry> &m_target;
+  const vector<size_t> &m_runs;
+  size_t m_width;
+  SortEntryLess m_less;
+  long m_tasks;
+  volatile long m_next;
+  volatile long m_done;
+  CEvent m_finished;
+};
 
-bool SorterAscending(const SortItem &left, const SortItem &right)
+class CSortPhaseJob : public CJob
 {
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, true, result, labelLeft, labelRight))
-    return result;
+public:
+  CSortPhaseJob(const boost::shared_ptr<CSortPhase> &phase) : m_phase(phase) { }
 
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) < 0;
-}
+  virtual const char *GetType() const { return "sort"; }
 
-bool SorterDescending(const SortItem &left, const SortItem &right)
-{
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, true, result, labelLeft, labelRight))
-    return result;
+  virtual bool DoWork()
+  {
+    while (m_phase->RunTask())
+      ;
+    return true;
+  }
 
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) > 0;
-}
+private:
+  boost::shared_ptr<CSortPhase> m_phase;
+};
 
-bool SorterIgnoreFoldersAscending(const SortItem &left, const SortItem &right)
+void RunSortPhase(vector<SortEntry> &source, vector<SortEntry> &target, const vector<size_t> &runs,
+                  size_t width, const SortEntryLess &less, unsigned int threads)
 {
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, false, result, labelLeft, labelRight))
-    return result;
-
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) < 0;
+  boost::shared_ptr<CSortPhase> phase(new CSortPhase(source, target, runs, width, less));
+  for (long i = 1; i < std::min(phase->GetTasks(), (long)threads); i++)
+    CJobManager::GetInstance().AddJob(new CSortPhaseJob(phase), NULL, CJob::PRIORITY_HIGH);
+  phase->Wait();
 }
 
-bool SorterIgnoreFoldersDescending(const SortItem &left, const SortItem &right)
+/*! \brief Stable sort which spreads large lists over the available cores.
+
+ The entries are split into one run per thread which are sorted and then merged
+ pairwise with std::merge. As both are stable this results in exactly the same
+ order as a single std::stable_sort.
+ */
+void StableSort(vector<SortEntry> &entries, const SortEntryLess &less)
 {
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, false, result, labelLeft, labelRight))
-    return result;
+  size_t threads = SortThreads > 0 ? SortThreads : g_cpuInfo.getCPUCount();
+  threads = std::min(threads, entries.size() / SORT_PARALLEL_MIN_RUN);
+  if (entries.size() < SORT_PARALLEL_THRESHOLD || threads < 2)
+  {
+    std::stable_sort(entries.begin(), entries.end(), less);
+    return;
+  }
 
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) > 0;
-}
+  vector<size_t> runs;
+  for (unsigned int i = 0; i < threads; i++)
+    runs.push_back(entries.size() * i / threads);
+  runs.push_back(entries.size());
 
-bool SorterIndirectAscending(const SortItemPtr &left, const SortItemPtr &right)
-{
-  return SorterAscending(*left, *right);
+  vector<SortEntry> buffer(entries.size());
+  RunSortPhase(entries, buffer, runs, 0, less, threads);
+
+  bool inBuffer = false;
+  for (size_t width = 1; width < threads; width *= 2)
+  {
+    if (inBuffer)
+      RunSortPhase(buffer, entries, runs, width, less, threads);
+    else
+      RunSortPhase(entries, buffer, runs, width, less, threads);
+    inBuffer = !inBuffer;
+  }
+
+  if (inBuffer)
+    entries.swap(buffer);
 }
 
-bool SorterIndirectDescending(const SortItemPtr &left, const SortItemPtr &right)
+/*! \brief Determine the range of items kept by limitStart/limitEnd.
+ */
+void GetLimits(size_t size, int limitStart, int limitEnd, size_t &begin, size_t &end)
 {
-  return SorterDescending(*left, *right);
+  begin = 0;
+  end = size;
+  if (limitStart > 0 && (size_t)limitStart < size)
+  {
+    begin = limitStart;
+    limitEnd -= limitStart;
+  }
+  if (limitEnd > 0 && (size_t)limitEnd < end - begin)
+    end = begin + limitEnd;
 }
 
-bool SorterIndirectIgnoreFoldersAscending(const SortItemPtr &left, const SortItemPtr &right)
+template<typename T>
+void ApplyLimits(std::vector<T> &items, int limitStart, int limitEnd)
 {
-  return SorterIgnoreFoldersAscending(*left, *right);
+  size_t begin, end;
+  GetLimits(items.size(), limitStart, limitEnd, begin, end);
+  items.erase(items.begin() + end, items.end());
+  items.erase(items.begin(), items.begin() + begin);
 }
 
-bool SorterIndirectIgnoreFoldersDescending(const SortItemPtr &left, const SortItemPtr &right)
-{
-  return SorterIgnoreFoldersDescending(*left, *right);
+/*! \brief Sort the given items by typed keys built with the given preparator.
+ The items are only moved once, after the order has been determined, and only
+ the ones within limitStart/limitEnd are kept.
+ */
+template<typename T>
+void SortByKeys(SortUtils::SortPreparator preparator, SortOrder sortOrder, SortAttribute attributes,
+                std::vector<T> &items, int limitStart, int limitEnd)
+{
+  CSortKeys keys;
+  vector<SortEntry> entries;
+  entries.reserve(items.size());
+  keys.Reserve(items.size());
+  for (size_t i = 0; i < items.size(); i++)
+  {
+    const SortItem &item = GetSortItem(items[i]);
+    keys.BeginItem();
+    preparator(attributes, item, keys);
+    entries.push_back(MakeSortEntry(i, item));
+  }
+  keys.Collate();
+
+  StableSort(entries, SortEntryLess(keys, sortOrder, attributes));
+
+  size_t begin, end;
+  GetLimits(entries.size(), limitStart, limitEnd, begin, end);
+  vector<T> sorted(end - begin);
+  for (size_t i = begin; i < end; i++)
+  {
+    swap(sorted[i - begin], items[entries[i].index]);
+    SetSortLabel(sorted[i - begin], keys, entries[i].index);
+  }
+  items.swap(sorted);
 }
 
 map<SortBy, SortUtils::SortPreparator> fillPreparators()
@@ -614,6 +1237,7 @@ map<SortBy, Fields> fillSortingFields()
   return sortingFields;
 }
 
+
 map<SortBy, SortUtils::SortPreparator> SortUtils::m_preparators = fillPreparators();
 map<SortBy, Fields> SortUtils::m_sortingFields = fillSortingFields();
 
@@ -625,35 +1249,12 @@ void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attribute
     SortPreparator preparator = getPreparator(sortBy);
     if (preparator != NULL)
     {
-      Fields sortingFields = GetFieldsForSorting(sortBy);
-
-      // Prepare the string used for sorting and store it under FieldSort
-      for (DatabaseResults::iterator item = items.begin(); item != items.end(); item++)
-      {
-        // add all fields to the item that are required for sorting if they are currently missing
-        for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); field++)
-        {
-          if (item->find(*field) == item->end())
-            item->insert(pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
-        }
-
-        CStdStringW sortLabel;
-        g_charsetConverter.utf8ToW(preparator(attributes, *item), sortLabel, false);
-        item->insert(pair<Field, CVariant>(FieldSort, CVariant(sortLabel)));
-      }
-
-      // Do the sorting
-      std::stable_sort(items.begin(), items.end(), getSorter(sortOrder, attributes));
+      SortByKeys(preparator, sortOrder, attributes, items, limitStart, limitEnd);
+      return;
     }
   }
 
-  if (limitStart > 0 && (size_t)limitStart < items.size())
-  {
-    items.erase(items.begin(), items.begin() + limitStart);
-    limitEnd -= limitStart;
-  }
-  if (limitEnd > 0 && (size_t)limitEnd < items.size())
-    items.erase(items.begin() + limitEnd, items.end());
+  ApplyLimits(items, limitStart, limitEnd);
 }
 
 void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd /* = -1 */, int limitStart /* = 0 */)
@@ -664,35 +1265,12 @@ void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attribute
     SortPreparator preparator = getPreparator(sortBy);
     if (preparator != NULL)
     {
-      Fields sortingFields = GetFieldsForSorting(sortBy);
-
-      // Prepare the string used for sorting and store it under FieldSort
-      for (SortItems::iterator item = items.begin(); item != items.end(); item++)
-      {
-        // add all fields to the item that are required for sorting if they are currently missing
-        for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); field++)
-        {
-          if ((*item)->find(*field) == (*item)->end())
-            (*item)->insert(pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
-        }
-
-        CStdStringW sortLabel;
-        g_charsetConverter.utf8ToW(preparator(attributes, **item), sortLabel, false);
-        (*item)->insert(pair<Field, CVariant>(FieldSort, CVariant(sortLabel)));
-      }
-
-      // Do the sorting
-      std::stable_sort(items.begin(), items.end(), getSorterIndirect(sortOrder, attributes));
+      SortByKeys(preparator, sortOrder, attributes, items, limitStart, limitEnd);
+      return;
     }
   }
 
-  if (limitStart > 0 && (size_t)limitStart < items.size())
-  {
-    items.erase(items.begin(), items.begin() + limitStart);
-    limitEnd -= limitStart;
-  }
-  if (limitEnd > 0 && (size_t)limitEnd < items.size())
-    items.erase(items.begin() + limitEnd, items.end());
+  ApplyLimits(items, limitStart, limitEnd);
 }
 
 void SortUtils::Sort(const SortDescription &sortDescription, DatabaseResults& items)
@@ -735,22 +1313,6 @@ const SortUtils::SortPreparator& SortUtils::getPreparator(SortBy sortBy)
   return m_preparators[SortByNone];
 }
 
-SortUtils::Sorter SortUtils::getSorter(SortOrder sortOrder, SortAttribute attributes)
-{
-  if (attributes & SortAttributeIgnoreFolders)
-    return sortOrder == SortOrderDescending ? SorterIgnoreFoldersDescending : SorterIgnoreFoldersAscending;
-
-  return sortOrder == SortOrderDescending ? SorterDescending : SorterAscending;
-}
-
-SortUtils::SorterIndirect SortUtils::getSorterIndirect(SortOrder sortOrder, SortAttribute attributes)
-{
-  if (attributes & SortAttributeIgnoreFolders)
-    return sortOrder == SortOrderDescending ? SorterIndirectIgnoreFoldersDescending : SorterIndirectIgnoreFoldersAscending;
-
-  return sortOrder == SortOrderDescending ? SorterIndirectDescending : SorterIndirectAscending;
-}
-
 const Fields& SortUtils::GetFieldsForSorting(SortBy sortBy)
 {
   map<SortBy, Fields>::const_iterator it = m_sortingFields.find(sortBy);
@@ -762,14 +1324,12 @@ const Fields& SortUtils::GetFieldsForSorting(SortBy sortBy)
 
 string SortUtils::RemoveArticles(const string &label)
 {
-  for (unsigned int i = 0; i < g_advancedSettings.m_vecTokens.size(); ++i)
-  {
-    if (g_advancedSettings.m_vecTokens[i].size() < label.size() &&
-        strnicmp(g_advancedSettings.m_vecTokens[i].c_str(), label.c_str(), g_advancedSettings.m_vecTokens[i].size()) == 0)
-      return label.substr(g_advancedSettings.m_vecTokens[i].size());
-  }
+  return label.substr(CSortKeys::GetArticleLength(label.c_str(), label.size()));
+}
 
-  return label;
+void SortUtils::SetSortThreads(unsigned int threads)
+{
+  SortThreads = threads;
 }
 
 typedef struct
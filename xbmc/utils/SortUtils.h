@@ -118,6 +118,8 @@ typedef DatabaseResult SortItem;
 typedef boost::shared_ptr<SortItem> SortItemPtr;
 typedef std::vector<SortItemPtr> SortItems;
 
+class CSortKeys;
+
 class SortUtils
 {
 public:
@@ -138,15 +140,17 @@ public:
   
   static const Fields& GetFieldsForSorting(SortBy sortBy);
   static std::string RemoveArticles(const std::string &label);
+
+  /*! \brief sets the number of threads large lists are sorted with.
+   \param threads the number of threads, 0 for one per CPU.
+   */
+  static void SetSortThreads(unsigned int threads);
   
-  typedef std::string (*SortPreparator) (SortAttribute, const SortItem&);
-  typedef bool (*Sorter) (const DatabaseResult &, const DatabaseResult &);
-  typedef bool (*SorterIndirect) (const SortItemPtr &, const SortItemPtr &);
+  /*! \brief adds the typed sort key parts of an item to the keys of the list being sorted */
+  typedef void (*SortPreparator) (SortAttribute, const SortItem&, CSortKeys&);
   
 private:
   static const SortPreparator& getPreparator(SortBy sortBy);
-  static Sorter getSorter(SortOrder sortOrder, SortAttribute attributes);
-  static SorterIndirect getSorterIndirect(SortOrder sortOrder, SortAttribute attributes);
 
   static std::map<SortBy, SortPreparator> m_preparators;
   static std::map<SortBy, Fields> m_sortingFields;
@@ -38,6 +38,10 @@ public:
   bool Search(const CStdString &strHaystack) const;
   bool IsValid(void) const;
 
+  const std::vector<CStdString> &GetAndTerms(void) const { return m_AND; }
+  const std::vector<CStdString> &GetOrTerms(void) const { return m_OR; }
+  const std::vector<CStdString> &GetNotTerms(void) const { return m_NOT; }
+
 private:
   void GetAndCutNextTerm(CStdString &strSearchTerm, CStdString &strNextTerm);
   void ExtractSearchTerms(const CStdString &strSearchTerm, TextSearchDefault defaultSearchMode);
@@ -417,3 +417,32 @@ TEST_F(TestArchive, MultiTypeArchive)
   EXPECT_EQ(2, iArray_var.at(2));
   EXPECT_EQ(3, iArray_var.at(3));
 }
+
+TEST(TestArchiveMemory, StoreAndLoad)
+{
+  std::vector<uint8_t> buffer;
+  std::string string_ref(CARCHIVE_BUFFER_MAX * 2, 'x'), string_var;
+  int int_ref = 1000, int_var = 0;
+
+  CArchive arstore(buffer);
+  EXPECT_TRUE(arstore.IsStoring());
+  arstore << int_ref;
+  arstore << string_ref;
+  arstore.Close();
+  EXPECT_EQ(sizeof(int) + sizeof(size_t) + string_ref.size(), buffer.size());
+
+  CArchive arload(&buffer[0], buffer.size());
+  EXPECT_TRUE(arload.IsLoading());
+  arload >> int_var;
+  arload >> string_var;
+  arload.Close();
+
+  EXPECT_EQ(int_ref, int_var);
+  EXPECT_STREQ(string_ref.c_str(), string_var.c_str());
+
+  // reading past the end of the block zeroes the result rather than refilling
+  CArchive arshort(&buffer[0], sizeof(int) - 1);
+  int_var = -1;
+  arshort >> int_var;
+  EXPECT_EQ(0, int_var);
+}
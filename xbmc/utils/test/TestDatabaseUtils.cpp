@@ -22,6 +22,11 @@
 #include "video/VideoDatabase.h"
 #include "music/MusicDatabase.h"
 #include "dbwrappers/qry_dat.h"
+#include "dbwrappers/sqlitedataset.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/SortUtils.h"
 #include "utils/Variant.h"
 #include "utils/StringUtils.h"
 
@@ -1310,3 +1315,134 @@ TEST(TestDatabaseUtils, BuildLimitClause)
 // 
 //   static std::string BuildLimitClause(int end, int start = 0);
 // };
+
+TEST(TestDatabaseUtils, BuildOrderByClause)
+{
+  SortDescription sorting;
+  std::string orderBy;
+
+  // nothing to sort by in SQL
+  sorting.sortBy = SortByRandom;
+  EXPECT_FALSE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeMovie, "", orderBy));
+  sorting.sortBy = SortByVideoResolution;
+  EXPECT_FALSE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeMovie, "", orderBy));
+  sorting.sortBy = SortByEpisodeNumber;
+  EXPECT_FALSE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeMovie, "", orderBy));
+
+  sorting.sortBy = SortByTrackNumber;
+  sorting.sortOrder = SortOrderDescending;
+  ASSERT_TRUE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeSong, "", orderBy));
+  EXPECT_STREQ("CAST(COALESCE(songview.iTrack, 0) AS DECIMAL(20,6)) DESC, songview.idSong", orderBy.c_str());
+
+  // text is only sorted by a database that compares it naturally
+  sorting.sortBy = SortByTitle;
+  sorting.sortOrder = SortOrderAscending;
+  EXPECT_FALSE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeSong, "", orderBy));
+  sorting.sortBy = SortByLabel;
+  EXPECT_FALSE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeSong, "", orderBy));
+
+  sorting.sortBy = SortByTitle;
+  ASSERT_TRUE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeSong, "NATURALNOCASE", orderBy));
+  EXPECT_STREQ("(COALESCE(songview.strTitle, '')) COLLATE NATURALNOCASE, songview.idSong", orderBy.c_str());
+}
+
+/* the order of songs sorted by SQLite is the order SortUtils sorts them in */
+class TestDatabaseUtilsSorting : public testing::Test
+{
+protected:
+  TestDatabaseUtilsSorting()
+  {
+    m_tokens = g_advancedSettings.m_vecTokens;
+    g_advancedSettings.m_vecTokens.clear();
+    g_advancedSettings.m_vecTokens.push_back("the ");
+    g_advancedSettings.m_vecTokens.push_back("l'");
+
+    m_db.setHostName(CSpecialProtocol::TranslatePath("special://temp/").c_str());
+    m_db.setDatabase("TestDatabaseUtilsSorting.db");
+    m_db.connect(true);
+    m_ds.reset(m_db.CreateDataset());
+    m_ds->exec("DROP TABLE IF EXISTS songview");
+    m_ds->exec("CREATE TABLE songview (idSong integer primary key, strTitle text, iTrack integer, strAlbum text, strArtists text)");
+
+    const char *titles[] = { "The 10th Song", "the 9th song", "Song 2", "song 10", "Song 02", "L'Amour", "Amour",
+                             "The", "zebra", "Zebra 1", "", "100 Years", "Theme", "a", "B", "10" };
+    for (size_t i = 0; i < sizeof(titles) / sizeof(titles[0]); i++)
+      AddSong(titles[i]);
+  }
+
+  ~TestDatabaseUtilsSorting()
+  {
+    m_ds.reset();
+    m_db.disconnect();
+    XFILE::CFile::Delete("special://temp/TestDatabaseUtilsSorting.db");
+    g_advancedSettings.m_vecTokens = m_tokens;
+  }
+
+  /* adds a song to the table and to the items sorted in memory */
+  void AddSong(const char *title)
+  {
+    size_t i = m_items.size();
+    int track = (int)((i * 7) % 5);
+    std::string album = StringUtils::Format("Album %d", (int)(i % 3) * 5);
+    m_ds->exec(m_db.prepare("INSERT INTO songview VALUES (%i, '%s', %i, '%s', '%s')", (int)i + 1, title, track, album.c_str(), "The Artist"));
+
+    SortItemPtr item(new SortItem());
+    (*item)[FieldId] = (int)i + 1;
+    (*item)[FieldTitle] = title;
+    (*item)[FieldTrackNumber] = track;
+    (*item)[FieldAlbum] = album;
+    (*item)[FieldArtist] = "The Artist";
+    (*item)[FieldLabel] = StringUtils::Format("%d. %s", track, title);
+    m_items.push_back(item);
+  }
+
+  void ExpectSameOrder(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes)
+  {
+    SortDescription sorting;
+    sorting.sortBy = sortBy;
+    sorting.sortOrder = sortOrder;
+    sorting.sortAttributes = attributes;
+
+    std::string orderBy;
+    ASSERT_TRUE(DatabaseUtils::BuildOrderByClause(sorting, MediaTypeSong, m_db.naturalCollation(), orderBy));
+    ASSERT_TRUE(m_ds->query(("SELECT idSong FROM songview ORDER BY " + orderBy).c_str()));
+
+    SortItems items(m_items);
+    SortUtils::Sort(sorting, items);
+
+    ASSERT_EQ(items.size(), (size_t)m_ds->num_rows());
+    for (size_t i = 0; i < items.size() && !m_ds->eof(); i++, m_ds->next())
+      EXPECT_EQ(items[i]->at(FieldId).asInteger(), m_ds->fv(0).get_asInt()) << "sort method " << sortBy << " position " << i;
+    m_ds->close();
+  }
+
+  dbiplus::SqliteDatabase m_db;
+  std::auto_ptr<dbiplus::Dataset> m_ds;
+  std::vector<CStdString> m_tokens;
+  SortItems m_items;
+};
+
+TEST_F(TestDatabaseUtilsSorting, SameAsSortUtils)
+{
+  ExpectSameOrder(SortByTitle, SortOrderAscending, SortAttributeNone);
+  ExpectSameOrder(SortByTitle, SortOrderDescending, SortAttributeNone);
+  ExpectSameOrder(SortByTitle, SortOrderAscending, SortAttributeIgnoreArticle);
+  ExpectSameOrder(SortByLabel, SortOrderAscending, SortAttributeNone);
+  ExpectSameOrder(SortByTrackNumber, SortOrderAscending, SortAttributeNone);
+  ExpectSameOrder(SortByTrackNumber, SortOrderDescending, SortAttributeNone);
+  ExpectSameOrder(SortByAlbum, SortOrderAscending, SortAttributeIgnoreArticle);
+}
+
+TEST_F(TestDatabaseUtilsSorting, NonAsciiTitles)
+{
+  const char *titles[] = { "\xC3\x89clair", "\xC3\xA9clair 2", "Eclair", "\xC3\x9Cber", "\xC3\xBCber 10", "Uber 9",
+                           "Stra\xC3\x9F" "e", "\xC3\x98rsted", "Zo\xC3\xAB", "\xE6\x97\xA5\xE6\x9C\xAC",
+                           "\xF0\x9F\x8E\xB5 Song", "The \xC3\x89t\xC3\xA9", "\xD0\x90\xD0\xB1\xD0\xB2" };
+  for (size_t i = 0; i < sizeof(titles) / sizeof(titles[0]); i++)
+    AddSong(titles[i]);
+
+  ExpectSameOrder(SortByTitle, SortOrderAscending, SortAttributeNone);
+  ExpectSameOrder(SortByTitle, SortOrderDescending, SortAttributeNone);
+  ExpectSameOrder(SortByTitle, SortOrderAscending, SortAttributeIgnoreArticle);
+  ExpectSameOrder(SortByLabel, SortOrderAscending, SortAttributeNone);
+}
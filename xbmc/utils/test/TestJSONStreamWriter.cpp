@@ -0,0 +1,130 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "utils/JSONStreamWriter.h"
+
+#include "gtest/gtest.h"
+
+class CChunkOutput : public IJSONStreamOutput
+{
+public:
+  CChunkOutput(int accept = -1) : m_accept(accept), m_chunks(0) { }
+
+  virtual bool Write(const char *data, size_t size)
+  {
+    if (m_accept >= 0 && m_chunks >= m_accept)
+      return false;
+    m_chunks++;
+    m_data.append(data, size);
+    return true;
+  }
+
+  int m_accept;
+  int m_chunks;
+  std::string m_data;
+};
+
+static CVariant Document(int items)
+{
+  CVariant document;
+  document["id"] = 1;
+  document["name"] = "list";
+  for (int i = 0; i < items; i++)
+  {
+    CVariant item;
+    item["index"] = i;
+    item["ratio"] = i / 4.0;
+    item["tags"].push_back("a");
+    item["tags"].push_back(true);
+    document["items"].push_back(item);
+  }
+  return document;
+}
+
+static void WriteDocument(CJSONStreamWriter &writer, const CVariant &document)
+{
+  // the members in the order of the CVariant's map
+  writer.OpenObject();
+  writer.WriteKey("id");
+  writer.WriteValue(document["id"]);
+  writer.WriteKey("items");
+  writer.OpenArray();
+  for (CVariant::const_iterator_array itr = document["items"].begin_array(); itr != document["items"].end_array(); itr++)
+    writer.WriteValue(*itr);
+  writer.CloseArray();
+  writer.WriteKey("name");
+  writer.WriteValue(document["name"]);
+  writer.CloseObject();
+}
+
+TEST(TestJSONStreamWriter, SameAsVariantWriter)
+{
+  CVariant document = Document(3);
+
+  for (int compact = 0; compact <= 1; compact++)
+  {
+    std::string str;
+    CJSONStringOutput output(str);
+    CJSONStreamWriter writer(&output, compact == 1);
+    WriteDocument(writer, document);
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_FALSE(writer.Failed());
+
+    std::string expected = CJSONVariantWriter::Write(document, compact == 1);
+    EXPECT_EQ(expected, str);
+    EXPECT_EQ(expected.size(), writer.Written());
+  }
+}
+
+TEST(TestJSONStreamWriter, Chunks)
+{
+  CVariant document = Document(1000);
+
+  CChunkOutput output;
+  CJSONStreamWriter writer(&output, true, 1024);
+  WriteDocument(writer, document);
+  EXPECT_TRUE(writer.Flush());
+  EXPECT_GT(output.m_chunks, 10);
+  EXPECT_EQ(CJSONVariantWriter::Write(document, true), output.m_data);
+}
+
+TEST(TestJSONStreamWriter, OutputGone)
+{
+  CChunkOutput output(2);
+  CJSONStreamWriter writer(&output, true, 64);
+  WriteDocument(writer, Document(100));
+
+  EXPECT_TRUE(writer.Failed());
+  EXPECT_FALSE(writer.Flush());
+  EXPECT_EQ(2, output.m_chunks);
+  EXPECT_EQ(output.m_data.size(), writer.Written());
+}
+
+TEST(TestJSONStreamWriter, Malformed)
+{
+  std::string str;
+  CJSONStringOutput output(str);
+  CJSONStreamWriter writer(&output, true);
+
+  // keys have to be strings
+  writer.OpenObject();
+  writer.WriteValue(CVariant(1));
+  EXPECT_TRUE(writer.Failed());
+}
@@ -21,6 +21,13 @@
 #include "utils/JobManager.h"
 #include "settings/Settings.h"
 #include "utils/SystemInfo.h"
+#include "utils/Stopwatch.h"
+#include "threads/Atomics.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+
+#include <iostream>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -177,3 +184,158 @@ TEST_F(TestJobManager, IsProcessing)
 
   job->FinishAndStopBlocking();
 }
+
+namespace
+{
+class CountingJob : public CJob
+{
+public:
+  CountingJob(volatile long &counter) : m_counter(counter) {}
+
+  const char * GetType() const
+  {
+    return "CountingJob";
+  }
+
+  bool DoWork()
+  {
+    AtomicIncrement(&m_counter);
+    return true;
+  }
+
+private:
+  volatile long &m_counter;
+};
+
+class CountingCallback : public IJobCallback
+{
+public:
+  CountingCallback(long expected) : m_completed(0), m_expected(expected) {}
+
+  void OnJobComplete(unsigned int jobID, bool success, CJob *job)
+  {
+    if (AtomicIncrement(&m_completed) == m_expected)
+      m_done.Set();
+  }
+
+  volatile long m_completed;
+  long m_expected;
+  CEvent m_done;
+};
+
+/* cancel what's left and wait for the workers to finish, so no job calls a callback that's gone */
+void StopJobs()
+{
+  CJobManager::GetInstance().CancelJobs();
+  CJobManager::GetInstance().Restart();
+}
+
+double MeasureJobsPerSecond(unsigned int workers, long jobs)
+{
+  CJobManager::GetInstance().SetMaxWorkers(workers);
+
+  volatile long processed = 0;
+  CountingCallback callback(jobs);
+  CStopWatch watch;
+  watch.StartZero();
+  for (long i = 0; i < jobs; i++)
+    CJobManager::GetInstance().AddJob(new CountingJob(processed), &callback, CJob::PRIORITY_HIGH);
+  EXPECT_TRUE(callback.m_done.WaitMSec(60000));
+  float elapsed = watch.GetElapsedSeconds();
+  StopJobs();
+
+  EXPECT_EQ(jobs, processed);
+  return elapsed > 0 ? jobs / elapsed : 0;
+}
+
+/* records the order jobs ran in */
+class OrderedJob : public CJob
+{
+public:
+  OrderedJob(std::vector<int> &order, CCriticalSection &section, int index)
+    : m_order(order), m_section(section), m_index(index) {}
+
+  const char * GetType() const
+  {
+    return "OrderedJob";
+  }
+
+  bool DoWork()
+  {
+    CSingleLock lock(m_section);
+    m_order.push_back(m_index);
+    return true;
+  }
+
+private:
+  std::vector<int> &m_order;
+  CCriticalSection &m_section;
+  int m_index;
+};
+
+/* queues OrderedJobs from within a job, so they all go to the same worker */
+class QueueingJob : public CJob
+{
+public:
+  QueueingJob(std::vector<int> &order, CCriticalSection &section, int count, IJobCallback *callback)
+    : m_order(order), m_section(section), m_count(count), m_callback(callback) {}
+
+  const char * GetType() const
+  {
+    return "QueueingJob";
+  }
+
+  bool DoWork()
+  {
+    for (int i = 0; i < m_count; i++)
+      CJobManager::GetInstance().AddJob(new OrderedJob(m_order, m_section, i), m_callback, CJob::PRIORITY_HIGH);
+    return true;
+  }
+
+private:
+  std::vector<int> &m_order;
+  CCriticalSection &m_section;
+  int m_count;
+  IJobCallback *m_callback;
+};
+}
+
+TEST_F(TestJobManager, SameWorkerInOrder)
+{
+  // start a few workers that may steal from each other, then run one job at a time
+  CJobManager::GetInstance().SetMaxWorkers(4);
+  volatile long processed = 0;
+  CountingCallback warmup(8);
+  for (int i = 0; i < 8; i++)
+    CJobManager::GetInstance().AddJob(new CountingJob(processed), &warmup, CJob::PRIORITY_HIGH);
+  EXPECT_TRUE(warmup.m_done.WaitMSec(60000));
+  CJobManager::GetInstance().SetMaxWorkers(1);
+
+  static const int jobs = 200;
+  std::vector<int> order;
+  CCriticalSection section;
+  CountingCallback callback(jobs);
+  CJobManager::GetInstance().AddJob(new QueueingJob(order, section, jobs, &callback), NULL, CJob::PRIORITY_HIGH);
+  EXPECT_TRUE(callback.m_done.WaitMSec(60000));
+  StopJobs();
+  CJobManager::GetInstance().SetMaxWorkers(5);
+
+  CSingleLock lock(section);
+  ASSERT_EQ((size_t)jobs, order.size());
+  for (int i = 0; i < jobs; i++)
+    EXPECT_EQ(i, order[i]);
+}
+
+// timings only, run with --gtest_also_run_disabled_tests
+TEST_F(TestJobManager, DISABLED_Throughput)
+{
+  static const long jobs = 20000;
+  static const unsigned int workers[] = { 1, 4, 16 };
+
+  for (unsigned int i = 0; i < sizeof(workers) / sizeof(workers[0]); i++)
+  {
+    double rate = MeasureJobsPerSecond(workers[i], jobs);
+    std::cout << workers[i] << " workers: " << (long)rate << " jobs/s" << std::endl;
+  }
+  CJobManager::GetInstance().SetMaxWorkers(5);
+}
@@ -0,0 +1,77 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "utils/PrefetchJob.h"
+#include "utils/JobManager.h"
+#include "threads/Atomics.h"
+
+#include "gtest/gtest.h"
+
+namespace
+{
+class CCountingRequest : public CPrefetchRequest
+{
+public:
+  CCountingRequest() : m_runs(0) {}
+
+  volatile long m_runs;
+
+protected:
+  virtual void DoWork()
+  {
+    AtomicIncrement(&m_runs);
+  }
+};
+}
+
+TEST(TestPrefetchJob, ClaimedOnce)
+{
+  CCountingRequest request;
+  EXPECT_TRUE(request.Start());
+  EXPECT_FALSE(request.Start());
+  request.Run();
+  request.Wait();
+  EXPECT_EQ(1, request.m_runs);
+}
+
+TEST(TestPrefetchJob, RunByWorker)
+{
+  boost::shared_ptr<CCountingRequest> request(new CCountingRequest);
+  CJobManager::GetInstance().AddJob(new CPrefetchJob(request, "prefetchtest"), NULL);
+
+  // whoever claims it first runs it, the other one waits for it
+  if (request->Start())
+    request->Run();
+  else
+    request->Wait();
+  EXPECT_EQ(1, request->m_runs);
+}
+
+TEST(TestPrefetchJob, ClaimedBeforeTheJob)
+{
+  boost::shared_ptr<CCountingRequest> request(new CCountingRequest);
+  EXPECT_TRUE(request->Start());
+
+  CPrefetchJob job(request, "prefetchtest");
+  EXPECT_TRUE(job.DoWork());
+  EXPECT_EQ(0, request->m_runs);
+  EXPECT_STREQ("prefetchtest", job.GetType());
+}
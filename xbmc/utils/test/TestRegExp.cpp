@@ -132,6 +132,40 @@ TEST(TestRegExp, operatorEqual)
   EXPECT_STREQ("string", match.c_str());
 }
 
+TEST(TestRegExp, Cache)
+{
+  std::string match;
+  CRegExp *regex = new CRegExp(true);
+  CRegExp regexcached(true), regexcase, regexstudied(true);
+
+  // the same expression compiled again uses the cached code
+  EXPECT_TRUE(regex->RegComp("s([0-9]+)e([0-9]+)"));
+  EXPECT_TRUE(regexcached.RegComp("s([0-9]+)e([0-9]+)"));
+  EXPECT_TRUE(regexcase.RegComp("s([0-9]+)e([0-9]+)"));
+  EXPECT_TRUE(regexstudied.RegComp("s([0-9]+)e([0-9]+)", CRegExp::StudyWithJitComp));
+  delete regex;
+  EXPECT_EQ(4, regexcached.RegFind("Show.S01E02.mkv"));
+  EXPECT_STREQ("02", regexcached.GetMatch(2).c_str());
+  EXPECT_EQ(-1, regexcase.RegFind("Show.S01E02.mkv"));
+  EXPECT_EQ(4, regexstudied.RegFind("Show.S01E02.mkv"));
+
+  // evicted code stays valid for the objects using it
+  CRegExp::SetCacheSize(0);
+  EXPECT_EQ(4, regexstudied.RegFind("Show.S01E02.mkv"));
+  EXPECT_TRUE(regexcached.RegComp("^(Test)"));
+  EXPECT_EQ(0, regexcached.RegFind("Test string."));
+  EXPECT_FALSE(regexcached.RegComp("(unbalanced"));
+  CRegExp::SetCacheSize(500);
+  EXPECT_EQ(4, regexstudied.RegFind("Show.S01E02.mkv"));
+
+  // expressions kept out of the cache work the same
+  CRegExp regexuncached(true);
+  EXPECT_TRUE(regexuncached.RegComp("s([0-9]+)e([0-9]+)", CRegExp::NoStudy, CRegExp::NoCache));
+  EXPECT_EQ(4, regexuncached.RegFind("Show.S01E02.mkv"));
+  EXPECT_STREQ("01", regexuncached.GetMatch(1).c_str());
+  EXPECT_FALSE(regexuncached.RegComp("(unbalanced", CRegExp::NoStudy, CRegExp::NoCache));
+}
+
 class TestRegExpLog : public testing::Test
 {
 protected:
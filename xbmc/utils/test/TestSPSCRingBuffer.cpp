@@ -0,0 +1,201 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "utils/SPSCRingBuffer.h"
+#include "utils/RingBuffer.h"
+#include "utils/Stopwatch.h"
+#include "threads/Thread.h"
+
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(TestSPSCRingBuffer, General)
+{
+  CSPSCRingBuffer a;
+  char data[20];
+
+  EXPECT_TRUE(a.Create(20));
+  EXPECT_EQ(20U, a.getSize());
+  EXPECT_EQ(0U, a.getMaxReadSize());
+  EXPECT_EQ(20U, a.getMaxWriteSize());
+  EXPECT_FALSE(a.ReadData(data, 1));
+
+  memset(data, 0, sizeof(data));
+  for (unsigned int i = 0; i < a.getSize(); i++)
+    EXPECT_TRUE(a.WriteData(data, 1));
+  EXPECT_FALSE(a.WriteData(data, 1));
+  EXPECT_EQ(20U, a.getMaxReadSize());
+  a.Clear();
+  EXPECT_EQ(0U, a.getMaxReadSize());
+
+  // wrap around the end of the buffer a few times
+  for (int i = 0; i < 10; i++)
+  {
+    EXPECT_TRUE(a.WriteData("0123456789", 11));
+    memset(data, 0, sizeof(data));
+    EXPECT_TRUE(a.ReadData(data, 5));
+    EXPECT_STREQ("01234", data);
+    EXPECT_TRUE(a.SkipBytes(1));
+    EXPECT_TRUE(a.ReadData(data, 5));
+    EXPECT_STREQ("6789", data);
+  }
+  EXPECT_FALSE(a.SkipBytes(1));
+}
+
+TEST(TestSPSCRingBuffer, Spans)
+{
+  CSPSCRingBuffer a;
+  CSPSCRingBuffer::Span spans[2];
+
+  EXPECT_TRUE(a.Create(16));
+  EXPECT_TRUE(a.WriteData("0123456789ab", 12));
+  EXPECT_TRUE(a.SkipBytes(10));
+
+  // the free space wraps: 4 bytes at the end, 10 at the start
+  EXPECT_EQ(14U, a.PeekWrite(spans));
+  EXPECT_EQ(4U, spans[0].size);
+  EXPECT_EQ(10U, spans[1].size);
+  memcpy(spans[0].data, "cdef", 4);
+  memcpy(spans[1].data, "gh", 2);
+  a.CommitWrite(6);
+
+  EXPECT_EQ(8U, a.PeekRead(spans));
+  EXPECT_EQ(6U, spans[0].size);
+  EXPECT_EQ(0, memcmp(spans[0].data, "abcdef", 6));
+  EXPECT_EQ(2U, spans[1].size);
+  EXPECT_EQ(0, memcmp(spans[1].data, "gh", 2));
+  a.CommitRead(7);
+  EXPECT_EQ(1U, a.getMaxReadSize());
+  EXPECT_EQ(15U, a.getMaxWriteSize());
+}
+
+namespace
+{
+static const unsigned int BlockSize = 4096;
+
+/* writes count blocks into a ring buffer, each filled with its number */
+template<class RingBuffer>
+class CProducer : public IRunnable
+{
+public:
+  CProducer(RingBuffer &buffer, unsigned int count) : m_buffer(buffer), m_count(count) {}
+
+  void Run()
+  {
+    std::vector<char> block(BlockSize);
+    for (unsigned int i = 0; i < m_count; i++)
+    {
+      memset(&block[0], (char)i, BlockSize);
+      while (!m_buffer.WriteData(&block[0], BlockSize))
+        XbmcThreads::ThreadSleep(0);
+    }
+  }
+
+private:
+  RingBuffer   &m_buffer;
+  unsigned int  m_count;
+};
+
+/* reads back what CProducer wrote, returns whether the data was intact */
+template<class RingBuffer>
+bool Consume(RingBuffer &buffer, unsigned int count)
+{
+  std::vector<char> block(BlockSize);
+  bool intact = true;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    while (!buffer.ReadData(&block[0], BlockSize))
+      XbmcThreads::ThreadSleep(0);
+    intact &= block[0] == (char)i && memcmp(&block[0], &block[1], BlockSize - 1) == 0;
+  }
+  return intact;
+}
+
+/* small writes and reads in turn, the cost per call without any contention */
+template<class RingBuffer>
+double MeasureCallRate(unsigned int count)
+{
+  RingBuffer buffer;
+  EXPECT_TRUE(buffer.Create(64 * 1024));
+
+  char block[64] = { 0 };
+  CStopWatch watch;
+  watch.StartZero();
+  for (unsigned int i = 0; i < count; i++)
+  {
+    buffer.WriteData(block, sizeof(block));
+    buffer.ReadData(block, sizeof(block));
+  }
+  float elapsed = watch.GetElapsedSeconds();
+
+  return elapsed > 0 ? 2 * count / elapsed : 0;
+}
+
+template<class RingBuffer>
+double MeasureThroughput(unsigned int count)
+{
+  RingBuffer buffer;
+  EXPECT_TRUE(buffer.Create(64 * 1024));
+
+  CProducer<RingBuffer> producer(buffer, count);
+  CThread thread(&producer, "RingBufferProducer");
+  CStopWatch watch;
+  watch.StartZero();
+  thread.Create();
+  EXPECT_TRUE(Consume(buffer, count));
+  float elapsed = watch.GetElapsedSeconds();
+  thread.WaitForThreadExit(10000);
+
+  return elapsed > 0 ? count * (double)BlockSize / elapsed / (1024 * 1024) : 0;
+}
+}
+
+TEST(TestSPSCRingBuffer, Threaded)
+{
+  CSPSCRingBuffer buffer;
+  EXPECT_TRUE(buffer.Create(10000));
+
+  // an odd size makes the blocks wrap at changing offsets
+  CProducer<CSPSCRingBuffer> producer(buffer, 10000);
+  CThread thread(&producer, "RingBufferProducer");
+  thread.Create();
+  EXPECT_TRUE(Consume(buffer, 10000));
+  EXPECT_TRUE(thread.WaitForThreadExit(10000));
+  EXPECT_EQ(0U, buffer.getMaxReadSize());
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestSPSCRingBuffer, DISABLED_Benchmark)
+{
+  static const unsigned int blocks = 200000;
+  static const unsigned int calls = 5000000;
+
+  double locked = MeasureThroughput<CRingBuffer>(blocks);
+  std::cout << "CRingBuffer: " << (long)locked << " MB/s between two threads" << std::endl;
+  double lockFree = MeasureThroughput<CSPSCRingBuffer>(blocks);
+  std::cout << "CSPSCRingBuffer: " << (long)lockFree << " MB/s between two threads" << std::endl;
+
+  locked = MeasureCallRate<CRingBuffer>(calls);
+  std::cout << "CRingBuffer: " << (long)locked << " calls/s with 64 byte blocks" << std::endl;
+  lockFree = MeasureCallRate<CSPSCRingBuffer>(calls);
+  std::cout << "CSPSCRingBuffer: " << (long)lockFree << " calls/s with 64 byte blocks" << std::endl;
+}
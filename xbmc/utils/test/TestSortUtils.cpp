@@ -19,8 +19,13 @@
  */
 
 #include "utils/SortUtils.h"
+#include "utils/StringUtils.h"
+#include "utils/Stopwatch.h"
 #include "utils/Variant.h"
 
+#include <algorithm>
+#include <iostream>
+
 #include "gtest/gtest.h"
 
 TEST(TestSortUtils, Sort_SortBy)
@@ -131,3 +136,145 @@ TEST(TestSortUtils, GetFieldsForSorting)
   EXPECT_EQ(FieldTrackNumber, *it);
   EXPECT_EQ((unsigned int)4, fields.size());
 }
+
+TEST(TestSortUtils, Sort_TypedKeys)
+{
+  DatabaseResults items;
+  const char *labels[] = { "Movie 10", "Movie 9", "movie 9", "Movie 100" };
+  const double ratings[] = { 7.5, 10.0, 7.5, 9.0 };
+  for (int i = 0; i < 4; i++)
+  {
+    DatabaseResult item;
+    item[FieldId] = i;
+    item[FieldLabel] = labels[i];
+    item[FieldRating] = ratings[i];
+    items.push_back(item);
+  }
+  DatabaseResult special;
+  special[FieldId] = 4;
+  special[FieldLabel] = "All";
+  special[FieldSortSpecial] = SortSpecialOnTop;
+  items.push_back(special);
+
+  SortUtils::Sort(SortByRating, SortOrderDescending, SortAttributeNone, items);
+  ASSERT_EQ((size_t)5, items.size());
+  EXPECT_EQ(4, items[0][FieldId].asInteger());
+  EXPECT_EQ(1, items[1][FieldId].asInteger());
+  EXPECT_EQ(3, items[2][FieldId].asInteger());
+  EXPECT_EQ(0, items[3][FieldId].asInteger());
+  EXPECT_EQ(2, items[4][FieldId].asInteger());
+
+  SortUtils::Sort(SortByLabel, SortOrderAscending, SortAttributeNone, items, 3, 1);
+  ASSERT_EQ((size_t)2, items.size());
+  EXPECT_EQ(1, items[0][FieldId].asInteger());
+  EXPECT_EQ(2, items[1][FieldId].asInteger());
+}
+
+TEST(TestSortUtils, Sort_SortLabel)
+{
+  SortItems items;
+  for (int i = 0; i < 2; i++)
+  {
+    SortItemPtr item(new SortItem());
+    (*item)[FieldLabel] = i == 0 ? "Zulu" : "Alpha";
+    (*item)[FieldYear] = 2000 - i;
+    items.push_back(item);
+  }
+
+  SortUtils::Sort(SortByYear, SortOrderAscending, SortAttributeNone, items);
+  EXPECT_STREQ(L"1999 Alpha", (*items[0])[FieldSort].asWideString().c_str());
+  EXPECT_STREQ(L"2000 Zulu", (*items[1])[FieldSort].asWideString().c_str());
+}
+
+// prints timings, run with --gtest_also_run_disabled_tests
+TEST(TestSortUtils, DISABLED_Benchmark)
+{
+  static const int count = 50000;
+  static const SortBy sortBy[] = { SortByYear, SortByRating, SortByLabel };
+  static const char *names[] = { "year", "rating", "label" };
+
+  DatabaseResults results;
+  results.reserve(count);
+  srand(1);
+  for (int i = 0; i < count; i++)
+  {
+    DatabaseResult item;
+    item[FieldId] = i;
+    item[FieldLabel] = StringUtils::Format("The Movie %d - Part %d", rand() % 5000, rand() % 10);
+    item[FieldYear] = 1950 + rand() % 64;
+    item[FieldRating] = (rand() % 100) / 10.0;
+    results.push_back(item);
+  }
+
+  for (unsigned int i = 0; i < sizeof(sortBy) / sizeof(sortBy[0]); i++)
+  {
+    DatabaseResults items(results);
+    CStopWatch watch;
+    watch.StartZero();
+    SortUtils::Sort(sortBy[i], SortOrderAscending, SortAttributeIgnoreArticle, items);
+    float elapsed = watch.GetElapsedMilliseconds();
+    std::cout << "sorting " << count << " items by " << names[i] << ": " << elapsed << " ms" << std::endl;
+
+    ASSERT_EQ((size_t)count, items.size());
+    for (int j = 1; j < count && sortBy[i] == SortByYear; j++)
+      ASSERT_LE(items[j - 1][FieldYear].asInteger(), items[j][FieldYear].asInteger());
+    for (int j = 1; j < count && sortBy[i] == SortByRating; j++)
+      ASSERT_LE(items[j - 1][FieldRating].asDouble(), items[j][FieldRating].asDouble());
+  }
+}
+
+/* the order Sort_Parallel expects: items on top, by year descending, items on the bottom */
+class CParallelSortLess
+{
+public:
+  bool operator()(const DatabaseResult &left, const DatabaseResult &right) const
+  {
+    int leftRank = Rank(left), rightRank = Rank(right);
+    if (leftRank != rightRank)
+      return leftRank < rightRank;
+    if (leftRank != 1)
+      return false;
+    return left.at(FieldYear).asInteger() > right.at(FieldYear).asInteger();
+  }
+
+private:
+  static int Rank(const DatabaseResult &item)
+  {
+    DatabaseResult::const_iterator it = item.find(FieldSortSpecial);
+    if (it == item.end())
+      return 1;
+    return it->second.asInteger() == SortSpecialOnTop ? 0 : 2;
+  }
+};
+
+TEST(TestSortUtils, Sort_Parallel)
+{
+  static const int count = 100000;
+
+  DatabaseResults items;
+  items.reserve(count);
+  srand(2);
+  for (int i = 0; i < count; i++)
+  {
+    DatabaseResult item;
+    item[FieldId] = i;
+    item[FieldLabel] = "Label";
+    item[FieldYear] = rand() % 50;
+    if (i % 1000 == 0)
+      item[FieldSortSpecial] = i % 2000 == 0 ? SortSpecialOnTop : SortSpecialOnBottom;
+    items.push_back(item);
+  }
+
+  DatabaseResults expected(items);
+  std::stable_sort(expected.begin(), expected.end(), CParallelSortLess());
+
+  // sort with several threads however many CPUs there are
+  SortUtils::SetSortThreads(4);
+  SortUtils::Sort(SortByYear, SortOrderDescending, SortAttributeNone, items, 90100, 100);
+  SortUtils::SetSortThreads(0);
+
+  // the same order as a single stable sort, minus the 100 skipped items
+  ASSERT_EQ((size_t)90000, items.size());
+  for (int i = 0; i < 90000; i++)
+    ASSERT_EQ(expected[i + 100].at(FieldId).asInteger(), items[i].at(FieldId).asInteger()) << "position " << i;
+}
@@ -3429,45 +3429,8 @@ bool CVideoDatabase::GetStreamDetails(CVideoInfoTag& tag) const
 
     while (!pDS->eof())
     {
-      CStreamDetail::StreamType e = (CStreamDetail::StreamType)pDS->fv(1).get_asInt();
-      switch (e)
-      {
-      case CStreamDetail::VIDEO:
-        {
-          CStreamDetailVideo *p = new CStreamDetailVideo();
-          p->m_strCodec = pDS->fv(2).get_asString();
-          p->m_fAspect = pDS->fv(3).get_asFloat();
-          p->m_iWidth = pDS->fv(4).get_asInt();
-          p->m_iHeight = pDS->fv(5).get_asInt();
-          p->m_iDuration = pDS->fv(10).get_asInt();
-          p->m_strStereoMode = pDS->fv(11).get_asString();
-          details.AddStream(p);
-          retVal = true;
-          break;
-        }
-      case CStreamDetail::AUDIO:
-        {
-          CStreamDetailAudio *p = new CStreamDetailAudio();
-          p->m_strCodec = pDS->fv(6).get_asString();
-          if (pDS->fv(7).get_isNull())
-            p->m_iChannels = -1;
-          else
-            p->m_iChannels = pDS->fv(7).get_asInt();
-          p->m_strLanguage = pDS->fv(8).get_asString();
-          details.AddStream(p);
-          retVal = true;
-          break;
-        }
-      case CStreamDetail::SUBTITLE:
-        {
-          CStreamDetailSubtitle *p = new CStreamDetailSubtitle();
-          p->m_strLanguage = pDS->fv(9).get_asString();
-          details.AddStream(p);
-          retVal = true;
-          break;
-        }
-      }
-
+      if (AddStreamDetail(pDS->get_sql_record(), details))
+        retVal = true;
       pDS->next();
     }
 
@@ -3477,12 +3440,58 @@ bool CVideoDatabase::GetStreamDetails(CVideoInfoTag& tag) const
   {
     CLog::Log(LOGERROR, "%s(%i) failed", __FUNCTION__, tag.m_iFileId);
   }
+  FinishStreamDetails(tag);
+
+  return retVal;
+}
+
+bool CVideoDatabase::AddStreamDetail(const dbiplus::sql_record* const record, CStreamDetails &details)
+{
+  CStreamDetail::StreamType e = (CStreamDetail::StreamType)record->at(1).get_asInt();
+  switch (e)
+  {
+  case CStreamDetail::VIDEO:
+    {
+      CStreamDetailVideo *p = new CStreamDetailVideo();
+      p->m_strCodec = record->at(2).get_asString();
+      p->m_fAspect = record->at(3).get_asFloat();
+      p->m_iWidth = record->at(4).get_asInt();
+      p->m_iHeight = record->at(5).get_asInt();
+      p->m_iDuration = record->at(10).get_asInt();
+      p->m_strStereoMode = record->at(11).get_asString();
+      details.AddStream(p);
+      return true;
+    }
+  case CStreamDetail::AUDIO:
+    {
+      CStreamDetailAudio *p = new CStreamDetailAudio();
+      p->m_strCodec = record->at(6).get_asString();
+      if (record->at(7).get_isNull())
+        p->m_iChannels = -1;
+      else
+        p->m_iChannels = record->at(7).get_asInt();
+      p->m_strLanguage = record->at(8).get_asString();
+      details.AddStream(p);
+      return true;
+    }
+  case CStreamDetail::SUBTITLE:
+    {
+      CStreamDetailSubtitle *p = new CStreamDetailSubtitle();
+      p->m_strLanguage = record->at(9).get_asString();
+      details.AddStream(p);
+      return true;
+    }
+  }
+  return false;
+}
+
+void CVideoDatabase::FinishStreamDetails(CVideoInfoTag &tag)
+{
+  CStreamDetails& details = tag.m_streamDetails;
   details.DetermineBestStreams();
 
   if (details.GetVideoDuration() > 0)
     tag.m_duration = details.GetVideoDuration();
-
-  return retVal;
 }
  
 bool CVideoDatabase::GetResumePoint(CVideoInfoTag& tag)
@@ -3824,6 +3833,259 @@ void CVideoDatabase::GetCast(const CStdString &table, const CStdString &table_id
   }
 }
 
+bool CVideoDatabase::GetDetailsForItems(CFileItemList &items)
+{
+  if (NULL == m_pDB.get()) return false;
+  if (NULL == m_pDS2.get()) return false;
+
+  // the tags of the items by the ids their details are stored under
+  VideoTagsById movies, tvshows, episodes, episodeShows, musicvideos, files;
+  for (int i = 0; i < items.Size(); i++)
+  {
+    if (!items[i]->HasVideoInfoTag())
+      continue;
+
+    CVideoInfoTag *tag = items[i]->GetVideoInfoTag();
+    if (tag->m_iDbId <= 0)
+      continue;
+
+    if (tag->m_type == MediaTypeMovie)
+      movies[tag->m_iDbId].push_back(tag);
+    else if (tag->m_type == MediaTypeTvShow)
+      tvshows[tag->m_iDbId].push_back(tag);
+    else if (tag->m_type == MediaTypeEpisode)
+    {
+      episodes[tag->m_iDbId].push_back(tag);
+      if (tag->m_iIdShow > 0)
+        episodeShows[tag->m_iIdShow].push_back(tag);
+    }
+    else if (tag->m_type == MediaTypeMusicVideo)
+      musicvideos[tag->m_iDbId].push_back(tag);
+    else
+      continue;
+
+    if (tag->m_type != MediaTypeTvShow && tag->m_iFileId > 0)
+      files[tag->m_iFileId].push_back(tag);
+
+    tag->m_cast.clear();
+    tag->m_tags.clear();
+    tag->m_showLink.clear();
+    if (tag->m_strPictureURL.m_url.empty())
+      tag->m_strPictureURL.Parse();
+  }
+
+  try
+  {
+    GetCastForItems("movie", "idMovie", movies);
+    GetTagsForItems(MediaTypeMovie, movies);
+    GetShowLinksForItems(movies);
+
+    GetCastForItems("tvshow", "idShow", tvshows);
+    GetTagsForItems(MediaTypeTvShow, tvshows);
+
+    // the cast of an episode is followed by the cast of its show
+    GetCastForItems("episode", "idEpisode", episodes);
+    GetCastForItems("tvshow", "idShow", episodeShows);
+    GetEpisodeBookmarksForItems(episodes);
+
+    GetTagsForItems(MediaTypeMusicVideo, musicvideos);
+
+    GetStreamDetailsForItems(files);
+    return true;
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s failed", __FUNCTION__);
+  }
+  return false;
+}
+
+/* the most ids in the IN () condition of a single query */
+#define VIDEODB_MAX_IDS_PER_QUERY 500
+
+vector<string> CVideoDatabase::GetIdLists(const VideoTagsById &tags)
+{
+  vector<string> idLists;
+  string ids;
+  unsigned int count = 0;
+  for (VideoTagsById::const_iterator it = tags.begin(); it != tags.end(); ++it)
+  {
+    if (count == VIDEODB_MAX_IDS_PER_QUERY)
+    {
+      idLists.push_back(ids);
+      ids.clear();
+      count = 0;
+    }
+    if (!ids.empty())
+      ids += ",";
+    ids += StringUtils::Format("%i", it->first);
+    count++;
+  }
+  if (!ids.empty())
+    idLists.push_back(ids);
+  return idLists;
+}
+
+void CVideoDatabase::GetCastForItems(const std::string &table, const std::string &table_id, const VideoTagsById &tags)
+{
+  vector<string> idLists = GetIdLists(tags);
+  for (vector<string>::const_iterator ids = idLists.begin(); ids != idLists.end(); ++ids)
+  {
+    CStdString sql = PrepareSQL("SELECT actorlink%s.%s,"
+                                "  actors.strActor,"
+                                "  actorlink%s.strRole,"
+                                "  actorlink%s.iOrder,"
+                                "  actors.strThumb,"
+                                "  art.url "
+                                "FROM actorlink%s"
+                                "  JOIN actors ON"
+                                "    actorlink%s.idActor=actors.idActor"
+                                "  LEFT JOIN art ON"
+                                "    art.media_id=actors.idActor AND art.media_type='actor' AND art.type='thumb' "
+                                "WHERE actorlink%s.%s IN (%s) "
+                                "ORDER BY actorlink%s.%s, actorlink%s.iOrder",
+                                table.c_str(), table_id.c_str(), table.c_str(), table.c_str(), table.c_str(), table.c_str(),
+                                table.c_str(), table_id.c_str(), ids->c_str(), table.c_str(), table_id.c_str(), table.c_str());
+    m_pDS2->query(sql.c_str());
+    while (!m_pDS2->eof())
+    {
+      VideoTagsById::const_iterator it = tags.find(m_pDS2->fv(0).get_asInt());
+      if (it != tags.end())
+      {
+        SActorInfo info;
+        info.strName = m_pDS2->fv(1).get_asString();
+        info.strRole = m_pDS2->fv(2).get_asString();
+        info.order = m_pDS2->fv(3).get_asInt();
+        info.thumbUrl.ParseString(m_pDS2->fv(4).get_asString());
+        info.thumb = m_pDS2->fv(5).get_asString();
+
+        // as in GetCast(), an actor is only listed once
+        for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+        {
+          vector<SActorInfo> &cast = (*tag)->m_cast;
+          bool found = false;
+          for (vector<SActorInfo>::const_iterator i = cast.begin(); i != cast.end(); ++i)
+          {
+            if (i->strName == info.strName)
+            {
+              found = true;
+              break;
+            }
+          }
+          if (!found)
+            cast.push_back(info);
+        }
+      }
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+  }
+}
+
+void CVideoDatabase::GetTagsForItems(const std::string &mediaType, const VideoTagsById &tags)
+{
+  vector<string> idLists = GetIdLists(tags);
+  for (vector<string>::const_iterator ids = idLists.begin(); ids != idLists.end(); ++ids)
+  {
+    CStdString sql = PrepareSQL("SELECT taglinks.idMedia, tag.strTag FROM tag JOIN taglinks ON taglinks.idTag = tag.idTag "
+                                "WHERE taglinks.media_type = '%s' AND taglinks.idMedia IN (%s) "
+                                "ORDER BY taglinks.idMedia, tag.idTag", mediaType.c_str(), ids->c_str());
+    m_pDS2->query(sql.c_str());
+    while (!m_pDS2->eof())
+    {
+      VideoTagsById::const_iterator it = tags.find(m_pDS2->fv(0).get_asInt());
+      if (it != tags.end())
+      {
+        for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+          (*tag)->m_tags.push_back(m_pDS2->fv(1).get_asString());
+      }
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+  }
+}
+
+void CVideoDatabase::GetShowLinksForItems(const VideoTagsById &movies)
+{
+  vector<string> idLists = GetIdLists(movies);
+  for (vector<string>::const_iterator ids = idLists.begin(); ids != idLists.end(); ++ids)
+  {
+    CStdString sql = PrepareSQL("SELECT movielinktvshow.idMovie, tvshow.c%02d FROM movielinktvshow "
+                                "JOIN tvshow ON tvshow.idShow = movielinktvshow.idShow "
+                                "WHERE movielinktvshow.idMovie IN (%s) "
+                                "ORDER BY movielinktvshow.idMovie", VIDEODB_ID_TV_TITLE, ids->c_str());
+    m_pDS2->query(sql.c_str());
+    while (!m_pDS2->eof())
+    {
+      VideoTagsById::const_iterator it = movies.find(m_pDS2->fv(0).get_asInt());
+      if (it != movies.end())
+      {
+        for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+          (*tag)->m_showLink.push_back(m_pDS2->fv(1).get_asString());
+      }
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+  }
+}
+
+void CVideoDatabase::GetEpisodeBookmarksForItems(const VideoTagsById &episodes)
+{
+  vector<string> idLists = GetIdLists(episodes);
+  for (vector<string>::const_iterator ids = idLists.begin(); ids != idLists.end(); ++ids)
+  {
+    CStdString sql = PrepareSQL("SELECT episode.idEpisode, bookmark.timeInSeconds FROM bookmark "
+                                "JOIN episode ON episode.c%02d=bookmark.idBookmark "
+                                "WHERE bookmark.type=%i AND episode.idEpisode IN (%s)",
+                                VIDEODB_ID_EPISODE_BOOKMARK, CBookmark::EPISODE, ids->c_str());
+    m_pDS2->query(sql.c_str());
+    while (!m_pDS2->eof())
+    {
+      VideoTagsById::const_iterator it = episodes.find(m_pDS2->fv(0).get_asInt());
+      if (it != episodes.end())
+      {
+        for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+          (*tag)->m_fEpBookmark = m_pDS2->fv(1).get_asFloat();
+      }
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+  }
+}
+
+void CVideoDatabase::GetStreamDetailsForItems(const VideoTagsById &files)
+{
+  for (VideoTagsById::const_iterator it = files.begin(); it != files.end(); ++it)
+  {
+    for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+      (*tag)->m_streamDetails.Reset();
+  }
+
+  vector<string> idLists = GetIdLists(files);
+  for (vector<string>::const_iterator ids = idLists.begin(); ids != idLists.end(); ++ids)
+  {
+    CStdString sql = PrepareSQL("SELECT * FROM streamdetails WHERE idFile IN (%s)", ids->c_str());
+    m_pDS2->query(sql.c_str());
+    while (!m_pDS2->eof())
+    {
+      VideoTagsById::const_iterator it = files.find(m_pDS2->fv(0).get_asInt());
+      if (it != files.end())
+      {
+        for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+          AddStreamDetail(m_pDS2->get_sql_record(), (*tag)->m_streamDetails);
+      }
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+  }
+
+  for (VideoTagsById::const_iterator it = files.begin(); it != files.end(); ++it)
+  {
+    for (vector<CVideoInfoTag*>::const_iterator tag = it->second.begin(); tag != it->second.end(); ++tag)
+      FinishStreamDetails(**tag);
+  }
+}
+
 /// \brief GetVideoSettings() obtains any saved video settings for the current file.
 /// \retval Returns true if the settings exist, false otherwise.
 bool CVideoDatabase::GetVideoSettings(const CStdString &strFilenameAndPath, CVideoSettings &settings)
@@ -5968,24 +6230,37 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
     if (!videoUrl.FromString(strBaseDir) || !GetFilter(videoUrl, extFilter, sorting))
       return false;
 
-    int total = -1;
-
     CStdString strSQL = "select %s from movieview ";
     CStdString strSQLExtra;
     if (!CDatabase::BuildSQL(strSQLExtra, extFilter, strSQLExtra))
       return false;
 
-    // Apply the limiting directly here if there's no special sorting but limiting
-    if (extFilter.limit.empty() &&
-        sorting.sortBy == SortByNone &&
-       (sorting.limitStart > 0 || sorting.limitEnd > 0))
-    {
-      total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
-      strSQLExtra += DatabaseUtils::BuildLimitClause(sorting.limitEnd, sorting.limitStart);
-    }
+    int total = -1;
+    bool sorted = SortInDatabase(strSQL, extFilter, sorting, MediaTypeMovie, strSQLExtra, total);
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
+    if (sorted)
+    {
+      // the rows come sorted and paged, so build the items from them as they are
+      // read instead of holding the whole result set in memory first
+      unsigned int time = XbmcThreads::SystemClockMillis();
+      m_pDS->query_stream(strSQL);
+      while (!m_pDS->eof())
+      {
+        AddMovieItem(videoUrl, m_pDS->get_sql_record(), items);
+        m_pDS->next();
+      }
+      int iRowsFound = m_pDS->num_rows();
+      m_pDS->close();
+      CLog::Log(LOGDEBUG, "%s took %d ms for %d items query: %s", __FUNCTION__, XbmcThreads::SystemClockMillis() - time, iRowsFound, strSQL.c_str());
+
+      // store the total value of items as a property
+      if (iRowsFound > 0)
+        items.SetProperty("total", total < iRowsFound ? iRowsFound : total);
+      return true;
+    }
+
     int iRowsFound = RunQuery(strSQL);
     if (iRowsFound <= 0)
       return iRowsFound == 0;
@@ -5998,7 +6273,7 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
     DatabaseResults results;
     results.reserve(iRowsFound);
 
-    if (!SortUtils::SortFromDataset(sortDescription, MediaTypeMovie, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorting, MediaTypeMovie, m_pDS, results))
       return false;
 
     // get data from returned rows
@@ -6007,23 +6282,7 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
     for (DatabaseResults::const_iterator it = results.begin(); it != results.end(); it++)
     {
       unsigned int targetRow = (unsigned int)it->at(FieldRow).asInteger();
-      const dbiplus::sql_record* const record = data.at(targetRow);
-
-      CVideoInfoTag movie = GetDetailsForMovie(record);
-      if (CProfilesManager::Get().GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE ||
-          g_passwordManager.bMasterUser                                   ||
-          g_passwordManager.IsDatabasePathUnlocked(movie.m_strPath, *CMediaSourceSettings::Get().GetSources("video")))
-      {
-        CFileItemPtr pItem(new CFileItem(movie));
-
-        CVideoDbUrl itemUrl = videoUrl;
-        CStdString path = StringUtils::Format("%ld", movie.m_iDbId);
-        itemUrl.AppendPath(path);
-        pItem->SetPath(itemUrl.ToString());
-
-        pItem->SetOverlayImage(CGUIListItem::ICON_OVERLAY_UNWATCHED,movie.m_playCount > 0);
-        items.Add(pItem);
-      }
+      AddMovieItem(videoUrl, data.at(targetRow), items);
     }
 
     // cleanup
@@ -6037,6 +6296,25 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
   return false;
 }
 
+void CVideoDatabase::AddMovieItem(const CVideoDbUrl &baseUrl, const dbiplus::sql_record* const record, CFileItemList &items)
+{
+  CVideoInfoTag movie = GetDetailsForMovie(record);
+  if (CProfilesManager::Get().GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE ||
+      g_passwordManager.bMasterUser                                   ||
+      g_passwordManager.IsDatabasePathUnlocked(movie.m_strPath, *CMediaSourceSettings::Get().GetSources("video")))
+  {
+    CFileItemPtr pItem(new CFileItem(movie));
+
+    CVideoDbUrl itemUrl = baseUrl;
+    CStdString path = StringUtils::Format("%ld", movie.m_iDbId);
+    itemUrl.AppendPath(path);
+    pItem->SetPath(itemUrl.ToString());
+
+    pItem->SetOverlayImage(CGUIListItem::ICON_OVERLAY_UNWATCHED,movie.m_playCount > 0);
+    items.Add(pItem);
+  }
+}
+
 bool CVideoDatabase::GetTvShowsNav(const CStdString& strBaseDir, CFileItemList& items,
                                   int idGenre /* = -1 */, int idYear /* = -1 */, int idActor /* = -1 */, int idDirector /* = -1 */, int idStudio /* = -1 */, int idTag /* = -1 */,
                                   const SortDescription &sortDescription /* = SortDescription() */)
@@ -6071,24 +6349,19 @@ bool CVideoDatabase::GetTvShowsByWhere(const CStdString& strBaseDir, const Filte
     if (NULL == m_pDB.get()) return false;
     if (NULL == m_pDS.get()) return false;
 
-    int total = -1;
-    
     CStdString strSQL = "SELECT %s FROM tvshowview ";
     CVideoDbUrl videoUrl;
     CStdString strSQLExtra;
     Filter extFilter = filter;
     SortDescription sorting = sortDescription;
+    // leave out empty shows in the query already, so they don't take up places on a page
+    if (g_advancedSettings.m_bVideoLibraryHideEmptySeries)
+      extFilter.AppendWhere("tvshowview.totalCount > 0");
     if (!BuildSQL(strBaseDir, strSQLExtra, extFilter, strSQLExtra, videoUrl, sorting))
       return false;
 
-    // Apply the limiting directly here if there's no special sorting but limiting
-      if (extFilter.limit.empty() &&
-        sorting.sortBy == SortByNone &&
-        (sorting.limitStart > 0 || sorting.limitEnd > 0))
-    {
-      total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
-      strSQLExtra += DatabaseUtils::BuildLimitClause(sorting.limitEnd, sorting.limitStart);
-    }
+    int total = -1;
+    bool sorted = SortInDatabase(strSQL, extFilter, sorting, MediaTypeTvShow, strSQLExtra, total);
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
@@ -6103,7 +6376,7 @@ bool CVideoDatabase::GetTvShowsByWhere(const CStdString& strBaseDir, const Filte
     
     DatabaseResults results;
     results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeTvShow, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorted ? SortDescription() : sorting, MediaTypeTvShow, m_pDS, results))
       return false;
 
     // get data from returned rows
@@ -6383,8 +6656,6 @@ bool CVideoDatabase::GetEpisodesByWhere(const CStdString& strBaseDir, const Filt
     if (NULL == m_pDB.get()) return false;
     if (NULL == m_pDS.get()) return false;
 
-    int total = -1;
-    
     CStdString strSQL = "select %s from episodeview ";
     CVideoDbUrl videoUrl;
     CStdString strSQLExtra;
@@ -6393,14 +6664,8 @@ bool CVideoDatabase::GetEpisodesByWhere(const CStdString& strBaseDir, const Filt
     if (!BuildSQL(strBaseDir, strSQLExtra, extFilter, strSQLExtra, videoUrl, sorting))
       return false;
 
-    // Apply the limiting directly here if there's no special sorting but limiting
-    if (extFilter.limit.empty() &&
-      sorting.sortBy == SortByNone &&
-      (sorting.limitStart > 0 || sorting.limitEnd > 0))
-    {
-      total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
-      strSQLExtra += DatabaseUtils::BuildLimitClause(sorting.limitEnd, sorting.limitStart);
-    }
+    int total = -1;
+    bool sorted = SortInDatabase(strSQL, extFilter, sorting, MediaTypeEpisode, strSQLExtra, total);
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
@@ -6415,7 +6680,7 @@ bool CVideoDatabase::GetEpisodesByWhere(const CStdString& strBaseDir, const Filt
     
     DatabaseResults results;
     results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeEpisode, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorted ? SortDescription() : sorting, MediaTypeEpisode, m_pDS, results))
       return false;
     
     // get data from returned rows
@@ -7235,8 +7500,6 @@ bool CVideoDatabase::GetMusicVideosByWhere(const CStdString &baseDir, const Filt
     if (NULL == m_pDB.get()) return false;
     if (NULL == m_pDS.get()) return false;
 
-    int total = -1;
-    
     CStdString strSQL = "select %s from musicvideoview ";
     CVideoDbUrl videoUrl;
     CStdString strSQLExtra;
@@ -7245,14 +7508,8 @@ bool CVideoDatabase::GetMusicVideosByWhere(const CStdString &baseDir, const Filt
     if (!BuildSQL(baseDir, strSQLExtra, extFilter, strSQLExtra, videoUrl, sorting))
       return false;
 
-    // Apply the limiting directly here if there's no special sorting but limiting
-    if (extFilter.limit.empty() &&
-      sorting.sortBy == SortByNone &&
-      (sorting.limitStart > 0 || sorting.limitEnd > 0))
-    {
-      total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
-      strSQLExtra += DatabaseUtils::BuildLimitClause(sorting.limitEnd, sorting.limitStart);
-    }
+    int total = -1;
+    bool sorted = SortInDatabase(strSQL, extFilter, sorting, MediaTypeMusicVideo, strSQLExtra, total);
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
@@ -7267,7 +7524,7 @@ bool CVideoDatabase::GetMusicVideosByWhere(const CStdString &baseDir, const Filt
     
     DatabaseResults results;
     results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeMusicVideo, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorted ? SortDescription() : sorting, MediaTypeMusicVideo, m_pDS, results))
       return false;
     
     // get data from returned rows
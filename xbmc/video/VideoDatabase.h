@@ -25,6 +25,7 @@
 #include "utils/SortUtils.h"
 #include "video/VideoDbUrl.h"
 
+#include <map>
 #include <memory>
 #include <set>
 
@@ -456,6 +457,15 @@ public:
   bool GetSetInfo(int idSet, CVideoInfoTag& details);
   bool GetFileInfo(const CStdString& strFilenameAndPath, CVideoInfoTag& details, int idFile = -1);
 
+  /*! \brief Get the details of a list of items that GetMovieInfo() and friends get for a single item
+   Reads the cast, tags, links to tv shows, episode bookmarks and stream details of all items with a
+   query per table rather than a few queries per item, so a page of items from one of the *ByWhere()
+   functions gets its details in a fixed number of queries.
+   \param items the items of movies, tv shows, episodes or music videos to complete
+   \return true if the details were read, false otherwise
+   */
+  bool GetDetailsForItems(CFileItemList &items);
+
   int GetPathId(const CStdString& strPath);
   int GetTvShowId(const CStdString& strPath);
   int GetEpisodeId(const CStdString& strFilenameAndPath, int idEpisode=-1, int idSeason=-1); // idEpisode, idSeason are used for multipart episodes as hints
@@ -803,6 +813,33 @@ protected:
   bool GetNavCommon(const CStdString& strBaseDir, CFileItemList& items, const CStdString& type, int idContent=-1, const Filter &filter = Filter(), bool countOnly = false);
   void GetCast(const CStdString &table, const CStdString &table_id, int type_id, std::vector<SActorInfo> &cast);
 
+  /*! \brief Video info tags by the id they are looked up by, see GetDetailsForItems()
+   */
+  typedef std::map<int, std::vector<CVideoInfoTag*> > VideoTagsById;
+
+  /*! \brief Split the ids of a map of tags into comma separated lists for IN () conditions
+   \param tags the tags by id
+   \return lists of at most a few hundred ids each
+   */
+  static std::vector<std::string> GetIdLists(const VideoTagsById &tags);
+
+  void GetCastForItems(const std::string &table, const std::string &table_id, const VideoTagsById &tags);
+  void GetTagsForItems(const std::string &mediaType, const VideoTagsById &tags);
+  void GetShowLinksForItems(const VideoTagsById &movies);
+  void GetEpisodeBookmarksForItems(const VideoTagsById &episodes);
+  void GetStreamDetailsForItems(const VideoTagsById &files);
+
+  /*! \brief Add a row of the streamdetails table to the stream details of an item
+   \param record the row
+   \param details the stream details to add the stream to
+   \return true if the row was a stream, false otherwise
+   */
+  static bool AddStreamDetail(const dbiplus::sql_record* const record, CStreamDetails &details);
+
+  /*! \brief Pick the best streams of an item once its stream details are read, and take its duration from them
+   */
+  static void FinishStreamDetails(CVideoInfoTag &tag);
+
   void GetDetailsFromDB(std::auto_ptr<dbiplus::Dataset> &pDS, int min, int max, const SDbTableOffsets *offsets, CVideoInfoTag &details, int idxOffset = 2);
   void GetDetailsFromDB(const dbiplus::sql_record* const record, int min, int max, const SDbTableOffsets *offsets, CVideoInfoTag &details, int idxOffset = 2);
   CStdString GetValueString(const CVideoInfoTag &details, int min, int max, const SDbTableOffsets *offsets) const;
@@ -824,6 +861,13 @@ private:
    */
   int RunQuery(const CStdString &sql);
 
+  /*! \brief Create a movie item from a movieview row and add it to the list, unless its path is locked
+   \param baseUrl the url of the list the item belongs to
+   \param record the movieview row
+   \param items the list to add the item to
+   */
+  void AddMovieItem(const CVideoDbUrl &baseUrl, const dbiplus::sql_record* const record, CFileItemList &items);
+
   /*! \brief Determine whether the path is using lookup using folders
    \param path the path to check
    \param shows whether this path is from a tvshow (defaults to false)
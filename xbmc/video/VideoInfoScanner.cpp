@@ -57,6 +57,8 @@ using namespace ADDON;
 
 namespace VIDEO
 {
+  /* how many folders past the one being scanned are listed ahead of time */
+  static const unsigned int PrefetchFolders = 16;
 
   CVideoInfoScanner::CVideoInfoScanner() : CThread("VideoInfoScanner")
   {
@@ -106,6 +108,9 @@ namespace VIDEO
       // result in unexpected behaviour.
       m_bCanInterrupt = false;
 
+      // listings left over from an earlier scan may be out of date
+      m_prefetcher.Clear();
+
       bool bCancelled = false;
       while (!bCancelled && m_pathsToScan.size())
       {
@@ -116,6 +121,12 @@ namespace VIDEO
          * occurs.
          */
         CStdString directory = *m_pathsToScan.begin();
+
+        // keep the next few paths listing while this one is scanned
+        set<CStdString>::const_iterator next = m_pathsToScan.begin();
+        for (unsigned int i = 0; i < PrefetchFolders && ++next != m_pathsToScan.end(); ++i)
+          Prefetch(*next);
+
         if (!CDirectory::Exists(directory))
         {
           /*
@@ -128,7 +139,11 @@ namespace VIDEO
         }
         else if (!DoScan(directory))
           bCancelled = true;
+
+        // whatever wasn't asked for by now won't be
+        m_prefetcher.Forget(directory);
       }
+      m_prefetcher.Clear();
 
       if (!bCancelled)
       {
@@ -264,19 +279,19 @@ namespace VIDEO
         m_handle->SetTitle(StringUtils::Format(g_localizeStrings.Get(str), info->Name().c_str()));
       }
 
-      CStdString fastHash = GetFastHash(strDirectory);
-      if (m_database.GetPathHash(strDirectory, dbHash) && !fastHash.empty() && fastHash == dbHash)
+      m_database.GetPathHash(strDirectory, dbHash);
+      ScanListingPtr listing = m_prefetcher.Get(strDirectory, CScanListing::LIST_STACKED, dbHash);
+      CStdString fastHash = listing->m_fastHash;
+      if (!fastHash.empty() && fastHash == dbHash)
       { // fast hashes match - no need to process anything
         CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to no change (fasthash)", CURL::GetRedacted(strDirectory).c_str());
         hash = fastHash;
         bSkip = true;
       }
       if (!bSkip)
-      { // need to fetch the folder
-        CDirectory::GetDirectory(strDirectory, items, g_advancedSettings.m_videoExtensions);
-        items.Stack();
-        // compute hash
-        GetPathHash(items, hash);
+      { // the stacked folder and its hash
+        items.Assign(listing->m_items);
+        hash = listing->m_hash;
         if (hash != dbHash && !hash.empty())
         {
           if (dbHash.empty())
@@ -309,9 +324,9 @@ namespace VIDEO
 
       if (foundDirectly && !settings.parent_name_root)
       {
-        CDirectory::GetDirectory(strDirectory, items, g_advancedSettings.m_videoExtensions);
-        items.SetPath(strDirectory);
-        GetPathHash(items, hash);
+        ScanListingPtr listing = m_prefetcher.Get(strDirectory, CScanListing::LIST_FILES);
+        items.Assign(listing->m_items);
+        hash = listing->m_hash;
         bSkip = true;
         if (!m_database.GetPathHash(strDirectory, dbHash) || dbHash != hash)
         {
@@ -356,26 +371,66 @@ namespace VIDEO
     if (m_handle)
       OnDirectoryScanned(strDirectory);
 
+    // if we have a directory item (non-playlist) we then recurse into that folder
+    // do not recurse for tv shows - we have already looked recursively for episodes
+    vector<CStdString> folders;
     for (int i = 0; i < items.Size(); ++i)
     {
       CFileItemPtr pItem = items[i];
+      if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList() && settings.recurse > 0 && content != CONTENT_TVSHOWS)
+        folders.push_back(pItem->GetPath());
+    }
 
+    size_t prefetched = 0;
+    for (size_t i = 0; i < folders.size(); ++i)
+    {
       if (m_bStop)
         break;
 
-      // if we have a directory item (non-playlist) we then recurse into that folder
-      // do not recurse for tv shows - we have already looked recursively for episodes
-      if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList() && settings.recurse > 0 && content != CONTENT_TVSHOWS)
+      // keep the next few folders listing while this one is scanned
+      for (; prefetched < folders.size() && prefetched <= i + PrefetchFolders; ++prefetched)
+        Prefetch(folders[prefetched]);
+
+      if (!DoScan(folders[i]))
       {
-        if (!DoScan(pItem->GetPath()))
-        {
-          m_bStop = true;
-        }
+        m_bStop = true;
       }
     }
     return !m_bStop;
   }
 
+  void CVideoInfoScanner::Prefetch(const CStdString& strDirectory)
+  {
+    if (m_prefetcher.IsPrefetched(strDirectory))
+      return;
+
+    bool foundDirectly = false;
+    SScanSettings settings;
+    ScraperPtr info = m_database.GetScraperForPath(strDirectory, settings, foundDirectly);
+    CONTENT_TYPE content = info ? info->Content() : CONTENT_NONE;
+
+    if (content == CONTENT_NONE || (!m_scanAll && settings.noupdate))
+      return;
+
+    if (CUtil::ExcludeFileOrFolder(strDirectory, content == CONTENT_TVSHOWS ? g_advancedSettings.m_tvshowExcludeFromScanRegExps
+                                                                              : g_advancedSettings.m_moviesExcludeFromScanRegExps))
+      return;
+
+    if (content == CONTENT_MOVIES || content == CONTENT_MUSICVIDEOS)
+    {
+      CStdString dbHash;
+      m_database.GetPathHash(strDirectory, dbHash);
+      m_prefetcher.Prefetch(strDirectory, CScanListing::LIST_STACKED, dbHash);
+    }
+    else if (content == CONTENT_TVSHOWS)
+    {
+      if (foundDirectly && !settings.parent_name_root)
+        m_prefetcher.Prefetch(strDirectory, CScanListing::LIST_FILES);
+      else
+        m_prefetcher.Prefetch(strDirectory, CScanListing::LIST_RECURSIVE);
+    }
+  }
+
   bool CVideoInfoScanner::RetrieveVideoInfo(CFileItemList& items, bool bDirNames, CONTENT_TYPE content, bool useLocal, CScraperUrl* pURL, bool fetchEpisodes, CGUIDialogProgress* pDlgProgress)
   {
     if (pDlgProgress)
@@ -395,11 +450,19 @@ namespace VIDEO
 
     bool FoundSomeInfo = false;
     vector<int> seenPaths;
+    int prefetched = 0;
     for (int i = 0; i < (int)items.Size(); ++i)
     {
       m_nfoReader.Close();
       CFileItemPtr pItem = items[i];
 
+      // keep the next few shows listing while this one is scraped
+      for (; content == CONTENT_TVSHOWS && fetchEpisodes && prefetched < items.Size() && prefetched <= i + (int)PrefetchFolders; ++prefetched)
+      {
+        if (items[prefetched]->m_bIsFolder)
+          m_prefetcher.Prefetch(items[prefetched]->GetPath(), CScanListing::LIST_RECURSIVE);
+      }
+
       // we do this since we may have a override per dir
       ScraperPtr info2 = m_database.GetScraperForPath(pItem->m_bIsFolder ? pItem->GetPath() : items.GetPath());
       if (!info2) // skip
@@ -670,9 +733,10 @@ namespace VIDEO
 
     if (item->m_bIsFolder)
     {
-      CUtil::GetRecursiveListing(item->GetPath(), items, g_advancedSettings.m_videoExtensions, true);
-      CStdString hash, dbHash;
-      int numFilesInFolder = GetPathHash(items, hash);
+      ScanListingPtr listing = m_prefetcher.Get(item->GetPath(), CScanListing::LIST_RECURSIVE);
+      items.Assign(listing->m_items);
+      CStdString hash = listing->m_hash, dbHash;
+      int numFilesInFolder = listing->m_count;
 
       if (m_database.GetPathHash(item->GetPath(), dbHash) && dbHash == hash)
       {
@@ -868,7 +932,7 @@ namespace VIDEO
 
   bool CVideoInfoScanner::EnumerateEpisodeItem(const CFileItem *item, EPISODELIST& episodeList)
   {
-    SETTINGS_TVSHOWLIST expression = g_advancedSettings.m_tvshowEnumRegExps;
+    const SETTINGS_TVSHOWLIST& expression = g_advancedSettings.m_tvshowEnumRegExps;
 
     CStdString strLabel=item->GetPath();
     // URLDecode in case an episode is on a http/https/dav/davs:// source and URL-encoded like foo%201x01%20bar.avi
@@ -877,7 +941,7 @@ namespace VIDEO
     for (unsigned int i=0;i<expression.size();++i)
     {
       CRegExp reg(true, CRegExp::autoUtf8);
-      if (!reg.RegComp(expression[i].regexp))
+      if (!reg.RegComp(expression[i].regexp, CRegExp::StudyWithJitComp))
         continue;
 
       int regexppos, regexp2pos;
@@ -947,7 +1011,7 @@ namespace VIDEO
 
       CRegExp reg2(true, CRegExp::autoUtf8);
       // check the remainder of the string for any further episodes.
-      if (!byDate && reg2.RegComp(g_advancedSettings.m_tvshowMultiPartEnumRegExp))
+      if (!byDate && reg2.RegComp(g_advancedSettings.m_tvshowMultiPartEnumRegExp, CRegExp::StudyWithJitComp))
       {
         int offset = 0;
 
@@ -1691,7 +1755,7 @@ namespace VIDEO
     return items.GetFolderCount() == 0;
   }
 
-  CStdString CVideoInfoScanner::GetFastHash(const CStdString &directory) const
+  CStdString CVideoInfoScanner::GetFastHash(const CStdString &directory)
   {
     struct __stat64 buffer;
     if (XFILE::CFile::Stat(directory, &buffer) == 0)
@@ -22,6 +22,7 @@
 #include "VideoDatabase.h"
 #include "addons/Scraper.h"
 #include "NfoFile.h"
+#include "VideoScanPrefetcher.h"
 
 class CRegExp;
 class CFileItem;
@@ -120,10 +121,33 @@ namespace VIDEO
     static std::string GetImage(CFileItem *pItem, bool useLocal, bool bApplyToDir, const std::string &type = "");
     static std::string GetFanart(CFileItem *pItem, bool useLocal);
 
+    /*! \brief Hash a folder listing by the paths, sizes and dates of its items
+     \param items the folder listing
+     \param hash [out] the hash, empty if there are no items
+     \return the number of videos in the listing
+     */
+    static int GetPathHash(const CFileItemList &items, CStdString &hash);
+
+    /*! \brief Retrieve a "fast" hash of the given directory (if available)
+     Performs a stat() on the directory, and uses modified time to create a "fast"
+     hash of the folder. If no modified time is available, the create time is used,
+     and if neither are available, an empty hash is returned.
+     \param directory folder to hash
+     \return the hash of the folder of the form "fast<datetime>"
+     */
+    static CStdString GetFastHash(const CStdString &directory);
+
   protected:
     virtual void Process();
     bool DoScan(const CStdString& strDirectory);
 
+    /*! \brief Have the prefetcher list a folder that DoScan() is going to scan
+     Takes the same decisions DoScan() takes for the folder, DoScan() checks them again
+     when it gets to the folder.
+     \param strDirectory folder to list
+     */
+    void Prefetch(const CStdString& strDirectory);
+
     INFO_RET RetrieveInfoForTvShow(CFileItem *pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, bool fetchEpisodes, CGUIDialogProgress* pDlgProgress);
     INFO_RET RetrieveInfoForMovie(CFileItem *pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress);
     INFO_RET RetrieveInfoForMusicVideo(CFileItem *pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress);
@@ -179,17 +203,6 @@ namespace VIDEO
      */
     void FetchActorThumbs(std::vector<SActorInfo>& actors, const CStdString& strPath);
 
-    static int GetPathHash(const CFileItemList &items, CStdString &hash);
-
-    /*! \brief Retrieve a "fast" hash of the given directory (if available)
-     Performs a stat() on the directory, and uses modified time to create a "fast"
-     hash of the folder. If no modified time is available, the create time is used,
-     and if neither are available, an empty hash is returned.
-     \param directory folder to hash
-     \return the hash of the folder of the form "fast<datetime>"
-     */
-    CStdString GetFastHash(const CStdString &directory) const;
-
     /*! \brief Decide whether a folder listing could use the "fast" hash
      Fast hashing can be done whenever the folder contains no scannable subfolders, as the
      fast hash technique uses modified time to determine when folder content changes, which
@@ -234,6 +247,7 @@ namespace VIDEO
     bool m_scanAll;
     CStdString m_strStartDir;
     CVideoDatabase m_database;
+    CVideoScanPrefetcher m_prefetcher;
     std::set<CStdString> m_pathsToScan;
     std::set<CStdString> m_pathsToCount;
     std::set<int> m_pathsToClean;
@@ -0,0 +1,166 @@
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "VideoScanPrefetcher.h"
+#include "VideoInfoScanner.h"
+#include "URL.h"
+#include "Util.h"
+#include "filesystem/Directory.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/JobManager.h"
+#include "utils/PrefetchJob.h"
+#include "utils/URIUtils.h"
+
+using namespace std;
+using namespace XFILE;
+
+namespace VIDEO
+{
+  /* A folder to list, shared by the prefetcher and the job listing it */
+  class CScanListingRequest : public CPrefetchRequest
+  {
+  public:
+    CScanListingRequest(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash)
+      : m_directory(directory), m_mode(mode), m_dbHash(dbHash), m_listing(new CScanListing)
+    {
+    }
+
+    const CStdString         m_directory;
+    const CScanListing::MODE m_mode;
+    const CStdString         m_dbHash;
+    ScanListingPtr           m_listing;
+
+  protected:
+    virtual void DoWork()
+    {
+      CVideoScanPrefetcher::List(m_directory, m_mode, m_dbHash, *m_listing);
+    }
+  };
+
+  CVideoScanPrefetcher::CVideoScanPrefetcher(unsigned int jobsPerHost /* = 3 */)
+    : m_jobsPerHost(jobsPerHost)
+  {
+  }
+
+  CVideoScanPrefetcher::~CVideoScanPrefetcher()
+  {
+    Clear();
+  }
+
+  void CVideoScanPrefetcher::Prefetch(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash /* = "" */)
+  {
+    if (m_requests.find(directory) != m_requests.end())
+      return;
+
+    ScanListingRequestPtr request(new CScanListingRequest(directory, mode, dbHash));
+    m_requests.insert(make_pair(directory, request));
+
+    // folders of the same host wait for each other, so we don't flood a NAS with requests
+    std::string host = CURL(directory).GetHostName();
+    Hosts::iterator queue = m_hosts.find(host);
+    if (queue == m_hosts.end())
+      queue = m_hosts.insert(make_pair(host, new CJobQueue(false, m_jobsPerHost, CJob::PRIORITY_LOW))).first;
+    queue->second->AddJob(new CPrefetchJob(request, "videoscanlisting"));
+  }
+
+  bool CVideoScanPrefetcher::IsPrefetched(const CStdString &directory) const
+  {
+    return m_requests.find(directory) != m_requests.end();
+  }
+
+  ScanListingPtr CVideoScanPrefetcher::Get(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash /* = "" */)
+  {
+    Requests::iterator it = m_requests.find(directory);
+    if (it != m_requests.end())
+    {
+      ScanListingRequestPtr request = it->second;
+      m_requests.erase(it);
+
+      // a worker is on it, wait rather than listing it twice
+      if (!request->Start())
+      {
+        request->Wait();
+        ScanListingPtr listing = request->m_listing;
+        if (listing->m_mode == mode && (listing->m_listed || listing->m_dbHash == dbHash))
+          return listing;
+      }
+    }
+
+    ScanListingPtr listing(new CScanListing);
+    List(directory, mode, dbHash, *listing);
+    return listing;
+  }
+
+  void CVideoScanPrefetcher::Forget(const CStdString &directory)
+  {
+    for (Requests::iterator it = m_requests.begin(); it != m_requests.end(); )
+    {
+      if (URIUtils::IsInPath(it->first, directory))
+      {
+        // claiming the request turns its job into a no-op if it hasn't started yet
+        it->second->Start();
+        m_requests.erase(it++);
+      }
+      else
+        ++it;
+    }
+  }
+
+  void CVideoScanPrefetcher::Clear()
+  {
+    for (Requests::iterator it = m_requests.begin(); it != m_requests.end(); ++it)
+      it->second->Start();
+    m_requests.clear();
+
+    // jobs in progress finish on their own, they hold on to their request
+    for (Hosts::iterator it = m_hosts.begin(); it != m_hosts.end(); ++it)
+      delete it->second;
+    m_hosts.clear();
+  }
+
+  void CVideoScanPrefetcher::List(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash, CScanListing &listing)
+  {
+    listing.m_mode = mode;
+    listing.m_dbHash = dbHash;
+    listing.m_listed = true;
+
+    switch (mode)
+    {
+    case CScanListing::LIST_STACKED:
+      listing.m_fastHash = CVideoInfoScanner::GetFastHash(directory);
+      if (!listing.m_fastHash.empty() && listing.m_fastHash == dbHash)
+      { // unchanged, no need to list it
+        listing.m_listed = false;
+        return;
+      }
+      CDirectory::GetDirectory(directory, listing.m_items, g_advancedSettings.m_videoExtensions);
+      listing.m_items.Stack();
+      break;
+    case CScanListing::LIST_RECURSIVE:
+      CUtil::GetRecursiveListing(directory, listing.m_items, g_advancedSettings.m_videoExtensions, true);
+      break;
+    default:
+      CDirectory::GetDirectory(directory, listing.m_items, g_advancedSettings.m_videoExtensions);
+      listing.m_items.SetPath(directory);
+      break;
+    }
+    listing.m_count = CVideoInfoScanner::GetPathHash(listing.m_items, listing.m_hash);
+  }
+}
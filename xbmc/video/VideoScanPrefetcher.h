@@ -0,0 +1,122 @@
+#pragma once
+/*
+ *      Copyright (C) 2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include "FileItem.h"
+#include "utils/StdString.h"
+
+class CJobQueue;
+
+namespace VIDEO
+{
+  class CScanListingRequest;
+
+  /*! \brief A folder as the video scanner reads it from the file system */
+  class CScanListing
+  {
+  public:
+    enum MODE
+    {
+      LIST_FILES = 0, ///< list the folder, as for a tv show source
+      LIST_STACKED,   ///< fast hash the folder and list and stack it unless the fast hash is the database hash, as for movies and music videos
+      LIST_RECURSIVE  ///< list the folder and its subfolders, as for a tv show
+    };
+
+    CScanListing() : m_mode(LIST_FILES), m_listed(false), m_count(0) {}
+
+    MODE          m_mode;
+    bool          m_listed;   ///< false if the fast hash matched m_dbHash and the folder wasn't listed
+    CStdString    m_dbHash;   ///< the database hash the fast hash was compared with
+    CStdString    m_fastHash; ///< fast hash of the folder, LIST_STACKED only
+    CStdString    m_hash;     ///< hash of m_items, empty if the folder is empty or can't be listed
+    int           m_count;    ///< number of videos in m_items
+    CFileItemList m_items;
+
+  private:
+    CScanListing(const CScanListing&);
+    CScanListing& operator=(const CScanListing&);
+  };
+
+  typedef boost::shared_ptr<CScanListing> ScanListingPtr;
+
+  /*! \brief Lists folders for the video scanner ahead of time
+
+   The scanner names the folders it is about to scan, and job manager workers
+   list and hash them while the scanner is busy with the database and the
+   scrapers. At most jobsPerHost folders of any one host are listed at once,
+   so a NAS isn't flooded with requests. Get() waits for a listing in
+   progress, or lists the folder on the calling thread if no worker started
+   on it yet, so scanning is never slower than listing every folder in turn.
+
+   Only the scanner thread may call the member functions.
+   */
+  class CVideoScanPrefetcher
+  {
+  public:
+    CVideoScanPrefetcher(unsigned int jobsPerHost = 3);
+    ~CVideoScanPrefetcher();
+
+    /*! \brief Start listing a folder, unless it is listed already
+     \param directory the folder to list
+     \param mode how to list it
+     \param dbHash the hash of the folder in the database, used by LIST_STACKED
+     */
+    void Prefetch(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash = "");
+
+    /*! \brief Check whether a folder is being listed or waiting to be taken with Get() */
+    bool IsPrefetched(const CStdString &directory) const;
+
+    /*! \brief Take the listing of a folder, waiting for it or listing it here as needed
+     A listing prefetched in another mode, or compared with another database hash than
+     dbHash without being listed, is thrown away and the folder listed again.
+     \param directory the folder to list
+     \param mode how to list it
+     \param dbHash the hash of the folder in the database, used by LIST_STACKED
+     \return the listing, never NULL
+     */
+    ScanListingPtr Get(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash = "");
+
+    /*! \brief Forget the listings of a folder and its subfolders, they won't be asked for */
+    void Forget(const CStdString &directory);
+
+    /*! \brief Forget all listings and cancel the listing jobs */
+    void Clear();
+
+    /*! \brief List a folder the way the video scanner does
+     \param directory the folder to list
+     \param mode how to list it
+     \param dbHash the hash of the folder in the database, used by LIST_STACKED
+     \param listing [out] the listing
+     */
+    static void List(const CStdString &directory, CScanListing::MODE mode, const CStdString &dbHash, CScanListing &listing);
+
+  private:
+    typedef boost::shared_ptr<CScanListingRequest> ScanListingRequestPtr;
+    typedef std::map<CStdString, ScanListingRequestPtr> Requests;
+    typedef std::map<std::string, CJobQueue*> Hosts;
+
+    unsigned int m_jobsPerHost;
+    Requests     m_requests;
+    Hosts        m_hosts; ///< a job queue for each host, limiting the listings in progress
+  };
+}